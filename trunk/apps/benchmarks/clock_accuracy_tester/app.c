@@ -18,6 +18,8 @@
 
 #include <mios32.h>
 #include <string.h>
+#include <stdlib.h>
+#include <seq_bpm.h>
 #include "app.h"
 
 
@@ -26,6 +28,9 @@
 /////////////////////////////////////////////////////////////////////////////
 #define STRING_MAX 80
 
+// max. number of clock timestamps which can be recorded
+#define RECORD_MAX 2048
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local types
@@ -49,6 +54,7 @@ static s32 DelayUpdate(delay_t* d, u32 timestamp);
 static s32 CONSOLE_Parse(mios32_midi_port_t port, u8 byte);
 
 static s32 NOTIFY_MIDI_Rx(mios32_midi_port_t port, u8 byte);
+static s32 NOTIFY_MIDI_Realtime(mios32_midi_port_t port, u8 midi_byte, u32 timestamp);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -69,6 +75,11 @@ static volatile u8 print_message; // notifier
 static char line_buffer[STRING_MAX];
 static u16 line_ix;
 
+static u32 record_timestamp[RECORD_MAX];
+static u16 record_num;
+static u16 record_ix;
+static volatile u8 record_finished; // notifier
+
 /////////////////////////////////////////////////////////////////////////////
 // This hook is called after startup to initialize the application
 /////////////////////////////////////////////////////////////////////////////
@@ -80,6 +91,22 @@ void APP_Init(void)
   // install MIDI Rx callback function
   MIOS32_MIDI_DirectRxCallback_Init(&NOTIFY_MIDI_Rx);
 
+  // MIDI clocks are timestamped on arrival, and forwarded to the BPM generator
+  // which filters the timestamps
+  {
+    int i;
+    for(i=0; i<4; ++i) {
+      MIOS32_MIDI_RealtimeTap_Init(USB0 + i, &NOTIFY_MIDI_Realtime);
+      MIOS32_MIDI_RealtimeTap_Init(UART0 + i, &NOTIFY_MIDI_Realtime);
+    }
+  }
+  SEQ_BPM_Init(0);
+  SEQ_BPM_ModeSet(SEQ_BPM_MODE_Slave);
+
+  record_num = 0;
+  record_ix = 0;
+  record_finished = 0;
+
   // print welcome message on MIOS terminal
   MIOS32_MIDI_SendDebugMessage("\n");
   MIOS32_MIDI_SendDebugMessage("====================\n");
@@ -131,6 +158,29 @@ void APP_Background(void)
 				   c_d_tick.delay_min / 1000, c_d_tick.delay_min % 1000,
 				   avg / 1000, avg % 1000,
 				   c_d_tick.delay_max / 1000, c_d_tick.delay_max % 1000);
+
+      seq_bpm_dll_state_t dll;
+      SEQ_BPM_DLL_StateGet(&dll);
+      if( dll.locked ) {
+	u32 dll_bpm = (u32)(dll.bpm * 1000);
+	MIOS32_MIDI_SendDebugMessage("DLL %d.%03d  -  phase error %d uS, jitter %d uS, relocks %d\n",
+				     dll_bpm / 1000, dll_bpm % 1000,
+				     dll.phase_error_us, dll.jitter_us, dll.relocks);
+      }
+    }
+
+    if( record_finished ) {
+      // dump the recorded timestamps, they can be replayed with gnu_test/clock_replay
+      MIOS32_MIDI_SendDebugMessage("Recorded clock timestamps (uS):\n");
+      int i;
+      for(i=0; i<record_num; ++i)
+	MIOS32_MIDI_SendDebugMessage("%u\n", record_timestamp[i]);
+      MIOS32_MIDI_SendDebugMessage("Recording finished.\n");
+
+      MIOS32_IRQ_Disable();
+      record_finished = 0;
+      record_num = 0;
+      MIOS32_IRQ_Enable();
     }
   }
 }
@@ -209,6 +259,8 @@ s32 CONSOLE_Parse(mios32_midi_port_t port, u8 byte)
 	MIOS32_MIDI_SendDebugMessage("Welcome to " MIOS32_LCD_BOOT_MSG_LINE1 "!");
 	MIOS32_MIDI_SendDebugMessage("Following commands are available:");
 	MIOS32_MIDI_SendDebugMessage("  reset:          clears the current measurements\n");
+	MIOS32_MIDI_SendDebugMessage("  record <n>:     records the timestamps of the next <n> clocks (max. %d)\n", RECORD_MAX);
+	MIOS32_MIDI_SendDebugMessage("  bandwidth <n>:  sets the DLL bandwidth in 1/1000 of the clock rate (1..100)\n");
 	MIOS32_MIDI_SendDebugMessage("  help:           this page\n");
       } else if( strcmp(parameter, "reset") == 0 ) {
 	MIOS32_IRQ_Disable();
@@ -221,6 +273,28 @@ s32 CONSOLE_Parse(mios32_midi_port_t port, u8 byte)
 	MIOS32_IRQ_Enable();
 
 	MIOS32_MIDI_SendDebugMessage("Measurements have been cleared!\n");
+      } else if( strcmp(parameter, "record") == 0 ) {
+	char *arg = strtok_r(NULL, separators, &brkt);
+	int num = arg ? atoi(arg) : 0;
+	if( num < 1 || num > RECORD_MAX ) {
+	  MIOS32_MIDI_SendDebugMessage("Please specify the number of clocks (1..%d), e.g. \"record 1000\"\n", RECORD_MAX);
+	} else {
+	  MIOS32_IRQ_Disable();
+	  record_ix = 0;
+	  record_finished = 0;
+	  record_num = num;
+	  MIOS32_IRQ_Enable();
+
+	  MIOS32_MIDI_SendDebugMessage("Recording the next %d clocks...\n", num);
+	}
+      } else if( strcmp(parameter, "bandwidth") == 0 ) {
+	char *arg = strtok_r(NULL, separators, &brkt);
+	int bandwidth = arg ? atoi(arg) : 0;
+	if( SEQ_BPM_DLL_BandwidthSet(bandwidth / 1000.0) < 0 ) {
+	  MIOS32_MIDI_SendDebugMessage("Please specify the DLL bandwidth (1..100), e.g. \"bandwidth 10\"\n");
+	} else {
+	  MIOS32_MIDI_SendDebugMessage("DLL bandwidth set to 0.%03d\n", bandwidth);
+	}
       } else {
 	MIOS32_MIDI_SendDebugMessage("Unknown command - type 'help' to list available commands!\n");
       }
@@ -286,6 +360,24 @@ static s32 DelayUpdate(delay_t* d, u32 timestamp)
 
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Installed via MIOS32_MIDI_RealtimeTap_Init
+/////////////////////////////////////////////////////////////////////////////
+static s32 NOTIFY_MIDI_Realtime(mios32_midi_port_t port, u8 midi_byte, u32 timestamp)
+{
+  if( midi_byte == 0xf8 && record_num && !record_finished ) {
+    record_timestamp[record_ix] = timestamp;
+    if( ++record_ix >= record_num )
+      record_finished = 1;
+  }
+
+  SEQ_BPM_NotifyMIDIRxTimestamp(midi_byte, timestamp);
+
+  // measure the unfiltered delays
+  return NOTIFY_MIDI_Rx(port, midi_byte);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Installed via MIOS32_MIDI_DirectRxCallback_Init
 /////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,299 @@
+// $Id$
+/*
+ * Host build of a MIDI clock slave replay
+ *
+ * Feeds a stream of MIDI clock timestamps into the SEQ_BPM slave, and
+ * measures how accurate the interpolated internal clocks (384 ppqn) follow
+ * the incoming clock. The 250 uS timer of the BPM generator is emulated.
+ *
+ * The stream is processed twice:
+ *   - counter: clocks are notified with SEQ_BPM_NotifyMIDIRx(), the delay
+ *              is measured with the 250 uS timer
+ *   - dll:     clocks are notified with SEQ_BPM_NotifyMIDIRxTimestamp(),
+ *              the timestamps are filtered by the DLL
+ *
+ * The clock stream can be recorded with the "record" command of the
+ * clock_accuracy_tester application: one timestamp (in uS) per line,
+ * lines which don't start with a number are ignored.
+ * If no file is specified, a synthetic stream is generated: a master which
+ * drifts from 120 to 126 BPM, with 1 mS timestamp granularity (USB frames)
+ * and +/- 300 uS random jitter.
+ *
+ * Usage: clock_replay [-b <dll bandwidth>] [<clock file>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define PPQN              384
+#define TIMER_PERIOD_US   250
+
+#define SYNTH_CLOCKS      (24*4*128) // 128 bars
+#define SYNTH_BPM_START   120.0
+#define SYNTH_BPM_END     126.0
+#define SYNTH_JITTER_US   300
+#define SYNTH_GRANULARITY 1000
+
+// the reference tempo is the average clock interval of +/- one beat
+#define REF_WINDOW        24
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static void (*timer_irq_handler)(void);
+
+static u32 *clock_time;
+static u32 num_clocks;
+
+static double *tick_time;
+static u32 num_ticks;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated MIOS32 functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_IRQ_Disable(void) { return 0; }
+s32 MIOS32_IRQ_Enable(void) { return 0; }
+
+s32 MIOS32_TIMER_Init(u8 timer, u32 period, void *_irq_handler, u8 irq_priority)
+{
+  timer_irq_handler = _irq_handler;
+  return 0;
+}
+
+s32 MIOS32_TIMER_ReInit(u8 timer, u32 period)
+{
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Clock streams
+/////////////////////////////////////////////////////////////////////////////
+static s32 ClockStreamRead(char *filename)
+{
+  FILE *f = fopen(filename, "r");
+  char line[128];
+  u32 max_clocks = 1024;
+
+  if( f == NULL )
+    return -1;
+
+  clock_time = (u32 *)malloc(max_clocks * sizeof(u32));
+  num_clocks = 0;
+  while( fgets(line, sizeof(line), f) ) {
+    unsigned int timestamp;
+    if( sscanf(line, "%u", &timestamp) != 1 )
+      continue;
+
+    if( num_clocks >= max_clocks ) {
+      max_clocks *= 2;
+      clock_time = (u32 *)realloc(clock_time, max_clocks * sizeof(u32));
+    }
+    clock_time[num_clocks++] = timestamp;
+  }
+
+  fclose(f);
+
+  return (num_clocks >= 2*REF_WINDOW) ? 0 : -2;
+}
+
+static s32 ClockStreamGenerate(void)
+{
+  double t = 0.0;
+  u32 seed = 1;
+  u32 i;
+
+  clock_time = (u32 *)malloc(SYNTH_CLOCKS * sizeof(u32));
+  for(i=0; i<SYNTH_CLOCKS; ++i) {
+    double bpm = SYNTH_BPM_START + (SYNTH_BPM_END - SYNTH_BPM_START) * i / SYNTH_CLOCKS;
+    t += 60E6 / (bpm * 24);
+
+    seed = seed * 1103515245 + 12345;
+    s32 jitter = (s32)((seed >> 16) % (2*SYNTH_JITTER_US+1)) - SYNTH_JITTER_US;
+    u32 timestamp = (u32)(1000000 + t + jitter);
+    clock_time[i] = timestamp - (timestamp % SYNTH_GRANULARITY);
+  }
+  num_clocks = SYNTH_CLOCKS;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the reference clock interval at the given clock
+/////////////////////////////////////////////////////////////////////////////
+static double RefPeriodGet(u32 clock)
+{
+  u32 first = (clock >= REF_WINDOW) ? (clock - REF_WINDOW) : 0;
+  u32 last = (clock + REF_WINDOW < num_clocks) ? (clock + REF_WINDOW) : (num_clocks - 1);
+  return (double)(clock_time[last] - clock_time[first]) / (last - first);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Polls the BPM generator like the sequencer task
+/////////////////////////////////////////////////////////////////////////////
+static void PollTicks(double now)
+{
+  u32 bpm_tick;
+  u16 song_pos;
+
+  SEQ_BPM_ChkReqStop();
+  SEQ_BPM_ChkReqCont();
+  SEQ_BPM_ChkReqSongPos(&song_pos);
+  SEQ_BPM_ChkReqStart();
+
+  while( SEQ_BPM_ChkReqClk(&bpm_tick) ) {
+    if( num_ticks < num_clocks*(PPQN/24) )
+      tick_time[num_ticks++] = now;
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Replays the clock stream, and prints the results
+/////////////////////////////////////////////////////////////////////////////
+static void Replay(const char *name, u8 use_timestamps, float bandwidth)
+{
+  u32 clock;
+  double timer_time;
+
+  SEQ_BPM_Init(0);
+  SEQ_BPM_PPQN_Set(PPQN);
+  SEQ_BPM_ModeSet(SEQ_BPM_MODE_Slave);
+  SEQ_BPM_DLL_BandwidthSet(bandwidth);
+
+  num_ticks = 0;
+  timer_time = clock_time[0] - 1000;
+
+  SEQ_BPM_NotifyMIDIRx(0xfa); // MIDI Start
+  PollTicks(timer_time);
+
+  for(clock=0; clock<num_clocks; ++clock) {
+    // timer interrupts until the clock arrives
+    while( timer_time + TIMER_PERIOD_US <= clock_time[clock] ) {
+      timer_time += TIMER_PERIOD_US;
+      timer_irq_handler();
+      PollTicks(timer_time);
+    }
+
+    if( use_timestamps )
+      SEQ_BPM_NotifyMIDIRxTimestamp(0xf8, clock_time[clock]);
+    else
+      SEQ_BPM_NotifyMIDIRx(0xf8);
+    PollTicks(clock_time[clock]);
+
+    if( clock == num_clocks/2 ) {
+      seq_bpm_dll_state_t dll;
+      SEQ_BPM_DLL_StateGet(&dll);
+      if( use_timestamps )
+	printf("  DLL at clock %u: %s, %.3f BPM (reference %.3f), phase error %d uS, jitter %u uS\n",
+	       clock, dll.locked ? "locked" : "unlocked", dll.bpm,
+	       60E6 / (24 * RefPeriodGet(clock)), dll.phase_error_us, dll.jitter_us);
+    }
+  }
+
+  // compare the tick intervals with the reference tempo
+  // the first and the last beat are skipped
+  double sum_sqr = 0.0;
+  double max_error = 0.0;
+  u32 num_measured = 0;
+  u32 num_bursts = 0;
+  u32 tick;
+  for(tick=REF_WINDOW*(PPQN/24); tick<num_ticks && tick/(PPQN/24)+REF_WINDOW<num_clocks; ++tick) {
+    double ref_interval = RefPeriodGet(tick/(PPQN/24)) / (PPQN/24);
+    double interval = tick_time[tick] - tick_time[tick-1];
+    double error = fabs(interval - ref_interval);
+
+    sum_sqr += error*error;
+    if( error > max_error )
+      max_error = error;
+    if( interval < 0.25*ref_interval )
+      ++num_bursts;
+    ++num_measured;
+  }
+
+  printf("%-8s %u ticks: interval error rms %6.1f uS, max %6.1f uS, %u bursts\n",
+	 name, num_ticks, num_measured ? sqrt(sum_sqr / num_measured) : 0.0, max_error, num_bursts);
+
+  if( use_timestamps ) {
+    seq_bpm_jitter_t jitter;
+    seq_bpm_dll_state_t dll;
+    SEQ_BPM_JitterGet(&jitter);
+    SEQ_BPM_DLL_StateGet(&dll);
+    printf("  incoming clock: %u intervals, average %u uS, max deviation %u uS\n",
+	   jitter.clocks, jitter.period_us, jitter.max_us);
+    printf("  DLL at end: %.3f BPM (reference %.3f), jitter %u uS, %u relocks\n",
+	   dll.bpm, 60E6 / (24 * RefPeriodGet(num_clocks-1)), dll.jitter_us, dll.relocks);
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  float bandwidth = SEQ_BPM_DLL_DEFAULT_BANDWIDTH;
+  char *filename = NULL;
+  int i;
+
+  for(i=1; i<argc; ++i) {
+    if( strcmp(argv[i], "-b") == 0 && (i+1) < argc ) {
+      bandwidth = atof(argv[++i]);
+    } else if( argv[i][0] != '-' && filename == NULL ) {
+      filename = argv[i];
+    } else {
+      printf("Usage: %s [-b <dll bandwidth>] [<clock file>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if( filename ) {
+    if( ClockStreamRead(filename) < 0 ) {
+      printf("ERROR: can't read at least %d clocks from %s\n", 2*REF_WINDOW, filename);
+      return 1;
+    }
+    printf("Clock stream: %s, %u clocks\n", filename, num_clocks);
+  } else {
+    ClockStreamGenerate();
+    printf("Clock stream: synthetic, %u clocks, %.0f..%.0f BPM, +/- %d uS jitter, %d uS granularity\n",
+	   num_clocks, SYNTH_BPM_START, SYNTH_BPM_END, SYNTH_JITTER_US, SYNTH_GRANULARITY);
+  }
+  printf("DLL bandwidth: %.4f\n", bandwidth);
+
+  tick_time = (double *)malloc(num_clocks * (PPQN/24) * sizeof(double));
+
+  Replay("counter", 0, bandwidth);
+  Replay("dll", 1, bandwidth);
+
+  free(tick_time);
+  free(clock_time);
+
+  return 0;
+}
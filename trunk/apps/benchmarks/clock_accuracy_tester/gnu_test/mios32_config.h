@@ -0,0 +1,10 @@
+// $Id$
+/*
+ * Local MIOS32 configuration file for the host build
+ *
+ */
+
+#ifndef _MIOS32_CONFIG_H
+#define _MIOS32_CONFIG_H
+
+#endif /* _MIOS32_CONFIG_H */
@@ -67,6 +67,7 @@ void APP_Init(void)
   MIOS32_MIDI_SendDebugMessage("====================\n");
   MIOS32_MIDI_SendDebugMessage("\n");
   MIOS32_MIDI_SendDebugMessage("Settings:\n");
+  MIOS32_MIDI_SendDebugMessage("#define SEQ_MIDI_OUT_SCHEDULER %d\n", SEQ_MIDI_OUT_SCHEDULER);
   MIOS32_MIDI_SendDebugMessage("#define SEQ_MIDI_OUT_MALLOC_METHOD %d\n", SEQ_MIDI_OUT_MALLOC_METHOD);
   MIOS32_MIDI_SendDebugMessage("#define SEQ_MIDI_OUT_MAX_EVENTS %d\n", SEQ_MIDI_OUT_MAX_EVENTS);
   MIOS32_MIDI_SendDebugMessage("\n");
@@ -159,6 +160,9 @@ void APP_MIDI_NotifyPackage(mios32_midi_port_t port, mios32_midi_package_t midi_
     else
       MIOS32_MIDI_SendDebugMessage("Time: %5d.%d mS\n", benchmark_cycles/10, benchmark_cycles%10);
 
+    MIOS32_MIDI_SendDebugMessage("Inserts: %u, worst case insert latency: %u cycles\n",
+				 benchmark_inserts, benchmark_insert_time_max);
+
     // print status screen
     print_msg = PRINT_MSG_STATUS;
   }
@@ -25,6 +25,35 @@
 #include "benchmark.h"
 #include "mid_file.h"
 
+#if defined(MIOS32_FAMILY_EMULATION)
+#include <time.h>
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+// timer which measures the insert latency
+#if defined(MIOS32_FAMILY_EMULATION)
+  // host build: nanoseconds
+# define BENCHMARK_TIMER_INIT()
+# define BENCHMARK_TIMER_GET() BENCHMARK_HostTimerGet()
+#else
+  // Cortex-M3: DWT cycle counter
+# define BENCHMARK_TIMER_INIT() { *(volatile u32 *)0xe000edfc |= (1 << 24); *(volatile u32 *)0xe0001000 |= (1 << 0); }
+# define BENCHMARK_TIMER_GET() (*(volatile u32 *)0xe0001004)
+#endif
+
+// dense pattern: number of tracks, steps are played each 96 ticks (16th notes @384 ppqn)
+#define BENCHMARK_DENSE_TRACKS       16
+#define BENCHMARK_DENSE_STEP_TICKS   96
+#define BENCHMARK_DENSE_ECHO_REPEATS  4
+#define BENCHMARK_DENSE_SUSTAINED_TRACKS 8
+
+// set this to 0 to schedule the echo repeats with separate SEQ_MIDI_OUT_Send() calls
+#define BENCHMARK_DENSE_BATCH_SEND 1
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
@@ -32,6 +61,35 @@
 
 static s32 BENCHMARK_PlayEvent(u8 track, mios32_midi_package_t midi_package, u32 tick);
 static s32 BENCHMARK_PlayMeta(u8 track, u8 meta, u32 len, u8 *buffer, u32 tick);
+static s32 BENCHMARK_Send(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len);
+static s32 BENCHMARK_SendBatch(seq_midi_out_event_t *events, u32 num_events);
+static s32 BENCHMARK_ReSchedule(u8 tag, u32 timestamp);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global variables
+/////////////////////////////////////////////////////////////////////////////
+
+u32 benchmark_inserts;
+u32 benchmark_insert_time_max;
+unsigned long long benchmark_insert_time_total;
+
+u32 benchmark_reschedules;
+u32 benchmark_reschedule_visited_total;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local functions
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(MIOS32_FAMILY_EMULATION)
+static u32 BENCHMARK_HostTimerGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u32)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -52,6 +110,9 @@ s32 BENCHMARK_Init(u32 mode)
   MID_PARSER_InstallFileCallbacks(&MID_FILE_read, &MID_FILE_eof, &MID_FILE_seek);
   MID_PARSER_InstallEventCallbacks(&BENCHMARK_PlayEvent, &BENCHMARK_PlayMeta);
 
+  // timer for insert latency measurements
+  BENCHMARK_TIMER_INIT();
+
   return 0; // no error
 }
 
@@ -84,6 +145,16 @@ s32 BENCHMARK_Reset(void)
   seq_midi_out_max_allocated = 0;
   seq_midi_out_dropouts = 0;
 
+  // clear insert statistics
+  benchmark_inserts = 0;
+  benchmark_insert_time_max = 0;
+  benchmark_insert_time_total = 0;
+
+  // clear re-schedule statistics
+  benchmark_reschedules = 0;
+  benchmark_reschedule_visited_total = 0;
+  seq_midi_out_reschedule_visited_max = 0;
+
   return 0; // no error
 }
 
@@ -127,6 +198,152 @@ s32 BENCHMARK_Start(void)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// this function performs a benchmark with a dense 16 track pattern
+// each track plays a CC and a note with 4 echo repeats per step, and
+// the MIDI clock is scheduled as well. Off events are scheduled far in the
+// future, so that the queue is much deeper than during MIDI file playback.
+// The first 8 tracks additionally play a sustained note, which is released
+// with SEQ_MIDI_OUT_ReSchedule() on the next step.
+// BENCHMARK_Reset() should be called before.
+/////////////////////////////////////////////////////////////////////////////
+s32 BENCHMARK_StartDense(u32 num_ticks)
+{
+  u32 bpm_tick;
+  u32 random = 0x12345678;
+
+  for(bpm_tick=0; bpm_tick<num_ticks || seq_midi_out_allocated; ++bpm_tick) {
+    // forward to BPM handler
+    SEQ_BPM_TickSet(bpm_tick);
+
+    if( bpm_tick < num_ticks ) {
+      // MIDI clock at 24 ppqn
+      if( (bpm_tick % 16) == 0 ) {
+	mios32_midi_package_t clk;
+	clk.ALL = 0;
+	clk.type = 0x5; // single byte system message
+	clk.evnt0 = 0xf8;
+	BENCHMARK_Send(0xff, clk, SEQ_MIDI_OUT_ClkEvent, bpm_tick, 0);
+      }
+
+      // schedule the steps of all tracks
+      if( (bpm_tick % BENCHMARK_DENSE_STEP_TICKS) == 0 ) {
+	u8 track;
+	for(track=0; track<BENCHMARK_DENSE_TRACKS; ++track) {
+	  // simple LCG, humanizes the timestamps and gatelengths
+	  random = random * 1664525 + 1013904223;
+	  u32 delay = (random >> 8) % 24;
+	  u32 gatelength = 24 + ((random >> 16) % (4*BENCHMARK_DENSE_STEP_TICKS));
+
+	  mios32_midi_package_t p;
+	  p.ALL = 0;
+	  p.type = CC;
+	  p.event = CC;
+	  p.chn = track;
+	  p.cc_number = 1;
+	  p.value = random & 0x7f;
+	  BENCHMARK_Send(0xff, p, SEQ_MIDI_OUT_CCEvent, bpm_tick + delay, 0);
+
+	  seq_midi_out_event_t echo_events[BENCHMARK_DENSE_ECHO_REPEATS+1];
+	  u8 repeat;
+	  for(repeat=0; repeat<=BENCHMARK_DENSE_ECHO_REPEATS; ++repeat) {
+	    p.type = NoteOn;
+	    p.event = NoteOn;
+	    p.note = 36 + ((random >> 24) % 48) + repeat;
+	    p.velocity = 100 - 16*repeat;
+	    p.cable = track;
+#if BENCHMARK_DENSE_BATCH_SEND
+	    seq_midi_out_event_t *e = &echo_events[repeat];
+	    e->port = 0xff;
+	    e->package = p;
+	    e->event_type = SEQ_MIDI_OUT_OnOffEvent;
+	    e->timestamp = bpm_tick + delay + repeat*BENCHMARK_DENSE_STEP_TICKS/2;
+	    e->len = gatelength;
+#else
+	    BENCHMARK_Send(0xff, p, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + delay + repeat*BENCHMARK_DENSE_STEP_TICKS/2, gatelength);
+#endif
+	  }
+#if BENCHMARK_DENSE_BATCH_SEND
+	  BENCHMARK_SendBatch(echo_events, BENCHMARK_DENSE_ECHO_REPEATS+1);
+#endif
+
+	  if( track < BENCHMARK_DENSE_SUSTAINED_TRACKS ) {
+	    // release the previous sustained note, and hold the new one until the next step
+	    BENCHMARK_ReSchedule(track, bpm_tick + delay);
+
+	    p.note = 24 + track;
+	    p.velocity = 100;
+	    BENCHMARK_Send(0xff, p, SEQ_MIDI_OUT_OnEvent, bpm_tick + delay, 0);
+	    p.velocity = 0;
+	    BENCHMARK_Send(0xff, p, SEQ_MIDI_OUT_OffEvent, 0xffffffff, 0);
+	  }
+	}
+      }
+    } else if( bpm_tick == num_ticks ) {
+      // release all sustained notes
+      u8 track;
+      for(track=0; track<BENCHMARK_DENSE_SUSTAINED_TRACKS; ++track)
+	BENCHMARK_ReSchedule(track, bpm_tick);
+    }
+
+    // send timestamped MIDI events immediately
+    SEQ_MIDI_OUT_Handler();
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// schedules an event and measures the insert latency
+/////////////////////////////////////////////////////////////////////////////
+static s32 BENCHMARK_Send(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len)
+{
+  u32 t0 = BENCHMARK_TIMER_GET();
+  s32 status = SEQ_MIDI_OUT_Send(port, midi_package, event_type, timestamp, len);
+  u32 delay = BENCHMARK_TIMER_GET() - t0;
+
+  ++benchmark_inserts;
+  benchmark_insert_time_total += delay;
+  if( delay > benchmark_insert_time_max )
+    benchmark_insert_time_max = delay;
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// schedules multiple events and measures the insert latency per event
+/////////////////////////////////////////////////////////////////////////////
+static s32 BENCHMARK_SendBatch(seq_midi_out_event_t *events, u32 num_events)
+{
+  u32 t0 = BENCHMARK_TIMER_GET();
+  s32 status = SEQ_MIDI_OUT_SendBatch(events, num_events);
+  u32 delay = (BENCHMARK_TIMER_GET() - t0) / num_events;
+
+  benchmark_inserts += num_events;
+  benchmark_insert_time_total += delay * num_events;
+  if( delay > benchmark_insert_time_max )
+    benchmark_insert_time_max = delay;
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// re-schedules the Off events of a tag and counts the visited items
+/////////////////////////////////////////////////////////////////////////////
+static s32 BENCHMARK_ReSchedule(u8 tag, u32 timestamp)
+{
+  s32 status = SEQ_MIDI_OUT_ReSchedule(tag, SEQ_MIDI_OUT_OffEvent, timestamp);
+
+  ++benchmark_reschedules;
+  benchmark_reschedule_visited_total += seq_midi_out_reschedule_visited;
+
+  return status;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // called when a MIDI event should be played at a given tick
 /////////////////////////////////////////////////////////////////////////////
@@ -138,7 +355,7 @@ static s32 BENCHMARK_PlayEvent(u8 track, mios32_midi_package_t midi_package, u32
 
   // output events to a dummy port (so that the interface doesn't falsify the benchmark results)
 #if 1
-  SEQ_MIDI_OUT_Send(0xff, midi_package, event_type, tick, 0);
+  BENCHMARK_Send(0xff, midi_package, event_type, tick, 0);
 #else
   SEQ_MIDI_OUT_Send(USB0, midi_package, event_type, tick, 0);
 #endif
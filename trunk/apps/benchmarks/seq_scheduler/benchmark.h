@@ -32,11 +32,21 @@ extern s32 BENCHMARK_Init(u32 mode);
 
 extern s32 BENCHMARK_Reset(void);
 extern s32 BENCHMARK_Start(void);
+extern s32 BENCHMARK_StartDense(u32 num_ticks);
 
 
 /////////////////////////////////////////////////////////////////////////////
 // Export global variables
 /////////////////////////////////////////////////////////////////////////////
 
+// insert statistics (host build: nS, Cortex-M3: CPU cycles)
+extern u32 benchmark_inserts;
+extern u32 benchmark_insert_time_max;
+extern unsigned long long benchmark_insert_time_total;
+
+// re-schedule statistics
+extern u32 benchmark_reschedules;
+extern u32 benchmark_reschedule_visited_total;
+
 
 #endif /* _BENCHMARK_H */
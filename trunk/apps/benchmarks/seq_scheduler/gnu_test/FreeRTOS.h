@@ -0,0 +1,15 @@
+// $Id$
+/*
+ * FreeRTOS stub for the host build
+ *
+ */
+
+#ifndef _FREERTOS_H
+#define _FREERTOS_H
+
+#include <stdlib.h>
+
+#define pvPortMalloc(size) malloc(size)
+#define vPortFree(ptr)     free(ptr)
+
+#endif /* _FREERTOS_H */
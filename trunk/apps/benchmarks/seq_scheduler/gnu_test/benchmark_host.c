@@ -0,0 +1,152 @@
+// $Id$
+/*
+ * Host build of the MIDI Out Scheduler benchmark
+ * Emulates the BPM generator and MIDI output, and prints the results
+ * of the MIDI file playback and the dense pattern benchmark
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+#include <seq_midi_out.h>
+
+#include <stdarg.h>
+#include <time.h>
+
+#include "benchmark.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define MIDI_FILE_LOOPS   100
+#define DENSE_TICKS       (384*4*64) // 64 bars @384 ppqn
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static u32 bpm_tick;
+static u32 sent_packages;
+static u32 sent_checksum;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated BPM generator (always running, tick under direct control)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_ModeSet(seq_bpm_mode_t mode) { return 0; }
+s32 SEQ_BPM_Start(void) { return 0; }
+s32 SEQ_BPM_IsRunning(void) { return 1; }
+s32 SEQ_BPM_Set(float bpm) { return 0; }
+u32 SEQ_BPM_TickGet(void) { return bpm_tick; }
+s32 SEQ_BPM_TickSet(u32 tick) { bpm_tick = tick; return 0; }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated MIDI output: counts the packages and calculates a checksum
+// over the output order, so that both scheduler methods can be compared
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  ++sent_packages;
+  sent_checksum = (sent_checksum * 31) + (package.ALL & 0xffffffff) + bpm_tick;
+  return 0;
+}
+
+s32 MIOS32_MIDI_SendDebugMessage(char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prints the results of a benchmark run
+/////////////////////////////////////////////////////////////////////////////
+static void print_results(const char *name, double seconds)
+{
+  printf("%s:\n", name);
+  printf("  Time:           %8.2f mS\n", seconds * 1000.0);
+  printf("  Inserts:        %8u (%.0f inserts/sec)\n",
+	 (unsigned)benchmark_inserts,
+	 benchmark_insert_time_total ? (1e9 * benchmark_inserts / benchmark_insert_time_total) : 0.0);
+  printf("  Insert latency: %8.1f nS average, %u nS worst case\n",
+	 benchmark_inserts ? ((double)benchmark_insert_time_total / benchmark_inserts) : 0.0,
+	 (unsigned)benchmark_insert_time_max);
+  if( benchmark_reschedules ) {
+    printf("  Re-schedules:   %8u, visited items: %.1f average, %u max\n",
+	   (unsigned)benchmark_reschedules,
+	   (double)benchmark_reschedule_visited_total / benchmark_reschedules,
+	   (unsigned)seq_midi_out_reschedule_visited_max);
+  }
+  printf("  Max allocated:  %8u, dropouts: %u\n",
+	 (unsigned)seq_midi_out_max_allocated, (unsigned)seq_midi_out_dropouts);
+  printf("  Sent packages:  %8u, checksum: %08x\n",
+	 (unsigned)sent_packages, (unsigned)sent_checksum);
+}
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  int i;
+  double t0;
+
+  printf("SEQ_MIDI_OUT_SCHEDULER %d, SEQ_MIDI_OUT_MAX_EVENTS %d\n",
+	 SEQ_MIDI_OUT_SCHEDULER, SEQ_MIDI_OUT_MAX_EVENTS);
+
+  BENCHMARK_Init(0);
+
+  // MIDI file playback
+  unsigned long long time_total = 0;
+  u32 time_max = 0, inserts = 0;
+  sent_packages = sent_checksum = 0;
+  t0 = now();
+  for(i=0; i<MIDI_FILE_LOOPS; ++i) {
+    BENCHMARK_Reset();
+    BENCHMARK_Start();
+
+    inserts += benchmark_inserts;
+    time_total += benchmark_insert_time_total;
+    if( benchmark_insert_time_max > time_max )
+      time_max = benchmark_insert_time_max;
+  }
+  benchmark_inserts = inserts;
+  benchmark_insert_time_total = time_total;
+  benchmark_insert_time_max = time_max;
+  print_results("MIDI file playback (100 loops)", now() - t0);
+
+  // dense pattern
+  sent_packages = sent_checksum = 0;
+  BENCHMARK_Reset();
+  t0 = now();
+  BENCHMARK_StartDense(DENSE_TICKS);
+  print_results("Dense 16 track pattern with echo", now() - t0);
+
+  return 0;
+}
@@ -0,0 +1,15 @@
+// $Id$
+/*
+ * Local MIOS32 configuration file for the host build
+ *
+ */
+
+#ifndef _MIOS32_CONFIG_H
+#define _MIOS32_CONFIG_H
+
+// same settings like on the core, but with a deeper queue for the dense pattern
+#define SEQ_MIDI_OUT_MALLOC_METHOD 3
+#define SEQ_MIDI_OUT_MAX_EVENTS 1024
+#define SEQ_MIDI_OUT_MALLOC_ANALYSIS 1
+
+#endif /* _MIOS32_CONFIG_H */
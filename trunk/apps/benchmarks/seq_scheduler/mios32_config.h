@@ -15,6 +15,11 @@
 #define MIOS32_LCD_BOOT_MSG_LINE2 "(c) 2009 T.Klose"
 
 
+// scheduler method:
+// 0: sorted linked list
+// 1: binary heap
+#define SEQ_MIDI_OUT_SCHEDULER 0
+
 // memory alloccation method:
 // 0: internal static allocation with one byte for each flag
 // 1: internal static allocation with 8bit flags
@@ -43,6 +43,11 @@ static struct uip_udp_conn *osc_conn[OSC_SERVER_NUM_CONNECTIONS];
 
 static mios32_osc_search_tree_t parse_root[];
 
+#if OSC_SERVER_SCHEDULER_SLOTS
+static mios32_osc_scheduler_slot_t osc_scheduler_slot[OSC_SERVER_SCHEDULER_SLOTS];
+static mios32_osc_scheduler_t osc_scheduler;
+#endif
+
 static u8 *osc_send_packet;
 static u32 osc_send_len;
 
@@ -62,6 +67,12 @@ s32 OSC_SERVER_Init(u32 mode)
   // disable send packet
   osc_send_packet = NULL;
 
+#if OSC_SERVER_SCHEDULER_SLOTS
+  // init bundle scheduler (only once, settings are kept if connections are re-initialized)
+  if( osc_scheduler.slot == NULL )
+    MIOS32_OSC_SchedulerInit(&osc_scheduler, osc_scheduler_slot, OSC_SERVER_SCHEDULER_SLOTS, parse_root, NULL);
+#endif
+
   // remove open connections
   for(con=0; con<OSC_SERVER_NUM_CONNECTIONS; ++con)
     if( osc_conn[con] != NULL )
@@ -185,6 +196,93 @@ u16 OSC_SERVER_LocalPortGet(u8 con)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Bundle Scheduler
+/////////////////////////////////////////////////////////////////////////////
+s32 OSC_SERVER_SchedulerModeSet(mios32_osc_scheduler_mode_t mode)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  return MIOS32_OSC_SchedulerModeSet(&osc_scheduler, mode);
+#else
+  return -1; // scheduler not available
+#endif
+}
+
+mios32_osc_scheduler_mode_t OSC_SERVER_SchedulerModeGet(void)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  return MIOS32_OSC_SchedulerModeGet(&osc_scheduler);
+#else
+  return MIOS32_OSC_SCHEDULER_MODE_OFF;
+#endif
+}
+
+s32 OSC_SERVER_SchedulerLatencySet(u32 latency_ms)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  return MIOS32_OSC_SchedulerLatencySet(&osc_scheduler, latency_ms * 1000);
+#else
+  return -1; // scheduler not available
+#endif
+}
+
+u32 OSC_SERVER_SchedulerLatencyGet(void)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  return MIOS32_OSC_SchedulerLatencyGet(&osc_scheduler) / 1000;
+#else
+  return 0;
+#endif
+}
+
+s32 OSC_SERVER_SchedulerStatsGet(mios32_osc_scheduler_stats_t *stats)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  return MIOS32_OSC_SchedulerStatsGet(&osc_scheduler, stats);
+#else
+  return -1; // scheduler not available
+#endif
+}
+
+s32 OSC_SERVER_SchedulerStatsReset(void)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  return MIOS32_OSC_SchedulerStatsReset(&osc_scheduler);
+#else
+  return -1; // scheduler not available
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the system time in OSC timetag format
+/////////////////////////////////////////////////////////////////////////////
+static mios32_osc_timetag_t OSC_SERVER_TimetagGet(void)
+{
+  mios32_sys_time_t t = MIOS32_SYS_TimeGet();
+  mios32_osc_timetag_t timetag;
+
+  timetag.seconds = t.seconds;
+  timetag.fraction = (u32)(((unsigned long long)t.fraction_ms << 32) / 1000);
+
+  return timetag;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Called by the uIP task each mS to execute scheduled bundles
+/////////////////////////////////////////////////////////////////////////////
+s32 OSC_SERVER_Tick(void)
+{
+#if OSC_SERVER_SCHEDULER_SLOTS
+  if( MIOS32_OSC_SchedulerNumQueued(&osc_scheduler) )
+    return MIOS32_OSC_SchedulerHandler(&osc_scheduler, OSC_SERVER_TimetagGet());
+#endif
+
+  return 0; // no error
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Called by UIP when a new UDP datagram has been received
 // (UIP_UDP_APPCALL has been configured accordingly in uip-conf.h)
@@ -254,7 +352,11 @@ s32 OSC_SERVER_AppCall(void)
       MIOS32_MIDI_SendDebugHexDump((u8 *)uip_appdata, uip_len);
       MUTEX_MIDIOUT_GIVE;
 #endif
+#if OSC_SERVER_SCHEDULER_SLOTS
+      s32 status = MIOS32_OSC_ParsePacketScheduled((u8 *)uip_appdata, uip_len, &osc_scheduler, OSC_SERVER_TimetagGet());
+#else
       s32 status = MIOS32_OSC_ParsePacket((u8 *)uip_appdata, uip_len, parse_root);
+#endif
       if( status < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 2
 	MUTEX_MIDIOUT_TAKE;
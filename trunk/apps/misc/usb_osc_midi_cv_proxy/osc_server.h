@@ -37,6 +37,13 @@
 #define OSC_REMOTE_PORT 10001
 #endif
 
+// number of bundle elements which can be scheduled for later execution
+// 0 disables the scheduler (bundles are executed immediately)
+// can be overruled in mios32_config.h
+#ifndef OSC_SERVER_SCHEDULER_SLOTS
+#define OSC_SERVER_SCHEDULER_SLOTS 32
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -61,7 +68,15 @@ extern u16 OSC_SERVER_RemotePortGet(u8 con);
 extern s32 OSC_SERVER_LocalPortSet(u8 con, u16 port);
 extern u16 OSC_SERVER_LocalPortGet(u8 con);
 
+extern s32 OSC_SERVER_SchedulerModeSet(mios32_osc_scheduler_mode_t mode);
+extern mios32_osc_scheduler_mode_t OSC_SERVER_SchedulerModeGet(void);
+extern s32 OSC_SERVER_SchedulerLatencySet(u32 latency_ms);
+extern u32 OSC_SERVER_SchedulerLatencyGet(void);
+extern s32 OSC_SERVER_SchedulerStatsGet(mios32_osc_scheduler_stats_t *stats);
+extern s32 OSC_SERVER_SchedulerStatsReset(void);
+
 extern s32 OSC_SERVER_AppCall(void);
+extern s32 OSC_SERVER_Tick(void);
 extern s32 OSC_SERVER_SendPacket(u8 con, u8 *packet, u32 len);
 
 
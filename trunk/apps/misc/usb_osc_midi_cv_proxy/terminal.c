@@ -131,6 +131,21 @@ static u32 get_ip(char *word)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// help function which returns the name of an OSC scheduler mode
+/////////////////////////////////////////////////////////////////////////////
+static const char *TERMINAL_OscSchedulerModeStr(mios32_osc_scheduler_mode_t mode)
+{
+  switch( mode ) {
+  case MIOS32_OSC_SCHEDULER_MODE_OFF:      return "off";
+  case MIOS32_OSC_SCHEDULER_MODE_RELATIVE: return "relative";
+  case MIOS32_OSC_SCHEDULER_MODE_ABSOLUTE: return "absolute";
+  }
+
+  return "unknown";
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Parser
 /////////////////////////////////////////////////////////////////////////////
@@ -182,6 +197,8 @@ s32 TERMINAL_ParseLine(char *input, void *_output_function)
       out("  set osc_remote <con> <address>:   changes OSC Remote Address");
       out("  set osc_remote_port <con> <port>: changes OSC Remote Port (1024..65535)");
       out("  set osc_local_port <con> <port>:  changes OSC Local Port (1024..65535)");
+      out("  set osc_scheduler <off|rel|abs>: timetag handling of OSC bundles (relative: remote clock not synced)");
+      out("  set osc_latency <0..1000>:        latency compensation of scheduled OSC bundles in mS");
       out("  set udpmon <0..4>:                enables UDP monitor to check OSC packets (current: %d)\n", UIP_TASK_UDP_MonitorLevelGet());
       out("  set midimon <on|off>:             enables/disables the MIDI monitor");
       out("  set midimon_filter <on|off>:      enables/disables MIDI monitor filters");
@@ -354,6 +371,36 @@ s32 TERMINAL_ParseLine(char *input, void *_output_function)
 	      }
 	    }
 	  }
+	} else if( strcmp(parameter, "osc_scheduler") == 0 ) {
+	  s32 mode = -1;
+	  if( (parameter = strtok_r(NULL, separators, &brkt)) ) {
+	    if( strcmp(parameter, "off") == 0 )
+	      mode = MIOS32_OSC_SCHEDULER_MODE_OFF;
+	    else if( strcmp(parameter, "rel") == 0 || strcmp(parameter, "relative") == 0 )
+	      mode = MIOS32_OSC_SCHEDULER_MODE_RELATIVE;
+	    else if( strcmp(parameter, "abs") == 0 || strcmp(parameter, "absolute") == 0 )
+	      mode = MIOS32_OSC_SCHEDULER_MODE_ABSOLUTE;
+	  }
+
+	  if( mode < 0 ) {
+	    out("Expecting 'off', 'rel' or 'abs'!");
+	  } else if( OSC_SERVER_SchedulerModeSet(mode) < 0 ) {
+	    out("ERROR: OSC scheduler not available!");
+	  } else {
+	    out("OSC scheduler mode: %s", TERMINAL_OscSchedulerModeStr(OSC_SERVER_SchedulerModeGet()));
+	  }
+	} else if( strcmp(parameter, "osc_latency") == 0 ) {
+	  s32 value = -1;
+	  if( (parameter = strtok_r(NULL, separators, &brkt)) )
+	    value = get_dec(parameter);
+
+	  if( value < 0 || value > 1000 ) {
+	    out("Expecting latency in range 0..1000 mS");
+	  } else if( OSC_SERVER_SchedulerLatencySet(value) < 0 ) {
+	    out("ERROR: OSC scheduler not available!");
+	  } else {
+	    out("OSC scheduler latency: %d mS", OSC_SERVER_SchedulerLatencyGet());
+	  }
 	} else if( strcmp(parameter, "udpmon") == 0 ) {
 	  char *arg;
 	  if( (arg = strtok_r(NULL, separators, &brkt)) ) {
@@ -464,6 +511,16 @@ static s32 TERMINAL_PrintSystem(void *_output_function)
     out("OSC%d Local port: %d", con+1, OSC_SERVER_LocalPortGet(con));
   }
 
+  mios32_osc_scheduler_stats_t stats;
+  if( OSC_SERVER_SchedulerStatsGet(&stats) < 0 ) {
+    out("OSC Scheduler: not available");
+  } else {
+    out("OSC Scheduler: %s, latency %d mS",
+	TERMINAL_OscSchedulerModeStr(OSC_SERVER_SchedulerModeGet()), OSC_SERVER_SchedulerLatencyGet());
+    out("OSC Scheduler: %u queued, %u immediate, %u late (max %u uS), %u overflows, max dispatch delay %u uS",
+	stats.queued, stats.immediate, stats.late, stats.max_late_us, stats.overflows, stats.max_dispatch_delay_us);
+  }
+
   out("UDP Monitor: verbose level #%d\n", UIP_TASK_UDP_MonitorLevelGet());
 
   out("MIDI Monitor: %s", MIDIMON_ActiveGet() ? "enabled" : "disabled");
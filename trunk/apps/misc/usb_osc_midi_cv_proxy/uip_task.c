@@ -242,6 +242,9 @@ static void UIP_TASK_Handler(void *pvParameters)
       }
     }
 
+    // dispatch scheduled OSC bundles which are due
+    OSC_SERVER_Tick();
+
     // release exclusive access to UIP functions
     MUTEX_UIP_GIVE;
   }
@@ -71,6 +71,7 @@
 // Local prototypes
 /////////////////////////////////////////////////////////////////////////////
 static s32 NOTIFY_MIDI_Rx(mios32_midi_port_t port, u8 byte);
+static s32 NOTIFY_MIDI_Realtime(mios32_midi_port_t port, u8 midi_byte, u32 timestamp);
 static s32 NOTIFY_MIDI_Tx(mios32_midi_port_t port, mios32_midi_package_t package);
 static s32 NOTIFY_MIDI_TimeOut(mios32_midi_port_t port);
 
@@ -128,6 +129,15 @@ void APP_Init(void)
   MIOS32_MIDI_DirectRxCallback_Init(&NOTIFY_MIDI_Rx);
   MIOS32_MIDI_DirectTxCallback_Init(&NOTIFY_MIDI_Tx);
 
+  // install realtime taps for the ports which can receive the MIDI clock
+  {
+    int i;
+    for(i=0; i<4; ++i) {
+      MIOS32_MIDI_RealtimeTap_Init(USB0 + i, &NOTIFY_MIDI_Realtime);
+      MIOS32_MIDI_RealtimeTap_Init(UART0 + i, &NOTIFY_MIDI_Realtime);
+    }
+  }
+
   // install timeout callback function
   MIOS32_MIDI_TimeOutCallback_Init(&NOTIFY_MIDI_TimeOut);
 }
@@ -547,6 +557,20 @@ static s32 NOTIFY_MIDI_Rx(mios32_midi_port_t port, u8 midi_byte)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Installed via MIOS32_MIDI_RealtimeTap_Init
+// Realtime messages of the tapped ports are timestamped on arrival
+/////////////////////////////////////////////////////////////////////////////
+static s32 NOTIFY_MIDI_Realtime(mios32_midi_port_t port, u8 midi_byte, u32 timestamp)
+{
+  // filter MIDI In port which controls the MIDI clock
+  if( SEQ_MIDI_ROUTER_MIDIClockInGet(port) == 1 )
+    SEQ_BPM_NotifyMIDIRxTimestamp(midi_byte, timestamp);
+
+  return 0; // no error, no filtering
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Installed via MIOS32_MIDI_DirectTxCallback_Init
 /////////////////////////////////////////////////////////////////////////////
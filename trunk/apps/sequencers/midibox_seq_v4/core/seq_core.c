@@ -60,6 +60,10 @@
 // value is visible in INFO->System page (-> press exit button, go to last item)
 #define STOPWATCH_PERFORMANCE_MEASURING 1
 
+// max number of events which can be scheduled with a single SEQ_MIDI_OUT_SendBatch() call
+// (15 echo repeats or 9 roll triggers)
+#define BATCH_SEND_MAX_EVENTS 16
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
@@ -70,6 +74,8 @@ static s32 SEQ_CORE_NextStep(seq_core_trk_t *t, seq_cc_trk_t *tcc, u8 no_progres
 static s32 SEQ_CORE_Transpose(seq_core_trk_t *t, seq_cc_trk_t *tcc, mios32_midi_package_t *p);
 static s32 SEQ_CORE_Limit(seq_core_trk_t *t, seq_cc_trk_t *tcc, seq_layer_evnt_t *e);
 static s32 SEQ_CORE_Echo(seq_core_trk_t *t, seq_cc_trk_t *tcc, mios32_midi_package_t p, u32 bpm_tick, u32 gatelength);
+static s32 SEQ_CORE_BatchSet(u8 ix, mios32_midi_port_t port, mios32_midi_package_t p, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len);
+static s32 SEQ_CORE_BatchSend(u8 num_events);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -109,6 +115,10 @@ seq_core_loop_mode_t seq_core_glb_loop_mode;
 u8 seq_core_glb_loop_offset;
 u8 seq_core_glb_loop_steps;
 
+// if 0, Roll and Echo events are scheduled with separate SEQ_MIDI_OUT_Send() calls
+// (can be switched with the "batch" terminal command to compare the stopwatch result)
+u8 seq_core_batch_send;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
@@ -120,6 +130,9 @@ static u32 bpm_tick_prefetched_ctr;
 static float seq_core_bpm_target;
 static float seq_core_bpm_sweep_inc;
 
+// events of a roll or echo (located here instead of stack to save stack space)
+static seq_midi_out_event_t batch_events[BATCH_SEND_MAX_EVENTS];
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Initialisation
@@ -138,6 +151,7 @@ s32 SEQ_CORE_Init(u32 mode)
   seq_core_global_scale_root_selection = 0; // from keyboard
   seq_core_keyb_scale_root = 0; // taken if enabled in OPT menu
   seq_core_din_sync_pulse_ctr = 0; // used to generate a 1 mS pulse
+  seq_core_batch_send = 1;
 
   seq_core_metronome_port = DEFAULT;
   seq_core_metronome_chn = 10;
@@ -337,6 +351,9 @@ s32 SEQ_CORE_Handler(void)
 	  SEQ_STATISTICS_StopwatchReset();
 #endif
 
+	  // take over prefetched patterns of the new song step at the step boundary
+	  SEQ_PATTERN_SwapHandler(bpm_tick);
+
 	  // generate MIDI events
 	  SEQ_CORE_Tick(bpm_tick, -1, 0);
 	  SEQ_MIDPLY_Tick(bpm_tick);
@@ -1018,7 +1035,8 @@ s32 SEQ_CORE_Tick(u32 bpm_tick, s8 export_track, u8 mute_nonloopback_tracks)
       	      
 		      int i;
 		      for(i=triggers-1; i>=0; --i)
-			SEQ_MIDI_OUT_Send(tcc->midi_port, *p, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + t->bpm_tick_delay + i*gatelength, half_gatelength);
+			SEQ_CORE_BatchSet(i, tcc->midi_port, *p, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + t->bpm_tick_delay + i*gatelength, half_gatelength);
+		      SEQ_CORE_BatchSend(triggers);
 		    } else {
 		      // force gatelength depending on number of triggers
 		      if( triggers < 6 ) {
@@ -1043,20 +1061,21 @@ s32 SEQ_CORE_Tick(u32 bpm_tick, s8 export_track, u8 mute_nonloopback_tracks)
 		      if( roll_mode & 0x40 ) { // upwards
 			int i;
 			for(i=triggers-1; i>=0; --i) {
-			  SEQ_MIDI_OUT_Send(tcc->midi_port, p_multi, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + t->bpm_tick_delay + i*gatelength, half_gatelength);
+			  SEQ_CORE_BatchSet(i, tcc->midi_port, p_multi, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + t->bpm_tick_delay + i*gatelength, half_gatelength);
 			  u16 velocity = roll_attenuation * p_multi.velocity;
 			  p_multi.velocity = velocity >> 8;
 			}
 		      } else { // downwards
 			int i;
 			for(i=0; i<triggers; ++i) {
-			  SEQ_MIDI_OUT_Send(tcc->midi_port, p_multi, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + t->bpm_tick_delay + i*gatelength, half_gatelength);
+			  SEQ_CORE_BatchSet(i, tcc->midi_port, p_multi, SEQ_MIDI_OUT_OnOffEvent, bpm_tick + t->bpm_tick_delay + i*gatelength, half_gatelength);
 			  if( roll_mode ) {
 			    u16 velocity = roll_attenuation * p_multi.velocity;
 			    p_multi.velocity = velocity >> 8;
 			  }
 			}
 		      }
+		      SEQ_CORE_BatchSend(triggers);
 		    }
 		  } else {
 		    if( !gatelength )
@@ -1631,13 +1650,56 @@ static s32 SEQ_CORE_Echo(seq_core_trk_t *t, seq_cc_trk_t *tcc, mios32_midi_packa
       SEQ_SCALE_Note(&p, scale, root);
     }
 
-    SEQ_MIDI_OUT_Send(tcc->midi_port, p, event_type, bpm_tick + echo_offset, gatelength);
+    SEQ_CORE_BatchSet(i, tcc->midi_port, p, event_type, bpm_tick + echo_offset, gatelength);
   }
 
+  // the echo offset is increasing, therefore all repeats are merged into the queue with a single pass
+  SEQ_CORE_BatchSend(tcc->echo_repeats);
+
   return 0; // no error
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Stores an event at the given position of the batch, which will be
+// scheduled with SEQ_CORE_BatchSend()
+// Events should be sorted by timestamp for best performance
+// (if seq_core_batch_send is 0, the event is scheduled immediately)
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_CORE_BatchSet(u8 ix, mios32_midi_port_t port, mios32_midi_package_t p, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len)
+{
+  if( !seq_core_batch_send )
+    return SEQ_MIDI_OUT_Send(port, p, event_type, timestamp, len);
+
+  if( ix >= BATCH_SEND_MAX_EVENTS )
+    return -1; // invalid index
+
+  seq_midi_out_event_t *e = &batch_events[ix];
+  e->port = port;
+  e->package = p;
+  e->event_type = event_type;
+  e->timestamp = timestamp;
+  e->len = len;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Schedules the events which have been stored with SEQ_CORE_BatchSet()
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_CORE_BatchSend(u8 num_events)
+{
+  if( !seq_core_batch_send )
+    return 0; // no error (events already sent)
+
+  if( num_events > BATCH_SEND_MAX_EVENTS )
+    num_events = BATCH_SEND_MAX_EVENTS;
+
+  return SEQ_MIDI_OUT_SendBatch(batch_events, num_events);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Manually triggers a step of all selected tracks
 /////////////////////////////////////////////////////////////////////////////
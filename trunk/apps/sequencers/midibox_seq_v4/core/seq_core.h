@@ -226,6 +226,8 @@ extern seq_core_options_t seq_core_options;
 extern u8 seq_core_steps_per_measure;
 extern u8 seq_core_steps_per_pattern;
 
+extern u8 seq_core_batch_send;
+
 extern u16 seq_core_trk_muted;
 extern seq_core_slaveclk_mute_t seq_core_slaveclk_mute;
 
@@ -14,6 +14,14 @@
  * so that no directory access is required to find the first sector of the
  * file (again).
  *
+ * Read accesses are served from a small LRU cache which holds lines of
+ * SEQ_FILE_CACHE_LINE_SECTORS consecutive sectors. Each line is loaded with
+ * a single multi sector read, on sequential reads the next line is loaded in
+ * advance. Seeks only change the read position, sectors are read on demand.
+ * Write accesses are collected in a buffer and transfered in sector aligned
+ * blocks. The buffer is flushed by SEQ_FILE_WriteSeek(), SEQ_FILE_WriteClose()
+ * and by SEQ_FILE_CheckSDCard() (idle flush if a file is kept open).
+ *
  * NOTE: before accessing the SD Card, the upper level function should
  * synchronize with the SD Card semaphore!
  *   MUTEX_SDCARD_TAKE; // to take the semaphore
@@ -53,6 +61,7 @@
 #include "seq_file_gc.h"
 #include "seq_file_t.h"
 #include "seq_file_bm.h"
+#include "seq_file_ses.h"
 #include "seq_file_hw.h"
 
 #include "seq_mixer.h"
@@ -95,6 +104,11 @@ u8 seq_file_backup_percentage;
 /////////////////////////////////////////////////////////////////////////////
 
 static s32 SEQ_FILE_MountFS(void);
+static u32 SEQ_FILE_ReadPos(void);
+#if SEQ_FILE_USE_CACHE
+static s32 SEQ_FILE_CacheRead(u8 *buffer, u32 len);
+#endif
+static s32 SEQ_FILE_WriteDirect(u8 *buffer, u32 len);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -125,6 +139,37 @@ static u32 volume_free_bytes;
 #define TMP_BUFFER_SIZE _MAX_SS
 static u8 tmp_buffer[TMP_BUFFER_SIZE];
 
+// read cache
+#define CACHE_LINE_SIZE (SEQ_FILE_CACHE_LINE_SECTORS*SECTOR_SIZE)
+
+typedef struct {
+  u32 org_clust; // start cluster of the file, 0 if line is invalid
+  u32 line;      // line number in file
+  u32 len;       // number of valid bytes (less at the end of file)
+  u32 stamp;     // last access, the least recently used line will be replaced
+} seq_file_cache_line_t;
+
+#if SEQ_FILE_USE_CACHE
+static seq_file_cache_line_t cache_line[SEQ_FILE_CACHE_LINES];
+static u8 cache_data[SEQ_FILE_CACHE_LINES][CACHE_LINE_SIZE];
+static u32 cache_stamp;
+static u32 cache_last_clust; // last loaded line, used to detect sequential reads
+static u32 cache_last_line;
+#endif
+static u8 cache_enabled;
+
+// read position in the current file
+static u32 seq_file_read_pos;
+
+// write buffer
+#if SEQ_FILE_USE_CACHE
+static u8 write_buffer[SEQ_FILE_WRITE_BUFFER_SIZE];
+static u32 write_buffer_limit;
+#endif
+static u32 write_buffer_len;
+
+static seq_file_cache_stats_t cache_stats;
+
 static u8 status_msg_ctr;
 
 
@@ -139,6 +184,11 @@ s32 SEQ_FILE_Init(u32 mode)
   seq_file_read_is_open = 0;
   seq_file_write_is_open = 0;
   sdcard_available = 0;
+
+  cache_enabled = SEQ_FILE_USE_CACHE;
+  write_buffer_len = 0;
+  SEQ_FILE_CacheInvalidate();
+  SEQ_FILE_CacheStatsReset();
   volume_available = 0;
   volume_free_bytes = 0;
 
@@ -161,6 +211,7 @@ s32 SEQ_FILE_Init(u32 mode)
   SEQ_FILE_C_Init(0); // config file access
   SEQ_FILE_G_Init(0); // groove file access
   SEQ_FILE_B_Init(0); // pattern file access
+  SEQ_FILE_SES_Init(0); // session container access
   SEQ_FILE_M_Init(0); // mixer file access
   SEQ_FILE_S_Init(0); // song file access
   SEQ_FILE_T_Init(0); // track preset file access
@@ -232,6 +283,10 @@ s32 SEQ_FILE_CheckSDCard(void)
     return 2; // SD card has been disconnected
   }
 
+  // idle: transfer pending data of a file which is still open for writing
+  if( seq_file_write_is_open && write_buffer_len )
+    SEQ_FILE_WriteFlush();
+
   if( status_msg_ctr ) {
     if( !--status_msg_ctr )
       return 3;
@@ -253,6 +308,10 @@ static s32 SEQ_FILE_MountFS(void)
   seq_file_read_is_open = 0;
   seq_file_write_is_open = 0;
 
+  // cached data belongs to the previous volume
+  write_buffer_len = 0;
+  SEQ_FILE_CacheInvalidate();
+
   if( (res=f_mount(0, &fs)) != FR_OK ) {
     DEBUG_MSG("[SEQ_FILE] Failed to mount SD Card - error status: %d\n", res);
     return -1; // error
@@ -360,7 +419,14 @@ s32 SEQ_FILE_LoadAllFiles(u8 including_hw)
     SEQ_FILE_GC_Load();
   }
 
+  // staged patterns of the previous session are invalid
+  SEQ_PATTERN_PrefetchCancel();
+
   status |= SEQ_FILE_B_LoadAllBanks(seq_file_session_name);
+
+  // ignore status if session container doesn't exist - patterns will be read from bank files
+  SEQ_FILE_SES_Load(seq_file_session_name);
+
   status |= SEQ_FILE_M_LoadAllBanks(seq_file_session_name);
   status |= SEQ_FILE_S_LoadAllBanks(seq_file_session_name);
   status |= SEQ_FILE_G_Load(seq_file_session_name);
@@ -393,6 +459,8 @@ s32 SEQ_FILE_UnloadAllFiles(void)
 {
   s32 status = 0;
   status |= SEQ_FILE_B_UnloadAllBanks();
+  status |= SEQ_FILE_SES_Unload();
+  SEQ_PATTERN_PrefetchCancel();
   status |= SEQ_FILE_M_UnloadAllBanks();
   status |= SEQ_FILE_S_UnloadAllBanks();
   status |= SEQ_FILE_G_Unload();
@@ -401,6 +469,7 @@ s32 SEQ_FILE_UnloadAllFiles(void)
   status |= SEQ_FILE_BM_Unload(0);
   status |= SEQ_FILE_BM_Unload(1);
   status |= SEQ_FILE_HW_Unload();
+  SEQ_FILE_CacheInvalidate();
   return status;
 }
 
@@ -517,6 +586,7 @@ s32 SEQ_FILE_ReadOpen(seq_file_t* file, char *filepath)
   file->dsect = seq_file_read.dsect;
   file->dir_sect = seq_file_read.dir_sect;
   file->dir_ptr = seq_file_read.dir_ptr;
+  file->pos = seq_file_read_pos = 0;
 
   // file is opened
   seq_file_read_is_open = 1;
@@ -555,8 +625,20 @@ s32 SEQ_FILE_ReadReOpen(seq_file_t* file)
   seq_file_read.dir_sect = file->dir_sect;
   seq_file_read.dir_ptr = file->dir_ptr;
 
-  // ensure that the right sector is in cache again
-  disk_read(seq_file_read.fs->drive, seq_file_read.buf, seq_file_read.dsect, 1);
+  if( cache_enabled ) {
+    // the sector buffer of FatFs could contain data of another file
+    // since cache lines are read from sector boundaries, it's sufficient
+    // to invalidate it - no sector has to be read here
+    seq_file_read.dsect = 0;
+    seq_file_read_pos = file->pos;
+  } else if( file->dsect && file->pos == file->fptr ) {
+    // ensure that the right sector is in cache again
+    disk_read(seq_file_read.fs->drive, seq_file_read.buf, seq_file_read.dsect, 1);
+  } else {
+    // file has been read via cache before: continue at the read position
+    seq_file_read.dsect = 0;
+    f_lseek(&seq_file_read, file->pos);
+  }
 
   // file is opened (again)
   seq_file_read_is_open = 1;
@@ -582,6 +664,7 @@ s32 SEQ_FILE_ReadClose(seq_file_t *file)
   file->dsect = seq_file_read.dsect;
   file->dir_sect = seq_file_read.dir_sect;
   file->dir_ptr = seq_file_read.dir_ptr;
+  file->pos = SEQ_FILE_ReadPos();
 
   // file has been closed
   seq_file_read_is_open = 0;
@@ -598,6 +681,12 @@ s32 SEQ_FILE_ReadClose(seq_file_t *file)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_FILE_ReadSeek(u32 offset)
 {
+  if( cache_enabled ) {
+    // the FatFs file pointer will be changed on the next cache miss
+    seq_file_read_pos = (offset > seq_file_read.fsize) ? seq_file_read.fsize : offset;
+    return 0; // no error
+  }
+
   if( (seq_file_dfs_errno=f_lseek(&seq_file_read, offset)) != FR_OK ) {
 #if DEBUG_VERBOSE_LEVEL >= 2
     DEBUG_MSG("[SEQ_FILE_ReadSeek] ERROR: seek to offset %u failed (FatFs status: %d)\n", offset, seq_file_dfs_errno);
@@ -620,6 +709,11 @@ s32 SEQ_FILE_ReadBuffer(u8 *buffer, u32 len)
   if( !volume_available )
     return SEQ_FILE_ERR_NO_VOLUME;
 
+#if SEQ_FILE_USE_CACHE
+  if( cache_enabled )
+    return SEQ_FILE_CacheRead(buffer, len);
+#endif
+
   if( (seq_file_dfs_errno=f_read(&seq_file_read, buffer, len, &successcount)) != FR_OK ) {
 #if DEBUG_VERBOSE_LEVEL >= 3
     DEBUG_MSG("[SEQ_FILE] Failed to read sector at position 0x%08x, status: %u\n", seq_file_read.fptr, seq_file_dfs_errno);
@@ -641,7 +735,7 @@ s32 SEQ_FILE_ReadLine(u8 *buffer, u32 max_len)
   s32 status;
   u32 num_read = 0;
 
-  while( seq_file_read.fptr < seq_file_read.fsize ) {
+  while( SEQ_FILE_ReadPos() < seq_file_read.fsize ) {
     status = SEQ_FILE_ReadBuffer(buffer, 1);
 
     if( status < 0 )
@@ -708,6 +802,10 @@ s32 SEQ_FILE_WriteOpen(char *filepath, u8 create)
 
   // remember state
   seq_file_write_is_open = 1;
+  write_buffer_len = 0;
+
+  // cached sectors could be changed
+  SEQ_FILE_CacheInvalidate();
 
   return 0; // no error
 }
@@ -719,7 +817,8 @@ s32 SEQ_FILE_WriteOpen(char *filepath, u8 create)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_FILE_WriteClose(void)
 {
-  s32 status = 0;
+  // transfer pending data
+  s32 status = SEQ_FILE_WriteFlush();
 
   // close file
   if( (seq_file_dfs_errno=f_close(&seq_file_write)) != FR_OK )
@@ -727,6 +826,9 @@ s32 SEQ_FILE_WriteClose(void)
 
   seq_file_write_is_open = 0;
 
+  // cached sectors could have been changed
+  SEQ_FILE_CacheInvalidate();
+
   return status;
 }
 
@@ -738,6 +840,12 @@ s32 SEQ_FILE_WriteClose(void)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_FILE_WriteSeek(u32 offset)
 {
+  s32 status;
+
+  // transfer pending data
+  if( (status=SEQ_FILE_WriteFlush()) < 0 )
+    return status;
+
   if( (seq_file_dfs_errno=f_lseek(&seq_file_write, offset)) != FR_OK ) {
 #if DEBUG_VERBOSE_LEVEL >= 2
     DEBUG_MSG("[SEQ_FILE_ReadSeek] ERROR: seek to offset %u failed (FatFs status: %d)\n", offset, seq_file_dfs_errno);
@@ -755,7 +863,10 @@ u32 SEQ_FILE_WriteGetCurrentSize(void)
 {
   if( !seq_file_write_is_open )
     return 0;
-  return seq_file_write.fsize;
+
+  // consider pending data of the write buffer
+  u32 end = seq_file_write.fptr + write_buffer_len;
+  return (end > seq_file_write.fsize) ? end : seq_file_write.fsize;
 }
 
 
@@ -766,6 +877,58 @@ u32 SEQ_FILE_WriteGetCurrentSize(void)
 // returns < 0 on errors (error codes are documented in seq_file.h)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_FILE_WriteBuffer(u8 *buffer, u32 len)
+{
+  // exit if volume not available
+  if( !volume_available )
+    return SEQ_FILE_ERR_NO_VOLUME;
+
+#if !SEQ_FILE_USE_CACHE
+  return SEQ_FILE_WriteDirect(buffer, len);
+#else
+  if( !cache_enabled )
+    return SEQ_FILE_WriteDirect(buffer, len);
+
+  ++cache_stats.writes;
+
+  while( len ) {
+    if( !write_buffer_len ) {
+      // large blocks at a sector boundary are transfered directly
+      if( len >= SEQ_FILE_WRITE_BUFFER_SIZE && (seq_file_write.fptr % SECTOR_SIZE) == 0 ) {
+	++cache_stats.write_flushes;
+	return SEQ_FILE_WriteDirect(buffer, len);
+      }
+
+      // the buffer should end at a sector boundary, so that complete
+      // sectors can be written by FatFs
+      write_buffer_limit = SEQ_FILE_WRITE_BUFFER_SIZE - (seq_file_write.fptr % SECTOR_SIZE);
+    }
+
+    u32 num_bytes = write_buffer_limit - write_buffer_len;
+    if( num_bytes > len )
+      num_bytes = len;
+    memcpy(&write_buffer[write_buffer_len], buffer, num_bytes);
+    write_buffer_len += num_bytes;
+    buffer += num_bytes;
+    len -= num_bytes;
+
+    if( write_buffer_len >= write_buffer_limit ) {
+      s32 status;
+      if( (status=SEQ_FILE_WriteFlush()) < 0 )
+	return status;
+    }
+  }
+
+  return 0; // no error
+#endif
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes into a file w/o write buffer
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_WriteDirect(u8 *buffer, u32 len)
 {
   // exit if volume not available
   if( !volume_available )
@@ -814,6 +977,295 @@ s32 SEQ_FILE_WriteWord(u32 word)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Transfers the pending data of the write buffer
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_WriteFlush(void)
+{
+#if !SEQ_FILE_USE_CACHE
+  return 0; // no write buffer
+#else
+  if( !write_buffer_len )
+    return 0; // nothing to do
+
+  u32 len = write_buffer_len;
+  write_buffer_len = 0;
+  ++cache_stats.write_flushes;
+
+  return SEQ_FILE_WriteDirect(write_buffer, len);
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Enables/disables the read cache and the write buffer
+// (it's enabled by default, can be disabled for debugging purposes)
+// returns -1 if the cache isn't available (SEQ_FILE_USE_CACHE == 0)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_CacheEnable(u8 enable)
+{
+#if !SEQ_FILE_USE_CACHE
+  if( enable )
+    return -1; // not available
+#endif
+
+  SEQ_FILE_WriteFlush();
+
+  // take over the read position of an opened file
+  if( seq_file_read_is_open ) {
+    if( cache_enabled && !enable ) {
+      seq_file_read.dsect = 0;
+      f_lseek(&seq_file_read, seq_file_read_pos);
+    } else if( !cache_enabled && enable ) {
+      seq_file_read_pos = seq_file_read.fptr;
+    }
+  }
+
+  cache_enabled = enable;
+  SEQ_FILE_CacheInvalidate();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns 1 if the read cache and the write buffer are enabled
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_CacheEnabled(void)
+{
+  return cache_enabled;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Invalidates all cache lines
+// has to be called whenever files are changed w/o SEQ_FILE_Write* functions
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_CacheInvalidate(void)
+{
+#if SEQ_FILE_USE_CACHE
+  int i;
+
+  for(i=0; i<SEQ_FILE_CACHE_LINES; ++i)
+    cache_line[i].org_clust = 0;
+  cache_last_clust = 0;
+#endif
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Cache statistics (for SEQ_TERMINAL)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_CacheStatsGet(seq_file_cache_stats_t *stats)
+{
+  *stats = cache_stats;
+  return 0; // no error
+}
+
+s32 SEQ_FILE_CacheStatsReset(void)
+{
+  memset(&cache_stats, 0, sizeof(seq_file_cache_stats_t));
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns the read position of the current file
+/////////////////////////////////////////////////////////////////////////////
+static u32 SEQ_FILE_ReadPos(void)
+{
+  return cache_enabled ? seq_file_read_pos : seq_file_read.fptr;
+}
+
+
+#if SEQ_FILE_USE_CACHE
+/////////////////////////////////////////////////////////////////////////////
+// Changes the FatFs file pointer to a sector aligned offset
+// (no sector is read, since the FatFs sector buffer isn't used)
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_CacheSeek(u32 offset)
+{
+  if( seq_file_read.fptr != offset &&
+      (seq_file_dfs_errno=f_lseek(&seq_file_read, offset)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SEQ_FILE_CacheSeek] ERROR: seek to offset %u failed (FatFs status: %d)\n", offset, seq_file_dfs_errno);
+#endif
+    return SEQ_FILE_ERR_SEEK;
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads a line of the current file into the least recently used cache line
+// returns the cache line index, < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_CacheLoad(u32 line)
+{
+  int i;
+  int ix = 0;
+
+  for(i=0; i<SEQ_FILE_CACHE_LINES; ++i) {
+    if( !cache_line[i].org_clust ) {
+      ix = i;
+      break;
+    }
+    if( cache_line[i].stamp < cache_line[ix].stamp )
+      ix = i;
+  }
+
+  seq_file_cache_line_t *l = &cache_line[ix];
+  l->org_clust = 0; // invalid until sectors have been read
+
+  s32 status;
+  if( (status=SEQ_FILE_CacheSeek(line * CACHE_LINE_SIZE)) < 0 )
+    return status;
+
+  // sectors are transfered directly into the cache line with a single (multi sector) read
+  UINT successcount;
+  if( (seq_file_dfs_errno=f_read(&seq_file_read, cache_data[ix], CACHE_LINE_SIZE, &successcount)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+    DEBUG_MSG("[SEQ_FILE] Failed to read sector at position 0x%08x, status: %u\n", seq_file_read.fptr, seq_file_dfs_errno);
+#endif
+    return SEQ_FILE_ERR_READ;
+  }
+
+  l->org_clust = seq_file_read.org_clust;
+  l->line = line;
+  l->len = successcount;
+  l->stamp = ++cache_stamp;
+
+  cache_last_clust = l->org_clust;
+  cache_last_line = line;
+
+  return ix;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Searches for a line of the current file in the cache
+// returns the cache line index, -1 if not found
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_CacheFind(u32 line)
+{
+  int i;
+
+  for(i=0; i<SEQ_FILE_CACHE_LINES; ++i) {
+    if( cache_line[i].org_clust == seq_file_read.org_clust && cache_line[i].line == line )
+      return i;
+  }
+
+  return -1; // not found
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the cache line which contains the given line of the current file
+// loads it on a cache miss
+// returns the cache line index, < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_CacheGet(u32 line)
+{
+  s32 ix;
+
+  if( (ix=SEQ_FILE_CacheFind(line)) >= 0 ) {
+    ++cache_stats.hits;
+    cache_line[ix].stamp = ++cache_stamp;
+    return ix;
+  }
+
+  ++cache_stats.misses;
+  u8 sequential = cache_last_clust == seq_file_read.org_clust && (cache_last_line + 1) == line;
+
+  if( (ix=SEQ_FILE_CacheLoad(line)) < 0 )
+    return ix;
+
+#if SEQ_FILE_CACHE_LINES >= 2
+  // sequential read: load the next line as well
+  // (the LRU line will be replaced, which is never the line that has just been loaded)
+  if( sequential &&
+      (line + 1) * CACHE_LINE_SIZE < seq_file_read.fsize &&
+      SEQ_FILE_CacheFind(line + 1) < 0 &&
+      SEQ_FILE_CacheLoad(line + 1) >= 0 ) {
+    ++cache_stats.prefetches;
+  }
+#endif
+
+  return ix;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reads from the current file via cache
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_CacheRead(u8 *buffer, u32 len)
+{
+  // like f_read: read until end of file
+  u32 remaining = seq_file_read.fsize - seq_file_read_pos;
+  u32 num_bytes = (len > remaining) ? remaining : len;
+
+  while( num_bytes ) {
+    u32 line = seq_file_read_pos / CACHE_LINE_SIZE;
+    u32 line_offset = seq_file_read_pos % CACHE_LINE_SIZE;
+    u32 chunk;
+
+    if( !line_offset && num_bytes >= CACHE_LINE_SIZE && SEQ_FILE_CacheFind(line) < 0 ) {
+      // large blocks are transfered directly into the buffer
+      // (unless the first line has already been prefetched)
+      chunk = num_bytes - (num_bytes % CACHE_LINE_SIZE);
+
+      s32 status;
+      if( (status=SEQ_FILE_CacheSeek(seq_file_read_pos)) < 0 )
+	return status;
+
+      UINT successcount;
+      if( (seq_file_dfs_errno=f_read(&seq_file_read, buffer, chunk, &successcount)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+	DEBUG_MSG("[SEQ_FILE] Failed to read sector at position 0x%08x, status: %u\n", seq_file_read.fptr, seq_file_dfs_errno);
+#endif
+	return SEQ_FILE_ERR_READ;
+      }
+      if( successcount != chunk )
+	return SEQ_FILE_ERR_READCOUNT;
+
+      ++cache_stats.direct_reads;
+    } else {
+      s32 ix;
+      if( (ix=SEQ_FILE_CacheGet(line)) < 0 )
+	return ix;
+
+      if( cache_line[ix].len <= line_offset )
+	return SEQ_FILE_ERR_READCOUNT; // file has been changed?
+
+      chunk = cache_line[ix].len - line_offset;
+      if( chunk > num_bytes )
+	chunk = num_bytes;
+      memcpy(buffer, &cache_data[ix][line_offset], chunk);
+    }
+
+    buffer += chunk;
+    seq_file_read_pos += chunk;
+    num_bytes -= chunk;
+    len -= chunk;
+  }
+
+  if( len ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+    DEBUG_MSG("[SEQ_FILE] Wrong successcount while reading from position 0x%08x\n", seq_file_read_pos);
+#endif
+    return SEQ_FILE_ERR_READCOUNT;
+  }
+
+  return 0; // no error
+}
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Creates a directory
 /////////////////////////////////////////////////////////////////////////////
@@ -1128,6 +1580,9 @@ s32 SEQ_FILE_Copy(char *src_file, char *dst_file, u8 *tmp_buffer)
     return SEQ_FILE_ERR_NO_VOLUME;
   }
 
+  // destination file will be overwritten
+  SEQ_FILE_CacheInvalidate();
+
 #if DEBUG_VERBOSE_LEVEL >= 2
   DEBUG_MSG("[SEQ_FILE_Copy] copy %s to %s\n", src_file, dst_file);
 #endif
@@ -26,6 +26,37 @@
 #define SEQ_FILE_SESSION_PATH "/SESSIONS"
 
 
+// read cache and write buffer (see below) are only available if this switch is 1
+// By default they are disabled on the STM32F103, since they allocate 4k of
+// static RAM with the default settings, which isn't available there
+#ifndef SEQ_FILE_USE_CACHE
+#if defined(MIOS32_FAMILY_STM32F10x)
+#define SEQ_FILE_USE_CACHE 0
+#else
+#define SEQ_FILE_USE_CACHE 1
+#endif
+#endif
+
+// read cache: number of cache lines, and number of consecutive sectors per line
+// A line is loaded with a single (multi sector) read access. If a file is
+// read sequentially, the next line will be loaded in advance as well.
+// Memory consumption: SEQ_FILE_CACHE_LINES * SEQ_FILE_CACHE_LINE_SECTORS * 512 bytes
+#ifndef SEQ_FILE_CACHE_LINES
+#define SEQ_FILE_CACHE_LINES 3
+#endif
+
+#ifndef SEQ_FILE_CACHE_LINE_SECTORS
+#define SEQ_FILE_CACHE_LINE_SECTORS 2
+#endif
+
+// write buffer: SEQ_FILE_WriteBuffer() calls are collected, and transfered
+// in sector aligned blocks (allows multi sector writes)
+// has to be a multiple of 512
+#ifndef SEQ_FILE_WRITE_BUFFER_SIZE
+#define SEQ_FILE_WRITE_BUFFER_SIZE (2*512)
+#endif
+
+
 // error codes
 // NOTE: SEQ_FILE_SendErrorMessage() should be extended whenever new codes have been added!
 
@@ -64,6 +95,7 @@
 #define SEQ_FILE_B_ERR_WRITE           -133 // error while writing file (exact error status cannot be determined anymore)
 #define SEQ_FILE_B_ERR_NO_FILE         -134 // no or invalid bank file
 #define SEQ_FILE_B_ERR_P_TOO_LARGE     -135 // during pattern write: pattern too large for slot in bank
+#define SEQ_FILE_B_ERR_PREFETCH_SIZE   -136 // during pattern prefetch: pattern too large for prefetch buffer
 
 // used by seq_file_m.c
 #define SEQ_FILE_M_ERR_INVALID_BANK    -144 // invalid bank number
@@ -120,6 +152,18 @@
 #define SEQ_FILE_BM_ERR_WRITE          -158 // error while writing file (exact error status cannot be determined anymore)
 #define SEQ_FILE_BM_ERR_NO_FILE        -159 // no or invalid config file
 
+// used by seq_file_ses.c
+#define SEQ_FILE_SES_ERR_FORMAT        -240 // invalid session container format
+#define SEQ_FILE_SES_ERR_READ          -241 // error while reading file (exact error status cannot be determined anymore)
+#define SEQ_FILE_SES_ERR_WRITE         -242 // error while writing file (exact error status cannot be determined anymore)
+#define SEQ_FILE_SES_ERR_NO_FILE       -243 // no or invalid session container
+#define SEQ_FILE_SES_ERR_LAYOUT        -244 // container has been created for a different layer memory layout
+#define SEQ_FILE_SES_ERR_INVALID_BANK  -245 // bank not available in container
+#define SEQ_FILE_SES_ERR_INVALID_PATTERN -246 // invalid pattern number
+#define SEQ_FILE_SES_ERR_EMPTY_SLOT    -247 // pattern slot hasn't been written yet
+#define SEQ_FILE_SES_ERR_PREFETCH_SIZE -248 // during pattern prefetch: pattern record too large for prefetch buffer
+#define SEQ_FILE_SES_ERR_P_TOO_LARGE   -249 // during import: pattern too large for slot in bank
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -136,8 +180,19 @@ typedef struct {
   u32 dsect; // current data sector;
   u32 dir_sect; // sector containing the directory entry
   u8 *dir_ptr; // pointer to the directory entry in the window
+  u32 pos;   // read position (fptr is only updated on cache misses)
 } seq_file_t;
 
+// read cache and write buffer statistics
+typedef struct {
+  u32 hits;          // cache line accesses which didn't require a sector read
+  u32 misses;        // cache lines which have been loaded on demand
+  u32 prefetches;    // cache lines which have been loaded in advance
+  u32 direct_reads;  // large read accesses which bypassed the cache
+  u32 writes;        // number of SEQ_FILE_WriteBuffer() calls
+  u32 write_flushes; // number of block transfers of the write buffer
+} seq_file_cache_stats_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -178,6 +233,13 @@ extern s32 SEQ_FILE_WriteBuffer(u8 *buffer, u32 len);
 extern s32 SEQ_FILE_WriteByte(u8 byte);
 extern s32 SEQ_FILE_WriteHWord(u16 hword);
 extern s32 SEQ_FILE_WriteWord(u32 word);
+extern s32 SEQ_FILE_WriteFlush(void);
+
+extern s32 SEQ_FILE_CacheEnable(u8 enable);
+extern s32 SEQ_FILE_CacheEnabled(void);
+extern s32 SEQ_FILE_CacheInvalidate(void);
+extern s32 SEQ_FILE_CacheStatsGet(seq_file_cache_stats_t *stats);
+extern s32 SEQ_FILE_CacheStatsReset(void);
 
 extern s32 SEQ_FILE_MakeDir(char *path);
 
@@ -26,6 +26,7 @@
 
 #include "seq_file.h"
 #include "seq_file_b.h"
+#include "seq_file_ses.h"
 
 #include "seq_cc.h"
 #include "seq_par.h"
@@ -109,6 +110,12 @@ typedef struct {
   seq_file_t file;      // file informations
 } seq_file_b_info_t;
 
+// source of pattern data
+typedef struct {
+  u8 *ptr;  // NULL: read from file
+  u32 len;  // remaining bytes in buffer
+} seq_file_b_src_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
@@ -358,55 +365,61 @@ s32 SEQ_FILE_B_Open(char *session, u8 bank)
 
 
 /////////////////////////////////////////////////////////////////////////////
-// reads a pattern from bank into given group
-// returns < 0 on errors (error codes are documented in seq_file.h)
+// Pattern data is either read from the opened bank file (ptr == NULL),
+// or from a buffer which has been filled by SEQ_FILE_B_PatternPrefetch()
 /////////////////////////////////////////////////////////////////////////////
-s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
+static s32 SEQ_FILE_B_SrcRead(seq_file_b_src_t *src, u8 *buffer, u32 len)
 {
-  if( bank >= SEQ_FILE_B_NUM_BANKS )
-    return SEQ_FILE_B_ERR_INVALID_BANK;
+  if( src->ptr == NULL )
+    return SEQ_FILE_ReadBuffer(buffer, len);
 
-  if( target_group >= SEQ_CORE_NUM_GROUPS )
-    return SEQ_FILE_B_ERR_INVALID_GROUP;
+  if( len > src->len )
+    return SEQ_FILE_ERR_READCOUNT;
 
-  seq_file_b_info_t *info = &seq_file_b_info[bank];
+  memcpy(buffer, src->ptr, len);
+  src->ptr += len;
+  src->len -= len;
 
-  if( !info->valid )
-    return SEQ_FILE_B_ERR_NO_FILE;
+  return 0; // no error
+}
 
-  if( pattern >= info->header.num_patterns )
-    return SEQ_FILE_B_ERR_INVALID_PATTERN;
+static s32 SEQ_FILE_B_SrcByte(seq_file_b_src_t *src, u8 *byte)
+{
+  return SEQ_FILE_B_SrcRead(src, byte, 1);
+}
 
-  // re-open file
-  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
-    return -1; // file cannot be re-opened
+static s32 SEQ_FILE_B_SrcHWord(seq_file_b_src_t *src, u16 *hword)
+{
+  // ensure little endian coding
+  u8 tmp[2];
+  s32 status = SEQ_FILE_B_SrcRead(src, tmp, 2);
+  *hword = ((u16)tmp[0] << 0) | ((u16)tmp[1] << 8);
+  return status;
+}
 
-  // change to file position
-  s32 status;
-  u32 offset = 10 + sizeof(seq_file_b_header_t) + pattern * info->header.pattern_size;
-  if( (status=SEQ_FILE_ReadSeek(offset)) < 0 ) {
-#if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[SEQ_FILE_B] failed to change pattern offset in file, status: %d\n", status);
-#endif
-    // close file (so that it can be re-opened)
-    SEQ_FILE_ReadClose((seq_file_t*)&info->file);
-    return SEQ_FILE_B_ERR_READ;
-  }
 
-  status |= SEQ_FILE_ReadBuffer((u8 *)seq_pattern_name[target_group], 20);
+/////////////////////////////////////////////////////////////////////////////
+// parses a pattern record into given group
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_B_PatternParse(seq_file_b_src_t *src, u8 bank, u8 pattern, u8 target_group)
+{
+  s32 status = 0;
+
+  status |= SEQ_FILE_B_SrcRead(src, (u8 *)seq_pattern_name[target_group], 20);
   seq_pattern_name[target_group][20] = 0;
 
   u8 num_tracks;
-  status |= SEQ_FILE_ReadByte(&num_tracks);
+  status |= SEQ_FILE_B_SrcByte(src, &num_tracks);
 
   u8 mixer_map;
-  status |= SEQ_FILE_ReadByte(&mixer_map);
+  status |= SEQ_FILE_B_SrcByte(src, &mixer_map);
 
   u8 sysex_setup;
-  status |= SEQ_FILE_ReadByte(&sysex_setup);
+  status |= SEQ_FILE_B_SrcByte(src, &sysex_setup);
 
   u8 reserved;
-  status |= SEQ_FILE_ReadByte(&reserved);
+  status |= SEQ_FILE_B_SrcByte(src, &reserved);
 
 #if DEBUG_VERBOSE_LEVEL >= 1
   DEBUG_MSG("[SEQ_FILE_B] read pattern B%d:P%d '%s', %d tracks\n", bank+1, pattern, seq_pattern_name[target_group], num_tracks);
@@ -419,29 +432,29 @@ s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
   u8 track_i;
   u8 track = target_group * SEQ_CORE_NUM_TRACKS_PER_GROUP;
   for(track_i=0; track_i<num_tracks; ++track_i, ++track) {
-    status |= SEQ_FILE_ReadBuffer((u8 *)seq_core_trk[track].name, 80);
+    status |= SEQ_FILE_B_SrcRead(src, (u8 *)seq_core_trk[track].name, 80);
     seq_core_trk[track].name[80] = 0;
 
     u8 num_p_instruments;
-    status |= SEQ_FILE_ReadByte(&num_p_instruments);
+    status |= SEQ_FILE_B_SrcByte(src, &num_p_instruments);
 
     u8 num_t_instruments;
-    status |= SEQ_FILE_ReadByte(&num_t_instruments);
+    status |= SEQ_FILE_B_SrcByte(src, &num_t_instruments);
 
     u8 num_p_layers;
-    status |= SEQ_FILE_ReadByte(&num_p_layers);
+    status |= SEQ_FILE_B_SrcByte(src, &num_p_layers);
 
     u8 num_t_layers;
-    status |= SEQ_FILE_ReadByte(&num_t_layers);
+    status |= SEQ_FILE_B_SrcByte(src, &num_t_layers);
 
     u16 p_layer_size;
-    status |= SEQ_FILE_ReadHWord(&p_layer_size);
+    status |= SEQ_FILE_B_SrcHWord(src, &p_layer_size);
 
     u16 t_layer_size;
-    status |= SEQ_FILE_ReadHWord(&t_layer_size);
+    status |= SEQ_FILE_B_SrcHWord(src, &t_layer_size);
 
     u8 cc_buffer[128];
-    status |= SEQ_FILE_ReadBuffer(cc_buffer, 128);
+    status |= SEQ_FILE_B_SrcRead(src, cc_buffer, 128);
     
     // before changing CCs: we should stop here on error if read failed
     if( status < 0 ) {
@@ -471,12 +484,12 @@ s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
     u32 par_size = num_p_instruments * num_p_layers * p_layer_size;
     u32 par_size_taken = (par_size > SEQ_PAR_MAX_BYTES) ? SEQ_PAR_MAX_BYTES : par_size;
     if( par_size_taken )
-      SEQ_FILE_ReadBuffer((u8 *)&seq_par_layer_value[track], par_size_taken);
+      SEQ_FILE_B_SrcRead(src, (u8 *)&seq_par_layer_value[track], par_size_taken);
 
     // read remaining bytes into dummy buffer
     while( par_size > par_size_taken ) {
       u8 dummy;
-      SEQ_FILE_ReadByte(&dummy);
+      SEQ_FILE_B_SrcByte(src, &dummy);
       ++par_size_taken;
     }
 
@@ -487,12 +500,12 @@ s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
     u32 trg_size = num_t_instruments * num_t_layers * t_layer_size;
     u32 trg_size_taken = (trg_size > SEQ_TRG_MAX_BYTES) ? SEQ_TRG_MAX_BYTES : trg_size;
     if( trg_size_taken )
-      SEQ_FILE_ReadBuffer((u8 *)&seq_trg_layer_value[track], trg_size_taken);
+      SEQ_FILE_B_SrcRead(src, (u8 *)&seq_trg_layer_value[track], trg_size_taken);
 
     // read remaining bytes into dummy buffer
     while( trg_size > trg_size_taken ) {
       u8 dummy;
-      SEQ_FILE_ReadByte(&dummy);
+      SEQ_FILE_B_SrcByte(src, &dummy);
       ++trg_size_taken;
     }
 
@@ -501,6 +514,55 @@ s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
 
   }
 
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reads a pattern from bank into given group
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
+{
+  if( bank >= SEQ_FILE_B_NUM_BANKS )
+    return SEQ_FILE_B_ERR_INVALID_BANK;
+
+  if( target_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  // read from session container if available
+  if( SEQ_FILE_SES_BankValid(bank) )
+    return SEQ_FILE_SES_PatternRead(bank, pattern, target_group);
+
+  seq_file_b_info_t *info = &seq_file_b_info[bank];
+
+  if( !info->valid )
+    return SEQ_FILE_B_ERR_NO_FILE;
+
+  if( pattern >= info->header.num_patterns )
+    return SEQ_FILE_B_ERR_INVALID_PATTERN;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
+    return -1; // file cannot be re-opened
+
+  // change to file position
+  s32 status;
+  u32 offset = 10 + sizeof(seq_file_b_header_t) + pattern * info->header.pattern_size;
+  if( (status=SEQ_FILE_ReadSeek(offset)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_B] failed to change pattern offset in file, status: %d\n", status);
+#endif
+    // close file (so that it can be re-opened)
+    SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+    return SEQ_FILE_B_ERR_READ;
+  }
+
+  seq_file_b_src_t src;
+  src.ptr = NULL; // read from file
+  src.len = 0;
+  status = SEQ_FILE_B_PatternParse(&src, bank, pattern, target_group);
+
   // close file (so that it can be re-opened)
   SEQ_FILE_ReadClose((seq_file_t*)&info->file);
 
@@ -515,6 +577,93 @@ s32 SEQ_FILE_B_PatternRead(u8 bank, u8 pattern, u8 target_group)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// reads the raw pattern record from bank into a buffer, so that it can be
+// transfered into a group with SEQ_FILE_B_PatternReadBuffer() later
+// without accessing the SD Card
+// returns < 0 on errors (error codes are documented in seq_file.h)
+// returns number of bytes stored in buffer on success
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_B_PatternPrefetch(u8 bank, u8 pattern, u8 *buffer, u32 max_len)
+{
+  if( bank >= SEQ_FILE_B_NUM_BANKS )
+    return SEQ_FILE_B_ERR_INVALID_BANK;
+
+  // read from session container if available
+  if( SEQ_FILE_SES_BankValid(bank) )
+    return SEQ_FILE_SES_PatternPrefetch(bank, pattern, buffer, max_len);
+
+  seq_file_b_info_t *info = &seq_file_b_info[bank];
+
+  if( !info->valid )
+    return SEQ_FILE_B_ERR_NO_FILE;
+
+  if( pattern >= info->header.num_patterns )
+    return SEQ_FILE_B_ERR_INVALID_PATTERN;
+
+  // the last pattern record of a file could be shorter than the slot
+  u32 offset = 10 + sizeof(seq_file_b_header_t) + pattern * info->header.pattern_size;
+  if( offset >= info->file.fsize )
+    return SEQ_FILE_B_ERR_INVALID_PATTERN; // slot not written yet
+
+  u32 len = info->header.pattern_size;
+  if( len > (info->file.fsize - offset) )
+    len = info->file.fsize - offset;
+
+  if( len > max_len )
+    return SEQ_FILE_B_ERR_PREFETCH_SIZE;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
+    return -1; // file cannot be re-opened
+
+  s32 status;
+  if( (status=SEQ_FILE_ReadSeek(offset)) >= 0 )
+    status = SEQ_FILE_ReadBuffer(buffer, len);
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_B] error while prefetching pattern, status: %d\n", status);
+#endif
+    return SEQ_FILE_B_ERR_READ;
+  }
+
+  return len;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// transfers a pattern record which has been read by SEQ_FILE_B_PatternPrefetch()
+// into given group
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_B_PatternReadBuffer(u8 bank, u8 pattern, u8 target_group, u8 *buffer, u32 len)
+{
+  if( target_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  // buffer has been filled from the session container
+  // (staging area is cleared whenever the container is loaded or unloaded)
+  if( SEQ_FILE_SES_BankValid(bank) )
+    return SEQ_FILE_SES_PatternReadBuffer(bank, pattern, target_group, buffer, len);
+
+  seq_file_b_src_t src;
+  src.ptr = buffer;
+  src.len = len;
+  if( SEQ_FILE_B_PatternParse(&src, bank, pattern, target_group) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_B] prefetched pattern B%d:P%d is incomplete\n", bank+1, pattern);
+#endif
+    return SEQ_FILE_B_ERR_READ;
+  }
+
+  return 0; // no error
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // writes a pattern of a given group into bank
 // returns < 0 on errors (error codes are documented in seq_file.h)
@@ -686,7 +835,15 @@ s32 SEQ_FILE_B_PatternWrite(char *session, u8 bank, u8 pattern, u8 source_group,
   DEBUG_MSG("[SEQ_FILE_B] Pattern written with status %d\n", status);
 #endif
 
-  return (status < 0) ? SEQ_FILE_B_ERR_WRITE : 0;
+  if( status < 0 )
+    return SEQ_FILE_B_ERR_WRITE;
+
+  // keep session container in sync
+  // on errors the container will be unloaded, so that the bank file is used again
+  if( SEQ_FILE_SES_BankValid(bank) )
+    SEQ_FILE_SES_PatternWrite(session, bank, pattern, source_group);
+
+  return 0; // no error
 }
 
 
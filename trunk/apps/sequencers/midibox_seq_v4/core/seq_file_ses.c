@@ -0,0 +1,1340 @@
+// $Id$
+/*
+ * Session container access functions
+ *
+ * The pattern banks of a session are stored in a single file (MBSEQ_SE.V4)
+ * with a section table. The parameter and trigger layers of a pattern are
+ * stored in the same layout like in seq_par_layer_value[] and
+ * seq_trg_layer_value[], so that they can be loaded with a single bulk read
+ * for each layer type.
+ *
+ * The remaining session files (mixer maps, songs, grooves, config and
+ * bookmarks) are embedded unmodified, so that a session can be restored
+ * from the container with SEQ_FILE_SES_Import(). The sequencer still loads
+ * them from the separate files.
+ *
+ * NOTE: before accessing the SD Card, the upper level function should
+ * synchronize with the SD Card semaphore!
+ *   MUTEX_SDCARD_TAKE; // to take the semaphore
+ *   MUTEX_SDCARD_GIVE; // to release the semaphore
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <string.h>
+
+#include "seq_file.h"
+#include "seq_file_b.h"
+#include "seq_file_ses.h"
+
+#include "seq_core.h"
+#include "seq_cc.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_pattern.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
+/////////////////////////////////////////////////////////////////////////////
+#define DEBUG_VERBOSE_LEVEL 0
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+// size of the file header, the section table starts here
+#define HEADER_SIZE 32
+
+// sizes of the records which are taken over from the bank files
+#define PATTERN_HEADER_SIZE 24
+#define TRACK_HEADER_SIZE   216
+
+// flags of a pattern record (stored in the reserved byte of the pattern header)
+#define PATTERN_FLAG_USED   0x01 // slot has been written
+
+// embedded session files
+#define NUM_EMBEDDED_FILES 5
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+// Structure of session container:
+//    file_type[10]
+//    seq_file_ses_header_t
+//    Section table at offset 32: seq_file_ses_section_t * num_sections
+//    Bank Section:  seq_file_ses_bank_t (padded to 1k)
+//                   Pattern 0: Pattern header (24 bytes, same like in bank file)
+//                              Track 0..3 header (216 bytes each, same like in bank file)
+//                              Parameter Layers of Track 0..3 (used bytes only, max. SEQ_PAR_MAX_BYTES each)
+//                              Trigger Layers of Track 0..3 (used bytes only, max. SEQ_TRG_MAX_BYTES each)
+//                              (padded to SEQ_FILE_SES_PATTERN_SIZE)
+//                   Pattern 1: ...
+//    Embedded file: content of MBSEQ_M.V4, MBSEQ_S.V4, ... (padded to 1k)
+//
+// Each section starts at a 1k boundary.
+// The layers are packed like in the bank files, so that loading a pattern doesn't
+// read more sectors than the bank file slot. Each layer type is read with a single
+// access into the layer rows of the group, and moved to the row starts in RAM afterwards.
+//
+// Size for 4 banks with 64 patterns:
+// 1024 + 4 * (1024 + 64 * (1024 + 4*1024 + 4*256))
+// 1024 + 4 * (1024 + 64 * 6144)
+// -> 1577984 bytes + embedded files
+
+// not defined as structure:
+// file_type[10] will contain "MBSEQV4SE" + 0 (zero-terminated string)
+typedef struct {
+  u16  version;          // SEQ_FILE_SES_VERSION
+  u16  num_sections;     // number of entries in section table
+  u16  par_max_bytes;    // SEQ_PAR_MAX_BYTES of the exporting firmware
+  u16  trg_max_bytes;    // SEQ_TRG_MAX_BYTES of the exporting firmware
+  u8   tracks_per_group; // SEQ_CORE_NUM_TRACKS_PER_GROUP of the exporting firmware
+  u16  bank_used[SEQ_FILE_B_NUM_BANKS]; // number of records up to the last written slot of each bank
+} seq_file_ses_header_t; // 17 bytes, padded to 22
+
+// position of seq_file_ses_header_t.bank_used in file, updated on pattern writes
+#define HEADER_BANK_USED_OFFSET 19
+
+typedef struct {
+  char name[20];      // bank name, taken over from bank file
+  u16  num_patterns;  // number of patterns (usually 64)
+  u16  pattern_size;  // size of a pattern slot in the bank file (only used on import)
+} seq_file_ses_bank_t;  // 24 bytes
+
+
+// container informations stored in RAM
+typedef struct {
+  unsigned valid: 1;  // container is accessible
+
+  seq_file_ses_header_t header;
+  seq_file_ses_section_t section[SEQ_FILE_SES_MAX_SECTIONS];
+  s8 bank_section[SEQ_FILE_B_NUM_BANKS]; // section of bank, -1 if not available
+
+  seq_file_t file;      // file informations
+} seq_file_ses_info_t;
+
+// source of pattern data
+typedef struct {
+  u8  *ptr;    // NULL: read from the opened container
+  u32 len;     // size of buffer
+  u32 offset;  // position of the pattern record in file
+} seq_file_ses_src_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static seq_file_ses_info_t seq_file_ses_info;
+
+static const char embedded_file_id[NUM_EMBEDDED_FILES][5] = {
+  "MIXR", "SONG", "GROV", "CONF", "BOOK"
+};
+
+static const char embedded_file_name[NUM_EMBEDDED_FILES][12] = {
+  "MBSEQ_M.V4", "MBSEQ_S.V4", "MBSEQ_G.V4", "MBSEQ_C.V4", "MBSEQ_BM.V4"
+};
+
+static const u8 zero_buffer[64];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Initialisation
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_Init(u32 mode)
+{
+  // invalidate container info
+  SEQ_FILE_SES_Unload();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads the section table of the session container
+// Called from SEQ_FILE_LoadAllFiles()
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_Load(char *session)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+
+  // staged patterns have been read in the previous format
+  SEQ_FILE_SES_Unload();
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/MBSEQ_SE.V4", SEQ_FILE_SESSION_PATH, session);
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] Open session container '%s'\n", filepath);
+#endif
+
+  s32 status;
+  if( (status=SEQ_FILE_ReadOpen((seq_file_t*)&info->file, filepath)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] failed to open file, status: %d\n", status);
+#endif
+    return SEQ_FILE_SES_ERR_NO_FILE;
+  }
+
+  // read and check header
+  // in order to avoid endianess issues, we have to read the sector bytewise!
+  char file_type[10];
+  status |= SEQ_FILE_ReadBuffer((u8 *)file_type, 10);
+  status |= SEQ_FILE_ReadHWord(&info->header.version);
+  status |= SEQ_FILE_ReadHWord(&info->header.num_sections);
+  status |= SEQ_FILE_ReadHWord(&info->header.par_max_bytes);
+  status |= SEQ_FILE_ReadHWord(&info->header.trg_max_bytes);
+  status |= SEQ_FILE_ReadByte(&info->header.tracks_per_group);
+  u8 bank;
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank)
+    status |= SEQ_FILE_ReadHWord(&info->header.bank_used[bank]);
+
+  if( status >= 0 && strncmp(file_type, "MBSEQV4SE", 10) != 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    file_type[9] = 0;
+    DEBUG_MSG("[SEQ_FILE_SES] wrong header type: %s\n", file_type);
+#endif
+    SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+    return SEQ_FILE_SES_ERR_FORMAT;
+  }
+
+  // containers of other versions have a different pattern record layout, they have to be exported again
+  if( status >= 0 && info->header.version != SEQ_FILE_SES_VERSION ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] unsupported version: %d\n", info->header.version);
+#endif
+    SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+    return SEQ_FILE_SES_ERR_FORMAT;
+  }
+
+  // the layer blocks can only be transfered directly if the memory layout matches
+  if( status >= 0 &&
+      (info->header.par_max_bytes != SEQ_PAR_MAX_BYTES ||
+       info->header.trg_max_bytes != SEQ_TRG_MAX_BYTES ||
+       info->header.tracks_per_group != SEQ_CORE_NUM_TRACKS_PER_GROUP) ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] container has been created for a different layer layout (%d/%d/%d)\n",
+	      info->header.par_max_bytes, info->header.trg_max_bytes, info->header.tracks_per_group);
+#endif
+    SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+    return SEQ_FILE_SES_ERR_LAYOUT;
+  }
+
+  // read section table
+  if( info->header.num_sections > SEQ_FILE_SES_MAX_SECTIONS )
+    info->header.num_sections = SEQ_FILE_SES_MAX_SECTIONS;
+
+  status |= SEQ_FILE_ReadSeek(HEADER_SIZE);
+
+  u8 section;
+  for(section=0; section<info->header.num_sections; ++section) {
+    seq_file_ses_section_t *s = &info->section[section];
+    status |= SEQ_FILE_ReadBuffer((u8 *)s->id, 4);
+    status |= SEQ_FILE_ReadWord(&s->offset);
+    status |= SEQ_FILE_ReadWord(&s->size);
+    status |= SEQ_FILE_ReadHWord(&s->num_items);
+    status |= SEQ_FILE_ReadHWord(&s->item_size);
+  }
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] error while reading file, status: %d\n", status);
+#endif
+    return SEQ_FILE_SES_ERR_READ;
+  }
+
+  // assign bank sections
+  for(section=0; section<info->header.num_sections; ++section) {
+    seq_file_ses_section_t *s = &info->section[section];
+
+    if( strncmp(s->id, "BNK", 3) != 0 || s->id[3] < '1' || s->id[3] >= ('1' + SEQ_FILE_B_NUM_BANKS) )
+      continue;
+
+    // check that all pattern records are available
+    u32 end = s->offset + SEQ_FILE_SES_ALIGN + s->num_items * SEQ_FILE_SES_PATTERN_SIZE;
+    if( s->item_size != SEQ_FILE_SES_PATTERN_SIZE || end > info->file.fsize ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+      DEBUG_MSG("[SEQ_FILE_SES] section %c%c%c%c is incomplete - ignored\n", s->id[0], s->id[1], s->id[2], s->id[3]);
+#endif
+      continue;
+    }
+
+    info->bank_section[s->id[3] - '1'] = section;
+  }
+
+  // container valid
+  info->valid = 1;
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] session container with %d sections loaded\n", info->header.num_sections);
+#endif
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Invalidates the container, patterns will be read from bank files again
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_Unload(void)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+
+  if( info->valid ) {
+    // the staging area could contain pattern records of the container
+    SEQ_PATTERN_PrefetchCancel();
+  }
+
+  info->valid = 0;
+  info->header.num_sections = 0;
+
+  u8 bank;
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank)
+    info->bank_section[bank] = -1;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns 1 if the session container has been loaded
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_Valid(void)
+{
+  return seq_file_ses_info.valid;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns 1 if the patterns of the given bank can be read from the container
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_BankValid(u8 bank)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+
+  if( !info->valid || bank >= SEQ_FILE_B_NUM_BANKS )
+    return 0;
+
+  return info->bank_section[bank] >= 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the number of sections, 0 if container not valid
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_NumSections(void)
+{
+  return seq_file_ses_info.valid ? seq_file_ses_info.header.num_sections : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the table entry of a section
+// returns < 0 if section doesn't exist
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_SectionGet(u8 section, seq_file_ses_section_t *s)
+{
+  if( section >= SEQ_FILE_SES_NumSections() )
+    return SEQ_FILE_SES_ERR_NO_FILE;
+
+  *s = seq_file_ses_info.section[section];
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions for export and import
+/////////////////////////////////////////////////////////////////////////////
+
+// writes zeros into the opened write file
+static s32 SEQ_FILE_SES_WriteZeros(u32 len)
+{
+  s32 status = 0;
+
+  while( len && status >= 0 ) {
+    u32 num_bytes = (len > sizeof(zero_buffer)) ? sizeof(zero_buffer) : len;
+    status = SEQ_FILE_WriteBuffer((u8 *)zero_buffer, num_bytes);
+    len -= num_bytes;
+  }
+
+  return status;
+}
+
+// fills the write file with zeros up to the next 1k boundary
+static s32 SEQ_FILE_SES_WriteAlign(void)
+{
+  u32 size = SEQ_FILE_WriteGetCurrentSize();
+  return SEQ_FILE_SES_WriteZeros((SEQ_FILE_SES_ALIGN - (size % SEQ_FILE_SES_ALIGN)) % SEQ_FILE_SES_ALIGN);
+}
+
+// copies copy_len bytes from given position of the opened read file into the
+// write file, and fills the remaining bytes up to total_len with zeros
+// bytes behind the end of the read file (fsize) are replaced by zeros as well
+static s32 SEQ_FILE_SES_CopyBlock(u32 offset, u32 copy_len, u32 total_len, u32 fsize)
+{
+  s32 status = 0;
+  u8 buffer[128];
+
+  if( copy_len > total_len )
+    copy_len = total_len;
+
+  if( offset >= fsize )
+    copy_len = 0;
+  else if( copy_len > (fsize - offset) )
+    copy_len = fsize - offset;
+
+  if( copy_len )
+    status |= SEQ_FILE_ReadSeek(offset);
+
+  u32 pos;
+  for(pos=0; pos<copy_len && status >= 0; pos+=sizeof(buffer)) {
+    u32 num_bytes = ((copy_len - pos) > sizeof(buffer)) ? sizeof(buffer) : (copy_len - pos);
+    status |= SEQ_FILE_ReadBuffer(buffer, num_bytes);
+    status |= SEQ_FILE_WriteBuffer(buffer, num_bytes);
+  }
+
+  if( status >= 0 )
+    status |= SEQ_FILE_SES_WriteZeros(total_len - copy_len);
+
+  return status;
+}
+
+// returns the number of parameter/trigger layer bytes of a track header
+// layer_header points to the layer partitioning (offset 80 of the track header)
+static void SEQ_FILE_SES_TrackLayerBytes(u8 *layer_header, u32 *par_size, u32 *trg_size)
+{
+  u8 num_p_instruments = layer_header[0];
+  u8 num_t_instruments = layer_header[1];
+  u8 num_p_layers = layer_header[2];
+  u8 num_t_layers = layer_header[3];
+  u16 p_layer_size = ((u16)layer_header[4] << 0) | ((u16)layer_header[5] << 8);
+  u16 t_layer_size = ((u16)layer_header[6] << 0) | ((u16)layer_header[7] << 8);
+
+  *par_size = num_p_instruments * num_p_layers * p_layer_size;
+  *trg_size = num_t_instruments * num_t_layers * t_layer_size;
+}
+
+// returns the number of layer bytes which are stored in a pattern record
+// (like SEQ_FILE_B_PatternRead(), layer bytes which don't fit into RAM are skipped)
+static void SEQ_FILE_SES_TrackLayerBytesStored(u8 *layer_header, u32 *par_size, u32 *trg_size)
+{
+  SEQ_FILE_SES_TrackLayerBytes(layer_header, par_size, trg_size);
+
+  if( *par_size > SEQ_PAR_MAX_BYTES )
+    *par_size = SEQ_PAR_MAX_BYTES;
+  if( *trg_size > SEQ_TRG_MAX_BYTES )
+    *trg_size = SEQ_TRG_MAX_BYTES;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// converts a pattern slot of a bank file into a pattern record
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_ExportPattern(seq_file_t *file, u32 offset)
+{
+  s32 status = 0;
+
+  // slot hasn't been written yet
+  if( (offset + PATTERN_HEADER_SIZE) > file->fsize )
+    return SEQ_FILE_SES_WriteZeros(SEQ_FILE_SES_PATTERN_SIZE);
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen(file) < 0 )
+    return SEQ_FILE_SES_ERR_READ;
+
+  u8 pattern_header[PATTERN_HEADER_SIZE];
+  status |= SEQ_FILE_ReadSeek(offset);
+  status |= SEQ_FILE_ReadBuffer(pattern_header, PATTERN_HEADER_SIZE);
+
+  u8 num_tracks = pattern_header[20];
+  if( num_tracks > SEQ_CORE_NUM_TRACKS_PER_GROUP )
+    num_tracks = SEQ_CORE_NUM_TRACKS_PER_GROUP;
+  pattern_header[20] = num_tracks;
+  pattern_header[23] = PATTERN_FLAG_USED;
+  status |= SEQ_FILE_WriteBuffer(pattern_header, PATTERN_HEADER_SIZE);
+
+  // copy track headers, and determine the position of the layers
+  u32 par_offset[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+  u32 par_size[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+  u32 trg_offset[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+  u32 trg_size[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+
+  u32 pos = offset + PATTERN_HEADER_SIZE;
+  u8 track_i;
+  for(track_i=0; track_i<num_tracks && status >= 0; ++track_i) {
+    u8 track_header[TRACK_HEADER_SIZE];
+    status |= SEQ_FILE_ReadSeek(pos);
+    status |= SEQ_FILE_ReadBuffer(track_header, TRACK_HEADER_SIZE);
+    status |= SEQ_FILE_WriteBuffer(track_header, TRACK_HEADER_SIZE);
+
+    u32 par_size_bank, trg_size_bank;
+    SEQ_FILE_SES_TrackLayerBytes(&track_header[80], &par_size_bank, &trg_size_bank);
+    SEQ_FILE_SES_TrackLayerBytesStored(&track_header[80], &par_size[track_i], &trg_size[track_i]);
+    par_offset[track_i] = pos + TRACK_HEADER_SIZE;
+    trg_offset[track_i] = par_offset[track_i] + par_size_bank;
+    pos = trg_offset[track_i] + trg_size_bank;
+  }
+
+  u32 size = PATTERN_HEADER_SIZE + track_i*TRACK_HEADER_SIZE;
+
+  // parameter layers (packed)
+  u8 num_copied = track_i;
+  for(track_i=0; track_i<num_copied && status >= 0; ++track_i) {
+    status |= SEQ_FILE_SES_CopyBlock(par_offset[track_i], par_size[track_i], par_size[track_i], file->fsize);
+    size += par_size[track_i];
+  }
+
+  // trigger layers (packed)
+  for(track_i=0; track_i<num_copied && status >= 0; ++track_i) {
+    status |= SEQ_FILE_SES_CopyBlock(trg_offset[track_i], trg_size[track_i], trg_size[track_i], file->fsize);
+    size += trg_size[track_i];
+  }
+
+  // fill remaining bytes of record with zero
+  if( status >= 0 )
+    status |= SEQ_FILE_SES_WriteZeros(SEQ_FILE_SES_PATTERN_SIZE - size);
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose(file);
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// converts a bank file into a bank section
+// returns SEQ_FILE_SES_ERR_NO_FILE if bank file doesn't exist
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_ExportBank(char *session, u8 bank, seq_file_ses_section_t *s)
+{
+  s32 status = 0;
+  seq_file_t file;
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, session, bank+1);
+
+  // check for existence first: SEQ_FILE_ReadOpen() would re-mount the volume
+  // on a missing file, which invalidates the opened container
+  if( SEQ_FILE_FileExists(filepath) < 1 || SEQ_FILE_ReadOpen(&file, filepath) < 0 )
+    return SEQ_FILE_SES_ERR_NO_FILE;
+
+  char file_type[10];
+  seq_file_ses_bank_t bank_header;
+  status |= SEQ_FILE_ReadBuffer((u8 *)file_type, 10);
+  status |= SEQ_FILE_ReadBuffer((u8 *)bank_header.name, 20);
+  status |= SEQ_FILE_ReadHWord(&bank_header.num_patterns);
+  status |= SEQ_FILE_ReadHWord(&bank_header.pattern_size);
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose(&file);
+
+  if( status < 0 || strncmp(file_type, "MBSEQV4_B", 10) != 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] %s is not a valid bank file - not exported\n", filepath);
+#endif
+    return SEQ_FILE_SES_ERR_NO_FILE;
+  }
+
+  char id[5];
+  sprintf(id, "BNK%d", bank+1);
+  memcpy(s->id, id, 4);
+  s->offset = SEQ_FILE_WriteGetCurrentSize();
+  s->num_items = bank_header.num_patterns;
+  s->item_size = SEQ_FILE_SES_PATTERN_SIZE;
+
+  status |= SEQ_FILE_WriteBuffer((u8 *)bank_header.name, 20);
+  status |= SEQ_FILE_WriteHWord(bank_header.num_patterns);
+  status |= SEQ_FILE_WriteHWord(bank_header.pattern_size);
+  status |= SEQ_FILE_SES_WriteAlign();
+
+  u16 pattern;
+  for(pattern=0; pattern<bank_header.num_patterns && status >= 0; ++pattern) {
+    u32 offset = 10 + sizeof(seq_file_ses_bank_t) + pattern * bank_header.pattern_size;
+    status |= SEQ_FILE_SES_ExportPattern(&file, offset);
+
+    // the bank file ends after the last written slot
+    if( (offset + PATTERN_HEADER_SIZE) <= file.fsize )
+      seq_file_ses_info.header.bank_used[bank] = pattern + 1;
+  }
+
+  s->size = SEQ_FILE_WriteGetCurrentSize() - s->offset;
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] bank #%d exported with status %d\n", bank+1, status);
+#endif
+
+  return (status < 0) ? SEQ_FILE_SES_ERR_WRITE : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// embeds a session file into the container
+// returns SEQ_FILE_SES_ERR_NO_FILE if the file doesn't exist
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_ExportFile(char *session, u8 file_ix, seq_file_ses_section_t *s)
+{
+  s32 status = 0;
+  seq_file_t file;
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/%s", SEQ_FILE_SESSION_PATH, session, embedded_file_name[file_ix]);
+
+  // check for existence first: SEQ_FILE_ReadOpen() would re-mount the volume
+  // on a missing file, which invalidates the opened container
+  if( SEQ_FILE_FileExists(filepath) < 1 || SEQ_FILE_ReadOpen(&file, filepath) < 0 )
+    return SEQ_FILE_SES_ERR_NO_FILE;
+
+  memcpy(s->id, embedded_file_id[file_ix], 4);
+  s->offset = SEQ_FILE_WriteGetCurrentSize();
+  s->size = file.fsize;
+  s->num_items = 0;
+  s->item_size = 0;
+
+  status |= SEQ_FILE_SES_CopyBlock(0, file.fsize, file.fsize, file.fsize);
+  status |= SEQ_FILE_SES_WriteAlign();
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose(&file);
+
+  return (status < 0) ? SEQ_FILE_SES_ERR_WRITE : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates the session container from the bank files and embeds the
+// remaining session files
+// The container will be loaded thereafter
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_Export(char *session)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+
+  // container will be overwritten
+  SEQ_FILE_SES_Unload();
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/MBSEQ_SE.V4", SEQ_FILE_SESSION_PATH, session);
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] Creating session container '%s'\n", filepath);
+#endif
+
+  s32 status = 0;
+  if( (status=SEQ_FILE_WriteOpen(filepath, 1)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] Failed to create file, status: %d\n", status);
+#endif
+    return status;
+  }
+
+  // header and section table are written at the end, so that an incomplete
+  // container will never be loaded
+  status |= SEQ_FILE_SES_WriteZeros(SEQ_FILE_SES_ALIGN);
+
+  u8 num_sections = 0;
+
+  u8 bank;
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank)
+    info->header.bank_used[bank] = 0;
+
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS && status >= 0; ++bank) {
+    s32 error = SEQ_FILE_SES_ExportBank(session, bank, &info->section[num_sections]);
+    if( error >= 0 )
+      ++num_sections;
+    else if( error != SEQ_FILE_SES_ERR_NO_FILE )
+      status |= error;
+  }
+
+  u8 file_ix;
+  for(file_ix=0; file_ix<NUM_EMBEDDED_FILES && status >= 0; ++file_ix) {
+    s32 error = SEQ_FILE_SES_ExportFile(session, file_ix, &info->section[num_sections]);
+    if( error >= 0 )
+      ++num_sections;
+    else if( error != SEQ_FILE_SES_ERR_NO_FILE )
+      status |= error;
+  }
+
+  // write header
+  status |= SEQ_FILE_WriteSeek(0);
+
+  const char file_type[10] = "MBSEQV4SE";
+  status |= SEQ_FILE_WriteBuffer((u8 *)file_type, 10);
+  status |= SEQ_FILE_WriteHWord(SEQ_FILE_SES_VERSION);
+  status |= SEQ_FILE_WriteHWord(num_sections);
+  status |= SEQ_FILE_WriteHWord(SEQ_PAR_MAX_BYTES);
+  status |= SEQ_FILE_WriteHWord(SEQ_TRG_MAX_BYTES);
+  status |= SEQ_FILE_WriteByte(SEQ_CORE_NUM_TRACKS_PER_GROUP);
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank)
+    status |= SEQ_FILE_WriteHWord(info->header.bank_used[bank]);
+  status |= SEQ_FILE_SES_WriteZeros(HEADER_SIZE - HEADER_BANK_USED_OFFSET - 2*SEQ_FILE_B_NUM_BANKS);
+
+  // write section table
+  u8 section;
+  for(section=0; section<num_sections; ++section) {
+    seq_file_ses_section_t *s = &info->section[section];
+    status |= SEQ_FILE_WriteBuffer((u8 *)s->id, 4);
+    status |= SEQ_FILE_WriteWord(s->offset);
+    status |= SEQ_FILE_WriteWord(s->size);
+    status |= SEQ_FILE_WriteHWord(s->num_items);
+    status |= SEQ_FILE_WriteHWord(s->item_size);
+  }
+
+  // close file
+  status |= SEQ_FILE_WriteClose();
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] Session container with %d sections created with status %d\n", num_sections, status);
+#endif
+
+  if( status < 0 )
+    return SEQ_FILE_SES_ERR_WRITE;
+
+  return SEQ_FILE_SES_Load(session);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// converts a pattern record into a pattern slot of a bank file
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_ImportPattern(u32 offset, u16 pattern_size)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  s32 status = 0;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
+    return SEQ_FILE_SES_ERR_READ;
+
+  u8 pattern_header[PATTERN_HEADER_SIZE];
+  status |= SEQ_FILE_ReadSeek(offset);
+  status |= SEQ_FILE_ReadBuffer(pattern_header, PATTERN_HEADER_SIZE);
+
+  u32 size = 0;
+  if( status >= 0 && (pattern_header[23] & PATTERN_FLAG_USED) ) {
+    u8 num_tracks = pattern_header[20];
+    if( num_tracks > SEQ_CORE_NUM_TRACKS_PER_GROUP )
+      num_tracks = SEQ_CORE_NUM_TRACKS_PER_GROUP;
+
+    pattern_header[23] = 0x00; // reserved in bank files
+    status |= SEQ_FILE_WriteBuffer(pattern_header, PATTERN_HEADER_SIZE);
+    size += PATTERN_HEADER_SIZE;
+
+    // the packed trigger layers are located behind the parameter layers of all tracks
+    u32 par_offset = offset + PATTERN_HEADER_SIZE + num_tracks*TRACK_HEADER_SIZE;
+    u32 trg_offset = par_offset;
+
+    u8 track_i;
+    for(track_i=0; track_i<num_tracks && status >= 0; ++track_i) {
+      u8 track_header[TRACK_HEADER_SIZE];
+      status |= SEQ_FILE_ReadSeek(offset + PATTERN_HEADER_SIZE + track_i*TRACK_HEADER_SIZE);
+      status |= SEQ_FILE_ReadBuffer(track_header, TRACK_HEADER_SIZE);
+
+      u32 par_size, trg_size;
+      SEQ_FILE_SES_TrackLayerBytesStored(&track_header[80], &par_size, &trg_size);
+      trg_offset += par_size;
+    }
+
+    for(track_i=0; track_i<num_tracks && status >= 0; ++track_i) {
+      u8 track_header[TRACK_HEADER_SIZE];
+      status |= SEQ_FILE_ReadSeek(offset + PATTERN_HEADER_SIZE + track_i*TRACK_HEADER_SIZE);
+      status |= SEQ_FILE_ReadBuffer(track_header, TRACK_HEADER_SIZE);
+      status |= SEQ_FILE_WriteBuffer(track_header, TRACK_HEADER_SIZE);
+
+      u32 par_size, trg_size;
+      SEQ_FILE_SES_TrackLayerBytes(&track_header[80], &par_size, &trg_size);
+      size += TRACK_HEADER_SIZE + par_size + trg_size;
+      if( size > pattern_size ) {
+	status = SEQ_FILE_SES_ERR_P_TOO_LARGE;
+	break;
+      }
+
+      u32 par_stored, trg_stored;
+      SEQ_FILE_SES_TrackLayerBytesStored(&track_header[80], &par_stored, &trg_stored);
+      status |= SEQ_FILE_SES_CopyBlock(par_offset, par_stored, par_size, info->file.fsize);
+      status |= SEQ_FILE_SES_CopyBlock(trg_offset, trg_stored, trg_size, info->file.fsize);
+      par_offset += par_stored;
+      trg_offset += trg_stored;
+    }
+  }
+
+  // fill remaining bytes of slot with zero
+  if( status >= 0 )
+    status |= SEQ_FILE_SES_WriteZeros(pattern_size - size);
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// converts a bank section into a bank file
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_ImportBank(char *session, u8 bank)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  seq_file_ses_section_t *s = &info->section[info->bank_section[bank]];
+  seq_file_ses_bank_t bank_header;
+  s32 status = 0;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
+    return SEQ_FILE_SES_ERR_READ;
+
+  status |= SEQ_FILE_ReadSeek(s->offset);
+  status |= SEQ_FILE_ReadBuffer((u8 *)bank_header.name, 20);
+  status |= SEQ_FILE_ReadHWord(&bank_header.num_patterns);
+  status |= SEQ_FILE_ReadHWord(&bank_header.pattern_size);
+
+  if( bank_header.num_patterns > s->num_items )
+    bank_header.num_patterns = s->num_items;
+
+  // the bank file ends after the last written slot
+  s32 last_pattern = -1;
+  u16 pattern;
+  for(pattern=0; pattern<bank_header.num_patterns && status >= 0; ++pattern) {
+    u8 flags;
+    status |= SEQ_FILE_ReadSeek(s->offset + SEQ_FILE_SES_ALIGN + pattern*SEQ_FILE_SES_PATTERN_SIZE + 23);
+    status |= SEQ_FILE_ReadByte(&flags);
+    if( flags & PATTERN_FLAG_USED )
+      last_pattern = pattern;
+  }
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  if( status < 0 )
+    return SEQ_FILE_SES_ERR_READ;
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, session, bank+1);
+
+  if( (status=SEQ_FILE_WriteOpen(filepath, 1)) < 0 )
+    return status;
+
+  const char file_type[10] = "MBSEQV4_B";
+  status |= SEQ_FILE_WriteBuffer((u8 *)file_type, 10);
+  status |= SEQ_FILE_WriteBuffer((u8 *)bank_header.name, 20);
+  status |= SEQ_FILE_WriteHWord(bank_header.num_patterns);
+  status |= SEQ_FILE_WriteHWord(bank_header.pattern_size);
+
+  for(pattern=0; (s32)pattern<=last_pattern && status >= 0; ++pattern)
+    status |= SEQ_FILE_SES_ImportPattern(s->offset + SEQ_FILE_SES_ALIGN + pattern*SEQ_FILE_SES_PATTERN_SIZE,
+					 bank_header.pattern_size);
+
+  // close file
+  status |= SEQ_FILE_WriteClose();
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] bank #%d imported with status %d\n", bank+1, status);
+#endif
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// restores an embedded session file
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_ImportFile(char *session, u8 file_ix, seq_file_ses_section_t *s)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  s32 status = 0;
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/%s", SEQ_FILE_SESSION_PATH, session, embedded_file_name[file_ix]);
+
+  if( (status=SEQ_FILE_WriteOpen(filepath, 1)) < 0 )
+    return status;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 ) {
+    SEQ_FILE_WriteClose();
+    return SEQ_FILE_SES_ERR_READ;
+  }
+
+  status |= SEQ_FILE_SES_CopyBlock(s->offset, s->size, s->size, info->file.fsize);
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  // close file
+  status |= SEQ_FILE_WriteClose();
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Restores the bank files and the embedded session files from the
+// session container
+// The files have to be loaded again thereafter (SEQ_FILE_LoadAllFiles())
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_Import(char *session)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  s32 status;
+
+  if( (status=SEQ_FILE_SES_Load(session)) < 0 )
+    return status;
+
+  u8 bank;
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS && status >= 0; ++bank)
+    if( info->bank_section[bank] >= 0 )
+      status |= SEQ_FILE_SES_ImportBank(session, bank);
+
+  u8 file_ix;
+  for(file_ix=0; file_ix<NUM_EMBEDDED_FILES && status >= 0; ++file_ix) {
+    u8 section;
+    for(section=0; section<info->header.num_sections; ++section) {
+      seq_file_ses_section_t *s = &info->section[section];
+      if( strncmp(s->id, embedded_file_id[file_ix], 4) == 0 ) {
+	status |= SEQ_FILE_SES_ImportFile(session, file_ix, s);
+	break;
+      }
+    }
+  }
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] Session imported with status %d\n", status);
+#endif
+
+  return (status < 0) ? SEQ_FILE_SES_ERR_WRITE : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pattern data is either read from the container (ptr == NULL), or from
+// a buffer which has been filled by SEQ_FILE_SES_PatternPrefetch()
+// pos is relative to the beginning of the pattern record
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_SrcRead(seq_file_ses_src_t *src, u32 pos, u8 *buffer, u32 len)
+{
+  if( src->ptr == NULL ) {
+    s32 status;
+    if( (status=SEQ_FILE_ReadSeek(src->offset + pos)) < 0 )
+      return status;
+    return SEQ_FILE_ReadBuffer(buffer, len);
+  }
+
+  if( (pos + len) > src->len )
+    return SEQ_FILE_ERR_READCOUNT;
+
+  memcpy(buffer, &src->ptr[pos], len);
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reads the packed layers of num_tracks tracks with a single access into
+// the layer rows (row_size bytes each), and moves them to the row starts
+// the rows are processed backwards, so that no packed data is overwritten
+// before it has been moved
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_LayerRead(seq_file_ses_src_t *src, u32 pos, u8 *rows, u32 row_size, u8 num_tracks, u32 *size)
+{
+  s32 status;
+  u32 offset[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+  u32 total = 0;
+
+  u8 track_i;
+  for(track_i=0; track_i<num_tracks; ++track_i) {
+    offset[track_i] = total;
+    total += size[track_i];
+  }
+
+  if( total && (status=SEQ_FILE_SES_SrcRead(src, pos, rows, total)) < 0 )
+    return status;
+
+  while( track_i ) {
+    --track_i;
+    u8 *row = &rows[track_i*row_size];
+    if( offset[track_i] != track_i*row_size )
+      memmove(row, &rows[offset[track_i]], size[track_i]);
+    memset(&row[size[track_i]], 0, row_size - size[track_i]);
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// parses a pattern record into given group
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_PatternParse(seq_file_ses_src_t *src, u8 bank, u8 pattern, u8 target_group)
+{
+  s32 status = 0;
+
+  u8 pattern_header[PATTERN_HEADER_SIZE];
+  if( (status=SEQ_FILE_SES_SrcRead(src, 0, pattern_header, PATTERN_HEADER_SIZE)) < 0 )
+    return status;
+
+  if( !(pattern_header[23] & PATTERN_FLAG_USED) )
+    return SEQ_FILE_SES_ERR_EMPTY_SLOT;
+
+  memcpy(seq_pattern_name[target_group], pattern_header, 20);
+  seq_pattern_name[target_group][20] = 0;
+
+  // mixer map and sysex setup are not evaluated (like in bank files)
+  u8 num_tracks = pattern_header[20];
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] read pattern B%d:P%d '%s', %d tracks\n", bank+1, pattern, seq_pattern_name[target_group], num_tracks);
+#endif
+
+  // reduce number of tracks if required
+  if( num_tracks > SEQ_CORE_NUM_TRACKS_PER_GROUP )
+    num_tracks = SEQ_CORE_NUM_TRACKS_PER_GROUP;
+
+  u8 first_track = target_group * SEQ_CORE_NUM_TRACKS_PER_GROUP;
+  u32 par_size[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+  u32 trg_size[SEQ_CORE_NUM_TRACKS_PER_GROUP];
+  u32 par_total = 0;
+  u8 track_i;
+  u8 track = first_track;
+  for(track_i=0; track_i<num_tracks; ++track_i, ++track) {
+    u32 pos = PATTERN_HEADER_SIZE + track_i*TRACK_HEADER_SIZE;
+
+    status |= SEQ_FILE_SES_SrcRead(src, pos, (u8 *)seq_core_trk[track].name, 80);
+    seq_core_trk[track].name[80] = 0;
+
+    u8 track_header[8];
+    status |= SEQ_FILE_SES_SrcRead(src, pos + 80, track_header, 8);
+
+    u8 cc_buffer[128];
+    status |= SEQ_FILE_SES_SrcRead(src, pos + 88, cc_buffer, 128);
+
+    // before changing CCs: we should stop here on error if read failed
+    if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+      DEBUG_MSG("[SEQ_FILE_SES] read track #%d failed due to file access error, status: %d\n", track+1, status);
+#endif
+      break;
+    }
+
+    u8 num_p_instruments = track_header[0];
+    u8 num_t_instruments = track_header[1];
+    u8 num_p_layers = track_header[2];
+    u8 num_t_layers = track_header[3];
+    u16 p_layer_size = ((u16)track_header[4] << 0) | ((u16)track_header[5] << 8);
+    u16 t_layer_size = ((u16)track_header[6] << 0) | ((u16)track_header[7] << 8);
+
+    // reading CCs
+    u8 cc;
+    for(cc=0; cc<128; ++cc)
+      SEQ_CC_Set(track, cc, cc_buffer[cc]);
+
+    // partitionate layers (steps will be overwritten below)
+    SEQ_PAR_TrackInit(track, p_layer_size, num_p_layers, num_p_instruments);
+    SEQ_TRG_TrackInit(track, t_layer_size*8, num_t_layers, num_t_instruments);
+
+    SEQ_FILE_SES_TrackLayerBytesStored(track_header, &par_size[track_i], &trg_size[track_i]);
+    par_total += par_size[track_i];
+  }
+
+  // reading Parameter and Trigger layers of all tracks at once
+  if( track_i && status >= 0 ) {
+    u32 pos = PATTERN_HEADER_SIZE + num_tracks*TRACK_HEADER_SIZE;
+    status |= SEQ_FILE_SES_LayerRead(src, pos, (u8 *)&seq_par_layer_value[first_track],
+				     SEQ_PAR_MAX_BYTES, track_i, par_size);
+    status |= SEQ_FILE_SES_LayerRead(src, pos + par_total, (u8 *)&seq_trg_layer_value[first_track],
+				     SEQ_TRG_MAX_BYTES, track_i, trg_size);
+  }
+
+  // finally update CC links again, because some of them depend on SEQ_PAR_NumLayersGet()!!!
+  for(track=first_track; track<(first_track+track_i); ++track)
+    SEQ_CC_LinkUpdate(track);
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns the position of a pattern record in the container
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_FILE_SES_PatternOffset(u8 bank, u8 pattern, u32 *offset)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+
+  if( bank >= SEQ_FILE_B_NUM_BANKS )
+    return SEQ_FILE_SES_ERR_INVALID_BANK;
+
+  if( !SEQ_FILE_SES_BankValid(bank) )
+    return SEQ_FILE_SES_ERR_NO_FILE;
+
+  seq_file_ses_section_t *s = &info->section[info->bank_section[bank]];
+  if( pattern >= s->num_items )
+    return SEQ_FILE_SES_ERR_INVALID_PATTERN;
+
+  *offset = s->offset + SEQ_FILE_SES_ALIGN + pattern * SEQ_FILE_SES_PATTERN_SIZE;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reads a pattern from container into given group
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_PatternRead(u8 bank, u8 pattern, u8 target_group)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  s32 status;
+
+  if( target_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  seq_file_ses_src_t src;
+  if( (status=SEQ_FILE_SES_PatternOffset(bank, pattern, &src.offset)) < 0 )
+    return status;
+  src.ptr = NULL; // read from file
+  src.len = 0;
+
+  // slots behind the last written one are empty (no need to access the SD Card)
+  if( pattern >= info->header.bank_used[bank] )
+    return SEQ_FILE_SES_ERR_EMPTY_SLOT;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
+    return -1; // file cannot be re-opened
+
+  status = SEQ_FILE_SES_PatternParse(&src, bank, pattern, target_group);
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] error while reading pattern, status: %d\n", status);
+#endif
+    return (status == SEQ_FILE_SES_ERR_EMPTY_SLOT) ? status : SEQ_FILE_SES_ERR_READ;
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reads the raw pattern record from container into a buffer, so that it can
+// be transfered into a group with SEQ_FILE_SES_PatternReadBuffer() later
+// without accessing the SD Card
+// returns < 0 on errors (error codes are documented in seq_file.h)
+// returns number of bytes stored in buffer on success
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_PatternPrefetch(u8 bank, u8 pattern, u8 *buffer, u32 max_len)
+{
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  s32 status;
+  u32 offset;
+
+  if( (status=SEQ_FILE_SES_PatternOffset(bank, pattern, &offset)) < 0 )
+    return status;
+
+  if( SEQ_FILE_SES_PATTERN_SIZE > max_len )
+    return SEQ_FILE_SES_ERR_PREFETCH_SIZE;
+
+  // slots behind the last written one are empty (no need to access the SD Card)
+  if( pattern >= info->header.bank_used[bank] )
+    return SEQ_FILE_SES_ERR_EMPTY_SLOT;
+
+  // re-open file
+  if( SEQ_FILE_ReadReOpen((seq_file_t*)&info->file) < 0 )
+    return -1; // file cannot be re-opened
+
+  // headers first, they specify the number of used layer bytes
+  u32 len = PATTERN_HEADER_SIZE + SEQ_CORE_NUM_TRACKS_PER_GROUP*TRACK_HEADER_SIZE;
+  if( (status=SEQ_FILE_ReadSeek(offset)) >= 0 )
+    status = SEQ_FILE_ReadBuffer(buffer, len);
+
+  if( status >= 0 && (buffer[23] & PATTERN_FLAG_USED) ) {
+    u8 num_tracks = buffer[20];
+    if( num_tracks > SEQ_CORE_NUM_TRACKS_PER_GROUP )
+      num_tracks = SEQ_CORE_NUM_TRACKS_PER_GROUP;
+
+    u32 data_len = PATTERN_HEADER_SIZE + num_tracks*TRACK_HEADER_SIZE;
+    u8 track_i;
+    for(track_i=0; track_i<num_tracks; ++track_i) {
+      u32 par_size, trg_size;
+      SEQ_FILE_SES_TrackLayerBytesStored(&buffer[PATTERN_HEADER_SIZE + track_i*TRACK_HEADER_SIZE + 80], &par_size, &trg_size);
+      data_len += par_size + trg_size;
+    }
+
+    if( data_len > len ) {
+      status = SEQ_FILE_ReadBuffer(&buffer[len], data_len - len);
+      len = data_len;
+    }
+  }
+
+  // close file (so that it can be re-opened)
+  SEQ_FILE_ReadClose((seq_file_t*)&info->file);
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] error while prefetching pattern, status: %d\n", status);
+#endif
+    return SEQ_FILE_SES_ERR_READ;
+  }
+
+  // empty slots can't be taken over
+  if( !(buffer[23] & PATTERN_FLAG_USED) )
+    return SEQ_FILE_SES_ERR_EMPTY_SLOT;
+
+  return len;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// transfers a pattern record which has been read by SEQ_FILE_SES_PatternPrefetch()
+// into given group
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_PatternReadBuffer(u8 bank, u8 pattern, u8 target_group, u8 *buffer, u32 len)
+{
+  if( target_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  seq_file_ses_src_t src;
+  src.ptr = buffer;
+  src.len = len;
+  src.offset = 0;
+  if( SEQ_FILE_SES_PatternParse(&src, bank, pattern, target_group) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] prefetched pattern B%d:P%d is incomplete\n", bank+1, pattern);
+#endif
+    return SEQ_FILE_SES_ERR_READ;
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// writes a pattern of a given group into the container
+// Called from SEQ_FILE_B_PatternWrite(), so that the container is in sync
+// with the bank file. If the container can't be written, it will be unloaded.
+// returns < 0 on errors (error codes are documented in seq_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_SES_PatternWrite(char *session, u8 bank, u8 pattern, u8 source_group)
+{
+  s32 status;
+  u32 offset;
+
+  if( source_group >= SEQ_CORE_NUM_GROUPS )
+    return SEQ_FILE_B_ERR_INVALID_GROUP;
+
+  if( (status=SEQ_FILE_SES_PatternOffset(bank, pattern, &offset)) < 0 )
+    return status;
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/%s/MBSEQ_SE.V4", SEQ_FILE_SESSION_PATH, session);
+
+  if( (status=SEQ_FILE_WriteOpen(filepath, 0)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_FILE_SES] Failed to open file, status: %d\n", status);
+#endif
+    SEQ_FILE_SES_Unload();
+    return status;
+  }
+
+  status |= SEQ_FILE_WriteSeek(offset);
+
+  // pattern header
+  u8 num_tracks = SEQ_CORE_NUM_TRACKS_PER_GROUP;
+  status |= SEQ_FILE_WriteBuffer((u8 *)seq_pattern_name[source_group], 20);
+  status |= SEQ_FILE_WriteByte(num_tracks);
+  status |= SEQ_FILE_WriteByte(0x00); // mixer map: off
+  status |= SEQ_FILE_WriteByte(0x00); // SysEx setup: off
+  status |= SEQ_FILE_WriteByte(PATTERN_FLAG_USED);
+
+  // track headers
+  u8 first_track = source_group * SEQ_CORE_NUM_TRACKS_PER_GROUP;
+  u8 track;
+  for(track=first_track; track<(first_track+num_tracks); ++track) {
+    status |= SEQ_FILE_WriteBuffer((u8 *)seq_core_trk[track].name, 80);
+    status |= SEQ_FILE_WriteByte(SEQ_PAR_NumInstrumentsGet(track));
+    status |= SEQ_FILE_WriteByte(SEQ_TRG_NumInstrumentsGet(track));
+    status |= SEQ_FILE_WriteByte(SEQ_PAR_NumLayersGet(track));
+    status |= SEQ_FILE_WriteByte(SEQ_TRG_NumLayersGet(track));
+    status |= SEQ_FILE_WriteHWord(SEQ_PAR_NumStepsGet(track));
+    status |= SEQ_FILE_WriteHWord(SEQ_TRG_NumStepsGet(track)/8);
+
+    u8 cc;
+    for(cc=0; cc<128; ++cc) {
+      s32 cc_value = SEQ_CC_Get(track, cc);
+      if( cc_value < 0 ) // set CC value to 0 if it doesn't exist (reserved CCs)
+	cc_value = 0;
+      status |= SEQ_FILE_WriteByte(cc_value);
+    }
+  }
+
+  // layers: only the used bytes are taken over (packed), so that the record is
+  // identical to an exported bank file slot
+  u32 size = PATTERN_HEADER_SIZE + num_tracks*TRACK_HEADER_SIZE;
+  for(track=first_track; track<(first_track+num_tracks); ++track) {
+    u32 par_size = SEQ_PAR_NumInstrumentsGet(track) * SEQ_PAR_NumLayersGet(track) * SEQ_PAR_NumStepsGet(track);
+    if( par_size > SEQ_PAR_MAX_BYTES )
+      par_size = SEQ_PAR_MAX_BYTES;
+    status |= SEQ_FILE_WriteBuffer((u8 *)&seq_par_layer_value[track], par_size);
+    size += par_size;
+  }
+
+  for(track=first_track; track<(first_track+num_tracks); ++track) {
+    u32 trg_size = SEQ_TRG_NumInstrumentsGet(track) * SEQ_TRG_NumLayersGet(track) * (SEQ_TRG_NumStepsGet(track)/8);
+    if( trg_size > SEQ_TRG_MAX_BYTES )
+      trg_size = SEQ_TRG_MAX_BYTES;
+    status |= SEQ_FILE_WriteBuffer((u8 *)&seq_trg_layer_value[track], trg_size);
+    size += trg_size;
+  }
+
+  status |= SEQ_FILE_SES_WriteZeros(SEQ_FILE_SES_PATTERN_SIZE - size);
+
+  // slot behind the last written one: take it over into the header
+  seq_file_ses_info_t *info = &seq_file_ses_info;
+  if( pattern >= info->header.bank_used[bank] ) {
+    info->header.bank_used[bank] = pattern + 1;
+    status |= SEQ_FILE_WriteSeek(HEADER_BANK_USED_OFFSET + 2*bank);
+    status |= SEQ_FILE_WriteHWord(info->header.bank_used[bank]);
+  }
+
+  // close file
+  status |= SEQ_FILE_WriteClose();
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SEQ_FILE_SES] Pattern written with status %d\n", status);
+#endif
+
+  if( status < 0 ) {
+    // container is out of sync - continue with bank files
+    SEQ_FILE_SES_Unload();
+    return SEQ_FILE_SES_ERR_WRITE;
+  }
+
+  return 0; // no error
+}
@@ -0,0 +1,77 @@
+// $Id$
+/*
+ * Header for session container functions
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _SEQ_FILE_SES_H
+#define _SEQ_FILE_SES_H
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+// format version, incremented on incompatible changes
+#define SEQ_FILE_SES_VERSION 2
+
+// max. number of sections in the container
+#define SEQ_FILE_SES_MAX_SECTIONS 16
+
+// sections and pattern records start at 1k boundaries, so that the layer
+// blocks are mostly transfered with multi sector reads w/o touching the cache
+#define SEQ_FILE_SES_ALIGN 1024
+
+// size of a pattern record: track headers, followed by the used bytes of the
+// parameter and trigger layers of all tracks of a group (packed, padded to 1k)
+#define SEQ_FILE_SES_PATTERN_SIZE (SEQ_FILE_SES_ALIGN + SEQ_CORE_NUM_TRACKS_PER_GROUP*(SEQ_PAR_MAX_BYTES + SEQ_TRG_MAX_BYTES))
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  char id[4];         // section identifier, e.g. "BNK1" or "SONG"
+  u32  offset;        // offset from beginning of file
+  u32  size;          // size in bytes
+  u16  num_items;     // number of pattern records in bank sections, 0 for embedded files
+  u16  item_size;     // size of a pattern record
+} seq_file_ses_section_t; // 16 bytes
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 SEQ_FILE_SES_Init(u32 mode);
+extern s32 SEQ_FILE_SES_Load(char *session);
+extern s32 SEQ_FILE_SES_Unload(void);
+extern s32 SEQ_FILE_SES_Valid(void);
+
+extern s32 SEQ_FILE_SES_BankValid(u8 bank);
+extern s32 SEQ_FILE_SES_NumSections(void);
+extern s32 SEQ_FILE_SES_SectionGet(u8 section, seq_file_ses_section_t *info);
+
+extern s32 SEQ_FILE_SES_Export(char *session);
+extern s32 SEQ_FILE_SES_Import(char *session);
+
+extern s32 SEQ_FILE_SES_PatternRead(u8 bank, u8 pattern, u8 target_group);
+extern s32 SEQ_FILE_SES_PatternPrefetch(u8 bank, u8 pattern, u8 *buffer, u32 max_len);
+extern s32 SEQ_FILE_SES_PatternReadBuffer(u8 bank, u8 pattern, u8 target_group, u8 *buffer, u32 len);
+extern s32 SEQ_FILE_SES_PatternWrite(char *session, u8 bank, u8 pattern, u8 source_group);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+
+#endif /* _SEQ_FILE_SES_H */
@@ -184,6 +184,7 @@ s32 SEQ_MIDIMP_ReadFile(char *path)
   MIOS32_IRQ_Disable();
   MID_PARSER_InstallFileCallbacks(&SEQ_MIDIMP_read, &SEQ_MIDIMP_eof, &SEQ_MIDIMP_seek);
   MID_PARSER_InstallEventCallbacks(&SEQ_MIDIMP_PlayEventAnalyze, &SEQ_MIDIMP_PlayMetaAnalyze);
+  MID_PARSER_InstallSysExCallback(NULL); // could have been installed by SEQ_MIDPLY
   MIOS32_IRQ_Enable();
 
   MUTEX_SDCARD_TAKE;
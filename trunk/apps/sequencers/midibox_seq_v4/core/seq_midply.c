@@ -57,6 +57,7 @@ static s32 SEQ_MIDPLY_seek(u32 pos);
 
 static s32 SEQ_MIDPLY_PlayEvent(u8 track, mios32_midi_package_t midi_package, u32 tick);
 static s32 SEQ_MIDPLY_PlayMeta(u8 track, u8 meta, u32 len, u8 *buffer, u32 tick);
+static s32 SEQ_MIDPLY_PlaySysEx(u8 track, u8 event, u32 offset, u32 len, u8 *buffer, u32 tick);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -247,6 +248,7 @@ s32 SEQ_MIDPLY_ReadFile(char *path)
   MIOS32_IRQ_Disable();
   MID_PARSER_InstallFileCallbacks(&SEQ_MIDPLY_read, &SEQ_MIDPLY_eof, &SEQ_MIDPLY_seek);
   MID_PARSER_InstallEventCallbacks(&SEQ_MIDPLY_PlayEvent, &SEQ_MIDPLY_PlayMeta);
+  MID_PARSER_InstallSysExCallback(&SEQ_MIDPLY_PlaySysEx);
   MIOS32_IRQ_Enable();
 
   // ensure exclusive access to parser (this routine could be interrupted by sequencer handler)
@@ -661,6 +663,35 @@ static s32 SEQ_MIDPLY_PlayEvent(u8 track, mios32_midi_package_t midi_package, u3
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// called when a chunk of a SysEx or Escaped event should be played at a given tick
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_MIDPLY_PlaySysEx(u8 track, u8 event, u32 offset, u32 len, u8 *buffer, u32 tick)
+{
+  // calculate tick based on 384 ppqn
+  tick += loop_offset;
+  tick = (384 * tick) / MIDI_PARSER_PPQN_Get();
+
+  // ignore all events in silent mode (for SEQ_MIDPLY_SongPos function)
+  if( ffwd_silent_mode )
+    return 0;
+
+  mios32_midi_package_t midi_package;
+  midi_package.ALL = 0;
+  midi_package.type = 0xf; // single bytes will be transmitted
+  midi_package.cable = 15; // use tag of track #16 (see SEQ_MIDPLY_PlayEvent)
+
+  s32 status = 0;
+  int i;
+  for(i=0; i<len; ++i) {
+    midi_package.evnt0 = buffer[i];
+    status |= SEQ_MIDI_OUT_Send(seq_midply_port, midi_package, SEQ_MIDI_OUT_OnEvent, tick+1, 0);
+  }
+
+  return status;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // called when a Meta event should be played/processed at a given tick
 /////////////////////////////////////////////////////////////////////////////
@@ -16,6 +16,7 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #include <mios32.h>
+#include <string.h>
 
 #include <seq_bpm.h>
 
@@ -43,6 +44,37 @@
 // value is visible in INFO->System page (-> press exit button, go to last item)
 #define STOPWATCH_PERFORMANCE_MEASURING 0
 
+// for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
+#define DEBUG_VERBOSE_LEVEL 0
+
+
+// states of the staged patterns
+#define PREFETCH_STATE_IDLE    0 // nothing staged
+#define PREFETCH_STATE_REQ     1 // pattern should be read by the pattern task
+#define PREFETCH_STATE_LOADING 2 // pattern task is reading the pattern
+#define PREFETCH_STATE_READY   3 // pattern is available in the staging area
+#define PREFETCH_STATE_SWAP    4 // pattern will be taken at the next step boundary
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  seq_pattern_t pattern;  // staged pattern
+  u8  state;              // PREFETCH_STATE_*
+  u16 offset;             // position in prefetch_buffer
+  u16 len;                // size of the pattern record
+  u32 ready_tick;         // bpm_tick at which the pattern was available
+} seq_pattern_prefetch_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static s32 SEQ_PATTERN_PrefetchHandler(void);
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global variables
@@ -53,6 +85,24 @@ seq_pattern_t seq_pattern_req[SEQ_CORE_NUM_GROUPS];
 char seq_pattern_name[SEQ_CORE_NUM_GROUPS][21];
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+// the patterns of the next song step are read into the staging area while the
+// current patterns are played, and taken over at the measure boundary
+static seq_pattern_prefetch_t prefetch[SEQ_CORE_NUM_GROUPS];
+#if SEQ_PATTERN_PREFETCH_BUFFER_SIZE
+static u8 prefetch_buffer[SEQ_PATTERN_PREFETCH_BUFFER_SIZE];
+#endif
+
+// a new request is deferred until pending swaps have been done
+static seq_pattern_t prefetch_next[SEQ_CORE_NUM_GROUPS];
+static u8 prefetch_next_req;
+
+static seq_pattern_prefetch_stats_t prefetch_stats;
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Initialisation
 /////////////////////////////////////////////////////////////////////////////
@@ -88,6 +138,9 @@ s32 SEQ_PATTERN_Init(u32 mode)
   SEQ_STATISTICS_StopwatchInit();
 #endif
 
+  SEQ_PATTERN_PrefetchCancel();
+  SEQ_PATTERN_PrefetchStatsReset();
+
   return 0; // no error
 }
 
@@ -117,6 +170,8 @@ s32 SEQ_PATTERN_Change(u8 group, seq_pattern_t pattern, u8 force_immediate_chang
     portENTER_CRITICAL();
     pattern.REQ = 0; // request not required - we load the pattern immediately
     seq_pattern_req[group] = pattern;
+    if( prefetch[group].state == PREFETCH_STATE_SWAP )
+      prefetch[group].state = PREFETCH_STATE_IDLE; // overruled by this change
     portEXIT_CRITICAL();
 
 #if LED_PERFORMANCE_MEASURING
@@ -133,6 +188,31 @@ s32 SEQ_PATTERN_Change(u8 group, seq_pattern_t pattern, u8 force_immediate_chang
     // in song mode it has to be considered, that this function is called multiple times
     // to request pattern changes for all groups
 
+    // pattern already available in staging area? It will be taken by
+    // SEQ_PATTERN_SwapHandler() at the next step boundary w/o SD Card access
+    if( SEQ_SONG_ActiveGet() ) {
+      u8 swap = 0;
+
+      portENTER_CRITICAL();
+      seq_pattern_prefetch_t *pf = &prefetch[group];
+      if( pf->state == PREFETCH_STATE_READY &&
+	  pf->pattern.bank == pattern.bank && pf->pattern.pattern == pattern.pattern ) {
+	pf->state = PREFETCH_STATE_SWAP;
+	pattern.REQ = 0;
+	seq_pattern_req[group] = pattern;
+	swap = 1;
+      } else if( pf->state == PREFETCH_STATE_REQ || pf->state == PREFETCH_STATE_LOADING ) {
+	pf->state = PREFETCH_STATE_IDLE; // too late, pattern will be loaded directly
+	++prefetch_stats.late;
+      } else {
+	++prefetch_stats.missed;
+      }
+      portEXIT_CRITICAL();
+
+      if( swap )
+	return 0; // no error
+    }
+
     // else request change
     portENTER_CRITICAL();
     pattern.REQ = 1;
@@ -187,6 +267,222 @@ s32 SEQ_PATTERN_Handler(void)
   MIOS32_BOARD_LED_Set(0xffffffff, 0);
 #endif
 
+  // read the patterns of the next song step into the staging area
+  // (not in synched pattern change mode, which calls this function from SEQ_CORE_Handler())
+  if( SEQ_SONG_ActiveGet() )
+    SEQ_PATTERN_PrefetchHandler();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reads the requested patterns into the staging area
+// Called from SEQ_PATTERN_Handler() (pattern task)
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_PATTERN_PrefetchHandler(void)
+{
+#if SEQ_PATTERN_PREFETCH_BUFFER_SIZE == 0
+  return 0; // no staging area
+#else
+  u8 group;
+
+  // start new prefetch request if no swap is pending anymore
+  portENTER_CRITICAL();
+  if( prefetch_next_req ) {
+    u8 swap_pending = 0;
+    for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group)
+      if( prefetch[group].state == PREFETCH_STATE_SWAP )
+	swap_pending = 1;
+
+    if( !swap_pending ) {
+      prefetch_next_req = 0;
+      for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+	prefetch[group].pattern = prefetch_next[group];
+	prefetch[group].state = prefetch_next[group].DISABLED ? PREFETCH_STATE_IDLE : PREFETCH_STATE_REQ;
+      }
+    }
+  }
+  portEXIT_CRITICAL();
+
+  u32 buffer_offset = 0;
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+    seq_pattern_prefetch_t *pf = &prefetch[group];
+
+    portENTER_CRITICAL();
+    u8 state = pf->state;
+    if( state == PREFETCH_STATE_REQ )
+      pf->state = PREFETCH_STATE_LOADING;
+    seq_pattern_t pattern = pf->pattern;
+    portEXIT_CRITICAL();
+
+    if( state == PREFETCH_STATE_READY || state == PREFETCH_STATE_SWAP ) {
+      buffer_offset = pf->offset + pf->len; // allocated by a previous call
+    } else if( state == PREFETCH_STATE_REQ ) {
+      s32 status;
+
+      MUTEX_SDCARD_TAKE;
+      status = SEQ_FILE_B_PatternPrefetch(pattern.bank, pattern.pattern,
+					  &prefetch_buffer[buffer_offset],
+					  SEQ_PATTERN_PREFETCH_BUFFER_SIZE - buffer_offset);
+      MUTEX_SDCARD_GIVE;
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+      DEBUG_MSG("[SEQ_PATTERN:%u] prefetch G%d B%d:P%d status %d\n",
+		SEQ_BPM_TickGet(), group+1, pattern.bank+1, pattern.pattern+1, status);
+#endif
+
+      // request could have been cancelled meanwhile
+      portENTER_CRITICAL();
+      if( pf->state == PREFETCH_STATE_LOADING ) {
+	if( status < 0 ) {
+	  pf->state = PREFETCH_STATE_IDLE; // e.g. staging area full: pattern will be loaded directly
+	} else {
+	  pf->state = PREFETCH_STATE_READY;
+	  pf->offset = buffer_offset;
+	  pf->len = status;
+	  pf->ready_tick = SEQ_BPM_TickGet();
+	  buffer_offset += status;
+	}
+      }
+      portEXIT_CRITICAL();
+
+      // direct pattern change requests have higher priority - continue later
+      u8 req_group;
+      for(req_group=0; req_group<SEQ_CORE_NUM_GROUPS; ++req_group) {
+	if( seq_pattern_req[req_group].REQ ) {
+	  SEQ_TASK_PatternResume();
+	  return 0; // no error
+	}
+      }
+    }
+  }
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Requests to read the given patterns into the staging area
+// Patterns with DISABLED flag won't be prefetched
+// Usually called from SEQ_SONG_FetchPos() with the patterns of the next song step
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PATTERN_PrefetchReq(seq_pattern_t *patterns)
+{
+#if SEQ_PATTERN_PREFETCH_BUFFER_SIZE == 0
+  return 0; // no staging area: patterns are loaded at the end of the song step
+#else
+  u8 group;
+
+  portENTER_CRITICAL();
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group)
+    prefetch_next[group] = patterns[group];
+  prefetch_next_req = 1;
+  portEXIT_CRITICAL();
+
+  // resume low-prio pattern handler
+  SEQ_TASK_PatternResume();
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Invalidates the staging area, e.g. on song position changes or if the
+// patterns have been changed on SD Card
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PATTERN_PrefetchCancel(void)
+{
+  u8 group;
+
+  portENTER_CRITICAL();
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group)
+    prefetch[group].state = PREFETCH_STATE_IDLE;
+  prefetch_next_req = 0;
+  portEXIT_CRITICAL();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Takes over the staged patterns at the step boundary after a song change
+// Called from SEQ_CORE_Handler() before each tick, so that the swap is
+// atomic for the sequencer
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PATTERN_SwapHandler(u32 bpm_tick)
+{
+#if SEQ_PATTERN_PREFETCH_BUFFER_SIZE == 0
+  return 0; // nothing staged
+#else
+  u8 group;
+  u8 swapped = 0;
+
+  if( (bpm_tick % 96) != 0 )
+    return 0; // no step boundary
+
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+    seq_pattern_prefetch_t *pf = &prefetch[group];
+
+    if( pf->state != PREFETCH_STATE_SWAP )
+      continue;
+
+    seq_pattern[group] = seq_pattern_req[group];
+    if( SEQ_FILE_B_PatternReadBuffer(pf->pattern.bank, pf->pattern.pattern, group,
+				     &prefetch_buffer[pf->offset], pf->len) < 0 ) {
+      // shouldn't happen - try again from SD Card
+      portENTER_CRITICAL();
+      seq_pattern_req[group].REQ = 1;
+      portEXIT_CRITICAL();
+      SEQ_TASK_PatternResume();
+    }
+    pf->state = PREFETCH_STATE_IDLE;
+    swapped = 1;
+
+    u32 margin = (bpm_tick > pf->ready_tick) ? (bpm_tick - pf->ready_tick) : 0;
+    prefetch_stats.margin_last = margin;
+    if( !prefetch_stats.swaps || margin < prefetch_stats.margin_min )
+      prefetch_stats.margin_min = margin;
+    if( margin > prefetch_stats.margin_max )
+      prefetch_stats.margin_max = margin;
+    prefetch_stats.margin_sum += margin;
+    ++prefetch_stats.swaps;
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SEQ_PATTERN:%u] swapped G%d to B%d:P%d, margin %u ticks\n",
+	      bpm_tick, group+1, pf->pattern.bank+1, pf->pattern.pattern+1, margin);
+#endif
+  }
+
+  if( swapped ) {
+    // restart *all* patterns?
+    if( seq_core_options.RATOPC )
+      SEQ_CORE_ResetTrkPosAll();
+
+    // continue with deferred prefetch request
+    if( prefetch_next_req )
+      SEQ_TASK_PatternResume();
+  }
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prefetch statistics
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_PATTERN_PrefetchStatsGet(seq_pattern_prefetch_stats_t *stats)
+{
+  *stats = prefetch_stats;
+  return 0; // no error
+}
+
+s32 SEQ_PATTERN_PrefetchStatsReset(void)
+{
+  memset(&prefetch_stats, 0, sizeof(seq_pattern_prefetch_stats_t));
   return 0; // no error
 }
 
@@ -233,6 +529,16 @@ s32 SEQ_PATTERN_Save(u8 group, seq_pattern_t pattern)
 
   status = SEQ_FILE_B_PatternWrite(seq_file_session_name, pattern.bank, pattern.pattern, group, 1);
 
+  // a staged copy of this pattern is outdated now
+  u8 prefetch_group;
+  portENTER_CRITICAL();
+  for(prefetch_group=0; prefetch_group<SEQ_CORE_NUM_GROUPS; ++prefetch_group) {
+    seq_pattern_prefetch_t *pf = &prefetch[prefetch_group];
+    if( pf->pattern.bank == pattern.bank && pf->pattern.pattern == pattern.pattern )
+      pf->state = PREFETCH_STATE_IDLE;
+  }
+  portEXIT_CRITICAL();
+
 #if STOPWATCH_PERFORMANCE_MEASURING == 1
   SEQ_STATISTICS_StopwatchCapture();
 #endif
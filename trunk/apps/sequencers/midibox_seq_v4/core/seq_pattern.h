@@ -22,6 +22,22 @@
 // Global definitions
 /////////////////////////////////////////////////////////////////////////////
 
+// staging area for the patterns of the next song step, which are read by the
+// pattern task in advance and swapped at the measure boundary
+// RAM is tight: by default it can hold one pattern with the default layer
+// partitioning (6008 bytes); the patterns of the remaining groups will be
+// loaded at the end of the song step like before.
+// 4*6*1024 would allow to prefetch all groups
+// 0 disables prefetching, this is the default for the STM32F103 which doesn't
+// have enough free RAM
+#ifndef SEQ_PATTERN_PREFETCH_BUFFER_SIZE
+#if defined(MIOS32_FAMILY_STM32F10x)
+#define SEQ_PATTERN_PREFETCH_BUFFER_SIZE 0
+#else
+#define SEQ_PATTERN_PREFETCH_BUFFER_SIZE (6*1024)
+#endif
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -43,6 +59,16 @@ typedef union {
   };
 } seq_pattern_t;
 
+typedef struct {
+  u32 swaps;        // number of patterns which have been taken from the staging area
+  u32 late;         // number of patterns which were still loading when the change was due
+  u32 missed;       // number of pattern changes which haven't been prefetched (e.g. staging area full, song position changed)
+  u32 margin_last;  // ticks between the end of prefetching and the swap
+  u32 margin_min;
+  u32 margin_max;
+  u32 margin_sum;   // for the average margin
+} seq_pattern_prefetch_stats_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -54,6 +80,12 @@ extern char *SEQ_PATTERN_NameGet(u8 group);
 extern s32 SEQ_PATTERN_Change(u8 group, seq_pattern_t pattern, u8 force_immediate_change);
 extern s32 SEQ_PATTERN_Handler(void);
 
+extern s32 SEQ_PATTERN_PrefetchReq(seq_pattern_t *patterns);
+extern s32 SEQ_PATTERN_PrefetchCancel(void);
+extern s32 SEQ_PATTERN_SwapHandler(u32 bpm_tick);
+extern s32 SEQ_PATTERN_PrefetchStatsGet(seq_pattern_prefetch_stats_t *stats);
+extern s32 SEQ_PATTERN_PrefetchStatsReset(void);
+
 extern s32 SEQ_PATTERN_Load(u8 group, seq_pattern_t pattern);
 extern s32 SEQ_PATTERN_Save(u8 group, seq_pattern_t pattern);
 
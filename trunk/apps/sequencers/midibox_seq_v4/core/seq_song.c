@@ -56,6 +56,13 @@ static u8 song_loop_ctr_max;
 static u8 something_has_been_changed;
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Local prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static s32 SEQ_SONG_PrefetchNextPos(void);
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Initialisation
 /////////////////////////////////////////////////////////////////////////////
@@ -240,6 +247,10 @@ s32 SEQ_SONG_FetchPos(u8 force_immediate_change)
 {
   int recursion_ctr = 0;
 
+  // staged patterns don't match on song position changes
+  if( force_immediate_change )
+    SEQ_PATTERN_PrefetchCancel();
+
   u8 again;
   do {
     again = 0;
@@ -320,7 +331,8 @@ s32 SEQ_SONG_FetchPos(u8 force_immediate_change)
 
 	  seq_pattern_t p;
 
-	  // TODO: implement prefetching until end of step!
+	  // the patterns have been prefetched by the pattern task if possible,
+	  // see SEQ_SONG_PrefetchNextPos()
 
 	  if( s->pattern_g1 < 0x80 ) {
 	    p.ALL = 0;
@@ -354,10 +366,79 @@ s32 SEQ_SONG_FetchPos(u8 force_immediate_change)
 
   } while( again );
 
+  // read the patterns of the next song step in background
+  if( song_active )
+    SEQ_SONG_PrefetchNextPos();
+
   return 0; // no error
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// determines the patterns of the next song step w/o executing the actions,
+// and requests the pattern task to read them into the staging area.
+// They will be taken over by SEQ_PATTERN_SwapHandler() at the measure boundary
+// returns 0 if the patterns can't be determined (e.g. Stop or JmpSong action)
+// returns 1 if prefetching has been requested
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_SONG_PrefetchNextPos(void)
+{
+  int recursion_ctr = 0;
+  u32 pos = song_pos + 1;
+
+  while( ++recursion_ctr < 64 ) {
+    if( pos >= SEQ_SONG_NUM_STEPS )
+      pos = 0;
+
+    seq_song_step_t *s = (seq_song_step_t *)&seq_song_steps[pos];
+
+    switch( s->action ) {
+      case SEQ_SONG_ACTION_JmpPos:
+	pos = s->action_value % SEQ_SONG_NUM_STEPS;
+	break;
+
+      case SEQ_SONG_ACTION_SelMixerMap:
+      case SEQ_SONG_ACTION_Tempo:
+      case SEQ_SONG_ACTION_Mutes:
+	++pos;
+	break;
+
+      default:
+	if( s->action >= SEQ_SONG_ACTION_Loop1 && s->action <= SEQ_SONG_ACTION_Loop16 ) {
+	  seq_pattern_t p[SEQ_CORE_NUM_GROUPS];
+	  int group;
+
+	  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group)
+	    p[group].ALL = 0;
+
+	  p[0].pattern = s->pattern_g1;
+	  p[0].bank = s->bank_g1;
+	  p[0].DISABLED = s->pattern_g1 >= 0x80;
+
+	  p[1].pattern = s->pattern_g2;
+	  p[1].bank = s->bank_g2;
+	  p[1].DISABLED = s->pattern_g2 >= 0x80;
+
+	  p[2].pattern = s->pattern_g3;
+	  p[2].bank = s->bank_g3;
+	  p[2].DISABLED = s->pattern_g3 >= 0x80;
+
+	  p[3].pattern = s->pattern_g4;
+	  p[3].bank = s->bank_g4;
+	  p[3].DISABLED = s->pattern_g4 >= 0x80;
+
+	  SEQ_PATTERN_PrefetchReq(p);
+	  return 1; // prefetching requested
+	}
+
+	return 0; // Stop/JmpSong: patterns can't be determined in advance
+    }
+  }
+
+  return 0; // recursion detected
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // fetches the next pos entry of a song
 /////////////////////////////////////////////////////////////////////////////
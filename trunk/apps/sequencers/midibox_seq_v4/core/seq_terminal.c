@@ -18,6 +18,7 @@
 #include <mios32.h>
 #include <string.h>
 
+#include <seq_bpm.h>
 #include <seq_midi_out.h>
 #include <ff.h>
 
@@ -31,6 +32,7 @@
 
 #include "seq_core.h"
 #include "seq_song.h"
+#include "seq_pattern.h"
 #include "seq_cc.h"
 #include "seq_layer.h"
 #include "seq_par.h"
@@ -48,6 +50,7 @@
 #include "seq_file_gc.h"
 #include "seq_file_bm.h"
 #include "seq_file_hw.h"
+#include "seq_file_ses.h"
 
 #include "seq_ui.h"
 
@@ -188,6 +191,16 @@ s32 SEQ_TERMINAL_Parse(mios32_midi_port_t port, u8 byte)
 	SEQ_TERMINAL_PrintGrooveTemplates(DEBUG_MSG);
       } else if( strcmp(parameter, "memory") == 0 ) {
 	SEQ_TERMINAL_PrintMemoryInfo(DEBUG_MSG);
+      } else if( strcmp(parameter, "clock") == 0 ) {
+	char *arg;
+	if( (arg = strtok_r(NULL, separators, &brkt)) && strcmp(arg, "reset") == 0 ) {
+	  SEQ_BPM_JitterReset();
+	  MUTEX_MIDIOUT_TAKE;
+	  DEBUG_MSG("MIDI Clock jitter statistics have been reset.\n");
+	  MUTEX_MIDIOUT_GIVE;
+	} else {
+	  SEQ_TERMINAL_PrintClockJitter(DEBUG_MSG);
+	}
 #if !defined(MIOS32_FAMILY_EMULATION)
       } else if( strcmp(parameter, "network") == 0 ) {
 	SEQ_TERMINAL_PrintNetworkInfo(DEBUG_MSG);
@@ -224,8 +237,50 @@ s32 SEQ_TERMINAL_Parse(mios32_midi_port_t port, u8 byte)
 	}
 	MUTEX_MIDIOUT_GIVE;
 #endif
+      } else if( strcmp(parameter, "batch") == 0 ) {
+	char *arg;
+	MUTEX_MIDIOUT_TAKE;
+	if( (arg = strtok_r(NULL, separators, &brkt)) ) {
+	  if( strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0 ) {
+	    // the sequencer handler runs with MUTEX_MIDIOUT, so that a roll/echo can't be interrupted
+	    seq_core_batch_send = strcmp(arg, "on") == 0;
+	    // the stopwatch max value should be compared for both settings
+	    SEQ_STATISTICS_StopwatchInit();
+	  } else {
+	    DEBUG_MSG("Please specify \"batch on\" or \"batch off\"\n");
+	  }
+	}
+	DEBUG_MSG("Batched scheduling of Roll/Echo events: %s\n", seq_core_batch_send ? "on" : "off");
+	MUTEX_MIDIOUT_GIVE;
       } else if( strcmp(parameter, "sdcard") == 0 ) {
 	SEQ_TERMINAL_PrintSdCardInfo(DEBUG_MSG);
+      } else if( strcmp(parameter, "session") == 0 ) {
+	char *arg;
+	if( (arg = strtok_r(NULL, separators, &brkt)) && strcmp(arg, "export") == 0 ) {
+	  MUTEX_SDCARD_TAKE;
+	  s32 status = SEQ_FILE_SES_Export(seq_file_session_name);
+	  MUTEX_SDCARD_GIVE;
+	  MUTEX_MIDIOUT_TAKE;
+	  if( status < 0 )
+	    DEBUG_MSG("Export of session '%s' failed with status %d!\n", seq_file_session_name, status);
+	  else
+	    DEBUG_MSG("Session '%s' has been exported into MBSEQ_SE.V4\n", seq_file_session_name);
+	  MUTEX_MIDIOUT_GIVE;
+	} else if( arg && strcmp(arg, "import") == 0 ) {
+	  MUTEX_SDCARD_TAKE;
+	  s32 status = SEQ_FILE_SES_Import(seq_file_session_name);
+	  if( status >= 0 )
+	    SEQ_FILE_LoadAllFiles(0); // excluding HW config
+	  MUTEX_SDCARD_GIVE;
+	  MUTEX_MIDIOUT_TAKE;
+	  if( status < 0 )
+	    DEBUG_MSG("Import of session '%s' failed with status %d!\n", seq_file_session_name, status);
+	  else
+	    DEBUG_MSG("Session '%s' has been restored from MBSEQ_SE.V4\n", seq_file_session_name);
+	  MUTEX_MIDIOUT_GIVE;
+	} else {
+	  SEQ_TERMINAL_PrintSessionContainer(DEBUG_MSG);
+	}
       } else if( strcmp(parameter, "testaoutpin") == 0 ) {
 	char *arg;
 	int pin_number = -1;
@@ -323,7 +378,10 @@ s32 SEQ_TERMINAL_PrintHelp(void *_output_function)
   out("  grooves:        print groove templates\n");
   out("  bookmarks:      print bookmarks\n");
   out("  memory:         print memory allocation info\n");
+  out("  clock [reset]:  print (or reset) jitter histogram of incoming MIDI clock\n");
+  out("  batch [on|off]: batched scheduling of Roll/Echo events (resets the stopwatch)\n");
   out("  sdcard:         print SD Card info\n");
+  out("  session [export|import]: print info about (or create/restore) the session container\n");
 #if !defined(MIOS32_FAMILY_EMULATION)
   out("  network:        print ethernet network info\n");
   out("  udpmon <0..4>:  enables UDP monitor to check OSC packets (current: %d)\n", UIP_TASK_UDP_MonitorLevelGet());
@@ -367,8 +425,10 @@ s32 SEQ_TERMINAL_PrintSystem(void *_output_function)
 
   out("Systime: %02d:%02d:%02d\n", hours, minutes, seconds);
   out("CPU Load: %02d%%\n", SEQ_STATISTICS_CurrentCPULoad());
-  out("MIDI Scheduler: Alloc %3d/%3d Drops: %3d",
+  out("MIDI Scheduler: Alloc %3d/%3d Drops: %3d\n",
 	    seq_midi_out_allocated, seq_midi_out_max_allocated, seq_midi_out_dropouts);
+  out("MIDI Scheduler: ReSchedule visited %3d/%3d items\n",
+	    seq_midi_out_reschedule_visited, seq_midi_out_reschedule_visited_max);
 
   u32 stopwatch_value_max = SEQ_STATISTICS_StopwatchGetValueMax();
   u32 stopwatch_value = SEQ_STATISTICS_StopwatchGetValue();
@@ -393,6 +453,57 @@ s32 SEQ_TERMINAL_PrintSystem(void *_output_function)
 }
 
 
+s32 SEQ_TERMINAL_PrintClockJitter(void *_output_function)
+{
+  void (*out)(char *format, ...) = _output_function;
+  seq_bpm_jitter_t jitter;
+  int bin;
+
+  SEQ_BPM_JitterGet(&jitter);
+
+  MUTEX_MIDIOUT_TAKE;
+
+  out("MIDI Clock Jitter:\n");
+  out("==================\n");
+  out("BPM Mode: %s\n", SEQ_BPM_IsMaster() ? "Master" : "Slave");
+  if( !jitter.clocks ) {
+    out("No timestamped MIDI clock received yet.\n");
+  } else {
+    out("Measured Clocks: %u\n", jitter.clocks);
+    out("Average Interval: %u uS (%d.%d BPM)\n",
+	jitter.period_us, (int)(2500000000ULL / jitter.period_us / 1000),
+	(int)((2500000000ULL / jitter.period_us / 100) % 10));
+    out("Max. Deviation: %u uS\n", jitter.max_us);
+
+    u32 lower_limit = 0;
+    for(bin=0; bin<SEQ_BPM_JITTER_BINS; ++bin) {
+      u32 upper_limit = SEQ_BPM_JitterBinLimitGet(bin);
+      u32 permille = (u32)(((unsigned long long)jitter.bin[bin] * 1000) / jitter.clocks);
+      if( upper_limit == 0xffffffff )
+	out("  > %4u uS: %8u (%3d.%d%%)\n", lower_limit, jitter.bin[bin], permille/10, permille%10);
+      else
+	out("%4u..%4u uS: %8u (%3d.%d%%)\n", lower_limit, upper_limit, jitter.bin[bin], permille/10, permille%10);
+      lower_limit = upper_limit + 1;
+    }
+  }
+
+  seq_bpm_dll_state_t dll;
+  SEQ_BPM_DLL_StateGet(&dll);
+  if( dll.locked ) {
+    u32 dll_bpm = (u32)(dll.bpm * 10);
+    out("DLL: %d.%d BPM, phase error %d uS, jitter %u uS, %u relocks\n",
+	dll_bpm / 10, dll_bpm % 10, dll.phase_error_us, dll.jitter_us, dll.relocks);
+  } else {
+    out("DLL: not locked\n");
+  }
+
+  out("done.\n");
+  MUTEX_MIDIOUT_GIVE;
+
+  return 0; // no error
+}
+
+
 s32 SEQ_TERMINAL_PrintGlobalConfig(void *_output_function)
 {
   void (*out)(char *format, ...) = _output_function;
@@ -573,6 +684,18 @@ s32 SEQ_TERMINAL_PrintCurrentSong(void *_output_function)
   out("Name: '%s'\n", seq_song_name);
   MIOS32_MIDI_SendDebugHexDump((u8 *)&seq_song_steps[0], SEQ_SONG_NUM_STEPS*sizeof(seq_song_step_t));
 
+  {
+    seq_pattern_prefetch_stats_t stats;
+    SEQ_PATTERN_PrefetchStatsGet(&stats);
+
+    out("Pattern Prefetching (%d bytes staging area):\n", SEQ_PATTERN_PREFETCH_BUFFER_SIZE);
+    out("Swaps: %u, Late: %u, Not prefetched: %u\n", stats.swaps, stats.late, stats.missed);
+    if( stats.swaps ) {
+      out("Margin: last %u, min %u, max %u, avg %u ticks\n",
+	  stats.margin_last, stats.margin_min, stats.margin_max, stats.margin_sum / stats.swaps);
+    }
+  }
+
   out("done.\n");
   MUTEX_MIDIOUT_GIVE;
 
@@ -649,6 +772,40 @@ static void ShowFatDate(u32 ThisDate, char* msg)
 }
 
 
+s32 SEQ_TERMINAL_PrintSessionContainer(void *_output_function)
+{
+  void (*out)(char *format, ...) = _output_function;
+
+  MUTEX_MIDIOUT_TAKE;
+
+  out("Session Container\n");
+  out("=================\n");
+
+  if( !SEQ_FILE_SES_Valid() ) {
+    out("MBSEQ_SE.V4 not available in session '%s' - patterns are read from bank files.\n", seq_file_session_name);
+    out("Enter 'session export' to create the container.\n");
+  } else {
+    u8 bank;
+    for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank)
+      out("Bank #%d: read from %s\n", bank+1, SEQ_FILE_SES_BankValid(bank) ? "container" : "bank file");
+
+    u8 section;
+    for(section=0; section<SEQ_FILE_SES_NumSections(); ++section) {
+      seq_file_ses_section_t s;
+      if( SEQ_FILE_SES_SectionGet(section, &s) >= 0 ) {
+	out("Section %c%c%c%c: offset 0x%06x, %7u bytes, %3d items\n",
+	    s.id[0], s.id[1], s.id[2], s.id[3],
+	    (unsigned int)s.offset, (unsigned int)s.size, s.num_items);
+      }
+    }
+  }
+
+  MUTEX_MIDIOUT_GIVE;
+
+  return 0; // no error
+}
+
+
 s32 SEQ_TERMINAL_PrintSdCardInfo(void *_output_function)
 {
   void (*out)(char *format, ...) = _output_function;
@@ -783,6 +940,23 @@ s32 SEQ_TERMINAL_PrintSdCardInfo(void *_output_function)
       out("File /SESSIONS/%s/MBSEQ_HW.V4: doesn't exist or hasn't been re-loaded\n", seq_file_session_name);
   }
 
+  out("\n");
+  out("Read Cache and Write Buffer\n");
+  out("===========================\n");
+
+  {
+    seq_file_cache_stats_t stats;
+    SEQ_FILE_CacheStatsGet(&stats);
+
+    out("Cache: %s (%d lines of %d sectors)\n",
+	SEQ_FILE_CacheEnabled() ? "enabled" : "disabled",
+	SEQ_FILE_CACHE_LINES, SEQ_FILE_CACHE_LINE_SECTORS);
+    out("Hits: %u, Misses: %u, Prefetches: %u, Direct Reads: %u\n",
+	stats.hits, stats.misses, stats.prefetches, stats.direct_reads);
+    out("Writes: %u, Block Transfers: %u\n",
+	stats.writes, stats.write_flushes);
+  }
+
   out("done.\n");
   MUTEX_MIDIOUT_GIVE;
 
@@ -34,6 +34,7 @@ extern s32 SEQ_TERMINAL_Parse(mios32_midi_port_t port, u8 byte);
 
 extern s32 SEQ_TERMINAL_PrintHelp(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintSystem(void *_output_function);
+extern s32 SEQ_TERMINAL_PrintClockJitter(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintGlobalConfig(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintBookmarks(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintSessionConfig(void *_output_function);
@@ -43,6 +44,7 @@ extern s32 SEQ_TERMINAL_PrintCurrentMixerMap(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintCurrentSong(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintGrooveTemplates(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintMemoryInfo(void *_output_function);
+extern s32 SEQ_TERMINAL_PrintSessionContainer(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintSdCardInfo(void *_output_function);
 extern s32 SEQ_TERMINAL_PrintNetworkInfo(void *_output_function);
 extern s32 SEQ_TERMINAL_TestAoutPin(void *_output_function, u8 pin_number, u8 level);
@@ -0,0 +1,379 @@
+// $Id$
+/*
+ * Host test of the SEQ_FILE read cache and write buffer
+ *
+ * A session with different data in each pattern slot is stored into a new
+ * SD Card image, and all patterns of all banks are loaded thereafter
+ * (like on pattern changes), followed by pattern name lookups (like in the
+ * pattern page) and alternating pattern changes.
+ *
+ * Each step is executed with disabled and enabled cache. The number of
+ * sector reads/writes is reported, and the loaded patterns have to be
+ * identical.
+ *
+ * Usage: seq_bank_load_test [<image-file>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+#include <ff.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "seq_core.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_mixer.h"
+#include "seq_pattern.h"
+#include "seq_file.h"
+#include "seq_file_b.h"
+
+#include "host_stubs.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_IMAGE_FILE    "bankload.img"
+
+#define IMAGE_SECTORS         (32*1024*1024/512) // 32 MB
+
+#define NUM_PATTERNS          64 // per bank, as created by SEQ_FILE_B_Create()
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static int errors;
+
+// checksums of the patterns loaded w/o cache
+static u32 pattern_checksum[SEQ_FILE_B_NUM_BANKS][NUM_PATTERNS];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// The BPM generator isn't used by this test
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_Init(u32 mode) { return 0; }
+seq_bpm_mode_t SEQ_BPM_ModeGet(void) { return SEQ_BPM_MODE_Master; }
+s32 SEQ_BPM_ModeSet(seq_bpm_mode_t mode) { return 0; }
+float SEQ_BPM_Get(void) { return 120.0; }
+s32 SEQ_BPM_Set(float bpm) { return 0; }
+s32 SEQ_BPM_PPQN_Get(void) { return 384; }
+s32 SEQ_BPM_PPQN_Set(u16 ppqn) { return 0; }
+u32 SEQ_BPM_TickGet(void) { return 0; }
+s32 SEQ_BPM_TickSet(u32 tick) { return 0; }
+s32 SEQ_BPM_IsRunning(void) { return 0; }
+s32 SEQ_BPM_IsMaster(void) { return 1; }
+s32 SEQ_BPM_Start(void) { return 0; }
+s32 SEQ_BPM_Cont(void) { return 0; }
+s32 SEQ_BPM_Stop(void) { return 0; }
+s32 SEQ_BPM_ChkReqStop(void) { return 0; }
+s32 SEQ_BPM_ChkReqCont(void) { return 0; }
+s32 SEQ_BPM_ChkReqSongPos(u16 *song_pos) { return 0; }
+s32 SEQ_BPM_ChkReqStart(void) { return 0; }
+s32 SEQ_BPM_ChkReqClk(u32 *bpm_tick_ptr) { *bpm_tick_ptr = 0; return 0; }
+u32 SEQ_BPM_TicksFor_mS(u16 time_ms) { return ((u32)time_ms * 384 * 120) / 60000; }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(u8 condition, const char *format, int value)
+{
+  if( !condition ) {
+    printf("ERROR: ");
+    printf(format, value);
+    printf("\n");
+    ++errors;
+  }
+}
+
+// fills the tracks of a group with data which is unique for each pattern slot
+static void PatternFill(u8 group, u8 bank, u8 pattern)
+{
+  u8 track;
+  int i;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    for(i=0; i<SEQ_PAR_MAX_BYTES; ++i)
+      seq_par_layer_value[track][i] = (u8)(i*7 + track*13 + bank*31 + pattern*17);
+    for(i=0; i<SEQ_TRG_MAX_BYTES; ++i)
+      seq_trg_layer_value[track][i] = (u8)(i*3 + track*5 + bank*11 + pattern*19);
+  }
+
+  sprintf(seq_pattern_name[group], "Bank %d Pattern %02d  ", bank+1, pattern+1);
+}
+
+// clears the tracks of a group, so that a loaded pattern doesn't contain old data
+static void PatternClear(u8 group)
+{
+  u8 track;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    memset(seq_par_layer_value[track], 0, SEQ_PAR_MAX_BYTES);
+    memset(seq_trg_layer_value[track], 0, SEQ_TRG_MAX_BYTES);
+  }
+  memset(seq_pattern_name[group], 0, 21);
+}
+
+static u32 PatternChecksum(u8 group)
+{
+  u32 checksum = 0;
+  u8 track;
+  int i;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    for(i=0; i<SEQ_PAR_MAX_BYTES; ++i)
+      checksum = checksum * 31 + seq_par_layer_value[track][i];
+    for(i=0; i<SEQ_TRG_MAX_BYTES; ++i)
+      checksum = checksum * 31 + seq_trg_layer_value[track][i];
+  }
+  for(i=0; i<20; ++i)
+    checksum = checksum * 31 + seq_pattern_name[group][i];
+
+  return checksum;
+}
+
+static void StatsPrint(const char *name, u8 cached)
+{
+  host_sdcard_stats_t stats;
+  HOST_SDCARD_StatsGet(&stats);
+
+  printf("%-26s %-9s %5u reads (%6u sectors), %5u writes (%6u sectors)\n",
+	 name, cached ? "cached:" : "uncached:",
+	 stats.read_commands, stats.sectors_read, stats.write_commands, stats.sectors_written);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates a session and stores all patterns
+// returns the number of written sectors
+/////////////////////////////////////////////////////////////////////////////
+static u32 SessionStore(char *session, u8 cached)
+{
+  char path[30];
+  s32 status;
+  u8 bank, pattern;
+
+  SEQ_FILE_CacheEnable(cached);
+
+  sprintf(path, "%s/%s", SEQ_FILE_SESSION_PATH, session);
+  SEQ_FILE_MakeDir(path);
+
+  strcpy(seq_file_new_session_name, session);
+  if( (status=SEQ_FILE_Format()) < 0 ) {
+    Check(0, "failed to create session (status %d)", status);
+    return 0;
+  }
+
+  HOST_SDCARD_StatsReset();
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    u8 group = bank % SEQ_CORE_NUM_GROUPS;
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      PatternFill(group, bank, pattern);
+      if( (status=SEQ_FILE_B_PatternWrite(session, bank, pattern, group, 0)) < 0 )
+	Check(0, "failed to store pattern (status %d)", status);
+    }
+  }
+  StatsPrint("Store all patterns", cached);
+
+  host_sdcard_stats_t stats;
+  HOST_SDCARD_StatsGet(&stats);
+  return stats.sectors_written;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads all patterns of all banks, looks up all pattern names and switches
+// between two patterns
+// returns the number of read sectors
+/////////////////////////////////////////////////////////////////////////////
+static u32 SessionLoad(char *session, u8 cached)
+{
+  s32 status;
+  u8 bank, pattern;
+  u32 sectors_read = 0;
+  host_sdcard_stats_t stats;
+
+  SEQ_FILE_CacheEnable(cached);
+
+  // load all patterns
+  HOST_SDCARD_StatsReset();
+  SEQ_FILE_B_LoadAllBanks(session);
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    u8 group = bank % SEQ_CORE_NUM_GROUPS;
+    Check(SEQ_FILE_B_NumPatterns(bank) == NUM_PATTERNS, "bank %d not available", bank+1);
+
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      PatternClear(group);
+      if( (status=SEQ_FILE_B_PatternRead(bank, pattern, group)) < 0 )
+	Check(0, "failed to load pattern (status %d)", status);
+
+      char name[21];
+      sprintf(name, "Bank %d Pattern %02d  ", bank+1, pattern+1);
+      if( strncmp(seq_pattern_name[group], name, 20) != 0 )
+	Check(0, "pattern %d: wrong data has been loaded", bank*NUM_PATTERNS + pattern);
+
+      u32 checksum = PatternChecksum(group);
+      if( !cached )
+	pattern_checksum[bank][pattern] = checksum;
+      else if( checksum != pattern_checksum[bank][pattern] )
+	Check(0, "pattern %d: data differs from uncached read", bank*NUM_PATTERNS + pattern);
+    }
+  }
+  StatsPrint("Load all patterns", cached);
+  HOST_SDCARD_StatsGet(&stats);
+  sectors_read += stats.sectors_read;
+
+  // pattern names of all banks
+  HOST_SDCARD_StatsReset();
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      char name[21];
+      char expected_name[21];
+      SEQ_FILE_B_PatternPeekName(bank, pattern, 1, name);
+      sprintf(expected_name, "Bank %d Pattern %02d  ", bank+1, pattern+1);
+      if( strncmp(name, expected_name, 20) != 0 )
+	Check(0, "pattern %d: wrong name", bank*NUM_PATTERNS + pattern);
+    }
+  }
+  StatsPrint("Peek all pattern names", cached);
+  HOST_SDCARD_StatsGet(&stats);
+  sectors_read += stats.sectors_read;
+
+  // alternating pattern changes
+  HOST_SDCARD_StatsReset();
+  for(pattern=0; pattern<32; ++pattern) {
+    u8 bank = 0;
+    u8 group = 0;
+    u8 alt_pattern = (pattern & 1) ? 1 : 0;
+    PatternClear(group);
+    if( (status=SEQ_FILE_B_PatternRead(bank, alt_pattern, group)) < 0 )
+      Check(0, "failed to load pattern (status %d)", status);
+    Check(PatternChecksum(group) == pattern_checksum[bank][alt_pattern], "alternating pattern %d: data differs", alt_pattern);
+  }
+  StatsPrint("Alternating patterns", cached);
+  HOST_SDCARD_StatsGet(&stats);
+  sectors_read += stats.sectors_read;
+
+  return sectors_read;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Compares two files byte by byte
+/////////////////////////////////////////////////////////////////////////////
+static s32 FileCompare(char *path1, char *path2)
+{
+  static FIL fil1, fil2;
+  static u8 buffer1[512], buffer2[512];
+  UINT count1, count2;
+
+  if( f_open(&fil1, path1, FA_OPEN_EXISTING | FA_READ) != FR_OK ||
+      f_open(&fil2, path2, FA_OPEN_EXISTING | FA_READ) != FR_OK )
+    return -1; // file not found
+
+  if( fil1.fsize != fil2.fsize )
+    return -2; // different size
+
+  do {
+    if( f_read(&fil1, buffer1, sizeof(buffer1), &count1) != FR_OK ||
+	f_read(&fil2, buffer2, sizeof(buffer2), &count2) != FR_OK )
+      return -3; // read error
+    if( count1 != count2 || memcmp(buffer1, buffer2, count1) != 0 )
+      return -4; // different content
+  } while( count1 );
+
+  return 0; // files are identical
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  char *image_file = (argc >= 2) ? argv[1] : DEFAULT_IMAGE_FILE;
+  s32 status;
+  u8 bank;
+
+  SEQ_MIXER_Init(0);
+  SEQ_CORE_Init(0);
+  SEQ_FILE_Init(0);
+
+  // always start with a new image
+  remove(image_file);
+  if( (status=HOST_SDCARD_ImageOpen(image_file, IMAGE_SECTORS)) < 0 ) {
+    printf("ERROR: can't create image file %s (status %d)\n", image_file, status);
+    return 1;
+  }
+
+  {
+    FATFS fs;
+    FRESULT res;
+    if( (res=f_mount(0, &fs)) != FR_OK || (res=f_mkfs(0, 0, 0)) != FR_OK ) {
+      printf("ERROR: failed to format image (status %d)\n", res);
+      return 1;
+    }
+    f_mount(0, NULL);
+  }
+
+  if( SEQ_FILE_CheckSDCard() < 0 || !SEQ_FILE_VolumeAvailable() ) {
+    printf("ERROR: failed to mount new image\n");
+    return 1;
+  }
+  SEQ_FILE_MakeDir(SEQ_FILE_SESSION_PATH);
+
+  printf("Cache: %d lines of %d sectors, write buffer: %d bytes\n",
+	 SEQ_FILE_CACHE_LINES, SEQ_FILE_CACHE_LINE_SECTORS, SEQ_FILE_WRITE_BUFFER_SIZE);
+
+  // store
+  u32 written_uncached = SessionStore("UNCACHED", 0);
+  u32 written_cached = SessionStore("CACHED", 1);
+
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    char path1[40];
+    char path2[40];
+    sprintf(path1, "%s/UNCACHED/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, bank+1);
+    sprintf(path2, "%s/CACHED/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, bank+1);
+    Check(FileCompare(path1, path2) == 0, "bank %d: files stored with/without cache differ", bank+1);
+  }
+
+  // load
+  u32 read_uncached = SessionLoad("CACHED", 0);
+  u32 read_cached = SessionLoad("CACHED", 1);
+
+  seq_file_cache_stats_t stats;
+  SEQ_FILE_CacheStatsGet(&stats);
+  printf("Cache statistics: %u hits, %u misses, %u prefetches, %u direct reads, %u writes, %u block transfers\n",
+	 stats.hits, stats.misses, stats.prefetches, stats.direct_reads, stats.writes, stats.write_flushes);
+
+  printf("Sector reads:  %u before, %u after (%.1f%%)\n",
+	 read_uncached, read_cached, read_uncached ? 100.0 * read_cached / read_uncached : 0.0);
+  printf("Sector writes: %u before, %u after\n", written_uncached, written_cached);
+
+  Check(read_cached < read_uncached, "cache doesn't reduce the number of sector reads%c", ' ');
+  Check(written_cached <= written_uncached, "write buffer increases the number of sector writes%c", ' ');
+
+  HOST_SDCARD_ImageClose();
+
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+
+  return errors ? 1 : 0;
+}
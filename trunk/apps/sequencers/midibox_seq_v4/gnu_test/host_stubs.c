@@ -0,0 +1,445 @@
+// $Id$
+/*
+ * Host stubs for the MBSEQ V4 tick benchmark
+ * Provides the MIOS32 functions used by the core modules, a SD Card
+ * which is emulated by an image file, and dummies for all UI/MIDI-In/Router
+ * functions which are not part of the benchmark
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "tasks.h"
+#include "seq_core.h"
+#include "seq_ui.h"
+#include "seq_record.h"
+#include "seq_midi_in.h"
+#include "seq_midi_port.h"
+#include "seq_midi_router.h"
+#include "seq_midply.h"
+#include "seq_midexp.h"
+#include "seq_midimp.h"
+#include "seq_cv.h"
+#include "seq_statistics.h"
+#include "seq_file_m.h"
+#include "seq_file_s.h"
+#include "seq_file_g.h"
+#include "seq_file_c.h"
+#include "seq_file_gc.h"
+#include "seq_file_t.h"
+#include "seq_file_bm.h"
+#include "seq_file_hw.h"
+
+#include "host_stubs.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static FILE *sdcard_image;
+static u32 sdcard_image_sectors;
+
+static u32 midi_packages;
+static u32 midi_checksum;
+
+static host_sdcard_stats_t sdcard_stats;
+
+static unsigned long long stopwatch_start;
+static u32 stopwatch_value;
+static u32 stopwatch_value_max;
+static unsigned long long stopwatch_sum;
+static u32 stopwatch_captures;
+
+static u8 pattern_task_resumed;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SD Card emulation: the image file is accessed like a SD Card with
+// 512 byte sectors. A new image will be created if the file doesn't exist.
+// returns < 0 on errors
+// returns 1 if a new image has been created
+/////////////////////////////////////////////////////////////////////////////
+s32 HOST_SDCARD_ImageOpen(char *filename, u32 num_sectors)
+{
+  s32 created = 0;
+
+  if( (sdcard_image=fopen(filename, "r+b")) == NULL ) {
+    if( (sdcard_image=fopen(filename, "w+b")) == NULL )
+      return -1; // file can't be created
+
+    // allocate the complete image
+    if( fseek(sdcard_image, num_sectors*512 - 1, SEEK_SET) != 0 || fputc(0, sdcard_image) == EOF )
+      return -2; // image can't be allocated
+    created = 1;
+  }
+
+  fseek(sdcard_image, 0, SEEK_END);
+  sdcard_image_sectors = ftell(sdcard_image) / 512;
+
+  return created;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Number of sector accesses
+/////////////////////////////////////////////////////////////////////////////
+s32 HOST_SDCARD_StatsGet(host_sdcard_stats_t *stats)
+{
+  *stats = sdcard_stats;
+  return 0; // no error
+}
+
+s32 HOST_SDCARD_StatsReset(void)
+{
+  memset(&sdcard_stats, 0, sizeof(host_sdcard_stats_t));
+  return 0; // no error
+}
+
+s32 HOST_SDCARD_ImageClose(void)
+{
+  if( sdcard_image != NULL ) {
+    fclose(sdcard_image);
+    sdcard_image = NULL;
+  }
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_Init(u32 mode)
+{
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_CheckAvailable(u8 was_available)
+{
+  return sdcard_image != NULL;
+}
+
+s32 MIOS32_SDCARD_SectorRead(u32 sector, u8 *buffer)
+{
+  if( sdcard_image == NULL || sector >= sdcard_image_sectors )
+    return -256; // no card/sector not available
+
+  if( fseek(sdcard_image, sector*512, SEEK_SET) != 0 ||
+      fread(buffer, 1, 512, sdcard_image) != 512 )
+    return -257; // read error
+
+  ++sdcard_stats.read_commands;
+  ++sdcard_stats.sectors_read;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_SectorWrite(u32 sector, u8 *buffer)
+{
+  if( sdcard_image == NULL || sector >= sdcard_image_sectors )
+    return -256; // no card/sector not available
+
+  if( fseek(sdcard_image, sector*512, SEEK_SET) != 0 ||
+      fwrite(buffer, 1, 512, sdcard_image) != 512 )
+    return -257; // write error
+
+  ++sdcard_stats.write_commands;
+  ++sdcard_stats.sectors_written;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_SectorsRead(u32 sector, u8 *buffer, u32 count)
+{
+  if( sdcard_image == NULL || (sector + count) > sdcard_image_sectors )
+    return -256; // no card/sector not available
+
+  if( fseek(sdcard_image, sector*512, SEEK_SET) != 0 ||
+      fread(buffer, 512, count, sdcard_image) != count )
+    return -257; // read error
+
+  ++sdcard_stats.read_commands;
+  sdcard_stats.sectors_read += count;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_SectorsWrite(u32 sector, u8 *buffer, u32 count)
+{
+  if( sdcard_image == NULL || (sector + count) > sdcard_image_sectors )
+    return -256; // no card/sector not available
+
+  if( fseek(sdcard_image, sector*512, SEEK_SET) != 0 ||
+      fwrite(buffer, 512, count, sdcard_image) != count )
+    return -257; // write error
+
+  ++sdcard_stats.write_commands;
+  sdcard_stats.sectors_written += count;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_CIDRead(mios32_sdcard_cid_t *cid)
+{
+  memset(cid, 0, sizeof(mios32_sdcard_cid_t));
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_CSDRead(mios32_sdcard_csd_t *csd)
+{
+  // SD V2 format: number of sectors = (DeviceSize+1) * 1024
+  memset(csd, 0, sizeof(mios32_sdcard_csd_t));
+  csd->CSDStruct = 1;
+  csd->DeviceSize = (sdcard_image_sectors / 1024) - 1;
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIDI output: counts the packages and calculates a checksum over the
+// output order, so that the results of different builds can be compared
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  ++midi_packages;
+  midi_checksum = ((midi_checksum << 5) | (midi_checksum >> 27)) ^ (package.ALL + port);
+  return 0; // no error
+}
+
+s32 MIOS32_MIDI_SendCC(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 cc, u8 val)
+{
+  mios32_midi_package_t package;
+  package.type = CC;
+  package.evnt0 = CC | chn;
+  package.evnt1 = cc;
+  package.evnt2 = val;
+  return MIOS32_MIDI_SendPackage(port, package);
+}
+
+s32 MIOS32_MIDI_SendProgramChange(mios32_midi_port_t port, mios32_midi_chn_t chn, u8 prg)
+{
+  mios32_midi_package_t package;
+  package.type = ProgramChange;
+  package.evnt0 = ProgramChange | chn;
+  package.evnt1 = prg;
+  package.evnt2 = 0x00;
+  return MIOS32_MIDI_SendPackage(port, package);
+}
+
+s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+  return 0; // no error
+}
+
+s32 MIOS32_MIDI_SendDebugMessage(char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+
+  return 0; // no error
+}
+
+u32 HOST_MIDI_PackagesGet(void)
+{
+  return midi_packages;
+}
+
+u32 HOST_MIDI_ChecksumGet(void)
+{
+  return midi_checksum;
+}
+
+s32 HOST_MIDI_Reset(void)
+{
+  midi_packages = 0;
+  midi_checksum = 0;
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Other MIOS32 functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_IRQ_Disable(void) { return 0; }
+s32 MIOS32_IRQ_Enable(void) { return 0; }
+s32 MIOS32_TIMER_Init(u8 timer, u32 period, void *_irq_handler, u8 irq_priority) { return 0; }
+s32 MIOS32_TIMER_ReInit(u8 timer, u32 period) { return 0; }
+
+void TASKS_SDCardSemaphoreTake(void) {}
+void TASKS_SDCardSemaphoreGive(void) {}
+void TASKS_MIDIOUTSemaphoreTake(void) {}
+void TASKS_MIDIOUTSemaphoreGive(void) {}
+
+// the pattern task is emulated by the test, which calls SEQ_PATTERN_Handler()
+// between the ticks once it has been resumed
+void SEQ_TASK_PatternResume(void)
+{
+  pattern_task_resumed = 1;
+}
+
+s32 HOST_TASK_PatternResumed(void)
+{
+  s32 resumed = pattern_task_resumed;
+  pattern_task_resumed = 0;
+  return resumed;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// UI
+/////////////////////////////////////////////////////////////////////////////
+seq_ui_page_t ui_page;
+u8 ui_seq_pause;
+u8 ui_selected_step_view;
+u8 seq_ui_display_update_req;
+seq_ui_button_state_t seq_ui_button_state;
+
+s32 SEQ_UI_SDCardErrMsg(u16 delay, s32 status) { return 0; }
+s32 SEQ_UI_IsSelectedTrack(u8 track) { return track == 0; }
+u8  SEQ_UI_VisibleTrackGet(void) { return 0; }
+s32 SEQ_UI_SONG_EditPosSet(u8 new_edit_pos) { return 0; }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIDI In/Router/Port/CV
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_MIDI_IN_BusReceive(mios32_midi_port_t port, mios32_midi_package_t midi_package, u8 from_loopback_port) { return 0; }
+s32 SEQ_MIDI_IN_TransposerNoteGet(u8 bus, u8 hold) { return 0x3c; } // C-3
+s32 SEQ_MIDI_IN_ArpNoteGet(u8 bus, u8 hold, u8 sorted, u8 key_num) { return 0; }
+s32 SEQ_MIDI_ROUTER_SendMIDIClockEvent(u8 evnt0, u32 bpm_tick) { return 0; }
+s32 SEQ_MIDI_PORT_OutMuteGet(mios32_midi_port_t port) { return 0; }
+u16 SEQ_CV_ClkDividerGet(void) { return 16; } // DIN Sync: 24 ppqn
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Recording, MIDI file player/exporter/importer
+/////////////////////////////////////////////////////////////////////////////
+seq_record_options_t seq_record_options;
+
+s32 SEQ_RECORD_Init(u32 mode) { return 0; }
+s32 SEQ_RECORD_Reset(u8 track) { return 0; }
+s32 SEQ_RECORD_NewStep(u8 track, u8 prev_step, u8 new_step, u32 bpm_tick) { return 0; }
+
+s32 SEQ_MIDPLY_Init(u32 mode) { return 0; }
+s32 SEQ_MIDPLY_Reset(void) { return 0; }
+s32 SEQ_MIDPLY_Tick(u32 bpm_tick) { return 0; }
+s32 SEQ_MIDPLY_SongPos(u16 new_song_pos, u8 from_midi) { return 0; }
+s32 SEQ_MIDPLY_RunModeGet(void) { return 0; }
+s32 SEQ_MIDPLY_PlayOffEvents(void) { return 0; }
+seq_midply_mode_t SEQ_MIDPLY_ModeGet(void) { return SEQ_MIDPLY_MODE_Parallel; }
+s32 SEQ_MIDEXP_Init(u32 mode) { return 0; }
+s32 SEQ_MIDIMP_Init(u32 mode) { return 0; }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Statistics: the stopwatch measures the tick handler like on the core,
+// but with nS resolution (the host is much faster)
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long StopwatchTimeGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+s32 SEQ_STATISTICS_StopwatchInit(void)
+{
+  stopwatch_value = 0;
+  stopwatch_value_max = 0;
+  stopwatch_sum = 0;
+  stopwatch_captures = 0;
+  return 0; // no error
+}
+
+s32 SEQ_STATISTICS_StopwatchReset(void)
+{
+  stopwatch_start = StopwatchTimeGet();
+  return 0; // no error
+}
+
+s32 SEQ_STATISTICS_StopwatchCapture(void)
+{
+  stopwatch_value = (u32)(StopwatchTimeGet() - stopwatch_start);
+  if( stopwatch_value > stopwatch_value_max )
+    stopwatch_value_max = stopwatch_value;
+  stopwatch_sum += stopwatch_value;
+  ++stopwatch_captures;
+  return 0; // no error
+}
+
+u32 SEQ_STATISTICS_StopwatchGetValue(void)
+{
+  return stopwatch_value;
+}
+
+u32 SEQ_STATISTICS_StopwatchGetValueMax(void)
+{
+  return stopwatch_value_max;
+}
+
+u32 HOST_STOPWATCH_AverageGet(void)
+{
+  return stopwatch_captures ? (u32)(stopwatch_sum / stopwatch_captures) : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Files which are not part of the benchmark
+// (only the pattern banks are loaded from the session)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_FILE_M_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_M_LoadAllBanks(char *session) { return 0; }
+s32 SEQ_FILE_M_UnloadAllBanks(void) { return 0; }
+s32 SEQ_FILE_M_NumMaps(void) { return 0; }
+s32 SEQ_FILE_M_Create(char *session) { return -1; }
+s32 SEQ_FILE_M_Open(char *session) { return -1; }
+s32 SEQ_FILE_M_MapRead(u8 map) { return -1; }
+s32 SEQ_FILE_M_MapWrite(char *session, u8 map, u8 rename_if_empty_name) { return -1; }
+
+s32 SEQ_FILE_S_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_S_LoadAllBanks(char *session) { return 0; }
+s32 SEQ_FILE_S_UnloadAllBanks(void) { return 0; }
+s32 SEQ_FILE_S_NumSongs(void) { return 0; }
+s32 SEQ_FILE_S_Create(char *session) { return -1; }
+s32 SEQ_FILE_S_Open(char *session) { return -1; }
+s32 SEQ_FILE_S_SongRead(u8 song) { return -1; }
+s32 SEQ_FILE_S_SongWrite(char *session, u8 song, u8 rename_if_empty_name) { return -1; }
+
+s32 SEQ_FILE_G_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_G_Load(char *session) { return 0; }
+s32 SEQ_FILE_G_Unload(void) { return 0; }
+s32 SEQ_FILE_G_Write(char *session) { return 0; }
+
+s32 SEQ_FILE_C_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_C_Load(char *session) { return -1; } // no config: keep the patterns of the session
+s32 SEQ_FILE_C_Unload(void) { return 0; }
+s32 SEQ_FILE_C_Write(char *session) { return 0; }
+
+s32 SEQ_FILE_GC_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_GC_Load(void) { return 0; }
+s32 SEQ_FILE_GC_Unload(void) { return 0; }
+
+s32 SEQ_FILE_T_Init(u32 mode) { return 0; }
+
+s32 SEQ_FILE_BM_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_BM_Load(char *session, u8 global) { return 0; }
+s32 SEQ_FILE_BM_Unload(u8 global) { return 0; }
+s32 SEQ_FILE_BM_Write(char *session, u8 global) { return 0; }
+
+s32 SEQ_FILE_HW_Init(u32 mode) { return 0; }
+s32 SEQ_FILE_HW_Load(void) { return 0; }
+s32 SEQ_FILE_HW_Unload(void) { return 0; }
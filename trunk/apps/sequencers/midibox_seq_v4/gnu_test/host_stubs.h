@@ -0,0 +1,56 @@
+// $Id$
+/*
+ * Header file for the host stubs of the MBSEQ V4 tick benchmark
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _HOST_STUBS_H
+#define _HOST_STUBS_H
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  u32 read_commands;   // single and multi sector reads
+  u32 sectors_read;
+  u32 write_commands;  // single and multi sector writes
+  u32 sectors_written;
+} host_sdcard_stats_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 HOST_SDCARD_ImageOpen(char *filename, u32 num_sectors);
+extern s32 HOST_SDCARD_ImageClose(void);
+extern s32 HOST_SDCARD_StatsGet(host_sdcard_stats_t *stats);
+extern s32 HOST_SDCARD_StatsReset(void);
+
+extern u32 HOST_MIDI_PackagesGet(void);
+extern u32 HOST_MIDI_ChecksumGet(void);
+extern s32 HOST_MIDI_Reset(void);
+
+extern s32 HOST_TASK_PatternResumed(void);
+
+extern u32 HOST_STOPWATCH_AverageGet(void);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+#endif /* _HOST_STUBS_H */
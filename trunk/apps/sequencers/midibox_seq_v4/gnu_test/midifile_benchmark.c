@@ -0,0 +1,605 @@
+// $Id$
+/*
+ * Host benchmark of the MIDI file parser (modules/midifile)
+ *
+ * A large Type 1 MIDI file with MID_PARSER_MAX_TRACKS tracks (notes, CCs,
+ * Pitchbends, SysEx, Escaped and Meta events, running status, long delta
+ * times) is written into a new SD Card image. Thereafter the file is played
+ * like by SEQ_MIDPLY: the file callbacks access the file via SEQ_FILE, and
+ * MID_PARSER_FetchEvents() is called for small time frames.
+ *
+ * The events received by the callbacks are compared with the generated
+ * events (checksum for each track), once with the SysEx chunk callback and
+ * once with bytewise forwarding of SysEx data.
+ *
+ * Usage: seq_midifile_benchmark [<image-file> [<passes>]]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+#include <ff.h>
+#include <mid_parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "seq_file.h"
+
+#include "host_stubs.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_IMAGE_FILE    "midifile.img"
+#define DEFAULT_PASSES        4
+
+#define IMAGE_SECTORS         (32*1024*1024/512) // 32 MB
+
+#define MIDIFILE_PATH         "/BENCH.MID"
+
+#define NUM_TRACKS            MID_PARSER_MAX_TRACKS // track 0 is the conductor track
+#define PPQN                  384
+#define NUM_BARS              64
+#define STEPS_PER_BAR         16
+#define STEP_TICKS            (PPQN/4)
+
+// ticks fetched with each MID_PARSER_FetchEvents() call
+// (SEQ_MIDPLY prefetches 50 mS, which are 38 ticks @120 BPM)
+#define FETCH_TICKS           38
+
+// max. size of a generated track
+#define TRACK_BUFFER_SIZE     (64*1024)
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  u32 read_calls;
+  u32 seek_calls;
+  u32 bytes_read;
+  u32 event_calls;
+  u32 meta_calls;
+  u32 sysex_calls;
+} callback_stats_t;
+
+typedef struct {
+  u8  *buffer;
+  u32 len;
+  u32 tick;
+  u8  running_status;
+} track_writer_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static int errors;
+
+static seq_file_t midifile_fi;
+static u32 midifile_pos;
+static u32 midifile_len;
+
+static callback_stats_t stats;
+
+// checksums over the events of each track
+static u32 expected_checksum[NUM_TRACKS];
+static u32 received_checksum[NUM_TRACKS];
+
+// number of events in file (without SysEx data bytes)
+static u32 num_events;
+
+// file accesses of the previous (unbuffered) implementation, derived from
+// its access pattern: one seek per event, one read per byte (meta data: one read)
+static u32 unbuffered_seek_calls;
+static u32 unbuffered_read_calls;
+
+static u8 track_buffer[TRACK_BUFFER_SIZE];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// The BPM generator isn't used by this benchmark
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_Init(u32 mode) { return 0; }
+seq_bpm_mode_t SEQ_BPM_ModeGet(void) { return SEQ_BPM_MODE_Master; }
+s32 SEQ_BPM_ModeSet(seq_bpm_mode_t mode) { return 0; }
+float SEQ_BPM_Get(void) { return 120.0; }
+s32 SEQ_BPM_Set(float bpm) { return 0; }
+s32 SEQ_BPM_PPQN_Get(void) { return 384; }
+s32 SEQ_BPM_PPQN_Set(u16 ppqn) { return 0; }
+u32 SEQ_BPM_TickGet(void) { return 0; }
+s32 SEQ_BPM_TickSet(u32 tick) { return 0; }
+s32 SEQ_BPM_IsRunning(void) { return 0; }
+s32 SEQ_BPM_IsMaster(void) { return 1; }
+s32 SEQ_BPM_Start(void) { return 0; }
+s32 SEQ_BPM_Cont(void) { return 0; }
+s32 SEQ_BPM_Stop(void) { return 0; }
+s32 SEQ_BPM_ChkReqStop(void) { return 0; }
+s32 SEQ_BPM_ChkReqCont(void) { return 0; }
+s32 SEQ_BPM_ChkReqSongPos(u16 *song_pos) { return 0; }
+s32 SEQ_BPM_ChkReqStart(void) { return 0; }
+s32 SEQ_BPM_ChkReqClk(u32 *bpm_tick_ptr) { *bpm_tick_ptr = 0; return 0; }
+u32 SEQ_BPM_TicksFor_mS(u16 time_ms) { return ((u32)time_ms * 384 * 120) / 60000; }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(u8 condition, const char *format, int value)
+{
+  if( !condition ) {
+    printf("ERROR: ");
+    printf(format, value);
+    printf("\n");
+    ++errors;
+  }
+}
+
+static unsigned long long TimeGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// FNV-1a
+static u32 HashByte(u32 hash, u8 byte)
+{
+  return (hash ^ byte) * 16777619;
+}
+
+static u32 HashTick(u32 hash, u32 tick)
+{
+  hash = HashByte(hash, tick >> 24);
+  hash = HashByte(hash, tick >> 16);
+  hash = HashByte(hash, tick >> 8);
+  return HashByte(hash, tick);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIDI file generator
+/////////////////////////////////////////////////////////////////////////////
+static void WriteByte(track_writer_t *w, u8 byte)
+{
+  if( w->len < TRACK_BUFFER_SIZE )
+    w->buffer[w->len++] = byte;
+}
+
+static u32 WriteVarLen(track_writer_t *w, u32 value)
+{
+  u8 bytes[4];
+  int num = 0;
+
+  do {
+    bytes[num++] = value & 0x7f;
+    value >>= 7;
+  } while( value && num < 4 );
+
+  int i;
+  for(i=num-1; i>=0; --i)
+    WriteByte(w, bytes[i] | (i ? 0x80 : 0x00));
+
+  return num;
+}
+
+static void WriteDelta(track_writer_t *w, u32 delta)
+{
+  u32 num = WriteVarLen(w, delta);
+  w->tick += delta;
+
+  if( w->len > num ) // the first delta is read by MID_PARSER_Read()
+    unbuffered_read_calls += num;
+}
+
+static void WriteEvent(track_writer_t *w, u8 track, u32 delta, u8 evnt0, u8 evnt1, u8 evnt2)
+{
+  WriteDelta(w, delta);
+
+  u8 num_bytes = ((evnt0 & 0xf0) == 0xc0 || (evnt0 & 0xf0) == 0xd0) ? 2 : 3;
+
+  if( evnt0 != w->running_status ) {
+    WriteByte(w, evnt0);
+    w->running_status = evnt0;
+    unbuffered_read_calls += 1;
+  }
+  WriteByte(w, evnt1);
+  if( num_bytes == 3 )
+    WriteByte(w, evnt2);
+  unbuffered_read_calls += num_bytes - 1;
+  ++unbuffered_seek_calls;
+  ++num_events;
+
+  u32 *hash = &expected_checksum[track];
+  *hash = HashTick(*hash, w->tick);
+  *hash = HashByte(*hash, evnt0);
+  *hash = HashByte(*hash, evnt1);
+  if( num_bytes == 3 )
+    *hash = HashByte(*hash, evnt2);
+}
+
+static void WriteMeta(track_writer_t *w, u8 track, u32 delta, u8 meta, u32 len, u8 *data)
+{
+  WriteDelta(w, delta);
+
+  WriteByte(w, 0xff);
+  WriteByte(w, meta);
+  unbuffered_read_calls += 2 + WriteVarLen(w, len);
+  int i;
+  for(i=0; i<len; ++i)
+    WriteByte(w, data[i]);
+  w->running_status = 0; // running status is cancelled by meta events
+  ++unbuffered_seek_calls;
+  ++num_events;
+
+  u32 buflen = (len > (MID_PARSER_META_BUFFER_SIZE-1)) ? (MID_PARSER_META_BUFFER_SIZE-1) : len;
+  if( buflen )
+    unbuffered_read_calls += 1 + (len - buflen);
+
+  u32 *hash = &expected_checksum[track];
+  *hash = HashTick(*hash, w->tick);
+  *hash = HashByte(*hash, meta);
+  *hash = HashTick(*hash, buflen);
+  for(i=0; i<buflen; ++i)
+    *hash = HashByte(*hash, data[i]);
+}
+
+static void WriteSysEx(track_writer_t *w, u8 track, u32 delta, u8 event, u32 len, u32 seed)
+{
+  WriteDelta(w, delta);
+
+  WriteByte(w, event);
+  unbuffered_read_calls += 1 + WriteVarLen(w, len);
+  w->running_status = 0; // running status is cancelled by SysEx events
+  ++unbuffered_seek_calls;
+  ++num_events;
+
+  u32 *hash = &expected_checksum[track];
+  int i;
+  for(i=0; i<len; ++i) {
+    u8 byte = (i == (len-1) && event == 0xf0) ? 0xf7 : ((i * 7 + seed) & 0x7f);
+    WriteByte(w, byte);
+    ++unbuffered_read_calls;
+
+    *hash = HashTick(*hash, w->tick);
+    *hash = HashByte(*hash, byte);
+  }
+}
+
+// generates a track with deterministic content
+static s32 TrackWrite(u8 track)
+{
+  track_writer_t writer;
+  track_writer_t *w = &writer;
+  u8 text[400];
+  int i;
+
+  w->buffer = track_buffer;
+  w->len = 0;
+  w->tick = 0;
+  w->running_status = 0;
+
+  sprintf((char *)text, "Track %d", track);
+  WriteMeta(w, track, 0, 0x03, strlen((char *)text), text);
+
+  if( track == 0 ) {
+    // conductor track
+    u8 tempo[3] = { 0x07, 0xa1, 0x20 }; // 120 BPM
+    WriteMeta(w, track, 0, 0x51, 3, tempo);
+    u8 time_signature[4] = { 4, 2, 24, 8 };
+    WriteMeta(w, track, 0, 0x58, 4, time_signature);
+
+    // long text which doesn't fit into the meta buffer
+    for(i=0; i<sizeof(text); ++i)
+      text[i] = 'A' + (i % 26);
+    WriteMeta(w, track, 0, 0x01, sizeof(text), text);
+
+    u32 bar;
+    for(bar=1; bar<NUM_BARS; ++bar) {
+      sprintf((char *)text, "Bar %d", bar+1);
+      WriteMeta(w, track, 4*PPQN, 0x06, strlen((char *)text), text);
+    }
+  } else {
+    u8 chn = (track - 1) % 16;
+    u32 bar, step;
+    u32 step_tick = 0;
+
+    WriteEvent(w, track, 0, 0xc0 | chn, track, 0);
+
+    for(bar=0; bar<NUM_BARS; ++bar) {
+      // SysEx at the beginning of each bar on every 4th track (crosses the read buffer boundaries)
+      if( (track % 4) == 1 )
+	WriteSysEx(w, track, step_tick - w->tick, 0xf0, 20 + ((track*37 + bar*13) % 300), track + bar);
+
+      // Escaped event (e.g. realtime messages) on every 8th track
+      if( (track % 8) == 2 && (bar % 4) == 0 )
+	WriteSysEx(w, track, step_tick - w->tick, 0xf7, 3, 0x78);
+
+      // long pause (3 byte delta) in the middle of the song on some tracks
+      if( bar == NUM_BARS/2 && (track % 5) == 0 ) {
+	step_tick += 1000*STEP_TICKS;
+	WriteEvent(w, track, step_tick - w->tick, 0xb0 | chn, 0x7b, 0x00);
+      }
+
+      for(step=0; step<STEPS_PER_BAR; ++step, step_tick += STEP_TICKS) {
+	u8 note = 0x24 + ((track * 5 + step * 3 + bar) % 48);
+	u8 velocity = 1 + ((track + step * 11 + bar * 7) % 127);
+	u32 offset = (track + step) % 8;
+	u32 gate = 1 + ((track * 13 + step * 29 + bar) % (STEP_TICKS - 10));
+
+	WriteEvent(w, track, step_tick + offset - w->tick, 0x90 | chn, note, velocity);
+	WriteEvent(w, track, 0, 0xb0 | chn, 0x01, (step * 8 + bar) & 0x7f);
+	if( (track % 3) == 0 && (step % 2) == 0 )
+	  WriteEvent(w, track, 0, 0xe0 | chn, 0x00, (step * 4 + bar) & 0x7f);
+	if( (track % 7) == 3 )
+	  WriteEvent(w, track, 0, 0xd0 | chn, velocity, 0);
+	WriteEvent(w, track, gate, 0x90 | chn, note, 0x00); // Note Off (with running status)
+      }
+    }
+  }
+
+  // End of Track
+  WriteMeta(w, track, 0, 0x2f, 0, NULL);
+
+  if( w->len >= TRACK_BUFFER_SIZE )
+    return -1; // track buffer too small
+
+  s32 status = 0;
+  status |= SEQ_FILE_WriteBuffer((u8 *)"MTrk", 4);
+  status |= SEQ_FILE_WriteByte((w->len >> 24) & 0xff);
+  status |= SEQ_FILE_WriteByte((w->len >> 16) & 0xff);
+  status |= SEQ_FILE_WriteByte((w->len >> 8) & 0xff);
+  status |= SEQ_FILE_WriteByte(w->len & 0xff);
+  status |= SEQ_FILE_WriteBuffer(w->buffer, w->len);
+
+  return status;
+}
+
+static s32 MidiFileWrite(void)
+{
+  s32 status;
+
+  if( (status=SEQ_FILE_WriteOpen(MIDIFILE_PATH, 1)) < 0 )
+    return status;
+
+  // header: format 1, NUM_TRACKS, PPQN
+  u8 header[14] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, NUM_TRACKS, PPQN >> 8, PPQN & 0xff };
+  status |= SEQ_FILE_WriteBuffer(header, 14);
+
+  u8 track;
+  for(track=0; track<NUM_TRACKS && status >= 0; ++track)
+    status |= TrackWrite(track);
+
+  status |= SEQ_FILE_WriteClose();
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// File callbacks (same like in SEQ_MIDPLY)
+/////////////////////////////////////////////////////////////////////////////
+static u32 MidiFileRead(void *buffer, u32 len)
+{
+  s32 status;
+
+  ++stats.read_calls;
+  stats.bytes_read += len;
+
+  if( (status=SEQ_FILE_ReadReOpen(&midifile_fi)) >= 0 ) {
+    status = SEQ_FILE_ReadBuffer(buffer, len);
+    SEQ_FILE_ReadClose(&midifile_fi);
+  }
+  midifile_pos += len;
+
+  return (status >= 0) ? len : 0;
+}
+
+static s32 MidiFileEof(void)
+{
+  return midifile_pos >= midifile_len;
+}
+
+static s32 MidiFileSeek(u32 pos)
+{
+  s32 status;
+
+  ++stats.seek_calls;
+
+  midifile_pos = pos;
+  if( midifile_pos >= midifile_len )
+    return -1; // end of file reached
+
+  if( (status=SEQ_FILE_ReadReOpen(&midifile_fi)) >= 0 ) {
+    status = SEQ_FILE_ReadSeek(pos);
+    SEQ_FILE_ReadClose(&midifile_fi);
+  }
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Event callbacks
+/////////////////////////////////////////////////////////////////////////////
+static s32 PlayEvent(u8 track, mios32_midi_package_t midi_package, u32 tick)
+{
+  u32 *hash = &received_checksum[track];
+
+  ++stats.event_calls;
+
+  *hash = HashTick(*hash, tick);
+  *hash = HashByte(*hash, midi_package.evnt0);
+  if( midi_package.type != 0xf ) { // not a single SysEx byte
+    *hash = HashByte(*hash, midi_package.evnt1);
+    if( midi_package.type != ProgramChange && midi_package.type != Aftertouch )
+      *hash = HashByte(*hash, midi_package.evnt2);
+  }
+
+  return 0;
+}
+
+static s32 PlayMeta(u8 track, u8 meta, u32 len, u8 *buffer, u32 tick)
+{
+  u32 *hash = &received_checksum[track];
+  int i;
+
+  ++stats.meta_calls;
+
+  *hash = HashTick(*hash, tick);
+  *hash = HashByte(*hash, meta);
+  *hash = HashTick(*hash, len);
+  for(i=0; i<len; ++i)
+    *hash = HashByte(*hash, buffer[i]);
+
+  return 0;
+}
+
+static s32 PlaySysEx(u8 track, u8 event, u32 offset, u32 len, u8 *buffer, u32 tick)
+{
+  u32 *hash = &received_checksum[track];
+  int i;
+
+  ++stats.sysex_calls;
+
+  for(i=0; i<len; ++i) {
+    *hash = HashTick(*hash, tick);
+    *hash = HashByte(*hash, buffer[i]);
+  }
+
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Plays the MIDI file <passes> times
+/////////////////////////////////////////////////////////////////////////////
+static void MidiFilePlay(const char *name, u8 sysex_chunks, u32 passes)
+{
+  host_sdcard_stats_t sdcard;
+  unsigned long long time_ns = 0;
+  u32 pass;
+
+  MID_PARSER_InstallSysExCallback(sysex_chunks ? &PlaySysEx : NULL);
+
+  memset(&stats, 0, sizeof(stats));
+  HOST_SDCARD_StatsReset();
+
+  for(pass=0; pass<passes; ++pass) {
+    memset(received_checksum, 0, sizeof(received_checksum));
+
+    unsigned long long start = TimeGet();
+    MID_PARSER_RestartSong();
+    u32 tick = 0;
+    while( MID_PARSER_FetchEvents(tick, FETCH_TICKS) > 0 )
+      tick += FETCH_TICKS;
+    time_ns += TimeGet() - start;
+
+    u8 track;
+    for(track=0; track<NUM_TRACKS; ++track)
+      Check(received_checksum[track] == expected_checksum[track], "track %d: received events differ from generated events", track);
+  }
+
+  HOST_SDCARD_StatsGet(&sdcard);
+
+  printf("%s:\n", name);
+  printf("  %.0f events/sec (%.1f uS per pass)\n",
+	 (double)num_events * passes * 1e9 / time_ns, time_ns / 1000.0 / passes);
+  printf("  callbacks per pass: %u read, %u seek (%u bytes), %u event, %u meta, %u sysex\n",
+	 stats.read_calls / passes, stats.seek_calls / passes, stats.bytes_read / passes,
+	 stats.event_calls / passes, stats.meta_calls / passes, stats.sysex_calls / passes);
+  printf("  SD Card per pass: %u reads (%u sectors)\n",
+	 sdcard.read_commands / passes, sdcard.sectors_read / passes);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  char *image_file = (argc >= 2) ? argv[1] : DEFAULT_IMAGE_FILE;
+  u32 passes = (argc >= 3) ? atoi(argv[2]) : DEFAULT_PASSES;
+  s32 status;
+
+  if( passes < 1 )
+    passes = 1;
+
+  SEQ_FILE_Init(0);
+  MID_PARSER_Init(0);
+
+  // always start with a new image
+  remove(image_file);
+  if( (status=HOST_SDCARD_ImageOpen(image_file, IMAGE_SECTORS)) < 0 ) {
+    printf("ERROR: can't create image file %s (status %d)\n", image_file, status);
+    return 1;
+  }
+
+  {
+    FATFS fs;
+    FRESULT res;
+    if( (res=f_mount(0, &fs)) != FR_OK || (res=f_mkfs(0, 0, 0)) != FR_OK ) {
+      printf("ERROR: failed to format image (status %d)\n", res);
+      return 1;
+    }
+    f_mount(0, NULL);
+  }
+
+  if( SEQ_FILE_CheckSDCard() < 0 || !SEQ_FILE_VolumeAvailable() ) {
+    printf("ERROR: failed to mount new image\n");
+    return 1;
+  }
+
+  if( (status=MidiFileWrite()) < 0 ) {
+    printf("ERROR: failed to write %s (status %d)\n", MIDIFILE_PATH, status);
+    return 1;
+  }
+
+  // open MIDI file like SEQ_MIDPLY_ReadFile()
+  status = SEQ_FILE_ReadOpen(&midifile_fi, MIDIFILE_PATH);
+  SEQ_FILE_ReadClose(&midifile_fi);
+  if( status < 0 ) {
+    printf("ERROR: failed to open %s (status %d)\n", MIDIFILE_PATH, status);
+    return 1;
+  }
+  midifile_pos = 0;
+  midifile_len = midifile_fi.fsize;
+
+  MID_PARSER_InstallFileCallbacks(&MidiFileRead, &MidiFileEof, &MidiFileSeek);
+  MID_PARSER_InstallEventCallbacks(&PlayEvent, &PlayMeta);
+  MID_PARSER_Read();
+
+  Check(MIDI_PARSER_TrackNumGet() == NUM_TRACKS, "found %d tracks", MIDI_PARSER_TrackNumGet());
+
+  printf("MIDI file: %u bytes, %d tracks, %u events, track buffer: %d bytes\n",
+	 midifile_len, MIDI_PARSER_TrackNumGet(), num_events, MID_PARSER_TRACK_BUFFER_SIZE);
+  printf("Unbuffered parsing (previous implementation): %u read, %u seek callbacks\n",
+	 unbuffered_read_calls, unbuffered_seek_calls);
+
+  MidiFilePlay("SysEx forwarded bytewise", 0, passes);
+  MidiFilePlay("SysEx forwarded in chunks", 1, passes);
+
+  HOST_SDCARD_ImageClose();
+
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+// $Id$
+/*
+ * Local MIOS32 configuration file for the host build of the
+ * MBSEQ V4 tick benchmark
+ *
+ */
+
+#ifndef _MIOS32_CONFIG_H
+#define _MIOS32_CONFIG_H
+
+// messages are print to stdout
+#define DEBUG_MSG MIOS32_MIDI_SendDebugMessage
+
+// single threaded: no critical sections required
+#define portENTER_CRITICAL() do {} while( 0 )
+#define portEXIT_CRITICAL()  do {} while( 0 )
+
+// same MIDI Out Scheduler settings like on the core (see ../mios32/mios32_config.h)
+#define SEQ_MIDI_OUT_MALLOC_METHOD 3
+#define SEQ_MIDI_OUT_MAX_EVENTS 256
+#define SEQ_MIDI_OUT_MALLOC_ANALYSIS 1
+
+#endif /* _MIOS32_CONFIG_H */
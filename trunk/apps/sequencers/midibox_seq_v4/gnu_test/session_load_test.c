@@ -0,0 +1,560 @@
+// $Id$
+/*
+ * Host test of the session container (MBSEQ_SE.V4)
+ *
+ * A session with different data and layer partitionings in each pattern
+ * slot is stored into a new SD Card image, and exported into a session
+ * container. The session is loaded (bank files opened + one pattern per
+ * group) and all patterns are read thereafter - from the bank files, and
+ * from the container. The loaded patterns have to be identical.
+ *
+ * Finally the container is imported into a new session, and the restored
+ * files have to be identical to the original ones.
+ *
+ * Usage: seq_session_load_test [<image-file>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+#include <ff.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "seq_core.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_mixer.h"
+#include "seq_pattern.h"
+#include "seq_file.h"
+#include "seq_file_b.h"
+#include "seq_file_ses.h"
+
+#include "host_stubs.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_IMAGE_FILE    "sessionload.img"
+
+#define IMAGE_SECTORS         (32*1024*1024/512) // 32 MB
+
+#define NUM_PATTERNS          64 // per bank, as created by SEQ_FILE_B_Create()
+
+// only the first half of the last bank is written
+#define LAST_BANK_PATTERNS    32
+
+#define SESSION               "LEGACY"
+#define SESSION_RESTORED      "RESTORED"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  host_sdcard_stats_t sdcard;
+  unsigned long long time_ns;
+} measurement_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static int errors;
+
+// checksums of the patterns loaded from bank files
+static u32 pattern_checksum[SEQ_FILE_B_NUM_BANKS][NUM_PATTERNS];
+
+static unsigned long long measure_start;
+
+static u8 prefetch_buffer[SEQ_FILE_SES_PATTERN_SIZE];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// The BPM generator isn't used by this test
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_Init(u32 mode) { return 0; }
+seq_bpm_mode_t SEQ_BPM_ModeGet(void) { return SEQ_BPM_MODE_Master; }
+s32 SEQ_BPM_ModeSet(seq_bpm_mode_t mode) { return 0; }
+float SEQ_BPM_Get(void) { return 120.0; }
+s32 SEQ_BPM_Set(float bpm) { return 0; }
+s32 SEQ_BPM_PPQN_Get(void) { return 384; }
+s32 SEQ_BPM_PPQN_Set(u16 ppqn) { return 0; }
+u32 SEQ_BPM_TickGet(void) { return 0; }
+s32 SEQ_BPM_TickSet(u32 tick) { return 0; }
+s32 SEQ_BPM_IsRunning(void) { return 0; }
+s32 SEQ_BPM_IsMaster(void) { return 1; }
+s32 SEQ_BPM_Start(void) { return 0; }
+s32 SEQ_BPM_Cont(void) { return 0; }
+s32 SEQ_BPM_Stop(void) { return 0; }
+s32 SEQ_BPM_ChkReqStop(void) { return 0; }
+s32 SEQ_BPM_ChkReqCont(void) { return 0; }
+s32 SEQ_BPM_ChkReqSongPos(u16 *song_pos) { return 0; }
+s32 SEQ_BPM_ChkReqStart(void) { return 0; }
+s32 SEQ_BPM_ChkReqClk(u32 *bpm_tick_ptr) { *bpm_tick_ptr = 0; return 0; }
+u32 SEQ_BPM_TicksFor_mS(u16 time_ms) { return ((u32)time_ms * 384 * 120) / 60000; }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(u8 condition, const char *format, int value)
+{
+  if( !condition ) {
+    printf("ERROR: ");
+    printf(format, value);
+    printf("\n");
+    ++errors;
+  }
+}
+
+static unsigned long long TimeGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void MeasureStart(void)
+{
+  HOST_SDCARD_StatsReset();
+  measure_start = TimeGet();
+}
+
+static void MeasureStop(measurement_t *m)
+{
+  m->time_ns = TimeGet() - measure_start;
+  HOST_SDCARD_StatsGet(&m->sdcard);
+}
+
+static void MeasurePrint(const char *name, measurement_t *m)
+{
+  printf("%-34s %5u reads (%6u sectors), %8.1f uS\n",
+	 name, m->sdcard.read_commands, m->sdcard.sectors_read, m->time_ns / 1000.0);
+}
+
+// fills the tracks of a group with data which is unique for each pattern slot
+// the layer partitioning differs between the slots
+static void PatternFill(u8 group, u8 bank, u8 pattern)
+{
+  u8 track;
+  int i;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    switch( (track + pattern) % 3 ) {
+    case 0:
+      SEQ_PAR_TrackInit(track, 64, 16, 1);
+      SEQ_TRG_TrackInit(track, 256, 8, 1);
+      break;
+    case 1:
+      SEQ_PAR_TrackInit(track, 128, 4, 1);
+      SEQ_TRG_TrackInit(track, 128, 8, 1);
+      break;
+    default:
+      SEQ_PAR_TrackInit(track, 32, 2, 16); // drum track
+      SEQ_TRG_TrackInit(track, 32, 2, 16);
+    }
+
+    u32 par_size = SEQ_PAR_NumInstrumentsGet(track) * SEQ_PAR_NumLayersGet(track) * SEQ_PAR_NumStepsGet(track);
+    for(i=0; i<par_size; ++i)
+      seq_par_layer_value[track][i] = (u8)(i*7 + track*13 + bank*31 + pattern*17);
+    u32 trg_size = SEQ_TRG_NumInstrumentsGet(track) * SEQ_TRG_NumLayersGet(track) * (SEQ_TRG_NumStepsGet(track)/8);
+    for(i=0; i<trg_size; ++i)
+      seq_trg_layer_value[track][i] = (u8)(i*3 + track*5 + bank*11 + pattern*19);
+
+    sprintf(seq_core_trk[track].name, "Track %d of B%d:P%d", track+1, bank+1, pattern+1);
+  }
+
+  sprintf(seq_pattern_name[group], "Bank %d Pattern %02d  ", bank+1, pattern+1);
+}
+
+// clears the tracks of a group, so that a loaded pattern doesn't contain old data
+static void PatternClear(u8 group)
+{
+  u8 track;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    memset(seq_par_layer_value[track], 0xff, SEQ_PAR_MAX_BYTES);
+    memset(seq_trg_layer_value[track], 0xff, SEQ_TRG_MAX_BYTES);
+    memset(seq_core_trk[track].name, 0, sizeof(seq_core_trk[track].name));
+  }
+  memset(seq_pattern_name[group], 0, 21);
+}
+
+static u32 PatternChecksum(u8 group)
+{
+  u32 checksum = 0;
+  u8 track;
+  int i;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    for(i=0; i<SEQ_PAR_MAX_BYTES; ++i)
+      checksum = checksum * 31 + seq_par_layer_value[track][i];
+    for(i=0; i<SEQ_TRG_MAX_BYTES; ++i)
+      checksum = checksum * 31 + seq_trg_layer_value[track][i];
+    for(i=0; i<80; ++i)
+      checksum = checksum * 31 + seq_core_trk[track].name[i];
+    checksum = checksum * 31 + SEQ_PAR_NumInstrumentsGet(track);
+    checksum = checksum * 31 + SEQ_PAR_NumLayersGet(track);
+    checksum = checksum * 31 + SEQ_PAR_NumStepsGet(track);
+    checksum = checksum * 31 + SEQ_TRG_NumInstrumentsGet(track);
+    checksum = checksum * 31 + SEQ_TRG_NumLayersGet(track);
+    checksum = checksum * 31 + SEQ_TRG_NumStepsGet(track);
+  }
+  for(i=0; i<20; ++i)
+    checksum = checksum * 31 + seq_pattern_name[group][i];
+
+  return checksum;
+}
+
+static u8 PatternAvailable(u8 bank, u8 pattern)
+{
+  return bank < (SEQ_FILE_B_NUM_BANKS-1) || pattern < LAST_BANK_PATTERNS;
+}
+
+// writes a small file with deterministic content
+static s32 FileCreate(char *session, char *filename, u32 size)
+{
+  char path[40];
+  s32 status;
+  u32 i;
+
+  sprintf(path, "%s/%s/%s", SEQ_FILE_SESSION_PATH, session, filename);
+  if( (status=SEQ_FILE_WriteOpen(path, 1)) < 0 )
+    return status;
+
+  for(i=0; i<size; ++i)
+    status |= SEQ_FILE_WriteByte((u8)(i*11 + size));
+
+  status |= SEQ_FILE_WriteClose();
+
+  return status;
+}
+
+// compares two files byte by byte
+static s32 FileCompare(char *path1, char *path2)
+{
+  static FIL fil1, fil2;
+  static u8 buffer1[512], buffer2[512];
+  UINT count1, count2;
+
+  if( f_open(&fil1, path1, FA_OPEN_EXISTING | FA_READ) != FR_OK ||
+      f_open(&fil2, path2, FA_OPEN_EXISTING | FA_READ) != FR_OK )
+    return -1; // file not found
+
+  if( fil1.fsize != fil2.fsize )
+    return -2; // different size
+
+  do {
+    if( f_read(&fil1, buffer1, sizeof(buffer1), &count1) != FR_OK ||
+	f_read(&fil2, buffer2, sizeof(buffer2), &count2) != FR_OK )
+      return -3; // read error
+    if( count1 != count2 || memcmp(buffer1, buffer2, count1) != 0 )
+      return -4; // different content
+  } while( count1 );
+
+  return 0; // files are identical
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates the session
+/////////////////////////////////////////////////////////////////////////////
+static void SessionCreate(void)
+{
+  char path[30];
+  s32 status;
+  u8 bank, pattern;
+
+  sprintf(path, "%s/%s", SEQ_FILE_SESSION_PATH, SESSION);
+  SEQ_FILE_MakeDir(path);
+
+  strcpy(seq_file_new_session_name, SESSION);
+  if( (status=SEQ_FILE_Format()) < 0 ) {
+    Check(0, "failed to create session (status %d)", status);
+    return;
+  }
+
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    u8 group = bank % SEQ_CORE_NUM_GROUPS;
+
+    // last bank: start with an empty file
+    if( bank == (SEQ_FILE_B_NUM_BANKS-1) )
+      SEQ_FILE_B_Create(SESSION, bank);
+
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      if( !PatternAvailable(bank, pattern) )
+	break;
+      PatternFill(group, bank, pattern);
+      if( (status=SEQ_FILE_B_PatternWrite(SESSION, bank, pattern, group, 0)) < 0 )
+	Check(0, "failed to store pattern (status %d)", status);
+    }
+  }
+
+  // the remaining session files are stubbed - create some with dummy content
+  FileCreate(SESSION, "MBSEQ_M.V4", 35618);
+  FileCreate(SESSION, "MBSEQ_S.V4", 12345);
+  FileCreate(SESSION, "MBSEQ_C.V4", 777);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Opens the session like SEQ_FILE_LoadAllFiles() and loads the first
+// pattern of bank 1..4 into group 1..4
+/////////////////////////////////////////////////////////////////////////////
+static void SessionOpen(u8 container, measurement_t *m)
+{
+  u8 group;
+  s32 status;
+
+  SEQ_FILE_B_UnloadAllBanks();
+  SEQ_FILE_SES_Unload();
+  SEQ_FILE_CacheInvalidate();
+
+  MeasureStart();
+  SEQ_FILE_B_LoadAllBanks(SESSION);
+  if( container )
+    Check(SEQ_FILE_SES_Load(SESSION) >= 0, "failed to load session container%c", ' ');
+
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+    if( (status=SEQ_FILE_B_PatternRead(group, 0, group)) < 0 )
+      Check(0, "failed to load pattern (status %d)", status);
+  }
+  MeasureStop(m);
+
+  for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group)
+    Check(PatternChecksum(group) == pattern_checksum[group][0] || !container, "session open: group %d differs", group+1);
+
+  MeasurePrint(container ? "Open session (container):" : "Open session (bank files):", m);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads all patterns of all banks
+/////////////////////////////////////////////////////////////////////////////
+static void PatternLoadAll(u8 container, measurement_t *m)
+{
+  s32 status;
+  u8 bank, pattern;
+
+  Check(SEQ_FILE_SES_Valid() == container, "container state %d unexpected", SEQ_FILE_SES_Valid());
+
+  MeasureStart();
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    u8 group = bank % SEQ_CORE_NUM_GROUPS;
+
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      PatternClear(group);
+      status = SEQ_FILE_B_PatternRead(bank, pattern, group);
+
+      if( !PatternAvailable(bank, pattern) ) {
+	Check(status < 0, "pattern %d: empty slot has been loaded", bank*NUM_PATTERNS + pattern);
+	continue;
+      }
+
+      if( status < 0 ) {
+	Check(0, "failed to load pattern (status %d)", status);
+	continue;
+      }
+
+      u32 checksum = PatternChecksum(group);
+      if( !container )
+	pattern_checksum[bank][pattern] = checksum;
+      else if( checksum != pattern_checksum[bank][pattern] )
+	Check(0, "pattern %d: data differs from bank file", bank*NUM_PATTERNS + pattern);
+    }
+  }
+  MeasureStop(m);
+
+  MeasurePrint(container ? "Load all patterns (container):" : "Load all patterns (bank files):", m);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prefetch and write-through
+/////////////////////////////////////////////////////////////////////////////
+static void PatternPrefetchAndWrite(void)
+{
+  s32 status;
+  u8 group = 1;
+  u8 bank = 2;
+  u8 pattern;
+
+  // prefetched pattern records have to be parsed like direct reads
+  for(pattern=0; pattern<NUM_PATTERNS; pattern+=7) {
+    PatternClear(group);
+    status = SEQ_FILE_B_PatternPrefetch(bank, pattern, prefetch_buffer, sizeof(prefetch_buffer));
+    // only the used bytes of the record are transfered
+    Check(status > 0 && status <= SEQ_FILE_SES_PATTERN_SIZE, "prefetch returned %d", status);
+    if( status >= 0 ) {
+      Check(SEQ_FILE_B_PatternReadBuffer(bank, pattern, group, prefetch_buffer, status) >= 0, "pattern %d: can't parse prefetched record", pattern);
+      Check(PatternChecksum(group) == pattern_checksum[bank][pattern], "pattern %d: prefetched record differs", pattern);
+    }
+  }
+
+  // stored patterns have to be taken over into the container
+  pattern = 5;
+  PatternFill(group, 0, 42);
+  u32 checksum = PatternChecksum(group);
+  Check(SEQ_FILE_B_PatternWrite(SESSION, bank, pattern, group, 0) >= 0, "failed to store pattern%c", ' ');
+  Check(SEQ_FILE_SES_Valid(), "container has been unloaded after write%c", ' ');
+
+  PatternClear(group);
+  Check(SEQ_FILE_B_PatternRead(bank, pattern, group) >= 0, "failed to load stored pattern%c", ' ');
+  Check(PatternChecksum(group) == checksum, "stored pattern differs in container%c", ' ');
+
+  // slot behind the last written one of the last bank
+  bank = SEQ_FILE_B_NUM_BANKS-1;
+  pattern = LAST_BANK_PATTERNS;
+  Check(SEQ_FILE_B_PatternRead(bank, pattern, group) < 0, "empty slot %d has been loaded", pattern);
+  PatternFill(group, bank, pattern);
+  u32 checksum_empty_slot = PatternChecksum(group);
+  Check(SEQ_FILE_B_PatternWrite(SESSION, bank, pattern, group, 0) >= 0, "failed to store pattern%c", ' ');
+
+  PatternClear(group);
+  Check(SEQ_FILE_B_PatternRead(bank, pattern, group) >= 0, "failed to load stored pattern%c", ' ');
+  Check(PatternChecksum(group) == checksum_empty_slot, "stored pattern differs in container%c", ' ');
+
+  // reload the container: the written slot has been taken over into the header
+  Check(SEQ_FILE_SES_Load(SESSION) >= 0, "failed to load session container%c", ' ');
+  PatternClear(group);
+  Check(SEQ_FILE_B_PatternRead(bank, pattern, group) >= 0, "failed to load stored pattern%c", ' ');
+  Check(PatternChecksum(group) == checksum_empty_slot, "stored pattern differs in reloaded container%c", ' ');
+
+  bank = 2;
+  pattern = 5;
+  SEQ_FILE_SES_Unload();
+  PatternClear(group);
+  Check(SEQ_FILE_B_PatternRead(bank, pattern, group) >= 0, "failed to load stored pattern%c", ' ');
+  Check(PatternChecksum(group) == checksum, "stored pattern differs in bank file%c", ' ');
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  char *image_file = (argc >= 2) ? argv[1] : DEFAULT_IMAGE_FILE;
+  s32 status;
+
+  SEQ_MIXER_Init(0);
+  SEQ_CORE_Init(0);
+  SEQ_FILE_Init(0);
+
+  // always start with a new image
+  remove(image_file);
+  if( (status=HOST_SDCARD_ImageOpen(image_file, IMAGE_SECTORS)) < 0 ) {
+    printf("ERROR: can't create image file %s (status %d)\n", image_file, status);
+    return 1;
+  }
+
+  {
+    FATFS fs;
+    FRESULT res;
+    if( (res=f_mount(0, &fs)) != FR_OK || (res=f_mkfs(0, 0, 0)) != FR_OK ) {
+      printf("ERROR: failed to format image (status %d)\n", res);
+      return 1;
+    }
+    f_mount(0, NULL);
+  }
+
+  if( SEQ_FILE_CheckSDCard() < 0 || !SEQ_FILE_VolumeAvailable() ) {
+    printf("ERROR: failed to mount new image\n");
+    return 1;
+  }
+  SEQ_FILE_MakeDir(SEQ_FILE_SESSION_PATH);
+
+  printf("Pattern record: %d bytes (bank file slot: 6008 bytes)\n", SEQ_FILE_SES_PATTERN_SIZE);
+
+  SessionCreate();
+
+  // reference: bank files
+  measurement_t open_b, open_ses, all_b, all_ses, export;
+  SessionOpen(0, &open_b);
+  PatternLoadAll(0, &all_b);
+
+  // export
+  MeasureStart();
+  status = SEQ_FILE_SES_Export(SESSION);
+  MeasureStop(&export);
+  Check(status >= 0, "export failed with status %d", status);
+  printf("%-34s %5u reads (%6u sectors), %5u writes (%6u sectors), %d sections\n", "Export:",
+	 export.sdcard.read_commands, export.sdcard.sectors_read,
+	 export.sdcard.write_commands, export.sdcard.sectors_written, SEQ_FILE_SES_NumSections());
+  Check(SEQ_FILE_SES_NumSections() == SEQ_FILE_B_NUM_BANKS + 3, "unexpected number of sections: %d", SEQ_FILE_SES_NumSections());
+
+  // container
+  SessionOpen(1, &open_ses);
+  PatternLoadAll(1, &all_ses);
+
+  printf("Open session:  %u -> %u sectors, %u -> %u read commands\n",
+	 open_b.sdcard.sectors_read, open_ses.sdcard.sectors_read,
+	 open_b.sdcard.read_commands, open_ses.sdcard.read_commands);
+  printf("Load patterns: %u -> %u sectors, %u -> %u read commands, %.1f -> %.1f uS per pattern\n",
+	 all_b.sdcard.sectors_read, all_ses.sdcard.sectors_read,
+	 all_b.sdcard.read_commands, all_ses.sdcard.read_commands,
+	 all_b.time_ns / 1000.0 / (SEQ_FILE_B_NUM_BANKS*NUM_PATTERNS),
+	 all_ses.time_ns / 1000.0 / (SEQ_FILE_B_NUM_BANKS*NUM_PATTERNS));
+
+  Check(all_ses.sdcard.read_commands < all_b.sdcard.read_commands, "container doesn't reduce the number of read commands%c", ' ');
+  Check(all_ses.sdcard.sectors_read <= all_b.sdcard.sectors_read, "container reads more sectors than the bank files%c", ' ');
+
+  PatternPrefetchAndWrite();
+
+  // restore the session from the container
+  {
+    char path1[40];
+    char path2[40];
+    u8 bank;
+
+    sprintf(path1, "%s/%s", SEQ_FILE_SESSION_PATH, SESSION_RESTORED);
+    SEQ_FILE_MakeDir(path1);
+
+    sprintf(path1, "%s/%s/MBSEQ_SE.V4", SEQ_FILE_SESSION_PATH, SESSION);
+    sprintf(path2, "%s/%s/MBSEQ_SE.V4", SEQ_FILE_SESSION_PATH, SESSION_RESTORED);
+    static u8 copy_buffer[512];
+    Check(SEQ_FILE_Copy(path1, path2, copy_buffer) >= 0, "failed to copy container%c", ' ');
+
+    Check((status=SEQ_FILE_SES_Import(SESSION_RESTORED)) >= 0, "import failed with status %d", status);
+
+    for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+      sprintf(path1, "%s/%s/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, SESSION, bank+1);
+      sprintf(path2, "%s/%s/MBSEQ_B%d.V4", SEQ_FILE_SESSION_PATH, SESSION_RESTORED, bank+1);
+      Check(FileCompare(path1, path2) == 0, "bank %d: restored file differs", bank+1);
+    }
+
+    char *files[3] = { "MBSEQ_M.V4", "MBSEQ_S.V4", "MBSEQ_C.V4" };
+    int i;
+    for(i=0; i<3; ++i) {
+      sprintf(path1, "%s/%s/%s", SEQ_FILE_SESSION_PATH, SESSION, files[i]);
+      sprintf(path2, "%s/%s/%s", SEQ_FILE_SESSION_PATH, SESSION_RESTORED, files[i]);
+      Check(FileCompare(path1, path2) == 0, "embedded file #%d: restored file differs", i+1);
+    }
+    printf("Import: %s\n", errors ? "failed" : "restored files are identical");
+  }
+
+  HOST_SDCARD_ImageClose();
+
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+
+  return errors ? 1 : 0;
+}
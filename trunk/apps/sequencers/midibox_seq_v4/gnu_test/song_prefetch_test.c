@@ -0,0 +1,389 @@
+// $Id$
+/*
+ * Host test of the pattern prefetching in song mode
+ *
+ * A song which changes the patterns of all groups on each song step is
+ * played twice: at first with disabled staging area (all patterns are
+ * loaded at the end of the song step like before), thereafter with
+ * prefetching, so that the patterns are read by the pattern task while
+ * the previous song step is played, and swapped at the measure boundary.
+ *
+ * The pattern task is emulated: once it has been resumed, it runs
+ * TASK_LATENCY ticks later (e.g. because the SD Card is busy).
+ *
+ * At the beginning of each measure the patterns of all groups are checked,
+ * and the MIDI output of both runs has to be identical.
+ *
+ * Usage: seq_song_prefetch_test [<image-file>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+#include <seq_midi_out.h>
+#include <ff.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "seq_core.h"
+#include "seq_cc.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_mixer.h"
+#include "seq_pattern.h"
+#include "seq_song.h"
+#include "seq_file.h"
+#include "seq_file_b.h"
+
+#include "host_stubs.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_IMAGE_FILE    "songprefetch.img"
+#define SESSION               "SONG"
+
+#define IMAGE_SECTORS         (32*1024*1024/512) // 32 MB
+
+#define NUM_PATTERNS          4  // used patterns per bank
+#define NUM_MEASURES          24
+#define TICKS_PER_MEASURE     (16*96)
+
+#define TASK_LATENCY          16 // ticks
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static int errors;
+
+static u32 bpm_tick;
+static u8  bpm_req_start;
+static u8  bpm_req_clk;
+
+// checksums of the stored patterns
+static u32 pattern_checksum[SEQ_FILE_B_NUM_BANKS][NUM_PATTERNS];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated BPM generator: always running, a new tick is requested
+// by the test loop
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_Init(u32 mode) { return 0; }
+seq_bpm_mode_t SEQ_BPM_ModeGet(void) { return SEQ_BPM_MODE_Master; }
+s32 SEQ_BPM_ModeSet(seq_bpm_mode_t mode) { return 0; }
+float SEQ_BPM_Get(void) { return 120.0; }
+s32 SEQ_BPM_Set(float bpm) { return 0; }
+s32 SEQ_BPM_PPQN_Get(void) { return 384; }
+s32 SEQ_BPM_PPQN_Set(u16 ppqn) { return 0; }
+u32 SEQ_BPM_TickGet(void) { return bpm_tick; }
+s32 SEQ_BPM_TickSet(u32 tick) { bpm_tick = tick; return 0; }
+s32 SEQ_BPM_IsRunning(void) { return 1; }
+s32 SEQ_BPM_IsMaster(void) { return 1; }
+s32 SEQ_BPM_Start(void) { bpm_req_start = 1; return 0; }
+s32 SEQ_BPM_Cont(void) { return 0; }
+s32 SEQ_BPM_Stop(void) { return 0; }
+s32 SEQ_BPM_ChkReqStop(void) { return 0; }
+s32 SEQ_BPM_ChkReqCont(void) { return 0; }
+s32 SEQ_BPM_ChkReqSongPos(u16 *song_pos) { return 0; }
+u32 SEQ_BPM_TicksFor_mS(u16 time_ms) { return ((u32)time_ms * 384 * 120) / 60000; }
+
+s32 SEQ_BPM_ChkReqStart(void)
+{
+  s32 req = bpm_req_start;
+  bpm_req_start = 0;
+  return req;
+}
+
+s32 SEQ_BPM_ChkReqClk(u32 *bpm_tick_ptr)
+{
+  s32 req = bpm_req_clk;
+  bpm_req_clk = 0;
+  *bpm_tick_ptr = bpm_tick;
+  return req;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(u8 condition, const char *format, int value)
+{
+  if( !condition ) {
+    printf("ERROR: ");
+    printf(format, value);
+    printf("\n");
+    ++errors;
+  }
+}
+
+// fills the tracks of a group with steps which are unique for each pattern slot
+static void PatternFill(u8 group, u8 bank, u8 pattern)
+{
+  u8 track;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    int num_steps = SEQ_TRG_NumStepsGet(track);
+    int step;
+
+    SEQ_CC_Set(track, SEQ_CC_MIDI_CHANNEL, track % 16);
+    for(step=0; step<num_steps; ++step) {
+      SEQ_TRG_GateSet(track, step, 0, ((step + pattern) % (1 + (track % 4))) == 0);
+      SEQ_PAR_Set(track, step, 0, 0, 0x24 + ((step*5 + track*3 + bank*7 + pattern*11) % 48)); // note
+      SEQ_PAR_Set(track, step, 1, 0, 32 + ((step + pattern*13) % 96)); // velocity
+    }
+  }
+
+  sprintf(seq_pattern_name[group], "Bank %d Pattern %02d  ", bank+1, pattern+1);
+}
+
+static u32 PatternChecksum(u8 group)
+{
+  u32 checksum = 0;
+  u8 track;
+  int i;
+
+  for(track=group*SEQ_CORE_NUM_TRACKS_PER_GROUP; track<(group+1)*SEQ_CORE_NUM_TRACKS_PER_GROUP; ++track) {
+    for(i=0; i<SEQ_PAR_MAX_BYTES; ++i)
+      checksum = checksum * 31 + seq_par_layer_value[track][i];
+    for(i=0; i<SEQ_TRG_MAX_BYTES; ++i)
+      checksum = checksum * 31 + seq_trg_layer_value[track][i];
+  }
+  for(i=0; i<20; ++i)
+    checksum = checksum * 31 + seq_pattern_name[group][i];
+
+  return checksum;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// The song:
+//   1: Loop1 P1/P1/P1/P1
+//   2: Loop1 P2/P2/P2/P2
+//   3: Tempo 120
+//   4: Loop2 P3/--/P3/P3 (G2 keeps P2)
+//   5: Loop1 P4/P4/P4/P4
+//   6: Jump to position 2
+/////////////////////////////////////////////////////////////////////////////
+static void SongCreate(void)
+{
+  seq_song_step_t s;
+  int step;
+
+  for(step=0; step<SEQ_SONG_NUM_STEPS; ++step)
+    SEQ_SONG_StepEntryClear(step);
+
+  for(step=0; step<5; ++step) {
+    u8 pattern = (step < 2) ? step : (step - 1);
+
+    s.ALL = 0;
+    s.action = (step == 3) ? SEQ_SONG_ACTION_Loop2 : SEQ_SONG_ACTION_Loop1;
+    s.pattern_g1 = pattern;
+    s.pattern_g2 = (step == 3) ? 0x80 : pattern;
+    s.pattern_g3 = pattern;
+    s.pattern_g4 = pattern;
+    s.bank_g1 = 0;
+    s.bank_g2 = 1;
+    s.bank_g3 = 2;
+    s.bank_g4 = 3;
+
+    if( step == 2 ) {
+      s.ALL = 0;
+      s.action = SEQ_SONG_ACTION_Tempo;
+      s.action_value = 120;
+    }
+
+    SEQ_SONG_StepEntrySet(step, s);
+  }
+
+  s.ALL = 0;
+  s.action = SEQ_SONG_ACTION_JmpPos;
+  s.action_value = 1;
+  SEQ_SONG_StepEntrySet(5, s);
+}
+
+// returns the expected pattern of a group at the given measure
+static u8 SongExpectedPattern(u32 measure, u8 group)
+{
+  if( measure == 0 )
+    return 0;
+
+  switch( (measure-1) % 4 ) {
+  case 0: return 1;
+  case 1:
+  case 2: return (group == 1) ? 1 : 2;
+  }
+  return 3;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Plays the song, checks the patterns at the beginning of each measure
+// returns the MIDI checksum
+/////////////////////////////////////////////////////////////////////////////
+static u32 SongPlay(u8 prefetch)
+{
+  u32 task_tick = 0;
+  u8 task_pending = 0;
+  u8 group;
+
+  SEQ_MIDI_OUT_Init(0);
+  SEQ_CORE_Init(0);
+  HOST_MIDI_Reset();
+  HOST_TASK_PatternResumed();
+
+  SongCreate(); // after SEQ_CORE_Init(), which clears the song
+  SEQ_SONG_ActiveSet(1);
+  bpm_tick = 0;
+  SEQ_BPM_Start();
+  SEQ_CORE_Handler(); // handles the start request
+
+  u32 tick;
+  for(tick=0; tick<NUM_MEASURES*TICKS_PER_MEASURE; ++tick) {
+    bpm_tick = tick;
+    bpm_req_clk = 1;
+    SEQ_CORE_Handler();
+    SEQ_MIDI_OUT_Handler();
+
+    // the tick loop could have been forwarded
+    u32 handled_tick = (bpm_tick > tick) ? bpm_tick : tick;
+
+    if( (tick % TICKS_PER_MEASURE) == 0 ) {
+      u32 measure = tick / TICKS_PER_MEASURE;
+      for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+	u8 pattern = SongExpectedPattern(measure, group);
+	if( seq_pattern[group].pattern != pattern || PatternChecksum(group) != pattern_checksum[group][pattern] ) {
+	  printf("ERROR: measure %u group G%d: expected pattern %d, got %d\n",
+		 measure+1, group+1, pattern+1, seq_pattern[group].pattern+1);
+	  ++errors;
+	}
+      }
+    }
+
+    // emulated pattern task
+    if( HOST_TASK_PatternResumed() && !task_pending ) {
+      task_pending = 1;
+      task_tick = handled_tick + TASK_LATENCY;
+    }
+
+    if( task_pending && tick >= task_tick ) {
+      task_pending = 0;
+      if( !prefetch )
+	SEQ_PATTERN_PrefetchCancel(); // staging area not used
+      SEQ_PATTERN_Handler();
+    }
+  }
+
+  SEQ_CORE_PlayOffEvents();
+
+  return HOST_MIDI_ChecksumGet();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  char *image_file = (argc >= 2) ? argv[1] : DEFAULT_IMAGE_FILE;
+  char path[30];
+  s32 status;
+  u8 bank, pattern;
+
+  SEQ_MIDI_OUT_Init(0);
+  SEQ_MIXER_Init(0);
+  SEQ_CORE_Init(0);
+  SEQ_FILE_Init(0);
+
+  // always start with a new image
+  remove(image_file);
+  if( (status=HOST_SDCARD_ImageOpen(image_file, IMAGE_SECTORS)) < 0 ) {
+    printf("ERROR: can't create image file %s (status %d)\n", image_file, status);
+    return 1;
+  }
+
+  {
+    FATFS fs;
+    FRESULT res;
+    if( (res=f_mount(0, &fs)) != FR_OK || (res=f_mkfs(0, 0, 0)) != FR_OK ) {
+      printf("ERROR: failed to format image (status %d)\n", res);
+      return 1;
+    }
+    f_mount(0, NULL);
+  }
+
+  if( SEQ_FILE_CheckSDCard() < 0 || !SEQ_FILE_VolumeAvailable() ) {
+    printf("ERROR: failed to mount new image\n");
+    return 1;
+  }
+
+  // create session: group G<n> plays from bank <n>
+  SEQ_FILE_MakeDir(SEQ_FILE_SESSION_PATH);
+  sprintf(path, "%s/%s", SEQ_FILE_SESSION_PATH, SESSION);
+  SEQ_FILE_MakeDir(path);
+
+  strcpy(seq_file_new_session_name, SESSION);
+  if( (status=SEQ_FILE_Format()) < 0 ) {
+    printf("ERROR: failed to create session (status %d)\n", status);
+    return 1;
+  }
+  strcpy(seq_file_session_name, SESSION);
+
+  for(bank=0; bank<SEQ_FILE_B_NUM_BANKS; ++bank) {
+    for(pattern=0; pattern<NUM_PATTERNS; ++pattern) {
+      PatternFill(bank, bank, pattern);
+      pattern_checksum[bank][pattern] = PatternChecksum(bank);
+      if( (status=SEQ_FILE_B_PatternWrite(SESSION, bank, pattern, bank, 0)) < 0 )
+	Check(0, "failed to store pattern (status %d)", status);
+    }
+  }
+  SEQ_FILE_B_LoadAllBanks(SESSION);
+
+  printf("Staging area: %d bytes, pattern task latency: %d ticks\n",
+	 SEQ_PATTERN_PREFETCH_BUFFER_SIZE, TASK_LATENCY);
+
+  // play w/o and with prefetching
+  u32 checksum_reference = SongPlay(0);
+  seq_pattern_prefetch_stats_t stats_reference;
+  SEQ_PATTERN_PrefetchStatsGet(&stats_reference);
+
+  u32 checksum_prefetch = SongPlay(1);
+  seq_pattern_prefetch_stats_t stats;
+  SEQ_PATTERN_PrefetchStatsGet(&stats);
+
+  printf("Without prefetching: MIDI checksum %08x, %u swaps, %u late, %u not prefetched\n",
+	 checksum_reference, stats_reference.swaps, stats_reference.late, stats_reference.missed);
+  printf("With prefetching:    MIDI checksum %08x, %u swaps, %u late, %u not prefetched\n",
+	 checksum_prefetch, stats.swaps, stats.late, stats.missed);
+  if( stats.swaps ) {
+    printf("Swap margin:         last %u, min %u, max %u, avg %u ticks\n",
+	   stats.margin_last, stats.margin_min, stats.margin_max, stats.margin_sum / stats.swaps);
+  }
+
+  Check(stats_reference.swaps == 0, "patterns swapped although prefetching was disabled%c", ' ');
+  Check(stats.swaps > 0, "no pattern has been swapped%c", ' ');
+  Check(stats.late == 0, "%d patterns have been prefetched too late", stats.late);
+  Check(checksum_reference == checksum_prefetch, "MIDI output differs%c", ' ');
+
+  HOST_SDCARD_ImageClose();
+
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+
+  return errors ? 1 : 0;
+}
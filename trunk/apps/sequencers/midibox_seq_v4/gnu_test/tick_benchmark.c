@@ -0,0 +1,332 @@
+// $Id$
+/*
+ * Host build of a deterministic MBSEQ V4 tick benchmark
+ *
+ * Loads the pattern banks of a session from a SD Card image, and runs
+ * the sequencer core for a given number of ticks as fast as possible
+ * (the BPM generator is bypassed).
+ * Prints the tick throughput, the number of generated MIDI events and
+ * the per-tick latency percentiles.
+ *
+ * If the image file doesn't exist, a new one will be formatted, and a
+ * session with a dense set of benchmark patterns will be created.
+ *
+ * Usage: seq_tick_benchmark [<image-file> [<session> [<ticks>]]]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+#include <seq_bpm.h>
+#include <seq_midi_out.h>
+#include <ff.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "seq_core.h"
+#include "seq_cc.h"
+#include "seq_par.h"
+#include "seq_trg.h"
+#include "seq_mixer.h"
+#include "seq_pattern.h"
+#include "seq_file.h"
+#include "seq_file_b.h"
+#include "seq_statistics.h"
+
+#include "host_stubs.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_IMAGE_FILE    "sdcard.img"
+#define DEFAULT_SESSION       "BENCH"
+#define DEFAULT_TICKS         (384*4*256) // 256 bars @384 ppqn
+
+#define IMAGE_SECTORS         (32*1024*1024/512) // 32 MB
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static u32 bpm_tick;
+static u8  bpm_req_start;
+static u8  bpm_req_clk;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated BPM generator: always running, a new tick is requested
+// by the benchmark loop
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_Init(u32 mode) { return 0; }
+seq_bpm_mode_t SEQ_BPM_ModeGet(void) { return SEQ_BPM_MODE_Master; }
+s32 SEQ_BPM_ModeSet(seq_bpm_mode_t mode) { return 0; }
+float SEQ_BPM_Get(void) { return 120.0; }
+s32 SEQ_BPM_Set(float bpm) { return 0; }
+s32 SEQ_BPM_PPQN_Get(void) { return 384; }
+s32 SEQ_BPM_PPQN_Set(u16 ppqn) { return 0; }
+u32 SEQ_BPM_TickGet(void) { return bpm_tick; }
+s32 SEQ_BPM_TickSet(u32 tick) { bpm_tick = tick; return 0; }
+s32 SEQ_BPM_IsRunning(void) { return 1; }
+s32 SEQ_BPM_IsMaster(void) { return 1; }
+s32 SEQ_BPM_Start(void) { bpm_req_start = 1; return 0; }
+s32 SEQ_BPM_Cont(void) { return 0; }
+s32 SEQ_BPM_Stop(void) { return 0; }
+s32 SEQ_BPM_ChkReqStop(void) { return 0; }
+s32 SEQ_BPM_ChkReqCont(void) { return 0; }
+s32 SEQ_BPM_ChkReqSongPos(u16 *song_pos) { return 0; }
+u32 SEQ_BPM_TicksFor_mS(u16 time_ms) { return ((u32)time_ms * 384 * 120) / 60000; }
+
+s32 SEQ_BPM_ChkReqStart(void)
+{
+  s32 req = bpm_req_start;
+  bpm_req_start = 0;
+  return req;
+}
+
+s32 SEQ_BPM_ChkReqClk(u32 *bpm_tick_ptr)
+{
+  s32 req = bpm_req_clk;
+  bpm_req_clk = 0;
+  *bpm_tick_ptr = bpm_tick;
+  return req;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int CompareU32(const void *a, const void *b)
+{
+  u32 va = *(const u32 *)a;
+  u32 vb = *(const u32 *)b;
+  return (va > vb) - (va < vb);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Fills the tracks of all groups with a deterministic, dense set of steps
+/////////////////////////////////////////////////////////////////////////////
+static void CreateBenchmarkPatterns(void)
+{
+  u8 track;
+
+  for(track=0; track<SEQ_CORE_NUM_TRACKS; ++track) {
+    int num_steps = SEQ_TRG_NumStepsGet(track);
+    int num_par_layers = SEQ_PAR_NumLayersGet(track);
+    int num_instruments = SEQ_TRG_NumInstrumentsGet(track);
+    int step, par_layer, instrument;
+
+    SEQ_CC_Set(track, SEQ_CC_MIDI_CHANNEL, track % 16);
+    SEQ_CC_Set(track, SEQ_CC_LENGTH, (track % 4) ? (15 + 16*(track % 4)) : 15);
+
+    // every fourth track plays with echo
+    if( (track % 4) == 3 )
+      SEQ_CC_Set(track, SEQ_CC_ECHO_REPEATS, 3);
+
+    for(step=0; step<num_steps; ++step) {
+      for(instrument=0; instrument<num_instruments; ++instrument) {
+	u8 gate = ((step + track + instrument) % (1 + (track % 3))) == 0;
+	SEQ_TRG_GateSet(track, step, instrument, gate);
+	SEQ_TRG_AccentSet(track, step, instrument, (step % 8) == 0);
+      }
+
+      for(par_layer=0; par_layer<num_par_layers; ++par_layer) {
+	for(instrument=0; instrument<num_instruments; ++instrument) {
+	  u8 value = 0;
+	  switch( SEQ_PAR_AssignmentGet(track, par_layer) ) {
+	  case SEQ_PAR_Type_Note:     value = 0x30 + ((step*7 + track*3 + par_layer) % 24); break;
+	  case SEQ_PAR_Type_Velocity: value = 64 + ((step*5 + track) % 64); break;
+	  case SEQ_PAR_Type_Length:   value = 1 + ((step + track) % 24); break;
+	  case SEQ_PAR_Type_CC:       value = (step*4 + track) % 128; break;
+	  default: value = SEQ_PAR_Get(track, step, par_layer, instrument);
+	  }
+	  SEQ_PAR_Set(track, step, par_layer, instrument, value);
+	}
+      }
+    }
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Formats a new image and creates the benchmark session
+/////////////////////////////////////////////////////////////////////////////
+static s32 CreateSession(char *session)
+{
+  FATFS fs;
+  FRESULT res;
+  char path[30];
+  s32 status;
+
+  if( (res=f_mount(0, &fs)) != FR_OK || (res=f_mkfs(0, 0, 0)) != FR_OK ) {
+    printf("ERROR: failed to format image (status %d)\n", res);
+    return -1;
+  }
+  f_mount(0, NULL);
+
+  if( SEQ_FILE_CheckSDCard() < 0 || !SEQ_FILE_VolumeAvailable() ) {
+    printf("ERROR: failed to mount new image\n");
+    return -2;
+  }
+
+  CreateBenchmarkPatterns();
+
+  SEQ_FILE_MakeDir(SEQ_FILE_SESSION_PATH);
+  sprintf(path, "%s/%s", SEQ_FILE_SESSION_PATH, session);
+  SEQ_FILE_MakeDir(path);
+
+  strcpy(seq_file_new_session_name, session);
+  if( (status=SEQ_FILE_Format()) < 0 ) {
+    printf("ERROR: failed to create session %s (status %d)\n", session, status);
+    return -3;
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  char *image_file = (argc >= 2) ? argv[1] : DEFAULT_IMAGE_FILE;
+  char *session = (argc >= 3) ? argv[2] : DEFAULT_SESSION;
+  u32 num_ticks = (argc >= 4) ? strtoul(argv[3], NULL, 0) : DEFAULT_TICKS;
+  s32 status;
+  u8 group;
+
+  if( num_ticks == 0 || strlen(session) > 8 ) {
+    printf("Usage: %s [<image-file> [<session> [<ticks>]]]\n", argv[0]);
+    return 1;
+  }
+
+  SEQ_MIDI_OUT_Init(0);
+  SEQ_MIXER_Init(0);
+  SEQ_CORE_Init(0);
+  SEQ_FILE_Init(0);
+
+  if( (status=HOST_SDCARD_ImageOpen(image_file, IMAGE_SECTORS)) < 0 ) {
+    printf("ERROR: can't open image file %s (status %d)\n", image_file, status);
+    return 1;
+  }
+
+  if( status == 1 ) {
+    printf("Creating session %s in new image %s\n", session, image_file);
+    if( CreateSession(session) < 0 )
+      return 1;
+    // start from scratch, so that all patterns are taken from the banks
+    SEQ_CORE_Init(0);
+  } else {
+    if( SEQ_FILE_CheckSDCard() < 0 || !SEQ_FILE_VolumeAvailable() ) {
+      printf("ERROR: failed to mount image %s\n", image_file);
+      return 1;
+    }
+  }
+
+  // load the banks of the session
+  strcpy(seq_file_session_name, session);
+  SEQ_FILE_B_LoadAllBanks(seq_file_session_name);
+
+  u32 *tick_time = (u32 *)malloc(num_ticks * sizeof(u32));
+  if( tick_time == NULL ) {
+    printf("ERROR: out of memory\n");
+    return 1;
+  }
+
+  printf("Session:         %s (%s)\n", session, image_file);
+  printf("Ticks:           %u\n", num_ticks);
+
+  // run the sequencer with batched and unbatched scheduling of Roll/Echo events
+  // the output has to be identical
+  u32 checksum[2];
+  int run;
+  for(run=0; run<2; ++run) {
+    // start from scratch, and take the first pattern of the bank
+    // which is assigned to the group
+    SEQ_CORE_Init(0);
+    seq_core_batch_send = (run == 0);
+
+    for(group=0; group<SEQ_CORE_NUM_GROUPS; ++group) {
+      seq_pattern_t pattern;
+      pattern.ALL = 0;
+      pattern.bank = group;
+      pattern.pattern = 0;
+      if( (status=SEQ_PATTERN_Load(group, pattern)) < 0 ) {
+	printf("ERROR: failed to load pattern %d:%d of session %s (status %d)\n",
+	       pattern.bank+1, pattern.pattern+1, session, status);
+	return 1;
+      }
+    }
+
+    HOST_MIDI_Reset();
+    SEQ_STATISTICS_StopwatchInit();
+    seq_midi_out_max_allocated = 0;
+    seq_midi_out_dropouts = 0;
+
+    SEQ_BPM_Start();
+    SEQ_CORE_Handler(); // handles the start request
+
+    unsigned long long total_start = TimeGet();
+    u32 tick;
+    for(tick=0; tick<num_ticks; ++tick) {
+      unsigned long long t0 = TimeGet();
+      bpm_tick = tick;
+      bpm_req_clk = 1;
+      SEQ_CORE_Handler();
+      SEQ_MIDI_OUT_Handler();
+      tick_time[tick] = (u32)(TimeGet() - t0);
+    }
+    unsigned long long total_time = TimeGet() - total_start;
+
+    SEQ_CORE_PlayOffEvents();
+    checksum[run] = HOST_MIDI_ChecksumGet();
+
+    qsort(tick_time, num_ticks, sizeof(u32), CompareU32);
+
+    printf("%s Roll/Echo events:\n", seq_core_batch_send ? "Batched" : "Unbatched");
+    printf("  Time:            %llu.%03llu mS\n", total_time / 1000000, (total_time / 1000) % 1000);
+    printf("  Ticks/sec:       %.0f\n", (double)num_ticks * 1e9 / (double)total_time);
+    printf("  MIDI events:     %u (checksum %08x)\n", HOST_MIDI_PackagesGet(), checksum[run]);
+    printf("  Scheduler:       %u allocated, %u max, %u drops\n",
+	   seq_midi_out_allocated, seq_midi_out_max_allocated, seq_midi_out_dropouts);
+    printf("  Tick latency:    p50 %u nS, p90 %u nS, p99 %u nS, max %u nS\n",
+	   tick_time[num_ticks/2], tick_time[(u32)((unsigned long long)num_ticks*90/100)],
+	   tick_time[(u32)((unsigned long long)num_ticks*99/100)], tick_time[num_ticks-1]);
+    printf("  Stopwatch:       %u nS average, %u nS max (SEQ_CORE_Tick)\n",
+	   HOST_STOPWATCH_AverageGet(), SEQ_STATISTICS_StopwatchGetValueMax());
+  }
+
+  HOST_SDCARD_ImageClose();
+  free(tick_time);
+
+  if( checksum[0] != checksum[1] ) {
+    printf("FAILED: batched and unbatched output differ\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -338,6 +338,20 @@ s32 MIOS32_UART_TxBufferPut(u8 uart, u8 b)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Buffer statistics are not provided by the emulation
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_UART_BufferStatsGet(u8 uart, mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats)
+{
+  return -1; // not supported
+}
+
+s32 MIOS32_UART_BufferStatsReset(u8 uart)
+{
+  return -1; // not supported
+}
+
+
 //s32   MIOS32_MIDI_SendByteToRxCallback(UART0, b);
 
 /*
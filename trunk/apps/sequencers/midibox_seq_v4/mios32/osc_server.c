@@ -44,6 +44,11 @@ static struct uip_udp_conn *osc_conn[OSC_SERVER_NUM_CONNECTIONS];
 
 static mios32_osc_search_tree_t parse_root[];
 
+#if OSC_SERVER_SEARCH_TABLE_SLOTS
+static mios32_osc_search_table_entry_t parse_slots[OSC_SERVER_SEARCH_TABLE_SLOTS];
+static mios32_osc_search_table_t parse_table;
+#endif
+
 static u8 *osc_send_packet;
 static u32 osc_send_len;
 
@@ -63,6 +68,18 @@ s32 OSC_SERVER_Init(u32 mode)
   // disable send packet
   osc_send_packet = NULL;
 
+#if OSC_SERVER_SEARCH_TABLE_SLOTS
+  // compile the search tree
+  // if it doesn't fit into the table, MIOS32_OSC_ParsePacketTable() will use the tree
+  if( MIOS32_OSC_SearchTableCompile(&parse_table, parse_slots, OSC_SERVER_SEARCH_TABLE_SLOTS, parse_root) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    MUTEX_MIDIOUT_TAKE;
+    DEBUG_MSG("[OSC_SERVER] search table too small, using search tree\n");
+    MUTEX_MIDIOUT_GIVE;
+#endif
+  }
+#endif
+
   // remove open connections
   for(con=0; con<OSC_SERVER_NUM_CONNECTIONS; ++con)
     if( osc_conn[con] != NULL )
@@ -255,7 +272,11 @@ s32 OSC_SERVER_AppCall(void)
       MIOS32_MIDI_SendDebugHexDump((u8 *)uip_appdata, uip_len);
       MUTEX_MIDIOUT_GIVE;
 #endif
+#if OSC_SERVER_SEARCH_TABLE_SLOTS
+      s32 status = MIOS32_OSC_ParsePacketTable((u8 *)uip_appdata, uip_len, &parse_table);
+#else
       s32 status = MIOS32_OSC_ParsePacket((u8 *)uip_appdata, uip_len, parse_root);
+#endif
       if( status < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 2
 	MUTEX_MIDIOUT_TAKE;
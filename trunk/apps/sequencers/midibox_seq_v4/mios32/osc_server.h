@@ -37,6 +37,13 @@
 #define OSC_REMOTE_PORT 10001
 #endif
 
+// number of slots of the compiled OSC search table (8 bytes each, power of two)
+// 0 disables the table to save RAM, the search tree will be used instead
+// can be overruled in mios32_config.h
+#ifndef OSC_SERVER_SEARCH_TABLE_SLOTS
+#define OSC_SERVER_SEARCH_TABLE_SLOTS 256
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -12,6 +12,7 @@
  * ==========================================================================
  */
 
+#include <string.h>
 #include "MbSidAsid.h"
 
 
@@ -41,6 +42,20 @@ MbSidAsid::MbSidAsid()
     asid_cmd = 0;
     asid_stream_ix = 0;
     asid_reg_ix = 0;
+    asid_frame.numWrites = 0;
+
+    asid_buffer_wr = 0;
+    asid_buffer_rd = 0;
+    asid_jitter_depth = MBSID_ASID_JITTER_DEPTH;
+    asid_prefill = true;
+
+    asid_time_us = 0;
+    asid_tick_period_us = 1000;
+    asid_arrival_num = 0;
+    asid_frame_period_us = 20000; // 50 Hz (PAL) until the sender rate is known
+    asid_playout_us = 0;
+
+    memset(&asid_stats, 0, sizeof(mbsid_asid_stats_t));
 
     modeSet(MBSID_ASID_MODE_OFF);
 }
@@ -76,8 +91,13 @@ bool MbSidAsid::parse(mios32_midi_port_t port, u8 midi_in)
     asid_last_sysex_port = port;
 
     // clear state if status byte (like 0xf0 or 0xf7...) has been received
-    if( midi_in & (1 << 7) )
+    if( midi_in & (1 << 7) ) {
+        // sequence completed
+        if( asid_state == MBSID_ASID_STATE_DATA && asid_cmd == 0x4e )
+            frameEnd();
+
         asid_state = MBSID_ASID_STATE_SYX0;
+    }
 
     // check SysEx sequence
     switch( asid_state ) {
@@ -111,6 +131,7 @@ bool MbSidAsid::parse(mios32_midi_port_t port, u8 midi_in)
                 modeSet(MBSID_ASID_MODE_ON);
             asid_stream_ix = 0;
             asid_reg_ix = 0;
+            asid_frame.numWrites = 0;
             break;
 
         case 0x4f: // LCD
@@ -149,6 +170,60 @@ bool MbSidAsid::parse(mios32_midi_port_t port, u8 midi_in)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// This function decodes a complete SysEx message at once, which is faster
+// than forwarding it byte by byte to parse() if the MIDI driver delivers
+// whole messages (e.g. USB)
+// Only sequence commands are handled here, returns false if the message
+// has to be forwarded to parse()
+/////////////////////////////////////////////////////////////////////////////
+bool MbSidAsid::parseBuffer(mios32_midi_port_t port, u8 *buffer, u32 len)
+{
+    if( len < 4 || buffer[0] != 0xf0 || buffer[1] != 0x2d || buffer[2] != 0x4e || buffer[len-1] != 0xf7 )
+        return false;
+
+    // byte parser busy with another message, or another device already streams
+    if( asid_state != MBSID_ASID_STATE_SYX0 ||
+        (asid_mode != MBSID_ASID_MODE_OFF && port != asid_last_sysex_port) )
+        return false;
+
+    asid_last_sysex_port = port;
+
+    // ensure that SID player is properly initialized (some players don't send start command!)
+    if( asid_mode == MBSID_ASID_MODE_OFF )
+        modeSet(MBSID_ASID_MODE_ON);
+
+    u8 *data = &buffer[3];
+    u32 data_len = len - 4;
+
+    asid_frame.numWrites = 0;
+    if( data_len > 8 ) {
+        u8 *masks = &data[0];
+        u8 *msbs = &data[4];
+        u8 *value = &data[8];
+        u32 num_values = data_len - 8;
+
+        for(u8 reg_ix=0; reg_ix<sizeof(asid_reg_map) && num_values; ++reg_ix) {
+            u8 mask = 1 << (reg_ix % 7);
+            if( masks[reg_ix/7] & mask ) {
+                u8 sid_value = *value++;
+                if( msbs[reg_ix/7] & mask )
+                    sid_value |= (1 << 7);
+
+                asid_frame.reg[asid_frame.numWrites] = asid_reg_map[reg_ix];
+                asid_frame.value[asid_frame.numWrites] = sid_value;
+                ++asid_frame.numWrites;
+                --num_values;
+            }
+        }
+    }
+
+    frameEnd();
+
+    return true; // don't forward message
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // This function is called from NOTIFY_MIDI_TimeOut() in app.c if the 
 // MIDI parser runs into timeout
@@ -174,6 +249,122 @@ mbsid_asid_mode_t MbSidAsid::modeGet(void)
 void MbSidAsid::modeSet(mbsid_asid_mode_t mode)
 {
     asid_mode = mode;
+    bufferFlush();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Jitter Buffer Control
+/////////////////////////////////////////////////////////////////////////////
+void MbSidAsid::jitterDepthSet(u8 depth)
+{
+    if( depth > MBSID_ASID_BUFFER_SIZE )
+        depth = MBSID_ASID_BUFFER_SIZE;
+
+    asid_jitter_depth = depth;
+    bufferFlush();
+}
+
+u8 MbSidAsid::jitterDepthGet(void)
+{
+    return asid_jitter_depth;
+}
+
+void MbSidAsid::tickPeriodSet(u32 periodUs)
+{
+    asid_tick_period_us = periodUs;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Discards all buffered frames, playout starts again once the buffer
+// has been filled
+/////////////////////////////////////////////////////////////////////////////
+void MbSidAsid::bufferFlush(void)
+{
+    MIOS32_IRQ_Disable();
+    asid_buffer_rd = asid_buffer_wr;
+    asid_prefill = true;
+    asid_arrival_num = 0;
+    MIOS32_IRQ_Enable();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Should be called periodically from the sound engine timer (see
+// tickPeriodSet()) while ASID mode is active
+// Buffered frames are played out at the estimated frame rate of the sender
+/////////////////////////////////////////////////////////////////////////////
+void MbSidAsid::tick(void)
+{
+    asid_time_us += asid_tick_period_us;
+
+    u8 num = asid_buffer_wr - asid_buffer_rd;
+    if( asid_prefill ) {
+        if( !num || num < asid_jitter_depth )
+            return; // wait until buffer is filled
+
+        asid_prefill = false;
+        asid_playout_us = asid_frame_period_us; // first frame is played immediately
+    } else {
+        asid_playout_us += asid_tick_period_us;
+    }
+
+    // the period is corrected if the number of buffered frames differs from
+    // the requested depth (e.g. sender slightly faster or slower than our estimation)
+    u32 period = asid_frame_period_us;
+    if( num > asid_jitter_depth )
+        period -= (period / 32) * (num - asid_jitter_depth);
+    else if( num < asid_jitter_depth )
+        period += (period / 32) * (asid_jitter_depth - num);
+
+    if( asid_playout_us < period )
+        return;
+
+    if( !num ) {
+        // buffer ran empty: fill it again
+        ++asid_stats.underruns;
+        asid_prefill = true;
+        return;
+    }
+
+    frameApply(&asid_buffer[asid_buffer_rd % MBSID_ASID_BUFFER_SIZE]);
+    ++asid_buffer_rd;
+    ++asid_stats.framesPlayed;
+    asid_playout_us -= period;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Statistics
+/////////////////////////////////////////////////////////////////////////////
+void MbSidAsid::statsGet(mbsid_asid_stats_t *stats)
+{
+    *stats = asid_stats;
+    stats->framePeriodUs = asid_frame_period_us;
+    stats->depth = asid_buffer_wr - asid_buffer_rd;
+}
+
+void MbSidAsid::printStatistics(void)
+{
+    if( asid_mode == MBSID_ASID_MODE_OFF )
+        return;
+
+    mbsid_asid_stats_t stats;
+    statsGet(&stats);
+
+    u32 rate_x10 = stats.framePeriodUs ? (10000000 / stats.framePeriodUs) : 0;
+    if( asid_jitter_depth ) {
+        DEBUG_MSG((char *)"[ASID] %d.%d Hz, buffer %d/%d (max %d), %d frames, %d underruns, %d overflows\n",
+                  rate_x10 / 10, rate_x10 % 10,
+                  stats.depth, asid_jitter_depth, stats.maxDepth,
+                  stats.framesReceived, stats.underruns, stats.overflows);
+    } else {
+        DEBUG_MSG((char *)"[ASID] %d.%d Hz, %d frames (jitter buffer disabled)\n",
+                  rate_x10 / 10, rate_x10 % 10, stats.framesReceived);
+    }
+
+    asid_stats.maxDepth = 0;
 }
 
 
@@ -200,13 +391,10 @@ void MbSidAsid::newData(u8 midi_in)
                 if( asid_msbs[asid_reg_ix/7] & (1 << (asid_reg_ix % 7)) )
                     sid_value |= (1 << 7);
 
-                sid_regs_t *sid_l = (sid_regs_t *)&sid_regs[0];
-                sid_regs_t *sid_r = (sid_regs_t *)&sid_regs[1];
-                u8 sid_reg = asid_reg_map[asid_reg_ix];
-
-                sid_l->ALL[sid_reg] = sid_value;
-                sid_r->ALL[sid_reg] = sid_value;
-                SID_Update(0);
+                // registers are written once the sequence is complete (frameEnd())
+                asid_frame.reg[asid_frame.numWrites] = asid_reg_map[asid_reg_ix];
+                asid_frame.value[asid_frame.numWrites] = sid_value;
+                ++asid_frame.numWrites;
 
                 taken = 1;
             }
@@ -218,3 +406,91 @@ void MbSidAsid::newData(u8 midi_in)
 
     ++asid_stream_ix;
 }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Called when a sequence has been received completely
+// The frame is either played immediately, or stored in the jitter buffer
+/////////////////////////////////////////////////////////////////////////////
+void MbSidAsid::frameEnd(void)
+{
+    ++asid_stats.framesReceived;
+
+    // estimate the frame period of the sender over the last frames, so that
+    // bunched frames (e.g. from USB drivers) are averaged
+    // the measurement restarts after pauses (e.g. player stopped)
+    u32 now = asid_time_us;
+    if( asid_arrival_num ) {
+        u32 last = asid_arrival_us[(asid_arrival_num-1) % MBSID_ASID_RATE_WINDOW];
+        if( (now - last) >= 100000 )
+            asid_arrival_num = 0;
+    }
+
+    if( asid_arrival_num >= 4 ) { // ignore the first intervals
+        u8 num = (asid_arrival_num > MBSID_ASID_RATE_WINDOW) ? MBSID_ASID_RATE_WINDOW : asid_arrival_num;
+        u32 first = asid_arrival_us[(asid_arrival_num - num) % MBSID_ASID_RATE_WINDOW];
+        u32 period = (now - first) / num;
+        asid_frame_period_us = (period < asid_tick_period_us) ? asid_tick_period_us : period;
+    }
+
+    asid_arrival_us[asid_arrival_num % MBSID_ASID_RATE_WINDOW] = now;
+    if( ++asid_arrival_num >= 2*MBSID_ASID_RATE_WINDOW )
+        asid_arrival_num -= MBSID_ASID_RATE_WINDOW;
+
+    if( !asid_jitter_depth ) {
+        frameApply(&asid_frame);
+        ++asid_stats.framesPlayed;
+        return;
+    }
+
+    // buffer full: the oldest frame is played immediately
+    if( (u8)(asid_buffer_wr - asid_buffer_rd) >= MBSID_ASID_BUFFER_SIZE ) {
+        MIOS32_IRQ_Disable();
+        if( (u8)(asid_buffer_wr - asid_buffer_rd) >= MBSID_ASID_BUFFER_SIZE ) {
+            frameApply(&asid_buffer[asid_buffer_rd % MBSID_ASID_BUFFER_SIZE]);
+            ++asid_buffer_rd;
+            ++asid_stats.framesPlayed;
+            ++asid_stats.overflows;
+        }
+        MIOS32_IRQ_Enable();
+    }
+
+    memcpy(&asid_buffer[asid_buffer_wr % MBSID_ASID_BUFFER_SIZE], &asid_frame, sizeof(mbsid_asid_frame_t));
+    ++asid_buffer_wr;
+
+    u8 depth = asid_buffer_wr - asid_buffer_rd;
+    if( depth > asid_stats.maxDepth )
+        asid_stats.maxDepth = depth;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes the registers of a frame into both SIDs of the first core
+/////////////////////////////////////////////////////////////////////////////
+void MbSidAsid::frameApply(mbsid_asid_frame_t *frame)
+{
+    sid_regs_t *sid_l = (sid_regs_t *)&sid_regs[0];
+    sid_regs_t *sid_r = (sid_regs_t *)&sid_regs[1];
+    u32 written = 0;
+
+    for(int i=0; i<frame->numWrites; ++i) {
+        u8 sid_reg = frame->reg[i];
+        u32 mask = 1 << sid_reg;
+
+        // the control registers can be written twice within a frame (e.g. to
+        // retrigger the gate): the first value has to reach the SID before
+        if( written & mask ) {
+            SID_Update(0);
+            written = 0;
+        }
+
+        sid_l->ALL[sid_reg] = frame->value[i];
+        sid_r->ALL[sid_reg] = frame->value[i];
+        SID_REGS_DIRTY_SET(sid_l, mask);
+        SID_REGS_DIRTY_SET(sid_r, mask);
+        written |= mask;
+    }
+
+    if( written )
+        SID_Update(0);
+}
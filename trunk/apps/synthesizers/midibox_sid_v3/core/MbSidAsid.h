@@ -19,6 +19,27 @@
 #include "MbSidStructs.h"
 
 
+// optional jitter buffer: number of frames which are buffered before they are
+// played out at the estimated frame rate of the sender (0: frames are played immediately)
+// can be changed during runtime with jitterDepthSet()
+#ifndef MBSID_ASID_JITTER_DEPTH
+#define MBSID_ASID_JITTER_DEPTH 0
+#endif
+
+// maximum number of frames in the jitter buffer (each frame allocates 57 bytes)
+// has to be a power of two
+#ifndef MBSID_ASID_BUFFER_SIZE
+#define MBSID_ASID_BUFFER_SIZE 8
+#endif
+
+// number of frames over which the frame period of the sender is measured
+// has to be a power of two
+#define MBSID_ASID_RATE_WINDOW 16
+
+// maximum number of register writes per frame (size of the ASID register map)
+#define MBSID_ASID_FRAME_WRITES 28
+
+
 // command states
 typedef enum {
     MBSID_ASID_STATE_SYX0,
@@ -35,6 +56,26 @@ typedef enum {
 } mbsid_asid_mode_t;
 
 
+// decoded register writes of a single sequence command
+typedef struct {
+    u8 numWrites;
+    u8 reg[MBSID_ASID_FRAME_WRITES];
+    u8 value[MBSID_ASID_FRAME_WRITES];
+} mbsid_asid_frame_t;
+
+
+// jitter buffer statistics
+typedef struct {
+    u32 framesReceived;
+    u32 framesPlayed;
+    u32 underruns;
+    u32 overflows;
+    u32 framePeriodUs; // estimated frame period of the sender
+    u8 depth;          // current number of buffered frames
+    u8 maxDepth;       // maximum number since last printStatistics()
+} mbsid_asid_stats_t;
+
+
 class MbSidAsid
 {
 public:
@@ -49,8 +90,29 @@ public:
     mbsid_asid_mode_t modeGet(void);
     void modeSet(mbsid_asid_mode_t mode);
 
+    // decodes a complete SysEx message at once (F0 2D ... F7)
+    // returns false if the message has to be forwarded to parse() byte by byte
+    bool parseBuffer(mios32_midi_port_t port, u8 *buffer, u32 len);
+
+    // should be called from the sound engine timer, plays out buffered frames
+    void tick(void);
+
+    // period of tick() calls in uS
+    void tickPeriodSet(u32 periodUs);
+
+    // jitter buffer control (0: frames are played immediately)
+    void jitterDepthSet(u8 depth);
+    u8 jitterDepthGet(void);
+
+    // statistics
+    void statsGet(mbsid_asid_stats_t *stats);
+    void printStatistics(void); // via DEBUG_MSG, only if ASID mode active
+
 protected:
     void newData(u8 midi_in);
+    void frameEnd(void);
+    void frameApply(mbsid_asid_frame_t *frame);
+    void bufferFlush(void);
 
     mbsid_asid_mode_t asid_mode;
     mbsid_asid_state_t asid_state;
@@ -60,6 +122,26 @@ protected:
     u8 asid_reg_ix;
     u8 asid_masks[4];
     u8 asid_msbs[4];
+
+    // frame which is currently decoded
+    mbsid_asid_frame_t asid_frame;
+
+    // jitter buffer (single producer: MIDI parser, single consumer: tick())
+    // the free running indices are only incremented by their owner
+    mbsid_asid_frame_t asid_buffer[MBSID_ASID_BUFFER_SIZE];
+    volatile u8 asid_buffer_wr;
+    volatile u8 asid_buffer_rd;
+    u8 asid_jitter_depth;
+    bool asid_prefill;
+
+    volatile u32 asid_time_us;
+    u32 asid_tick_period_us;
+    u32 asid_arrival_us[MBSID_ASID_RATE_WINDOW]; // arrival times of the last frames
+    u8 asid_arrival_num;
+    u32 asid_frame_period_us;
+    u32 asid_playout_us;
+
+    mbsid_asid_stats_t asid_stats;
 };
 
 #endif /* _MB_SID_ASID_H */
@@ -0,0 +1,410 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * MIDIbox SID Patch Banks
+ * Bank A is available in ROM, with MBSID_USE_BANK_FILES all banks can be
+ * stored on SD Card
+ *
+ * Patches of bank files are read via a small LRU cache. After a program
+ * change the neighbouring patches are requested with prefetchRequest(), and
+ * loaded by prefetchHandler() from a low priority task, so that the next
+ * program change can be served from RAM without SD Card access.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <string.h>
+#include "MbSidBank.h"
+#include "MbSidTables.h"
+
+#if MBSID_USE_BANK_FILES
+#include "sid_file.h"
+#include "sid_file_b.h"
+#include "tasks.h"
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
+// should be at least 1 for sending error messages
+/////////////////////////////////////////////////////////////////////////////
+#define DEBUG_VERBOSE_LEVEL 1
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+#include "sid_bank_preset_a.inc"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor
+/////////////////////////////////////////////////////////////////////////////
+MbSidBank::MbSidBank()
+{
+    cacheHits = 0;
+    cacheMisses = 0;
+    prefetchLoads = 0;
+
+#if MBSID_USE_BANK_FILES
+    accessCtr = 0;
+    prefetchBank = 0;
+    prefetchNum = 0;
+
+    for(int slot=0; slot<MBSID_BANK_CACHE_SIZE; ++slot)
+        cache[slot].loading = false;
+    cacheInvalidate();
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Destructor
+/////////////////////////////////////////////////////////////////////////////
+MbSidBank::~MbSidBank()
+{
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reads a patch
+// the target is only changed if the patch is available
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidBank::patchRead(u8 bank, u8 patch, sid_patch_t *p)
+{
+    if( bank >= MBSID_BANK_NUM )
+        return -2; // invalid bank
+
+    if( patch >= MBSID_BANK_NUM_PATCHES )
+        return -3; // invalid patch
+
+#if MBSID_USE_BANK_FILES
+    if( !bankInRom(bank) ) {
+        if( !SID_FILE_B_NumPatches(bank) )
+            return -4; // no bank file
+
+        MIOS32_IRQ_Disable();
+        s32 slot = cacheLookup(bank, patch);
+        if( slot >= 0 ) {
+            cache[slot].lastAccess = ++accessCtr;
+            memcpy(p->ALL, cache[slot].body.ALL, sizeof(sid_patch_t));
+        }
+        MIOS32_IRQ_Enable();
+
+        if( slot >= 0 ) {
+            ++cacheHits;
+            return 0; // no error
+        }
+
+        ++cacheMisses;
+        return (cacheLoad(bank, patch, p) < 0) ? -5 : 0;
+    }
+#endif
+
+    memcpy(p->ALL, sid_bank_preset_0[patch], sizeof(sid_patch_t));
+
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes a patch
+// A bank file which doesn't exist yet will be created
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidBank::patchWrite(u8 bank, u8 patch, sid_patch_t *p)
+{
+    if( bank >= MBSID_BANK_NUM )
+        return -2; // invalid bank
+
+    if( patch >= MBSID_BANK_NUM_PATCHES )
+        return -3; // invalid patch
+
+#if !MBSID_USE_BANK_FILES
+    return -4; // ROM bank can't be written
+#else
+    s32 status = 0;
+
+    MUTEX_SDCARD_TAKE;
+    if( !SID_FILE_B_NumPatches(bank) ) {
+        if( !SID_FILE_VolumeAvailable() ) {
+            status = -4; // no SD Card
+        } else {
+            // bank A starts with the ROM patches, all others with the lead preset
+            if( bank == 0 )
+                status = SID_FILE_B_Create(bank, &sid_bank_preset_0[0][0], MBSID_BANK_NUM_PATCHES);
+            else
+                status = SID_FILE_B_Create(bank, mbSidPatchPresetLead, 1);
+#if DEBUG_VERBOSE_LEVEL >= 1
+            if( status < 0 )
+                DEBUG_MSG("[MbSidBank] failed to create bank %c (status %d)\n", 'A'+bank, status);
+#endif
+        }
+    }
+
+    if( status >= 0 )
+        status = SID_FILE_B_PatchWrite(bank, patch, p->ALL);
+    MUTEX_SDCARD_GIVE;
+
+    if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+        DEBUG_MSG("[MbSidBank] failed to write patch %c%03d (status %d)\n", 'A'+bank, patch+1, status);
+#endif
+        return (status == -4) ? -4 : -5;
+    }
+
+    // write-through: the cache always contains the stored patch
+    MIOS32_IRQ_Disable();
+    bool cached = false;
+    mbsid_bank_cache_slot_t *slot = &cache[0];
+    for(int i=0; i<MBSID_BANK_CACHE_SIZE; ++i, ++slot) {
+        if( slot->bank == bank && slot->patch == patch ) {
+            memcpy(slot->body.ALL, p->ALL, sizeof(sid_patch_t));
+            slot->lastAccess = ++accessCtr;
+            cached = true;
+        }
+    }
+
+    if( !cached ) {
+        s32 victim = cacheVictimGet();
+        if( victim >= 0 ) {
+            cache[victim].bank = bank;
+            cache[victim].patch = patch;
+            cache[victim].lastAccess = ++accessCtr;
+            memcpy(cache[victim].body.ALL, p->ALL, sizeof(sid_patch_t));
+        }
+    }
+    MIOS32_IRQ_Enable();
+
+    return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns the name of a patch as zero-terminated C string (17 chars)
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidBank::patchNameGet(u8 bank, u8 patch, char *buffer)
+{
+    int i;
+    const u8 *name;
+
+    if( bank >= MBSID_BANK_NUM ) {
+        sprintf(buffer, "<Invalid Bank %c>", 'A'+bank);
+        return -1; // invalid bank
+    }
+
+    if( patch >= MBSID_BANK_NUM_PATCHES ) {
+        sprintf(buffer, "<WrongPatch %03d>", patch);
+        return -2; // invalid patch
+    }
+
+#if MBSID_USE_BANK_FILES
+    if( !bankInRom(bank) ) {
+        char fileName[17];
+
+        // take the name from the cache if possible, without loading the patch
+        MIOS32_IRQ_Disable();
+        s32 slot = cacheLookup(bank, patch);
+        if( slot >= 0 )
+            memcpy(fileName, cache[slot].body.name, 16);
+        MIOS32_IRQ_Enable();
+
+        if( slot < 0 ) {
+            s32 status;
+            MUTEX_SDCARD_TAKE;
+            status = SID_FILE_B_PatchPeekName(bank, patch, fileName);
+            MUTEX_SDCARD_GIVE;
+
+            if( status < 0 ) {
+                sprintf(buffer, "<Empty Bank %c>  ", 'A'+bank);
+                return -3; // no bank file
+            }
+        }
+
+        for(i=0; i<16; ++i)
+            buffer[i] = fileName[i] >= 0x20 ? fileName[i] : ' ';
+        buffer[i] = 0;
+
+        return 0; // no error
+    }
+#endif
+
+    name = sid_bank_preset_0[patch];
+    for(i=0; i<16; ++i)
+        buffer[i] = name[i] >= 0x20 ? name[i] : ' ';
+    buffer[i] = 0;
+
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Requests the neighbours of the selected patch
+// The next patch in the direction of the last program change is loaded
+// first, thereafter the previous one and the one after the next
+/////////////////////////////////////////////////////////////////////////////
+void MbSidBank::prefetchRequest(u8 bank, u8 patch, s8 direction)
+{
+#if MBSID_USE_BANK_FILES
+    if( direction == 0 )
+        direction = 1;
+
+    s16 candidate[MBSID_BANK_PREFETCH_NUM] = {
+        (s16)(patch + direction),
+        (s16)(patch - direction),
+        (s16)(patch + 2*direction)
+    };
+
+    MIOS32_IRQ_Disable();
+    prefetchBank = bank;
+    prefetchNum = 0;
+    // the handler takes the patches from the end of the list
+    for(int i=MBSID_BANK_PREFETCH_NUM-1; i>=0; --i) {
+        if( candidate[i] >= 0 && candidate[i] < MBSID_BANK_NUM_PATCHES )
+            prefetchPatch[prefetchNum++] = candidate[i];
+    }
+    MIOS32_IRQ_Enable();
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads the next requested patch which isn't cached yet
+/////////////////////////////////////////////////////////////////////////////
+void MbSidBank::prefetchHandler(void)
+{
+#if MBSID_USE_BANK_FILES
+    s32 patch = -1;
+
+    MIOS32_IRQ_Disable();
+    u8 bank = prefetchBank;
+    while( prefetchNum ) {
+        u8 candidate = prefetchPatch[--prefetchNum];
+        if( cacheLookup(bank, candidate) < 0 ) {
+            patch = candidate;
+            break;
+        }
+    }
+    MIOS32_IRQ_Enable();
+
+    if( patch < 0 || bankInRom(bank) || !SID_FILE_B_NumPatches(bank) )
+        return; // nothing to do
+
+    if( cacheLoad(bank, patch, NULL) >= 0 )
+        ++prefetchLoads;
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Invalidates all cached patches
+/////////////////////////////////////////////////////////////////////////////
+void MbSidBank::cacheInvalidate(void)
+{
+#if MBSID_USE_BANK_FILES
+    MIOS32_IRQ_Disable();
+    for(int slot=0; slot<MBSID_BANK_CACHE_SIZE; ++slot)
+        cache[slot].bank = 0xff;
+    prefetchNum = 0;
+    MIOS32_IRQ_Enable();
+#endif
+}
+
+
+#if MBSID_USE_BANK_FILES
+/////////////////////////////////////////////////////////////////////////////
+// Bank A is read from ROM as long as no bank file exists
+/////////////////////////////////////////////////////////////////////////////
+bool MbSidBank::bankInRom(u8 bank)
+{
+    return bank == 0 && !SID_FILE_B_NumPatches(bank);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the cache slot of a patch, or -1 if not cached
+// should be called with disabled IRQs
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidBank::cacheLookup(u8 bank, u8 patch)
+{
+    mbsid_bank_cache_slot_t *slot = &cache[0];
+    for(int i=0; i<MBSID_BANK_CACHE_SIZE; ++i, ++slot)
+        if( slot->bank == bank && slot->patch == patch )
+            return i;
+
+    return -1; // not cached
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the least recently used slot which isn't loaded currently
+// should be called with disabled IRQs
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidBank::cacheVictimGet(void)
+{
+    s32 victim = -1;
+
+    mbsid_bank_cache_slot_t *slot = &cache[0];
+    for(int i=0; i<MBSID_BANK_CACHE_SIZE; ++i, ++slot) {
+        if( slot->loading )
+            continue;
+
+        if( slot->bank == 0xff )
+            return i; // free slot
+
+        if( victim < 0 || slot->lastAccess < cache[victim].lastAccess )
+            victim = i;
+    }
+
+    return victim;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads a patch from SD Card into the cache, and copies it into p (if not NULL)
+// returns the slot or < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidBank::cacheLoad(u8 bank, u8 patch, sid_patch_t *p)
+{
+    MIOS32_IRQ_Disable();
+    s32 slot = cacheVictimGet();
+    if( slot >= 0 ) {
+        cache[slot].bank = 0xff; // invalid until the patch has been loaded
+        cache[slot].loading = true;
+        cache[slot].lastAccess = ++accessCtr;
+    }
+    MIOS32_IRQ_Enable();
+
+    if( slot < 0 )
+        return -1; // all slots are loaded by other tasks
+
+    s32 status;
+    MUTEX_SDCARD_TAKE;
+    status = SID_FILE_B_PatchRead(bank, patch, cache[slot].body.ALL);
+    MUTEX_SDCARD_GIVE;
+
+    MIOS32_IRQ_Disable();
+    if( status >= 0 ) {
+        cache[slot].bank = bank;
+        cache[slot].patch = patch;
+        if( p != NULL )
+            memcpy(p->ALL, cache[slot].body.ALL, sizeof(sid_patch_t));
+    }
+    cache[slot].loading = false;
+    MIOS32_IRQ_Enable();
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+    if( status < 0 )
+        DEBUG_MSG("[MbSidBank] failed to read patch %c%03d (status %d)\n", 'A'+bank, patch+1, status);
+#endif
+
+    return (status < 0) ? status : slot;
+}
+#endif
@@ -0,0 +1,112 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * MIDIbox SID Patch Banks
+ * Bank A is available in ROM, with MBSID_USE_BANK_FILES all banks can be
+ * stored on SD Card
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _MB_SID_BANK_H
+#define _MB_SID_BANK_H
+
+#include <mios32.h>
+#include "MbSidStructs.h"
+
+
+// patch banks are read from/written to SD Card (sid_file_b.c)
+#ifndef MBSID_USE_BANK_FILES
+#define MBSID_USE_BANK_FILES 0
+#endif
+
+// number of patches which are cached in RAM (each slot allocates 512 bytes)
+#ifndef MBSID_BANK_CACHE_SIZE
+#define MBSID_BANK_CACHE_SIZE 8
+#endif
+
+#if MBSID_USE_BANK_FILES
+#include "sid_file_b.h"
+#define MBSID_BANK_NUM SID_FILE_B_NUM_BANKS
+#else
+#define MBSID_BANK_NUM 1  // only the ROM bank is available
+#endif
+
+#define MBSID_BANK_NUM_PATCHES 128
+
+// number of neighbouring patches which are loaded after a program change
+#define MBSID_BANK_PREFETCH_NUM 3
+
+
+typedef struct {
+    u8 bank; // 0xff: slot not valid
+    u8 patch;
+    bool loading; // slot is currently loaded and can't be taken
+    u32 lastAccess;
+    sid_patch_t body;
+} mbsid_bank_cache_slot_t;
+
+
+class MbSidBank
+{
+public:
+    // Constructor
+    MbSidBank();
+
+    // Destructor
+    ~MbSidBank();
+
+    // patch access
+    // returns < 0 on errors: -2 invalid bank, -3 invalid patch, -4 bank not available, -5 read/write error
+    s32 patchRead(u8 bank, u8 patch, sid_patch_t *p);
+    s32 patchWrite(u8 bank, u8 patch, sid_patch_t *p);
+    s32 patchNameGet(u8 bank, u8 patch, char *buffer);
+
+    // requests the neighbours of the given patch, direction is the
+    // increment of the last program change
+    void prefetchRequest(u8 bank, u8 patch, s8 direction);
+
+    // should be called periodically from a low priority task, loads
+    // a single requested patch per call
+    void prefetchHandler(void);
+
+    // invalidates all cached patches (e.g. on SD Card change)
+    void cacheInvalidate(void);
+
+    // statistics
+    u32 cacheHits;
+    u32 cacheMisses;
+    u32 prefetchLoads;
+
+protected:
+#if MBSID_USE_BANK_FILES
+    // returns true if the patch is served from ROM
+    bool bankInRom(u8 bank);
+
+    // returns the slot of the patch or -1 if not cached
+    s32 cacheLookup(u8 bank, u8 patch);
+
+    // loads a patch into the cache and copies it into p (if not NULL)
+    // returns the slot or < 0 on errors
+    s32 cacheLoad(u8 bank, u8 patch, sid_patch_t *p);
+
+    // takes a slot for a new patch (least recently used)
+    s32 cacheVictimGet(void);
+
+    mbsid_bank_cache_slot_t cache[MBSID_BANK_CACHE_SIZE];
+    u32 accessCtr;
+
+    // pending prefetch request
+    u8 prefetchBank;
+    u8 prefetchPatch[MBSID_BANK_PREFETCH_NUM];
+    u8 prefetchNum;
+#endif
+};
+
+#endif /* _MB_SID_BANK_H */
@@ -17,14 +17,6 @@
 #include <string.h>
 
 
-/////////////////////////////////////////////////////////////////////////////
-// Local variables
-/////////////////////////////////////////////////////////////////////////////
-
-#define SID_BANK_NUM 1  // currently only a single bank is available in ROM
-#include "sid_bank_preset_a.inc"
-
-
 /////////////////////////////////////////////////////////////////////////////
 // Constructor
 /////////////////////////////////////////////////////////////////////////////
@@ -64,6 +56,7 @@ void MbSidEnvironment::updateSpeedFactorSet(u8 _updateSpeedFactor)
 {
     updateSpeedFactor = _updateSpeedFactor;
     mbSidClock.updateSpeedFactor = _updateSpeedFactor;
+    mbSidAsid.tickPeriodSet(2000 / _updateSpeedFactor);
 }
 
 
@@ -74,8 +67,11 @@ bool MbSidEnvironment::tick(void)
 {
     bool updateRequired = false;
 
-    if( mbSidAsid.modeGet() != MBSID_ASID_MODE_OFF )
+    // the sound engines are disabled in ASID mode, only buffered frames are played
+    if( mbSidAsid.modeGet() != MBSID_ASID_MODE_OFF ) {
+        mbSidAsid.tick();
         return false;
+    }
 
     // Tempo Clock
     mbSidClock.tick();
@@ -98,7 +94,16 @@ s32 MbSidEnvironment::bankSave(u8 sid, u8 bank, u8 patch)
     if( sid >= mbSid.size )
         return -1; // SID not available
 
-    return -2; // not supported yet
+    MbSid *s = &mbSid[sid];
+
+    s32 status;
+    if( (status=mbSidBank.patchWrite(bank, patch, &s->mbSidPatch.body)) < 0 )
+        return status; // -2: invalid bank, -3: invalid patch, -4: bank can't be written, -5: write error
+
+    s->mbSidPatch.bankNum = bank;
+    s->mbSidPatch.patchNum = patch;
+
+    return 0; // no error
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -111,25 +116,16 @@ s32 MbSidEnvironment::bankLoad(u8 sid, u8 bank, u8 patch)
 
     MbSid *s = &mbSid[sid];
 
-    if( bank >= SID_BANK_NUM )
-        return -2; // invalid bank
-
-    if( patch >= 128 )
-        return -3; // invalid patch
-
 #if 0
     DEBUG_MSG("[SID_BANK_PatchRead] SID %d reads patch %c%03d\n", sid, 'A'+bank, patch);
 #endif
 
-    switch( bank ) {
-    case 0: {
-        sid_patch_t *bankPatch = (sid_patch_t *)sid_bank_preset_0[patch];
-        s->mbSidPatch.copyToPatch(bankPatch);
-    } break;
+    s32 status;
+    if( (status=mbSidBank.patchRead(bank, patch, &s->mbSidPatch.body)) < 0 )
+        return status; // -2: invalid bank, -3: invalid patch, -4: no bank, -5: read error
 
-    default:
-        return -4; // no bank in ROM
-    }
+    s->mbSidPatch.bankNum = bank;
+    s->mbSidPatch.patchNum = patch;
 
     s->updatePatch(false);
 
@@ -142,34 +138,7 @@ s32 MbSidEnvironment::bankLoad(u8 sid, u8 bank, u8 patch)
 /////////////////////////////////////////////////////////////////////////////
 s32 MbSidEnvironment::bankPatchNameGet(u8 bank, u8 patch, char *buffer)
 {
-    int i;
-    sid_patch_t *p;
-
-    if( bank >= SID_BANK_NUM ) {
-        sprintf(buffer, "<Invalid Bank %c>", 'A'+bank);
-        return -1; // invalid bank
-    }
-
-    if( patch >= 128 ) {
-        sprintf(buffer, "<WrongPatch %03d>", patch);
-        return -2; // invalid patch
-  }
-
-    switch( bank ) {
-    case 0:
-        p = (sid_patch_t *)&sid_bank_preset_0[patch];
-        break;
-
-    default:
-        sprintf(buffer, "<Empty Bank %c>  ", 'A'+bank);
-        return -3; // no bank in ROM
-    }
-
-    for(i=0; i<16; ++i)
-        buffer[i] = p->name[i] >= 0x20 ? p->name[i] : ' ';
-    buffer[i] = 0;
-
-    return 0; // no error
+    return mbSidBank.patchNameGet(bank, patch, buffer);
 }
 
 
@@ -182,8 +151,12 @@ void MbSidEnvironment::midiReceive(mios32_midi_port_t port, mios32_midi_package_
     if( midi_package.event == ProgramChange ) {
         // TODO: check port and channel for program change
         int sid = 0;
-        for(MbSid *s = mbSid.first(); s != NULL ; s=mbSid.next(s), ++sid)
-            bankLoad(sid, s->mbSidPatch.bankNum, midi_package.evnt1);
+        for(MbSid *s = mbSid.first(); s != NULL ; s=mbSid.next(s), ++sid) {
+            u8 bank = s->mbSidPatch.bankNum;
+            s8 direction = (midi_package.evnt1 < s->mbSidPatch.patchNum) ? -1 : 1;
+            if( bankLoad(sid, bank, midi_package.evnt1) >= 0 )
+                mbSidBank.prefetchRequest(bank, midi_package.evnt1, direction); // load neighbours in background
+        }
     } else {
         for(MbSid *s = mbSid.first(); s != NULL ; s=mbSid.next(s))
             s->midiReceive(midi_package);
@@ -207,6 +180,24 @@ s32 MbSidEnvironment::midiReceiveSysEx(mios32_midi_port_t port, u8 midi_in)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// called with a complete SysEx message (F0 ... F7)
+// ASID sequences are decoded at once, all other messages are forwarded
+// to midiReceiveSysEx byte by byte
+/////////////////////////////////////////////////////////////////////////////
+s32 MbSidEnvironment::midiReceiveSysExBuffer(mios32_midi_port_t port, u8 *buffer, u32 len)
+{
+    if( mbSidAsid.parseBuffer(port, buffer, len) )
+        return 1;
+
+    s32 status = 0;
+    for(u32 i=0; i<len; ++i)
+        status |= midiReceiveSysEx(port, buffer[i]);
+
+    return status;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Receives a realtime event to service MbSidClock
 /////////////////////////////////////////////////////////////////////////////
@@ -256,7 +247,7 @@ bool MbSidEnvironment::sysexSetPatch(u8 sid, sid_patch_t *p, bool toBank, u8 ban
         return false;
 
     if( toBank ) {
-        bankSave(sid, bank, patch);
+        mbSidBank.patchWrite(bank, patch, p);
     } else {
         // forward to selected SID
         return mbSid[sid].sysexSetPatch(p);
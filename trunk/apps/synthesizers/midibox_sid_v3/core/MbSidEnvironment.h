@@ -22,6 +22,7 @@
 #include "MbSidSysEx.h"
 #include "MbSidAsid.h"
 #include "MbSidClock.h"
+#include "MbSidBank.h"
 
 class MbSidEnvironment
 {
@@ -60,6 +61,7 @@ public:
     // MIDI
     void midiReceive(mios32_midi_port_t port, mios32_midi_package_t midi_package);
     s32 midiReceiveSysEx(mios32_midi_port_t port, u8 midi_in);
+    s32 midiReceiveSysExBuffer(mios32_midi_port_t port, u8 *buffer, u32 len); // complete message
     void midiReceiveRealTimeEvent(mios32_midi_port_t port, u8 midi_in);
     void midiTimeOut(mios32_midi_port_t port);
 
@@ -74,6 +76,9 @@ public:
 
     // Tempo Clock
     MbSidClock mbSidClock;
+
+    // Patch Banks
+    MbSidBank mbSidBank;
 };
 
 #endif /* _MB_SID_ENVIRONMENT_H */
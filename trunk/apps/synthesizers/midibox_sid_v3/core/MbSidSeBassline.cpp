@@ -41,13 +41,9 @@ void MbSidSeBassline::init(sid_regs_t *sidRegLPtr, sid_regs_t *sidRegRPtr, MbSid
     MbSidVoice *v = mbSidVoice.first();
     for(int voice=0; voice < mbSidVoice.size; ++voice, ++v) {
         u8 physVoice = voice % 3;
-        sid_voice_t *physSidVoice;
-        if( voice >= 3 )
-            physSidVoice = (sid_voice_t *)&sidRegRPtr->v[physVoice];
-        else
-            physSidVoice = (sid_voice_t *)&sidRegLPtr->v[physVoice];
+        sid_regs_t *physSidRegs = (voice >= 3) ? sidRegRPtr : sidRegLPtr;
 
-        v->init(voice, physVoice, physSidVoice);
+        v->init(voice, physVoice, physSidRegs);
     }
 
     // assign SID registers to filters
@@ -216,19 +212,26 @@ bool MbSidSeBassline::tick(const u8 &updateSpeedFactor)
             v->pitch(updateSpeedFactor, this);
         v->pw(updateSpeedFactor, this);
 
+        u8 waveformReg = v->physSidVoice->waveform_reg;
         v->physSidVoice->waveform = v->voiceWaveform;
         v->physSidVoice->sync = v->voiceWaveformSync;
         v->physSidVoice->ringmod = v->voiceWaveformRingmod;
+        if( v->physSidVoice->waveform_reg != waveformReg )
+            v->physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
 
         // don't change ADSR so long delay is active (also important for ABW - ADSR bug workaround)
         if( !v->voiceSetDelayCtr ) {
-            v->physSidVoice->ad = v->voiceAttackDecay.ALL;
+            u8 ad = v->voiceAttackDecay.ALL;
 
             // force sustain to maximum if accent flag active
             u8 sr = v->voiceSustainRelease.ALL;
             if( v->voiceAccentActive )
                 sr |= 0xf0;
-            v->physSidVoice->sr = sr;
+            if( v->physSidVoice->ad != ad || v->physSidVoice->sr != sr ) {
+                v->physSidVoice->ad = ad;
+                v->physSidVoice->sr = sr;
+                v->physSidVoiceDirty(SID_VOICE_DIRTY_AD | SID_VOICE_DIRTY_SR);
+            }
         }
     }
 
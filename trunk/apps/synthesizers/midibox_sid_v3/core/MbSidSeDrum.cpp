@@ -41,13 +41,9 @@ void MbSidSeDrum::init(sid_regs_t *sidRegLPtr, sid_regs_t *sidRegRPtr, MbSidCloc
     MbSidVoiceDrum *v = mbSidVoiceDrum.first();
     for(int voice=0; voice < mbSidVoiceDrum.size; ++voice, ++v) {
         u8 physVoice = voice % 3;
-        sid_voice_t *physSidVoice;
-        if( voice >= 3 )
-            physSidVoice = (sid_voice_t *)&sidRegRPtr->v[physVoice];
-        else
-            physSidVoice = (sid_voice_t *)&sidRegLPtr->v[physVoice];
+        sid_regs_t *physSidRegs = (voice >= 3) ? sidRegRPtr : sidRegLPtr;
 
-        v->init(voice, physVoice, physSidVoice);
+        v->init(voice, physVoice, physSidRegs);
     }
 
     // assign SID registers to filters
@@ -361,7 +357,7 @@ void MbSidSeDrum::noteOff(u8 instrument, u8 note, bool bypassNotestack)
             return;
 
         // iterate through all voices which are assigned to the current instrument
-        MbSidVoice *v = mbSidVoiceDrum.first();
+        MbSidVoiceDrum *v = mbSidVoiceDrum.first();
         for(int voice=0; voice < mbSidVoiceDrum.size; ++voice, ++v) {
             if( v->voiceAssignedInstrument == drum ) {
                 // release voice
@@ -383,7 +379,7 @@ void MbSidSeDrum::noteAllOff(u8 instrument, bool bypassNotestack)
     if( instrument >= 1 )
         return;
 
-    MbSidVoice *v = mbSidVoiceDrum.first();
+    MbSidVoiceDrum *v = mbSidVoiceDrum.first();
     for(int voice=0; voice < mbSidVoiceDrum.size; ++voice, ++v) {
         // release voice
         voiceQueue.release(voice);
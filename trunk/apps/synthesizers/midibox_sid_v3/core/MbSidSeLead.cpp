@@ -41,13 +41,9 @@ void MbSidSeLead::init(sid_regs_t *sidRegLPtr, sid_regs_t *sidRegRPtr, MbSidCloc
     MbSidVoice *v = mbSidVoice.first();
     for(int voice=0; voice < mbSidVoice.size; ++voice, ++v) {
         u8 physVoice = voice % 3;
-        sid_voice_t *physSidVoice;
-        if( voice >= 3 )
-            physSidVoice = (sid_voice_t *)&sidRegRPtr->v[physVoice];
-        else
-            physSidVoice = (sid_voice_t *)&sidRegLPtr->v[physVoice];
+        sid_regs_t *physSidRegs = (voice >= 3) ? sidRegRPtr : sidRegLPtr;
 
-        v->init(voice, physVoice, physSidVoice);
+        v->init(voice, physVoice, physSidRegs);
     }
 
     // assign SID registers to filters
@@ -169,6 +165,9 @@ bool MbSidSeLead::tick(const u8 &updateSpeedFactor)
     mbSidMod.tick();
 
     // Wavetables
+    // the parameter writes of all wavetables are applied at once
+    sid_se_wt_write_t wtRow[4];
+    u8 wtRowNum = 0;
     MbSidWt *w = mbSidWt.first();
     for(int wt=0; wt < mbSidWt.size; ++wt, ++w) {
         s32 step = -1;
@@ -198,17 +197,27 @@ bool MbSidSeLead::tick(const u8 &updateSpeedFactor)
                 mbSidMod.modSrc[SID_SE_MOD_SRC_WT1 + wt] = ((s32)wtValue & 0x7f) * 256;
             }
 
-            // call parameter handler
+            // queue parameter write
             if( w->wtAssign ) {
-                // determine SID channels which should be modified
-                u8 sidlr = w->wtAssignLeftRight; // SID selection
-                u8 ins = wt;
-
-                parSetWT(w->wtAssign, wtValue, sidlr, ins);
+                sid_se_wt_write_t *row = &wtRow[wtRowNum++];
+                row->par = w->wtAssign;
+                row->wtValue = wtValue;
+                row->sidlr = w->wtAssignLeftRight; // SID selection
+                row->ins = wt;
+
+                // WT parameters have to be written before the next WT is clocked
+                if( row->par >= 0xe0 && row->par <= 0xf3 ) {
+                    parSetWTRow(wtRow, wtRowNum);
+                    wtRowNum = 0;
+                }
             }
         }
     }
 
+    // call parameter handler
+    if( wtRowNum )
+        parSetWTRow(wtRow, wtRowNum);
+
     // Arps and Voices
     MbSidVoice *v = mbSidVoice.first();
     for(int voice=0; voice < mbSidVoice.size; ++voice, ++v) {
@@ -221,14 +230,22 @@ bool MbSidSeLead::tick(const u8 &updateSpeedFactor)
             v->pitch(updateSpeedFactor, this);
         v->pw(updateSpeedFactor, this);
 
+        u8 waveformReg = v->physSidVoice->waveform_reg;
         v->physSidVoice->waveform = v->voiceWaveform;
         v->physSidVoice->sync = v->voiceWaveformSync;
         v->physSidVoice->ringmod = v->voiceWaveformRingmod;
+        if( v->physSidVoice->waveform_reg != waveformReg )
+            v->physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
 
         // don't change ADSR so long delay is active (also important for ABW - ADSR bug workaround)
         if( !v->voiceSetDelayCtr ) {
-            v->physSidVoice->ad = v->voiceAttackDecay.ALL;
-            v->physSidVoice->sr = v->voiceSustainRelease.ALL;
+            u8 ad = v->voiceAttackDecay.ALL;
+            u8 sr = v->voiceSustainRelease.ALL;
+            if( v->physSidVoice->ad != ad || v->physSidVoice->sr != sr ) {
+                v->physSidVoice->ad = ad;
+                v->physSidVoice->sr = sr;
+                v->physSidVoiceDirty(SID_VOICE_DIRTY_AD | SID_VOICE_DIRTY_SR);
+            }
         }
     }
 
@@ -718,40 +735,45 @@ void MbSidSeLead::parSet(u8 par, u16 value, u8 sidlr, u8 ins, bool scaleFrom16bi
             if( scaleFrom16bit ) value >>= 14;
             mp->op = (mp->op & 0x3f) | (value << 6);
         }
-    } else if( par <= 0xa7 ) { // LFO
-        MbSidLfo *l = &mbSidLfo[par & 7];
-
-        switch( par & 0xf8 ) {
-        case 0x80: // LFO Waveform
-            if( scaleFrom16bit ) value >>= 12;
-            l->lfoMode.WAVEFORM = value;
-            break;
-
-        case 0x88: // LFO Depth
-            if( scaleFrom16bit ) value >>= 8;
-            l->lfoDepth = (s32)value - 0x80;
-            break;
-
-        case 0x90: // LFO Rate
-            if( scaleFrom16bit ) value >>= 8;
-            l->lfoRate = value;
-            break;
-
-        case 0x98: // LFO Delay
-            if( scaleFrom16bit ) value >>= 8;
-            l->lfoDelay = value;
-            break;
-
-        case 0xa0: // LFO Phase
-            if( scaleFrom16bit ) value >>= 8;
-            l->lfoDelay = value;
-            break;
+        mbSidMod.patchChanged();
+    } else if( par <= 0xbf ) { // LFO
+        // only 6 LFOs, 0xa8..0xbf are not assigned
+        u8 lfo = par & 7;
+        if( par <= 0xa7 && lfo < mbSidLfo.size ) {
+            MbSidLfo *l = &mbSidLfo[lfo];
+
+            switch( par & 0xf8 ) {
+            case 0x80: // LFO Waveform
+                if( scaleFrom16bit ) value >>= 12;
+                l->lfoMode.WAVEFORM = value;
+                break;
+
+            case 0x88: // LFO Depth
+                if( scaleFrom16bit ) value >>= 8;
+                l->lfoDepth = (s32)value - 0x80;
+                break;
+
+            case 0x90: // LFO Rate
+                if( scaleFrom16bit ) value >>= 8;
+                l->lfoRate = value;
+                break;
+
+            case 0x98: // LFO Delay
+                if( scaleFrom16bit ) value >>= 8;
+                l->lfoDelay = value;
+                break;
+
+            case 0xa0: // LFO Phase
+                if( scaleFrom16bit ) value >>= 8;
+                l->lfoPhase = value;
+                break;
+            }
         }
     } else if( par <= 0xdf ) { // ENV
-        MbSidEnvLead *e = &mbSidEnvLead[par & 15];
+        MbSidEnvLead *e = &mbSidEnvLead[(par >> 4) & 1];
         if( scaleFrom16bit ) value >>= 8;
 
-        switch( par & 0xf0 ) {
+        switch( par & 0x0f ) {
         case 0x0: e->envMode.ALL = value; break;
         case 0x1: e->envDepth = (s32)value - 0x80; break;
         case 0x2: e->envDelay = value; break;
@@ -832,22 +854,22 @@ u16 MbSidSeLead::parGet(u8 par, u8 sidlr, u8 ins, bool scaleTo16bit)
             break;
 
         case 0x04: // Filter CutOff
-            value = !(sidlr & 1) ? mbSidFilter[1].filterCutoff : mbSidFilter[1].filterCutoff;
+            value = !(sidlr & 1) ? mbSidFilter[1].filterCutoff : mbSidFilter[0].filterCutoff;
             if( scaleTo16bit ) value <<= 4;
             break;
 
         case 0x05: // Filter Resonance
-            value = !(sidlr & 1) ? mbSidFilter[1].filterResonance : mbSidFilter[1].filterResonance;
+            value = !(sidlr & 1) ? mbSidFilter[1].filterResonance : mbSidFilter[0].filterResonance;
             if( scaleTo16bit ) value <<= 8;
             break;
 
         case 0x06: // Filter Channels
-            value = !(sidlr & 1) ? mbSidFilter[1].filterChannels : mbSidFilter[1].filterChannels;
+            value = !(sidlr & 1) ? mbSidFilter[1].filterChannels : mbSidFilter[0].filterChannels;
             if( scaleTo16bit ) value <<= 12;
             break;
 
         case 0x07: // Filter Mode
-            value = !(sidlr & 1) ? mbSidFilter[1].filterMode : mbSidFilter[1].filterMode;
+            value = !(sidlr & 1) ? mbSidFilter[1].filterMode : mbSidFilter[0].filterMode;
             if( scaleTo16bit ) value <<= 12;
             break;
         }
@@ -881,6 +903,7 @@ u16 MbSidSeLead::parGet(u8 par, u8 sidlr, u8 ins, bool scaleTo16bit)
             waveform.SYNC = v->voiceWaveformSync;
             waveform.RINGMOD = v->voiceWaveformRingmod;
             waveform.WAVEFORM = v->voiceWaveform;
+            value = waveform.ALL;
             if( scaleTo16bit ) value <<= 9;
         } break;
 
@@ -956,39 +979,43 @@ u16 MbSidSeLead::parGet(u8 par, u8 sidlr, u8 ins, bool scaleTo16bit)
             value = mp->op >> 6;
             if( scaleTo16bit ) value <<= 14;
         }
-    } else if( par <= 0xa7 ) { // LFO
-        MbSidLfo *l = &mbSidLfo[par & 7];
-
-        switch( par & 0xf8 ) {
-        case 0x80: // LFO Waveform
-            value = l->lfoMode.WAVEFORM;
-            if( scaleTo16bit ) value <<= 12;
-            break;
-
-        case 0x88: // LFO Depth
-            value = (s32)l->lfoDepth + 0x80;
-            if( scaleTo16bit ) value <<= 8;
-            break;
-
-        case 0x90: // LFO Rate
-            value = l->lfoRate;
-            if( scaleTo16bit ) value <<= 8;
-            break;
-
-        case 0x98: // LFO Delay
-            value = l->lfoDelay;
-            if( scaleTo16bit ) value <<= 8;
-            break;
-
-        case 0xa0: // LFO Phase
-            value = l->lfoDelay;
-            if( scaleTo16bit ) value <<= 8;
-            break;
+    } else if( par <= 0xbf ) { // LFO
+        // only 6 LFOs, 0xa8..0xbf are not assigned
+        u8 lfo = par & 7;
+        if( par <= 0xa7 && lfo < mbSidLfo.size ) {
+            MbSidLfo *l = &mbSidLfo[lfo];
+
+            switch( par & 0xf8 ) {
+            case 0x80: // LFO Waveform
+                value = l->lfoMode.WAVEFORM;
+                if( scaleTo16bit ) value <<= 12;
+                break;
+
+            case 0x88: // LFO Depth
+                value = (s32)l->lfoDepth + 0x80;
+                if( scaleTo16bit ) value <<= 8;
+                break;
+
+            case 0x90: // LFO Rate
+                value = l->lfoRate;
+                if( scaleTo16bit ) value <<= 8;
+                break;
+
+            case 0x98: // LFO Delay
+                value = l->lfoDelay;
+                if( scaleTo16bit ) value <<= 8;
+                break;
+
+            case 0xa0: // LFO Phase
+                value = l->lfoPhase;
+                if( scaleTo16bit ) value <<= 8;
+                break;
+            }
         }
     } else if( par <= 0xdf ) { // ENV
-        MbSidEnvLead *e = &mbSidEnvLead[par & 15];
+        MbSidEnvLead *e = &mbSidEnvLead[(par >> 4) & 1];
 
-        switch( par & 0xf0 ) {
+        switch( par & 0x0f ) {
         case 0x0: value = e->envMode.ALL; break;
         case 0x1: value = (s32)e->envDepth + 0x80; break;
         case 0x2: value = e->envDelay; break;
@@ -1090,6 +1117,16 @@ void MbSidSeLead::parSetWT(u8 par, u8 wtValue, u8 sidlr, u8 ins)
     bool scaleFrom16bit = true;
     parSet(par, parValue, sidlr, ins, scaleFrom16bit);
 }
+/////////////////////////////////////////////////////////////////////////////
+// Sets the parameter values of a complete WT step
+// row contains the write operations of all wavetables which are played
+// in the same update cycle, num the number of entries
+/////////////////////////////////////////////////////////////////////////////
+void MbSidSeLead::parSetWTRow(const sid_se_wt_write_t *row, u8 num)
+{
+    for(int i=0; i<num; ++i, ++row)
+        parSetWT(row->par, row->wtValue, row->sidlr, row->ins);
+}
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1264,7 +1301,8 @@ bool MbSidSeLead::sysexSetParameter(u16 addr, u8 data)
         return true;
     } else if( addr <= 0x13f ) { // Modulation Matrix
         // u8 mod = (addr - 0x100) / 8;
-        // directly read from patch
+        // directly read from patch, the compiled pathes are updated with the next tick
+        mbSidMod.patchChanged();
         return true;
     } else if( addr <= 0x16b ) { // Trigger Matrix
         // u8 trg = (addr - 0x140) / 3;
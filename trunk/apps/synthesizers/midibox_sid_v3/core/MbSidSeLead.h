@@ -63,6 +63,7 @@ public:
     void parSet(u8 par, u16 value, u8 sidlr, u8 ins, bool scaleFrom16bit);
     void parSetNRPN(u8 addr_lsb, u8 addr_msb, u8 data_lsb, u8 data_msb, u8 sidlr, u8 ins);
     void parSetWT(u8 par, u8 wtValue, u8 sidlr, u8 ins);
+    void parSetWTRow(const sid_se_wt_write_t *row, u8 num);
     u16 parGet(u8 par, u8 sidlr, u8 ins, bool scaleTo16bit);
 
 
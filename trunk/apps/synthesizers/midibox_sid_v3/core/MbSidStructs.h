@@ -798,4 +798,17 @@ typedef struct mbsid_knob_t {
 } mbsid_knob_t;
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Parameters
+/////////////////////////////////////////////////////////////////////////////
+
+// WT write operation (see parSetWTRow())
+typedef struct sid_se_wt_write_t {
+  u8 par;
+  u8 wtValue;
+  u8 sidlr;
+  u8 ins;
+} sid_se_wt_write_t;
+
+
 #endif /* _MBSID_STRUCTS_H */
@@ -495,7 +495,7 @@ s32 MbSidSysEx::sendAck(mios32_midi_port_t port, u8 ack_code, u8 ack_arg)
 
     // finally send SysEx stream
     MUTEX_MIDIOUT_TAKE;
-    s32 status = MIOS32_MIDI_SendSysEx(port, (u8 *)sysexBuffer, (u32)sysexBuffer_ptr - ((u32)&sysexBuffer[0]));
+    s32 status = MIOS32_MIDI_SendSysEx(port, (u8 *)sysexBuffer, (u32)(sysexBuffer_ptr - &sysexBuffer[0]));
     MUTEX_MIDIOUT_GIVE;
     return status;
 }
@@ -26,6 +26,10 @@
 #include "app.h"
 #include "MbSidEnvironment.h"
 
+#if MBSID_USE_BANK_FILES
+#include "sid_file.h"
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
@@ -97,6 +101,11 @@ extern "C" void APP_Init(void)
   MBNET_Init(0);
   MBNET_NodeIDSet(0x10);
 
+#if MBSID_USE_BANK_FILES
+  // init file access (SD Card will be checked by SID_TASK_Period1S)
+  SID_FILE_Init(0);
+#endif
+
   // initialize MbSidEnvironment
   sid_se_speed_factor = 2;
   mbSidEnvironment.updateSpeedFactorSet(sid_se_speed_factor);
@@ -265,6 +274,9 @@ extern "C" void SID_TASK_Period1mS(void)
 /////////////////////////////////////////////////////////////////////////////
 extern "C" void SID_TASK_Period1mS_LowPrio(void)
 {
+  // load neighbours of the selected patches from SD Card
+  mbSidEnvironment.mbSidBank.prefetchHandler();
+
 #if 0
   static s32 old_value = 0;
   MUTEX_MIDIOUT_TAKE;
@@ -296,6 +308,9 @@ extern "C" void SID_TASK_Period1S(void)
 #if 1
   SID_PrintStatistics();
 #endif
+
+  // ASID frame rate and jitter buffer (only if ASID mode active)
+  mbSidEnvironment.mbSidAsid.printStatistics();
   MUTEX_MIDIOUT_GIVE;
 
   static u8 wait_boot_ctr = 2; // wait 2 seconds before loading from SD Card - this is to increase the time where the boot screen is print!
@@ -313,14 +328,18 @@ extern "C" void SID_TASK_Period1S(void)
     return;
   }
 
+#if MBSID_USE_BANK_FILES
   // check if SD Card connected
   MUTEX_SDCARD_TAKE;
 
-#if 0
   s32 status = SID_FILE_CheckSDCard();
-#endif
 
   MUTEX_SDCARD_GIVE;
+
+  // bank files have been (re-)loaded or removed: cached patches are obsolete
+  if( status == 1 || status == 2 )
+    mbSidEnvironment.mbSidBank.cacheInvalidate();
+#endif
 }
 
 
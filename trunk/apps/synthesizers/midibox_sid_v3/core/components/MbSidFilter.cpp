@@ -90,8 +90,17 @@ void MbSidFilter::tick(const u8 &updateSpeedFactor)
     cutoff = cali_min + ((cutoff * (cali_max-cali_min)) / 4096);
 
     // map 12bit value to 11 value of SID register
-    physSidRegs->filter_l = (cutoff >> 1) & 0x7;
-    physSidRegs->filter_h = (cutoff >> 4);
+    // (registers are only marked as dirty if they have been changed)
+    u8 filter_l = (cutoff >> 1) & 0x7;
+    u8 filter_h = (cutoff >> 4);
+    if( physSidRegs->filter_l != filter_l || physSidRegs->filter_h != filter_h ) {
+        physSidRegs->filter_l = filter_l;
+        physSidRegs->filter_h = filter_h;
+        SID_REGS_DIRTY_SET(physSidRegs, SID_DIRTY_FILTER_CUTOFF);
+    }
+
+    u8 resChnReg = physSidRegs->ALL[0x17];
+    u8 modeVolReg = physSidRegs->ALL[0x18];
 
     // resonance (4bit only)
     physSidRegs->resonance = filterResonance >> 4;
@@ -108,4 +117,9 @@ void MbSidFilter::tick(const u8 &updateSpeedFactor)
     if( volume > 0xffff ) volume = 0xffff; else if( volume < 0 ) volume = 0;
 
     physSidRegs->volume = volume >> 12;
+
+    if( physSidRegs->ALL[0x17] != resChnReg )
+        SID_REGS_DIRTY_SET(physSidRegs, SID_DIRTY_FILTER_RES_CHN);
+    if( physSidRegs->ALL[0x18] != modeVolReg )
+        SID_REGS_DIRTY_SET(physSidRegs, SID_DIRTY_FILTER_MODE_VOL);
 }
@@ -19,6 +19,13 @@
 #include "MbSidStructs.h"
 
 
+// number of modulation pathes
+#define SID_SE_NUM_MOD_PATHES 8
+
+// maximum number of destinations of a path (2 x_targets + 2*8 direct targets)
+#define SID_SE_MOD_PATH_MAX_DST (2 + 2*8)
+
+
 class MbSidMod
 {
 public:
@@ -37,6 +44,10 @@ public:
     // Modulation Matrix handler
     void tick(void);
 
+    // has to be called whenever the modulation patch has been changed
+    // the compiled pathes will be updated with the next tick
+    void patchChanged(void) { modCompiled = false; }
+
     // first MOD Patch entry
     sid_se_mod_patch_t *modPatch;
 
@@ -47,8 +58,28 @@ public:
     s32 modDst[SID_SE_NUM_MOD_DST];
 
 protected:
+    // converts the modulation patch into the structure of arrays below
+    void compile(void);
+
     // flags modulation transitions
     u8 modTransition;
+
+    // compiled modulation pathes, only pathes with depth != 0 are taken
+    bool modCompiled;
+    u8  modNumPathes;
+    u8  modPathNum[SID_SE_NUM_MOD_PATHES];   // original path number (for S&H and feedback)
+    u8  modPathOp[SID_SE_NUM_MOD_PATHES];    // operator (0..15)
+    u8  modPathSrc1[SID_SE_NUM_MOD_PATHES];  // modSrc index, 0xff if constant
+    u8  modPathSrc2[SID_SE_NUM_MOD_PATHES];
+    s16 modPathConst1[SID_SE_NUM_MOD_PATHES]; // constant value if no modSrc is selected
+    s16 modPathConst2[SID_SE_NUM_MOD_PATHES];
+    s32 modPathDepth[SID_SE_NUM_MOD_PATHES]; // depth-128
+    s32 modPathSign[2*SID_SE_NUM_MOD_PATHES]; // +1/-1 for dst1/dst2 of each path
+
+    // flat list of destinations: modDst[modDstIx[i]] += value[modDstValueIx[i]]
+    u8  modNumDst;
+    u8  modDstIx[SID_SE_NUM_MOD_PATHES*SID_SE_MOD_PATH_MAX_DST];
+    u8  modDstValueIx[SID_SE_NUM_MOD_PATHES*SID_SE_MOD_PATH_MAX_DST];
 };
 
 #endif /* _MB_SID_MOD_H */
@@ -41,11 +41,12 @@ MbSidVoice::~MbSidVoice()
 // Voice init function with voice and register assignments
 // (usually only called once after startup)
 /////////////////////////////////////////////////////////////////////////////
-void MbSidVoice::init(u8 _voiceNum, u8 _physVoiceNum, sid_voice_t *_physSidVoice)
+void MbSidVoice::init(u8 _voiceNum, u8 _physVoiceNum, sid_regs_t *_physSidRegs)
 {
     voiceNum = _voiceNum;
     physVoiceNum = _physVoiceNum;
-    physSidVoice = _physSidVoice;
+    physSidRegs = _physSidRegs;
+    physSidVoice = (sid_voice_t *)&physSidRegs->v[physVoiceNum];
 
     this->init();
 }
@@ -144,6 +145,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
             // clear ADSR registers, so that the envelope gets completely released
             physSidVoice->ad = 0x00;
             physSidVoice->sr = 0x00;
+            physSidVoiceDirty(SID_VOICE_DIRTY_AD | SID_VOICE_DIRTY_SR);
         }
     }
 
@@ -169,8 +171,10 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
         voiceGateClrReq = 0;
 
         // clear SID gate flag if GSA function not enabled
-        if( !voiceGateStaysActive )
+        if( !voiceGateStaysActive ) {
             physSidVoice->gate = 0;
+            physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
+        }
 
         // gate not active anymore
         voiceGateActive = 0;
@@ -199,6 +203,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
                     voiceSetDelayCtr = 0x0000;
                     // for ADSR Bug Workaround (hard-sync)
                     physSidVoice->test = 0;
+                    physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
                 }
             }
 
@@ -215,6 +220,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
                             voiceOscSyncInProgress = 1;
                             // set test flag for one update cycle
                             physSidVoice->test = 1;
+                            physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
                             // don't change pitch for this update cycle!
                             changePitch = 0;
                             // skip gate handling for this update cycle
@@ -224,6 +230,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
                             voiceOscSyncInProgress = 1;
                             // set test flag for one update cycle
                             physSidVoice->test = 1;
+                            physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
                             // set pitch depending on selected oscillator phase to achieve an offset between the waveforms
                             // This approach has been invented by Wilba! :-)
                             u32 reference_frq = 16779; // 1kHz
@@ -235,6 +242,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
                             }
                             physSidVoice->frq_l = osc_sync_frq & 0xff;
                             physSidVoice->frq_h = osc_sync_frq >> 8;
+                            physSidVoiceDirty(SID_VOICE_DIRTY_FRQ);
                             // don't change pitch for this update cycle!
                             changePitch = 0;
                             // skip gate handling for this update cycle
@@ -247,6 +255,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
                     if( physSidVoice->test ) {
                         // clear test flag
                         physSidVoice->test = 0;
+                        physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
                         // don't change pitch for this update cycle!
                         changePitch = 0;
                         // ensure that pitch handler will re-calculate pitch frequency on next update cycle
@@ -255,6 +264,7 @@ bool MbSidVoice::gate(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
                         // this code is also executed if OSC synchronisation disabled
                         // set the gate flag
                         physSidVoice->gate = 1;
+                        physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
                         // OSC sync finished
                         voiceOscSyncInProgress = 0;
                     }
@@ -436,9 +446,14 @@ void MbSidVoice::pitch(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
         int frq_semi = (frq_b-frq_a) * (linear_frq & 0x1ff);
         int frq = frq_a + (frq_semi >> 9);
 
-        // write result into SID frequency register
-        physSidVoice->frq_l = frq & 0xff;
-        physSidVoice->frq_h = frq >> 8;
+        // write result into SID frequency register (marked as dirty only on changes)
+        u8 frq_l = frq & 0xff;
+        u8 frq_h = frq >> 8;
+        if( physSidVoice->frq_l != frq_l || physSidVoice->frq_h != frq_h ) {
+            physSidVoice->frq_l = frq_l;
+            physSidVoice->frq_h = frq_h;
+            physSidVoiceDirty(SID_VOICE_DIRTY_FRQ);
+        }
     }
 }
 
@@ -457,9 +472,14 @@ void MbSidVoice::pw(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
         if( pulsewidth > 0xfff ) pulsewidth = 0xfff; else if( pulsewidth < 0 ) pulsewidth = 0;
     }
 
-    // transfer to SID registers
-    physSidVoice->pw_l = pulsewidth & 0xff;
-    physSidVoice->pw_h = (pulsewidth >> 8) & 0x0f;
+    // transfer to SID registers (marked as dirty only on changes)
+    u8 pw_l = pulsewidth & 0xff;
+    u8 pw_h = (pulsewidth >> 8) & 0x0f;
+    if( physSidVoice->pw_l != pw_l || physSidVoice->pw_h != pw_h ) {
+        physSidVoice->pw_l = pw_l;
+        physSidVoice->pw_h = pw_h;
+        physSidVoiceDirty(SID_VOICE_DIRTY_PW);
+    }
 }
 
 
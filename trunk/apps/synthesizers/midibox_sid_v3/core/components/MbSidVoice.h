@@ -36,9 +36,12 @@ public:
     MbSidMidiVoice *midiVoicePtr;
 
     // voice init functions
-    virtual void init(u8 _voiceNum, u8 _physVoiceNum, sid_voice_t *_physSidVoice);
+    virtual void init(u8 _voiceNum, u8 _physVoiceNum, sid_regs_t *_physSidRegs);
     virtual void init();
 
+    // marks registers of the physical SID voice as changed (SID_VOICE_DIRTY_*)
+    void physSidVoiceDirty(u8 flags) { SID_REGS_DIRTY_SET(physSidRegs, (u32)flags << (7*physVoiceNum)); }
+
     // input parameters
     bool voiceLegato;
     bool voiceWavetableOnly;
@@ -100,6 +103,7 @@ public:
     u8  voiceNum; // number of assigned voice
     u8  physVoiceNum; // number of assigned physical SID voice
     sid_voice_t *physSidVoice; // reference to SID register
+    sid_regs_t *physSidRegs; // reference to all SID registers (for the dirty flags)
     u8  voiceNote;
     u8  voiceForcedNote;
     u8  voicePlayedNote;
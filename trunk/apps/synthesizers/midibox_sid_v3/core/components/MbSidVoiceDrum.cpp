@@ -41,11 +41,12 @@ MbSidVoiceDrum::~MbSidVoiceDrum()
 // Voice init function with voice and register assignments
 // (usually only called once after startup)
 /////////////////////////////////////////////////////////////////////////////
-void MbSidVoiceDrum::init(u8 _voiceNum, u8 _physVoiceNum, sid_voice_t *_physSidVoice)
+void MbSidVoiceDrum::init(u8 _voiceNum, u8 _physVoiceNum, sid_regs_t *_physSidRegs)
 {
     voiceNum = _voiceNum;
     physVoiceNum = _physVoiceNum;
-    physSidVoice = _physSidVoice;
+    physSidRegs = _physSidRegs;
+    physSidVoice = (sid_voice_t *)&physSidRegs->v[physVoiceNum];
 
     init();
 }
@@ -147,19 +148,27 @@ void MbSidVoiceDrum::tick(const u8 &updateSpeedFactor, MbSidSe *se, MbSidWtDrum
     // Pulsewidth handler
     pw(updateSpeedFactor, se);
 
+    u8 waveformReg = physSidVoice->waveform_reg;
     physSidVoice->waveform = voiceWaveform;
     physSidVoice->sync = voiceWaveformSync;
     physSidVoice->ringmod = voiceWaveformRingmod;
+    if( physSidVoice->waveform_reg != waveformReg )
+        physSidVoiceDirty(SID_VOICE_DIRTY_WAVEFORM);
 
     // don't change ADSR so long delay is active (also important for ABW - ADSR bug workaround)
     if( !voiceSetDelayCtr ) {
-        physSidVoice->ad = voiceAttackDecay.ALL;
+        u8 ad = voiceAttackDecay.ALL;
 
         // force sustain to maximum if accent flag active
         u8 sr = voiceSustainRelease.ALL;
         if( voiceAccentActive )
             sr |= 0xf0;
-        physSidVoice->sr = sr;
+
+        if( physSidVoice->ad != ad || physSidVoice->sr != sr ) {
+            physSidVoice->ad = ad;
+            physSidVoice->sr = sr;
+            physSidVoiceDirty(SID_VOICE_DIRTY_AD | SID_VOICE_DIRTY_SR);
+        }
     }
 }
 
@@ -194,7 +203,12 @@ void MbSidVoiceDrum::pitch(const u8 &updateSpeedFactor, MbSidSe *mbSidSe)
         }
     }
 
-    // copy target frequency into SID registers
-    physSidVoice->frq_l = targetFrq & 0xff;
-    physSidVoice->frq_h = targetFrq >> 8;
+    // copy target frequency into SID registers (marked as dirty only on changes)
+    u8 frq_l = targetFrq & 0xff;
+    u8 frq_h = targetFrq >> 8;
+    if( physSidVoice->frq_l != frq_l || physSidVoice->frq_h != frq_h ) {
+        physSidVoice->frq_l = frq_l;
+        physSidVoice->frq_h = frq_h;
+        physSidVoiceDirty(SID_VOICE_DIRTY_FRQ);
+    }
 }
@@ -32,7 +32,7 @@ public:
     ~MbSidVoiceDrum();
 
     // voice init functions
-    void init(u8 _voiceNum, u8 _physVoiceNum, sid_voice_t *_physSidVoice);
+    void init(u8 _voiceNum, u8 _physVoiceNum, sid_regs_t *_physSidRegs);
     void init();
     void init(MbSidDrum *d, u8 note, u8 velocity);
 
@@ -15,9 +15,6 @@
 #include "MbSidVoiceQueue.h"
 #include <string.h>
 
-// tmp-.
-#define SID_SE_NUM_VOICES 6
-
 
 /////////////////////////////////////////////////////////////////////////////
 // for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
@@ -32,6 +29,16 @@
 /////////////////////////////////////////////////////////////////////////////
 MbSidVoiceQueue::MbSidVoiceQueue()
 {
+    mbsid_voice_queue_item_t *v = &item[0];
+    for(int voice=0; voice<MBSID_VOICE_QUEUE_NUM_VOICES; ++voice, ++v) {
+        v->ASSIGNED = 0;
+        v->EXCLUSIVE = 0;
+        v->instrument = 0xff; // invalid instrument
+        v->allocated = voice;
+    }
+    allocCtr = MBSID_VOICE_QUEUE_NUM_VOICES;
+
+    listsRebuild();
 }
 
 
@@ -45,28 +52,34 @@ MbSidVoiceQueue::~MbSidVoiceQueue()
 
 /////////////////////////////////////////////////////////////////////////////
 //  This function initializes the voice queue and the assigned instruments
-//  The queue contains a number for each voice. So long the ASSIGNED flag is 
-//  set, the voice is assigned to an instrument, if bit ASSIGNED is not set, 
-//  the voice can be allocated by a new instrument
+//  Each voice has an ASSIGNED flag: so long it is set, the voice is assigned
+//  to an instrument, if it is not set, the voice can be allocated by a new
+//  instrument
 // 
 //  The instrument number is stored in the queue as well, it is especially
 //  important for mono voices
 // 
-//  The first voice in the queue is the first which will be taken.
-//  To realize a "drop longest note first" algorithm, the take number should
-//  always be moved to the end of the queue
+//  The least recently allocated voice is the first which will be taken
+//  ("drop longest note first" algorithm). The voices are linked into lists
+//  in allocation order, so that get(), getLast() and release() don't need
+//  to search or shuffle the queue:
+//  - one list per stereo half (left/right voices) with shared voices
+//  - one list per instrument and half with exclusively assigned voices
+//  get() only has to compare the heads of the lists which are allowed
+//  for the instrument
 /////////////////////////////////////////////////////////////////////////////
 void MbSidVoiceQueue::init(sid_patch_t *patch)
 {
-    mbsid_voice_queue_item_t *item = (mbsid_voice_queue_item_t *)&queue.item[0];
-    for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item) {
-        item->voice = voice;
-        item->ASSIGNED = 0;
-        item->EXCLUSIVE = 0;
-        item->instrument = 0xff; // invalid instrument
+    mbsid_voice_queue_item_t *v = &item[0];
+    for(int voice=0; voice<MBSID_VOICE_QUEUE_NUM_VOICES; ++voice, ++v) {
+        v->ASSIGNED = 0;
+        v->EXCLUSIVE = 0;
+        v->instrument = 0xff; // invalid instrument
+        v->allocated = voice; // first voice will be taken first
     }
+    allocCtr = MBSID_VOICE_QUEUE_NUM_VOICES;
 
-    // initialize exclusive flags
+    // initialize exclusive flags and lists
     initExclusive(patch);
 }
 
@@ -77,9 +90,9 @@ void MbSidVoiceQueue::init(sid_patch_t *patch)
 void MbSidVoiceQueue::initExclusive(sid_patch_t *patch)
 {
     // by default, allow non-exclusive access
-    mbsid_voice_queue_item_t *item = (mbsid_voice_queue_item_t *)&queue.item[0];
-    for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item)
-        item->EXCLUSIVE = 0;
+    mbsid_voice_queue_item_t *v = &item[0];
+    for(int voice=0; voice<MBSID_VOICE_QUEUE_NUM_VOICES; ++voice, ++v)
+        v->EXCLUSIVE = 0;
 
     // engine specific code
     sid_se_engine_t engine = (sid_se_engine_t)patch->engine;
@@ -88,9 +101,11 @@ void MbSidVoiceQueue::initExclusive(sid_patch_t *patch)
     case SID_SE_BASSLINE:
         break; // bot relevant
 
+    // note: the voice patches are stored in records of 10 (drum) or 48 (multi) bytes,
+    // which are smaller than sid_se_voice_patch_t
     case SID_SE_DRUM: {
-        sid_se_voice_patch_t *voice_patch = (sid_se_voice_patch_t *)&patch->D.voice[0];
-        for(int drum=0; drum<16; ++drum, ++voice_patch) {
+        for(int drum=0; drum<16; ++drum) {
+            sid_se_voice_patch_t *voice_patch = (sid_se_voice_patch_t *)&patch->D.voice[drum];
 #if 0
             u8 voice_asg = ((sid_se_v_flags_t)voice_patch->D.v_flags).D.VOICE_ASG;
 #else
@@ -100,31 +115,34 @@ void MbSidVoiceQueue::initExclusive(sid_patch_t *patch)
             u8 voice_asg = v_flags.D.VOICE_ASG;
 #endif
             int direct_voice_asg = voice_asg - 3;
-            if( direct_voice_asg >= 0 && direct_voice_asg < SID_SE_NUM_VOICES ) {
+            if( direct_voice_asg >= 0 && direct_voice_asg < MBSID_VOICE_QUEUE_NUM_VOICES ) {
                 // search for drum instrument in queue and set exclusive flag
-                item = (mbsid_voice_queue_item_t *)&queue.item[0];
-                for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item)
-                    if( item->instrument == drum )
-                        item->EXCLUSIVE = 1;
+                v = &item[0];
+                for(int voice=0; voice<MBSID_VOICE_QUEUE_NUM_VOICES; ++voice, ++v)
+                    if( v->instrument == drum )
+                        v->EXCLUSIVE = 1;
             }
         }
     } break;
 
     case SID_SE_MULTI: {
-        sid_se_voice_patch_t *voice_patch = (sid_se_voice_patch_t *)&patch->M.voice[0];
-        for(int ins=0; ins<6; ++ins, ++voice_patch) {
+        for(int ins=0; ins<6; ++ins) {
+            sid_se_voice_patch_t *voice_patch = (sid_se_voice_patch_t *)&patch->M.voice[ins];
             u8 voice_asg = voice_patch->M.voice_asg;
             int direct_voice_asg = voice_asg - 3;
-            if( direct_voice_asg >= 0 && direct_voice_asg < SID_SE_NUM_VOICES ) {
+            if( direct_voice_asg >= 0 && direct_voice_asg < MBSID_VOICE_QUEUE_NUM_VOICES ) {
                 // search for drum instrument in queue and set exclusive flag
-                item = (mbsid_voice_queue_item_t *)&queue.item[0];
-                for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item)
-                    if( item->instrument == ins )
-                        item->EXCLUSIVE = 1;
+                v = &item[0];
+                for(int voice=0; voice<MBSID_VOICE_QUEUE_NUM_VOICES; ++voice, ++v)
+                    if( v->instrument == ins )
+                        v->EXCLUSIVE = 1;
             }
         }
     } break;
     }
+
+    // exclusive flags have been changed
+    listsRebuild();
 }
 
 
@@ -137,67 +155,73 @@ void MbSidVoiceQueue::initExclusive(sid_patch_t *patch)
 /////////////////////////////////////////////////////////////////////////////
 u8 MbSidVoiceQueue::get(u8 instrument, u8 voice_asg, u8 num_voices)
 {
-    if( num_voices > SID_SE_NUM_VOICES )
-        num_voices = SID_SE_NUM_VOICES;
-
-    // determine allowed voices (each voice has a dedicated flag)
-    u32 allowed_voice_mask;
-    switch( voice_asg ) {
-    case 0: // all voices
-        allowed_voice_mask = (1 << SID_SE_NUM_VOICES)-1; // all voices
-        break;
-
-    case 1: // only left voices
-        allowed_voice_mask = (1 << (SID_SE_NUM_VOICES/2))-1;
-        break;
-
-    case 2: // only right voices
-        if( num_voices <= (SID_SE_NUM_VOICES/2) )
-            allowed_voice_mask = (1 << (SID_SE_NUM_VOICES/2))-1; // Mono mode: take left voices
-        else
-            allowed_voice_mask = ((1 << (SID_SE_NUM_VOICES/2))-1) << (SID_SE_NUM_VOICES/2); // only right voices
-        break;
-
-    default: { // dedicated voice
-        u8 dedicated_voice = (voice_asg-3) % num_voices; // if mono mode: take left voice
-        allowed_voice_mask = (1 << dedicated_voice);
-    }
-    }
+    if( num_voices > MBSID_VOICE_QUEUE_NUM_VOICES )
+        num_voices = MBSID_VOICE_QUEUE_NUM_VOICES;
+
+    u8 voice = MBSID_VOICE_QUEUE_NIL;
+    if( voice_asg >= 3 ) {
+        // dedicated voice
+        voice = (voice_asg-3) % num_voices; // if mono mode: take left voice
+    } else {
+        // determine allowed halves
+        u8 first_half = 0;
+        u8 last_half = 1;
+        switch( voice_asg ) {
+        case 1: // only left voices
+            last_half = 0;
+            break;
+
+        case 2: // only right voices
+            if( num_voices <= (MBSID_VOICE_QUEUE_NUM_VOICES/2) )
+                last_half = 0; // Mono mode: take left voices
+            else
+                first_half = 1; // only right voices
+            break;
+        }
 
-    // search for voice and allocate it
-    mbsid_voice_queue_item_t *item = (mbsid_voice_queue_item_t *)&queue.item[0];
-    for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item) {
-        if( allowed_voice_mask & (1 << item->voice) &&
-            (!item->EXCLUSIVE || (item->instrument == instrument) || (voice_asg >= 3)) ) {
-            // assign voice and save instrument number
-            item->ASSIGNED = 1;
-            item->EXCLUSIVE = (voice_asg >= 3) ? 1 : 0; // exclusive assignment?
-            item->instrument = instrument;
-
-            // if this isn't already the last voice, put this item to the end of the queue
-            if( voice < (SID_SE_NUM_VOICES-1) ) {
-                mbsid_voice_queue_item_t stored_item = *item;
-                int i;
-                for(i=voice; i<(SID_SE_NUM_VOICES-1); ++i)
-                    queue.item[i] = queue.item[i+1];
-                queue.item[SID_SE_NUM_VOICES-1] = stored_item;
+        // take the least recently allocated voice which is either shared,
+        // or exclusively assigned to this instrument
+        for(int half=first_half; half<=last_half; ++half) {
+            u8 candidate = list[MBSID_VOICE_QUEUE_LIST_SHARED(half)].head;
+            if( candidate != MBSID_VOICE_QUEUE_NIL &&
+                (voice == MBSID_VOICE_QUEUE_NIL || (s32)(item[candidate].allocated - item[voice].allocated) < 0) )
+                voice = candidate;
+
+            if( instrument < MBSID_VOICE_QUEUE_NUM_INSTRUMENTS ) {
+                candidate = list[MBSID_VOICE_QUEUE_LIST_EXCLUSIVE(instrument, half)].head;
+                if( candidate != MBSID_VOICE_QUEUE_NIL &&
+                    (voice == MBSID_VOICE_QUEUE_NIL || (s32)(item[candidate].allocated - item[voice].allocated) < 0) )
+                    voice = candidate;
             }
+        }
 
-#if DEBUG_VERBOSE_LEVEL >= 2
-            sendDebugMessage(sid);
+        if( voice == MBSID_VOICE_QUEUE_NIL ) {
+            // we should never reach this part!
+#if DEBUG_VERBOSE_LEVEL >= 1
+            DEBUG_MSG((char *)"[VoiceQueueGet] no voice available (voice_asg: 0x%02x)\n", voice_asg);
 #endif
-
-            // return with voice number
-            return queue.item[SID_SE_NUM_VOICES-1].voice;
+            return 0; // take first voice on this error case
         }
     }
 
-    // we should never reach this part!
-#if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[VoiceQueueGet] voice not in queue anymore (voice_asg: 0x%02x, allowed_mask: 0x%02x)\n", voice_asg, allowed_voice_mask);
+    // assign voice and save instrument number
+    mbsid_voice_queue_item_t *v = &item[voice];
+    v->ASSIGNED = 1;
+    v->EXCLUSIVE = (voice_asg >= 3) ? 1 : 0; // exclusive assignment?
+    v->instrument = instrument;
+
+    // put the voice to the end of its list
+    if( v->EXCLUSIVE && instrument < MBSID_VOICE_QUEUE_NUM_INSTRUMENTS )
+        allocate(voice, MBSID_VOICE_QUEUE_LIST_EXCLUSIVE(instrument, halfGet(voice)));
+    else
+        allocate(voice, MBSID_VOICE_QUEUE_LIST_SHARED(halfGet(voice)));
+
+#if DEBUG_VERBOSE_LEVEL >= 2
+    sendDebugMessage();
 #endif
 
-    return 0; // take first voice on this error case
+    // return with voice number
+    return voice;
 }
 
 
@@ -209,41 +233,26 @@ u8 MbSidVoiceQueue::get(u8 instrument, u8 voice_asg, u8 num_voices)
 /////////////////////////////////////////////////////////////////////////////
 u8 MbSidVoiceQueue::getLast(u8 instrument, u8 voice_asg, u8 num_voices, u8 search_voice)
 {
-    // search in queue for selected voice
-    mbsid_voice_queue_item_t *item = (mbsid_voice_queue_item_t *)&queue.item[0];
-    for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item)
-        if( item->voice == search_voice ) {
-            // selected voice found
-            // if instrument number not equal, we should get a new voice
-            if( item->instrument != instrument )
-                break;
-            // if number of available voices has changed meanwhile (e.g. Stereo->Mono switch):
-            // check that voice number still < n
-            if( item->voice >= num_voices )
-                break;
-
-            // it's mine!
-
-            // assign voice (again)
-            item->ASSIGNED = 1;
-
-            // if this isn't already the last voice, put this item to the end of the queue
-            if( voice < (SID_SE_NUM_VOICES-1) ) {
-                mbsid_voice_queue_item_t stored_item = *item;
-                int i;
-                for(i=voice; i<(SID_SE_NUM_VOICES-1); ++i)
-                    queue.item[i] = queue.item[i+1];
-                queue.item[SID_SE_NUM_VOICES-1] = stored_item;
-            }
+    // if instrument number not equal, we should get a new voice
+    // if number of available voices has changed meanwhile (e.g. Stereo->Mono switch):
+    // check that voice number still < n
+    if( search_voice < MBSID_VOICE_QUEUE_NUM_VOICES &&
+        item[search_voice].instrument == instrument &&
+        search_voice < num_voices ) {
+
+        // it's mine!
+
+        // assign voice (again) and put it to the end of its list
+        item[search_voice].ASSIGNED = 1;
+        allocate(search_voice, item[search_voice].list);
 
 #if DEBUG_VERBOSE_LEVEL >= 2
-            sendDebugMessage(sid);
+        sendDebugMessage();
 #endif
 
-            // return with voice number
-            return queue.item[SID_SE_NUM_VOICES-1].voice;
-
-        }
+        // return with voice number
+        return search_voice;
+    }
 
     // voice not found, continue at get()
     return get(instrument, voice_asg, num_voices);
@@ -257,37 +266,123 @@ u8 MbSidVoiceQueue::getLast(u8 instrument, u8 voice_asg, u8 num_voices, u8 searc
 /////////////////////////////////////////////////////////////////////////////
 u8 MbSidVoiceQueue::release(u8 release_voice)
 {
-    // search in voice queue for the voice
-    mbsid_voice_queue_item_t *item = (mbsid_voice_queue_item_t *)&queue.item[0];
-    for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item)
-        if( item->voice == release_voice ) {
-            item->ASSIGNED = 0;
-
-#if DEBUG_VERBOSE_LEVEL >= 2
-            sendDebugMessage();
+    if( release_voice >= MBSID_VOICE_QUEUE_NUM_VOICES ) {
+        // we should never reach this part!
+#if DEBUG_VERBOSE_LEVEL >= 1
+        DEBUG_MSG((char *)"[voiceRelease] voice %d not in queue!\n", release_voice);
 #endif
+        return 0; // take first voice on this error case
+    }
 
-            return item->voice;
-        }
+    item[release_voice].ASSIGNED = 0;
 
-    // we should never reach this part!
-#if DEBUG_VERBOSE_LEVEL >= 1
-    DEBUG_MSG("[voiceRelease] voice %d not in queue anymore!\n", release_voice);
+#if DEBUG_VERBOSE_LEVEL >= 2
+    sendDebugMessage();
 #endif
 
-    return 0; // take first voice on this error case
-
+    return release_voice;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 // Sends the content of the voice queue to the MIOS Terminal
+// (voices in the order in which they will be taken)
 /////////////////////////////////////////////////////////////////////////////
 void MbSidVoiceQueue::sendDebugMessage(void)
 {
-    DEBUG_MSG("Voice Queue content:\n");
-    mbsid_voice_queue_item_t *item = (mbsid_voice_queue_item_t *)&queue.item[0];
-    for(int voice=0; voice<SID_SE_NUM_VOICES; ++voice, ++item)
-        DEBUG_MSG("  [%d] V:%d  A:%d  E:%d  I:%d\n",
-                  voice, item->voice, item->ASSIGNED, item->EXCLUSIVE, item->instrument);
+    DEBUG_MSG((char *)"Voice Queue content:\n");
+
+    u32 printed = 0;
+    for(int i=0; i<MBSID_VOICE_QUEUE_NUM_VOICES; ++i) {
+        u8 voice = nextVoiceGet(printed);
+        printed |= (1 << voice);
+
+        mbsid_voice_queue_item_t *v = &item[voice];
+        DEBUG_MSG((char *)"  [%d] V:%d  A:%d  E:%d  I:%d\n",
+                  i, voice, v->ASSIGNED, v->EXCLUSIVE, v->instrument);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// List handling
+/////////////////////////////////////////////////////////////////////////////
+void MbSidVoiceQueue::listAppend(u8 list_ix, u8 voice)
+{
+    mbsid_voice_queue_list_t *l = &list[list_ix];
+    mbsid_voice_queue_item_t *v = &item[voice];
+
+    v->list = list_ix;
+    v->prev = l->tail;
+    v->next = MBSID_VOICE_QUEUE_NIL;
+
+    if( l->tail != MBSID_VOICE_QUEUE_NIL )
+        item[l->tail].next = voice;
+    else
+        l->head = voice;
+    l->tail = voice;
+}
+
+void MbSidVoiceQueue::listRemove(u8 voice)
+{
+    mbsid_voice_queue_item_t *v = &item[voice];
+    mbsid_voice_queue_list_t *l = &list[v->list];
+
+    if( v->prev != MBSID_VOICE_QUEUE_NIL )
+        item[v->prev].next = v->next;
+    else
+        l->head = v->next;
+
+    if( v->next != MBSID_VOICE_QUEUE_NIL )
+        item[v->next].prev = v->prev;
+    else
+        l->tail = v->prev;
+}
+
+// the voice gets the next allocation number and is moved to the end of the given list
+void MbSidVoiceQueue::allocate(u8 voice, u8 list_ix)
+{
+    item[voice].allocated = allocCtr++;
+    listRemove(voice);
+    listAppend(list_ix, voice);
+}
+
+// returns 0 for left, 1 for right voices
+u8 MbSidVoiceQueue::halfGet(u8 voice)
+{
+    return (voice >= (MBSID_VOICE_QUEUE_NUM_VOICES/2)) ? 1 : 0;
+}
+
+// returns the least recently allocated voice which isn't part of the mask
+u8 MbSidVoiceQueue::nextVoiceGet(u32 skip_mask)
+{
+    u8 next_voice = MBSID_VOICE_QUEUE_NIL;
+    for(int voice=0; voice<MBSID_VOICE_QUEUE_NUM_VOICES; ++voice) {
+        if( !(skip_mask & (1 << voice)) &&
+            (next_voice == MBSID_VOICE_QUEUE_NIL || (s32)(item[voice].allocated - item[next_voice].allocated) < 0) )
+            next_voice = voice;
+    }
+
+    return next_voice;
+}
+
+// links all voices into their lists in allocation order (only done on patch changes)
+void MbSidVoiceQueue::listsRebuild(void)
+{
+    for(int i=0; i<MBSID_VOICE_QUEUE_NUM_LISTS; ++i) {
+        list[i].head = MBSID_VOICE_QUEUE_NIL;
+        list[i].tail = MBSID_VOICE_QUEUE_NIL;
+    }
+
+    u32 linked = 0;
+    for(int i=0; i<MBSID_VOICE_QUEUE_NUM_VOICES; ++i) {
+        u8 voice = nextVoiceGet(linked);
+        linked |= (1 << voice);
+
+        mbsid_voice_queue_item_t *v = &item[voice];
+        if( v->EXCLUSIVE && v->instrument < MBSID_VOICE_QUEUE_NUM_INSTRUMENTS )
+            listAppend(MBSID_VOICE_QUEUE_LIST_EXCLUSIVE(v->instrument, halfGet(voice)), voice);
+        else
+            listAppend(MBSID_VOICE_QUEUE_LIST_SHARED(halfGet(voice)), voice);
+    }
 }
@@ -18,22 +18,37 @@
 #include <mios32.h>
 #include "MbSidStructs.h"
 
-typedef union {
-  struct {
-    u16 ALL;
-  };
-  struct {
-    u8 voice:6;
+// number of voices which are managed by the queue (even number, max. 32)
+#ifndef MBSID_VOICE_QUEUE_NUM_VOICES
+#define MBSID_VOICE_QUEUE_NUM_VOICES 6 // SID_SE_NUM_VOICES
+#endif
+
+// number of instruments which can allocate voices exclusively (drums)
+#define MBSID_VOICE_QUEUE_NUM_INSTRUMENTS 16
+
+// voices are linked into one list per stereo half for shared voices, and into one
+// list per instrument and half for exclusively assigned voices
+#define MBSID_VOICE_QUEUE_LIST_SHARED(half)          (half)
+#define MBSID_VOICE_QUEUE_LIST_EXCLUSIVE(ins, half)  (2 + 2*(ins) + (half))
+#define MBSID_VOICE_QUEUE_NUM_LISTS                  (2 + 2*MBSID_VOICE_QUEUE_NUM_INSTRUMENTS)
+
+#define MBSID_VOICE_QUEUE_NIL 0xff
+
+typedef struct {
+    u8 prev; // previous/next voice in list
+    u8 next;
+    u8 list;
+    u8 instrument;
     u8 ASSIGNED:1;
     u8 EXCLUSIVE:1;
-    u8 instrument;
-  };
+    u32 allocated; // allocation number, the lowest number is taken first
 } mbsid_voice_queue_item_t;
 
 
 typedef struct {
-  mbsid_voice_queue_item_t item[6]; // SID_SE_NUM_VOICES
-} mbsid_voice_queue_t;
+    u8 head; // least recently allocated voice
+    u8 tail;
+} mbsid_voice_queue_list_t;
 
 
 class MbSidVoiceQueue
@@ -58,8 +73,16 @@ public:
     void sendDebugMessage(void);
 
 private:
-    mbsid_voice_queue_t queue;
+    void listAppend(u8 list_ix, u8 voice);
+    void listRemove(u8 voice);
+    void listsRebuild(void);
+    void allocate(u8 voice, u8 list_ix);
+    u8 nextVoiceGet(u32 skip_mask);
+    u8 halfGet(u8 voice);
 
+    mbsid_voice_queue_item_t item[MBSID_VOICE_QUEUE_NUM_VOICES];
+    mbsid_voice_queue_list_t list[MBSID_VOICE_QUEUE_NUM_LISTS];
+    u32 allocCtr;
 };
 
 #endif /* _MB_SID_VOICE_QUEUE_H */
@@ -0,0 +1,563 @@
+// $Id$
+/*
+ * File access functions
+ *
+ * Frontend functions to read/write files.
+ * Optimized for Memory Size and Speed!
+ *
+ * For the whole application only single file handlers for read and write
+ * operations are available. They are shared globally to save memory (because
+ * each FatFs handler allocates more than 512 bytes to store the last read
+ * sector)
+ *
+ * For read operations it is possible to re-open a file via a sid_file_t reference
+ * so that no directory access is required to find the first sector of the
+ * file (again).
+ *
+ * NOTE: before accessing the SD Card, the upper level function should
+ * synchronize with the SD Card semaphore!
+ *   MUTEX_SDCARD_TAKE; // to take the semaphore
+ *   MUTEX_SDCARD_GIVE; // to release the semaphore
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <ff.h>
+#include <diskio.h>
+#include <string.h>
+
+#include "sid_file.h"
+#include "sid_file_b.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
+/////////////////////////////////////////////////////////////////////////////
+
+// Note: verbose level 1 is default - it prints error messages
+#define DEBUG_VERBOSE_LEVEL 1
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global variables
+/////////////////////////////////////////////////////////////////////////////
+
+// last error status returned by FatFs
+// can be used as additional debugging help if SID_FILE_*ERR returned by function
+u32 sid_file_dfs_errno;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static s32 SID_FILE_MountFS(void);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+// FatFs variables
+#define SECTOR_SIZE _MAX_SS
+
+// Work area (file system object) for logical drives
+static FATFS fs;
+
+// complete file structure for read/write accesses
+static FIL sid_file_read;
+static u8 sid_file_read_is_open; // only for safety purposes
+static FIL sid_file_write;
+static u8 sid_file_write_is_open; // only for safety purposes
+
+// SD Card status
+static u8 sdcard_available;
+static u8 volume_available;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Initialisation
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_Init(u32 mode)
+{
+  sid_file_read_is_open = 0;
+  sid_file_write_is_open = 0;
+  sdcard_available = 0;
+  volume_available = 0;
+
+  // init SDCard access
+  s32 error = MIOS32_SDCARD_Init(0);
+#if DEBUG_VERBOSE_LEVEL >= 2
+  DEBUG_MSG("[SID_FILE] SD Card interface initialized, status: %d\n", error);
+#endif
+
+  // init:
+  SID_FILE_B_Init(0); // patch bank file access
+
+  return error;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// This function should be called periodically to check the availability
+// of the SD Card
+//
+// Once the chard has been detected, all banks will be read
+// returns < 0 on errors (error codes are documented in sid_file.h)
+// returns 1 if SD card has been connected
+// returns 2 if SD card has been disconnected
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_CheckSDCard(void)
+{
+  // check if SD card is available
+  // High-speed access if SD card was previously available
+  u8 prev_sdcard_available = sdcard_available;
+  sdcard_available = MIOS32_SDCARD_CheckAvailable(prev_sdcard_available) > 0;
+
+  if( sdcard_available && !prev_sdcard_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE] SD Card has been connected!\n");
+#endif
+
+    s32 error = SID_FILE_MountFS();
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE] Tried to mount file system, status: %d\n", error);
+#endif
+
+    if( error < 0 ) {
+      // ensure that volume flagged as not available
+      volume_available = 0;
+
+      return error; // break here!
+    }
+
+    // load all file infos
+    SID_FILE_LoadAllFiles();
+
+    return 1; // SD card has been connected
+
+  } else if( !sdcard_available && prev_sdcard_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE] SD Card disconnected!\n");
+#endif
+    volume_available = 0;
+
+    // invalidate all file infos
+    SID_FILE_UnloadAllFiles();
+
+    return 2; // SD card has been disconnected
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Mount the file system
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+static s32 SID_FILE_MountFS(void)
+{
+  FRESULT res;
+  DIR dir;
+
+  sid_file_read_is_open = 0;
+  sid_file_write_is_open = 0;
+
+  if( (res=f_mount(0, &fs)) != FR_OK ) {
+    DEBUG_MSG("[SID_FILE] Failed to mount SD Card - error status: %d\n", res);
+    return -1; // error
+  }
+
+  if( (res=f_opendir(&dir, "/")) != FR_OK ) {
+    DEBUG_MSG("[SID_FILE] Failed to open root directory - error status: %d\n", res);
+    return -2; // error
+  }
+
+  volume_available = 1;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns 1 if SD card available
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_SDCardAvailable(void)
+{
+  return sdcard_available;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns 1 if volume available
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_VolumeAvailable(void)
+{
+  return volume_available;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads all files
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_LoadAllFiles(void)
+{
+  s32 status = 0;
+
+  status |= SID_FILE_B_LoadAllBanks();
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// invalidate all file infos
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_UnloadAllFiles(void)
+{
+  s32 status = 0;
+  status |= SID_FILE_B_UnloadAllBanks();
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// opens a file for reading
+// Note: to save memory, one a single file is allowed to be opened per
+// time - always use SID_FILE_ReadClose() before opening a new file!
+// Use SID_FILE_ReadReOpen() to continue reading
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_ReadOpen(sid_file_t* file, char *filepath)
+{
+#if DEBUG_VERBOSE_LEVEL >= 2
+  DEBUG_MSG("[SID_FILE] Opening file '%s'\n", filepath);
+#endif
+
+  if( sid_file_read_is_open ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE] FAILURE: tried to open file '%s' for reading, but previous file hasn't been closed!\n", filepath);
+#endif
+    return SID_FILE_ERR_OPEN_READ_WITHOUT_CLOSE;
+  }
+
+  if( (sid_file_dfs_errno=f_open(&sid_file_read, filepath, FA_OPEN_EXISTING | FA_READ)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE] Error opening file - try mounting the partition again\n");
+#endif
+
+    s32 error;
+    if( (error = SID_FILE_MountFS()) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+      DEBUG_MSG("[SID_FILE] mounting failed with status: %d\n", error);
+#endif
+      return SID_FILE_ERR_SD_CARD;
+    }
+
+    if( (sid_file_dfs_errno=f_open(&sid_file_read, filepath, FA_OPEN_EXISTING | FA_READ)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+      DEBUG_MSG("[SID_FILE] Still not able to open file - giving up!\n");
+#endif
+      return SID_FILE_ERR_OPEN_READ;
+    }
+  }
+
+#if DEBUG_VERBOSE_LEVEL >= 2
+  DEBUG_MSG("[SID_FILE] found '%s' of length %u\n", filepath, sid_file_read.fsize);
+#endif
+
+  // store current file variables in sid_file_t
+  file->flag = sid_file_read.flag;
+  file->csect = sid_file_read.csect;
+  file->fptr = sid_file_read.fptr;
+  file->fsize = sid_file_read.fsize;
+  file->org_clust = sid_file_read.org_clust;
+  file->curr_clust = sid_file_read.curr_clust;
+  file->dsect = sid_file_read.dsect;
+  file->dir_sect = sid_file_read.dir_sect;
+  file->dir_ptr = sid_file_read.dir_ptr;
+
+  // file is opened
+  sid_file_read_is_open = 1;
+
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reopens a file for reading
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_ReadReOpen(sid_file_t* file)
+{
+#if DEBUG_VERBOSE_LEVEL >= 2
+  DEBUG_MSG("[SID_FILE] Reopening file\n");
+#endif
+
+  if( sid_file_read_is_open ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE] FAILURE: tried to reopen file, but previous file hasn't been closed!\n");
+#endif
+    return SID_FILE_ERR_OPEN_READ_WITHOUT_CLOSE;
+  }
+
+  // restore file variables from sid_file_t
+  sid_file_read.fs = &fs;
+  sid_file_read.id = fs.id;
+  sid_file_read.flag = file->flag;
+  sid_file_read.csect = file->csect;
+  sid_file_read.fptr = file->fptr;
+  sid_file_read.fsize = file->fsize;
+  sid_file_read.org_clust = file->org_clust;
+  sid_file_read.curr_clust = file->curr_clust;
+  sid_file_read.dsect = file->dsect;
+  sid_file_read.dir_sect = file->dir_sect;
+  sid_file_read.dir_ptr = file->dir_ptr;
+
+  if( sid_file_read.fptr % SECTOR_SIZE ) {
+    // ensure that the right sector is in cache again
+    disk_read(sid_file_read.fs->drive, sid_file_read.buf, sid_file_read.dsect, 1);
+  } else {
+    // at a sector boundary the buffer content isn't used anymore - invalidate
+    // it, so that the next f_lseek() doesn't skip the read of the new sector
+    // and a complete sector is transfered directly into the target buffer
+    sid_file_read.dsect = 0;
+  }
+
+  // file is opened (again)
+  sid_file_read_is_open = 1;
+
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Closes a file which has been read
+// File can be re-opened if required thereafter w/o performance issues
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_ReadClose(sid_file_t *file)
+{
+  // store current file variables in sid_file_t
+  file->flag = sid_file_read.flag;
+  file->csect = sid_file_read.csect;
+  file->fptr = sid_file_read.fptr;
+  file->fsize = sid_file_read.fsize;
+  file->org_clust = sid_file_read.org_clust;
+  file->curr_clust = sid_file_read.curr_clust;
+  file->dsect = sid_file_read.dsect;
+  file->dir_sect = sid_file_read.dir_sect;
+  file->dir_ptr = sid_file_read.dir_ptr;
+
+  // file has been closed
+  sid_file_read_is_open = 0;
+
+
+  // don't close file via f_close()! We allow to open the file again
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Changes to a new file position
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_ReadSeek(u32 offset)
+{
+  if( (sid_file_dfs_errno=f_lseek(&sid_file_read, offset)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE_ReadSeek] ERROR: seek to offset %u failed (FatFs status: %d)\n", offset, sid_file_dfs_errno);
+#endif
+    return SID_FILE_ERR_SEEK;
+  }
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Read from file
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_ReadBuffer(u8 *buffer, u32 len)
+{
+  UINT successcount;
+
+  // exit if volume not available
+  if( !volume_available )
+    return SID_FILE_ERR_NO_VOLUME;
+
+  if( (sid_file_dfs_errno=f_read(&sid_file_read, buffer, len, &successcount)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+    DEBUG_MSG("[SID_FILE] Failed to read sector at position 0x%08x, status: %u\n", sid_file_read.fptr, sid_file_dfs_errno);
+#endif
+      return SID_FILE_ERR_READ;
+  }
+  if( successcount != len ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+    DEBUG_MSG("[SID_FILE] Wrong successcount while reading from position 0x%08x (count: %d)\n", sid_file_read.fptr, successcount);
+#endif
+    return SID_FILE_ERR_READCOUNT;
+  }
+
+  return 0; // no error
+}
+
+s32 SID_FILE_ReadHWord(u16 *hword)
+{
+  // ensure little endian coding
+  u8 tmp[2];
+  s32 status = SID_FILE_ReadBuffer(tmp, 2);
+  *hword = ((u16)tmp[0] << 0) | ((u16)tmp[1] << 8);
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Opens a file for writing
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_WriteOpen(char *filepath, u8 create)
+{
+  if( sid_file_write_is_open ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE] FAILURE: tried to open file '%s' for writing, but previous file hasn't been closed!\n", filepath);
+#endif
+    return SID_FILE_ERR_OPEN_WRITE_WITHOUT_CLOSE;
+  }
+
+  if( (sid_file_dfs_errno=f_open(&sid_file_write, filepath, (create ? FA_CREATE_ALWAYS : FA_OPEN_EXISTING) | FA_WRITE)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE] error opening file '%s' for writing!\n", filepath);
+#endif
+    return SID_FILE_ERR_OPEN_WRITE;
+  }
+
+  // remember state
+  sid_file_write_is_open = 1;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Closes a file by writing the last bytes
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_WriteClose(void)
+{
+  s32 status = 0;
+
+  // close file
+  if( (sid_file_dfs_errno=f_close(&sid_file_write)) != FR_OK )
+    status = SID_FILE_ERR_WRITECLOSE;
+
+  sid_file_write_is_open = 0;
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Changes to a new file position
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_WriteSeek(u32 offset)
+{
+  if( (sid_file_dfs_errno=f_lseek(&sid_file_write, offset)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE_WriteSeek] ERROR: seek to offset %u failed (FatFs status: %d)\n", offset, sid_file_dfs_errno);
+#endif
+    return SID_FILE_ERR_SEEK;
+  }
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Writes into a file with caching mechanism (actual write at end of sector)
+// File has to be closed via SID_FILE_WriteClose() after the last byte has
+// been written
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_WriteBuffer(u8 *buffer, u32 len)
+{
+  // exit if volume not available
+  if( !volume_available )
+    return SID_FILE_ERR_NO_VOLUME;
+
+  UINT successcount;
+  if( (sid_file_dfs_errno=f_write(&sid_file_write, buffer, len, &successcount)) != FR_OK ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+    DEBUG_MSG("[SID_FILE] Failed to write buffer, status: %u\n", sid_file_dfs_errno);
+#endif
+    return SID_FILE_ERR_WRITE;
+  }
+  if( successcount != len ) {
+#if DEBUG_VERBOSE_LEVEL >= 3
+    DEBUG_MSG("[SID_FILE] Wrong successcount while writing buffer (count: %d)\n", successcount);
+#endif
+    return SID_FILE_ERR_WRITECOUNT;
+  }
+
+  return 0; // no error
+}
+
+s32 SID_FILE_WriteHWord(u16 hword)
+{
+  // ensure little endian coding
+  u8 tmp[2];
+  tmp[0] = (u8)(hword >> 0);
+  tmp[1] = (u8)(hword >> 8);
+  return SID_FILE_WriteBuffer(tmp, 2);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates a directory
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_MakeDir(char *path)
+{
+  // exit if volume not available
+  if( !volume_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE_MakeDir] ERROR: volume doesn't exist!\n");
+#endif
+    return SID_FILE_ERR_NO_VOLUME;
+  }
+
+  if( (sid_file_dfs_errno=f_mkdir(path)) != FR_OK )
+    return SID_FILE_ERR_MKDIR;
+
+  return 0; // directory created
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns 1 if directory exists, 0 if it doesn't exist, < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_DirExists(char *path)
+{
+  DIR dir;
+
+  if( !volume_available ) {
+#if DEBUG_VERBOSE_LEVEL >= 2
+    DEBUG_MSG("[SID_FILE_DirExists] ERROR: volume doesn't exist!\n");
+#endif
+    return SID_FILE_ERR_NO_VOLUME;
+  }
+
+  return (sid_file_dfs_errno=f_opendir(&dir, path)) == FR_OK;
+}
@@ -0,0 +1,118 @@
+// $Id$
+/*
+ * Header for file functions
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _SID_FILE_H
+#define _SID_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// for compatibility with DOSFS
+// TODO: change
+#define MAX_PATH 100
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+// in which subdirectory of the SD card are the MBSID files located?
+#define SID_FILE_PATH "/MBSID"
+
+
+// error codes
+
+#define SID_FILE_ERR_SD_CARD           -1 // failed to access SD card
+#define SID_FILE_ERR_NO_VOLUME         -3 // volume not mounted
+#define SID_FILE_ERR_OPEN_READ         -5 // f_open(..FA_READ..) failed, e.g. file not found
+#define SID_FILE_ERR_OPEN_READ_WITHOUT_CLOSE -6 // SID_FILE_ReadOpen() has been called while previous file hasn't been closed via SID_FILE_ReadClose()
+#define SID_FILE_ERR_READ              -7 // f_read failed
+#define SID_FILE_ERR_READCOUNT         -8 // less bytes read than expected
+#define SID_FILE_ERR_OPEN_WRITE       -11 // f_open(..FA_WRITE..) failed
+#define SID_FILE_ERR_OPEN_WRITE_WITHOUT_CLOSE -12 // SID_FILE_WriteOpen() has been called while previous file hasn't been closed via SID_FILE_WriteClose()
+#define SID_FILE_ERR_WRITE            -13 // f_write failed
+#define SID_FILE_ERR_WRITECOUNT       -14 // less bytes written than expected
+#define SID_FILE_ERR_WRITECLOSE       -15 // f_close aborted due to previous error
+#define SID_FILE_ERR_SEEK             -16 // SID_FILE_*Seek() failed
+#define SID_FILE_ERR_MKDIR            -23 // SID_FILE_MakeDir() failed
+
+// used by sid_file_b.c
+#define SID_FILE_B_ERR_INVALID_BANK    -128 // invalid bank number
+#define SID_FILE_B_ERR_INVALID_PATCH   -130 // invalid patch number
+#define SID_FILE_B_ERR_FORMAT          -131 // invalid bank file format
+#define SID_FILE_B_ERR_READ            -132 // error while reading file (exact error status cannot be determined anymore)
+#define SID_FILE_B_ERR_WRITE           -133 // error while writing file (exact error status cannot be determined anymore)
+#define SID_FILE_B_ERR_NO_FILE         -134 // no or invalid bank file
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+// simplified file reference, part of FIL structure of FatFs
+typedef struct {
+  u8  flag;  // file status flag
+  u8  csect; // sector address in cluster
+  u32 fptr;  // file r/w pointer
+  u32 fsize; // file size
+  u32 org_clust; // file start cluster
+  u32 curr_clust; // current cluster
+  u32 dsect; // current data sector;
+  u32 dir_sect; // sector containing the directory entry
+  u8 *dir_ptr; // pointer to the directory entry in the window
+} sid_file_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 SID_FILE_Init(u32 mode);
+
+extern s32 SID_FILE_CheckSDCard(void);
+
+extern s32 SID_FILE_SDCardAvailable(void);
+extern s32 SID_FILE_VolumeAvailable(void);
+
+extern s32 SID_FILE_LoadAllFiles(void);
+extern s32 SID_FILE_UnloadAllFiles(void);
+
+extern s32 SID_FILE_ReadOpen(sid_file_t* file, char *filepath);
+extern s32 SID_FILE_ReadReOpen(sid_file_t* file);
+extern s32 SID_FILE_ReadClose(sid_file_t* file);
+extern s32 SID_FILE_ReadSeek(u32 offset);
+extern s32 SID_FILE_ReadBuffer(u8 *buffer, u32 len);
+extern s32 SID_FILE_ReadHWord(u16 *hword);
+
+extern s32 SID_FILE_WriteOpen(char *filepath, u8 create);
+extern s32 SID_FILE_WriteClose(void);
+extern s32 SID_FILE_WriteSeek(u32 offset);
+extern s32 SID_FILE_WriteBuffer(u8 *buffer, u32 len);
+extern s32 SID_FILE_WriteHWord(u16 hword);
+
+extern s32 SID_FILE_MakeDir(char *path);
+extern s32 SID_FILE_DirExists(char *path);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+// last error status returned by FatFs
+extern u32 sid_file_dfs_errno;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SID_FILE_H */
@@ -0,0 +1,431 @@
+// $Id$
+/*
+ * Patch bank access functions
+ *
+ * NOTE: before accessing the SD Card, the upper level function should
+ * synchronize with the SD Card semaphore!
+ *   MUTEX_SDCARD_TAKE; // to take the semaphore
+ *   MUTEX_SDCARD_GIVE; // to release the semaphore
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <string.h>
+
+#include "sid_file.h"
+#include "sid_file_b.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// for optional debugging messages via DEBUG_MSG (defined in mios32_config.h)
+/////////////////////////////////////////////////////////////////////////////
+#define DEBUG_VERBOSE_LEVEL 0
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+// Structure of bank file:
+//    Sector 0: file_type[10]
+//              sid_file_b_header_t
+//              (remaining bytes of the sector are 0)
+//    Sector 1: Patch 0 (sid_patch_t, 512 bytes)
+//    Sector 2: Patch 1
+//    ...
+//
+// Each patch is located at a fixed offset which is aligned to a sector:
+//   SID_FILE_B_HEADER_SIZE + patch * patch_size
+// Accordingly a patch can be read with a single seek and sector read,
+// and no patch index has to be stored in the file.
+// 512 + 128 * 512 -> 66048 bytes
+
+// not defined as structure:
+// file_type[10] will contain "MBSIDV3_B" + 0 (zero-terminated string)
+typedef struct {
+  char name[20];      // bank name consists of 20 characters, no zero termination, patted with spaces
+  u16  num_patches;   // number of patches per bank (usually 128)
+  u16  patch_size;    // reserved size for each patch (usually 512)
+} sid_file_b_header_t;  // 24 bytes
+
+#define SID_FILE_B_HEADER_SIZE 512
+
+
+// bank informations stored in RAM
+typedef struct {
+  unsigned valid: 1;  // bank is accessible
+
+  sid_file_b_header_t header;
+
+  sid_file_t file;      // file informations
+} sid_file_b_info_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static sid_file_b_info_t sid_file_b_info[SID_FILE_B_NUM_BANKS];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Initialisation
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_Init(u32 mode)
+{
+  // invalidate all bank infos
+  SID_FILE_B_UnloadAllBanks();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads all banks
+// Called from SID_FILE_CheckSDCard() when the SD card has been connected
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_LoadAllBanks(void)
+{
+  s32 status = 0;
+
+  // load all banks
+  u8 bank;
+  for(bank=0; bank<SID_FILE_B_NUM_BANKS; ++bank) {
+    s32 error = SID_FILE_B_Open(bank);
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] Tried to open bank %c file, status: %d\n", 'A'+bank, error);
+#endif
+    status |= error;
+  }
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Unloads all banks
+// Called from SID_FILE_CheckSDCard() when the SD card has been disconnected
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_UnloadAllBanks(void)
+{
+  // invalidate all bank infos
+  u8 bank;
+  for(bank=0; bank<SID_FILE_B_NUM_BANKS; ++bank)
+    sid_file_b_info[bank].valid = 0;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns number of patches in bank
+// Returns 0 if bank not valid
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_NumPatches(u8 bank)
+{
+  if( (bank < SID_FILE_B_NUM_BANKS) && sid_file_b_info[bank].valid )
+    return sid_file_b_info[bank].header.num_patches;
+
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// create a complete bank file
+// All patch slots are initialized with the given patches (repeated if
+// num_init_patches is less than the number of slots)
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_Create(u8 bank, const u8 *init_patches, u8 num_init_patches)
+{
+  if( bank >= SID_FILE_B_NUM_BANKS )
+    return SID_FILE_B_ERR_INVALID_BANK;
+
+  if( !num_init_patches )
+    return SID_FILE_B_ERR_INVALID_PATCH;
+
+  sid_file_b_info_t *info = &sid_file_b_info[bank];
+  info->valid = 0; // set to invalid as long as we are not sure if file can be accessed
+
+  // create directory if it doesn't exist
+  if( !SID_FILE_DirExists(SID_FILE_PATH) )
+    SID_FILE_MakeDir(SID_FILE_PATH); // status doesn't matter, we will see it on file open
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/BANK_%c.V3", SID_FILE_PATH, 'A'+bank);
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SID_FILE_B] Creating new bank file '%s'\n", filepath);
+#endif
+
+  s32 status = 0;
+  if( (status=SID_FILE_WriteOpen(filepath, 1)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] Failed to create file, status: %d\n", status);
+#endif
+    return status;
+  }
+
+  // write sid_file_b_header
+  const char file_type[10] = "MBSIDV3_B";
+  status |= SID_FILE_WriteBuffer((u8 *)file_type, 10);
+
+  // write bank name w/o zero terminator
+  char bank_name[21];
+  sprintf(bank_name, "Default Bank        ");
+  memcpy(info->header.name, bank_name, 20);
+  status |= SID_FILE_WriteBuffer((u8 *)info->header.name, 20);
+
+  // number of patches
+  info->header.num_patches = SID_FILE_B_NUM_PATCHES;
+  status |= SID_FILE_WriteHWord(info->header.num_patches);
+
+  // patch size
+  info->header.patch_size = SID_FILE_B_PATCH_SIZE;
+  status |= SID_FILE_WriteHWord(info->header.patch_size);
+
+  // fill remaining header sector with zeroes
+  u8 zero[SID_FILE_B_HEADER_SIZE - 10 - sizeof(sid_file_b_header_t)];
+  memset(zero, 0, sizeof(zero));
+  status |= SID_FILE_WriteBuffer(zero, sizeof(zero));
+
+  // write patch slots
+  u32 patch;
+  for(patch=0; patch<info->header.num_patches; ++patch)
+    status |= SID_FILE_WriteBuffer((u8 *)&init_patches[(patch % num_init_patches) * SID_FILE_B_PATCH_SIZE], SID_FILE_B_PATCH_SIZE);
+
+  // close file
+  status |= SID_FILE_WriteClose();
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] Bank file creation failed with status %d\n", status);
+#endif
+    return SID_FILE_B_ERR_WRITE;
+  }
+
+  // open bank to get the file informations for read operations
+  return SID_FILE_B_Open(bank);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// open a bank file
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_Open(u8 bank)
+{
+  if( bank >= SID_FILE_B_NUM_BANKS )
+    return SID_FILE_B_ERR_INVALID_BANK;
+
+  sid_file_b_info_t *info = &sid_file_b_info[bank];
+
+  info->valid = 0; // will be set to valid if bank header has been read successfully
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/BANK_%c.V3", SID_FILE_PATH, 'A'+bank);
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SID_FILE_B] Open bank file '%s'\n", filepath);
+#endif
+
+  s32 status;
+  if( (status=SID_FILE_ReadOpen(&info->file, filepath)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] failed to open file, status: %d\n", status);
+#endif
+    return status;
+  }
+
+  // read and check header
+  // in order to avoid endianess issues, we have to read the sector bytewise!
+  char file_type[10];
+  if( (status=SID_FILE_ReadBuffer((u8 *)file_type, 10)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] failed to read header, status: %d\n", status);
+#endif
+    SID_FILE_ReadClose(&info->file);
+    return status;
+  }
+
+  if( strncmp(file_type, "MBSIDV3_B", 10) != 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    file_type[9] = 0; // ensure that string is terminated
+    DEBUG_MSG("[SID_FILE_B] wrong header type: %s\n", file_type);
+#endif
+    SID_FILE_ReadClose(&info->file);
+    return SID_FILE_B_ERR_FORMAT;
+  }
+
+  status |= SID_FILE_ReadBuffer((u8 *)info->header.name, 20);
+  status |= SID_FILE_ReadHWord((u16 *)&info->header.num_patches);
+  status |= SID_FILE_ReadHWord((u16 *)&info->header.patch_size);
+
+  // close file (so that it can be re-opened)
+  SID_FILE_ReadClose(&info->file);
+
+  if( status < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] file access error while reading header, status: %d\n", status);
+#endif
+    return SID_FILE_B_ERR_READ;
+  }
+
+  if( info->header.patch_size < SID_FILE_B_PATCH_SIZE ||
+      info->header.num_patches > SID_FILE_B_NUM_PATCHES ||
+      info->file.fsize < (SID_FILE_B_HEADER_SIZE + (u32)info->header.num_patches * info->header.patch_size) ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] invalid bank size (%d patches, patch size %d, file size %u)\n",
+	      info->header.num_patches, info->header.patch_size, info->file.fsize);
+#endif
+    return SID_FILE_B_ERR_FORMAT;
+  }
+
+  // bank is valid! :)
+  info->valid = 1;
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SID_FILE_B] bank is valid! Number of Patches: %d, Patch Size: %d\n", info->header.num_patches, info->header.patch_size);
+#endif
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// reads a patch from bank into the given buffer (SID_FILE_B_PATCH_SIZE bytes)
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_PatchRead(u8 bank, u8 patch, u8 *buffer)
+{
+  if( bank >= SID_FILE_B_NUM_BANKS )
+    return SID_FILE_B_ERR_INVALID_BANK;
+
+  sid_file_b_info_t *info = &sid_file_b_info[bank];
+
+  if( !info->valid )
+    return SID_FILE_B_ERR_NO_FILE;
+
+  if( patch >= info->header.num_patches )
+    return SID_FILE_B_ERR_INVALID_PATCH;
+
+  // re-open file
+  if( SID_FILE_ReadReOpen(&info->file) < 0 )
+    return SID_FILE_B_ERR_READ; // file cannot be re-opened
+
+  // change to file position
+  s32 status;
+  u32 offset = SID_FILE_B_HEADER_SIZE + patch * info->header.patch_size;
+  if( (status=SID_FILE_ReadSeek(offset)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] failed to change patch offset in file, status: %d\n", status);
+#endif
+    // close file (so that it can be re-opened)
+    SID_FILE_ReadClose(&info->file);
+    return SID_FILE_B_ERR_READ;
+  }
+
+  status = SID_FILE_ReadBuffer(buffer, SID_FILE_B_PATCH_SIZE);
+
+  // close file (so that it can be re-opened)
+  SID_FILE_ReadClose(&info->file);
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SID_FILE_B] read patch %c%03d, status %d\n", 'A'+bank, patch+1, status);
+#endif
+
+  return (status < 0) ? SID_FILE_B_ERR_READ : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// writes a patch (SID_FILE_B_PATCH_SIZE bytes) into the bank
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_PatchWrite(u8 bank, u8 patch, u8 *buffer)
+{
+  if( bank >= SID_FILE_B_NUM_BANKS )
+    return SID_FILE_B_ERR_INVALID_BANK;
+
+  sid_file_b_info_t *info = &sid_file_b_info[bank];
+
+  if( !info->valid )
+    return SID_FILE_B_ERR_NO_FILE;
+
+  if( patch >= info->header.num_patches )
+    return SID_FILE_B_ERR_INVALID_PATCH;
+
+  char filepath[MAX_PATH];
+  sprintf(filepath, "%s/BANK_%c.V3", SID_FILE_PATH, 'A'+bank);
+
+  s32 status;
+  if( (status=SID_FILE_WriteOpen(filepath, 0)) < 0 ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[SID_FILE_B] Failed to open file, status: %d\n", status);
+#endif
+    return status;
+  }
+
+  // change to file position and overwrite the patch slot
+  u32 offset = SID_FILE_B_HEADER_SIZE + patch * info->header.patch_size;
+  if( (status=SID_FILE_WriteSeek(offset)) >= 0 )
+    status = SID_FILE_WriteBuffer(buffer, SID_FILE_B_PATCH_SIZE);
+
+  // close file
+  status |= SID_FILE_WriteClose();
+
+#if DEBUG_VERBOSE_LEVEL >= 1
+  DEBUG_MSG("[SID_FILE_B] write patch %c%03d, status %d\n", 'A'+bank, patch+1, status);
+#endif
+
+  return (status < 0) ? SID_FILE_B_ERR_WRITE : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// returns the name of a patch (16 characters + zero terminator)
+// returns < 0 on errors (error codes are documented in sid_file.h)
+/////////////////////////////////////////////////////////////////////////////
+s32 SID_FILE_B_PatchPeekName(u8 bank, u8 patch, char *patch_name)
+{
+  if( bank >= SID_FILE_B_NUM_BANKS )
+    return SID_FILE_B_ERR_INVALID_BANK;
+
+  sid_file_b_info_t *info = &sid_file_b_info[bank];
+
+  if( !info->valid )
+    return SID_FILE_B_ERR_NO_FILE;
+
+  if( patch >= info->header.num_patches )
+    return SID_FILE_B_ERR_INVALID_PATCH;
+
+  // re-open file
+  if( SID_FILE_ReadReOpen(&info->file) < 0 )
+    return SID_FILE_B_ERR_READ; // file cannot be re-opened
+
+  // the name is located at the beginning of the patch
+  s32 status;
+  u32 offset = SID_FILE_B_HEADER_SIZE + patch * info->header.patch_size;
+  if( (status=SID_FILE_ReadSeek(offset)) >= 0 )
+    status = SID_FILE_ReadBuffer((u8 *)patch_name, 16);
+  patch_name[16] = 0;
+
+  // close file (so that it can be re-opened)
+  SID_FILE_ReadClose(&info->file);
+
+  return (status < 0) ? SID_FILE_B_ERR_READ : 0;
+}
@@ -0,0 +1,63 @@
+// $Id$
+/*
+ * Header for patch bank file functions
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _SID_FILE_B_H
+#define _SID_FILE_B_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define SID_FILE_B_NUM_BANKS   8
+#define SID_FILE_B_NUM_PATCHES 128
+#define SID_FILE_B_PATCH_SIZE  512
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 SID_FILE_B_Init(u32 mode);
+extern s32 SID_FILE_B_LoadAllBanks(void);
+extern s32 SID_FILE_B_UnloadAllBanks(void);
+
+extern s32 SID_FILE_B_NumPatches(u8 bank);
+
+extern s32 SID_FILE_B_Create(u8 bank, const u8 *init_patches, u8 num_init_patches);
+extern s32 SID_FILE_B_Open(u8 bank);
+
+extern s32 SID_FILE_B_PatchRead(u8 bank, u8 patch, u8 *buffer);
+extern s32 SID_FILE_B_PatchWrite(u8 bank, u8 patch, u8 *buffer);
+
+extern s32 SID_FILE_B_PatchPeekName(u8 bank, u8 patch, char *patch_name);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SID_FILE_B_H */
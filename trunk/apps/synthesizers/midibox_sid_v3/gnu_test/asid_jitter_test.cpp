@@ -0,0 +1,307 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Host test of the ASID jitter buffer and burst decoding
+ *
+ * - a SID player sends frames at 50 Hz, they are delivered in bunches of
+ *   two frames with random jitter (like an USB MIDI driver does).
+ *   The time between register updates is measured with and without
+ *   jitter buffer
+ * - the decoding of complete SysEx buffers has to result in the same
+ *   register writes like the byte parser, and the decoding time is compared
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "MbSidEnvironment.h"
+
+
+#define FRAME_PERIOD_MS   20   // 50 Hz
+#define NUM_FRAMES        3000 // 1 minute
+#define MAX_JITTER_MS     3
+#define JITTER_DEPTH      3
+#define NUM_DECODE_FRAMES 100000
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated functions of the application/SID module
+/////////////////////////////////////////////////////////////////////////////
+extern "C" s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+    return 0; // acknowledge messages are not forwarded
+}
+
+sid_regs_t sid_regs[SID_NUM];
+
+// SID register writes of the left SID are recorded
+#define MAX_WRITES 64
+static u8 writtenReg[MAX_WRITES];
+static u8 writtenValue[MAX_WRITES];
+static int numWritten;
+static int numUpdates;
+
+// time of frame updates (detected by register 0x00, which contains the frame number)
+static u32 currentTimeMs;
+static u32 lastUpdateMs;
+static bool lastUpdateValid;
+static u32 updateIntervalHist[2*FRAME_PERIOD_MS+1];
+static u8 lastFrameNum;
+static int outOfOrder;
+
+extern "C" s32 SID_Update(u32 mode)
+{
+    ++numUpdates;
+
+    sid_regs_t *sid_l = &sid_regs[0];
+    for(int reg=0; reg<SID_REGS_NUM; ++reg) {
+        if( sid_l->dirty & (1 << reg) ) {
+            if( numWritten < MAX_WRITES ) {
+                writtenReg[numWritten] = reg;
+                writtenValue[numWritten] = sid_l->ALL[reg];
+                ++numWritten;
+            }
+
+            if( reg == 0x00 ) {
+                if( lastUpdateValid ) {
+                    u32 interval = currentTimeMs - lastUpdateMs;
+                    if( interval > 2*FRAME_PERIOD_MS )
+                        interval = 2*FRAME_PERIOD_MS;
+                    ++updateIntervalHist[interval];
+                    if( sid_l->ALL[reg] != (u8)(lastFrameNum + 1) )
+                        ++outOfOrder;
+                }
+                lastUpdateMs = currentTimeMs;
+                lastUpdateValid = true;
+                lastFrameNum = sid_l->ALL[reg];
+            }
+        }
+    }
+
+    sid_regs[0].dirty = 0;
+    sid_regs[1].dirty = 0;
+
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+static MbSidEnvironment mbSidEnvironment;
+static int errors;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random numbers (reproducible)
+/////////////////////////////////////////////////////////////////////////////
+static u32 seed = 1;
+
+static u32 Random(u32 range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(bool condition, const char *format, int value)
+{
+    if( !condition ) {
+        printf("ERROR: ");
+        printf(format, value);
+        printf("\n");
+        ++errors;
+    }
+}
+
+// creates an ASID sequence command which writes the frame number into register 0x00,
+// some random registers and both control register entries of voice 1
+// returns the length
+static u32 FrameCreate(u8 *buffer, u8 frameNum)
+{
+    u8 masks[4] = { 0, 0, 0, 0 };
+    u8 msbs[4] = { 0, 0, 0, 0 };
+    u8 values[28];
+    int numValues = 0;
+
+    for(int reg_ix=0; reg_ix<28; ++reg_ix) {
+        bool set = reg_ix == 0 || reg_ix == 22 || reg_ix == 25 || Random(3) == 0;
+        if( set ) {
+            u8 value = (reg_ix == 0) ? frameNum : Random(256);
+            masks[reg_ix/7] |= 1 << (reg_ix % 7);
+            if( value & 0x80 )
+                msbs[reg_ix/7] |= 1 << (reg_ix % 7);
+            values[numValues++] = value & 0x7f;
+        }
+    }
+
+    u32 len = 0;
+    buffer[len++] = 0xf0;
+    buffer[len++] = 0x2d;
+    buffer[len++] = 0x4e;
+    for(int i=0; i<4; ++i)
+        buffer[len++] = masks[i];
+    for(int i=0; i<4; ++i)
+        buffer[len++] = msbs[i];
+    for(int i=0; i<numValues; ++i)
+        buffer[len++] = values[i];
+    buffer[len++] = 0xf7;
+
+    return len;
+}
+
+static void SendBytes(u8 *buffer, u32 len)
+{
+    for(u32 i=0; i<len; ++i)
+        mbSidEnvironment.midiReceiveSysEx(DEFAULT, buffer[i]);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Streams NUM_FRAMES frames with the given jitter depth
+// returns the standard deviation of the update intervals in mS
+/////////////////////////////////////////////////////////////////////////////
+static double Stream(u8 jitterDepth)
+{
+    MbSidAsid *mbSidAsid = &mbSidEnvironment.mbSidAsid;
+
+    mbSidAsid->jitterDepthSet(jitterDepth);
+    memset(updateIntervalHist, 0, sizeof(updateIntervalHist));
+    lastUpdateValid = false;
+    outOfOrder = 0;
+
+    // the frames are sent in bunches of two with random jitter
+    u32 arrivalMs[NUM_FRAMES];
+    for(int frame=0; frame<NUM_FRAMES; ++frame)
+        arrivalMs[frame] = (frame | 1) * FRAME_PERIOD_MS + Random(MAX_JITTER_MS+1);
+
+    int frame = 0;
+    for(currentTimeMs=0; frame<NUM_FRAMES || currentTimeMs < arrivalMs[NUM_FRAMES-1] + 10*FRAME_PERIOD_MS; ++currentTimeMs) {
+        while( frame < NUM_FRAMES && arrivalMs[frame] <= currentTimeMs ) {
+            u8 buffer[64];
+            u32 len = FrameCreate(buffer, frame);
+            mbSidEnvironment.midiReceiveSysExBuffer(DEFAULT, buffer, len);
+            ++frame;
+        }
+
+        mbSidEnvironment.tick();
+    }
+
+    // standard deviation from the nominal period
+    double sum = 0;
+    int num = 0;
+    int minInterval = -1;
+    int maxInterval = -1;
+    for(int interval=0; interval<=2*FRAME_PERIOD_MS; ++interval) {
+        if( updateIntervalHist[interval] ) {
+            if( minInterval < 0 )
+                minInterval = interval;
+            maxInterval = interval;
+        }
+        double diff = interval - FRAME_PERIOD_MS;
+        sum += diff * diff * updateIntervalHist[interval];
+        num += updateIntervalHist[interval];
+    }
+    double deviation = num ? sqrt(sum / num) : 0.0;
+
+    mbsid_asid_stats_t stats;
+    mbSidAsid->statsGet(&stats);
+    printf("Jitter depth %d: interval deviation %.2f mS, %d..%d mS, estimated rate %.2f Hz, %u underruns, %u overflows\n",
+           jitterDepth, deviation,
+           minInterval, maxInterval,
+           1000000.0 / stats.framePeriodUs, stats.underruns, stats.overflows);
+    Check(num == NUM_FRAMES-1, "%d frames not played", NUM_FRAMES-1-num);
+    Check(outOfOrder == 0, "%d frames played out of order", outOfOrder);
+
+    return deviation;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    MbSidAsid *mbSidAsid = &mbSidEnvironment.mbSidAsid;
+    u8 buffer[64];
+
+    // burst decoding has to match the byte parser
+    for(int i=0; i<100; ++i) {
+        u32 len = FrameCreate(buffer, i);
+
+        numWritten = numUpdates = 0;
+        SendBytes(buffer, len);
+        int numWrittenBytes = numWritten;
+        int numUpdatesBytes = numUpdates;
+        u8 regsBytes[MAX_WRITES];
+        u8 valuesBytes[MAX_WRITES];
+        memcpy(regsBytes, writtenReg, numWritten);
+        memcpy(valuesBytes, writtenValue, numWritten);
+
+        numWritten = numUpdates = 0;
+        Check(mbSidEnvironment.midiReceiveSysExBuffer(DEFAULT, buffer, len) == 1, "frame %d not taken by burst decoder", i);
+
+        if( numWritten != numWrittenBytes || numUpdates != numUpdatesBytes ||
+            memcmp(regsBytes, writtenReg, numWritten) != 0 ||
+            memcmp(valuesBytes, writtenValue, numWritten) != 0 ) {
+            Check(false, "frame %d: burst decoding differs from byte parser", i);
+        }
+
+        // the control register is written twice: the first value has to reach the SID
+        Check(numUpdates == 2, "frame %d: control register writes not separated", i);
+    }
+    Check(mbSidAsid->modeGet() == MBSID_ASID_MODE_ON, "ASID mode not enabled%c", ' ');
+
+    // decoding time
+    u32 len = FrameCreate(buffer, 0);
+    unsigned long long t0 = TimeGet();
+    for(int i=0; i<NUM_DECODE_FRAMES; ++i)
+        SendBytes(buffer, len);
+    unsigned long long t1 = TimeGet();
+    for(int i=0; i<NUM_DECODE_FRAMES; ++i)
+        mbSidEnvironment.midiReceiveSysExBuffer(DEFAULT, buffer, len);
+    unsigned long long t2 = TimeGet();
+    printf("Decoding of %u byte frames: %.1f nS per frame byte by byte, %.1f nS per frame at once\n",
+           len, (double)(t1 - t0) / NUM_DECODE_FRAMES, (double)(t2 - t1) / NUM_DECODE_FRAMES);
+
+    // streaming
+    double deviationImmediate = Stream(0);
+    double deviationBuffered = Stream(JITTER_DEPTH);
+    Check(deviationBuffered < 1.0, "update intervals of jitter buffer deviate by %d mS", (int)deviationBuffered);
+    Check(deviationBuffered < deviationImmediate / 4, "jitter buffer doesn't improve the timing%c", ' ');
+
+    mbsid_asid_stats_t stats;
+    mbSidAsid->statsGet(&stats);
+    Check(stats.underruns <= 1, "%d underruns", stats.underruns);
+    Check(stats.framePeriodUs >= 19500 && stats.framePeriodUs <= 20500, "frame period estimated with %d uS", stats.framePeriodUs);
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    return errors ? 1 : 0;
+}
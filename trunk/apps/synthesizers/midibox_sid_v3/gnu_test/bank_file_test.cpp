@@ -0,0 +1,283 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Host test of the patch bank files
+ *
+ * A FAT file system is created in an image file which emulates the SD Card
+ * (sdcard_image.c). Thereafter:
+ * - bank B is written with modified ROM patches, one patch is stored into
+ *   bank A, which creates a copy of the ROM bank
+ * - all patches are read back after the SD Card has been re-connected
+ * - sequential program changes are sent with idle time for the low priority
+ *   task between them: all patches have to be served from the prefetched
+ *   cache without any SD Card access
+ * - random program changes are sent without idle time (worst case)
+ * - a stored patch has to be available from the cache (write-through) and
+ *   from the file
+ *
+ * Usage: bank_file_test [<image file>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include <ff.h>
+}
+
+#include "MbSidEnvironment.h"
+#include "sid_file.h"
+#include "sdcard_image.h"
+
+
+#define IMAGE_SECTORS      32768 // 16 MB
+#define NUM_RANDOM_CHANGES 2000
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated functions of the application/SID module
+/////////////////////////////////////////////////////////////////////////////
+extern "C" s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+    return 0; // acknowledge messages are not forwarded
+}
+
+sid_regs_t sid_regs[SID_NUM];
+
+extern "C" s32 SID_Update(u32 mode)
+{
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+static MbSidEnvironment mbSidEnvironment;
+static int errors;
+
+// expected content of bank B
+static sid_patch_t expected[MBSID_BANK_NUM_PATCHES];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random numbers (reproducible)
+/////////////////////////////////////////////////////////////////////////////
+static u32 seed = 1;
+
+static u32 Random(u32 range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(bool condition, const char *format, int value)
+{
+    if( !condition ) {
+        printf("ERROR: ");
+        printf(format, value);
+        printf("\n");
+        ++errors;
+    }
+}
+
+static void SendProgramChange(u8 patch)
+{
+    mios32_midi_package_t p;
+    p.ALL = 0;
+    p.type = 0xc;
+    p.event = ProgramChange;
+    p.chn = Chn1;
+    p.evnt1 = patch;
+    mbSidEnvironment.midiReceive(DEFAULT, p);
+}
+
+static bool PatchEqual(const sid_patch_t *a, const sid_patch_t *b)
+{
+    return memcmp(a->ALL, b->ALL, sizeof(sid_patch_t)) == 0;
+}
+
+static void Reconnect(char *imageFile)
+{
+    SDCARD_IMAGE_Close();
+    Check(SID_FILE_CheckSDCard() == 2, "SD Card disconnection not detected", 0);
+    mbSidEnvironment.mbSidBank.cacheInvalidate();
+
+    SDCARD_IMAGE_Open(imageFile);
+    Check(SID_FILE_CheckSDCard() == 1, "SD Card connection not detected", 0);
+    mbSidEnvironment.mbSidBank.cacheInvalidate();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    char *imageFile = (char *)((argc >= 2) ? argv[1] : "bank_file_test.img");
+    MbSid *mbSid = &mbSidEnvironment.mbSid[0];
+    MbSidBank *mbSidBank = &mbSidEnvironment.mbSidBank;
+
+    // create an empty FAT file system
+    static FATFS fs;
+    if( SDCARD_IMAGE_Create(imageFile, IMAGE_SECTORS) < 0 ) {
+        printf("ERROR: can't create image file %s\n", imageFile);
+        return 1;
+    }
+    f_mount(0, &fs);
+    if( f_mkfs(0, 1, 0) != FR_OK ) {
+        printf("ERROR: f_mkfs failed\n");
+        return 1;
+    }
+
+    SID_FILE_Init(0);
+    Check(SID_FILE_CheckSDCard() == 1, "SD Card connection not detected", 0);
+
+    // no bank files yet: only bank A is available (ROM)
+    Check(mbSidEnvironment.bankLoad(0, 1, 0) == -4, "bank B shouldn't be available", 0);
+    Check(mbSidEnvironment.bankLoad(0, 0, 4) == 0, "ROM patch A%03d not available", 5);
+
+    // fill bank B with modified ROM patches
+    u32 writes = sdcard_image_sector_writes;
+    unsigned long long t0 = TimeGet();
+    for(int patch=0; patch<MBSID_BANK_NUM_PATCHES; ++patch) {
+        Check(mbSidEnvironment.bankLoad(0, 0, patch) == 0, "ROM patch A%03d not available", patch+1);
+        char name[17];
+        sprintf(name, "B%03d %-11.11s", patch+1, (char *)mbSid->mbSidPatch.body.name);
+        memcpy(mbSid->mbSidPatch.body.name, name, 16);
+        mbSid->mbSidPatch.copyFromPatch(&expected[patch]);
+        Check(mbSidEnvironment.bankSave(0, 1, patch) == 0, "failed to store patch B%03d", patch+1);
+    }
+    unsigned long long t1 = TimeGet();
+    printf("Bank B stored: %u sector writes, %.1f uS per patch\n",
+           sdcard_image_sector_writes - writes, (double)(t1 - t0) / MBSID_BANK_NUM_PATCHES / 1000);
+
+    // store into bank A: a copy of the ROM bank is created
+    mbSidEnvironment.bankLoad(0, 0, 5);
+    sid_patch_t romPatch6;
+    mbSid->mbSidPatch.copyFromPatch(&romPatch6);
+    mbSidEnvironment.bankLoad(0, 1, 4);
+    Check(mbSidEnvironment.bankSave(0, 0, 4) == 0, "failed to store patch A%03d", 5);
+
+    // re-connect the SD Card, everything has to be read from the files again
+    Reconnect(imageFile);
+
+    mbSidEnvironment.bankLoad(0, 0, 4);
+    Check(PatchEqual(&mbSid->mbSidPatch.body, &expected[4]), "patch A%03d not stored in bank file", 5);
+    mbSidEnvironment.bankLoad(0, 0, 5);
+    Check(PatchEqual(&mbSid->mbSidPatch.body, &romPatch6), "patch A%03d not copied from ROM", 6);
+
+    int numFailed = 0;
+    for(int i=0; i<MBSID_BANK_NUM_PATCHES; ++i) {
+        u8 patch = (i * 37) % MBSID_BANK_NUM_PATCHES; // scrambled order
+        if( mbSidEnvironment.bankLoad(0, 1, patch) < 0 ||
+            !PatchEqual(&mbSid->mbSidPatch.body, &expected[patch]) ) {
+            if( ++numFailed <= 10 )
+                printf("ERROR: patch B%03d differs after re-connection\n", patch+1);
+        }
+    }
+    printf("Bank B read back: %d patches checked, %d failed\n", MBSID_BANK_NUM_PATCHES, numFailed);
+    errors += numFailed;
+
+    char name[17];
+    mbSidEnvironment.bankPatchNameGet(1, 99, name);
+    Check(strncmp(name, "B100", 4) == 0, "wrong name of patch B%03d", 100);
+    mbSidEnvironment.bankPatchNameGet(2, 0, name);
+    Check(strncmp(name, "<Empty Bank C>", 14) == 0, "bank %c shouldn't be available", 'C');
+
+    // sequential program changes, the low priority task runs between them
+    Reconnect(imageFile);
+    mbSidEnvironment.bankLoad(0, 1, 0);
+    mbSidBank->cacheHits = mbSidBank->cacheMisses = mbSidBank->prefetchLoads = 0;
+
+    int noAccess = 0;
+    numFailed = 0;
+    unsigned long long tChange = 0;
+    for(int patch=1; patch<MBSID_BANK_NUM_PATCHES; ++patch) {
+        for(int i=0; i<MBSID_BANK_PREFETCH_NUM; ++i)
+            mbSidBank->prefetchHandler();
+
+        u32 reads = sdcard_image_sector_reads;
+        t0 = TimeGet();
+        SendProgramChange(patch);
+        tChange += TimeGet() - t0;
+        if( sdcard_image_sector_reads == reads )
+            ++noAccess;
+
+        if( mbSid->mbSidPatch.patchNum != patch || !PatchEqual(&mbSid->mbSidPatch.body, &expected[patch]) )
+            ++numFailed;
+    }
+    printf("Sequential program changes: %d of %d without SD Card access, %.1f uS per change (%u hits, %u misses, %u prefetched)\n",
+           noAccess, MBSID_BANK_NUM_PATCHES-1, (double)tChange / (MBSID_BANK_NUM_PATCHES-1) / 1000,
+           mbSidBank->cacheHits, mbSidBank->cacheMisses, mbSidBank->prefetchLoads);
+    Check(numFailed == 0, "%d sequential program changes selected the wrong patch", numFailed);
+    // the first change can't be predicted
+    Check(noAccess >= MBSID_BANK_NUM_PATCHES-2, "%d sequential program changes accessed the SD Card", MBSID_BANK_NUM_PATCHES-1-noAccess);
+
+    // random program changes without idle time
+    mbSidBank->cacheHits = mbSidBank->cacheMisses = mbSidBank->prefetchLoads = 0;
+    numFailed = 0;
+    u32 reads = sdcard_image_sector_reads;
+    t0 = TimeGet();
+    for(int i=0; i<NUM_RANDOM_CHANGES; ++i) {
+        u8 patch = Random(MBSID_BANK_NUM_PATCHES);
+        SendProgramChange(patch);
+        if( mbSid->mbSidPatch.patchNum != patch || !PatchEqual(&mbSid->mbSidPatch.body, &expected[patch]) )
+            ++numFailed;
+    }
+    t1 = TimeGet();
+    reads = sdcard_image_sector_reads - reads;
+    printf("Random program changes: %d changes, %.1f uS per change (%u hits, %u misses, %.2f sector reads per miss)\n",
+           NUM_RANDOM_CHANGES, (double)(t1 - t0) / NUM_RANDOM_CHANGES / 1000,
+           mbSidBank->cacheHits, mbSidBank->cacheMisses,
+           mbSidBank->cacheMisses ? (double)reads / mbSidBank->cacheMisses : 0.0);
+    Check(numFailed == 0, "%d random program changes selected the wrong patch", numFailed);
+
+    // write-through
+    mbSidEnvironment.bankLoad(0, 1, 10);
+    memcpy(mbSid->mbSidPatch.body.name, "Changed Name    ", 16);
+    mbSid->mbSidPatch.copyFromPatch(&expected[10]);
+    mbSidEnvironment.bankSave(0, 1, 10);
+    mbSidEnvironment.bankLoad(0, 1, 11);
+    reads = sdcard_image_sector_reads;
+    mbSidEnvironment.bankLoad(0, 1, 10);
+    Check(sdcard_image_sector_reads == reads, "stored patch B%03d not cached", 11);
+    Check(PatchEqual(&mbSid->mbSidPatch.body, &expected[10]), "stored patch B%03d not updated in cache", 11);
+
+    Reconnect(imageFile);
+    mbSidEnvironment.bankLoad(0, 1, 10);
+    Check(PatchEqual(&mbSid->mbSidPatch.body, &expected[10]), "stored patch B%03d not updated in file", 11);
+
+    SDCARD_IMAGE_Close();
+    remove(imageFile);
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    return errors ? 1 : 0;
+}
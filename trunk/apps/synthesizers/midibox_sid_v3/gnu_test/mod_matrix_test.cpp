@@ -0,0 +1,370 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Host test of the MbSidMod modulation matrix
+ *
+ * The compiled modulation pathes of MbSidMod are compared against the
+ * previous implementation (ReferenceTick(), which decodes the patch on
+ * each update) with random patches and random modulation sources.
+ * The modulation sources and destinations have to be identical after
+ * each tick, incl. feedbacks over MOD1..8 and sample&hold states.
+ * Patches are changed during the test like parSet() and
+ * sysexSetParameter() would do.
+ *
+ * Thereafter the update time of both implementations is measured with
+ * a typical patch (6 active pathes).
+ *
+ * Usage: mod_matrix_test [<ticks>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MbSidMod.h"
+
+
+#define NUM_PATCHES        1000
+#define BENCHMARK_TICKS    1000000
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random numbers (reproducible)
+/////////////////////////////////////////////////////////////////////////////
+static u32 seed = 1;
+
+static u32 Random(u32 range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reference: previous implementation of MbSidMod::tick()
+/////////////////////////////////////////////////////////////////////////////
+static void ReferenceTick(sid_se_mod_patch_t *modPatch, s16 *modSrc, s32 *modDst, u8 &modTransition)
+{
+    // calculate modulation pathes
+    sid_se_mod_patch_t *mp = modPatch;
+    for(int i=0; i<8; ++i, ++mp) {
+        if( mp->depth != 0 ) {
+
+            // first source
+            s32 mod_src1_value;
+            if( !mp->src1 ) {
+                mod_src1_value = 0;
+            } else {
+                if( mp->src1 & (1 << 7) ) {
+                    // constant range 0x00..0x7f -> +0x0000..0x38f0
+                    mod_src1_value = (mp->src1 & 0x7f) << 7;
+                } else {
+                    // modulation range +/- 0x3fff
+                    mod_src1_value = modSrc[mp->src1-1] / 2;
+                }
+            }
+
+            // second source
+            s32 mod_src2_value;
+            if( !mp->src2 ) {
+                mod_src2_value = 0;
+            } else {
+                if( mp->src2 & (1 << 7) ) {
+                    // constant range 0x00..0x7f -> +0x0000..0x38f0
+                    mod_src2_value = (mp->src2 & 0x7f) << 7;
+                } else {
+                    // modulation range +/- 0x3fff
+                    mod_src2_value = modSrc[mp->src2-1] / 2;
+                }
+            }
+
+            // apply operator
+            s16 mod_result;
+            switch( mp->op & 0x0f ) {
+            case 0: // disabled
+                mod_result = 0;
+                break;
+
+            case 1: // SRC1 only
+                mod_result = mod_src1_value;
+                break;
+
+            case 2: // SRC2 only
+                mod_result = mod_src2_value;
+                break;
+
+            case 3: // SRC1+SRC2
+                mod_result = mod_src1_value + mod_src2_value;
+                break;
+
+            case 4: // SRC1-SRC2
+                mod_result = mod_src1_value - mod_src2_value;
+                break;
+
+            case 5: // SRC1*SRC2 / 8192 (to avoid overrun)
+                mod_result = (mod_src1_value * mod_src2_value) / 8192;
+                break;
+
+            case 6: // XOR
+                mod_result = mod_src1_value ^ mod_src2_value;
+                break;
+
+            case 7: // OR
+                mod_result = mod_src1_value | mod_src2_value;
+                break;
+
+            case 8: // AND
+                mod_result = mod_src1_value & mod_src2_value;
+                break;
+
+            case 9: // Min
+                mod_result = (mod_src1_value < mod_src2_value) ? mod_src1_value : mod_src2_value;
+                break;
+
+            case 10: // Max
+                mod_result = (mod_src1_value > mod_src2_value) ? mod_src1_value : mod_src2_value;
+                break;
+
+            case 11: // SRC1 < SRC2
+                mod_result = (mod_src1_value < mod_src2_value) ? 0x7fff : 0x0000;
+                break;
+
+            case 12: // SRC1 > SRC2
+                mod_result = (mod_src1_value > mod_src2_value) ? 0x7fff : 0x0000;
+                break;
+
+            case 13: { // SRC1 == SRC2 (with tolarance of +/- 64
+                s32 diff = mod_src1_value - mod_src2_value;
+                mod_result = (diff > -64 && diff < 64) ? 0x7fff : 0x0000;
+            } break;
+
+            case 14: { // S&H - SRC1 will be sampled whenever SRC2 changes from a negative to a positive value
+                // check for SRC2 transition
+                u8 old_mod_transition = modTransition;
+                if( mod_src2_value < 0 )
+                    modTransition &= ~(1 << i);
+                else
+                    modTransition |= (1 << i);
+
+                if( modTransition != old_mod_transition && mod_src2_value >= 0 ) // only on positive transition
+                    mod_result = mod_src1_value; // sample: take new mod value
+                else
+                    mod_result = modSrc[SID_SE_MOD_SRC_MOD1 + i]; // hold: take old mod value
+            } break;
+
+            default:
+                mod_result = 0;
+            }
+
+            // store in modulator source array for feedbacks
+            // use value w/o depth, this has two advantages:
+            // - maximum resolution when forwarding the data value
+            // - original MOD value can be taken for sample&hold feature
+            // bit it also has disadvantage:
+            // - the user could think it is a bug when depth doesn't affect the feedback MOD value...
+            modSrc[SID_SE_MOD_SRC_MOD1 + i] = mod_result;
+
+            // forward to destinations
+            if( mod_result ) {
+                s32 scaled_mod_result = ((s32)mp->depth-128) * mod_result / 64; // (+/- 0x7fff * +/- 0x7f) / 128
+      
+                // invert result if requested
+                s32 mod_dst1 = (mp->op & (1 << 6)) ? -scaled_mod_result : scaled_mod_result;
+                s32 mod_dst2 = (mp->op & (1 << 7)) ? -scaled_mod_result : scaled_mod_result;
+
+                // add result to modulation target array
+                u8 x_target1 = mp->x_target[0];
+                if( x_target1 && x_target1 <= SID_SE_NUM_MOD_DST )
+                    modDst[x_target1 - 1] += mod_dst1;
+	
+                u8 x_target2 = mp->x_target[1];
+                if( x_target2 && x_target2 <= SID_SE_NUM_MOD_DST )
+                    modDst[x_target2 - 1] += mod_dst2;
+
+                // add to additional SIDL/R targets
+                u8 direct_target_l = mp->direct_target[0];
+                if( direct_target_l ) {
+                    if( direct_target_l & (1 << 0) ) modDst[SID_SE_MOD_DST_PITCH1] += mod_dst1;
+                    if( direct_target_l & (1 << 1) ) modDst[SID_SE_MOD_DST_PITCH2] += mod_dst1;
+                    if( direct_target_l & (1 << 2) ) modDst[SID_SE_MOD_DST_PITCH3] += mod_dst1;
+                    if( direct_target_l & (1 << 3) ) modDst[SID_SE_MOD_DST_PW1] += mod_dst1;
+                    if( direct_target_l & (1 << 4) ) modDst[SID_SE_MOD_DST_PW2] += mod_dst1;
+                    if( direct_target_l & (1 << 5) ) modDst[SID_SE_MOD_DST_PW3] += mod_dst1;
+                    if( direct_target_l & (1 << 6) ) modDst[SID_SE_MOD_DST_FIL1] += mod_dst1;
+                    if( direct_target_l & (1 << 7) ) modDst[SID_SE_MOD_DST_VOL1] += mod_dst1;
+                }
+
+                u8 direct_target_r = mp->direct_target[1];
+                if( direct_target_r ) {
+                    if( direct_target_r & (1 << 0) ) modDst[SID_SE_MOD_DST_PITCH4] += mod_dst2;
+                    if( direct_target_r & (1 << 1) ) modDst[SID_SE_MOD_DST_PITCH5] += mod_dst2;
+                    if( direct_target_r & (1 << 2) ) modDst[SID_SE_MOD_DST_PITCH6] += mod_dst2;
+                    if( direct_target_r & (1 << 3) ) modDst[SID_SE_MOD_DST_PW4] += mod_dst2;
+                    if( direct_target_r & (1 << 4) ) modDst[SID_SE_MOD_DST_PW5] += mod_dst2;
+                    if( direct_target_r & (1 << 5) ) modDst[SID_SE_MOD_DST_PW6] += mod_dst2;
+                    if( direct_target_r & (1 << 6) ) modDst[SID_SE_MOD_DST_FIL2] += mod_dst2;
+                    if( direct_target_r & (1 << 7) ) modDst[SID_SE_MOD_DST_VOL2] += mod_dst2;
+                }
+            }
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random patch content
+/////////////////////////////////////////////////////////////////////////////
+static u8 RandomSource(void)
+{
+    switch( Random(4) ) {
+    case 0: return 0; // no source
+    case 1: return 0x80 | Random(128); // constant
+    case 2: return 1 + SID_SE_MOD_SRC_MOD1 + Random(8); // feedback
+    }
+    return 1 + Random(SID_SE_NUM_MOD_SRC);
+}
+
+static void RandomPath(sid_se_mod_patch_t *mp)
+{
+    mp->src1 = RandomSource();
+    mp->src2 = RandomSource();
+    mp->op = Random(256); // operator, unused bits and inversions
+    mp->depth = Random(4) ? Random(256) : 0;
+    mp->direct_target[0] = Random(2) ? Random(256) : 0;
+    mp->direct_target[1] = Random(2) ? Random(256) : 0;
+    mp->x_target[0] = Random(SID_SE_NUM_MOD_DST + 8); // also invalid targets
+    mp->x_target[1] = Random(SID_SE_NUM_MOD_DST + 8);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random modulation sources (MOD1..8 are the results of the pathes)
+/////////////////////////////////////////////////////////////////////////////
+static void RandomSources(s16 *modSrc, s16 *refModSrc, u32 tick)
+{
+    for(int src=0; src<SID_SE_NUM_MOD_SRC; ++src) {
+        if( src >= SID_SE_MOD_SRC_MOD1 && src < (SID_SE_MOD_SRC_MOD1+8) )
+            continue;
+
+        // slow changes with sign transitions (for S&H) and random values
+        s16 value;
+        if( src & 1 )
+            value = (s16)(Random(65536) - 32768);
+        else
+            value = (s16)((((tick + src * 7) % 64) - 32) * 1000);
+        modSrc[src] = refModSrc[src] = value;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    u32 ticksPerPatch = (argc >= 2) ? strtoul(argv[1], NULL, 0) : 100;
+    static sid_se_mod_patch_t modPatch[8];
+    static s16 refModSrc[SID_SE_NUM_MOD_SRC];
+    static s32 refModDst[SID_SE_NUM_MOD_DST];
+    u8 refModTransition = 0;
+    static MbSidMod mbSidMod; // static: modTransition is 0 like refModTransition
+    int errors = 0;
+
+    // verification
+    mbSidMod.init(modPatch);
+    u32 tick = 0;
+    int patch;
+    for(patch=0; patch<NUM_PATCHES && errors < 10; ++patch) {
+        if( patch == 0 || Random(4) == 0 ) {
+            // new patch
+            for(int path=0; path<8; ++path)
+                RandomPath(&modPatch[path]);
+            mbSidMod.patchChanged();
+        } else {
+            // change a single parameter (depth, inversion...)
+            // sources are taken from a valid path, since the reference doesn't check the range
+            sid_se_mod_patch_t randomPath;
+            RandomPath(&randomPath);
+            u8 ix = Random(sizeof(sid_se_mod_patch_t));
+            ((u8 *)&modPatch[Random(8)])[ix] = ((u8 *)&randomPath)[ix];
+            mbSidMod.patchChanged();
+        }
+
+        for(u32 i=0; i<ticksPerPatch && errors < 10; ++i, ++tick) {
+            RandomSources(mbSidMod.modSrc, refModSrc, tick);
+
+            mbSidMod.clearDestinations();
+            mbSidMod.tick();
+
+            memset(refModDst, 0, sizeof(refModDst));
+            ReferenceTick(modPatch, refModSrc, refModDst, refModTransition);
+
+            if( memcmp(mbSidMod.modSrc, refModSrc, sizeof(refModSrc)) != 0 ||
+                memcmp(mbSidMod.modDst, refModDst, sizeof(refModDst)) != 0 ) {
+                printf("ERROR: patch %d tick %u: results differ\n", patch, tick);
+                ++errors;
+            }
+        }
+    }
+    printf("Verification: %u ticks with %d patches\n", tick, patch);
+
+    // benchmark with a typical patch: 6 active pathes, LFO/ENV sources, pitch/PW/filter targets
+    memset(modPatch, 0, sizeof(modPatch));
+    for(int path=0; path<6; ++path) {
+        modPatch[path].src1 = 1 + SID_SE_MOD_SRC_LFO1 + path;
+        modPatch[path].src2 = (path & 1) ? (1 + SID_SE_MOD_SRC_ENV1) : 0;
+        modPatch[path].op = (path & 1) ? 5 : 1;
+        modPatch[path].depth = 0x80 + 0x10 * (path+1);
+        modPatch[path].direct_target[0] = 1 << path;
+        modPatch[path].direct_target[1] = 1 << path;
+        modPatch[path].x_target[0] = (path == 0) ? (1 + SID_SE_MOD_DST_FIL1) : 0;
+    }
+    mbSidMod.patchChanged();
+
+    unsigned long long t0 = TimeGet();
+    for(int i=0; i<BENCHMARK_TICKS; ++i) {
+        refModSrc[i % SID_SE_NUM_MOD_SRC] = (s16)i;
+        memset(refModDst, 0, sizeof(refModDst));
+        ReferenceTick(modPatch, refModSrc, refModDst, refModTransition);
+    }
+    unsigned long long t1 = TimeGet();
+    for(int i=0; i<BENCHMARK_TICKS; ++i) {
+        mbSidMod.modSrc[i % SID_SE_NUM_MOD_SRC] = (s16)i;
+        mbSidMod.clearDestinations();
+        mbSidMod.tick();
+    }
+    unsigned long long t2 = TimeGet();
+
+    if( memcmp(mbSidMod.modDst, refModDst, sizeof(refModDst)) != 0 ) {
+        printf("ERROR: benchmark results differ\n");
+        ++errors;
+    }
+
+    printf("Benchmark: reference %.1f nS per tick, compiled %.1f nS per tick\n",
+           (double)(t1 - t0) / BENCHMARK_TICKS, (double)(t2 - t1) / BENCHMARK_TICKS);
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    return errors ? 1 : 0;
+}
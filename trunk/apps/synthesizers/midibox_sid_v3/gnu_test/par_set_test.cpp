@@ -0,0 +1,462 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Host test and benchmark of the parameter handlers
+ *
+ * - Lead engine: each parameter of the parameter chart is written with
+ *   parSet() and read back with parGet(), unscaled and scaled from/to 16bit,
+ *   for the left, right and both SIDs.
+ * - Lead engine: the parameters which were handled wrong are checked
+ *   separately (ENV, LFO Phase, LFO 6/7, Filter and Waveform parGet).
+ * - Lead engine: random wavetable rows are applied with parSetWTRow(),
+ *   the result has to be identical to single parSetWT() calls.
+ * - Drum engine: noteOff()/noteAllOff() have to keep the drum voices intact.
+ * - the parSet() throughput of all engines is measured with random
+ *   parameters and values (like the modulation matrix, knobs and
+ *   wavetables would write them).
+ *
+ * Usage: par_set_test [<calls>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MbSidEnvironment.h"
+
+
+#define NUM_WT_ROWS        10000
+#define NUM_RANDOM_WRITES  4096
+#define BENCHMARK_CALLS    1000000
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated functions of the application/SID module
+/////////////////////////////////////////////////////////////////////////////
+extern "C" s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+    return 0; // acknowledge messages are not forwarded
+}
+
+sid_regs_t sid_regs[SID_NUM];
+
+extern "C" s32 SID_Update(u32 mode)
+{
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+static MbSidEnvironment mbSidEnvironment;
+static int errors;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random numbers (reproducible)
+/////////////////////////////////////////////////////////////////////////////
+static u32 seed = 1;
+
+static u32 Random(u32 range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Lead engine parameters which can be read back (see mbsidv3_parameter_chart.txt)
+// Knobs are not part of the list, since they forward their value to the
+// assigned parameters.
+/////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u8 first;
+    u8 last;
+    u8 bits;
+} par_range_t;
+
+static const par_range_t leadPars[] = {
+    { 0x01, 0x01,  7 }, // Volume
+    { 0x04, 0x04, 12 }, // Filter CutOff
+    { 0x05, 0x05,  8 }, // Filter Resonance
+    { 0x06, 0x07,  4 }, // Filter Channels/Mode
+    { 0x20, 0x23,  7 }, // Waveform
+    { 0x24, 0x27,  7 }, // Transpose
+    { 0x28, 0x2f,  8 }, // Finetune, Portamento
+    { 0x30, 0x33, 12 }, // Pulsewidth
+    { 0x34, 0x37,  8 }, // Delay
+    { 0x38, 0x47,  4 }, // Attack, Decay, Sustain, Release
+    { 0x48, 0x4b,  6 }, // Arp Speed
+    { 0x4c, 0x4f,  5 }, // Arp Gatelength
+    { 0x50, 0x53,  8 }, // Pitchbender
+    { 0x60, 0x67,  8 }, // MOD Depth
+    { 0x68, 0x6f,  2 }, // MOD Invert Target L/R
+    { 0x80, 0x85,  4 }, // LFO Waveform
+    { 0x88, 0x8d,  8 }, // LFO Depth
+    { 0x90, 0x95,  8 }, // LFO Rate
+    { 0x98, 0x9d,  8 }, // LFO Delay
+    { 0xa0, 0xa5,  8 }, // LFO Phase
+    { 0xc0, 0xdf,  8 }, // ENV1/2
+    { 0xe0, 0xe3,  6 }, // WT Speed
+    { 0xe4, 0xf3,  7 }, // WT Begin, End, Loop, Position
+    { 0, 0, 0 }
+};
+
+static int LeadParBits(u8 par)
+{
+    for(const par_range_t *r=leadPars; r->bits; ++r)
+        if( par >= r->first && par <= r->last )
+            return r->bits;
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns all readable Lead parameters of both SIDs
+/////////////////////////////////////////////////////////////////////////////
+static void LeadSnapshot(MbSidSeLead *se, u16 *values)
+{
+    for(int par=0; par<256; ++par) {
+        *values++ = LeadParBits(par) ? se->parGet(par, 1, 0, false) : 0;
+        *values++ = LeadParBits(par) ? se->parGet(par, 2, 0, false) : 0;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Write/Read test of the Lead parameters
+/////////////////////////////////////////////////////////////////////////////
+static void LeadReadBackTest(MbSidSeLead *se)
+{
+    int numChecked = 0;
+    int numFailed = 0;
+
+    for(int par=0; par<256; ++par) {
+        int bits = LeadParBits(par);
+        if( !bits )
+            continue;
+
+        for(int i=0; i<16; ++i) {
+            u8 sidlr = 1 + (i % 3);
+            bool scale16bit = (i & 1) ? true : false;
+            u16 value = Random(1 << bits);
+            u16 value16 = value << (16 - bits);
+
+            se->parSet(par, scale16bit ? value16 : value, sidlr, 0, scale16bit);
+
+            for(u8 getSidlr=1; getSidlr<=2; ++getSidlr) {
+                if( !(sidlr & getSidlr) )
+                    continue;
+
+                u16 expected = scale16bit ? value16 : value;
+                u16 result = se->parGet(par, getSidlr, 0, scale16bit);
+                ++numChecked;
+                if( result != expected ) {
+                    if( ++numFailed <= 10 )
+                        printf("ERROR: par 0x%02x sidlr %d %s: wrote 0x%04x, read 0x%04x\n",
+                               par, getSidlr, scale16bit ? "16bit" : "unscaled", expected, result);
+                }
+            }
+        }
+    }
+
+    printf("Lead parSet/parGet: %d values checked, %d failed\n", numChecked, numFailed);
+    errors += numFailed;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Checks that a parameter write ends up in the right object
+/////////////////////////////////////////////////////////////////////////////
+static int numHandlerChecks;
+static int numHandlerFailed;
+
+static void HandlerCheck(bool ok, const char *name, int par)
+{
+    ++numHandlerChecks;
+    if( !ok ) {
+        ++numHandlerFailed;
+        printf("ERROR: %s (par 0x%02x)\n", name, par);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Regression tests of the Lead parameter handlers which were broken:
+// ENV writes, LFO Phase, LFO 6/7 of each group, parGet of the filter
+// and of the waveform
+/////////////////////////////////////////////////////////////////////////////
+static void LeadHandlerTest(MbSidSeLead *se)
+{
+    numHandlerChecks = 0;
+    numHandlerFailed = 0;
+
+    // ENV1/2: each parameter has to be written into the selected ENV only
+    for(int env=0; env<2; ++env) {
+        se->parSet(0xc0 + 16*env + 0x1, 0x80 + 0x20 + env, 3, 0, false); // Depth
+        se->parSet(0xc0 + 16*env + 0x3, 0x40 + env, 3, 0, false);        // Attack
+        se->parSet(0xc0 + 16*env + 0xf, 0x10 + env, 3, 0, false);        // Release Curve
+    }
+    for(int env=0; env<2; ++env) {
+        MbSidEnvLead *e = &se->mbSidEnvLead[env];
+        HandlerCheck(e->envDepth == 0x20 + env, "ENV Depth not written", 0xc1 + 16*env);
+        HandlerCheck(e->envAttack == 0x40 + env, "ENV Attack not written", 0xc3 + 16*env);
+        HandlerCheck(e->envReleaseCurve == 0x10 + env, "ENV Release Curve not written", 0xcf + 16*env);
+    }
+
+    // LFO Phase mustn't change the LFO Delay
+    for(int lfo=0; lfo<6; ++lfo) {
+        MbSidLfo *l = &se->mbSidLfo[lfo];
+        se->parSet(0x98 + lfo, 0x11 + lfo, 3, 0, false); // Delay
+        se->parSet(0xa0 + lfo, 0x77 + lfo, 3, 0, false); // Phase
+        HandlerCheck(l->lfoPhase == 0x77 + lfo, "LFO Phase not written", 0xa0 + lfo);
+        HandlerCheck(l->lfoDelay == 0x11 + lfo, "LFO Phase changed the LFO Delay", 0xa0 + lfo);
+    }
+
+    // there are only 6 LFOs: parameter 6/7 of each group mustn't change LFO1
+    for(int par=0x80; par<=0xbf; ++par) {
+        if( (par & 7) < 6 )
+            continue;
+        MbSidLfo *l = &se->mbSidLfo[0];
+        u8 waveform = l->lfoMode.WAVEFORM;
+        s8 depth = l->lfoDepth;
+        u8 rate = l->lfoRate;
+        u8 delay = l->lfoDelay;
+        u8 phase = l->lfoPhase;
+        se->parSet(par, 0xffff, 3, 0, true);
+        HandlerCheck(l->lfoMode.WAVEFORM == waveform && l->lfoDepth == depth &&
+                     l->lfoRate == rate && l->lfoDelay == delay && l->lfoPhase == phase,
+                     "LFO parameter 6/7 changed LFO1", par);
+        HandlerCheck(se->parGet(par, 1, 0, false) == 0, "LFO parameter 6/7 returned a value", par);
+    }
+
+    // parGet of the filter has to return the selected SID
+    for(int par=0x04; par<=0x07; ++par) {
+        se->parSet(par, 0x1, 1, 0, false);
+        se->parSet(par, 0x2, 2, 0, false);
+        HandlerCheck(se->parGet(par, 1, 0, false) == 0x1, "Filter parGet of the left SID", par);
+        HandlerCheck(se->parGet(par, 2, 0, false) == 0x2, "Filter parGet of the right SID", par);
+    }
+    HandlerCheck(se->mbSidFilter[0].filterCutoff == 0x1, "Filter CutOff of the left SID", 0x04);
+    HandlerCheck(se->mbSidFilter[1].filterCutoff == 0x2, "Filter CutOff of the right SID", 0x04);
+
+    // parGet of the waveform has to return the value
+    for(int par=0x21; par<=0x23; ++par) {
+        u8 value = 0x40 | (par - 0x20); // ringmod flag + waveform
+        se->parSet(par, value, 3, 0, false);
+        HandlerCheck(se->parGet(par, 1, 0, false) == value, "Waveform parGet of the left SID", par);
+        HandlerCheck(se->parGet(par, 2, 0, false) == value, "Waveform parGet of the right SID", par);
+    }
+
+    printf("Lead parameter handlers: %d checks, %d failed\n", numHandlerChecks, numHandlerFailed);
+    errors += numHandlerFailed;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Compares parSetWTRow() with parSetWT()
+/////////////////////////////////////////////////////////////////////////////
+static void LeadWTRowTest(MbSidSeLead *se)
+{
+    static u16 valuesRow[2*256];
+    static u16 valuesSingle[2*256];
+    sid_se_wt_write_t row[4];
+    int numFailed = 0;
+
+    for(int i=0; i<NUM_WT_ROWS; ++i) {
+        u8 num = 1 + Random(4);
+        for(int wt=0; wt<num; ++wt) {
+            u8 par;
+            do {
+                par = Random(256);
+            } while( !LeadParBits(par) );
+            row[wt].par = par;
+            row[wt].wtValue = Random(256);
+            row[wt].sidlr = 1 + Random(3);
+            row[wt].ins = wt;
+        }
+
+        // the second call starts from the same parameter values
+        LeadSnapshot(se, valuesSingle);
+        se->parSetWTRow(row, num);
+        LeadSnapshot(se, valuesRow);
+
+        for(int par=0; par<256; ++par)
+            if( LeadParBits(par) ) {
+                se->parSet(par, valuesSingle[2*par+0], 1, 0, false);
+                se->parSet(par, valuesSingle[2*par+1], 2, 0, false);
+            }
+
+        for(int wt=0; wt<num; ++wt)
+            se->parSetWT(row[wt].par, row[wt].wtValue, row[wt].sidlr, row[wt].ins);
+        LeadSnapshot(se, valuesSingle);
+
+        if( memcmp(valuesRow, valuesSingle, sizeof(valuesRow)) != 0 ) {
+            if( ++numFailed <= 10 )
+                printf("ERROR: WT row %d (%d writes, first par 0x%02x) differs from single writes\n",
+                       i, num, row[0].par);
+        }
+    }
+
+    printf("Lead parSetWTRow: %d rows checked, %d failed\n", NUM_WT_ROWS, numFailed);
+    errors += numFailed;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Plays and releases all drums, the drum assignments of the voices must
+// not be changed by noteOff()/noteAllOff()
+/////////////////////////////////////////////////////////////////////////////
+static void DrumNoteOffTest(MbSidSeDrum *se)
+{
+    MbSidDrum *drumPtr[6];
+    int numFailed = 0;
+
+    for(int i=0; i<NUM_WT_ROWS; ++i) {
+        u8 note = 48 + Random(se->mbSidDrum.size); // transposed to drum 0..15
+        se->noteOn(0, note, 100, false);
+
+        for(int voice=0; voice<se->mbSidVoiceDrum.size; ++voice)
+            drumPtr[voice] = se->mbSidVoiceDrum[voice].mbSidDrumPtr;
+
+        if( i & 1 )
+            se->noteOff(0, note, false);
+        else
+            se->noteAllOff(0, false);
+
+        for(int voice=0; voice<se->mbSidVoiceDrum.size; ++voice) {
+            if( se->mbSidVoiceDrum[voice].mbSidDrumPtr != drumPtr[voice] ) {
+                if( ++numFailed <= 10 )
+                    printf("ERROR: %s of note 0x%02x changed the drum of voice %d\n",
+                           (i & 1) ? "noteOff" : "noteAllOff", note, voice);
+            }
+        }
+    }
+
+    printf("Drum noteOff/noteAllOff: %d notes checked, %d failed\n", NUM_WT_ROWS, numFailed);
+    errors += numFailed;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Measures parSet() of the engine of the given patch
+/////////////////////////////////////////////////////////////////////////////
+static void Benchmark(u8 patch, u8 numIns, int calls)
+{
+    static u8 par[NUM_RANDOM_WRITES];
+    static u16 value[NUM_RANDOM_WRITES];
+    static u8 wtValue[NUM_RANDOM_WRITES];
+
+    if( mbSidEnvironment.bankLoad(0, 0, patch) < 0 ) {
+        printf("ERROR: patch A%03d not available\n", patch+1);
+        ++errors;
+        return;
+    }
+
+    MbSid *mbSid = &mbSidEnvironment.mbSid[0];
+    MbSidSe *se = mbSid->currentMbSidSePtr;
+    char patchName[17];
+    mbSid->mbSidPatch.nameGet(patchName);
+
+    for(int i=0; i<NUM_RANDOM_WRITES; ++i) {
+        par[i] = Random(256);
+        value[i] = Random(0x10000);
+        wtValue[i] = Random(256);
+    }
+
+    unsigned long long t0 = TimeGet();
+    for(int i=0; i<calls; ++i) {
+        int ix = i % NUM_RANDOM_WRITES;
+        se->parSet(par[ix], value[ix], 3, i % numIns, true);
+    }
+    unsigned long long t1 = TimeGet();
+
+    printf("A%03d %s: parSet %.1f nS", patch+1, patchName, (double)(t1 - t0) / calls);
+
+    if( se == &mbSid->mbSidSeLead ) {
+        MbSidSeLead *lead = &mbSid->mbSidSeLead;
+
+        t0 = TimeGet();
+        for(int i=0; i<calls; ++i) {
+            int ix = i % NUM_RANDOM_WRITES;
+            lead->parSetWT(par[ix], wtValue[ix], 3, i & 3);
+        }
+        t1 = TimeGet();
+        printf(", parSetWT %.1f nS", (double)(t1 - t0) / calls);
+
+        sid_se_wt_write_t row[4];
+        t0 = TimeGet();
+        for(int i=0; i<calls; i+=4) {
+            for(int wt=0; wt<4; ++wt) {
+                int ix = (i + wt) % NUM_RANDOM_WRITES;
+                row[wt].par = par[ix];
+                row[wt].wtValue = wtValue[ix];
+                row[wt].sidlr = 3;
+                row[wt].ins = wt;
+            }
+            lead->parSetWTRow(row, 4);
+        }
+        t1 = TimeGet();
+        printf(", parSetWTRow %.1f nS", (double)(t1 - t0) / calls);
+    }
+
+    printf(" per parameter\n");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    int calls = (argc >= 2) ? atoi(argv[1]) : BENCHMARK_CALLS;
+
+    // A001: Lead Patch
+    if( mbSidEnvironment.bankLoad(0, 0, 0) < 0 ) {
+        printf("ERROR: patch A001 not available\n");
+        return 1;
+    }
+    MbSidSeLead *lead = &mbSidEnvironment.mbSid[0].mbSidSeLead;
+
+    LeadReadBackTest(lead);
+    LeadHandlerTest(lead);
+    LeadWTRowTest(lead);
+
+    // A033: Drum Kit 1
+    if( mbSidEnvironment.bankLoad(0, 0, 32) < 0 ) {
+        printf("ERROR: patch A033 not available\n");
+        return 1;
+    }
+    DrumNoteOffTest(&mbSidEnvironment.mbSid[0].mbSidSeDrum);
+
+    Benchmark(0, 1, calls);    // A001: Lead Patch
+    Benchmark(98, 2, calls);   // A099: Bassline Demo1
+    Benchmark(32, 16, calls);  // A033: Drum Kit 1
+    Benchmark(15, 6, calls);   // A016: Filtered Poly (Multi Engine)
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    return errors ? 1 : 0;
+}
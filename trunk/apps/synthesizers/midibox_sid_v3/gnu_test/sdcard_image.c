@@ -0,0 +1,181 @@
+// $Id$
+/*
+ * File backed emulation of the MIOS32_SDCARD driver
+ *
+ * The SD Card is emulated by an image file on the host, so that the
+ * FatFs based file functions can be tested without hardware.
+ * All sector accesses are counted.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sdcard_image.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global variables
+/////////////////////////////////////////////////////////////////////////////
+
+u32 sdcard_image_sector_reads;
+u32 sdcard_image_sector_writes;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static FILE *image;
+static u32 image_sectors;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates an empty image with the given number of sectors
+// (should be a multiple of 1024 sectors, since the size is reported in 512k units)
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_IMAGE_Create(char *filename, u32 sectors)
+{
+  u8 zero[512];
+
+  SDCARD_IMAGE_Close();
+
+  if( (image=fopen(filename, "w+b")) == NULL )
+    return -1; // file can't be created
+
+  memset(zero, 0, sizeof(zero));
+  u32 sector;
+  for(sector=0; sector<sectors; ++sector)
+    if( fwrite(zero, 512, 1, image) != 1 )
+      return -2; // write error
+
+  image_sectors = sectors;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Opens an existing image
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_IMAGE_Open(char *filename)
+{
+  SDCARD_IMAGE_Close();
+
+  if( (image=fopen(filename, "r+b")) == NULL )
+    return -1; // file not found
+
+  fseek(image, 0, SEEK_END);
+  image_sectors = ftell(image) / 512;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Closes the image (SD Card removed)
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_IMAGE_Close(void)
+{
+  if( image != NULL )
+    fclose(image);
+  image = NULL;
+  image_sectors = 0;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIOS32_SDCARD functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_SDCARD_Init(u32 mode)
+{
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_CheckAvailable(u8 was_available)
+{
+  return image != NULL;
+}
+
+s32 MIOS32_SDCARD_SectorRead(u32 sector, u8 *buffer)
+{
+  if( image == NULL || sector >= image_sectors )
+    return -1; // no card or invalid sector
+
+  ++sdcard_image_sector_reads;
+
+  if( fseek(image, (long)sector * 512, SEEK_SET) != 0 ||
+      fread(buffer, 512, 1, image) != 1 )
+    return -2; // read error
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_SectorWrite(u32 sector, u8 *buffer)
+{
+  if( image == NULL || sector >= image_sectors )
+    return -1; // no card or invalid sector
+
+  ++sdcard_image_sector_writes;
+
+  if( fseek(image, (long)sector * 512, SEEK_SET) != 0 ||
+      fwrite(buffer, 512, 1, image) != 1 )
+    return -2; // write error
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_SectorsRead(u32 sector, u8 *buffer, u32 count)
+{
+  s32 status;
+
+  // each sector is counted
+  for(; count; --count, ++sector, buffer += 512)
+    if( (status=MIOS32_SDCARD_SectorRead(sector, buffer)) < 0 )
+      return status;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_SectorsWrite(u32 sector, u8 *buffer, u32 count)
+{
+  s32 status;
+
+  // each sector is counted
+  for(; count; --count, ++sector, buffer += 512)
+    if( (status=MIOS32_SDCARD_SectorWrite(sector, buffer)) < 0 )
+      return status;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SDCARD_CSDRead(mios32_sdcard_csd_t *csd)
+{
+  if( image == NULL )
+    return -1; // no card
+
+  // reported like a SD V2 card
+  memset(csd, 0, sizeof(mios32_sdcard_csd_t));
+  csd->CSDStruct = 1;
+  csd->DeviceSize = (image_sectors >> 10) - 1;
+  csd->DeviceSizeMul = 0;
+
+  return 0; // no error
+}
@@ -0,0 +1,42 @@
+// $Id$
+/*
+ * Header for the file backed emulation of the MIOS32_SDCARD driver
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _SDCARD_IMAGE_H
+#define _SDCARD_IMAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 SDCARD_IMAGE_Create(char *filename, u32 sectors);
+extern s32 SDCARD_IMAGE_Open(char *filename);
+extern s32 SDCARD_IMAGE_Close(void);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+extern u32 sdcard_image_sector_reads;
+extern u32 sdcard_image_sector_writes;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SDCARD_IMAGE_H */
@@ -0,0 +1,410 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Host stress test of the MbSidVoiceQueue voice allocation
+ *
+ * Dense polyphonic note streams are replayed like MbSidSeMulti and
+ * MbSidSeDrum do: poly instruments get() a voice on each note, mono
+ * instruments getLast() their previous voice, Note Offs release() them.
+ * The voice assignments, dedicated voices and Mono/Stereo switches
+ * are changed randomly, incl. initExclusive() calls.
+ * Each returned voice is compared against the previous implementation
+ * (ReferenceQueue, which scans and shuffles the queue).
+ *
+ * Thereafter the allocations per second of both implementations are
+ * measured.
+ *
+ * The test is built for 6 voices (one SID pair) and for 24 voices
+ * (multi-SID emulation) with MBSID_VOICE_QUEUE_NUM_VOICES
+ *
+ * Usage: voice_queue_test [<events>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MbSidVoiceQueue.h"
+
+
+#define NUM_VOICES         MBSID_VOICE_QUEUE_NUM_VOICES
+#define NUM_EVENTS         2000000
+#define BENCHMARK_EVENTS   2000000
+#define MAX_NOTES          16 // per instrument
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated functions
+/////////////////////////////////////////////////////////////////////////////
+extern "C" s32 MIOS32_MIDI_SendDebugMessage(char *format, ...)
+{
+    return 0; // not printed
+}
+
+
+// the voice patches are stored as byte arrays in sid_patch_t
+static sid_se_voice_patch_t *VoicePatch(void *voice)
+{
+    return (sid_se_voice_patch_t *)voice;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Previous implementation of the voice queue
+// (the voice patches are addressed like in the new implementation, the
+// previous code used the size of sid_se_voice_patch_t as record size and
+// read behind the patch)
+/////////////////////////////////////////////////////////////////////////////
+typedef union {
+  struct {
+    u16 ALL;
+  };
+  struct {
+    u8 voice:6;
+    u8 ASSIGNED:1;
+    u8 EXCLUSIVE:1;
+    u8 instrument;
+  };
+} ref_voice_queue_item_t;
+
+class ReferenceQueue
+{
+public:
+    void init(sid_patch_t *patch)
+    {
+        ref_voice_queue_item_t *item = &queue[0];
+        for(int voice=0; voice<NUM_VOICES; ++voice, ++item) {
+            item->voice = voice;
+            item->ASSIGNED = 0;
+            item->EXCLUSIVE = 0;
+            item->instrument = 0xff;
+        }
+        initExclusive(patch);
+    }
+
+    void initExclusive(sid_patch_t *patch)
+    {
+        ref_voice_queue_item_t *item = &queue[0];
+        for(int voice=0; voice<NUM_VOICES; ++voice, ++item)
+            item->EXCLUSIVE = 0;
+
+        if( patch->engine == SID_SE_DRUM ) {
+            for(int drum=0; drum<16; ++drum) {
+                sid_se_v_flags_t v_flags;
+                v_flags.ALL = VoicePatch(&patch->D.voice[drum])->D.v_flags;
+                int direct_voice_asg = v_flags.D.VOICE_ASG - 3;
+                if( direct_voice_asg >= 0 && direct_voice_asg < NUM_VOICES ) {
+                    item = &queue[0];
+                    for(int voice=0; voice<NUM_VOICES; ++voice, ++item)
+                        if( item->instrument == drum )
+                            item->EXCLUSIVE = 1;
+                }
+            }
+        } else if( patch->engine == SID_SE_MULTI ) {
+            for(int ins=0; ins<6; ++ins) {
+                int direct_voice_asg = VoicePatch(&patch->M.voice[ins])->M.voice_asg - 3;
+                if( direct_voice_asg >= 0 && direct_voice_asg < NUM_VOICES ) {
+                    item = &queue[0];
+                    for(int voice=0; voice<NUM_VOICES; ++voice, ++item)
+                        if( item->instrument == ins )
+                            item->EXCLUSIVE = 1;
+                }
+            }
+        }
+    }
+
+    u8 get(u8 instrument, u8 voice_asg, u8 num_voices)
+    {
+        if( num_voices > NUM_VOICES )
+            num_voices = NUM_VOICES;
+
+        u32 allowed_voice_mask;
+        switch( voice_asg ) {
+        case 0: allowed_voice_mask = (1 << NUM_VOICES)-1; break;
+        case 1: allowed_voice_mask = (1 << (NUM_VOICES/2))-1; break;
+        case 2:
+            if( num_voices <= (NUM_VOICES/2) )
+                allowed_voice_mask = (1 << (NUM_VOICES/2))-1;
+            else
+                allowed_voice_mask = ((1 << (NUM_VOICES/2))-1) << (NUM_VOICES/2);
+            break;
+        default:
+            allowed_voice_mask = (1 << ((voice_asg-3) % num_voices));
+        }
+
+        ref_voice_queue_item_t *item = &queue[0];
+        for(int voice=0; voice<NUM_VOICES; ++voice, ++item) {
+            if( allowed_voice_mask & (1 << item->voice) &&
+                (!item->EXCLUSIVE || (item->instrument == instrument) || (voice_asg >= 3)) ) {
+                item->ASSIGNED = 1;
+                item->EXCLUSIVE = (voice_asg >= 3) ? 1 : 0;
+                item->instrument = instrument;
+
+                if( voice < (NUM_VOICES-1) ) {
+                    ref_voice_queue_item_t stored_item = *item;
+                    for(int i=voice; i<(NUM_VOICES-1); ++i)
+                        queue[i] = queue[i+1];
+                    queue[NUM_VOICES-1] = stored_item;
+                }
+                return queue[NUM_VOICES-1].voice;
+            }
+        }
+
+        return 0;
+    }
+
+    u8 getLast(u8 instrument, u8 voice_asg, u8 num_voices, u8 search_voice)
+    {
+        ref_voice_queue_item_t *item = &queue[0];
+        for(int voice=0; voice<NUM_VOICES; ++voice, ++item)
+            if( item->voice == search_voice ) {
+                if( item->instrument != instrument )
+                    break;
+                if( item->voice >= num_voices )
+                    break;
+
+                item->ASSIGNED = 1;
+                if( voice < (NUM_VOICES-1) ) {
+                    ref_voice_queue_item_t stored_item = *item;
+                    for(int i=voice; i<(NUM_VOICES-1); ++i)
+                        queue[i] = queue[i+1];
+                    queue[NUM_VOICES-1] = stored_item;
+                }
+                return queue[NUM_VOICES-1].voice;
+            }
+
+        return get(instrument, voice_asg, num_voices);
+    }
+
+    u8 release(u8 release_voice)
+    {
+        ref_voice_queue_item_t *item = &queue[0];
+        for(int voice=0; voice<NUM_VOICES; ++voice, ++item)
+            if( item->voice == release_voice ) {
+                item->ASSIGNED = 0;
+                return item->voice;
+            }
+
+        return 0;
+    }
+
+private:
+    ref_voice_queue_item_t queue[NUM_VOICES];
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Random numbers (reproducible)
+/////////////////////////////////////////////////////////////////////////////
+static u32 seed = 1;
+
+static u32 Random(u32 range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Note stream
+// Each instrument has a voice assignment, a poly/mono flag and a list of
+// active notes with their voices (like MbSidSeMulti::voiceGet())
+/////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    u8 voiceAsg;
+    bool poly;
+    u8 lastVoice;
+    u8 numNotes;
+    u8 noteVoice[MAX_NOTES];
+} instrument_t;
+
+typedef struct {
+    sid_patch_t patch;
+    u8 numInstruments;
+    u8 numVoices; // Mono/Stereo
+    instrument_t instrument[16];
+} stream_state_t;
+
+// voice assignments are mostly "all voices", sometimes left/right or dedicated
+static u8 RandomVoiceAsg(void)
+{
+    u32 r = Random(16);
+    if( r < 10 )
+        return 0;
+    if( r < 13 )
+        return 1 + Random(2);
+    return 3 + Random(NUM_VOICES);
+}
+
+static void PatchInit(stream_state_t *s, bool drum)
+{
+    memset(&s->patch, 0, sizeof(sid_patch_t));
+    s->patch.engine = drum ? SID_SE_DRUM : SID_SE_MULTI;
+    s->numInstruments = drum ? 16 : 6;
+    s->numVoices = NUM_VOICES;
+
+    for(int ins=0; ins<s->numInstruments; ++ins) {
+        instrument_t *i = &s->instrument[ins];
+        i->voiceAsg = RandomVoiceAsg();
+        i->poly = drum || Random(4) != 0;
+        i->lastVoice = 0;
+        i->numNotes = 0;
+
+        if( drum ) {
+            sid_se_v_flags_t v_flags;
+            v_flags.ALL = 0;
+            v_flags.D.VOICE_ASG = (i->voiceAsg < 16) ? i->voiceAsg : 0;
+            i->voiceAsg = v_flags.D.VOICE_ASG;
+            VoicePatch(&s->patch.D.voice[ins])->D.v_flags = v_flags.ALL;
+        } else {
+            VoicePatch(&s->patch.M.voice[ins])->M.voice_asg = i->voiceAsg;
+        }
+    }
+}
+
+// creates the next event and forwards it to the queue
+// returns the allocated/released voice
+template <class Q> static u8 Event(Q *q, stream_state_t *s, u32 r)
+{
+    instrument_t *i = &s->instrument[r % s->numInstruments];
+    u8 ins = i - &s->instrument[0];
+    r /= s->numInstruments;
+
+    // dense stream: more Note Ons than Note Offs until the note limit is reached
+    if( i->numNotes < MAX_NOTES && (r % 8) < 5 ) {
+        u8 voice;
+        if( i->poly )
+            voice = q->get(ins, i->voiceAsg, s->numVoices);
+        else
+            voice = q->getLast(ins, i->voiceAsg, s->numVoices, i->lastVoice);
+        i->lastVoice = voice;
+        i->noteVoice[i->numNotes++] = voice;
+        return voice;
+    }
+
+    if( i->numNotes ) {
+        u8 note = (r / 8) % i->numNotes;
+        u8 voice = i->noteVoice[note];
+        i->noteVoice[note] = i->noteVoice[--i->numNotes];
+        return q->release(voice);
+    }
+
+    return 0xff; // no event
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    int numEvents = (argc >= 2) ? atoi(argv[1]) : NUM_EVENTS;
+    int errors = 0;
+    int allocations = 0;
+
+    static MbSidVoiceQueue voiceQueue;
+    static ReferenceQueue referenceQueue;
+    static stream_state_t stateQueue, stateReference;
+
+    for(int event=0; event<numEvents; ++event) {
+        // patch change
+        if( (event % 10000) == 0 ) {
+            PatchInit(&stateQueue, Random(2) == 0);
+            voiceQueue.init(&stateQueue.patch);
+            referenceQueue.init(&stateQueue.patch);
+            stateReference = stateQueue;
+        }
+
+        // voice assignment change of a single instrument (like parSet())
+        if( Random(500) == 0 ) {
+            u8 ins = Random(stateQueue.numInstruments);
+            u8 voiceAsg = RandomVoiceAsg();
+            if( stateQueue.patch.engine == SID_SE_DRUM ) {
+                sid_se_v_flags_t v_flags;
+                v_flags.ALL = 0;
+                v_flags.D.VOICE_ASG = (voiceAsg < 16) ? voiceAsg : 0;
+                voiceAsg = v_flags.D.VOICE_ASG;
+                VoicePatch(&stateQueue.patch.D.voice[ins])->D.v_flags = v_flags.ALL;
+            } else {
+                VoicePatch(&stateQueue.patch.M.voice[ins])->M.voice_asg = voiceAsg;
+            }
+            stateQueue.instrument[ins].voiceAsg = voiceAsg;
+            stateReference.patch = stateQueue.patch;
+            stateReference.instrument[ins].voiceAsg = voiceAsg;
+            voiceQueue.initExclusive(&stateQueue.patch);
+            referenceQueue.initExclusive(&stateReference.patch);
+        }
+
+        // Mono/Stereo switch
+        if( Random(2000) == 0 ) {
+            stateQueue.numVoices = (stateQueue.numVoices == NUM_VOICES) ? NUM_VOICES/2 : NUM_VOICES;
+            stateReference.numVoices = stateQueue.numVoices;
+        }
+
+        u32 r = Random(1 << 20);
+        u8 voice = Event(&voiceQueue, &stateQueue, r);
+        u8 expected = Event(&referenceQueue, &stateReference, r);
+        if( voice != expected ) {
+            if( ++errors <= 10 )
+                printf("ERROR: event %d: voice %d allocated, expected %d\n", event, voice, expected);
+        }
+        if( voice != 0xff )
+            ++allocations;
+    }
+    printf("%d events (%d voices): %d allocated/released voices compared, %d differences\n",
+           numEvents, NUM_VOICES, allocations, errors);
+
+    // benchmark with dense poly streams (all voices)
+    stream_state_t state;
+    seed = 1;
+    PatchInit(&state, false);
+    for(int ins=0; ins<6; ++ins) {
+        state.instrument[ins].voiceAsg = 0;
+        state.instrument[ins].poly = true;
+        VoicePatch(&state.patch.M.voice[ins])->M.voice_asg = 0;
+    }
+    voiceQueue.init(&state.patch);
+    referenceQueue.init(&state.patch);
+
+    static u32 randomValues[BENCHMARK_EVENTS];
+    for(int i=0; i<BENCHMARK_EVENTS; ++i)
+        randomValues[i] = Random(1 << 20);
+
+    stream_state_t stateBenchmark = state;
+    unsigned long long t0 = TimeGet();
+    for(int i=0; i<BENCHMARK_EVENTS; ++i)
+        Event(&referenceQueue, &stateBenchmark, randomValues[i]);
+    unsigned long long t1 = TimeGet();
+    stateBenchmark = state;
+    for(int i=0; i<BENCHMARK_EVENTS; ++i)
+        Event(&voiceQueue, &stateBenchmark, randomValues[i]);
+    unsigned long long t2 = TimeGet();
+
+    printf("Allocations+releases per second: previous implementation %.1f M, voice queue %.1f M\n",
+           (double)BENCHMARK_EVENTS / (t1 - t0) * 1000, (double)BENCHMARK_EVENTS / (t2 - t1) * 1000);
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    return errors ? 1 : 0;
+}
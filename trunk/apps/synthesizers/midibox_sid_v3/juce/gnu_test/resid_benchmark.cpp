@@ -0,0 +1,328 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Host benchmark of the reSID rendering used by the JUCE plugin
+ *
+ * Renders 60 seconds of audio for 1/2/4/8 SIDs in buffers of 512 samples
+ * like a plugin host. The sound engine is emulated by register writes at
+ * 1 kHz (pulse width sweeps and note changes).
+ *
+ * Following methods are compared:
+ *   - sample: each SID is clocked sample by sample (previous implementation)
+ *   - block:  ReSidRenderer, one SID::clock() call per sub-block
+ *   - log:    the engine is updated each 1000 SID cycles, the register
+ *             writes are logged and executed at their cycle while rendering
+ * sample and block use the same update points, the output has to be identical.
+ * The log method is verified against cycle-by-cycle clocking with updates
+ * at the same cycles.
+ *
+ * Usage: resid_benchmark [<seconds>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ReSidRenderer.h"
+
+// these global variables are used by ReSID
+double mixer_value1 = 1.0;
+double mixer_value2 = 1.0;
+double mixer_value3 = 1.0;
+
+
+#define SAMPLE_RATE     44100
+#define UPDATE_FRQ      1000
+#define HOST_BLOCK_SIZE 512
+#define MAX_SIDS        8
+#define SID_FREQUENCY   1000000
+#define VERIFY_SECONDS  5
+
+typedef enum {
+    METHOD_SAMPLE,
+    METHOD_BLOCK,
+    METHOD_LOG,
+    METHOD_CYCLE, // reference for METHOD_LOG
+} method_t;
+
+static const char *methodName[] = { "sample", "block", "log", "cycle" };
+
+static unsigned char sidRegs[MAX_SIDS][32];
+static unsigned char sidRegsShadow[MAX_SIDS][32];
+static ReSidRegLog sidRegLog[MAX_SIDS];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated sound engine
+/////////////////////////////////////////////////////////////////////////////
+static void SoundEngineInit(SID *sid, int sidNum)
+{
+    sid->set_chip_model(MOS8580);
+    sid->reset();
+    sid->set_sampling_parameters(SID_FREQUENCY, SAMPLE_INTERPOLATE, SAMPLE_RATE);
+
+    unsigned char *regs = sidRegs[sidNum];
+    memset(regs, 0, sizeof(sidRegs[sidNum]));
+    memset(sidRegsShadow[sidNum], 0, sizeof(sidRegsShadow[sidNum]));
+    sidRegLog[sidNum].clear();
+
+    regs[0x18] = 0x1f; // Volume + LP filter
+    regs[0x17] = 0xf7; // Resonance, filter voices 1..3
+    regs[0x16] = 0x40; // Cutoff
+    for(int voice=0; voice<3; ++voice) {
+        int offset = 7*voice;
+        regs[offset + 0x05] = 0x09; // Attack/Decay
+        regs[offset + 0x06] = 0xa8; // Sustain/Release
+    }
+}
+
+static void SoundEngineTick(int sidNum, unsigned tick)
+{
+    unsigned char *regs = sidRegs[sidNum];
+
+    for(int voice=0; voice<3; ++voice) {
+        int offset = 7*voice;
+
+        // pulse width sweep
+        unsigned pw = (tick * (5 + voice + sidNum)) & 0xfff;
+        regs[offset + 0x02] = pw & 0xff;
+        regs[offset + 0x03] = pw >> 8;
+
+        // new note each 250 mS, gate released after 200 mS
+        unsigned phase = (tick + 37*voice + 11*sidNum) % 250;
+        if( phase == 0 ) {
+            unsigned frq = 2000 + ((tick / 250) * 769 + voice * 3001 + sidNum * 997) % 12000;
+            regs[offset + 0x00] = frq & 0xff;
+            regs[offset + 0x01] = frq >> 8;
+            regs[offset + 0x04] = (voice == 2) ? 0x11 : 0x41; // triangle/pulse + gate
+        } else if( phase == 200 ) {
+            regs[offset + 0x04] = (voice == 2) ? 0x10 : 0x40;
+        }
+    }
+
+    // filter sweep
+    regs[0x16] = 0x20 + ((tick >> 2) & 0x7f);
+}
+
+// transfers the changed registers like RESID_Update()/RESID_Log() of the plugin
+static void SoundEngineCommit(SID *sid, int sidNum, bool log, unsigned cycle)
+{
+    for(int reg=0; reg<25; ++reg) {
+        unsigned char data = sidRegs[sidNum][reg];
+        if( data != sidRegsShadow[sidNum][reg] ) {
+            if( log ) {
+                if( !sidRegLog[sidNum].append(cycle, reg, data) )
+                    continue; // retry with next update
+            } else {
+                sid->write(reg, data);
+            }
+            sidRegsShadow[sidNum][reg] = data;
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders the given number of samples
+// returns a checksum over the output
+/////////////////////////////////////////////////////////////////////////////
+static unsigned Render(int numSids, int numSamples, method_t method, double *seconds)
+{
+    static float buffer[MAX_SIDS][HOST_BLOCK_SIZE];
+    SID *sid[MAX_SIDS];
+    unsigned cycle[MAX_SIDS];
+    ReSidRenderer renderer;
+    unsigned tick = 0;
+    unsigned nextTickCycle = 0;
+    unsigned checksum = 0;
+
+    for(int i=0; i<numSids; ++i) {
+        sid[i] = new SID;
+        SoundEngineInit(sid[i], i);
+        cycle[i] = 0;
+    }
+    renderer.setSampleRate(SAMPLE_RATE, UPDATE_FRQ);
+
+    unsigned long long startTime = TimeGet();
+
+    for(int block=0; block<numSamples; block+=HOST_BLOCK_SIZE) {
+        int blockSamples = numSamples - block;
+        if( blockSamples > HOST_BLOCK_SIZE )
+            blockSamples = HOST_BLOCK_SIZE;
+
+        if( method == METHOD_LOG ) {
+            unsigned blockEndCycle = cycle[0] + (unsigned)((double)(blockSamples+1) * SID_FREQUENCY / SAMPLE_RATE);
+            while( (int)(nextTickCycle - blockEndCycle) < 0 ) {
+                for(int i=0; i<numSids; ++i) {
+                    SoundEngineTick(i, tick);
+                    SoundEngineCommit(sid[i], i, true, nextTickCycle);
+                }
+                ++tick;
+                nextTickCycle += SID_FREQUENCY / UPDATE_FRQ;
+            }
+
+            for(int i=0; i<numSids; ++i)
+                renderer.renderLogged(sid[i], &sidRegLog[i], cycle[i], buffer[i], blockSamples);
+        } else if( method == METHOD_CYCLE ) {
+            for(int pos=0; pos<blockSamples; ++pos) {
+                for(int i=0; i<numSids; ++i) {
+                    short sample_buf;
+                    bool done = false;
+                    while( !done ) {
+                        if( cycle[i] == nextTickCycle ) {
+                            // all SIDs are clocked in lock-step: SID 0 updates the engine
+                            if( i == 0 ) {
+                                for(int j=0; j<numSids; ++j)
+                                    SoundEngineTick(j, tick);
+                                ++tick;
+                            }
+                            SoundEngineCommit(sid[i], i, false, 0);
+                        }
+
+                        cycle_count delta_t = 1;
+                        done = sid[i]->clock(delta_t, &sample_buf, 1);
+                        cycle[i] += 1 - delta_t;
+                    }
+
+                    buffer[i][pos] = (float)sample_buf / 32768.0;
+                }
+
+                // next tick once all SIDs have passed it
+                if( (int)(cycle[numSids-1] - nextTickCycle) > 0 )
+                    nextTickCycle += SID_FREQUENCY / UPDATE_FRQ;
+            }
+        } else if( method == METHOD_BLOCK ) {
+            int pos = 0;
+            while( pos < blockSamples ) {
+                if( renderer.updateDue() ) {
+                    for(int i=0; i<numSids; ++i) {
+                        SoundEngineTick(i, tick);
+                        SoundEngineCommit(sid[i], i, false, 0);
+                    }
+                    ++tick;
+                    renderer.updateDone();
+                }
+
+                int len = renderer.blockLength(blockSamples - pos);
+                for(int i=0; i<numSids; ++i)
+                    renderer.render(sid[i], &buffer[i][pos], len);
+
+                renderer.advance(len);
+                pos += len;
+            }
+        } else {
+            for(int pos=0; pos<blockSamples; ++pos) {
+                if( renderer.updateDue() ) {
+                    for(int i=0; i<numSids; ++i) {
+                        SoundEngineTick(i, tick);
+                        SoundEngineCommit(sid[i], i, false, 0);
+                    }
+                    ++tick;
+                    renderer.updateDone();
+                }
+
+                for(int i=0; i<numSids; ++i) {
+                    short sample_buf;
+                    cycle_count delta_t = 1;
+                    while( !sid[i]->clock(delta_t, &sample_buf, 1) )
+                        if( !delta_t ) // delta_t can be changed by clock()
+                            delta_t = 1;
+
+                    buffer[i][pos] = (float)sample_buf / 32768.0;
+                }
+
+                renderer.advance(1);
+            }
+        }
+
+        // checksum over the bit patterns (not part of the measured time)
+        unsigned long long t = TimeGet();
+        for(int i=0; i<numSids; ++i)
+            for(int pos=0; pos<blockSamples; ++pos) {
+                unsigned word;
+                memcpy(&word, &buffer[i][pos], sizeof(word));
+                checksum = checksum * 31 + word;
+            }
+        startTime += TimeGet() - t;
+    }
+
+    *seconds = (double)(TimeGet() - startTime) / 1E9;
+
+    for(int i=0; i<numSids; ++i)
+        delete sid[i];
+
+    return checksum;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    int audioSeconds = (argc >= 2) ? atoi(argv[1]) : 60;
+    int numSamples = audioSeconds * SAMPLE_RATE;
+    int errors = 0;
+
+    if( audioSeconds <= 0 ) {
+        printf("Usage: %s [<seconds>]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Rendering %d seconds @%d Hz, engine updates @%d Hz, host buffer %d samples\n",
+           audioSeconds, SAMPLE_RATE, UPDATE_FRQ, HOST_BLOCK_SIZE);
+
+    for(int numSids=1; numSids<=MAX_SIDS; numSids*=2) {
+        double seconds[3];
+        unsigned checksum[3];
+
+        printf("%d SID%s:", numSids, (numSids == 1) ? " " : "s");
+        for(int method=METHOD_SAMPLE; method<=METHOD_LOG; ++method) {
+            checksum[method] = Render(numSids, numSamples, (method_t)method, &seconds[method]);
+            printf(" %s %7.3f s (%6.1fx realtime)%s",
+                   methodName[method], seconds[method], audioSeconds / seconds[method],
+                   (method == METHOD_LOG) ? "\n" : ",");
+        }
+
+        // sample and block are using the same update points
+        bool blockOk = checksum[METHOD_SAMPLE] == checksum[METHOD_BLOCK];
+
+        // log is compared with cycle-by-cycle clocking (slow, therefore only a few seconds)
+        int verifySamples = ((audioSeconds < VERIFY_SECONDS) ? audioSeconds : VERIFY_SECONDS) * SAMPLE_RATE;
+        double dummy;
+        bool logOk = Render(numSids, verifySamples, METHOD_LOG, &dummy) == Render(numSids, verifySamples, METHOD_CYCLE, &dummy);
+
+        printf("        speedup block %.2f, log %.2f; block output %s, log output %s\n",
+               seconds[METHOD_SAMPLE] / seconds[METHOD_BLOCK],
+               seconds[METHOD_SAMPLE] / seconds[METHOD_LOG],
+               blockOk ? "identical" : "DIFFERENT",
+               logOk ? "cycle exact" : "NOT CYCLE EXACT");
+
+        if( !blockOk || !logOk )
+            ++errors;
+    }
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    return errors ? 1 : 0;
+}
@@ -42,6 +42,18 @@
 // nice for first checks of the emulation w/o MIDI input
 #define RESID_PLAY_TESTTONE 0
 
+// register write log:
+// if 1: the sound engine is updated each RESID_FREQUENCY/MBSID_UPDATE_FRQ SID cycles,
+//       the register changes are logged and written at the exact SID cycle while
+//       rendering (independent from the sample rate, allows higher update rates)
+// if 0: the engine is updated at the nearest sample, all SIDs are rendered in
+//       sub-blocks between the updates
+#define RESID_REG_WRITE_LOG 1
+
+// maximum number of samples rendered between two engine updates in log mode
+// (limits the number of logged writes)
+#define RESID_REG_WRITE_LOG_MAX_SAMPLES 1024
+
 
 
 // these global variables are used by ReSID
@@ -98,8 +110,13 @@ AudioProcessing::AudioProcessing()
 #endif
   
     // MBSID integration
-    // temporary code!
-    mbSidUpdateCounter = 0;  
+    // the sound engine will be updated before the first sample
+    reSidRenderer.setSampleRate(reSidSampleRate, MBSID_UPDATE_FRQ);
+    reSidNextUpdateCycle = 0;
+    for(int sid=0; sid<SID_NUM; ++sid) {
+        reSidCycle[sid] = 0;
+        reSidRegLog[sid].clear();
+    }
 
     // initialize my private SID registers
     for(int sid=0; sid<SID_NUM; ++sid)
@@ -107,6 +124,10 @@ AudioProcessing::AudioProcessing()
             sidRegs[sid].ALL[reg] = 0;
             sidRegsShadow[sid].ALL[reg] = 0;
         }
+#if SID_USE_DIRTY_FLAGS
+    for(int sid=0; sid<SID_NUM; ++sid)
+        sidRegs[sid].dirty = 0;
+#endif
 
     // trigger reset
     RESID_Update(2);
@@ -121,6 +142,8 @@ AudioProcessing::AudioProcessing()
 
 AudioProcessing::~AudioProcessing()
 {
+    reSidWorkerPool.stop();
+
 #if SID_NUM
     for(int i=0; i<SID_NUM; ++i) {
         delete reSID[i];
@@ -136,7 +159,7 @@ const String AudioProcessing::getName() const
 
 int AudioProcessing::getNumParameters()
 {
-    return 3;
+    return 4;
 }
 
 float AudioProcessing::getParameter (int index)
@@ -145,6 +168,7 @@ float AudioProcessing::getParameter (int index)
     case 0: return gain;
     case 1: return (float)bank;
     case 2: return (float)patch;
+    case 3: return (float)reSidWorkerPool.getNumThreads();
     }
   
     return 0.0f;
@@ -178,6 +202,14 @@ void AudioProcessing::setParameter (int index, float newValue)
             sendChangeMessage (this);
         }
         break;
+
+    case 3:
+        if( reSidWorkerPool.getNumThreads() != (int)newValue ) {
+            // taken over with the next sub-block
+            reSidWorkerPool.setNumThreads((int)newValue);
+            sendChangeMessage (this);
+        }
+        break;
     }
 }
 
@@ -187,6 +219,7 @@ const String AudioProcessing::getParameterName (int index)
     case 0: return T("gain");
     case 1: return T("bank");
     case 2: return T("patch");
+    case 3: return T("threads");
     }
 
     return String::empty;
@@ -198,6 +231,7 @@ const String AudioProcessing::getParameterText (int index)
     case 0: return String (gain, 2);
     case 1: return String ((float)bank, 2);
     case 2: return String ((float)patch, 2);
+    case 3: return String (reSidWorkerPool.getNumThreads());
     }
   
     return String::empty;
@@ -240,11 +274,18 @@ void AudioProcessing::prepareToPlay (double sampleRate, int samplesPerBlock)
     keyboardState.reset();
     keyboardState.addListener(&midiProcessing);
 
+    // start the rendering threads (they sleep if the parameter selects a single thread)
+    reSidWorkerPool.start();
+
 #if SID_NUM
     reSidEnabled = 1;
     reSidSampleRate = sampleRate;
+    reSidRenderer.setSampleRate(reSidSampleRate, MBSID_UPDATE_FRQ);
+    reSidNextUpdateCycle = 0;
 
     for(int i=0; i<SID_NUM; ++i) {
+        reSidCycle[i] = 0;
+        reSidRegLog[i].clear();
         reSID[i]->reset();
         if( !reSID[i]->set_sampling_parameters(RESID_FREQUENCY, RESID_SAMPLING_METHOD, reSidSampleRate) ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
@@ -274,6 +315,7 @@ void AudioProcessing::releaseResources()
 {
     // when playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    reSidWorkerPool.stop();
 }
 
 void AudioProcessing::processBlock (AudioSampleBuffer& buffer,
@@ -327,30 +369,59 @@ void AudioProcessing::processBlock (AudioSampleBuffer& buffer,
         int numSamples = buffer.getNumSamples();
     
         // add SID sound(s) to output(s)
-        // TK: this nested loop isn't optimal for CPU load, but we have to ensure that all SIDs are in lock-step
-        for(int i=0; i<numSamples; ++i) {
+        // the buffer is split at the sound engine updates: registers don't change
+        // within a sub-block, so that each SID can be rendered for the whole
+        // sub-block while all SIDs are still in lock-step.
+        // The SIDs are rendered in parallel if the "threads" parameter is > 1,
+        // the pool returns when all SIDs are done (barrier before the next update)
+        int numSids = (numChannels < SID_NUM) ? numChannels : SID_NUM;
+        float *dst[SID_NUM];
+        int pos = 0;
+#if RESID_REG_WRITE_LOG
+        // the engine runs ahead: all updates within the next block are executed,
+        // and the register changes are logged with their SID cycle.
+        // Thereafter each SID renders the whole block w/o synchronisation to other SIDs
+        while( pos < numSamples ) {
+            int len = numSamples - pos;
+            if( len > RESID_REG_WRITE_LOG_MAX_SAMPLES )
+                len = RESID_REG_WRITE_LOG_MAX_SAMPLES;
+
+            // all SIDs are at the same cycle, +1 to cover the fractional sample position
+            unsigned blockEndCycle = reSidCycle[0] + (unsigned)((double)(len+1) * RESID_FREQUENCY / reSidSampleRate);
+            while( (int)(reSidNextUpdateCycle - blockEndCycle) < 0 ) {
+#if RESID_PLAY_TESTTONE == 0
+                mbSidEnvironment.tick();
+                RESID_Log(reSidNextUpdateCycle);
+#endif
+                reSidNextUpdateCycle += RESID_FREQUENCY / MBSID_UPDATE_FRQ;
+            }
+
+            for(int channel = 0; channel < numSids; ++channel)
+                dst[channel] = buffer.getSampleData(channel, pos);
+            reSidWorkerPool.renderLogged(reSidRenderer, reSID, reSidRegLog, reSidCycle, dst, numSids, len);
+
+            pos += len;
+        }
+#else
+        while( pos < numSamples ) {
             // update sound engine
-            mbSidUpdateCounter += (double)MBSID_UPDATE_FRQ / reSidSampleRate;
-            if( mbSidUpdateCounter >= 1.0 ) {
-                mbSidUpdateCounter -= 1.0;
+            if( reSidRenderer.updateDue() ) {
 #if RESID_PLAY_TESTTONE == 0
                 mbSidEnvironment.tick();
                 RESID_Update(0);
 #endif
+                reSidRenderer.updateDone();
             }
 
-            for(int channel = 0; channel < numChannels; ++channel) {
-                // poll for next sample
-                short sample_buf;
-                cycle_count delta_t = 1;
-                while( !reSID[channel]->clock(delta_t, &sample_buf, 1) )
-                    if( !delta_t ) // delta_t can be changed by clock()
-                        delta_t = 1;
+            int len = reSidRenderer.blockLength(numSamples - pos);
+            for(int channel = 0; channel < numSids; ++channel)
+                dst[channel] = buffer.getSampleData(channel, pos);
+            reSidWorkerPool.render(reSidRenderer, reSID, dst, numSids, len);
 
-                float currentSample = (float)sample_buf / 32768.0;
-                *buffer.getSampleData(channel, i) = currentSample;
-            }
+            reSidRenderer.advance(len);
+            pos += len;
         }
+#endif
     }
 #endif
 
@@ -397,6 +468,7 @@ void AudioProcessing::getStateInformation (MemoryBlock& destData)
     xmlState.setAttribute (T("gainLevel"), gain);
     xmlState.setAttribute (T("bank"), bank);
     xmlState.setAttribute (T("patch"), patch);
+    xmlState.setAttribute (T("threads"), reSidWorkerPool.getNumThreads());
     xmlState.setAttribute (T("sysexMidiIn"), lastSysexMidiIn);
     xmlState.setAttribute (T("sysexMidiOut"), lastSysexMidiOut);
   
@@ -421,6 +493,7 @@ void AudioProcessing::setStateInformation (const void* data, int sizeInBytes)
                     gain = (float) xmlState->getDoubleAttribute (T("gainLevel"), gain);
                     bank = (float) xmlState->getDoubleAttribute (T("bank"), bank);
                     patch = (float) xmlState->getDoubleAttribute (T("patch"), patch);
+                    reSidWorkerPool.setNumThreads(xmlState->getIntAttribute (T("threads"), reSidWorkerPool.getNumThreads()));
       
 					lastSysexMidiIn = xmlState->getStringAttribute (T("sysexMidiIn"), lastSysexMidiIn);
 					lastSysexMidiOut = xmlState->getStringAttribute (T("sysexMidiOut"), lastSysexMidiOut);
@@ -516,11 +589,24 @@ s32 AudioProcessing::RESID_Update(u32 mode)
             reSID[i]->reset();
     }
 
+#if SID_USE_DIRTY_FLAGS
+    // take over the dirty flags: only the marked registers have to be checked
+    u32 dirty[SID_NUM];
+    for(int sid=0; sid<SID_NUM; ++sid) {
+        dirty[sid] = (mode >= 1) ? 0xffffffff : sidRegs[sid].dirty;
+        sidRegs[sid].dirty = 0;
+    }
+#endif
+
     // check for updates
     for(int i=0; i<(int)sizeof(update_order); ++i) {
         u8 reg = update_order[i];
 
         for(int sid=0; sid<SID_NUM; ++sid) {
+#if SID_USE_DIRTY_FLAGS
+            if( !(dirty[sid] & (1 << reg)) )
+                continue;
+#endif
             u8 data;
             if( (data=sidRegs[sid].ALL[reg]) != sidRegsShadow[sid].ALL[reg] || mode >= 1 ) {
                 sidRegsShadow[sid].ALL[reg] = data;
@@ -531,3 +617,49 @@ s32 AudioProcessing::RESID_Update(u32 mode)
 
   return 0; // no error
 }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Logs the changed RESID registers, they will be written at the given
+// SID cycle by the renderer
+// IN: <cycle>: SID cycle of the engine update
+// OUT: returns < 0 if a write couldn't be logged
+/////////////////////////////////////////////////////////////////////////////
+s32 AudioProcessing::RESID_Log(unsigned cycle)
+{
+    s32 status = 0;
+
+#if SID_USE_DIRTY_FLAGS
+    u32 dirty[SID_NUM];
+    for(int sid=0; sid<SID_NUM; ++sid) {
+        dirty[sid] = sidRegs[sid].dirty;
+        sidRegs[sid].dirty = 0;
+    }
+#endif
+
+    for(int i=0; i<(int)sizeof(update_order); ++i) {
+        u8 reg = update_order[i];
+
+        for(int sid=0; sid<SID_NUM; ++sid) {
+#if SID_USE_DIRTY_FLAGS
+            if( !(dirty[sid] & (1 << reg)) )
+                continue;
+#endif
+            u8 data;
+            if( (data=sidRegs[sid].ALL[reg]) != sidRegsShadow[sid].ALL[reg] ) {
+                // if the log is full, the shadow register isn't updated,
+                // so that the write will be retried with the next update
+                if( reSidRegLog[sid].append(cycle, reg, data) )
+                    sidRegsShadow[sid].ALL[reg] = data;
+                else {
+#if SID_USE_DIRTY_FLAGS
+                    sidRegs[sid].dirty |= (1 << reg);
+#endif
+                    status = -1;
+                }
+            }
+        }
+    }
+
+    return status;
+}
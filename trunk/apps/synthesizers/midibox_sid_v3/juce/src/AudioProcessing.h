@@ -34,6 +34,8 @@
 #define AUDIO_PROCESSING_H
 
 #include "../resid/resid.h"
+#include "ReSidRenderer.h"
+#include "ReSidWorkerPool.h"
 #include "MbSidEnvironment.h"
 #include "MidiProcessing.h"
 
@@ -130,13 +132,18 @@ public:
   
     int reSidEnabled;
     double reSidSampleRate;
-    double reSidDeltaCycleCounter;
+    ReSidRenderer reSidRenderer;
+    ReSidWorkerPool reSidWorkerPool;
 
-    double mbSidUpdateCounter;
+    // register write log (one per SID) and SID cycle counters
+    ReSidRegLog reSidRegLog[SID_NUM];
+    unsigned reSidCycle[SID_NUM];
+    unsigned reSidNextUpdateCycle;
 
     sid_regs_t sidRegs[SID_NUM];
     sid_regs_t sidRegsShadow[SID_NUM];
     s32 RESID_Update(u32 mode);
+    s32 RESID_Log(unsigned cycle);
 
   
     //==============================================================================
@@ -73,9 +73,15 @@ void MidiProcessing::processNextMidiEvent(const MidiMessage& message)
 
     // TODO: integrate this properly into $MIOS32_PATH/mios32/juce/ !!!
     if( size >= 1 && runningStatus == 0xf0 ) {
-        for(int i=0; i<size; ++i)
-            if( mbSidEnvironment )
-                mbSidEnvironment->midiReceiveSysEx(DEFAULT, data[i]);
+        if( mbSidEnvironment ) {
+            if( data[0] == 0xf0 ) {
+                // message starts with 0xf0: it's decoded at once if complete (e.g. ASID frames)
+                mbSidEnvironment->midiReceiveSysExBuffer(DEFAULT, data, size);
+            } else {
+                for(int i=0; i<size; ++i)
+                    mbSidEnvironment->midiReceiveSysEx(DEFAULT, data[i]);
+            }
+        }
     } else {
         sendMidiEvent(data[0],
                       (size >= 2) ? data[1] : 0x00,
@@ -0,0 +1,88 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Log of timestamped SID register writes
+ *
+ * The sound engine runs ahead of the audio rendering, the register changes
+ * of each engine update are stored with the SID cycle at which they have
+ * to be written. The renderer executes them at this cycle.
+ *
+ * Only a single producer (engine update) and a single consumer (rendering
+ * thread of the SID) are allowed, and they must not access the log at the
+ * same time (the audio thread synchronizes them).
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#ifndef _RESID_REG_LOG_H
+#define _RESID_REG_LOG_H
+
+
+// number of register writes which can be stored (must be a power of 2)
+#ifndef RESID_REG_LOG_SIZE
+#define RESID_REG_LOG_SIZE 4096
+#endif
+
+
+typedef struct {
+    unsigned cycle; // absolute SID cycle (wraps around)
+    unsigned char reg;
+    unsigned char value;
+} resid_reg_log_entry_t;
+
+
+class ReSidRegLog
+{
+public:
+    // Constructor
+    ReSidRegLog() { clear(); }
+
+    // removes all entries
+    void clear(void) { head = tail = 0; overruns = 0; }
+
+    // returns true if no write is pending
+    bool empty(void) const { return head == tail; }
+
+    // number of pending writes
+    unsigned used(void) const { return (head - tail) & (RESID_REG_LOG_SIZE-1); }
+
+    // appends a register write, returns false if the log is full
+    bool append(unsigned cycle, unsigned char reg, unsigned char value)
+    {
+        unsigned next = (head + 1) & (RESID_REG_LOG_SIZE-1);
+        if( next == tail ) {
+            ++overruns;
+            return false;
+        }
+
+        resid_reg_log_entry_t *e = &entry[head];
+        e->cycle = cycle;
+        e->reg = reg;
+        e->value = value;
+        head = next;
+
+        return true;
+    }
+
+    // returns the oldest write (only valid if !empty())
+    const resid_reg_log_entry_t &front(void) const { return entry[tail]; }
+
+    // removes the oldest write
+    void pop(void) { tail = (tail + 1) & (RESID_REG_LOG_SIZE-1); }
+
+    // number of writes which couldn't be stored
+    unsigned overruns;
+
+protected:
+    resid_reg_log_entry_t entry[RESID_REG_LOG_SIZE];
+    unsigned head;
+    unsigned tail;
+};
+
+#endif /* _RESID_REG_LOG_H */
@@ -0,0 +1,185 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Block based reSID rendering
+ *
+ * The audio buffer is split at the update points of the sound engine.
+ * Between two updates the SID registers don't change, accordingly each
+ * SID can be clocked for the whole sub-block with a single SID::clock()
+ * call while all SIDs are still in lock-step at register write granularity.
+ *
+ * The update points are determined with integer arithmetic: the distance
+ * between two updates is sampleRate/updateFrequency samples, the remainder
+ * is accumulated in updatePhase (Bresenham), so that there is no drift.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#include "ReSidRenderer.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor
+/////////////////////////////////////////////////////////////////////////////
+ReSidRenderer::ReSidRenderer()
+{
+    setSampleRate(44100.0, 1000);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Destructor
+/////////////////////////////////////////////////////////////////////////////
+ReSidRenderer::~ReSidRenderer()
+{
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Sets the sample rate and the update frequency of the sound engine
+// The engine will be updated before the first sample
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::setSampleRate(double _sampleRate, int _updateFrequency)
+{
+    sampleRate = (int)(_sampleRate + 0.5);
+    updateFrequency = (_updateFrequency > 0) ? _updateFrequency : 1;
+    updatePhase = 0;
+    samplesUntilUpdate = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Schedules the next update of the sound engine
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::updateDone(void)
+{
+    updatePhase += sampleRate;
+    samplesUntilUpdate = updatePhase / updateFrequency;
+    updatePhase -= samplesUntilUpdate * updateFrequency;
+
+    // sample rate below update frequency: at least one sample per update
+    if( samplesUntilUpdate < 1 )
+        samplesUntilUpdate = 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Returns the number of samples which should be rendered with the next
+// sub-block
+/////////////////////////////////////////////////////////////////////////////
+int ReSidRenderer::blockLength(int remainingSamples)
+{
+    int len = remainingSamples;
+
+    if( len > samplesUntilUpdate )
+        len = samplesUntilUpdate;
+    if( len > RESID_RENDERER_SCRATCH_SIZE )
+        len = RESID_RENDERER_SCRATCH_SIZE;
+
+    return len;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders numSamples (<= blockLength()) into a float buffer
+// The SID will be clocked until the requested number of samples is
+// available, no cycles are left over for the next sub-block, so that the
+// result is identical to sample-wise clocking.
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::render(SID *sid, float *dst, int numSamples)
+{
+    render(sid, dst, numSamples, scratch);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders numSamples (<= RESID_RENDERER_SCRATCH_SIZE) into a float buffer,
+// the scratch buffer has to provide space for RESID_RENDERER_SCRATCH_SIZE
+// samples
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::render(SID *sid, float *dst, int numSamples, short *scratch)
+{
+    int rendered = 0;
+
+    while( rendered < numSamples ) {
+        // clock() returns once the buffer is full, the remaining cycles
+        // are not processed. One sample takes ~23 cycles @44.1kHz,
+        // the budget is sufficient for rates down to ~4 kHz
+        cycle_count delta_t = (numSamples - rendered) * 256;
+        rendered += sid->clock(delta_t, &scratch[rendered], numSamples - rendered);
+    }
+
+    convert(scratch, dst, numSamples);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders numSamples into a float buffer and executes the logged register
+// writes at the SID cycle of the log entry (writes with a cycle in the past
+// are executed immediately). Writes which are not due until the last sample
+// has been rendered stay in the log.
+// The SID is only clocked in segments between two writes, so that the
+// engine can be updated at a high rate without splitting the rendering
+// into small blocks.
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::renderLogged(SID *sid, ReSidRegLog *log, unsigned &cycle, float *dst, int numSamples)
+{
+    renderLogged(sid, log, cycle, dst, numSamples, scratch);
+}
+
+void ReSidRenderer::renderLogged(SID *sid, ReSidRegLog *log, unsigned &cycle, float *dst, int numSamples, short *scratch)
+{
+    for(int pos=0; pos<numSamples; pos+=RESID_RENDERER_SCRATCH_SIZE) {
+        int len = numSamples - pos;
+        if( len > RESID_RENDERER_SCRATCH_SIZE )
+            len = RESID_RENDERER_SCRATCH_SIZE;
+
+        int rendered = 0;
+        while( rendered < len ) {
+            // execute all writes which are due
+            while( !log->empty() && (int)(log->front().cycle - cycle) <= 0 ) {
+                sid->write(log->front().reg, log->front().value);
+                log->pop();
+            }
+
+            // clock until the next write, or until the buffer is full
+            cycle_count delta_t = (len - rendered) * 256;
+            if( !log->empty() && (int)(log->front().cycle - cycle) < delta_t )
+                delta_t = log->front().cycle - cycle;
+
+            cycle_count requested = delta_t;
+            rendered += sid->clock(delta_t, &scratch[rendered], len - rendered);
+            cycle += requested - delta_t; // delta_t contains the cycles which haven't been clocked
+        }
+
+        convert(scratch, &dst[pos], len);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Has to be called after all SIDs have rendered the sub-block
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::advance(int numSamples)
+{
+    samplesUntilUpdate -= numSamples;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Converts 16bit samples to float
+// Simple loop w/o dependencies, so that the compiler can vectorize it
+/////////////////////////////////////////////////////////////////////////////
+void ReSidRenderer::convert(const short * __restrict src, float * __restrict dst, int numSamples)
+{
+    const float scale = 1.0f / 32768.0f;
+
+    for(int i=0; i<numSamples; ++i)
+        dst[i] = (float)src[i] * scale;
+}
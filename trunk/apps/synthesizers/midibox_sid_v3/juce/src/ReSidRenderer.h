@@ -0,0 +1,76 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Block based reSID rendering
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#ifndef _RESID_RENDERER_H
+#define _RESID_RENDERER_H
+
+#include "../resid/resid.h"
+#include "ReSidRegLog.h"
+
+
+// maximum number of samples which are rendered with a single SID::clock() call
+// (a sub-block never exceeds the distance between two sound engine updates)
+#ifndef RESID_RENDERER_SCRATCH_SIZE
+#define RESID_RENDERER_SCRATCH_SIZE 256
+#endif
+
+
+class ReSidRenderer
+{
+public:
+    // Constructor
+    ReSidRenderer();
+
+    // Destructor
+    ~ReSidRenderer();
+
+    // sets the output sample rate and the update frequency of the sound engine
+    void setSampleRate(double sampleRate, int updateFrequency);
+
+    // returns true if the sound engine has to be updated before the next sample
+    bool updateDue(void) { return samplesUntilUpdate == 0; }
+
+    // has to be called after the sound engine has been updated
+    void updateDone(void);
+
+    // returns the number of samples which can be rendered until the next update
+    int blockLength(int remainingSamples);
+
+    // renders a sub-block of a SID into a float buffer
+    void render(SID *sid, float *dst, int numSamples);
+
+    // same as render(), but with a scratch buffer of the caller (for worker threads)
+    static void render(SID *sid, float *dst, int numSamples, short *scratch);
+
+    // renders any number of samples, the logged register writes are executed
+    // at their SID cycle. cycle is the cycle counter of the SID.
+    void renderLogged(SID *sid, ReSidRegLog *log, unsigned &cycle, float *dst, int numSamples);
+    static void renderLogged(SID *sid, ReSidRegLog *log, unsigned &cycle, float *dst, int numSamples, short *scratch);
+
+    // has to be called after all SIDs have rendered the sub-block
+    void advance(int numSamples);
+
+    // converts 16bit samples to float (-1.0..1.0)
+    static void convert(const short *src, float *dst, int numSamples);
+
+protected:
+    int samplesUntilUpdate;
+    int updatePhase;
+    int updateFrequency;
+    int sampleRate;
+
+    short scratch[RESID_RENDERER_SCRATCH_SIZE];
+};
+
+#endif /* _RESID_RENDERER_H */
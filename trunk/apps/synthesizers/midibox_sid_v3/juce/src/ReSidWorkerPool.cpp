@@ -0,0 +1,221 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Worker threads for parallel reSID rendering
+ *
+ * The audio thread updates the sound engine and commits the SID registers
+ * (RESID_Update()), thereafter the sub-block until the next engine update
+ * is rendered by the audio thread and the workers in parallel: each thread
+ * renders a fixed subset of the SIDs. The audio thread waits until all
+ * workers are done before the next engine update (barrier per tick), so
+ * that all SIDs stay in lock-step.
+ *
+ * With the register write log each SID executes the writes at their
+ * SID cycle by itself, so that a whole block can be rendered in parallel
+ * with a single barrier.
+ *
+ * The worker threads are started once and sleep while they are not
+ * used, setNumThreads() only selects how many of them take part.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#include "includes.h"
+#include "ReSidWorkerPool.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Worker: Constructor
+/////////////////////////////////////////////////////////////////////////////
+ReSidWorker::ReSidWorker(int index)
+    : Thread(T("reSID Worker ") + String(index))
+{
+    sid = NULL;
+    log = NULL;
+    cycle = NULL;
+    dst = NULL;
+    numSids = 0;
+    numSamples = 0;
+    first = 0;
+    step = 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Worker: Destructor
+/////////////////////////////////////////////////////////////////////////////
+ReSidWorker::~ReSidWorker()
+{
+    stopThread(1000);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Worker: waits for a job (notify()), renders the assigned SIDs and
+// signals the completion
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorker::run()
+{
+    while( !threadShouldExit() ) {
+        wait(-1);
+
+        if( threadShouldExit() )
+            break;
+
+        for(int i=first; i<numSids; i+=step) {
+            if( log != NULL )
+                ReSidRenderer::renderLogged(sid[i], &log[i], cycle[i], dst[i], numSamples, scratch);
+            else
+                ReSidRenderer::render(sid[i], dst[i], numSamples, scratch);
+        }
+
+        doneEvent.signal();
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pool: Constructor
+/////////////////////////////////////////////////////////////////////////////
+ReSidWorkerPool::ReSidWorkerPool()
+{
+    for(int i=0; i<RESID_WORKER_POOL_MAX_THREADS-1; ++i)
+        worker[i] = NULL;
+
+    numWorkersRunning = 0;
+    numThreads = 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pool: Destructor
+/////////////////////////////////////////////////////////////////////////////
+ReSidWorkerPool::~ReSidWorkerPool()
+{
+    stop();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Starts the worker threads (if not already done)
+// Should be called from prepareToPlay()
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorkerPool::start(void)
+{
+    if( numWorkersRunning )
+        return;
+
+    for(int i=0; i<RESID_WORKER_POOL_MAX_THREADS-1; ++i) {
+        worker[i] = new ReSidWorker(i+1);
+        worker[i]->startThread(9); // high priority: rendering is part of the audio callback
+    }
+
+    numWorkersRunning = RESID_WORKER_POOL_MAX_THREADS-1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Stops the worker threads
+// Must not be called while render() is executed
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorkerPool::stop(void)
+{
+    numWorkersRunning = 0;
+
+    for(int i=0; i<RESID_WORKER_POOL_MAX_THREADS-1; ++i) {
+        if( worker[i] != NULL ) {
+            worker[i]->signalThreadShouldExit();
+            worker[i]->notify();
+            delete worker[i]; // waits until the thread has been stopped
+            worker[i] = NULL;
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Sets the number of rendering threads (1..RESID_WORKER_POOL_MAX_THREADS)
+// Can be changed at any time, the new value is taken with the next sub-block
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorkerPool::setNumThreads(int _numThreads)
+{
+    if( _numThreads < 1 )
+        _numThreads = 1;
+    else if( _numThreads > RESID_WORKER_POOL_MAX_THREADS )
+        _numThreads = RESID_WORKER_POOL_MAX_THREADS;
+
+    numThreads = _numThreads;
+}
+
+int ReSidWorkerPool::getNumThreads(void)
+{
+    return numThreads;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders a sub-block of all SIDs
+// The registers must have been committed before, the function returns when
+// all SIDs have been rendered
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorkerPool::render(ReSidRenderer &renderer, SID **sid, float **dst, int numSids, int numSamples)
+{
+    dispatch(renderer, sid, NULL, NULL, dst, numSids, numSamples);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders a block of all SIDs with logged register writes
+// Each SID executes the writes of its own log, accordingly only a single
+// barrier per block is required
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorkerPool::renderLogged(ReSidRenderer &renderer, SID **sid, ReSidRegLog *log, unsigned *cycle, float **dst, int numSids, int numSamples)
+{
+    dispatch(renderer, sid, log, cycle, dst, numSids, numSamples);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Distributes the SIDs over the threads
+/////////////////////////////////////////////////////////////////////////////
+void ReSidWorkerPool::dispatch(ReSidRenderer &renderer, SID **sid, ReSidRegLog *log, unsigned *cycle, float **dst, int numSids, int numSamples)
+{
+    // take over the number of threads only once, it could be changed by another thread
+    int threads = numThreads;
+    if( threads > numSids )
+        threads = numSids;
+    if( threads > (numWorkersRunning+1) )
+        threads = numWorkersRunning+1;
+
+    // start the workers
+    for(int i=0; i<threads-1; ++i) {
+        ReSidWorker *w = worker[i];
+        w->sid = sid;
+        w->log = log;
+        w->cycle = cycle;
+        w->dst = dst;
+        w->numSids = numSids;
+        w->numSamples = numSamples;
+        w->first = i+1;
+        w->step = threads;
+        w->notify();
+    }
+
+    // the audio thread renders SID 0, threads, 2*threads, ...
+    for(int i=0; i<numSids; i+=threads) {
+        if( log != NULL )
+            renderer.renderLogged(sid[i], &log[i], cycle[i], dst[i], numSamples);
+        else
+            renderer.render(sid[i], dst[i], numSamples);
+    }
+
+    // barrier: wait until all workers are done
+    for(int i=0; i<threads-1; ++i)
+        worker[i]->doneEvent.wait(-1);
+}
@@ -0,0 +1,88 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Worker threads for parallel reSID rendering
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ * 
+ * ==========================================================================
+ */
+
+#ifndef _RESID_WORKER_POOL_H
+#define _RESID_WORKER_POOL_H
+
+#include "ReSidRenderer.h"
+
+
+// maximum number of rendering threads (including the audio thread)
+#ifndef RESID_WORKER_POOL_MAX_THREADS
+#define RESID_WORKER_POOL_MAX_THREADS 8
+#endif
+
+
+class ReSidWorker : public Thread
+{
+public:
+    // Constructor
+    ReSidWorker(int index);
+
+    // Destructor
+    ~ReSidWorker();
+
+    // renders the SIDs first, first+step, first+2*step, ...
+    void run();
+
+    // job (only changed while the worker is idle)
+    SID **sid;
+    ReSidRegLog *log; // NULL: sub-block w/o register writes
+    unsigned *cycle;
+    float **dst;
+    int numSids;
+    int numSamples;
+    int first;
+    int step;
+
+    // signalled when the job has been processed
+    WaitableEvent doneEvent;
+
+protected:
+    short scratch[RESID_RENDERER_SCRATCH_SIZE];
+};
+
+
+class ReSidWorkerPool
+{
+public:
+    // Constructor
+    ReSidWorkerPool();
+
+    // Destructor
+    ~ReSidWorkerPool();
+
+    // starts/stops the worker threads
+    void start(void);
+    void stop(void);
+
+    // number of rendering threads (including the audio thread)
+    void setNumThreads(int numThreads);
+    int getNumThreads(void);
+
+    // renders a sub-block of all SIDs, returns when all SIDs are rendered
+    void render(ReSidRenderer &renderer, SID **sid, float **dst, int numSids, int numSamples);
+
+    // renders a block of all SIDs with logged register writes, returns when all SIDs are rendered
+    void renderLogged(ReSidRenderer &renderer, SID **sid, ReSidRegLog *log, unsigned *cycle, float **dst, int numSids, int numSamples);
+
+protected:
+    void dispatch(ReSidRenderer &renderer, SID **sid, ReSidRegLog *log, unsigned *cycle, float **dst, int numSids, int numSamples);
+
+    ReSidWorker *worker[RESID_WORKER_POOL_MAX_THREADS-1];
+    int numWorkersRunning;
+    int numThreads;
+};
+
+#endif /* _RESID_WORKER_POOL_H */
@@ -57,4 +57,7 @@
 
 #define SIDPHYS_DISABLED
 
+// the MBSID engine marks all register writes in sid_regs_t.dirty
+#define SID_USE_DIRTY_FLAGS 1
+
 #endif /* _MIOS32_CONFIG_H */
@@ -89,10 +89,19 @@
 // MSD not enabled yet...
 #undef USE_MSD
 
+// patch banks are stored on SD Card (bank A is taken from ROM as long as no bank file exists)
+#define MBSID_USE_BANK_FILES    1
+
+// ASID frames are buffered and played out at the frame rate of the SID player
+// (compensates the jitter of USB MIDI drivers, adds 3 frames latency)
+#define MBSID_ASID_JITTER_DEPTH 3
+
 
 // MBNet Config:
 // relevant if configured as master: how many nodes should be scanned maximum
 #define SID_USE_MBNET           1
+// the MBSID engine marks all register writes in sid_regs_t.dirty
+#define SID_USE_DIRTY_FLAGS     1
 #define MBNET_SLAVE_NODES_MAX   4
 #define MBNET_SLAVE_NODES_BEGIN 0x00
 #define MBNET_SLAVE_NODES_END   0x03
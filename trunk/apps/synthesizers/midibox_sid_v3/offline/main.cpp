@@ -0,0 +1,555 @@
+/* -*- mode:C++; tab-width:4; c-basic-offset:4; indent-tabs-mode:nil -*- */
+// $Id$
+/*
+ * Offline MIDIbox SID Renderer
+ *
+ * Plays a Standard MIDI File through the MBSID sound engine and reSID,
+ * and writes the result into a 16bit stereo WAV file (left/right SID).
+ * Rendering isn't synchronized to a realtime clock, it runs as fast
+ * as possible: the tool is used as a batch renderer for patch libraries,
+ * and as a reproducible benchmark of the sound engines.
+ *
+ * Usage: mbsid_render [options] <midi file> [<wav file>]
+ *
+ * Options:
+ *   -r <rate>       sample rate (default: 44100)
+ *   -b <bank>       bank of the initial patch (default: 0)
+ *   -p <patch>      initial patch 1..128 (default: 1)
+ *   -s <syx file>   SysEx dump which is sent to MbSidSysEx before playback
+ *   -t <seconds>    rendering time after the end of the song (default: 2)
+ *   -g <gain>       output gain (default: 1.0)
+ *   -c              cycle exact register writes (reSID register write log)
+ *
+ * If no WAV file is specified, only the benchmark results are print.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2010 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#include <mios32.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+extern "C" {
+#include <mid_parser.h>
+}
+
+#include "MbSidEnvironment.h"
+#include "../juce/resid/resid.h"
+#include "../juce/src/ReSidRenderer.h"
+#include "../juce/src/ReSidRegLog.h"
+
+
+// update frequency of MBSID
+#define MBSID_UPDATE_FRQ 1000
+
+// SID frequency
+#define RESID_FREQUENCY 1000000
+
+// selected Model
+#define RESID_MODEL MOS8580
+
+// sampling method
+#define RESID_SAMPLING_METHOD SAMPLE_INTERPOLATE
+
+// number of samples which are rendered at once (and written into the WAV file)
+#define RENDER_BLOCK_SIZE 1024
+
+
+// these global variables are used by ReSID
+double mixer_value1;
+double mixer_value2;
+double mixer_value3;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static MbSidEnvironment mbSidEnvironment;
+
+static SID *reSID[SID_NUM];
+static ReSidRenderer reSidRenderer;
+static ReSidRegLog reSidRegLog[SID_NUM];
+static unsigned reSidCycle[SID_NUM];
+static unsigned reSidNextUpdateCycle;
+
+// the sound engine writes into sid_regs[] of the SID module
+static sid_regs_t sidRegsShadow[SID_NUM];
+
+static FILE *midiFile;
+
+// song position
+static double songTick;            // current MIDI tick
+static double songTicksPerUpdate;  // MIDI ticks per engine update (depends on tempo)
+static u32 songNextTick;           // next tick which has to be fetched
+static bool songFinished;
+static bool sysexRunning;
+
+// statistics
+static unsigned numEvents;
+static unsigned numUpdates;
+static double engineTime;
+static unsigned long long numRegsChecked;
+static unsigned long long numRegsWritten;
+
+// if true: the dirty flags are ignored, all registers are compared
+static bool fullCompare;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement
+/////////////////////////////////////////////////////////////////////////////
+static double timeGet(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1E-6;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIOS32 functions which are not part of the wrapper code
+/////////////////////////////////////////////////////////////////////////////
+extern "C" s32 MIOS32_MIDI_SendSysEx(mios32_midi_port_t port, u8 *stream, u32 count)
+{
+    return 0; // acknowledge messages are not forwarded
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Replacement for the SID module: the registers are transfered to reSID
+// after each engine update (physical SIDs are not available)
+/////////////////////////////////////////////////////////////////////////////
+sid_regs_t sid_regs[SID_NUM];
+
+extern "C" s32 SID_Update(u32 mode)
+{
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIDI file access (callbacks of MID_PARSER)
+/////////////////////////////////////////////////////////////////////////////
+static u32 midiFileRead(void *buffer, u32 len)
+{
+    return fread(buffer, 1, len, midiFile);
+}
+
+static s32 midiFileEof(void)
+{
+    return feof(midiFile) ? 1 : 0;
+}
+
+static s32 midiFileSeek(u32 pos)
+{
+    return fseek(midiFile, pos, SEEK_SET);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MIDI events of the song (callbacks of MID_PARSER)
+/////////////////////////////////////////////////////////////////////////////
+static s32 playEvent(u8 track, mios32_midi_package_t midi_package, u32 tick)
+{
+    ++numEvents;
+
+    if( midi_package.type == 0xf ) {
+        // SysEx bytes: the parser doesn't forward the 0xf0 of a SysEx event
+        if( !sysexRunning && midi_package.evnt0 != 0xf0 )
+            mbSidEnvironment.midiReceiveSysEx(DEFAULT, 0xf0);
+        sysexRunning = midi_package.evnt0 != 0xf7;
+        mbSidEnvironment.midiReceiveSysEx(DEFAULT, midi_package.evnt0);
+    } else {
+        mbSidEnvironment.midiReceive(DEFAULT, midi_package);
+    }
+
+    return 0; // no error
+}
+
+static s32 playMeta(u8 track, u8 meta, u32 len, u8 *buffer, u32 tick)
+{
+    if( meta == 0x51 && len >= 3 ) { // Set Tempo
+        u32 tempo_us = (buffer[0] << 16) | (buffer[1] << 8) | buffer[2];
+        if( tempo_us ) {
+            float bpm = 60.0 * (1E6 / (float)tempo_us);
+            mbSidEnvironment.bpmSet(bpm);
+            songTicksPerUpdate = (double)MIDI_PARSER_PPQN_Get() * bpm / (60.0 * MBSID_UPDATE_FRQ);
+        }
+    }
+
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Plays the MIDI events of the next mS, and updates the sound engine
+/////////////////////////////////////////////////////////////////////////////
+static void engineTick(void)
+{
+    double t0 = timeGet();
+
+    if( !songFinished ) {
+        songTick += songTicksPerUpdate;
+        while( !songFinished && songNextTick <= (u32)songTick ) {
+            if( MID_PARSER_FetchEvents(songNextTick, 1) <= 0 )
+                songFinished = true;
+            ++songNextTick;
+        }
+    }
+
+    mbSidEnvironment.tick();
+    ++numUpdates;
+
+    engineTime += timeGet() - t0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Transfers the changed SID registers to reSID
+/////////////////////////////////////////////////////////////////////////////
+static const u8 update_order[] = {
+   0,  1,  2,  3,  5,  6, // voice 1 w/o osc control register
+   7,  8,  9, 10, 12, 13, // voice 2 w/o osc control register
+  14, 15, 16, 17, 19, 20, // voice 3 w/o osc control register
+   4, 11, 18,             // voice 1/2/3 control registers
+  21, 22, 23, 24,         // remaining SID registers
+};
+
+static void reSidUpdate(bool logged, unsigned cycle)
+{
+    // take over the dirty flags: only the marked registers have to be checked
+    u32 dirty[SID_NUM];
+    for(int sid=0; sid<SID_NUM; ++sid) {
+        dirty[sid] = fullCompare ? 0xffffffff : sid_regs[sid].dirty;
+        sid_regs[sid].dirty = 0;
+    }
+
+    for(int i=0; i<(int)sizeof(update_order); ++i) {
+        u8 reg = update_order[i];
+
+        for(int sid=0; sid<SID_NUM; ++sid) {
+            if( !(dirty[sid] & (1 << reg)) )
+                continue;
+
+            ++numRegsChecked;
+            u8 data;
+            if( (data=sid_regs[sid].ALL[reg]) != sidRegsShadow[sid].ALL[reg] ) {
+                if( !logged ) {
+                    reSID[sid]->write(reg, data);
+                    sidRegsShadow[sid].ALL[reg] = data;
+                    ++numRegsWritten;
+                } else if( reSidRegLog[sid].append(cycle, reg, data) ) {
+                    sidRegsShadow[sid].ALL[reg] = data;
+                    ++numRegsWritten;
+                } else {
+                    // retried with the next update if the log is full
+                    sid_regs[sid].dirty |= (1 << reg);
+                }
+            }
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Renders a block of samples for all SIDs
+/////////////////////////////////////////////////////////////////////////////
+static void renderBlock(bool logged, double sampleRate, float **dst, int numSamples)
+{
+    if( logged ) {
+        // the engine runs ahead, register writes are executed at their SID cycle
+        unsigned blockEndCycle = reSidCycle[0] + (unsigned)((double)(numSamples+1) * RESID_FREQUENCY / sampleRate);
+        while( (int)(reSidNextUpdateCycle - blockEndCycle) < 0 ) {
+            engineTick();
+            reSidUpdate(true, reSidNextUpdateCycle);
+            reSidNextUpdateCycle += RESID_FREQUENCY / MBSID_UPDATE_FRQ;
+        }
+
+        for(int sid=0; sid<SID_NUM; ++sid)
+            reSidRenderer.renderLogged(reSID[sid], &reSidRegLog[sid], reSidCycle[sid], dst[sid], numSamples);
+    } else {
+        // sub-blocks between the engine updates
+        int pos = 0;
+        while( pos < numSamples ) {
+            if( reSidRenderer.updateDue() ) {
+                engineTick();
+                reSidUpdate(false, 0);
+                reSidRenderer.updateDone();
+            }
+
+            int len = reSidRenderer.blockLength(numSamples - pos);
+            for(int sid=0; sid<SID_NUM; ++sid)
+                reSidRenderer.render(reSID[sid], dst[sid] + pos, len);
+            reSidRenderer.advance(len);
+            pos += len;
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WAV file output
+/////////////////////////////////////////////////////////////////////////////
+static void wavPut32(u8 *p, u32 value)
+{
+    p[0] = value; p[1] = value >> 8; p[2] = value >> 16; p[3] = value >> 24;
+}
+
+static void wavPut16(u8 *p, u16 value)
+{
+    p[0] = value; p[1] = value >> 8;
+}
+
+static s32 wavHeaderWrite(FILE *f, u32 sampleRate, u32 numFrames)
+{
+    u8 header[44];
+    u32 dataSize = numFrames * SID_NUM * 2;
+
+    memcpy(&header[0], "RIFF", 4);
+    wavPut32(&header[4], 36 + dataSize);
+    memcpy(&header[8], "WAVEfmt ", 8);
+    wavPut32(&header[16], 16); // fmt chunk size
+    wavPut16(&header[20], 1); // PCM
+    wavPut16(&header[22], SID_NUM); // channels
+    wavPut32(&header[24], sampleRate);
+    wavPut32(&header[28], sampleRate * SID_NUM * 2); // bytes per second
+    wavPut16(&header[32], SID_NUM * 2); // block align
+    wavPut16(&header[34], 16); // bits per sample
+    memcpy(&header[36], "data", 4);
+    wavPut32(&header[40], dataSize);
+
+    if( fseek(f, 0, SEEK_SET) < 0 || fwrite(header, 1, sizeof(header), f) != sizeof(header) )
+        return -1;
+
+    return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Sends a SysEx file to MbSidSysEx
+/////////////////////////////////////////////////////////////////////////////
+static s32 sysexFileSend(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if( f == NULL )
+        return -1;
+
+    int c;
+    s32 num_bytes = 0;
+    while( (c=fgetc(f)) != EOF ) {
+        mbSidEnvironment.midiReceiveSysEx(DEFAULT, (u8)c);
+        ++num_bytes;
+    }
+
+    fclose(f);
+
+    return num_bytes;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-r <rate>] [-b <bank>] [-p <patch>] [-s <syx file>] [-t <seconds>] [-g <gain>] [-c] [-f] <midi file> [<wav file>]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    double sampleRate = 44100.0;
+    int bank = 0;
+    int patch = 1;
+    const char *sysexFilename = NULL;
+    double tailTime = 2.0;
+    float gain = 1.0f;
+    bool logged = false;
+    const char *midiFilename = NULL;
+    const char *wavFilename = NULL;
+
+    for(int i=1; i<argc; ++i) {
+        if( argv[i][0] == '-' && argv[i][1] != 0 && argv[i][2] == 0 ) {
+            char option = argv[i][1];
+            if( option == 'c' ) {
+                logged = true;
+                continue;
+            }
+            if( option == 'f' ) {
+                fullCompare = true;
+                continue;
+            }
+
+            if( (i+1) >= argc ) {
+                usage(argv[0]);
+                return 1;
+            }
+
+            const char *arg = argv[++i];
+            switch( option ) {
+            case 'r': sampleRate = atof(arg); break;
+            case 'b': bank = atoi(arg); break;
+            case 'p': patch = atoi(arg); break;
+            case 's': sysexFilename = arg; break;
+            case 't': tailTime = atof(arg); break;
+            case 'g': gain = atof(arg); break;
+            default:
+                usage(argv[0]);
+                return 1;
+            }
+        } else if( midiFilename == NULL ) {
+            midiFilename = argv[i];
+        } else if( wavFilename == NULL ) {
+            wavFilename = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if( midiFilename == NULL || sampleRate < 8000.0 || patch < 1 || patch > 128 ) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // reSID
+    mixer_value1 = 1.0f;
+    mixer_value2 = 1.0f;
+    mixer_value3 = 1.0f;
+    for(int sid=0; sid<SID_NUM; ++sid) {
+        reSID[sid] = new SID;
+        reSID[sid]->set_chip_model(RESID_MODEL);
+        reSID[sid]->reset();
+        if( !reSID[sid]->set_sampling_parameters(RESID_FREQUENCY, RESID_SAMPLING_METHOD, sampleRate) ) {
+            fprintf(stderr, "ERROR: reSID doesn't support a sample rate of %.0f Hz\n", sampleRate);
+            return 1;
+        }
+
+        reSidCycle[sid] = 0;
+        for(int reg=0; reg<SID_REGS_NUM; ++reg) {
+            sidRegsShadow[sid].ALL[reg] = 0;
+        }
+    }
+    reSidRenderer.setSampleRate(sampleRate, MBSID_UPDATE_FRQ);
+    reSidNextUpdateCycle = 0;
+
+    // MBSID (the environment has already assigned sid_regs[] to the engines)
+    if( mbSidEnvironment.bankLoad(0, bank, patch-1) < 0 ) {
+        fprintf(stderr, "ERROR: patch %c%03d not available\n", 'A' + bank, patch);
+        return 1;
+    }
+
+    if( sysexFilename && sysexFileSend(sysexFilename) < 0 ) {
+        fprintf(stderr, "ERROR: can't read %s\n", sysexFilename);
+        return 1;
+    }
+
+    char patchName[17];
+    mbSidEnvironment.mbSid[0].mbSidPatch.nameGet(patchName);
+
+    // MIDI file
+    if( (midiFile=fopen(midiFilename, "rb")) == NULL ) {
+        fprintf(stderr, "ERROR: can't open %s\n", midiFilename);
+        return 1;
+    }
+
+    MID_PARSER_Init(0);
+    MID_PARSER_InstallFileCallbacks((void *)&midiFileRead, (void *)&midiFileEof, (void *)&midiFileSeek);
+    MID_PARSER_InstallEventCallbacks((void *)&playEvent, (void *)&playMeta);
+    if( MID_PARSER_Read() < 0 || MIDI_PARSER_PPQN_Get() <= 0 ) {
+        fprintf(stderr, "ERROR: %s is not a valid MIDI file\n", midiFilename);
+        return 1;
+    }
+
+    // 120 BPM until the first tempo event
+    mbSidEnvironment.bpmSet(120.0);
+    mbSidEnvironment.bpmRestart();
+    songTicksPerUpdate = (double)MIDI_PARSER_PPQN_Get() * 120.0 / (60.0 * MBSID_UPDATE_FRQ);
+    songTick = -songTicksPerUpdate; // the first update plays tick 0
+    songNextTick = 0;
+    songFinished = false;
+    sysexRunning = false;
+
+    FILE *wavFile = NULL;
+    if( wavFilename ) {
+        if( (wavFile=fopen(wavFilename, "wb")) == NULL || wavHeaderWrite(wavFile, (u32)sampleRate, 0) < 0 ) {
+            fprintf(stderr, "ERROR: can't write %s\n", wavFilename);
+            return 1;
+        }
+    }
+
+    printf("Rendering %s with patch %c%03d \"%s\" at %.0f Hz (%s)\n",
+           midiFilename, 'A' + bank, patch, patchName, sampleRate,
+           logged ? "cycle exact" : "sub-blocks");
+
+    // render until the song is finished, thereafter the release phase
+    static float buffer[SID_NUM][RENDER_BLOCK_SIZE];
+    static short output[RENDER_BLOCK_SIZE * SID_NUM];
+    float *dst[SID_NUM];
+    for(int sid=0; sid<SID_NUM; ++sid)
+        dst[sid] = buffer[sid];
+
+    u32 numFrames = 0;
+    u32 tailFrames = (u32)(tailTime * sampleRate);
+    u32 endFrame = 0;
+    double t0 = timeGet();
+    while( !songFinished || numFrames < endFrame ) {
+        renderBlock(logged, sampleRate, dst, RENDER_BLOCK_SIZE);
+        numFrames += RENDER_BLOCK_SIZE;
+        if( !songFinished )
+            endFrame = numFrames + tailFrames;
+
+        if( wavFile ) {
+            short *out = output;
+            for(int i=0; i<RENDER_BLOCK_SIZE; ++i) {
+                for(int sid=0; sid<SID_NUM; ++sid) {
+                    float value = buffer[sid][i] * gain * 32767.0f;
+                    *out++ = (value >= 32767.0f) ? 32767 : ((value <= -32768.0f) ? -32768 : (short)value);
+                }
+            }
+
+            if( fwrite(output, sizeof(short), RENDER_BLOCK_SIZE * SID_NUM, wavFile) != RENDER_BLOCK_SIZE * SID_NUM ) {
+                fprintf(stderr, "ERROR: write to %s failed\n", wavFilename);
+                return 1;
+            }
+        }
+    }
+    double renderTime = timeGet() - t0;
+
+    if( wavFile ) {
+        if( wavHeaderWrite(wavFile, (u32)sampleRate, numFrames) < 0 ) {
+            fprintf(stderr, "ERROR: write to %s failed\n", wavFilename);
+            return 1;
+        }
+        fclose(wavFile);
+    }
+    fclose(midiFile);
+
+    unsigned overruns = 0;
+    for(int sid=0; sid<SID_NUM; ++sid) {
+        overruns += reSidRegLog[sid].overruns;
+        delete reSID[sid];
+    }
+
+    double audioTime = numFrames / sampleRate;
+    printf("%u MIDI events, %u engine updates, %.2f seconds audio rendered in %.3f seconds (%.1fx realtime)\n",
+           numEvents, numUpdates, audioTime, renderTime, (renderTime > 0.0) ? (audioTime / renderTime) : 0.0);
+    printf("Sound engine: %.3f seconds (%.1f uS per update), reSID: %.3f seconds\n",
+           engineTime, numUpdates ? (1E6 * engineTime / numUpdates) : 0.0, renderTime - engineTime);
+    printf("SID registers per update: %.2f checked, %.2f written (%d without dirty flags)\n",
+           numUpdates ? ((double)numRegsChecked / numUpdates) : 0.0,
+           numUpdates ? ((double)numRegsWritten / numUpdates) : 0.0,
+           (int)sizeof(update_order) * SID_NUM);
+    if( overruns )
+        printf("WARNING: %u register writes have been delayed by log overruns\n", overruns);
+
+    return 0;
+}
@@ -62,6 +62,7 @@ extern "C" {
 /////////////////////////////////////////////////////////////////////////////
 
 #include <mios32_irq.h>
+#include <mios32_ringbuffer.h>
 #include <mios32_sys.h>
 #include <mios32_spi.h>
 #include <mios32_srio.h>
@@ -30,6 +30,30 @@
 #endif
 
 
+// maximum number of interfaces which can be checked by MIOS32_MIDI_Receive_Handler()
+// (see MIOS32_MIDI_RxInterfaceAdd())
+#ifndef MIOS32_MIDI_RX_INTF_NUM
+#define MIOS32_MIDI_RX_INTF_NUM 16
+#endif
+
+// priority of the interfaces which are checked by default (0=highest, 255=lowest)
+#ifndef MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY
+#define MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY 8
+#endif
+
+// time budget of MIOS32_MIDI_Receive_Handler() in uS - once exceeded, the handler
+// returns to yield some CPU time for other tasks (0: no limit)
+#ifndef MIOS32_MIDI_RX_BUDGET_US
+#define MIOS32_MIDI_RX_BUDGET_US 200
+#endif
+
+// maximum number of ports which can be tapped for realtime messages
+// (see MIOS32_MIDI_RealtimeTap_Init())
+#ifndef MIOS32_MIDI_REALTIME_TAP_NUM
+#define MIOS32_MIDI_REALTIME_TAP_NUM 8
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Uses by MIOS32 SysEx parser
 /////////////////////////////////////////////////////////////////////////////
@@ -187,6 +211,19 @@ typedef enum {
   MIOS32_MIDI_SYSEX_CMD_STATE_END
 } mios32_midi_sysex_cmd_state_t;
 
+//! an interface which is checked by MIOS32_MIDI_Receive_Handler()
+typedef struct {
+  mios32_midi_port_t port;
+  u8 priority;
+  u8 weight;
+} mios32_midi_rx_intf_t;
+
+//! Rx/Tx buffer statistics of a MIDI port (see MIOS32_MIDI_BufferStatsGet())
+typedef struct {
+  mios32_ringbuffer_stats_t rx;
+  mios32_ringbuffer_stats_t tx;
+} mios32_midi_buffer_stats_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -200,6 +237,9 @@ extern s32 MIOS32_MIDI_RS_OptimisationSet(mios32_midi_port_t port, u8 enable);
 extern s32 MIOS32_MIDI_RS_OptimisationGet(mios32_midi_port_t port);
 extern s32 MIOS32_MIDI_RS_Reset(mios32_midi_port_t port);
 
+extern s32 MIOS32_MIDI_BufferStatsGet(mios32_midi_port_t port, mios32_midi_buffer_stats_t *stats);
+extern s32 MIOS32_MIDI_BufferStatsReset(mios32_midi_port_t port);
+
 extern s32 MIOS32_MIDI_SendPackage_NonBlocking(mios32_midi_port_t port, mios32_midi_package_t package);
 extern s32 MIOS32_MIDI_SendPackage(mios32_midi_port_t port, mios32_midi_package_t package);
 
@@ -229,6 +269,12 @@ extern s32 MIOS32_MIDI_SendDebugMessage(char *format, ...);
 extern s32 MIOS32_MIDI_SendDebugHexDump(u8 *src, u32 len);
 
 extern s32 MIOS32_MIDI_Receive_Handler(void *callback_event);
+extern s32 MIOS32_MIDI_RxInterfaceAdd(mios32_midi_port_t port, u8 priority, u8 weight);
+extern s32 MIOS32_MIDI_RxInterfaceRemove(mios32_midi_port_t port);
+extern s32 MIOS32_MIDI_RxInterfaceGet(u8 ix, mios32_midi_rx_intf_t *intf);
+extern s32 MIOS32_MIDI_RxInterfaceNumGet(void);
+extern s32 MIOS32_MIDI_RxBudgetSet(u16 budget_us);
+extern u16 MIOS32_MIDI_RxBudgetGet(void);
 
 extern s32 MIOS32_MIDI_Periodic_mS(void);
 
@@ -238,6 +284,9 @@ extern s32 MIOS32_MIDI_DirectRxCallback_Init(void *callback_rx);
 extern s32 MIOS32_MIDI_SendByteToRxCallback(mios32_midi_port_t port, u8 midi_byte);
 extern s32 MIOS32_MIDI_SendPackageToRxCallback(mios32_midi_port_t port, mios32_midi_package_t midi_package);
 
+extern s32 MIOS32_MIDI_RealtimeTap_Init(mios32_midi_port_t port, void *callback_realtime);
+extern u32 MIOS32_MIDI_TimestampGet(void);
+
 extern s32 MIOS32_MIDI_DefaultPortSet(mios32_midi_port_t port);
 extern mios32_midi_port_t MIOS32_MIDI_DefaultPortGet(void);
 
@@ -29,6 +29,23 @@
 #define MIOS32_OSC_MAX_ARGS 8
 #endif
 
+// OSC: node index which marks the root of a search table
+#define MIOS32_OSC_SEARCH_TABLE_ROOT 0xffff
+
+// OSC: maximum size of a bundle element which can be scheduled
+// (larger elements, e.g. SysEx blobs, are dispatched immediately)
+#ifndef MIOS32_OSC_SCHEDULER_ELEMENT_SIZE
+#define MIOS32_OSC_SCHEDULER_ELEMENT_SIZE 48
+#endif
+
+// OSC: default latency compensation of the scheduler in uS
+#ifndef MIOS32_OSC_SCHEDULER_DEFAULT_LATENCY_US
+#define MIOS32_OSC_SCHEDULER_DEFAULT_LATENCY_US 10000
+#endif
+
+// OSC: marks the end of a scheduler queue
+#define MIOS32_OSC_SCHEDULER_SLOT_NONE 0xff
+
 // the output function which is used to print debug messages
 // could be replaced by printf (e.g. for emulations)
 #ifndef MIOS32_OSC_DEBUG_MSG
@@ -48,6 +65,24 @@ typedef struct mios32_osc_search_tree_t {
 } mios32_osc_search_tree_t;
 
 
+//! entry of a compiled search table (see MIOS32_OSC_SearchTableCompile())
+typedef struct {
+  const mios32_osc_search_tree_t *node;  // node of the search tree, NULL if the slot is free
+  u16                            parent; // slot of the parent node, MIOS32_OSC_SEARCH_TABLE_ROOT for the first hierarchy level
+  u8                             hash;   // upper bits of the hash value, allows a quick check before the address part is compared
+  u8                             tree_search; // 1 if the next hierarchy level contains wildcards or duplicates: searched with the tree matcher
+} mios32_osc_search_table_entry_t;
+
+//! compiled search table, the slots are allocated by the application
+typedef struct {
+  mios32_osc_search_table_entry_t *slot;      // hash slots
+  u16                            num_slots;   // number of slots (power of two)
+  u16                            num_entries; // number of used slots
+  mios32_osc_search_tree_t       *search_tree; // the original search tree
+  u8                             tree_search; // 1 if the first hierarchy level has to be searched with the tree matcher
+} mios32_osc_search_table_t;
+
+
 typedef struct {
   u32 seconds;
   u32 fraction;
@@ -66,6 +101,49 @@ typedef struct {
 } mios32_osc_args_t;
 
 
+//! scheduler modes
+typedef enum {
+  MIOS32_OSC_SCHEDULER_MODE_OFF = 0,  // all bundles are dispatched immediately
+  MIOS32_OSC_SCHEDULER_MODE_RELATIVE, // the offset between remote and local clock is measured
+  MIOS32_OSC_SCHEDULER_MODE_ABSOLUTE  // the remote clock is synchronized to the local time
+} mios32_osc_scheduler_mode_t;
+
+//! a bundle element which waits for its due time
+typedef struct {
+  mios32_osc_timetag_t due;     // local time at which the element will be dispatched
+  mios32_osc_timetag_t timetag; // timetag of the bundle (forwarded to the method)
+  u16                  len;     // length of the element, 0 if the slot is free
+  u8                   next;    // next slot (queue sorted by due time, or free list)
+  u8                   element[MIOS32_OSC_SCHEDULER_ELEMENT_SIZE]; // copy of the element
+} mios32_osc_scheduler_slot_t;
+
+//! scheduler statistics
+typedef struct {
+  u32 queued;                // number of elements which have been queued
+  u32 immediate;             // number of elements without timetag (or timetag "immediately")
+  u32 late;                  // number of elements which arrived after their due time
+  u32 overflows;             // number of elements which didn't fit into the queue (dispatched immediately)
+  u32 max_late_us;           // maximum time an element arrived after its due time
+  u32 max_early_us;          // maximum time an element waited in the queue
+  u32 max_dispatch_delay_us; // maximum delay between due time and dispatching
+} mios32_osc_scheduler_stats_t;
+
+//! scheduler, the slots are allocated by the application
+typedef struct {
+  mios32_osc_scheduler_slot_t  *slot;      // queue slots
+  u8                           num_slots;  // number of slots (1..254)
+  u8                           head;       // slot with the earliest due time
+  u8                           free;       // first free slot
+  u8                           mode;       // mios32_osc_scheduler_mode_t
+  u8                           clock_offset_valid; // RELATIVE mode: clock offset has been measured
+  unsigned long long           clock_offset; // local time - remote time (32.32 fixed point, modulo 2^64)
+  u32                          latency_us; // latency compensation
+  mios32_osc_search_tree_t     *search_tree;  // search tree which is used to dispatch the elements
+  mios32_osc_search_table_t    *search_table; // optional search table (NULL: only the tree is used)
+  mios32_osc_scheduler_stats_t stats;
+} mios32_osc_scheduler_t;
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
 /////////////////////////////////////////////////////////////////////////////
@@ -105,6 +183,20 @@ extern u8 *MIOS32_OSC_PutMIDI(u8 *buffer, mios32_midi_package_t p);
 
 extern s32 MIOS32_OSC_ParsePacket(u8 *packet, u32 len, mios32_osc_search_tree_t *search_tree);
 
+extern s32 MIOS32_OSC_SearchTableCompile(mios32_osc_search_table_t *search_table, mios32_osc_search_table_entry_t *slots, u16 num_slots, mios32_osc_search_tree_t *search_tree);
+extern s32 MIOS32_OSC_ParsePacketTable(u8 *packet, u32 len, mios32_osc_search_table_t *search_table);
+
+extern s32 MIOS32_OSC_SchedulerInit(mios32_osc_scheduler_t *scheduler, mios32_osc_scheduler_slot_t *slots, u8 num_slots, mios32_osc_search_tree_t *search_tree, mios32_osc_search_table_t *search_table);
+extern s32 MIOS32_OSC_SchedulerModeSet(mios32_osc_scheduler_t *scheduler, mios32_osc_scheduler_mode_t mode);
+extern mios32_osc_scheduler_mode_t MIOS32_OSC_SchedulerModeGet(mios32_osc_scheduler_t *scheduler);
+extern s32 MIOS32_OSC_SchedulerLatencySet(mios32_osc_scheduler_t *scheduler, u32 latency_us);
+extern u32 MIOS32_OSC_SchedulerLatencyGet(mios32_osc_scheduler_t *scheduler);
+extern s32 MIOS32_OSC_SchedulerStatsGet(mios32_osc_scheduler_t *scheduler, mios32_osc_scheduler_stats_t *stats);
+extern s32 MIOS32_OSC_SchedulerStatsReset(mios32_osc_scheduler_t *scheduler);
+extern s32 MIOS32_OSC_SchedulerNumQueued(mios32_osc_scheduler_t *scheduler);
+extern s32 MIOS32_OSC_ParsePacketScheduled(u8 *packet, u32 len, mios32_osc_scheduler_t *scheduler, mios32_osc_timetag_t now);
+extern s32 MIOS32_OSC_SchedulerHandler(mios32_osc_scheduler_t *scheduler, mios32_osc_timetag_t now);
+
 extern s32 MIOS32_OSC_SendDebugMessage(mios32_osc_args_t *osc_args, u32 method_arg);
 
 
@@ -0,0 +1,69 @@
+// $Id$
+/*
+ * Header file for single-producer/single-consumer ring buffers
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _MIOS32_RINGBUFFER_H
+#define _MIOS32_RINGBUFFER_H
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+//! ring buffer control structure
+//! the buffer itself is allocated by the user, the structure only
+//! handles the slot indices
+typedef struct {
+  volatile u16 head;      // next slot which will be written (only changed by producer)
+  volatile u16 tail;      // next slot which will be read (only changed by consumer)
+  u16 size;               // number of slots (one of them is always kept free)
+  volatile u16 max_used;  // high-water mark (updated by producer)
+  volatile u32 overruns;  // number of items which have been dropped
+} mios32_ringbuffer_t;
+
+//! statistics of a ring buffer
+typedef struct {
+  u16 size;       // usable number of slots
+  u16 max_used;   // high-water mark
+  u32 overruns;   // number of items which have been dropped
+} mios32_ringbuffer_stats_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 MIOS32_RINGBUFFER_Init(mios32_ringbuffer_t *rb, u16 size);
+
+extern s32 MIOS32_RINGBUFFER_Used(mios32_ringbuffer_t *rb);
+extern s32 MIOS32_RINGBUFFER_Free(mios32_ringbuffer_t *rb);
+
+extern s32 MIOS32_RINGBUFFER_Reserve(mios32_ringbuffer_t *rb, u16 len);
+extern s32 MIOS32_RINGBUFFER_Commit(mios32_ringbuffer_t *rb, u16 len);
+extern s32 MIOS32_RINGBUFFER_Peek(mios32_ringbuffer_t *rb);
+extern s32 MIOS32_RINGBUFFER_Release(mios32_ringbuffer_t *rb, u16 len);
+extern s32 MIOS32_RINGBUFFER_NextIx(mios32_ringbuffer_t *rb, u16 ix);
+
+extern s32 MIOS32_RINGBUFFER_OverrunNotify(mios32_ringbuffer_t *rb);
+extern s32 MIOS32_RINGBUFFER_StatsGet(mios32_ringbuffer_t *rb, mios32_ringbuffer_stats_t *stats);
+extern s32 MIOS32_RINGBUFFER_StatsReset(mios32_ringbuffer_t *rb);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+#endif /* _MIOS32_RINGBUFFER_H */
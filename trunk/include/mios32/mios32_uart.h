@@ -29,6 +29,8 @@
 #endif
 
 // Tx buffer size (1..256)
+// Note: the Rx buffers are accessed lock-free, but all interrupts are still
+// disabled (MIOS32_IRQ_Disable) while bytes are put into a Tx buffer
 #ifndef MIOS32_UART_TX_BUFFER_SIZE
 #define MIOS32_UART_TX_BUFFER_SIZE 64
 #endif
@@ -116,6 +118,9 @@ extern s32 MIOS32_UART_TxBufferPut(u8 uart, u8 b);
 extern s32 MIOS32_UART_TxBufferPutMore_NonBlocking(u8 uart, u8 *buffer, u16 len);
 extern s32 MIOS32_UART_TxBufferPutMore(u8 uart, u8 *buffer, u16 len);
 
+extern s32 MIOS32_UART_BufferStatsGet(u8 uart, mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats);
+extern s32 MIOS32_UART_BufferStatsReset(u8 uart);
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Export global variables
@@ -29,6 +29,9 @@
 #endif
 
 // buffer size (should be at least >= MIOS32_USB_MIDI_DESC_DATA_*_SIZE/4)
+// Note: the Rx buffer is read lock-free, but all interrupts are still disabled
+// (MIOS32_IRQ_Disable) while a package is put into the Tx buffer, and while
+// the buffer handlers are called from task level
 #ifndef MIOS32_USB_MIDI_RX_BUFFER_SIZE
 #define MIOS32_USB_MIDI_RX_BUFFER_SIZE   64 // packages
 #endif
@@ -63,6 +66,9 @@ extern s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package
 extern s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package);
 extern s32 MIOS32_USB_MIDI_PackageReceive(mios32_midi_package_t *package);
 
+extern s32 MIOS32_USB_MIDI_BufferStatsGet(mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats);
+extern s32 MIOS32_USB_MIDI_BufferStatsReset(void);
+
 extern s32 MIOS32_USB_MIDI_Periodic_mS(void);
 
 
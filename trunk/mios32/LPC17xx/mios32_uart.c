@@ -502,4 +502,49 @@ s32 MIOS32_UART_TxBufferPut(u8 uart, u8 b)
   return error;
 }
 
+
+/////////////////////////////////////////////////////////////////////////////
+//! returns the statistics of the receive and transmit buffer
+//! \param[in] uart UART number (0..2)
+//! \param[out] rx_stats pointer to Rx buffer statistics (can be NULL)
+//! \param[out] tx_stats pointer to Tx buffer statistics (can be NULL)
+//! \return -1 if UART not available
+//! \return -3 not supported by LPC based UART, since it doesn't use software buffers
+//! \note Applications shouldn't call these functions directly, instead please use \ref MIOS32_COM or \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_UART_BufferStatsGet(u8 uart, mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats)
+{
+#if MIOS32_UART_NUM == 0
+  return -1; // no UART available
+#else
+  if( uart >= MIOS32_UART_NUM )
+    return -1; // UART not available
+
+  // not supported by LPC based UART
+  return -3;
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! resets the high-water marks and overrun counters of the receive and
+//! transmit buffer
+//! \param[in] uart UART number (0..2)
+//! \return -1 if UART not available
+//! \return -3 not supported by LPC based UART, since it doesn't use software buffers
+//! \note Applications shouldn't call these functions directly, instead please use \ref MIOS32_COM or \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_UART_BufferStatsReset(u8 uart)
+{
+#if MIOS32_UART_NUM == 0
+  return -1; // no UART available
+#else
+  if( uart >= MIOS32_UART_NUM )
+    return -1; // UART not available
+
+  // not supported by LPC based UART
+  return -3;
+#endif
+}
+
 #endif /* MIOS32_DONT_USE_UART */
@@ -31,6 +31,8 @@
 
 static void MIOS32_USB_MIDI_TxBufferHandler(u8 bEP);
 static void MIOS32_USB_MIDI_RxBufferHandler(u8 bEP);
+static void MIOS32_USB_MIDI_Periodic_TxBufferHandler(u8 bEP);
+static void MIOS32_USB_MIDI_Periodic_RxBufferHandler(u8 bEP);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -39,15 +41,11 @@ static void MIOS32_USB_MIDI_RxBufferHandler(u8 bEP);
 
 // Rx buffer
 static u32 rx_buffer[MIOS32_USB_MIDI_RX_BUFFER_SIZE];
-static volatile u16 rx_buffer_tail;
-static volatile u16 rx_buffer_head;
-static volatile u16 rx_buffer_size;
+static mios32_ringbuffer_t rx_rb;
 
 // Tx buffer
 static u32 tx_buffer[MIOS32_USB_MIDI_TX_BUFFER_SIZE];
-static volatile u16 tx_buffer_tail;
-static volatile u16 tx_buffer_head;
-static volatile u16 tx_buffer_size;
+static mios32_ringbuffer_t tx_rb;
 
 // transfer possible?
 static u8 transfer_possible = 0;
@@ -102,8 +100,8 @@ s32 MIOS32_USB_MIDI_ChangeConnectionState(u8 connected)
 {
   // in all cases: re-initialize USB MIDI driver
   // clear buffer counters and busy/wait signals again (e.g., so that no invalid data will be sent out)
-  rx_buffer_tail = rx_buffer_head = rx_buffer_size = 0;
-  tx_buffer_tail = tx_buffer_head = tx_buffer_size = 0;
+  MIOS32_RINGBUFFER_Init(&rx_rb, MIOS32_USB_MIDI_RX_BUFFER_SIZE);
+  MIOS32_RINGBUFFER_Init(&tx_rb, MIOS32_USB_MIDI_TX_BUFFER_SIZE);
 
   if( connected ) {
     transfer_possible = 1;
@@ -145,10 +143,16 @@ s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package)
     return -1;
 
   // buffer full?
-  if( tx_buffer_size >= (MIOS32_USB_MIDI_TX_BUFFER_SIZE-1) ) {
+  // the buffer can be written by multiple tasks: reserve and commit have to be atomic
+  // (only the Rx buffer is accessed lock-free)
+  MIOS32_IRQ_Disable();
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Reserve(&tx_rb, 1)) < 0 ) {
+    MIOS32_IRQ_Enable();
+
     // call USB handler, so that we are able to get the buffer free again on next execution
     // (this call simplifies polling loops!)
-    MIOS32_USB_MIDI_TxBufferHandler(0x81);
+    MIOS32_USB_MIDI_Periodic_TxBufferHandler(0x81);
 
     // device still available?
     // (ensures that polling loop terminates if cable has been disconnected)
@@ -159,12 +163,9 @@ s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package)
     return -2;
   }
 
-  // put package into buffer - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  tx_buffer[tx_buffer_head++] = package.ALL;
-  if( tx_buffer_head >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-    tx_buffer_head = 0;
-  ++tx_buffer_size;
+  // put package into buffer
+  tx_buffer[ix] = package.ALL;
+  MIOS32_RINGBUFFER_Commit(&tx_rb, 1);
   MIOS32_IRQ_Enable();
 
   return 0;
@@ -199,6 +200,8 @@ s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
 
   if( error >= 0 ) // no error: reset timeout counter
     timeout_ctr = 0;
+  else if( error == -2 ) // package dropped
+    MIOS32_RINGBUFFER_OverrunNotify(&tx_rb);
 
   return error;
 }
@@ -214,21 +217,48 @@ s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
 s32 MIOS32_USB_MIDI_PackageReceive(mios32_midi_package_t *package)
 {
   // package received?
-  if( !rx_buffer_size )
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Peek(&rx_rb)) < 0 )
     return -1;
 
-  // get package - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  package->ALL = rx_buffer[rx_buffer_tail];
-  if( ++rx_buffer_tail >= MIOS32_USB_MIDI_RX_BUFFER_SIZE )
-    rx_buffer_tail = 0;
-  --rx_buffer_size;
-  MIOS32_IRQ_Enable();
+  // get package (lock-free, the buffer is written by the USB interrupt)
+  package->ALL = rx_buffer[ix];
+  return MIOS32_RINGBUFFER_Release(&rx_rb, 1);
+}
 
-  return rx_buffer_size;
+
+/////////////////////////////////////////////////////////////////////////////
+//! This function returns the statistics of the Rx and Tx buffer
+//! \param[out] rx_stats pointer to Rx buffer statistics (can be NULL)
+//! \param[out] tx_stats pointer to Tx buffer statistics (can be NULL)
+//! \return < 0 on errors
+//! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_USB_MIDI_BufferStatsGet(mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats)
+{
+  if( rx_stats != NULL )
+    MIOS32_RINGBUFFER_StatsGet(&rx_rb, rx_stats);
+  if( tx_stats != NULL )
+    MIOS32_RINGBUFFER_StatsGet(&tx_rb, tx_stats);
+
+  return 0; // no error
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! This function resets the high-water marks and overrun counters of the
+//! Rx and Tx buffer
+//! \return < 0 on errors
+//! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_USB_MIDI_BufferStatsReset(void)
+{
+  MIOS32_RINGBUFFER_StatsReset(&rx_rb);
+  MIOS32_RINGBUFFER_StatsReset(&tx_rb);
+
+  return 0; // no error
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! This function should be called periodically each mS to handle timeout
@@ -245,15 +275,36 @@ s32 MIOS32_USB_MIDI_PackageReceive(mios32_midi_package_t *package)
 s32 MIOS32_USB_MIDI_Periodic_mS(void)
 {
   // check for received packages
-  MIOS32_USB_MIDI_RxBufferHandler(0x01);
+  MIOS32_USB_MIDI_Periodic_RxBufferHandler(0x01);
   
   // check for packages which should be transmitted
-  MIOS32_USB_MIDI_TxBufferHandler(0x81);
+  MIOS32_USB_MIDI_Periodic_TxBufferHandler(0x81);
 
   return 0;
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// The buffer handlers are called from the USB interrupt and from task level.
+// At task level they could also be called from different tasks at the same
+// time (MIOS32_USB_MIDI_Periodic_mS() and MIOS32_USB_MIDI_PackageSend_NonBlocking()),
+// accordingly all interrupts have to be disabled while the endpoint is accessed.
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_USB_MIDI_Periodic_TxBufferHandler(u8 bEP)
+{
+  MIOS32_IRQ_Disable();
+  MIOS32_USB_MIDI_TxBufferHandler(bEP);
+  MIOS32_IRQ_Enable();
+}
+
+static void MIOS32_USB_MIDI_Periodic_RxBufferHandler(u8 bEP)
+{
+  MIOS32_IRQ_Disable();
+  MIOS32_USB_MIDI_RxBufferHandler(bEP);
+  MIOS32_IRQ_Enable();
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // This handler sends the new packages through the IN pipe if the buffer 
 // is not empty
@@ -265,9 +316,9 @@ static void MIOS32_USB_MIDI_TxBufferHandler(u8 bEP)
   //   - new packages are in the buffer
   //   - the device is configured
 
-  // atomic operation to avoid conflict with other interrupts
-  MIOS32_IRQ_Disable();
-  if( !tx_buffer_busy && tx_buffer_size && transfer_possible ) {
+  s32 ix;
+  if( !tx_buffer_busy && transfer_possible && (ix=MIOS32_RINGBUFFER_Peek(&tx_rb)) >= 0 ) {
+    s32 tx_buffer_size = MIOS32_RINGBUFFER_Used(&tx_rb);
     s16 count = (tx_buffer_size > (MIOS32_USB_MIDI_DATA_IN_SIZE/4)) ? (MIOS32_USB_MIDI_DATA_IN_SIZE/4) : tx_buffer_size;
 
     // from USBHwEPWrite
@@ -282,23 +333,20 @@ static void MIOS32_USB_MIDI_TxBufferHandler(u8 bEP)
     int real_count = 0;
     while( count && (LPC_USB->USBCtrl & WR_EN) ) {
       ++real_count;
-      LPC_USB->USBTxData = tx_buffer[tx_buffer_tail];
-      if( ++tx_buffer_tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-	tx_buffer_tail = 0;
+      LPC_USB->USBTxData = tx_buffer[ix];
+      ix = MIOS32_RINGBUFFER_NextIx(&tx_rb, ix);
     }
 
     // notify that new package is sent
     tx_buffer_busy = 1;
 
     // send to IN pipe
-    tx_buffer_size -= real_count;
+    MIOS32_RINGBUFFER_Release(&tx_rb, real_count);
 
     // select endpoint and validate buffer
     USBHwCmd(CMD_EP_SELECT | EP2IDX(bEP));
     USBHwCmd(CMD_EP_VALIDATE_BUFFER);
   }
-
-  MIOS32_IRQ_Enable();
 }
 
 
@@ -307,9 +355,6 @@ static void MIOS32_USB_MIDI_TxBufferHandler(u8 bEP)
 /////////////////////////////////////////////////////////////////////////////
 static void MIOS32_USB_MIDI_RxBufferHandler(u8 bEP)
 {
-  // atomic operation to avoid conflict with other interrupts
-  MIOS32_IRQ_Disable();
-
   // from USBHwEPRead
 
   // set read enable bit for specific endpoint
@@ -328,7 +373,9 @@ static void MIOS32_USB_MIDI_RxBufferHandler(u8 bEP)
     s16 count = (dwLen & PKT_LNGTH_MASK) >> 2;
 
     // check if buffer is free
-    if( count && count < (MIOS32_USB_MIDI_RX_BUFFER_SIZE-rx_buffer_size) ) {
+    s32 ix;
+    if( count && (ix=MIOS32_RINGBUFFER_Reserve(&rx_rb, count)) >= 0 ) {
+      u16 num_packages = 0;
 
       while( count-- > 0 ) {
 	// copy received packages into receive buffer
@@ -336,14 +383,16 @@ static void MIOS32_USB_MIDI_RxBufferHandler(u8 bEP)
 	package.ALL = LPC_USB->USBRxData;
 
 	if( MIOS32_MIDI_SendPackageToRxCallback(USB0 + package.cable, package) == 0 ) {
-	  rx_buffer[rx_buffer_head] = package.ALL;
-
-	  if( ++rx_buffer_head >= MIOS32_USB_MIDI_RX_BUFFER_SIZE )
-	    rx_buffer_head = 0;
-	  ++rx_buffer_size;
+	  rx_buffer[ix] = package.ALL;
+	  ix = MIOS32_RINGBUFFER_NextIx(&rx_rb, ix);
+	  ++num_packages;
 	}
       }
 
+      // take over packages
+      if( num_packages )
+	MIOS32_RINGBUFFER_Commit(&rx_rb, num_packages);
+
       // make sure RD_EN is clear
       LPC_USB->USBCtrl = 0;
 
@@ -355,8 +404,6 @@ static void MIOS32_USB_MIDI_RxBufferHandler(u8 bEP)
 
   // make sure RD_EN is clear
   LPC_USB->USBCtrl = 0;
-
-  MIOS32_IRQ_Enable();
 }
 
 
@@ -154,3 +154,41 @@ s32 MIOS32_MIDI_SendReset(mios32_midi_port_t port)
 	return 0; //todo
 }
 
+// the statistics are taken from the emulated UART and USB MIDI buffers
+// (the default port is mapped to USB0 like in MIOS32_MIDI)
+s32 MIOS32_MIDI_BufferStatsGet(mios32_midi_port_t port, mios32_midi_buffer_stats_t *stats)
+{
+	if( !(port & 0xf0) )
+		port = USB0;
+
+	switch( port & 0xf0 ) {
+		case USB0:
+			return MIOS32_USB_MIDI_BufferStatsGet(&stats->rx, &stats->tx);
+
+		case UART0:
+			return MIOS32_UART_BufferStatsGet(port & 0xf, &stats->rx, &stats->tx);
+	}
+
+	return -1; // not supported by JUCE
+}
+
+s32 MIOS32_MIDI_BufferStatsReset(mios32_midi_port_t port)
+{
+	if( !(port & 0xf0) )
+		port = USB0;
+
+	switch( port & 0xf0 ) {
+		case USB0:
+			return MIOS32_USB_MIDI_BufferStatsReset();
+
+		case UART0:
+			return MIOS32_UART_BufferStatsReset(port & 0xf);
+	}
+
+	return -1; // not supported by JUCE
+}
+
+s32 MIOS32_MIDI_RealtimeTap_Init(mios32_midi_port_t port, void *callback_realtime)
+{
+	return -1; // not supported by JUCE
+}
@@ -54,14 +54,10 @@
 
 #if MIOS32_UART_NUM >= 1
 static u8 rx_buffer[MIOS32_UART_NUM][MIOS32_UART_RX_BUFFER_SIZE];
-static volatile u8 rx_buffer_tail[MIOS32_UART_NUM];
-static volatile u8 rx_buffer_head[MIOS32_UART_NUM];
-static volatile u8 rx_buffer_size[MIOS32_UART_NUM];
+static mios32_ringbuffer_t rx_rb[MIOS32_UART_NUM];
 
 static u8 tx_buffer[MIOS32_UART_NUM][MIOS32_UART_TX_BUFFER_SIZE];
-static volatile u8 tx_buffer_tail[MIOS32_UART_NUM];
-static volatile u8 tx_buffer_head[MIOS32_UART_NUM];
-static volatile u8 tx_buffer_size[MIOS32_UART_NUM];
+static mios32_ringbuffer_t tx_rb[MIOS32_UART_NUM];
 #endif
 
 
@@ -160,12 +156,14 @@ s32 MIOS32_UART_Init(u32 mode)
   //USART_ITConfig(MIOS32_UART1, USART_IT_RXNE, ENABLE);
 //#endif
 
-  //// clear buffer counters
-  //int i;
-  //for(i=0; i<MIOS32_UART_NUM; ++i) {
-    //rx_buffer_tail[i] = rx_buffer_head[i] = rx_buffer_size[i] = 0;
-    //tx_buffer_tail[i] = tx_buffer_head[i] = tx_buffer_size[i] = 0;
-  //}
+  // clear buffer counters
+#if MIOS32_UART_NUM >= 1
+  int i;
+  for(i=0; i<MIOS32_UART_NUM; ++i) {
+    MIOS32_RINGBUFFER_Init(&rx_rb[i], MIOS32_UART_RX_BUFFER_SIZE);
+    MIOS32_RINGBUFFER_Init(&tx_rb[i], MIOS32_UART_TX_BUFFER_SIZE);
+  }
+#endif
 
   //// enable UARTs
   //USART_Cmd(MIOS32_UART0, ENABLE);
@@ -193,7 +191,7 @@ s32 MIOS32_UART_RxBufferFree(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return 0;
   else
-    return MIOS32_UART_RX_BUFFER_SIZE - rx_buffer_size[uart];
+    return MIOS32_RINGBUFFER_Free(&rx_rb[uart]);
 #endif
 }
 
@@ -213,7 +211,7 @@ s32 MIOS32_UART_RxBufferUsed(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return 0;
   else
-    return rx_buffer_size[uart];
+    return MIOS32_RINGBUFFER_Used(&rx_rb[uart]);
 #endif
 }
 
@@ -234,16 +232,13 @@ s32 MIOS32_UART_RxBufferGet(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return -1; // UART not available
 
-  if( !rx_buffer_size[uart] )
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Peek(&rx_rb[uart])) < 0 )
     return -2; // nothing new in buffer
 
-  // get byte - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  u8 b = rx_buffer[uart][rx_buffer_tail[uart]];
-  if( ++rx_buffer_tail[uart] >= MIOS32_UART_RX_BUFFER_SIZE )
-    rx_buffer_tail[uart] = 0;
-  --rx_buffer_size[uart];
-  MIOS32_IRQ_Enable();
+  // get byte (lock-free, the buffer is written by the UART interrupt)
+  u8 b = rx_buffer[uart][ix];
+  MIOS32_RINGBUFFER_Release(&rx_rb[uart], 1);
 
   return b; // return received byte
 #endif
@@ -266,13 +261,12 @@ s32 MIOS32_UART_RxBufferPeek(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return -1; // UART not available
 
-  if( !rx_buffer_size[uart] )
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Peek(&rx_rb[uart])) < 0 )
     return -2; // nothing new in buffer
 
-  // get byte - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  u8 b = rx_buffer[uart][rx_buffer_tail[uart]];
-  MIOS32_IRQ_Enable();
+  // get byte without taking it
+  u8 b = rx_buffer[uart][ix];
 
   return b; // return received byte
 #endif
@@ -296,17 +290,16 @@ s32 MIOS32_UART_RxBufferPut(u8 uart, u8 b)
   if( uart >= MIOS32_UART_NUM )
     return -1; // UART not available
 
-  if( rx_buffer_size[uart] >= MIOS32_UART_RX_BUFFER_SIZE )
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Reserve(&rx_rb[uart], 1)) < 0 ) {
+    MIOS32_RINGBUFFER_OverrunNotify(&rx_rb[uart]);
     return -2; // buffer full (retry)
+  }
 
   // copy received byte into receive buffer
-  // this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  rx_buffer[uart][rx_buffer_head[uart]] = b;
-  if( ++rx_buffer_head[uart] >= MIOS32_UART_RX_BUFFER_SIZE )
-    rx_buffer_head[uart] = 0;
-  ++rx_buffer_size[uart];
-  MIOS32_IRQ_Enable();
+  // (lock-free, the buffer is read at task level)
+  rx_buffer[uart][ix] = b;
+  MIOS32_RINGBUFFER_Commit(&rx_rb[uart], 1);
 
   return 0; // no error
 #endif
@@ -328,7 +321,7 @@ s32 MIOS32_UART_TxBufferFree(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return 0;
   else
-    return MIOS32_UART_TX_BUFFER_SIZE - tx_buffer_size[uart];
+    return MIOS32_RINGBUFFER_Free(&tx_rb[uart]);
 #endif
 }
 
@@ -348,7 +341,7 @@ s32 MIOS32_UART_TxBufferUsed(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return 0;
   else
-    return tx_buffer_size[uart];
+    return MIOS32_RINGBUFFER_Used(&tx_rb[uart]);
 #endif
 }
 
@@ -369,16 +362,13 @@ s32 MIOS32_UART_TxBufferGet(u8 uart)
   if( uart >= MIOS32_UART_NUM )
     return -1; // UART not available
 
-  if( !tx_buffer_size[uart] )
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Peek(&tx_rb[uart])) < 0 )
     return -2; // nothing new in buffer
 
-  // get byte - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  u8 b = tx_buffer[uart][tx_buffer_tail[uart]];
-  if( ++tx_buffer_tail[uart] >= MIOS32_UART_TX_BUFFER_SIZE )
-    tx_buffer_tail[uart] = 0;
-  --tx_buffer_size[uart];
-  MIOS32_IRQ_Enable();
+  // get byte (called from the UART interrupt, the buffer is written with disabled interrupts)
+  u8 b = tx_buffer[uart][ix];
+  MIOS32_RINGBUFFER_Release(&tx_rb[uart], 1);
 
   return b; // return transmitted byte
 #endif
@@ -404,27 +394,33 @@ s32 MIOS32_UART_TxBufferPutMore_NonBlocking(u8 uart, u8 *buffer, u16 len)
   if( uart >= MIOS32_UART_NUM )
     return -1; // UART not available
 
-  if( (tx_buffer_size[uart]+len) >= MIOS32_UART_TX_BUFFER_SIZE )
+  // the buffer can be written by multiple tasks: reserve, copy and commit
+  // have to be atomic (only the Rx buffers are accessed lock-free)
+  MIOS32_IRQ_Disable();
+
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Reserve(&tx_rb[uart], len)) < 0 ) {
+    MIOS32_IRQ_Enable();
     return -2; // buffer full or cannot get all requested bytes (retry)
+  }
 
-  // copy bytes to be transmitted into transmit buffer
-  // this operation should be atomic!
-  MIOS32_IRQ_Disable();
+  // the Tx interrupt has to be enabled if the buffer was empty
+  u8 was_empty = MIOS32_RINGBUFFER_Used(&tx_rb[uart]) == 0;
 
+  // copy bytes to be transmitted into transmit buffer
+  // the bytes are taken over at once, so that they are sent atomically
   u16 i;
   for(i=0; i<len; ++i) {
-    tx_buffer[uart][tx_buffer_head[uart]] = *buffer++;
-
-    if( ++tx_buffer_head[uart] >= MIOS32_UART_TX_BUFFER_SIZE )
-      tx_buffer_head[uart] = 0;
-
-    // enable Tx interrupt if buffer was empty
-    if( ++tx_buffer_size[uart] == 1 ) {
-      switch( uart ) {
-        //case 0: MIOS32_UART0->CR1 |= (1 << 7); break; // enable TXE interrupt (TXEIE=1)
-        //case 1: MIOS32_UART1->CR1 |= (1 << 7); break; // enable TXE interrupt (TXEIE=1)
-        default: MIOS32_IRQ_Enable(); return -3; // uart not supported by routine (yet)
-      }
+    tx_buffer[uart][ix] = *buffer++;
+    ix = MIOS32_RINGBUFFER_NextIx(&tx_rb[uart], ix);
+  }
+  MIOS32_RINGBUFFER_Commit(&tx_rb[uart], len);
+
+  if( was_empty ) {
+    switch( uart ) {
+      //case 0: MIOS32_UART0->CR1 |= (1 << 7); break; // enable TXE interrupt (TXEIE=1)
+      //case 1: MIOS32_UART1->CR1 |= (1 << 7); break; // enable TXE interrupt (TXEIE=1)
+      default: MIOS32_IRQ_Enable(); return -3; // uart not supported by routine (yet)
     }
   }
 
@@ -493,6 +489,57 @@ s32 MIOS32_UART_TxBufferPut(u8 uart, u8 b)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! returns the statistics of the receive and transmit buffer
+//! \param[in] uart UART number (0..1)
+//! \param[out] rx_stats pointer to Rx buffer statistics (can be NULL)
+//! \param[out] tx_stats pointer to Tx buffer statistics (can be NULL)
+//! \return 0 if no error
+//! \return -1 if UART not available
+//! \note Applications shouldn't call these functions directly, instead please use \ref MIOS32_COM or \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_UART_BufferStatsGet(u8 uart, mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats)
+{
+#if MIOS32_UART_NUM == 0
+  return -1; // no UART available
+#else
+  if( uart >= MIOS32_UART_NUM )
+    return -1; // UART not available
+
+  if( rx_stats != NULL )
+    MIOS32_RINGBUFFER_StatsGet(&rx_rb[uart], rx_stats);
+  if( tx_stats != NULL )
+    MIOS32_RINGBUFFER_StatsGet(&tx_rb[uart], tx_stats);
+
+  return 0; // no error
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! resets the high-water marks and overrun counters of the receive and
+//! transmit buffer
+//! \param[in] uart UART number (0..1)
+//! \return 0 if no error
+//! \return -1 if UART not available
+//! \note Applications shouldn't call these functions directly, instead please use \ref MIOS32_COM or \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_UART_BufferStatsReset(u8 uart)
+{
+#if MIOS32_UART_NUM == 0
+  return -1; // no UART available
+#else
+  if( uart >= MIOS32_UART_NUM )
+    return -1; // UART not available
+
+  MIOS32_RINGBUFFER_StatsReset(&rx_rb[uart]);
+  MIOS32_RINGBUFFER_StatsReset(&tx_rb[uart]);
+
+  return 0; // no error
+#endif
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Interrupt handler for first UART
 /////////////////////////////////////////////////////////////////////////////
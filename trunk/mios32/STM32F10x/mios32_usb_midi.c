@@ -30,12 +30,15 @@
 extern USB_OTG_CORE_REGS USB_OTG_FS_regs;
 #endif
 
+
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
 /////////////////////////////////////////////////////////////////////////////
 
 static void MIOS32_USB_MIDI_TxBufferHandler(void);
 static void MIOS32_USB_MIDI_RxBufferHandler(void);
+static void MIOS32_USB_MIDI_Periodic_TxBufferHandler(void);
+static void MIOS32_USB_MIDI_Periodic_RxBufferHandler(void);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -44,16 +47,12 @@ static void MIOS32_USB_MIDI_RxBufferHandler(void);
 
 // Rx buffer
 static u32 rx_buffer[MIOS32_USB_MIDI_RX_BUFFER_SIZE];
-static volatile u16 rx_buffer_tail;
-static volatile u16 rx_buffer_head;
-static volatile u16 rx_buffer_size;
+static mios32_ringbuffer_t rx_rb;
 static volatile u8 rx_buffer_new_data;
 
 // Tx buffer
 static u32 tx_buffer[MIOS32_USB_MIDI_TX_BUFFER_SIZE];
-static volatile u16 tx_buffer_tail;
-static volatile u16 tx_buffer_head;
-static volatile u16 tx_buffer_size;
+static mios32_ringbuffer_t tx_rb;
 static volatile u8 tx_buffer_busy;
 
 // transfer possible?
@@ -86,9 +85,9 @@ s32 MIOS32_USB_MIDI_ChangeConnectionState(u8 connected)
 {
   // in all cases: re-initialize USB MIDI driver
   // clear buffer counters and busy/wait signals again (e.g., so that no invalid data will be sent out)
-  rx_buffer_tail = rx_buffer_head = rx_buffer_size = 0;
+  MIOS32_RINGBUFFER_Init(&rx_rb, MIOS32_USB_MIDI_RX_BUFFER_SIZE);
   rx_buffer_new_data = 0; // no data received yet
-  tx_buffer_tail = tx_buffer_head = tx_buffer_size = 0;
+  MIOS32_RINGBUFFER_Init(&tx_rb, MIOS32_USB_MIDI_TX_BUFFER_SIZE);
 
   if( connected ) {
     transfer_possible = 1;
@@ -130,10 +129,16 @@ s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package)
     return -1;
 
   // buffer full?
-  if( tx_buffer_size >= (MIOS32_USB_MIDI_TX_BUFFER_SIZE-1) ) {
+  // the buffer can be written by multiple tasks: reserve and commit have to be atomic
+  // (only the Rx buffer is accessed lock-free)
+  MIOS32_IRQ_Disable();
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Reserve(&tx_rb, 1)) < 0 ) {
+    MIOS32_IRQ_Enable();
+
     // call USB handler, so that we are able to get the buffer free again on next execution
     // (this call simplifies polling loops!)
-    MIOS32_USB_MIDI_TxBufferHandler();
+    MIOS32_USB_MIDI_Periodic_TxBufferHandler();
 
     // device still available?
     // (ensures that polling loop terminates if cable has been disconnected)
@@ -144,12 +149,9 @@ s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package)
     return -2;
   }
 
-  // put package into buffer - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  tx_buffer[tx_buffer_head++] = package.ALL;
-  if( tx_buffer_head >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-    tx_buffer_head = 0;
-  ++tx_buffer_size;
+  // put package into buffer
+  tx_buffer[ix] = package.ALL;
+  MIOS32_RINGBUFFER_Commit(&tx_rb, 1);
   MIOS32_IRQ_Enable();
 
   return 0;
@@ -184,6 +186,8 @@ s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
 
   if( error >= 0 ) // no error: reset timeout counter
     timeout_ctr = 0;
+  else if( error == -2 ) // package dropped
+    MIOS32_RINGBUFFER_OverrunNotify(&tx_rb);
 
   return error;
 }
@@ -199,21 +203,48 @@ s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package)
 s32 MIOS32_USB_MIDI_PackageReceive(mios32_midi_package_t *package)
 {
   // package received?
-  if( !rx_buffer_size )
+  s32 ix;
+  if( (ix=MIOS32_RINGBUFFER_Peek(&rx_rb)) < 0 )
     return -1;
 
-  // get package - this operation should be atomic!
-  MIOS32_IRQ_Disable();
-  package->ALL = rx_buffer[rx_buffer_tail];
-  if( ++rx_buffer_tail >= MIOS32_USB_MIDI_RX_BUFFER_SIZE )
-    rx_buffer_tail = 0;
-  --rx_buffer_size;
-  MIOS32_IRQ_Enable();
+  // get package (lock-free, the buffer is written by the USB interrupt)
+  package->ALL = rx_buffer[ix];
+  return MIOS32_RINGBUFFER_Release(&rx_rb, 1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! This function returns the statistics of the Rx and Tx buffer
+//! \param[out] rx_stats pointer to Rx buffer statistics (can be NULL)
+//! \param[out] tx_stats pointer to Tx buffer statistics (can be NULL)
+//! \return < 0 on errors
+//! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_USB_MIDI_BufferStatsGet(mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats)
+{
+  if( rx_stats != NULL )
+    MIOS32_RINGBUFFER_StatsGet(&rx_rb, rx_stats);
+  if( tx_stats != NULL )
+    MIOS32_RINGBUFFER_StatsGet(&tx_rb, tx_stats);
 
-  return rx_buffer_size;
+  return 0; // no error
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! This function resets the high-water marks and overrun counters of the
+//! Rx and Tx buffer
+//! \return < 0 on errors
+//! \note Applications shouldn't call this function directly, instead please use \ref MIOS32_MIDI layer functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_USB_MIDI_BufferStatsReset(void)
+{
+  MIOS32_RINGBUFFER_StatsReset(&rx_rb);
+  MIOS32_RINGBUFFER_StatsReset(&tx_rb);
+
+  return 0; // no error
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! This function should be called periodically each mS to handle timeout
@@ -230,15 +261,36 @@ s32 MIOS32_USB_MIDI_PackageReceive(mios32_midi_package_t *package)
 s32 MIOS32_USB_MIDI_Periodic_mS(void)
 {
   // check for received packages
-  MIOS32_USB_MIDI_RxBufferHandler();
+  MIOS32_USB_MIDI_Periodic_RxBufferHandler();
 
   // check for packages which should be transmitted
-  MIOS32_USB_MIDI_TxBufferHandler();
+  MIOS32_USB_MIDI_Periodic_TxBufferHandler();
 
   return 0;
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// The buffer handlers are called from the USB interrupt and from task level.
+// At task level they could also be called from different tasks at the same
+// time (MIOS32_USB_MIDI_Periodic_mS() and MIOS32_USB_MIDI_PackageSend_NonBlocking()),
+// accordingly all interrupts have to be disabled while the endpoint is accessed.
+/////////////////////////////////////////////////////////////////////////////
+static void MIOS32_USB_MIDI_Periodic_TxBufferHandler(void)
+{
+  MIOS32_IRQ_Disable();
+  MIOS32_USB_MIDI_TxBufferHandler();
+  MIOS32_IRQ_Enable();
+}
+
+static void MIOS32_USB_MIDI_Periodic_RxBufferHandler(void)
+{
+  MIOS32_IRQ_Disable();
+  MIOS32_USB_MIDI_RxBufferHandler();
+  MIOS32_IRQ_Enable();
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // This handler sends the new packages through the IN pipe if the buffer 
 // is not empty
@@ -249,12 +301,12 @@ static void MIOS32_USB_MIDI_TxBufferHandler(void)
   //   - last transfer finished
   //   - new packages are in the buffer
   //   - the device is configured
+  s32 ix;
 
-  // atomic operation to avoid conflict with other interrupts
-  MIOS32_IRQ_Disable();
 #ifdef STM32F10X_CL
-  if( !tx_buffer_busy && tx_buffer_size && transfer_possible ) {
+  if( !tx_buffer_busy && transfer_possible && (ix=MIOS32_RINGBUFFER_Peek(&tx_rb)) >= 0 ) {
     u32 ep_num = EP1_IN & 0x7f;
+    s32 tx_buffer_size = MIOS32_RINGBUFFER_Used(&tx_rb);
     s16 count = (tx_buffer_size > (MIOS32_USB_MIDI_DATA_IN_SIZE/4)) ? (MIOS32_USB_MIDI_DATA_IN_SIZE/4) : tx_buffer_size;
 
     USB_OTG_DSTS_TypeDef dsts;  
@@ -281,20 +333,21 @@ static void MIOS32_USB_MIDI_TxBufferHandler(void)
     // notify that new package is sent
     tx_buffer_busy = 1;
 
-    // send to IN pipe
-    tx_buffer_size -= count;
-
     // copy into EP FIFO
     __IO uint32_t *fifo = USB_OTG_FS_regs.FIFO[ep_num];
-    do {
-      USB_OTG_WRITE_REG32(fifo, tx_buffer[tx_buffer_tail]);
-      if( ++tx_buffer_tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-	tx_buffer_tail = 0;
-    } while( --count );
+    s16 i;
+    for(i=0; i<count; ++i) {
+      USB_OTG_WRITE_REG32(fifo, tx_buffer[ix]);
+      ix = MIOS32_RINGBUFFER_NextIx(&tx_rb, ix);
+    }
+
+    // send to IN pipe
+    MIOS32_RINGBUFFER_Release(&tx_rb, count);
   }
 #else
-  if( !tx_buffer_busy && tx_buffer_size && transfer_possible ) {
+  if( !tx_buffer_busy && transfer_possible && (ix=MIOS32_RINGBUFFER_Peek(&tx_rb)) >= 0 ) {
     u32 *pma_addr = (u32 *)(PMAAddr + (MIOS32_USB_ENDP1_TXADDR<<1));
+    s32 tx_buffer_size = MIOS32_RINGBUFFER_Used(&tx_rb);
     s16 count = (tx_buffer_size > (MIOS32_USB_MIDI_DATA_IN_SIZE/4)) ? (MIOS32_USB_MIDI_DATA_IN_SIZE/4) : tx_buffer_size;
 
     // notify that new package is sent
@@ -303,21 +356,19 @@ static void MIOS32_USB_MIDI_TxBufferHandler(void)
     // send to IN pipe
     SetEPTxCount(ENDP1, 4*count);
 
-    tx_buffer_size -= count;
-
     // copy into PMA buffer (16bit word with, only 32bit addressable)
-    do {
-      *pma_addr++ = tx_buffer[tx_buffer_tail] & 0xffff;
-      *pma_addr++ = (tx_buffer[tx_buffer_tail]>>16) & 0xffff;
-      if( ++tx_buffer_tail >= MIOS32_USB_MIDI_TX_BUFFER_SIZE )
-	tx_buffer_tail = 0;
-    } while( --count );
+    s16 i;
+    for(i=0; i<count; ++i) {
+      *pma_addr++ = tx_buffer[ix] & 0xffff;
+      *pma_addr++ = (tx_buffer[ix]>>16) & 0xffff;
+      ix = MIOS32_RINGBUFFER_NextIx(&tx_rb, ix);
+    }
+    MIOS32_RINGBUFFER_Release(&tx_rb, count);
 
     // send buffer
     SetEPTxValid(ENDP1);
   }
 #endif
-  MIOS32_IRQ_Enable();
 }
 
 
@@ -328,32 +379,32 @@ static void MIOS32_USB_MIDI_RxBufferHandler(void)
 {
   s16 count;
 
-  // atomic operation to avoid conflict with other interrupts
-  MIOS32_IRQ_Disable();
-
   // check if we can receive new data and get packages to be received from OUT pipe
 #ifdef STM32F10X_CL
   USB_OTG_EP *ep = PCD_GetOutEP(EP1_OUT & 0x7f);
   if( rx_buffer_new_data && (count=ep->xfer_len>>2) ) {
     // check if buffer is free
-    if( count < (MIOS32_USB_MIDI_RX_BUFFER_SIZE-rx_buffer_size) ) {
+    s32 ix;
+    if( (ix=MIOS32_RINGBUFFER_Reserve(&rx_rb, count)) >= 0 ) {
       u32 *buf_addr = (u32 *)&ep->xfer_buff[0];
+      u16 num_packages = 0;
 
       // copy received packages into receive buffer
-      // this operation should be atomic
       do {
 	mios32_midi_package_t package;
 	package.ALL = *buf_addr++;
 
 	if( MIOS32_MIDI_SendPackageToRxCallback(USB0 + package.cable, package) == 0 ) {
-	  rx_buffer[rx_buffer_head] = package.ALL;
-
-	  if( ++rx_buffer_head >= MIOS32_USB_MIDI_RX_BUFFER_SIZE )
-	    rx_buffer_head = 0;
-	  ++rx_buffer_size;
+	  rx_buffer[ix] = package.ALL;
+	  ix = MIOS32_RINGBUFFER_NextIx(&rx_rb, ix);
+	  ++num_packages;
 	}
       } while( --count > 0 );
 
+      // take over packages
+      if( num_packages )
+	MIOS32_RINGBUFFER_Commit(&rx_rb, num_packages);
+
       // notify, that data has been put into buffer
       rx_buffer_new_data = 0;
 
@@ -370,11 +421,12 @@ static void MIOS32_USB_MIDI_RxBufferHandler(void)
   if( rx_buffer_new_data && (count=GetEPRxCount(ENDP1)>>2) ) {
 
     // check if buffer is free
-    if( count < (MIOS32_USB_MIDI_RX_BUFFER_SIZE-rx_buffer_size) ) {
+    s32 ix;
+    if( (ix=MIOS32_RINGBUFFER_Reserve(&rx_rb, count)) >= 0 ) {
       u32 *pma_addr = (u32 *)(PMAAddr + (MIOS32_USB_ENDP1_RXADDR<<1));
+      u16 num_packages = 0;
 
       // copy received packages into receive buffer
-      // this operation should be atomic
       do {
 	u16 pl = *pma_addr++;
 	u16 ph = *pma_addr++;
@@ -382,14 +434,16 @@ static void MIOS32_USB_MIDI_RxBufferHandler(void)
 	package.ALL = (ph << 16) | pl;
 
 	if( MIOS32_MIDI_SendPackageToRxCallback(USB0 + package.cable, package) == 0 ) {
-	  rx_buffer[rx_buffer_head] = package.ALL;
-
-	  if( ++rx_buffer_head >= MIOS32_USB_MIDI_RX_BUFFER_SIZE )
-	    rx_buffer_head = 0;
-	  ++rx_buffer_size;
+	  rx_buffer[ix] = package.ALL;
+	  ix = MIOS32_RINGBUFFER_NextIx(&rx_rb, ix);
+	  ++num_packages;
 	}
       } while( --count > 0 );
 
+      // take over packages
+      if( num_packages )
+	MIOS32_RINGBUFFER_Commit(&rx_rb, num_packages);
+
       // notify, that data has been put into buffer
       rx_buffer_new_data = 0;
 
@@ -398,7 +452,6 @@ static void MIOS32_USB_MIDI_RxBufferHandler(void)
     }
   }
 #endif
-  MIOS32_IRQ_Enable();
 }
 
 
@@ -0,0 +1,337 @@
+// $Id$
+/*
+ * Host benchmark of the MIOS32_MIDI receive dispatcher
+ *
+ * All MIDI interfaces (USB, UART0..2, IIC0..7) are emulated by queues which
+ * are flooded with timestamped packages. UART1 additionally receives a MIDI
+ * clock. After each flood MIOS32_MIDI_Receive_Handler() is called once (like
+ * the MIDI task of the programming model), the callback emulates some
+ * application processing time and measures the latency of each package.
+ *
+ * The benchmark is executed for different interface priority/weight and
+ * time budget configurations, and prints the per-port latency.
+ *
+ * Usage: midi_rx_benchmark [<rounds> [<processing time in nS>]]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_ROUNDS          20000
+#define DEFAULT_PROCESSING_NS   3000
+
+#define NUM_INTF               12   // USB, UART0..2, IIC0..7
+#define INTF_QUEUE_SIZE       256   // packages per interface
+#define MAX_SAMPLES        200000   // latency samples per interface
+
+#define INTF_USB    0
+#define INTF_UART0  1
+#define INTF_IIC0   4
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  mios32_midi_package_t package[INTF_QUEUE_SIZE];
+  unsigned long long stamp[INTF_QUEUE_SIZE];
+  u16 head;
+  u16 tail;
+  u16 size;
+  u32 drops;
+} intf_queue_t;
+
+typedef struct {
+  u32 num_samples;
+  u32 *samples;
+} intf_latency_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static intf_queue_t intf_queue[NUM_INTF];
+static intf_latency_t intf_latency[NUM_INTF];
+
+static unsigned long long current_stamp;
+static u32 processing_ns;
+
+static const char intf_name[NUM_INTF][6] = {
+  "USB", "UART0", "UART1", "UART2",
+  "IIC0", "IIC1", "IIC2", "IIC3", "IIC4", "IIC5", "IIC6", "IIC7"
+};
+
+// packages which are sent to the interfaces per round
+static const u8 intf_flood[NUM_INTF] = {
+  16, 3, 1, 3,
+  2, 2, 2, 2, 2, 2, 2, 2
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int CompareU32(const void *a, const void *b)
+{
+  u32 va = *(const u32 *)a;
+  u32 vb = *(const u32 *)b;
+  return (va > vb) - (va < vb);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated interfaces
+/////////////////////////////////////////////////////////////////////////////
+static void IntfPut(u8 intf, mios32_midi_package_t package)
+{
+  intf_queue_t *q = &intf_queue[intf];
+
+  if( q->size >= INTF_QUEUE_SIZE ) {
+    ++q->drops;
+    return;
+  }
+
+  q->package[q->head] = package;
+  q->stamp[q->head] = TimeGet();
+  if( ++q->head >= INTF_QUEUE_SIZE )
+    q->head = 0;
+  ++q->size;
+}
+
+static s32 IntfGet(u8 intf, mios32_midi_package_t *package)
+{
+  intf_queue_t *q = &intf_queue[intf];
+
+  if( !q->size )
+    return -1;
+
+  *package = q->package[q->tail];
+  current_stamp = q->stamp[q->tail];
+  if( ++q->tail >= INTF_QUEUE_SIZE )
+    q->tail = 0;
+  --q->size;
+
+  return q->size;
+}
+
+static void IntfFlood(u32 round)
+{
+  u8 intf, i;
+
+  for(intf=0; intf<NUM_INTF; ++intf) {
+    for(i=0; i<intf_flood[intf]; ++i) {
+      mios32_midi_package_t p;
+
+      if( intf == (INTF_UART0+1) ) {
+	// MIDI clock
+	p.ALL = 0;
+	p.type = 0xf;
+	p.evnt0 = 0xf8;
+      } else {
+	p.ALL = 0;
+	p.type = CC;
+	p.event = CC;
+	p.chn = i & 0xf;
+	p.evnt1 = round & 0x7f;
+	p.evnt2 = i & 0x7f;
+	if( intf == INTF_USB )
+	  p.cable = i & 3;
+      }
+
+      IntfPut(intf, p);
+    }
+  }
+}
+
+static void IntfReset(void)
+{
+  u8 intf;
+
+  memset(intf_queue, 0, sizeof(intf_queue));
+  for(intf=0; intf<NUM_INTF; ++intf)
+    intf_latency[intf].num_samples = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Receive callback: measures the latency and emulates processing time
+/////////////////////////////////////////////////////////////////////////////
+static void NotifyPackage(mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  unsigned long long now = TimeGet();
+  u8 intf;
+
+  switch( port & 0xf0 ) {
+  case USB0:  intf = INTF_USB; break;
+  case UART0: intf = INTF_UART0 + (port & 0xf); break;
+  case IIC0:  intf = INTF_IIC0 + (port & 0xf); break;
+  default: return;
+  }
+
+  intf_latency_t *l = &intf_latency[intf];
+  if( l->num_samples < MAX_SAMPLES )
+    l->samples[l->num_samples++] = (u32)(now - current_stamp);
+
+  // processing time of the application
+  while( (TimeGet() - now) < processing_ns );
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Runs a configuration and prints the results
+/////////////////////////////////////////////////////////////////////////////
+static void Run(const char *name, u32 num_rounds)
+{
+  u32 *handler_time = (u32 *)malloc(num_rounds * sizeof(u32));
+  u32 round;
+  u8 intf;
+
+  IntfReset();
+
+  for(round=0; round<num_rounds; ++round) {
+    IntfFlood(round);
+
+    unsigned long long t0 = TimeGet();
+    MIOS32_MIDI_Receive_Handler(NotifyPackage);
+    handler_time[round] = (u32)(TimeGet() - t0);
+  }
+
+  qsort(handler_time, num_rounds, sizeof(u32), CompareU32);
+
+  printf("%s (budget %u uS)\n", name, MIOS32_MIDI_RxBudgetGet());
+  printf("  Handler:   p50 %6u uS, p99 %6u uS, max %6u uS\n",
+	 handler_time[num_rounds/2] / 1000, handler_time[(u32)((unsigned long long)num_rounds*99/100)] / 1000,
+	 handler_time[num_rounds-1] / 1000);
+
+  for(intf=0; intf<NUM_INTF; ++intf) {
+    intf_latency_t *l = &intf_latency[intf];
+    u32 n = l->num_samples;
+
+    if( !n ) {
+      printf("  %-5s      no packages received, %u dropped\n", intf_name[intf], intf_queue[intf].drops);
+      continue;
+    }
+
+    qsort(l->samples, n, sizeof(u32), CompareU32);
+    printf("  %-5s      p50 %6u uS, p99 %6u uS, max %6u uS, %u received, %u dropped\n",
+	   intf_name[intf],
+	   l->samples[n/2] / 1000, l->samples[(u32)((unsigned long long)n*99/100)] / 1000, l->samples[n-1] / 1000,
+	   n, intf_queue[intf].drops);
+  }
+
+  free(handler_time);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  u32 num_rounds = (argc >= 2) ? strtoul(argv[1], NULL, 0) : DEFAULT_ROUNDS;
+  u8 intf;
+
+  processing_ns = (argc >= 3) ? strtoul(argv[2], NULL, 0) : DEFAULT_PROCESSING_NS;
+
+  if( num_rounds == 0 ) {
+    printf("Usage: %s [<rounds> [<processing time in nS>]]\n", argv[0]);
+    return 1;
+  }
+
+  for(intf=0; intf<NUM_INTF; ++intf)
+    intf_latency[intf].samples = (u32 *)malloc(MAX_SAMPLES * sizeof(u32));
+
+  printf("%u rounds, %u nS processing time per package\n\n", num_rounds, processing_ns);
+
+  // default configuration: all interfaces with the same priority
+  MIOS32_MIDI_Init(0);
+  Run("Default (round robin)", num_rounds);
+
+  // clock master has the highest priority, USB is allowed to deliver more packages at once
+  MIOS32_MIDI_Init(0);
+  MIOS32_MIDI_RxInterfaceAdd(UART1, 0, 1);
+  MIOS32_MIDI_RxInterfaceAdd(USB0, MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY, 4);
+  Run("UART1 prioritized, USB weight 4", num_rounds);
+
+  // without time budget
+  MIOS32_MIDI_Init(0);
+  MIOS32_MIDI_RxInterfaceAdd(UART1, 0, 1);
+  MIOS32_MIDI_RxBudgetSet(0);
+  Run("UART1 prioritized, no budget", num_rounds);
+
+  return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Host stubs for the interface drivers
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_IRQ_Disable(void) { return 0; }
+s32 MIOS32_IRQ_Enable(void) { return 0; }
+
+s32 MIOS32_SYS_Reset(void) { return 0; }
+u32 MIOS32_SYS_ChipIDGet(void) { return 0; }
+u32 MIOS32_SYS_FlashSizeGet(void) { return 0; }
+u32 MIOS32_SYS_RAMSizeGet(void) { return 0; }
+s32 MIOS32_SYS_SerialNumberGet(char *str) { str[0] = 0; return 0; }
+
+s32 MIOS32_USB_MIDI_Init(u32 mode) { return 0; }
+s32 MIOS32_USB_MIDI_CheckAvailable(void) { return 1; }
+s32 MIOS32_USB_MIDI_PackageSend_NonBlocking(mios32_midi_package_t package) { return 0; }
+s32 MIOS32_USB_MIDI_PackageSend(mios32_midi_package_t package) { return 0; }
+s32 MIOS32_USB_MIDI_PackageReceive(mios32_midi_package_t *package) { return IntfGet(INTF_USB, package); }
+s32 MIOS32_USB_MIDI_Periodic_mS(void) { return 0; }
+s32 MIOS32_USB_MIDI_BufferStatsGet(mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats) { return -1; }
+s32 MIOS32_USB_MIDI_BufferStatsReset(void) { return -1; }
+
+s32 MIOS32_UART_MIDI_Init(u32 mode) { return 0; }
+s32 MIOS32_UART_MIDI_CheckAvailable(u8 uart_port) { return 1; }
+s32 MIOS32_UART_MIDI_RS_OptimisationSet(u8 uart_port, u8 enable) { return 0; }
+s32 MIOS32_UART_MIDI_RS_OptimisationGet(u8 uart_port) { return 0; }
+s32 MIOS32_UART_MIDI_RS_Reset(u8 uart_port) { return 0; }
+s32 MIOS32_UART_MIDI_PackageSend_NonBlocking(u8 uart_port, mios32_midi_package_t package) { return 0; }
+s32 MIOS32_UART_MIDI_PackageSend(u8 uart_port, mios32_midi_package_t package) { return 0; }
+s32 MIOS32_UART_MIDI_PackageReceive(u8 uart_port, mios32_midi_package_t *package) { return IntfGet(INTF_UART0 + uart_port, package); }
+s32 MIOS32_UART_MIDI_Periodic_mS(void) { return 0; }
+s32 MIOS32_UART_BufferStatsGet(u8 uart, mios32_ringbuffer_stats_t *rx_stats, mios32_ringbuffer_stats_t *tx_stats) { return -1; }
+s32 MIOS32_UART_BufferStatsReset(u8 uart) { return -1; }
+
+s32 MIOS32_IIC_MIDI_Init(u32 mode) { return 0; }
+s32 MIOS32_IIC_MIDI_CheckAvailable(u8 iic_port) { return 1; }
+s32 MIOS32_IIC_MIDI_RS_OptimisationSet(u8 iic_port, u8 enable) { return 0; }
+s32 MIOS32_IIC_MIDI_RS_OptimisationGet(u8 iic_port) { return 0; }
+s32 MIOS32_IIC_MIDI_RS_Reset(u8 iic_port) { return 0; }
+s32 MIOS32_IIC_MIDI_PackageSend_NonBlocking(u8 iic_port, mios32_midi_package_t package) { return 0; }
+s32 MIOS32_IIC_MIDI_PackageSend(u8 iic_port, mios32_midi_package_t package) { return 0; }
+s32 MIOS32_IIC_MIDI_PackageReceive(u8 iic_port, mios32_midi_package_t *package) { return IntfGet(INTF_IIC0 + iic_port, package); }
+s32 MIOS32_IIC_MIDI_Periodic_mS(void) { return 0; }
@@ -0,0 +1,16 @@
+// $Id$
+/*
+ * Local MIOS32 configuration file for the host build
+ *
+ */
+
+#ifndef _MIOS32_CONFIG_H
+#define _MIOS32_CONFIG_H
+
+// the MIDI receive benchmark emulates all UARTs
+#define MIOS32_UART_NUM 3
+
+// OSC debug messages are printed on the console
+#define MIOS32_OSC_DEBUG_MSG printf
+
+#endif /* _MIOS32_CONFIG_H */
@@ -0,0 +1,432 @@
+// $Id$
+/*
+ * Host benchmark of the MIOS32_OSC packet parser
+ *
+ * Uses the search tree of apps/sequencers/midibox_seq_v4/mios32/osc_server.c
+ * (the methods are replaced by stubs which log the dispatched calls), and
+ * a set of OSC packets which are typically received by MBSEQ: MIDI events
+ * (/midi*), values (/<channel>/<event>), Pianist Pro messages (/mcmpp/...
+ * with values in the path), bundles and some wildcard addresses.
+ *
+ * The packets are parsed with MIOS32_OSC_ParsePacket() (search tree) and
+ * MIOS32_OSC_ParsePacketTable() (compiled search table). At first the
+ * dispatched calls of both parsers are compared, thereafter the number of
+ * parsed messages per second is measured.
+ *
+ * Usage: osc_benchmark [<rounds>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_ROUNDS     200000
+
+#define NUM_PACKETS        64
+#define PACKET_SIZE        256
+#define TABLE_SLOTS        256
+
+#define LOG_SIZE           256
+#define LOG_PATH_SIZE      64
+
+// identical to the OSCx ports of MBSEQ
+#define OSC_PORT(n)        (0xf0 + (n))
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  u8  method;
+  u32 method_arg;
+  u8  num_args;
+  char path[LOG_PATH_SIZE];
+} dispatch_log_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static u8 packet[NUM_PACKETS][PACKET_SIZE];
+static u32 packet_len[NUM_PACKETS];
+static u32 packet_messages[NUM_PACKETS];
+static u32 num_packets;
+
+static dispatch_log_t *dispatch_log;
+static u32 dispatch_log_num;
+static u32 dispatch_checksum;
+
+static mios32_osc_search_table_entry_t parse_slots[TABLE_SLOTS];
+static mios32_osc_search_table_t parse_table;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Method stubs: log the call (if requested), and read the arguments
+/////////////////////////////////////////////////////////////////////////////
+static s32 LogCall(u8 method, mios32_osc_args_t *osc_args, u32 method_arg)
+{
+  int i;
+
+  // arguments are fetched directly from the packet buffer
+  for(i=0; i<osc_args->num_args; ++i) {
+    if( osc_args->arg_type[i] == 'i' || osc_args->arg_type[i] == 'm' )
+      dispatch_checksum += MIOS32_OSC_GetWord(osc_args->arg_ptr[i]);
+  }
+  dispatch_checksum += method_arg + method;
+
+  if( dispatch_log != NULL && dispatch_log_num < LOG_SIZE ) {
+    dispatch_log_t *log = &dispatch_log[dispatch_log_num++];
+    char *path = log->path;
+
+    log->method = method;
+    log->method_arg = method_arg;
+    log->num_args = osc_args->num_args;
+    path[0] = 0;
+    for(i=0; i<osc_args->num_path_parts; ++i) {
+      strncat(path, "/", LOG_PATH_SIZE - strlen(path) - 1);
+      strncat(path, osc_args->path_part[i], LOG_PATH_SIZE - strlen(path) - 1);
+    }
+  }
+
+  return 0; // no error
+}
+
+static s32 OSC_SERVER_Method_MIDI(mios32_osc_args_t *osc_args, u32 method_arg)    { return LogCall(0, osc_args, method_arg); }
+static s32 OSC_SERVER_Method_MCMPP(mios32_osc_args_t *osc_args, u32 method_arg)   { return LogCall(1, osc_args, method_arg); }
+static s32 OSC_SERVER_Method_Event(mios32_osc_args_t *osc_args, u32 method_arg)   { return LogCall(2, osc_args, method_arg); }
+static s32 OSC_SERVER_Method_EventPB(mios32_osc_args_t *osc_args, u32 method_arg) { return LogCall(3, osc_args, method_arg); }
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Search Tree of MBSEQ V4 (apps/sequencers/midibox_seq_v4/mios32/osc_server.c)
+/////////////////////////////////////////////////////////////////////////////
+
+static mios32_osc_search_tree_t parse_mcmpp_value[] = {
+  { "*", NULL, &OSC_SERVER_Method_MCMPP, 0x00000000 },
+
+  { NULL, NULL, NULL, 0 } // terminator
+};
+
+static mios32_osc_search_tree_t parse_mcmpp[] = {
+  { "key",           parse_mcmpp_value, NULL, 0x00000090 }, // bit [7:4] contains status byte
+  { "polypressure",  parse_mcmpp_value, NULL, 0x000000a0 }, // bit [7:4] contains status byte
+  { "cc",            parse_mcmpp_value, NULL, 0x000000b0 }, // bit [7:4] contains status byte
+  { "programchange", parse_mcmpp_value, NULL, 0x000000c0 }, // bit [7:4] contains status byte
+  { "aftertouch",    parse_mcmpp_value, NULL, 0x000000d0 }, // bit [7:4] contains status byte
+  { "pitch",         parse_mcmpp_value, NULL, 0x000000e0 }, // bit [7:4] contains status byte
+
+  { NULL, NULL, NULL, 0 } // terminator
+};
+
+
+static mios32_osc_search_tree_t parse_event[] = {
+  { "note",          NULL, &OSC_SERVER_Method_Event,   0x00000090 }, // bit [7:4] contains status byte
+  { "polypressure",  NULL, &OSC_SERVER_Method_Event,   0x000000a0 }, // bit [7:4] contains status byte
+  { "cc",            NULL, &OSC_SERVER_Method_Event,   0x000000b0 }, // bit [7:4] contains status byte
+  { "programchange", NULL, &OSC_SERVER_Method_Event,   0x000000c0 }, // bit [7:4] contains status byte
+  { "aftertouch",    NULL, &OSC_SERVER_Method_Event,   0x000000b0 }, // bit [7:4] contains status byte
+  { "pitchbend",     NULL, &OSC_SERVER_Method_EventPB, 0x000000e0 }, // bit [7:4] contains status byte
+
+  { NULL, NULL, NULL, 0 } // terminator
+};
+
+
+static mios32_osc_search_tree_t parse_root[] = {
+  { "midi",  NULL, &OSC_SERVER_Method_MIDI, OSC_PORT(0) },
+  { "midi1", NULL, &OSC_SERVER_Method_MIDI, OSC_PORT(0) },
+  { "midi2", NULL, &OSC_SERVER_Method_MIDI, OSC_PORT(1) },
+  { "midi3", NULL, &OSC_SERVER_Method_MIDI, OSC_PORT(2) },
+  { "midi4", NULL, &OSC_SERVER_Method_MIDI, OSC_PORT(3) },
+
+  { "mcmpp", parse_mcmpp, NULL, 0x00000000}, // pianist pro format
+
+  { "1",  parse_event, NULL, 0x00000000}, // bit [0:3] selects MIDI channel
+  { "2",  parse_event, NULL, 0x00000001}, // bit [0:3] selects MIDI channel
+  { "3",  parse_event, NULL, 0x00000002}, // bit [0:3] selects MIDI channel
+  { "4",  parse_event, NULL, 0x00000003}, // bit [0:3] selects MIDI channel
+  { "5",  parse_event, NULL, 0x00000004}, // bit [0:3] selects MIDI channel
+  { "6",  parse_event, NULL, 0x00000005}, // bit [0:3] selects MIDI channel
+  { "7",  parse_event, NULL, 0x00000006}, // bit [0:3] selects MIDI channel
+  { "8",  parse_event, NULL, 0x00000007}, // bit [0:3] selects MIDI channel
+  { "9",  parse_event, NULL, 0x00000008}, // bit [0:3] selects MIDI channel
+  { "10", parse_event, NULL, 0x00000009}, // bit [0:3] selects MIDI channel
+  { "11", parse_event, NULL, 0x0000000a}, // bit [0:3] selects MIDI channel
+  { "12", parse_event, NULL, 0x0000000b}, // bit [0:3] selects MIDI channel
+  { "13", parse_event, NULL, 0x0000000c}, // bit [0:3] selects MIDI channel
+  { "14", parse_event, NULL, 0x0000000d}, // bit [0:3] selects MIDI channel
+  { "15", parse_event, NULL, 0x0000000e}, // bit [0:3] selects MIDI channel
+  { "16", parse_event, NULL, 0x0000000f}, // bit [0:3] selects MIDI channel
+
+  { NULL, NULL, NULL, 0 } // terminator
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Time measurement in nS
+/////////////////////////////////////////////////////////////////////////////
+static unsigned long long TimeGet(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Packet construction
+/////////////////////////////////////////////////////////////////////////////
+static u8 *PutMessage(u8 *end_ptr, char *path, u32 value1, u32 value2, u8 num_values)
+{
+  end_ptr = MIOS32_OSC_PutString(end_ptr, path);
+  end_ptr = MIOS32_OSC_PutString(end_ptr, (num_values >= 2) ? ",ii" : ",i");
+  end_ptr = MIOS32_OSC_PutInt(end_ptr, value1);
+  if( num_values >= 2 )
+    end_ptr = MIOS32_OSC_PutInt(end_ptr, value2);
+  return end_ptr;
+}
+
+static void AddMessage(char *path, u32 value1, u32 value2, u8 num_values)
+{
+  u8 *end_ptr = PutMessage(packet[num_packets], path, value1, value2, num_values);
+  packet_len[num_packets] = end_ptr - packet[num_packets];
+  packet_messages[num_packets] = 1;
+  ++num_packets;
+}
+
+static void AddMIDIMessage(char *path, u8 evnt0, u8 evnt1, u8 evnt2)
+{
+  u8 *end_ptr = packet[num_packets];
+  mios32_midi_package_t p;
+
+  p.ALL = 0;
+  p.evnt0 = evnt0;
+  p.evnt1 = evnt1;
+  p.evnt2 = evnt2;
+  end_ptr = MIOS32_OSC_PutString(end_ptr, path);
+  end_ptr = MIOS32_OSC_PutString(end_ptr, ",m");
+  end_ptr = MIOS32_OSC_PutMIDI(end_ptr, p);
+  packet_len[num_packets] = end_ptr - packet[num_packets];
+  packet_messages[num_packets] = 1;
+  ++num_packets;
+}
+
+static void AddBundle(u8 first_channel, u8 num_elements)
+{
+  u8 *end_ptr = packet[num_packets];
+  mios32_osc_timetag_t timetag;
+  int i;
+
+  timetag.seconds = 0;
+  timetag.fraction = 1;
+  end_ptr = MIOS32_OSC_PutString(end_ptr, "#bundle");
+  end_ptr = MIOS32_OSC_PutTimetag(end_ptr, timetag);
+  for(i=0; i<num_elements; ++i) {
+    char path[20];
+    u8 *insert_len_ptr = end_ptr;
+    end_ptr += 4;
+    sprintf(path, "/%d/note", first_channel + i);
+    end_ptr = PutMessage(end_ptr, path, 0x3c + i, 100, 2);
+    MIOS32_OSC_PutWord(insert_len_ptr, (u32)(end_ptr-insert_len_ptr-4));
+  }
+  packet_len[num_packets] = end_ptr - packet[num_packets];
+  packet_messages[num_packets] = num_elements;
+  ++num_packets;
+}
+
+static void CreatePackets(void)
+{
+  int i;
+
+  num_packets = 0;
+
+  // MIDI events
+  AddMIDIMessage("/midi", 0x90, 0x3c, 0x64);
+  AddMIDIMessage("/midi2", 0xb0, 0x07, 0x40);
+  AddMIDIMessage("/midi4", 0xf8, 0x00, 0x00);
+
+  // values
+  for(i=1; i<=16; ++i) {
+    char path[20];
+    sprintf(path, "/%d/note", i);
+    AddMessage(path, 0x30 + i, 0x64, 2);
+    sprintf(path, "/%d/cc", i);
+    AddMessage(path, 0x10 + i, 0x40, 2);
+  }
+  AddMessage("/1/pitchbend", 100, 0, 1);
+  AddMessage("/10/programchange", 5, 0, 1);
+  AddMessage("/16/aftertouch", 50, 0, 1);
+
+  // Pianist Pro: values are part of the path (wildcard node in the tree)
+  AddMessage("/mcmpp/key/60/1", 100, 0, 1);
+  AddMessage("/mcmpp/cc/7/2", 90, 0, 1);
+  AddMessage("/mcmpp/pitch/3", 10, 0, 1);
+
+  // bundles
+  AddBundle(1, 4);
+  AddBundle(5, 8);
+
+  // wildcards sent by the remote host
+  AddMessage("/*/note", 0x3c, 0x40, 2);
+  AddMessage("/1?/cc", 0x01, 0x7f, 2);
+  AddMessage("/midi?", 0x90, 0x00, 1);
+
+  // unknown addresses
+  AddMessage("/17/note", 0x3c, 0x40, 2);
+  AddMessage("/1/unknown", 0x3c, 0x40, 2);
+  AddMessage("/midi5", 0x3c, 0x40, 1);
+  AddMessage("/mcmpp", 0x3c, 0x40, 1);
+  AddMessage("/sequencer/track/1/mute", 1, 0, 1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Parses all packets with the search tree or with the search table
+/////////////////////////////////////////////////////////////////////////////
+static s32 ParseAll(u8 use_table)
+{
+  u32 i;
+  s32 status = 0;
+
+  for(i=0; i<num_packets; ++i) {
+    s32 packet_status = use_table
+      ? MIOS32_OSC_ParsePacketTable(packet[i], packet_len[i], &parse_table)
+      : MIOS32_OSC_ParsePacket(packet[i], packet_len[i], parse_root);
+    if( packet_status < 0 )
+      status = packet_status;
+  }
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Compares the dispatched calls of both parsers
+/////////////////////////////////////////////////////////////////////////////
+static s32 Verify(void)
+{
+  dispatch_log_t *tree_log = (dispatch_log_t *)calloc(LOG_SIZE, sizeof(dispatch_log_t));
+  dispatch_log_t *table_log = (dispatch_log_t *)calloc(LOG_SIZE, sizeof(dispatch_log_t));
+  u32 num_tree_calls, num_table_calls;
+  s32 status = 0;
+  u32 i;
+
+  dispatch_log = tree_log;
+  dispatch_log_num = 0;
+  if( ParseAll(0) < 0 )
+    status = -1;
+  num_tree_calls = dispatch_log_num;
+
+  dispatch_log = table_log;
+  dispatch_log_num = 0;
+  if( ParseAll(1) < 0 )
+    status = -1;
+  num_table_calls = dispatch_log_num;
+
+  dispatch_log = NULL;
+
+  if( status < 0 )
+    printf("ERROR: parser returned an error\n");
+
+  if( num_tree_calls != num_table_calls ) {
+    printf("ERROR: tree dispatched %u calls, table %u calls\n", num_tree_calls, num_table_calls);
+    status = -2;
+  } else {
+    for(i=0; i<num_tree_calls; ++i) {
+      if( tree_log[i].method != table_log[i].method ||
+	  tree_log[i].method_arg != table_log[i].method_arg ||
+	  tree_log[i].num_args != table_log[i].num_args ||
+	  strcmp(tree_log[i].path, table_log[i].path) != 0 ) {
+	printf("ERROR: call #%u differs: tree %d %s 0x%08x, table %d %s 0x%08x\n", i,
+	       tree_log[i].method, tree_log[i].path, tree_log[i].method_arg,
+	       table_log[i].method, table_log[i].path, table_log[i].method_arg);
+	status = -3;
+      }
+    }
+  }
+
+  if( status >= 0 )
+    printf("Verify:   %u calls dispatched identically\n", num_tree_calls);
+
+  free(tree_log);
+  free(table_log);
+
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Measures the number of parsed messages per second
+/////////////////////////////////////////////////////////////////////////////
+static void Measure(const char *name, u8 use_table, u32 num_rounds)
+{
+  u32 num_messages = 0;
+  u32 round, i;
+
+  for(i=0; i<num_packets; ++i)
+    num_messages += packet_messages[i];
+
+  dispatch_checksum = 0;
+  unsigned long long t0 = TimeGet();
+  for(round=0; round<num_rounds; ++round)
+    ParseAll(use_table);
+  unsigned long long time = TimeGet() - t0;
+
+  double msgs_per_sec = (double)num_messages * num_rounds * 1e9 / (double)time;
+  printf("%-8s  %10.0f messages/sec, %6.1f nS/message (checksum %08x)\n",
+	 name, msgs_per_sec, 1e9 / msgs_per_sec, dispatch_checksum);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  u32 num_rounds = (argc >= 2) ? strtoul(argv[1], NULL, 0) : DEFAULT_ROUNDS;
+  s32 status;
+
+  if( num_rounds == 0 ) {
+    printf("Usage: %s [<rounds>]\n", argv[0]);
+    return 1;
+  }
+
+  MIOS32_OSC_Init(0);
+  CreatePackets();
+
+  if( (status=MIOS32_OSC_SearchTableCompile(&parse_table, parse_slots, TABLE_SLOTS, parse_root)) < 0 ) {
+    printf("ERROR: failed to compile search table (status %d)\n", status);
+    return 1;
+  }
+  printf("Table:    %d of %d slots used (%u bytes)\n", status, TABLE_SLOTS, (unsigned)sizeof(parse_slots));
+  printf("Packets:  %u, %u rounds\n", num_packets, num_rounds);
+
+  if( Verify() < 0 )
+    return 1;
+
+  Measure("tree", 0, num_rounds);
+  Measure("table", 1, num_rounds);
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+// $Id$
+/*
+ * Host test of the MIOS32_OSC bundle scheduler
+ *
+ * A remote host sends a bundle with a note event each 10 mS. The timetag
+ * of each bundle contains the send time of the remote clock, which has a
+ * large offset to the local clock. The bundles arrive with a random
+ * network delay, some of them are delayed more than the latency
+ * compensation. The scheduler handler is called each mS (like in the
+ * uIP task).
+ *
+ * The timing of the dispatched notes is measured for immediate dispatching
+ * (MIOS32_OSC_ParsePacket()) and for the scheduler in RELATIVE mode, and
+ * the scheduler statistics are checked.
+ *
+ * Usage: osc_scheduler_test [<latency in uS>]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define NUM_BUNDLES       2000
+#define BUNDLE_PERIOD_US  10000
+#define DELAY_MIN_US      500
+#define DELAY_JITTER_US   6000
+#define DELAY_SPIKE_US    25000 // each 100th bundle
+#define REMOTE_OFFSET_S   3000000000U // NTP time of the remote host
+#define NUM_SLOTS         32
+#define ON_TIME_US        1000  // resolution of the scheduler handler
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static u32 current_us;
+
+static u32 num_notes;
+static u32 note_time_us[NUM_BUNDLES];
+static s32 note_number[NUM_BUNDLES];
+
+static mios32_osc_scheduler_slot_t scheduler_slots[NUM_SLOTS];
+static mios32_osc_scheduler_t scheduler;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Search Tree
+/////////////////////////////////////////////////////////////////////////////
+static s32 OSC_Method_Note(mios32_osc_args_t *osc_args, u32 method_arg)
+{
+  if( num_notes < NUM_BUNDLES && osc_args->num_args >= 1 && osc_args->arg_type[0] == 'i' ) {
+    note_number[num_notes] = MIOS32_OSC_GetInt(osc_args->arg_ptr[0]);
+    note_time_us[num_notes] = current_us;
+    ++num_notes;
+  }
+
+  return 0; // no error
+}
+
+static mios32_osc_search_tree_t parse_root[] = {
+  { "note", NULL, &OSC_Method_Note, 0x00000000 },
+
+  { NULL, NULL, NULL, 0 } // terminator
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static mios32_osc_timetag_t TimetagFromUs(u32 seconds, u32 us)
+{
+  mios32_osc_timetag_t timetag;
+  timetag.seconds = seconds + us / 1000000;
+  timetag.fraction = (u32)(((unsigned long long)(us % 1000000) << 32) / 1000000);
+  return timetag;
+}
+
+static u32 CreateBundle(u8 *packet, u32 bundle)
+{
+  u8 *end_ptr = packet;
+  u8 *insert_len_ptr;
+
+  end_ptr = MIOS32_OSC_PutString(end_ptr, "#bundle");
+  end_ptr = MIOS32_OSC_PutTimetag(end_ptr, TimetagFromUs(REMOTE_OFFSET_S, bundle * BUNDLE_PERIOD_US));
+  insert_len_ptr = end_ptr;
+  end_ptr += 4;
+  end_ptr = MIOS32_OSC_PutString(end_ptr, "/note");
+  end_ptr = MIOS32_OSC_PutString(end_ptr, ",i");
+  end_ptr = MIOS32_OSC_PutInt(end_ptr, bundle);
+  MIOS32_OSC_PutWord(insert_len_ptr, (u32)(end_ptr-insert_len_ptr-4));
+
+  return end_ptr - packet;
+}
+
+
+static int CompareS32(const void *a, const void *b)
+{
+  s32 va = *(const s32 *)a;
+  s32 vb = *(const s32 *)b;
+  return (va > vb) - (va < vb);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Runs the simulation, returns the number of notes which are played in time
+/////////////////////////////////////////////////////////////////////////////
+static u32 Run(const char *name, u8 use_scheduler)
+{
+  static u32 arrival_us[NUM_BUNDLES];
+  u32 seed = 1;
+  u32 bundle;
+  u8 packet[64];
+
+  // network: bundles can overtake each other
+  for(bundle=0; bundle<NUM_BUNDLES; ++bundle) {
+    seed = seed * 1103515245 + 12345;
+    u32 delay = DELAY_MIN_US + (seed >> 8) % DELAY_JITTER_US;
+    if( (bundle % 100) == 50 )
+      delay += DELAY_SPIKE_US;
+    arrival_us[bundle] = 1000000 + bundle * BUNDLE_PERIOD_US + delay;
+  }
+
+  num_notes = 0;
+  for(current_us=1000000; current_us < 1000000 + (NUM_BUNDLES+10)*BUNDLE_PERIOD_US; current_us += 100) {
+    mios32_osc_timetag_t now = TimetagFromUs(0, current_us);
+
+    for(bundle=0; bundle<NUM_BUNDLES; ++bundle) {
+      if( arrival_us[bundle] >= current_us && arrival_us[bundle] < (current_us + 100) ) {
+	u32 len = CreateBundle(packet, bundle);
+	if( use_scheduler )
+	  MIOS32_OSC_ParsePacketScheduled(packet, len, &scheduler, now);
+	else
+	  MIOS32_OSC_ParsePacket(packet, len, parse_root);
+      }
+    }
+
+    if( use_scheduler && (current_us % 1000) == 0 )
+      MIOS32_OSC_SchedulerHandler(&scheduler, now);
+  }
+
+  // measure the deviation from the ideal note timing (relative to the median
+  // delay), and check the order
+  static s32 deviation[NUM_BUNDLES];
+  static s32 sorted[NUM_BUNDLES];
+  u32 out_of_order = 0;
+  u32 i;
+  for(i=0; i<num_notes; ++i) {
+    deviation[i] = (s32)(note_time_us[i] - 1000000 - note_number[i] * BUNDLE_PERIOD_US);
+    sorted[i] = deviation[i];
+    if( i > 0 && note_number[i] < note_number[i-1] )
+      ++out_of_order;
+  }
+  qsort(sorted, num_notes, sizeof(s32), CompareS32);
+  s32 median = num_notes ? sorted[num_notes/2] : 0;
+
+  double sum_sqr = 0.0;
+  u32 max_error = 0;
+  u32 on_time = 0;
+  for(i=0; i<num_notes; ++i) {
+    u32 error = abs(deviation[i] - median);
+    sum_sqr += (double)error * error;
+    if( error > max_error )
+      max_error = error;
+    if( error <= ON_TIME_US )
+      ++on_time;
+  }
+  double rms = (num_notes > 0) ? sqrt(sum_sqr / num_notes) : 0.0;
+
+  printf("%-10s %u notes, median delay %5d uS, error rms %7.1f uS, max %6u uS, %u within +/- %u uS, %u out of order\n",
+	 name, num_notes, median, rms, max_error, on_time, ON_TIME_US, out_of_order);
+
+  return on_time;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  u32 latency_us = (argc >= 2) ? strtoul(argv[1], NULL, 0) : 8000;
+  mios32_osc_scheduler_stats_t stats;
+  int errors = 0;
+
+  MIOS32_OSC_Init(0);
+  MIOS32_OSC_SchedulerInit(&scheduler, scheduler_slots, NUM_SLOTS, parse_root, NULL);
+  MIOS32_OSC_SchedulerLatencySet(&scheduler, latency_us);
+
+  printf("%u bundles each %u uS, network delay %u..%u uS (+%u uS each 100th bundle), latency %u uS\n",
+	 NUM_BUNDLES, BUNDLE_PERIOD_US, DELAY_MIN_US, DELAY_MIN_US + DELAY_JITTER_US, DELAY_SPIKE_US, latency_us);
+
+  u32 on_time_immediate = Run("immediate", 0);
+  u32 on_time_scheduled = Run("scheduled", 1);
+
+  MIOS32_OSC_SchedulerStatsGet(&scheduler, &stats);
+  printf("Scheduler: %u queued, %u immediate, %u late, %u overflows\n",
+	 stats.queued, stats.immediate, stats.late, stats.overflows);
+  printf("           max late %u uS, max early %u uS, max dispatch delay %u uS, %d still queued\n",
+	 stats.max_late_us, stats.max_early_us, stats.max_dispatch_delay_us,
+	 MIOS32_OSC_SchedulerNumQueued(&scheduler));
+
+  if( num_notes != NUM_BUNDLES ) {
+    printf("ERROR: %u of %u notes dispatched\n", num_notes, NUM_BUNDLES);
+    ++errors;
+  }
+
+  if( (stats.queued + stats.late) != NUM_BUNDLES || stats.overflows != 0 ) {
+    printf("ERROR: unexpected number of queued/late bundles\n");
+    ++errors;
+  }
+
+  // the first notes are scheduled later until the fastest transfer has been measured
+  if( on_time_scheduled < (stats.queued * 99) / 100 || on_time_scheduled <= on_time_immediate ) {
+    printf("ERROR: scheduler doesn't reduce the jitter\n");
+    ++errors;
+  }
+
+  if( stats.max_dispatch_delay_us > 1000 ) {
+    printf("ERROR: dispatch delay exceeds handler period\n");
+    ++errors;
+  }
+
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+// $Id$
+/*
+ * Host test of the lock-free MIOS32 ring buffer
+ *
+ * Checks the single-threaded semantics (capacity, wrap-around, multi-item
+ * reservations, statistics), and runs a producer and a consumer thread
+ * which exchange a numbered sequence through a small buffer, so that
+ * lost, duplicated or reordered items are detected.
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define TEST_BUFFER_SIZE    8
+#define STRESS_BUFFER_SIZE  17   // odd size to get wrap-arounds at varying positions
+#define STRESS_ITEMS        2000000
+
+#define CHECK(cond) do { \
+    if( !(cond) ) { \
+      printf("FAILED: %s (line %d)\n", #cond, __LINE__); \
+      ++num_errors; \
+    } \
+  } while( 0 )
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static int num_errors;
+
+static mios32_ringbuffer_t stress_rb;
+static u32 stress_buffer[STRESS_BUFFER_SIZE];
+static u32 stress_consumer_errors;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Single-threaded tests
+/////////////////////////////////////////////////////////////////////////////
+static void TestBasics(void)
+{
+  mios32_ringbuffer_t rb;
+  mios32_ringbuffer_stats_t stats;
+  u8 buffer[TEST_BUFFER_SIZE];
+  s32 ix;
+  int i, round;
+
+  CHECK(MIOS32_RINGBUFFER_Init(&rb, 1) < 0);
+  CHECK(MIOS32_RINGBUFFER_Init(&rb, TEST_BUFFER_SIZE) == 0);
+
+  // empty buffer
+  CHECK(MIOS32_RINGBUFFER_Used(&rb) == 0);
+  CHECK(MIOS32_RINGBUFFER_Free(&rb) == TEST_BUFFER_SIZE-1);
+  CHECK(MIOS32_RINGBUFFER_Peek(&rb) < 0);
+
+  // fill the buffer: one slot is kept free
+  for(i=0; i<TEST_BUFFER_SIZE-1; ++i) {
+    CHECK((ix=MIOS32_RINGBUFFER_Reserve(&rb, 1)) == i);
+    buffer[ix] = i;
+    CHECK(MIOS32_RINGBUFFER_Commit(&rb, 1) == i+1);
+  }
+  CHECK(MIOS32_RINGBUFFER_Free(&rb) == 0);
+  CHECK(MIOS32_RINGBUFFER_Reserve(&rb, 1) < 0);
+
+  // take all items
+  for(i=0; i<TEST_BUFFER_SIZE-1; ++i) {
+    CHECK((ix=MIOS32_RINGBUFFER_Peek(&rb)) >= 0);
+    CHECK(ix >= 0 && buffer[ix] == i);
+    CHECK(MIOS32_RINGBUFFER_Release(&rb, 1) == TEST_BUFFER_SIZE-2-i);
+  }
+  CHECK(MIOS32_RINGBUFFER_Peek(&rb) < 0);
+
+  // multi-item reservations which wrap around the buffer end
+  for(round=0; round<3*TEST_BUFFER_SIZE; ++round) {
+    u8 len = 1 + (round % (TEST_BUFFER_SIZE-1));
+
+    CHECK((ix=MIOS32_RINGBUFFER_Reserve(&rb, len)) >= 0);
+    if( ix < 0 )
+      break;
+    for(i=0; i<len; ++i) {
+      buffer[ix] = round + i;
+      ix = MIOS32_RINGBUFFER_NextIx(&rb, ix);
+    }
+    CHECK(MIOS32_RINGBUFFER_Commit(&rb, len) == len);
+    CHECK(MIOS32_RINGBUFFER_Reserve(&rb, TEST_BUFFER_SIZE-len) < 0);
+
+    CHECK((ix=MIOS32_RINGBUFFER_Peek(&rb)) >= 0);
+    if( ix < 0 )
+      break;
+    for(i=0; i<len; ++i) {
+      CHECK(buffer[ix] == (u8)(round + i));
+      ix = MIOS32_RINGBUFFER_NextIx(&rb, ix);
+    }
+    CHECK(MIOS32_RINGBUFFER_Release(&rb, len) == 0);
+  }
+
+  // statistics
+  MIOS32_RINGBUFFER_StatsGet(&rb, &stats);
+  CHECK(stats.size == TEST_BUFFER_SIZE-1);
+  CHECK(stats.max_used == TEST_BUFFER_SIZE-1);
+  CHECK(stats.overruns == 0);
+
+  CHECK(MIOS32_RINGBUFFER_OverrunNotify(&rb) == 1);
+  CHECK(MIOS32_RINGBUFFER_OverrunNotify(&rb) == 2);
+  MIOS32_RINGBUFFER_Reserve(&rb, 2);
+  MIOS32_RINGBUFFER_Commit(&rb, 2);
+  MIOS32_RINGBUFFER_StatsReset(&rb);
+  MIOS32_RINGBUFFER_StatsGet(&rb, &stats);
+  CHECK(stats.max_used == 2); // the high-water mark starts with the current level
+  CHECK(stats.overruns == 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Producer/consumer stress test
+/////////////////////////////////////////////////////////////////////////////
+static void *StressProducer(void *arg)
+{
+  u32 value = 0;
+
+  while( value < STRESS_ITEMS ) {
+    // alternate between single items and bursts
+    u16 len = 1 + (value % 5);
+    if( value + len > STRESS_ITEMS )
+      len = STRESS_ITEMS - value;
+
+    s32 ix;
+    if( (ix=MIOS32_RINGBUFFER_Reserve(&stress_rb, len)) < 0 ) {
+      sched_yield(); // buffer full, retry
+      continue;
+    }
+
+    u16 i;
+    for(i=0; i<len; ++i) {
+      stress_buffer[ix] = value++;
+      ix = MIOS32_RINGBUFFER_NextIx(&stress_rb, ix);
+    }
+    MIOS32_RINGBUFFER_Commit(&stress_rb, len);
+  }
+
+  return NULL;
+}
+
+static void *StressConsumer(void *arg)
+{
+  u32 expected = 0;
+
+  while( expected < STRESS_ITEMS ) {
+    s32 ix;
+    if( (ix=MIOS32_RINGBUFFER_Peek(&stress_rb)) < 0 ) {
+      sched_yield(); // buffer empty, retry
+      continue;
+    }
+
+    s32 used = MIOS32_RINGBUFFER_Used(&stress_rb);
+    s32 i;
+    for(i=0; i<used; ++i) {
+      if( stress_buffer[ix] != expected ) {
+	if( ++stress_consumer_errors <= 10 )
+	  printf("FAILED: expected %u, got %u\n", expected, stress_buffer[ix]);
+      }
+      ++expected;
+      ix = MIOS32_RINGBUFFER_NextIx(&stress_rb, ix);
+    }
+    MIOS32_RINGBUFFER_Release(&stress_rb, used);
+  }
+
+  return NULL;
+}
+
+static void TestStress(void)
+{
+  pthread_t producer, consumer;
+
+  MIOS32_RINGBUFFER_Init(&stress_rb, STRESS_BUFFER_SIZE);
+  stress_consumer_errors = 0;
+
+  pthread_create(&consumer, NULL, StressConsumer, NULL);
+  pthread_create(&producer, NULL, StressProducer, NULL);
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+
+  CHECK(stress_consumer_errors == 0);
+  CHECK(MIOS32_RINGBUFFER_Used(&stress_rb) == 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  TestBasics();
+  TestStress();
+
+  if( num_errors ) {
+    printf("%d error(s)\n", num_errors);
+    return 1;
+  }
+
+  printf("All ring buffer tests passed.\n");
+  return 0;
+}
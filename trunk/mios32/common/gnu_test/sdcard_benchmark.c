@@ -0,0 +1,398 @@
+// $Id$
+/*
+ * Host benchmark of the MIOS32_SDCARD single and multi block transfers
+ *
+ * The unmodified SD Card driver is running on top of a SPI level emulation
+ * of a SDHC card (sdcard_emu.c), which stores the content in an image file.
+ * The SPI transfer time (incl. the emulated access and programming delays
+ * of the card) is accumulated, so that the throughput of the STM32 can be
+ * estimated.
+ *
+ * - raw sectors are written and read back with MIOS32_SDCARD_SectorWrite/
+ *   SectorRead (one command per sector), and with SectorsWrite/SectorsRead
+ *   (multi block commands)
+ * - a session sized set of files is stored and loaded with FatFs.
+ *   The "single block" mode is emulated by wrapping the
+ *   MIOS32_SDCARD_SectorsRead/SectorsWrite calls of the FatFs glue
+ *   (linker option --wrap), so that the same file system code is measured
+ *
+ * Usage: sdcard_benchmark [<image file> [<read chunk size>]]
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <ff.h>
+
+#include "sdcard_emu.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define IMAGE_SECTORS      524288 // 256 MB
+#define CLUSTER_SIZE       32768  // like a formatted SDHC card
+
+#define RAW_SECTORS        2048   // 1 MB
+#define RAW_FIRST_SECTOR   4096
+
+#define DEFAULT_CHUNK_SIZE 8192
+#define MAX_CHUNK_SIZE     65536
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  char *name;
+  u32 size;
+} session_file_t;
+
+typedef struct {
+  unsigned long long time_ps;
+  u32 spi_bytes;
+  u32 commands;
+  u32 sectors;
+} result_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+// a MBSEQ V4 session: 4 pattern banks, mixer, song, groove, config
+static const session_file_t session_files[] = {
+  { "MBSEQ_B1.V4", 200704 },
+  { "MBSEQ_B2.V4", 200704 },
+  { "MBSEQ_B3.V4", 200704 },
+  { "MBSEQ_B4.V4", 200704 },
+  { "MBSEQ_M.V4",   16384 },
+  { "MBSEQ_S.V4",   10240 },
+  { "MBSEQ_G.V4",    2120 },
+  { "MBSEQ_C.V4",    1093 },
+  { NULL, 0 }
+};
+
+static u8 single_block_mode;
+static int errors;
+
+static u8 raw_buffer[RAW_SECTORS*512];
+static u8 chunk_buffer[MAX_CHUNK_SIZE];
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_SendDebugMessage(char *format, ...)
+{
+  return 0; // debug messages of the FatFs glue are not printed
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Wrapped multi block functions (called by the FatFs glue)
+/////////////////////////////////////////////////////////////////////////////
+extern s32 __real_MIOS32_SDCARD_SectorsRead(u32 sector, u8 *buffer, u32 count);
+extern s32 __real_MIOS32_SDCARD_SectorsWrite(u32 sector, u8 *buffer, u32 count);
+
+s32 __wrap_MIOS32_SDCARD_SectorsRead(u32 sector, u8 *buffer, u32 count)
+{
+  if( !single_block_mode )
+    return __real_MIOS32_SDCARD_SectorsRead(sector, buffer, count);
+
+  s32 status;
+  for(; count; --count, ++sector, buffer += 512)
+    if( (status=MIOS32_SDCARD_SectorRead(sector, buffer)) < 0 )
+      return status;
+
+  return 0; // no error
+}
+
+s32 __wrap_MIOS32_SDCARD_SectorsWrite(u32 sector, u8 *buffer, u32 count)
+{
+  if( !single_block_mode )
+    return __real_MIOS32_SDCARD_SectorsWrite(sector, buffer, count);
+
+  s32 status;
+  for(; count; --count, ++sector, buffer += 512)
+    if( (status=MIOS32_SDCARD_SectorWrite(sector, buffer)) < 0 )
+      return status;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help functions
+/////////////////////////////////////////////////////////////////////////////
+static void Check(int condition, const char *format, ...)
+{
+  if( !condition ) {
+    va_list args;
+    va_start(args, format);
+    printf("ERROR: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    ++errors;
+  }
+}
+
+// content of the files (different for each file and offset)
+static u8 FileByte(int file, u32 offset)
+{
+  return (u8)((offset * 13) ^ (offset >> 9) ^ (file * 71));
+}
+
+static void MeasureStart(void)
+{
+  SDCARD_EMU_StatsReset();
+}
+
+static void MeasureStop(result_t *result, u32 sectors)
+{
+  int i;
+
+  result->time_ps = sdcard_emu_stats.spi_time_ps;
+  result->spi_bytes = sdcard_emu_stats.spi_bytes;
+  result->sectors = sectors;
+  result->commands = 0;
+  for(i=0; i<64; ++i)
+    result->commands += sdcard_emu_stats.commands[i];
+}
+
+static void ResultPrint(const char *name, result_t *single, result_t *multi)
+{
+  double t_single = (double)single->time_ps / 1e12;
+  double t_multi = (double)multi->time_ps / 1e12;
+
+  printf("%-22s single: %7.0f sectors/s %6.1f mS (%4.0f SPI bytes/sector, %5u cmds) | multi: %7.0f sectors/s %6.1f mS (%4.0f SPI bytes/sector, %5u cmds) | x%.2f\n",
+	 name,
+	 single->sectors / t_single, t_single * 1000,
+	 (double)single->spi_bytes / single->sectors, single->commands,
+	 multi->sectors / t_multi, t_multi * 1000,
+	 (double)multi->spi_bytes / multi->sectors, multi->commands,
+	 t_single / t_multi);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Raw sector transfers
+/////////////////////////////////////////////////////////////////////////////
+static void RawWrite(u8 multi, u32 seed, result_t *result)
+{
+  u32 i;
+
+  for(i=0; i<sizeof(raw_buffer); ++i)
+    raw_buffer[i] = FileByte(seed, i);
+
+  MeasureStart();
+  if( multi ) {
+    Check(MIOS32_SDCARD_SectorsWrite(RAW_FIRST_SECTOR, raw_buffer, RAW_SECTORS) == 0, "SectorsWrite failed");
+  } else {
+    for(i=0; i<RAW_SECTORS; ++i)
+      Check(MIOS32_SDCARD_SectorWrite(RAW_FIRST_SECTOR + i, raw_buffer + i*512) == 0, "SectorWrite %u failed", i);
+  }
+  MeasureStop(result, RAW_SECTORS);
+}
+
+static void RawRead(u8 multi, u32 seed, result_t *result)
+{
+  u32 i;
+  u32 num_failed = 0;
+
+  memset(raw_buffer, 0, sizeof(raw_buffer));
+
+  MeasureStart();
+  if( multi ) {
+    Check(MIOS32_SDCARD_SectorsRead(RAW_FIRST_SECTOR, raw_buffer, RAW_SECTORS) == 0, "SectorsRead failed");
+  } else {
+    for(i=0; i<RAW_SECTORS; ++i)
+      Check(MIOS32_SDCARD_SectorRead(RAW_FIRST_SECTOR + i, raw_buffer + i*512) == 0, "SectorRead %u failed", i);
+  }
+  MeasureStop(result, RAW_SECTORS);
+
+  for(i=0; i<sizeof(raw_buffer); ++i)
+    if( raw_buffer[i] != FileByte(seed, i) )
+      ++num_failed;
+  Check(num_failed == 0, "%u bytes differ after %s read", num_failed, multi ? "multi block" : "single block");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Session stored/loaded with FatFs
+/////////////////////////////////////////////////////////////////////////////
+static u32 SessionSectors(void)
+{
+  u32 sectors = 0;
+  const session_file_t *f;
+
+  for(f=session_files; f->name != NULL; ++f)
+    sectors += (f->size + 511) / 512;
+
+  return sectors;
+}
+
+static void SessionStore(result_t *result, u32 chunk_size)
+{
+  const session_file_t *f;
+  FIL fil;
+
+  MeasureStart();
+  for(f=session_files; f->name != NULL; ++f) {
+    char path[32];
+    int file = f - session_files;
+    u32 offset;
+
+    sprintf(path, "/SESSION/%s", f->name);
+    if( f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK ) {
+      Check(0, "can't create %s", path);
+      continue;
+    }
+
+    for(offset=0; offset < f->size; ) {
+      u32 len = f->size - offset;
+      UINT written;
+      u32 i;
+
+      if( len > chunk_size )
+	len = chunk_size;
+      for(i=0; i<len; ++i)
+	chunk_buffer[i] = FileByte(file, offset + i);
+      if( f_write(&fil, chunk_buffer, len, &written) != FR_OK || written != len ) {
+	Check(0, "write error in %s", path);
+	break;
+      }
+      offset += len;
+    }
+
+    f_close(&fil);
+  }
+  MeasureStop(result, SessionSectors());
+}
+
+static void SessionLoad(result_t *result, u32 chunk_size)
+{
+  const session_file_t *f;
+  FIL fil;
+
+  MeasureStart();
+  for(f=session_files; f->name != NULL; ++f) {
+    char path[32];
+    int file = f - session_files;
+    u32 offset;
+    u32 num_failed = 0;
+
+    sprintf(path, "/SESSION/%s", f->name);
+    if( f_open(&fil, path, FA_OPEN_EXISTING | FA_READ) != FR_OK ) {
+      Check(0, "can't open %s", path);
+      continue;
+    }
+
+    for(offset=0; offset < f->size; ) {
+      UINT len;
+      u32 i;
+
+      if( f_read(&fil, chunk_buffer, chunk_size, &len) != FR_OK || len == 0 ) {
+	Check(0, "read error in %s", path);
+	break;
+      }
+      for(i=0; i<len; ++i)
+	if( chunk_buffer[i] != FileByte(file, offset + i) )
+	  ++num_failed;
+      offset += len;
+    }
+    Check(num_failed == 0, "%u bytes differ in %s", num_failed, path);
+
+    f_close(&fil);
+  }
+  MeasureStop(result, SessionSectors());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+/////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+  char *image_file = (argc >= 2) ? argv[1] : "sdcard_benchmark.img";
+  u32 chunk_size = (argc >= 3) ? strtol(argv[2], NULL, 0) : DEFAULT_CHUNK_SIZE;
+  result_t single, multi;
+  static FATFS fs;
+
+  if( chunk_size < 1 || chunk_size > MAX_CHUNK_SIZE ) {
+    printf("ERROR: chunk size has to be in the range 1..%d\n", MAX_CHUNK_SIZE);
+    return 1;
+  }
+
+  if( SDCARD_EMU_Create(image_file, IMAGE_SECTORS) < 0 ) {
+    printf("ERROR: can't create image file %s\n", image_file);
+    return 1;
+  }
+
+  MIOS32_SDCARD_Init(0);
+  Check(MIOS32_SDCARD_CheckAvailable(0) == 1, "SD Card not detected");
+  Check(MIOS32_SDCARD_CheckAvailable(1) == 1, "SD Card not available anymore");
+
+  printf("Card model: read latency %d/%d uS, write busy %d/%d/%d uS (first/next/stop), SPI at 18 MBit/s\n",
+	 SDCARD_EMU_READ_LATENCY_US, SDCARD_EMU_READ_NEXT_LATENCY_US,
+	 SDCARD_EMU_WRITE_BUSY_US, SDCARD_EMU_WRITE_NEXT_BUSY_US, SDCARD_EMU_WRITE_STOP_BUSY_US);
+
+  // raw sectors
+  RawWrite(0, 1, &single);
+  RawWrite(1, 2, &multi);
+  ResultPrint("Raw write (1 MB)", &single, &multi);
+
+  RawRead(0, 2, &single);
+  RawRead(1, 2, &multi);
+  ResultPrint("Raw read (1 MB)", &single, &multi);
+
+  // session with FatFs
+  f_mount(0, &fs);
+  if( f_mkfs(0, 1, CLUSTER_SIZE) != FR_OK ) {
+    printf("ERROR: f_mkfs failed\n");
+    return 1;
+  }
+  Check(f_mkdir("/SESSION") == FR_OK, "f_mkdir failed");
+
+  printf("Session: %u sectors, %u byte chunks, %u byte clusters\n", SessionSectors(), chunk_size, CLUSTER_SIZE);
+
+  single_block_mode = 1;
+  SessionStore(&single, chunk_size);
+  single_block_mode = 0;
+  SessionStore(&multi, chunk_size);
+  ResultPrint("Session store (FatFs)", &single, &multi);
+
+  single_block_mode = 1;
+  SessionLoad(&single, chunk_size);
+  single_block_mode = 0;
+  SessionLoad(&multi, chunk_size);
+  ResultPrint("Session load (FatFs)", &single, &multi);
+
+  Check(MIOS32_SDCARD_CheckAvailable(1) == 1, "SD Card not available after transfers");
+
+  SDCARD_EMU_Close();
+  remove(image_file);
+
+  printf("%s\n", errors ? "FAILED" : "PASSED");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,501 @@
+// $Id$
+/*
+ * SPI level emulation of a SD Card
+ *
+ * The MIOS32_SPI functions used by mios32_sdcard.c are emulated by a state
+ * machine which behaves like a SDHC card in SPI mode, the card content is
+ * stored in an image file on the host. This allows to run the unmodified
+ * MIOS32_SDCARD driver (and FatFs/DOSFS on top of it) on a PC.
+ *
+ * The delays of the card (read access time, programming time) are emulated
+ * with "not ready" and "busy" bytes, so that the number of transfered bytes
+ * and the accumulated SPI transfer time give a realistic estimation of the
+ * throughput on the STM32 (72 MHz core clock, SPI prescaler 4 = 18 MBit/s)
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sdcard_emu.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local definitions
+/////////////////////////////////////////////////////////////////////////////
+
+#define PERIPHERAL_CLOCK_MHZ 72
+
+// size of the output queue, has to be a power of 2 and must be able to store
+// the longest emulated delay + one data block
+#define OUT_QUEUE_SIZE 16384
+
+#define R1_IDLE            0x01
+#define R1_ILLEGAL_COMMAND 0x04
+#define R1_ADDRESS_ERROR   0x20
+
+typedef enum {
+  CARD_STATE_CMD,          // waiting for command
+  CARD_STATE_READ_MULTI,   // sending blocks until CMD12 is received
+  CARD_STATE_WRITE_SINGLE, // waiting for data token
+  CARD_STATE_WRITE_MULTI,  // waiting for data or stop token
+  CARD_STATE_WRITE_DATA    // receiving data block
+} card_state_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global variables
+/////////////////////////////////////////////////////////////////////////////
+
+sdcard_emu_stats_t sdcard_emu_stats;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local variables
+/////////////////////////////////////////////////////////////////////////////
+
+static FILE *image;
+static u32 image_sectors;
+
+static u32 byte_time_ps = (8 * 4 * 1000000) / PERIPHERAL_CLOCK_MHZ; // 18 MBit/s
+static u8 cs_active;
+
+static card_state_t card_state;
+static card_state_t write_state; // state after data block has been received
+static u8 card_idle;
+static u8 app_cmd;
+static u8 init_retries;
+
+static u8 cmd_buffer[6];
+static u8 cmd_len;
+
+static u32 block_sector;
+static u8 block_buffer[512+2];
+static u16 block_len;
+
+static u8 out_queue[OUT_QUEUE_SIZE];
+static u32 out_head;
+static u32 out_tail;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Output queue
+/////////////////////////////////////////////////////////////////////////////
+static void OutClear(void)
+{
+  out_head = out_tail = 0;
+}
+
+static void OutPush(u8 b)
+{
+  if( (out_head - out_tail) < OUT_QUEUE_SIZE )
+    out_queue[out_head++ & (OUT_QUEUE_SIZE-1)] = b;
+}
+
+static void OutPushDelay(u8 b, u32 delay_us)
+{
+  // the delay is converted into a number of bytes at the current SPI speed
+  u32 num = (u32)(((unsigned long long)delay_us * 1000000 + byte_time_ps - 1) / byte_time_ps);
+  while( num-- )
+    OutPush(b);
+}
+
+static void OutPushBlock(u8 *data, u32 len)
+{
+  while( len-- )
+    OutPush(*data++);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Sends a sector as data block
+/////////////////////////////////////////////////////////////////////////////
+static u8 SectorSend(u32 sector, u32 latency_us)
+{
+  u8 buffer[512];
+
+  if( sector >= image_sectors ||
+      fseek(image, (long)sector * 512, SEEK_SET) != 0 ||
+      fread(buffer, 512, 1, image) != 1 ) {
+    OutPush(0x08); // data error token: out of range
+    return 0;
+  }
+
+  ++sdcard_emu_stats.blocks_read;
+
+  OutPushDelay(0xff, latency_us);
+  OutPush(0xfe); // start token
+  OutPushBlock(buffer, 512);
+  OutPush(0xff); // CRC (not checked by driver)
+  OutPush(0xff);
+
+  return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Executes a command
+/////////////////////////////////////////////////////////////////////////////
+static void CommandExecute(void)
+{
+  u8 cmd = cmd_buffer[0] & 0x3f;
+  u32 arg = (cmd_buffer[1] << 24) | (cmd_buffer[2] << 16) | (cmd_buffer[3] << 8) | cmd_buffer[4];
+  u8 is_app_cmd = app_cmd;
+  u8 r1 = card_idle ? R1_IDLE : 0x00;
+
+  app_cmd = 0;
+  ++sdcard_emu_stats.commands[cmd];
+
+  // STOP_TRANSMISSION: the current data byte is followed by R1 and busy state
+  if( cmd == 12 ) {
+    OutClear();
+    OutPush(0x3c); // stuff byte, contains remaining data
+    OutPush(r1);
+    OutPush(0x00);
+    card_state = CARD_STATE_CMD;
+    return;
+  }
+
+  OutPush(0xff); // NCR
+
+  // reading multiple blocks is only terminated by CMD12
+  if( card_state == CARD_STATE_READ_MULTI ) {
+    OutPush(R1_ILLEGAL_COMMAND);
+    return;
+  }
+
+  if( is_app_cmd ) {
+    switch( cmd ) {
+    case 41: // SEND_OP_COND
+      // the card needs some retries until it's initialized
+      if( card_idle && ++init_retries >= 3 )
+	card_idle = 0;
+      OutPush(card_idle ? R1_IDLE : 0x00);
+      return;
+
+    case 23: // SET_WR_BLK_ERASE_COUNT
+      OutPush(r1);
+      return;
+    }
+  }
+
+  switch( cmd ) {
+  case 0: // GO_IDLE_STATE
+    card_idle = 1;
+    init_retries = 0;
+    OutPush(R1_IDLE);
+    break;
+
+  case 8: // SEND_IF_COND: R7 response
+    OutPush(r1);
+    OutPush(0x00);
+    OutPush(0x00);
+    OutPush((arg >> 8) & 0x0f);
+    OutPush(arg & 0xff);
+    break;
+
+  case 58: // READ_OCR: R3 response, power up and high capacity bit set
+    OutPush(r1);
+    OutPush(card_idle ? 0x40 : 0xc0);
+    OutPush(0xff);
+    OutPush(0x80);
+    OutPush(0x00);
+    break;
+
+  case 55: // APP_CMD
+    app_cmd = 1;
+    OutPush(r1);
+    break;
+
+  case 13: // SEND_STATUS: R2 response
+    OutPush(r1);
+    OutPush(0x00);
+    break;
+
+  case 16: // SET_BLOCKLEN
+    OutPush(r1);
+    break;
+
+  case 9: { // SEND_CSD: CSD version 2.0
+    u8 csd[16];
+    u32 c_size = (image_sectors >> 10) - 1;
+    memset(csd, 0, sizeof(csd));
+    csd[0] = 0x40;
+    csd[1] = 0x0e;
+    csd[3] = 0x32;
+    csd[4] = 0x5b;
+    csd[5] = 0x59;
+    csd[7] = (c_size >> 16) & 0x3f;
+    csd[8] = (c_size >> 8) & 0xff;
+    csd[9] = c_size & 0xff;
+    csd[12] = 0x0a;
+    csd[13] = 0x40;
+    OutPush(r1);
+    OutPushDelay(0xff, 10);
+    OutPush(0xfe);
+    OutPushBlock(csd, 16);
+    OutPush(0xff);
+    OutPush(0xff);
+  } break;
+
+  case 10: { // SEND_CID
+    u8 cid[16] = { 0x03, 'M', 'B', 'E', 'M', 'U', 'L', 0x10, 0, 0, 0, 1, 0x00, 0xa4, 0x00, 0x01 };
+    OutPush(r1);
+    OutPushDelay(0xff, 10);
+    OutPush(0xfe);
+    OutPushBlock(cid, 16);
+    OutPush(0xff);
+    OutPush(0xff);
+  } break;
+
+  case 17: // READ_SINGLE_BLOCK
+  case 18: // READ_MULTIPLE_BLOCK
+    if( card_idle ) {
+      OutPush(R1_ILLEGAL_COMMAND | R1_IDLE);
+    } else if( arg >= image_sectors ) {
+      OutPush(R1_ADDRESS_ERROR);
+    } else {
+      OutPush(r1);
+      SectorSend(arg, SDCARD_EMU_READ_LATENCY_US);
+      if( cmd == 18 ) {
+	block_sector = arg + 1;
+	card_state = CARD_STATE_READ_MULTI;
+      }
+    }
+    break;
+
+  case 24: // WRITE_BLOCK
+  case 25: // WRITE_MULTIPLE_BLOCK
+    if( card_idle ) {
+      OutPush(R1_ILLEGAL_COMMAND | R1_IDLE);
+    } else if( arg >= image_sectors ) {
+      OutPush(R1_ADDRESS_ERROR);
+    } else {
+      OutPush(r1);
+      block_sector = arg;
+      card_state = (cmd == 24) ? CARD_STATE_WRITE_SINGLE : CARD_STATE_WRITE_MULTI;
+    }
+    break;
+
+  default:
+    OutPush(r1 | R1_ILLEGAL_COMMAND);
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Handles a byte received from the SPI master
+/////////////////////////////////////////////////////////////////////////////
+static void ByteReceive(u8 b)
+{
+  switch( card_state ) {
+  case CARD_STATE_WRITE_SINGLE:
+  case CARD_STATE_WRITE_MULTI:
+    if( out_head != out_tail )
+      return; // still busy
+
+    if( (card_state == CARD_STATE_WRITE_SINGLE && b == 0xfe) ||
+	(card_state == CARD_STATE_WRITE_MULTI && b == 0xfc) ) {
+      write_state = card_state;
+      card_state = CARD_STATE_WRITE_DATA;
+      block_len = 0;
+    } else if( card_state == CARD_STATE_WRITE_MULTI && b == 0xfd ) {
+      // stop token: one byte delay, thereafter busy
+      OutPush(0xff);
+      OutPushDelay(0x00, SDCARD_EMU_WRITE_STOP_BUSY_US);
+      card_state = CARD_STATE_CMD;
+    }
+    return;
+
+  case CARD_STATE_WRITE_DATA:
+    block_buffer[block_len++] = b;
+    if( block_len >= sizeof(block_buffer) ) {
+      if( block_sector >= image_sectors ||
+	  fseek(image, (long)block_sector * 512, SEEK_SET) != 0 ||
+	  fwrite(block_buffer, 512, 1, image) != 1 ) {
+	OutPush(0x0d); // data rejected due to write error
+	card_state = CARD_STATE_CMD;
+	return;
+      }
+      ++sdcard_emu_stats.blocks_written;
+      ++block_sector;
+
+      OutPush(0x05); // data accepted
+      if( write_state == CARD_STATE_WRITE_SINGLE ) {
+	OutPushDelay(0x00, SDCARD_EMU_WRITE_BUSY_US);
+	card_state = CARD_STATE_CMD;
+      } else {
+	OutPushDelay(0x00, SDCARD_EMU_WRITE_NEXT_BUSY_US);
+	card_state = CARD_STATE_WRITE_MULTI;
+      }
+    }
+    return;
+
+  default:
+    // commands start with 01xxxxxx
+    if( cmd_len == 0 && (b & 0xc0) != 0x40 )
+      return;
+
+    cmd_buffer[cmd_len++] = b;
+    if( cmd_len >= 6 ) {
+      cmd_len = 0;
+      CommandExecute();
+    }
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Creates an empty image with the given number of sectors
+// (has to be a multiple of 1024 sectors, since the size is reported in 512k units)
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_EMU_Create(char *filename, u32 sectors)
+{
+  SDCARD_EMU_Close();
+
+  if( (image=fopen(filename, "w+b")) == NULL )
+    return -1; // file can't be created
+
+  // sparse file
+  if( fseek(image, (long)sectors * 512 - 1, SEEK_SET) != 0 || fputc(0, image) == EOF )
+    return -2; // write error
+
+  image_sectors = sectors;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Opens an existing image (SD Card connected)
+// returns < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_EMU_Open(char *filename)
+{
+  SDCARD_EMU_Close();
+
+  if( (image=fopen(filename, "r+b")) == NULL )
+    return -1; // file not found
+
+  fseek(image, 0, SEEK_END);
+  image_sectors = ftell(image) / 512;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Closes the image (SD Card removed)
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_EMU_Close(void)
+{
+  if( image != NULL )
+    fclose(image);
+  image = NULL;
+  image_sectors = 0;
+
+  card_state = CARD_STATE_CMD;
+  card_idle = 1;
+  cmd_len = 0;
+  OutClear();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Resets the statistics
+/////////////////////////////////////////////////////////////////////////////
+s32 SDCARD_EMU_StatsReset(void)
+{
+  memset(&sdcard_emu_stats, 0, sizeof(sdcard_emu_stats));
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Emulated MIOS32_SPI and MIOS32_DELAY functions
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_SPI_IO_Init(u8 spi, mios32_spi_pin_driver_t spi_pin_driver)
+{
+  return 0; // no error
+}
+
+s32 MIOS32_SPI_TransferModeInit(u8 spi, mios32_spi_mode_t spi_mode, mios32_spi_prescaler_t spi_prescaler)
+{
+  // SPI clock = peripheral clock / (2 << prescaler)
+  byte_time_ps = (8 * (2 << spi_prescaler) * 1000000) / PERIPHERAL_CLOCK_MHZ;
+  return 0; // no error
+}
+
+s32 MIOS32_SPI_RC_PinSet(u8 spi, u8 rc_pin, u8 pin_value)
+{
+  u8 active = pin_value ? 0 : 1;
+
+  // a deselected card aborts incomplete commands and discards pending output
+  if( cs_active && !active ) {
+    cmd_len = 0;
+    if( card_state == CARD_STATE_READ_MULTI )
+      card_state = CARD_STATE_CMD;
+    OutClear();
+  }
+  cs_active = active;
+
+  return 0; // no error
+}
+
+s32 MIOS32_SPI_TransferByte(u8 spi, u8 b)
+{
+  ++sdcard_emu_stats.spi_bytes;
+  sdcard_emu_stats.spi_time_ps += byte_time_ps;
+
+  if( image == NULL || !cs_active )
+    return 0xff; // DO is high-Z
+
+  u8 ret = 0xff;
+  if( out_head != out_tail ) {
+    ret = out_queue[out_tail++ & (OUT_QUEUE_SIZE-1)];
+  } else if( card_state == CARD_STATE_READ_MULTI ) {
+    // prepare next block
+    if( !SectorSend(block_sector++, SDCARD_EMU_READ_NEXT_LATENCY_US) )
+      card_state = CARD_STATE_CMD;
+    ret = out_queue[out_tail++ & (OUT_QUEUE_SIZE-1)];
+  }
+
+  ByteReceive(b);
+
+  return ret;
+}
+
+s32 MIOS32_SPI_TransferBlock(u8 spi, u8 *send_buffer, u8 *receive_buffer, u16 len, void *callback)
+{
+  u16 i;
+
+  for(i=0; i<len; ++i) {
+    u8 b = MIOS32_SPI_TransferByte(spi, send_buffer ? send_buffer[i] : 0xff);
+    if( receive_buffer )
+      receive_buffer[i] = b;
+  }
+
+  return 0; // no error
+}
+
+s32 MIOS32_DELAY_Wait_uS(u16 uS)
+{
+  sdcard_emu_stats.spi_time_ps += (unsigned long long)uS * 1000000;
+  return 0; // no error
+}
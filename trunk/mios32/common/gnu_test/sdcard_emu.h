@@ -0,0 +1,80 @@
+// $Id$
+/*
+ * Header for the SPI level emulation of a SD Card
+ *
+ * ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+#ifndef _SDCARD_EMU_H
+#define _SDCARD_EMU_H
+
+/////////////////////////////////////////////////////////////////////////////
+// Global definitions
+/////////////////////////////////////////////////////////////////////////////
+
+// card model: delays of the card in uS, they are emulated by 0xff (data not
+// ready) resp. 0x00 (busy) bytes at the current SPI frequency
+
+// access time until the first data token of a read command
+#ifndef SDCARD_EMU_READ_LATENCY_US
+#define SDCARD_EMU_READ_LATENCY_US 100
+#endif
+
+// access time of the subsequent blocks of a multi block read
+#ifndef SDCARD_EMU_READ_NEXT_LATENCY_US
+#define SDCARD_EMU_READ_NEXT_LATENCY_US 5
+#endif
+
+// programming time of a single block write
+#ifndef SDCARD_EMU_WRITE_BUSY_US
+#define SDCARD_EMU_WRITE_BUSY_US 1000
+#endif
+
+// programming time of the subsequent blocks of a (pre-erased) multi block write
+#ifndef SDCARD_EMU_WRITE_NEXT_BUSY_US
+#define SDCARD_EMU_WRITE_NEXT_BUSY_US 50
+#endif
+
+// programming time after the stop token of a multi block write
+#ifndef SDCARD_EMU_WRITE_STOP_BUSY_US
+#define SDCARD_EMU_WRITE_STOP_BUSY_US 1000
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Global Types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  unsigned long long spi_time_ps; // transfer time of all SPI bytes and delays in pS
+  u32 spi_bytes;
+  u32 commands[64];               // number of received commands, indexed by CMD<n>
+  u32 blocks_read;
+  u32 blocks_written;
+} sdcard_emu_stats_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+extern s32 SDCARD_EMU_Create(char *filename, u32 sectors);
+extern s32 SDCARD_EMU_Open(char *filename);
+extern s32 SDCARD_EMU_Close(void);
+
+extern s32 SDCARD_EMU_StatsReset(void);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Export global variables
+/////////////////////////////////////////////////////////////////////////////
+
+extern sdcard_emu_stats_t sdcard_emu_stats;
+
+#endif /* _SDCARD_EMU_H */
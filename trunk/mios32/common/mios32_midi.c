@@ -23,6 +23,9 @@
 #include <mios32.h>
 #include <string.h>
 #include <stdarg.h>
+#if defined(MIOS32_FAMILY_EMULATION)
+#include <sys/time.h>
+#endif
 
 // this module can be optionally disabled in a local mios32_config.h file (included from mios32.h)
 #if !defined(MIOS32_DONT_USE_MIDI)
@@ -104,13 +107,7 @@ typedef union {
     unsigned CTR:3;
     unsigned MY_SYSEX:1;
     unsigned CMD:1;
-  };
-
-  struct {
-    unsigned CTR:3;
-    unsigned MY_SYSEX:1;
-    unsigned CMD:1;
-    unsigned PING_BYTE_RECEIVED;
+    unsigned PING_BYTE_RECEIVED:1;
   };
 } sysex_state_t;
 
@@ -163,6 +160,24 @@ static mios32_midi_port_t last_sysex_port = DEFAULT;
 static u16 sysex_timeout_ctr;
 static sysex_timeout_ctr_flags_t sysex_timeout_ctr_flags;
 
+// interfaces which are checked by MIOS32_MIDI_Receive_Handler(), sorted by priority
+static mios32_midi_rx_intf_t rx_intf[MIOS32_MIDI_RX_INTF_NUM];
+static u8 rx_intf_num;
+
+// time budget of MIOS32_MIDI_Receive_Handler() in uS
+static u16 rx_budget_us;
+
+// ports which are tapped for realtime messages (see MIOS32_MIDI_RealtimeTap_Init())
+static mios32_midi_port_t realtime_tap_port[MIOS32_MIDI_REALTIME_TAP_NUM];
+static s32 (*realtime_tap_func[MIOS32_MIDI_REALTIME_TAP_NUM])(mios32_midi_port_t port, u8 midi_byte, u32 timestamp);
+static u8 realtime_tap_num;
+
+#if !defined(MIOS32_FAMILY_EMULATION)
+// uS timestamp, and the cycle counter value it refers to (see MIOS32_MIDI_TimestampGet())
+static u32 timestamp_us;
+static u32 timestamp_cycles;
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
@@ -203,6 +218,9 @@ s32 MIOS32_MIDI_Init(u32 mode)
   timeout_callback_func = NULL;
   debug_command_callback_func = NULL;
 
+  // no realtime taps
+  realtime_tap_num = 0;
+
   // initialize interfaces
 #if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI)
   if( MIOS32_USB_MIDI_Init(0) < 0 )
@@ -229,6 +247,31 @@ s32 MIOS32_MIDI_Init(u32 mode)
   sysex_timeout_ctr = 0;
   sysex_timeout_ctr_flags.ALL = 0;
 
+  // interfaces which are checked by MIOS32_MIDI_Receive_Handler()
+  rx_intf_num = 0;
+  rx_budget_us = MIOS32_MIDI_RX_BUDGET_US;
+#if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI)
+  MIOS32_MIDI_RxInterfaceAdd(USB0, MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY, 1);
+#endif
+#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI)
+#if MIOS32_UART_NUM >= 1 && MIOS32_UART0_ASSIGNMENT == 1
+  MIOS32_MIDI_RxInterfaceAdd(UART0, MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY, 1);
+#endif
+#if MIOS32_UART_NUM >= 2 && MIOS32_UART1_ASSIGNMENT == 1
+  MIOS32_MIDI_RxInterfaceAdd(UART1, MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY, 1);
+#endif
+#if MIOS32_UART_NUM >= 3 && MIOS32_UART2_ASSIGNMENT == 1
+  MIOS32_MIDI_RxInterfaceAdd(UART2, MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY, 1);
+#endif
+#endif
+#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
+  {
+    int i;
+    for(i=0; i<8; ++i)
+      MIOS32_MIDI_RxInterfaceAdd(IIC0 + i, MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY, 1);
+  }
+#endif
+
   return -ret;
 }
 
@@ -274,6 +317,86 @@ s32 MIOS32_MIDI_CheckAvailable(mios32_midi_port_t port)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! This function returns the statistics of the Rx and Tx buffer of a given
+//! MIDI port: the number of usable slots, the high-water mark and the
+//! number of dropped items (bytes for UART, packages for USB).<BR>
+//! Useful to find out if the buffer sizes (e.g. MIOS32_UART_RX_BUFFER_SIZE,
+//! MIOS32_USB_MIDI_TX_BUFFER_SIZE) are sufficient for an application.
+//! \param[in] port MIDI port (DEFAULT, USB0..USB7, UART0..UART2)
+//! \param[out] stats pointer to the statistics structure
+//! \return -1 if port not available or if it doesn't provide statistics
+//! \return 0 on success
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_BufferStatsGet(mios32_midi_port_t port, mios32_midi_buffer_stats_t *stats)
+{
+  // if default/debug port: select mapped port
+  if( !(port & 0xf0) ) {
+    port = (port == MIDI_DEBUG) ? debug_port : default_port;
+  }
+
+  // branch depending on selected port
+  switch( port & 0xf0 ) {
+    case USB0://..15
+#if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI)
+      return MIOS32_USB_MIDI_BufferStatsGet(&stats->rx, &stats->tx);
+#else
+      return -1; // USB has been disabled
+#endif
+
+    case UART0://..15
+#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI)
+      return MIOS32_UART_BufferStatsGet(port & 0xf, &stats->rx, &stats->tx);
+#else
+      return -1; // UART_MIDI has been disabled
+#endif
+
+    case IIC0://..15
+      return -1; // not supported by IIC_MIDI
+  }
+
+  return -1; // invalid port
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! This function resets the high-water marks and overrun counters of the
+//! Rx and Tx buffer of a given MIDI port
+//! \param[in] port MIDI port (DEFAULT, USB0..USB7, UART0..UART2)
+//! \return -1 if port not available or if it doesn't provide statistics
+//! \return 0 on success
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_BufferStatsReset(mios32_midi_port_t port)
+{
+  // if default/debug port: select mapped port
+  if( !(port & 0xf0) ) {
+    port = (port == MIDI_DEBUG) ? debug_port : default_port;
+  }
+
+  // branch depending on selected port
+  switch( port & 0xf0 ) {
+    case USB0://..15
+#if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI)
+      return MIOS32_USB_MIDI_BufferStatsReset();
+#else
+      return -1; // USB has been disabled
+#endif
+
+    case UART0://..15
+#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI)
+      return MIOS32_UART_BufferStatsReset(port & 0xf);
+#else
+      return -1; // UART_MIDI has been disabled
+#endif
+
+    case IIC0://..15
+      return -1; // not supported by IIC_MIDI
+  }
+
+  return -1; // invalid port
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! This function enables/disables running status optimisation for a given
 //! MIDI OUT port to improve bandwidth if MIDI events with the same
@@ -859,263 +982,511 @@ s32 MIOS32_MIDI_SendDebugHexDump(u8 *src, u32 len)
 
 
 /////////////////////////////////////////////////////////////////////////////
-//! Checks for incoming MIDI messages amd calls callback_package function
-//! with following parameters:
-//! \code
-//!    callback_package(mios32_midi_port_t port, mios32_midi_package_t midi_package)
-//! \endcode
+//! Adds an interface to the list of interfaces which are checked by
+//! MIOS32_MIDI_Receive_Handler(), or changes the priority/weight of an
+//! interface which is already in the list.
 //!
-//! Not for use in an application - this function is called by
-//! by a task in the programming model, callback_package is APP_MIDI_NotifyPackage()
+//! Interfaces are checked in the order of their priority. Once an interface
+//! delivered a package, all interfaces with a higher priority will be checked
+//! again before interfaces with a lower priority are serviced. Accordingly
+//! a port which receives MIDI clock (e.g. the clock master) can be
+//! prioritized over ports which receive large SysEx or controller streams.<BR>
+//! Interfaces with the same priority are serviced in a round robin manner,
+//! the weight defines the maximum number of packages which are taken from
+//! the interface before the next one is checked.
 //!
-//! SysEx streams can be optionally redirected to a separate callback function 
-//! which can be installed via MIOS32_MIDI_SysExCallback_Init()
+//! By default USB0, all UARTs which are assigned to MIDI and IIC0..IIC7 are
+//! added with priority MIOS32_MIDI_RX_INTF_DEFAULT_PRIORITY and weight 1
+//! (if the interfaces haven't been disabled in mios32_config.h)
 //!
-//! \return < 0 on errors
-/////////////////////////////////////////////////////////////////////////////
-s32 MIOS32_MIDI_Receive_Handler(void *_callback_package)
+//! Example:
+//! \code
+//!   // receive MIDI clock from UART1 with highest priority
+//!   MIOS32_MIDI_RxInterfaceAdd(UART1, 0, 1);
+//! \endcode
+//! \param[in] port USB0 (for all USB cables), UART0..UART2, IIC0..IIC7
+//! \param[in] priority 0 (highest) ... 255 (lowest)
+//! \param[in] weight number of packages which are handled at once (1..255)
+//! \return -1 if interface not supported (or disabled)
+//! \return -2 if the list is full (see MIOS32_MIDI_RX_INTF_NUM)
+//! \return >= 0: number of interfaces in the list
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RxInterfaceAdd(mios32_midi_port_t port, u8 priority, u8 weight)
 {
-  u8 port;
-  mios32_midi_package_t package;
-
-  void (*callback_package)(mios32_midi_port_t port, mios32_midi_package_t midi_package) = _callback_package;
-
-  u8 intf = 0; // interface to be checked
-  u8 total_packages_forwarded = 0; // number of forwards - stop after 10 forwards to yield some CPU time for other tasks
-  u8 packages_forwarded = 0;
-  u8 again = 1;
-  do {
-    // Round Robin
-    // TODO: maybe a list based approach would be better
-    // it would allow to add/remove interfaces dynamically
-    // this would also allow to give certain ports a higher priority (to add them multiple times to the list)
-    // it would also improve this spagetthi code ;)
-    s32 status = -1;
-    switch( intf++ ) {
+  switch( port & 0xf0 ) {
+    case USB0://..15
 #if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI)
-      case 0: status = MIOS32_USB_MIDI_PackageReceive(&package); port = USB0 + package.cable; break;
-#else
-      case 0: status = -1; break;
-#endif
-#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI) && MIOS32_UART0_ASSIGNMENT == 1
-      case 1: status = MIOS32_UART_MIDI_PackageReceive(0, &package); port = UART0; break;
-#else
-      case 1: status = -1; break;
-#endif
-#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI) && MIOS32_UART1_ASSIGNMENT == 1
-      case 2: status = MIOS32_UART_MIDI_PackageReceive(1, &package); port = UART1; break;
-#else
-      case 2: status = -1; break;
-#endif
-#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI) && MIOS32_UART2_ASSIGNMENT == 1
-      case 3: status = MIOS32_UART_MIDI_PackageReceive(2, &package); port = UART2; break;
-#else
-      case 3: status = -1; break;
-#endif
-#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 4: status = MIOS32_IIC_MIDI_PackageReceive(0, &package); port = IIC0; break;
-#else
-      case 4: status = -1; break;
-#endif
-#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 5: status = MIOS32_IIC_MIDI_PackageReceive(1, &package); port = IIC1; break;
+      port = USB0; // the USB driver delivers the packages of all cables
+      break;
 #else
-      case 5: status = -1; break;
+      return -1; // USB has been disabled
 #endif
-#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 6: status = MIOS32_IIC_MIDI_PackageReceive(2, &package); port = IIC2; break;
+
+    case UART0://..15
+#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI)
+      if( (port & 0xf) >= MIOS32_UART_NUM )
+	return -1; // UART not available
+      break;
 #else
-      case 6: status = -1; break;
+      return -1; // UART_MIDI has been disabled
 #endif
+
+    case IIC0://..15
 #if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 7: status = MIOS32_IIC_MIDI_PackageReceive(3, &package); port = IIC3; break;
+      if( (port & 0xf) >= 8 )
+	return -1; // IIC interface not available
+      break;
 #else
-      case 7: status = -1; break;
+      return -1; // IIC_MIDI has been disabled
 #endif
-#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 8: status = MIOS32_IIC_MIDI_PackageReceive(4, &package); port = IIC4; break;
+
+    default:
+      return -1; // interface not supported
+  }
+
+  if( weight == 0 )
+    weight = 1;
+
+  // if the interface is already in the list: remove it, it will be added again at the new position
+  MIOS32_MIDI_RxInterfaceRemove(port);
+
+  if( rx_intf_num >= MIOS32_MIDI_RX_INTF_NUM )
+    return -2; // list full
+
+  // insert behind all interfaces with the same or a higher priority
+  // the list is modified with MIOS32_IRQ_Disable() since it could be read by the receive handler
+  // (the list is small, and it's only changed during initialisation or on user request)
+  MIOS32_IRQ_Disable();
+
+  int ix = rx_intf_num;
+  while( ix > 0 && rx_intf[ix-1].priority > priority ) {
+    rx_intf[ix] = rx_intf[ix-1];
+    --ix;
+  }
+  rx_intf[ix].port = port;
+  rx_intf[ix].priority = priority;
+  rx_intf[ix].weight = weight;
+  ++rx_intf_num;
+
+  MIOS32_IRQ_Enable();
+
+  return rx_intf_num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Removes an interface from the list of interfaces which are checked by
+//! MIOS32_MIDI_Receive_Handler()<BR>
+//! Incoming packages of this interface won't be forwarded anymore, and
+//! stay in the receive buffer of the interface driver.
+//! \param[in] port USB0 (for all USB cables), UART0..UART2, IIC0..IIC7
+//! \return -1 if interface not in list
+//! \return >= 0: number of interfaces in the list
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RxInterfaceRemove(mios32_midi_port_t port)
+{
+  if( (port & 0xf0) == USB0 )
+    port = USB0;
+
+  int ix;
+  for(ix=0; ix<rx_intf_num; ++ix)
+    if( rx_intf[ix].port == port )
+      break;
+
+  if( ix >= rx_intf_num )
+    return -1; // interface not in list
+
+  MIOS32_IRQ_Disable();
+  for(; ix<(rx_intf_num-1); ++ix)
+    rx_intf[ix] = rx_intf[ix+1];
+  --rx_intf_num;
+  MIOS32_IRQ_Enable();
+
+  return rx_intf_num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns an entry of the receive interface list (e.g. for terminal output)
+//! \param[in] ix index of the entry (0..MIOS32_MIDI_RxInterfaceNumGet()-1)
+//! \param[out] intf pointer to the entry which will be filled
+//! \return -1 if entry doesn't exist
+//! \return 0 on success
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RxInterfaceGet(u8 ix, mios32_midi_rx_intf_t *intf)
+{
+  if( ix >= rx_intf_num )
+    return -1; // entry doesn't exist
+
+  *intf = rx_intf[ix];
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! \return number of interfaces which are checked by MIOS32_MIDI_Receive_Handler()
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RxInterfaceNumGet(void)
+{
+  return rx_intf_num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Sets the time budget of MIOS32_MIDI_Receive_Handler().<BR>
+//! Once the budget is exceeded, the handler returns to yield some CPU time
+//! for other tasks. Remaining packages will be handled on the next
+//! invocation.<BR>
+//! Note that the budget is checked after each interface, accordingly it
+//! can be exceeded by the time which is required to handle the packages
+//! of a single interface (which is limited by the weight).
+//! \param[in] budget_us budget in uS (0: no limit, handle all packages)
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RxBudgetSet(u16 budget_us)
+{
+  rx_budget_us = budget_us;
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! \return the time budget of MIOS32_MIDI_Receive_Handler() in uS
+/////////////////////////////////////////////////////////////////////////////
+u16 MIOS32_MIDI_RxBudgetGet(void)
+{
+  return rx_budget_us;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns a free running timestamp in uS which is used to check the time
+//! budget of MIOS32_MIDI_Receive_Handler(), and which is passed to realtime
+//! taps (see MIOS32_MIDI_RealtimeTap_Init()).
+//!
+//! On Cortex-M3 the DWT cycle counter is used, it's enabled with the first
+//! call. The timestamp wraps around after ca. 71 minutes, accordingly the
+//! difference between two timestamps should always be calculated with
+//! unsigned u32 arithmetic.
+//! \note the function has to be called at least once within 2^32 CPU cycles
+//! (ca. 59 seconds @72 MHz), otherwise the timestamp won't be continuous.
+//! This is ensured by MIOS32_MIDI_Periodic_mS() while realtime taps are
+//! installed.
+//! \return timestamp in uS
+/////////////////////////////////////////////////////////////////////////////
+u32 MIOS32_MIDI_TimestampGet(void)
+{
+#if defined(MIOS32_FAMILY_EMULATION)
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (u32)tv.tv_sec * 1000000 + tv.tv_usec;
 #else
-      case 8: status = -1; break;
+# define DWT_CTRL   (*(volatile u32 *)0xe0001000)
+# define DWT_CYCCNT (*(volatile u32 *)0xe0001004)
+# define CYCLES_PER_US (MIOS32_SYS_CPU_FREQUENCY / 1000000)
+
+  u32 timestamp;
+
+  // can be called from interrupts and tasks
+  MIOS32_IRQ_Disable();
+
+  if( !(DWT_CTRL & 1) ) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1; // CYCCNTENA
+    timestamp_cycles = 0;
+  }
+
+  // the cycle counter wraps after 2^32 cycles, accordingly it isn't
+  // sufficient to divide it by CYCLES_PER_US - instead the elapsed uS
+  // are accumulated, and the remaining cycles are taken over on the next call
+  u32 elapsed_us = (DWT_CYCCNT - timestamp_cycles) / CYCLES_PER_US;
+  timestamp_cycles += elapsed_us * CYCLES_PER_US;
+  timestamp_us += elapsed_us;
+  timestamp = timestamp_us;
+
+  MIOS32_IRQ_Enable();
+
+  return timestamp;
 #endif
-#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 9: status = MIOS32_IIC_MIDI_PackageReceive(5, &package); port = IIC5; break;
-#else
-      case 9: status = -1; break;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Gets a package from an interface of the receive list
+// IN: <port> interface (USB0, UART0..2, IIC0..7)
+// OUT: <package> the received package, <package_port> the port which
+//      should be passed to the callback function
+// returns -1 if no package available, -10 on timeout, >= 0 on success
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_MIDI_RxInterfacePackageReceive(mios32_midi_port_t port, mios32_midi_package_t *package, mios32_midi_port_t *package_port)
+{
+  s32 status = -1;
+
+  *package_port = port;
+
+  switch( port & 0xf0 ) {
+    case USB0://..15
+#if !defined(MIOS32_DONT_USE_USB) && !defined(MIOS32_DONT_USE_USB_MIDI)
+      if( (status=MIOS32_USB_MIDI_PackageReceive(package)) >= 0 )
+	*package_port = USB0 + package->cable;
 #endif
-#if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 10: status = MIOS32_IIC_MIDI_PackageReceive(6, &package); port = IIC6; break;
-#else
-      case 10: status = -1; break;
+      break;
+
+    case UART0://..15
+#if !defined(MIOS32_DONT_USE_UART) && !defined(MIOS32_DONT_USE_UART_MIDI)
+      status = MIOS32_UART_MIDI_PackageReceive(port & 0xf, package);
 #endif
+      break;
+
+    case IIC0://..15
 #if !defined(MIOS32_DONT_USE_IIC) && !defined(MIOS32_DONT_USE_IIC_MIDI)
-      case 11: status = MIOS32_IIC_MIDI_PackageReceive(7, &package); port = IIC7; break;
-#else
-      case 11: status = -1; break;
+      status = MIOS32_IIC_MIDI_PackageReceive(port & 0xf, package);
 #endif
-      default:
-	// allow 10 forwards maximum to yield some CPU time for other tasks
-	if( packages_forwarded && total_packages_forwarded < 10 ) {
-	  intf = 0; // restart with USB
-	  packages_forwarded = 0; // for checking, if packages still have been forwarded in next round
-	} else {
-	  again = 0; // no more interfaces to be processed
-	}
-	status = -1; // empty round - no message
-    }
+      break;
+  }
 
-    // timeout detected by interface?
-    if( status == -10 ) {
-      MIOS32_MIDI_TimeOut(port);
-      again = 0;
-    } else if( status >= 0 ) { // message received?
-      // notify that a package has been forwarded
-      ++packages_forwarded;
-      ++total_packages_forwarded;
+  return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Forwards a received package to the SysEx parser and the callback functions
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_MIDI_Receive_Package(void (*callback_package)(mios32_midi_port_t port, mios32_midi_package_t midi_package), mios32_midi_port_t port, mios32_midi_package_t package)
+{
+  // remove cable number from package (MIOS32_MIDI passes it's own port number)
+  package.cable = 0;
 
-      // remove cable number from package (MIOS32_MIDI passes it's own port number)
-      package.cable = 0;
+  // branch depending on package type
+  if( package.type >= 0x8 && package.type < 0xf ) {
+    if( callback_package != NULL )
+      callback_package(port, package);
+  } else {
+    u8 filter_sysex = 0;
 
-      // branch depending on package type
-      if( package.type >= 0x8 && package.type < 0xf ) {
+    switch( package.type ) {
+      case 0x0: // reserved, ignore
+      case 0x1: // cable events, ignore
+	break;
+
+      case 0x2: // Two-byte System Common messages like MTC, SongSelect, etc.
+      case 0x3: // Three-byte System Common messages like SPP, etc.
 	if( callback_package != NULL )
+	  callback_package(port, package); // -> forwarded as event
+	break;
+
+      case 0x4: // SysEx starts or continues (3 bytes)
+      case 0xf: // Single byte is interpreted as SysEx as well (I noticed that portmidi sometimes sends single bytes!)
+
+	if( package.evnt0 >= 0xf8 ) { // relevant for package type 0xf
+	  if( callback_package != NULL )
+	    callback_package(port, package); // -> realtime event is forwarded as event
+	  break;
+	}
+
+	if( package.evnt0 == 0xf0 ) {
+	  // cheap timeout mechanism - see comments above the sysex_timeout_ctr declaration
+	  if( !sysex_timeout_ctr_flags.ALL ) {
+	    switch( port & 0xf0 ) {
+	      case USB0://..15
+		sysex_timeout_ctr = 0;
+		sysex_timeout_ctr_flags.usb_receives = (1 << (port & 0xf));
+		break;
+	      case UART0://..15
+		// already done in MIOS32_UART_MIDI_PackageReceive()
+		break;
+	      case IIC0://..15
+		sysex_timeout_ctr = 0;
+		sysex_timeout_ctr_flags.iic_receives = (1 << (port & 0xf));
+		break;
+		// no timeout protection for remaining interfaces (yet)
+	    }
+	  }
+	}
+
+	MIOS32_MIDI_SYSEX_Parser(port, package.evnt0); // -> forward to MIOS32 SysEx Parser
+	if( package.type != 0x0f ) {
+	  MIOS32_MIDI_SYSEX_Parser(port, package.evnt1); // -> forward to MIOS32 SysEx Parser
+	  MIOS32_MIDI_SYSEX_Parser(port, package.evnt2); // -> forward to MIOS32 SysEx Parser
+	}
+
+	if( sysex_callback_func != NULL ) {
+	  filter_sysex |= sysex_callback_func(port, package.evnt0); // -> forwarded as SysEx
+	  if( package.type != 0x0f ) {
+	    filter_sysex |= sysex_callback_func(port, package.evnt1); // -> forwarded as SysEx
+	    filter_sysex |= sysex_callback_func(port, package.evnt2); // -> forwarded as SysEx
+	  }
+	}
+
+	if( callback_package != NULL && !filter_sysex )
 	  callback_package(port, package);
-      } else {
-	u8 filter_sysex = 0;
 
-	switch( package.type ) {
-  	  case 0x0: // reserved, ignore
-	  case 0x1: // cable events, ignore
-	    break;
+	break;
 
-	  case 0x2: // Two-byte System Common messages like MTC, SongSelect, etc. 
-	  case 0x3: // Three-byte System Common messages like SPP, etc. 
-	    if( callback_package != NULL )
-	      callback_package(port, package); // -> forwarded as event
-	    break;
+      case 0x5:   // Single-byte System Common Message or SysEx ends with following single byte.
+	if( package.evnt0 >= 0xf8 ) {
+	  if( callback_package != NULL )
+	    callback_package(port, package); // -> forwarded as event
+	  break;
+	}
+	// no >= 0xf8 event: continue!
+
+      case 0x6:   // SysEx ends with following two bytes.
+      case 0x7: { // SysEx ends with following three bytes.
+	u8 num_bytes = package.type - 0x5 + 1;
+	u8 current_byte = 0;
+
+	if( num_bytes >= 1 ) {
+	  current_byte = package.evnt0;
+	  MIOS32_MIDI_SYSEX_Parser(port, current_byte); // -> forward to MIOS32 SysEx Parser
+	  if( sysex_callback_func != NULL )
+	    filter_sysex |= sysex_callback_func(port, current_byte); // -> forwarded as SysEx
+	}
 
-	  case 0x4: // SysEx starts or continues (3 bytes)
-	  case 0xf: // Single byte is interpreted as SysEx as well (I noticed that portmidi sometimes sends single bytes!)
+	if( num_bytes >= 2 ) {
+	  current_byte = package.evnt1;
+	  MIOS32_MIDI_SYSEX_Parser(port, current_byte); // -> forward to MIOS32 SysEx Parser
+	  if( sysex_callback_func != NULL )
+	    filter_sysex |= sysex_callback_func(port, current_byte); // -> forwarded as SysEx
+	}
 
-	    if( package.evnt0 >= 0xf8 ) { // relevant for package type 0xf
-	      if( callback_package != NULL )
-		callback_package(port, package); // -> realtime event is forwarded as event
-	      break;
-	    }
+	if( num_bytes >= 3 ) {
+	  current_byte = package.evnt2;
+	  MIOS32_MIDI_SYSEX_Parser(port, current_byte); // -> forward to MIOS32 SysEx Parser
+	  if( sysex_callback_func != NULL )
+	    filter_sysex |= sysex_callback_func(port, current_byte); // -> forwarded as SysEx
+	}
 
-	    if( package.evnt0 == 0xf0 ) {
-	      // cheap timeout mechanism - see comments above the sysex_timeout_ctr declaration
-	      if( !sysex_timeout_ctr_flags.ALL ) {
-		switch( port & 0xf0 ) {
-		  case USB0://..15
-		    sysex_timeout_ctr = 0;
-		    sysex_timeout_ctr_flags.usb_receives = (1 << (port & 0xf));
-		    break;
-		  case UART0://..15
-		    // already done in MIOS32_UART_MIDI_PackageReceive()
-		    break;
-		  case IIC0://..15
-		    sysex_timeout_ctr = 0;
-		    sysex_timeout_ctr_flags.iic_receives = (1 << (port & 0xf));
-		    break;
-		    // no timeout protection for remaining interfaces (yet)
-		}
-	      }
-	    }
+	// reset timeout protection if required
+	if( current_byte == 0xf7 )
+	  sysex_timeout_ctr_flags.ALL = 0;
 
-	    MIOS32_MIDI_SYSEX_Parser(port, package.evnt0); // -> forward to MIOS32 SysEx Parser
-	    if( package.type != 0x0f ) {
-	      MIOS32_MIDI_SYSEX_Parser(port, package.evnt1); // -> forward to MIOS32 SysEx Parser
-	      MIOS32_MIDI_SYSEX_Parser(port, package.evnt2); // -> forward to MIOS32 SysEx Parser
-	    }
+	// forward as package if not filtered
+	if( callback_package != NULL && !filter_sysex )
+	  callback_package(port, package);
 
-	    if( sysex_callback_func != NULL ) {
-	      filter_sysex |= sysex_callback_func(port, package.evnt0); // -> forwarded as SysEx
-	      if( package.type != 0x0f ) {
-		filter_sysex |= sysex_callback_func(port, package.evnt1); // -> forwarded as SysEx
-		filter_sysex |= sysex_callback_func(port, package.evnt2); // -> forwarded as SysEx
-	      }
-	    }
+      } break;
+    }
+  }
 
-	    if( callback_package != NULL && !filter_sysex )
-	      callback_package(port, package);
+  return 0; // no error
+}
 
-	    break;
 
-	  case 0x5:   // Single-byte System Common Message or SysEx ends with following single byte. 
-	    if( package.evnt0 >= 0xf8 ) {
-	      if( callback_package != NULL )
-		callback_package(port, package); // -> forwarded as event
-	      break;
-	    }
-	    // no >= 0xf8 event: continue!
-
-	  case 0x6:   // SysEx ends with following two bytes.
-	  case 0x7: { // SysEx ends with following three bytes.
-	    u8 num_bytes = package.type - 0x5 + 1;
-	    u8 current_byte = 0;
-
-	    if( num_bytes >= 1 ) {
-	      current_byte = package.evnt0;
-	      MIOS32_MIDI_SYSEX_Parser(port, current_byte); // -> forward to MIOS32 SysEx Parser
-	      if( sysex_callback_func != NULL )
-		filter_sysex |= sysex_callback_func(port, current_byte); // -> forwarded as SysEx
-	    }
+/////////////////////////////////////////////////////////////////////////////
+// Checks for a SysEx timeout of packet oriented interfaces
+// returns 1 if a timeout has been notified
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_MIDI_Receive_TimeOutCheck(void)
+{
+  if( sysex_timeout_ctr_flags.ALL && sysex_timeout_ctr > 1000 ) {
+    u8 timeout_port = 0;
+
+    // determine port
+    if( sysex_timeout_ctr_flags.usb_receives ) {
+      int i; // i'm missing a prio instruction in C!
+      for(i=0; i<16; ++i)
+	if( sysex_timeout_ctr_flags.usb_receives & (1 << i) )
+	  break;
+      if( i >= 16 ) // failsafe
+	i = 0;
+      timeout_port = USB0 + i;
+    } else if( sysex_timeout_ctr_flags.iic_receives ) {
+      int i; // i'm missing a prio instruction in C!
+      for(i=0; i<16; ++i)
+	if( sysex_timeout_ctr_flags.iic_receives & (1 << i) )
+	  break;
+      if( i >= 16 ) // failsafe
+	i = 0;
+      timeout_port = IIC0 + i;
+    }
 
-	    if( num_bytes >= 2 ) {
-	      current_byte = package.evnt1;
-	      MIOS32_MIDI_SYSEX_Parser(port, current_byte); // -> forward to MIOS32 SysEx Parser
-	      if( sysex_callback_func != NULL )
-		filter_sysex |= sysex_callback_func(port, current_byte); // -> forwarded as SysEx
-	    }
+    MIOS32_MIDI_TimeOut(timeout_port);
+    sysex_timeout_ctr_flags.ALL = 0;
+    return 1; // timeout
+  }
 
-	    if( num_bytes >= 3 ) {
-	      current_byte = package.evnt2;
-	      MIOS32_MIDI_SYSEX_Parser(port, current_byte); // -> forward to MIOS32 SysEx Parser
-	      if( sysex_callback_func != NULL )
-		filter_sysex |= sysex_callback_func(port, current_byte); // -> forwarded as SysEx
-	    }
+  return 0; // no timeout
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Checks for incoming MIDI messages amd calls callback_package function
+//! with following parameters:
+//! \code
+//!    callback_package(mios32_midi_port_t port, mios32_midi_package_t midi_package)
+//! \endcode
+//!
+//! Not for use in an application - this function is called by
+//! by a task in the programming model, callback_package is APP_MIDI_NotifyPackage()
+//!
+//! SysEx streams can be optionally redirected to a separate callback function 
+//! which can be installed via MIOS32_MIDI_SysExCallback_Init()
+//!
+//! The interfaces are checked in the order of their priority, see
+//! MIOS32_MIDI_RxInterfaceAdd(). The handler returns once no new package
+//! has been received, or the time budget has been exceeded
+//! (see MIOS32_MIDI_RxBudgetSet()).
+//!
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_Receive_Handler(void *_callback_package)
+{
+  void (*callback_package)(mios32_midi_port_t port, mios32_midi_package_t midi_package) = _callback_package;
+
+  u32 budget_start = 0;
+  u8 budget_started = 0;
+  u8 level_forwarded = 0;
+  u8 ix = 0;
+
+  while( ix < rx_intf_num ) {
+    mios32_midi_rx_intf_t *intf = &rx_intf[ix];
+    u8 num_forwarded;
+
+    // take up to <weight> packages from this interface
+    for(num_forwarded=0; num_forwarded<intf->weight; ++num_forwarded) {
+      mios32_midi_package_t package;
+      mios32_midi_port_t port;
+      s32 status = MIOS32_MIDI_RxInterfacePackageReceive(intf->port, &package, &port);
+
+      // timeout detected by interface?
+      if( status == -10 ) {
+	MIOS32_MIDI_TimeOut(port);
+	return 0;
+      }
 
-	    // reset timeout protection if required
-	    if( current_byte == 0xf7 )
-	      sysex_timeout_ctr_flags.ALL = 0;
+      if( status < 0 )
+	break; // no new package
 
-	    // forward as package if not filtered
-	    if( callback_package != NULL && !filter_sysex )
-	      callback_package(port, package);
-	    
-	  } break;
-	}	  
+      // start time measurement with the first package
+      if( !budget_started ) {
+	budget_started = 1;
+	budget_start = MIOS32_MIDI_TimestampGet();
       }
+
+      MIOS32_MIDI_Receive_Package(callback_package, port, package);
     }
 
     // timeout detected by this handler?
-    if( sysex_timeout_ctr_flags.ALL && sysex_timeout_ctr > 1000 ) {
-      u8 timeout_port = 0;
-
-      // determine port
-      if( sysex_timeout_ctr_flags.usb_receives ) {
-	int i; // i'm missing a prio instruction in C!
-	for(i=0; i<16; ++i)
-	  if( sysex_timeout_ctr_flags.usb_receives & (1 << i) )
-	    break;
-	if( i >= 16 ) // failsafe
-	  i = 0;
-	timeout_port = USB0 + i;
-      } else if( sysex_timeout_ctr_flags.iic_receives ) {
-	int i; // i'm missing a prio instruction in C!
-	for(i=0; i<16; ++i)
-	  if( sysex_timeout_ctr_flags.iic_receives & (1 << i) )
-	    break;
-	if( i >= 16 ) // failsafe
-	  i = 0;
-	timeout_port = IIC0 + i;
-      }
-
-      MIOS32_MIDI_TimeOut(timeout_port);
-      sysex_timeout_ctr_flags.ALL = 0;
-      again = 0;
+    if( MIOS32_MIDI_Receive_TimeOutCheck() > 0 )
+      return 0;
+
+    // budget exceeded? Yield some CPU time for other tasks
+    if( num_forwarded && rx_budget_us && (u32)(MIOS32_MIDI_TimestampGet() - budget_start) >= rx_budget_us )
+      return 0;
+
+    if( num_forwarded )
+      level_forwarded = 1;
+
+    // end of priority level: check higher priority interfaces again if packages have been forwarded,
+    // otherwise continue with the next level
+    if( ++ix >= rx_intf_num || rx_intf[ix].priority != intf->priority ) {
+      if( level_forwarded )
+	ix = 0;
+      level_forwarded = 0;
     }
-  } while( again );
+  }
 
   return 0;
 }
@@ -1151,6 +1522,10 @@ s32 MIOS32_MIDI_Periodic_mS(void)
   if( sysex_timeout_ctr < 65535 )
     ++sysex_timeout_ctr;
 
+  // keep the timestamp of the realtime taps continuous
+  if( realtime_tap_num )
+    MIOS32_MIDI_TimestampGet();
+
   return status;
 }
 
@@ -1238,6 +1613,18 @@ s32 MIOS32_MIDI_DirectRxCallback_Init(void *callback_rx)
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_MIDI_SendByteToRxCallback(mios32_midi_port_t port, u8 midi_byte)
 {
+  // realtime messages are forwarded to the tap of the port (if installed)
+  // instead of the Rx callback
+  if( midi_byte >= 0xf8 && realtime_tap_num ) {
+    int i;
+    for(i=0; i<realtime_tap_num; ++i) {
+      if( realtime_tap_port[i] == port ) {
+	s32 (*tap_func)(mios32_midi_port_t port, u8 midi_byte, u32 timestamp) = realtime_tap_func[i];
+	return tap_func(port, midi_byte, MIOS32_MIDI_TimestampGet());
+      }
+    }
+  }
+
   // note: here we could filter the user hook execution on special situations
   if( direct_rx_callback_func != NULL )
     return direct_rx_callback_func(port, midi_byte);
@@ -1256,18 +1643,87 @@ s32 MIOS32_MIDI_SendByteToRxCallback(mios32_midi_port_t port, u8 midi_byte)
 s32 MIOS32_MIDI_SendPackageToRxCallback(mios32_midi_port_t port, mios32_midi_package_t midi_package)
 {
   // note: here we could filter the user hook execution on special situations
-  if( direct_rx_callback_func != NULL ) {
+  if( direct_rx_callback_func != NULL || realtime_tap_num ) {
     u8 buffer[3] = {midi_package.evnt0, midi_package.evnt1, midi_package.evnt2};
     int len = mios32_midi_pcktype_num_bytes[midi_package.cin];
     int i;
     s32 status = 0;
     for(i=0; i<len; ++i)
-      status |= direct_rx_callback_func(port, buffer[i]);
+      status |= MIOS32_MIDI_SendByteToRxCallback(port, buffer[i]);
     return status;
   }
   return 0; // no error
 }
 
+
+/////////////////////////////////////////////////////////////////////////////
+//! Installs a realtime tap for the given port.<BR>
+//! Realtime messages (0xf8..0xff) which are received by the port will be
+//! forwarded to the tap instead of the Rx callback (see
+//! MIOS32_MIDI_DirectRxCallback_Init()). Bytes which are received via UART
+//! are forwarded directly from the UART receive interrupt, i.e. before they
+//! are put into the receive queue, and before they have to wait for
+//! MIOS32_MIDI_Receive_Handler().
+//!
+//! The tap gets a timestamp in uS which has been taken on arrival of the
+//! byte (see MIOS32_MIDI_TimestampGet()). It is especially useful to sync
+//! a BPM generator to an incoming MIDI clock with low jitter.
+//!
+//! Like the Rx callback, the tap should be executed so fast as possible.
+//! \param[in] port MIDI port (USB0..USB7, UART0..UART3, IIC0..IIC7, ...)
+//! \param[in] *callback_realtime pointer to callback function:<BR>
+//! \code
+//!    s32 callback_realtime(mios32_midi_port_t port, u8 midi_byte, u32 timestamp)
+//!    {
+//!    }
+//! \endcode
+//! The byte will be forwarded into the MIDI Rx queue if the function returns 0.<BR>
+//! It will be filtered out if the callback returns != 0.<BR>
+//! Use NULL to remove the tap of a port.
+//! \return -1 if the port is invalid
+//! \return -2 if no free tap is available (see MIOS32_MIDI_REALTIME_TAP_NUM)
+//! \return >= 0: number of installed taps
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_MIDI_RealtimeTap_Init(mios32_midi_port_t port, void *callback_realtime)
+{
+  int i;
+
+  if( port == DEFAULT || port == MIDI_DEBUG )
+    return -1; // virtual ports can't be tapped
+
+  MIOS32_IRQ_Disable();
+
+  // search for existing tap
+  for(i=0; i<realtime_tap_num; ++i)
+    if( realtime_tap_port[i] == port )
+      break;
+
+  if( callback_realtime == NULL ) {
+    // remove tap (if it exists)
+    if( i < realtime_tap_num ) {
+      for(; i<(realtime_tap_num-1); ++i) {
+	realtime_tap_port[i] = realtime_tap_port[i+1];
+	realtime_tap_func[i] = realtime_tap_func[i+1];
+      }
+      --realtime_tap_num;
+    }
+  } else {
+    if( i >= MIOS32_MIDI_REALTIME_TAP_NUM ) {
+      MIOS32_IRQ_Enable();
+      return -2; // no free tap
+    }
+
+    realtime_tap_port[i] = port;
+    realtime_tap_func[i] = callback_realtime;
+    if( i >= realtime_tap_num )
+      realtime_tap_num = i + 1;
+  }
+
+  MIOS32_IRQ_Enable();
+
+  return realtime_tap_num;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //! This function allows to change the DEFAULT port.<BR>
 //! The preset which will be used after application reset can be set in
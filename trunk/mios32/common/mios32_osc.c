@@ -82,6 +82,12 @@
 //! An example for a search tree construction and OSC method handling can be found
 //! under $MIOS32_PATH/apps/examples/ethernet/osc
 //!
+//! For applications which receive a lot of OSC messages, the search tree can be
+//! compiled into a hashed search table with MIOS32_OSC_SearchTableCompile().
+//! MIOS32_OSC_ParsePacketTable() resolves each address part with a single
+//! hash lookup, and only falls back to the tree matcher for wildcards.<BR>
+//! The table costs 8 bytes RAM per slot.
+//!
 //!
 //! Client Part (sending OSC packets):
 //!
@@ -148,8 +154,14 @@
 // Local prototypes
 /////////////////////////////////////////////////////////////////////////////
 
-static s32 MIOS32_OSC_SearchElement(u8 *buffer, u32 len, mios32_osc_args_t *osc_args, mios32_osc_search_tree_t *search_tree);
+static s32 MIOS32_OSC_Parse(u8 *packet, u32 len, mios32_osc_search_tree_t *search_tree, mios32_osc_search_table_t *search_table, mios32_osc_scheduler_t *scheduler, unsigned long long now);
+static s32 MIOS32_OSC_SchedulerQueue(mios32_osc_scheduler_t *scheduler, u8 *element, u32 len, mios32_osc_timetag_t timetag, unsigned long long due);
+static u32 MIOS32_OSC_TimeToUs(unsigned long long time);
+static s32 MIOS32_OSC_SearchElement(u8 *buffer, u32 len, mios32_osc_args_t *osc_args, mios32_osc_search_tree_t *search_tree, mios32_osc_search_table_t *search_table);
 static s32 MIOS32_OSC_SearchPath(char *path, mios32_osc_args_t *osc_args, u32 method_arg, mios32_osc_search_tree_t *search_tree);
+static s32 MIOS32_OSC_SearchTable(char *path, mios32_osc_args_t *osc_args, mios32_osc_search_table_t *search_table);
+static s32 MIOS32_OSC_SearchTableInsert(mios32_osc_search_table_t *search_table, u16 parent, mios32_osc_search_tree_t *search_tree, u8 depth, u8 *tree_search);
+static u32 MIOS32_OSC_SearchTableHash(const char *part, u16 parent, size_t *part_len);
 
 static size_t my_strnlen(char *str, size_t max_len);
 
@@ -488,6 +500,45 @@ u8 *MIOS32_OSC_PutMIDI(u8 *buffer, mios32_midi_package_t p)
 //! returns -4 if MIOS32_OSC_MAX_PATH_PARTS has been exceeded
 /////////////////////////////////////////////////////////////////////////////
 s32 MIOS32_OSC_ParsePacket(u8 *packet, u32 len, mios32_osc_search_tree_t *search_tree)
+{
+  return MIOS32_OSC_Parse(packet, len, search_tree, NULL, NULL, 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Same as MIOS32_OSC_ParsePacket(), but the methods are searched in a
+//! search table which has been prepared with MIOS32_OSC_SearchTableCompile().
+//!
+//! Addresses without wildcards are resolved with one hash lookup per
+//! address part. Addresses with '*' or '?' wildcards, and hierarchy levels
+//! of the search tree which contain wildcards, are handled by the tree
+//! matcher, so that the same methods are called like with MIOS32_OSC_ParsePacket().
+//!
+//! The arguments are not copied: the pointers in mios32_osc_args_t point
+//! into the packet buffer, accordingly the buffer has to stay valid until
+//! the method returns.
+//! \param[in] packet pointer to OSC packet
+//! \param[in] len length of packet
+//! \param[in] search_table the compiled search table
+//! \return 0 if packet has been parsed w/o errors
+//! \return -1 if packet format invalid
+//! \return -2 if the packet contains an OSC element with invalid format
+//! \return -3 if the packet contains an OSC element with an unsupported format
+//! returns -4 if MIOS32_OSC_MAX_PATH_PARTS has been exceeded
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_ParsePacketTable(u8 *packet, u32 len, mios32_osc_search_table_t *search_table)
+{
+  return MIOS32_OSC_Parse(packet, len, search_table->search_tree, search_table, NULL, 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Internal function:
+// parses a packet or bundle, search_table is NULL if only the search tree
+// should be used, scheduler is NULL if bundles should be dispatched immediately
+// now: local time (32.32 fixed point) for the scheduler
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_OSC_Parse(u8 *packet, u32 len, mios32_osc_search_tree_t *search_tree, mios32_osc_search_table_t *search_table, mios32_osc_scheduler_t *scheduler, unsigned long long now)
 {
   // store osc arguments (and more...) into osc_args variable
   mios32_osc_args_t osc_args;
@@ -505,6 +556,44 @@ s32 MIOS32_OSC_ParsePacket(u8 *packet, u32 len, mios32_osc_search_tree_t *search
     osc_args.timetag = MIOS32_OSC_GetTimetag((u8 *)packet+pos);
     pos += 8;
 
+    // determine the due time if the bundle should be scheduled
+    // timetag 0.1 means "immediately"
+    unsigned long long due = 0;
+    u8 schedule = 0;
+    u8 late = 0;
+    if( scheduler != NULL && scheduler->mode != MIOS32_OSC_SCHEDULER_MODE_OFF &&
+	(osc_args.timetag.seconds != 0 || osc_args.timetag.fraction != 1) ) {
+      unsigned long long timetag = ((unsigned long long)osc_args.timetag.seconds << 32) | osc_args.timetag.fraction;
+
+      if( scheduler->mode == MIOS32_OSC_SCHEDULER_MODE_RELATIVE ) {
+	// the clock offset follows the fastest transfer immediately, and
+	// slowly increases again so that clock drifts are compensated
+	unsigned long long offset = now - timetag;
+	if( !scheduler->clock_offset_valid || (long long)(offset - scheduler->clock_offset) < 0 ) {
+	  scheduler->clock_offset = offset;
+	  scheduler->clock_offset_valid = 1;
+	} else {
+	  scheduler->clock_offset += (offset - scheduler->clock_offset) >> 12;
+	}
+	timetag += scheduler->clock_offset;
+      }
+
+      due = timetag + (((unsigned long long)scheduler->latency_us << 32) / 1000000);
+
+      long long early = (long long)(due - now);
+      if( early > 0 ) {
+	u32 early_us = MIOS32_OSC_TimeToUs(early);
+	schedule = 1;
+	if( early_us > scheduler->stats.max_early_us )
+	  scheduler->stats.max_early_us = early_us;
+      } else {
+	u32 late_us = MIOS32_OSC_TimeToUs(-early);
+	late = 1;
+	if( late_us > scheduler->stats.max_late_us )
+	  scheduler->stats.max_late_us = late_us;
+      }
+    }
+
     // parse elements
     while( (pos+4) <= len ) {
       // get element size
@@ -516,8 +605,16 @@ s32 MIOS32_OSC_ParsePacket(u8 *packet, u32 len, mios32_osc_search_tree_t *search
 	return -1; // invalid packet
 
       // parse element if size > 0
-      if( elem_size ) {
-	s32 status = MIOS32_OSC_SearchElement((u8 *)(packet+pos), elem_size, &osc_args, search_tree);
+      // if the element is queued, it will be parsed by MIOS32_OSC_SchedulerHandler()
+      if( elem_size && (!schedule || MIOS32_OSC_SchedulerQueue(scheduler, (u8 *)(packet+pos), elem_size, osc_args.timetag, due) < 0) ) {
+	if( scheduler != NULL && !schedule ) {
+	  if( late )
+	    ++scheduler->stats.late;
+	  else
+	    ++scheduler->stats.immediate;
+	}
+
+	s32 status = MIOS32_OSC_SearchElement((u8 *)(packet+pos), elem_size, &osc_args, search_tree, search_table);
 	if( status < 0 )
 	  return status;
       }
@@ -531,7 +628,10 @@ s32 MIOS32_OSC_ParsePacket(u8 *packet, u32 len, mios32_osc_search_tree_t *search
     osc_args.timetag.seconds = 0;
     osc_args.timetag.fraction = 1;
 
-    s32 status = MIOS32_OSC_SearchElement(packet, len, &osc_args, search_tree);
+    if( scheduler != NULL )
+      ++scheduler->stats.immediate;
+
+    s32 status = MIOS32_OSC_SearchElement(packet, len, &osc_args, search_tree, search_table);
     if( status < 0 )
       return status;
   }
@@ -547,7 +647,7 @@ s32 MIOS32_OSC_ParsePacket(u8 *packet, u32 len, mios32_osc_search_tree_t *search
 // returns -3 if element contains an unsupported format
 // returns -4 if MIOS32_OSC_MAX_PATH_PARTS has been exceeded
 /////////////////////////////////////////////////////////////////////////////
-static s32 MIOS32_OSC_SearchElement(u8 *buffer, u32 len, mios32_osc_args_t *osc_args, mios32_osc_search_tree_t *search_tree)
+static s32 MIOS32_OSC_SearchElement(u8 *buffer, u32 len, mios32_osc_args_t *osc_args, mios32_osc_search_tree_t *search_tree, mios32_osc_search_table_t *search_table)
 {
   // exit immediately if element is empty
   if( !len )
@@ -675,7 +775,11 @@ static s32 MIOS32_OSC_SearchElement(u8 *buffer, u32 len, mios32_osc_args_t *osc_
   }
 
   // finally parse for elements which are matching the OSC address
+  // addresses with wildcards have to be compared with each node of the tree
   osc_args->num_path_parts = 0;
+  if( search_table != NULL && strpbrk((char *)path, "*?") == NULL )
+    return MIOS32_OSC_SearchTable((char *)&path[1], osc_args, search_table);
+
   return MIOS32_OSC_SearchPath((char *)&path[1], osc_args, 0x00000000, search_tree);
 }
 
@@ -756,6 +860,529 @@ static s32 MIOS32_OSC_SearchPath(char *path, mios32_osc_args_t *osc_args, u32 me
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! Compiles a search tree into a search table, which allows to dispatch
+//! OSC messages with MIOS32_OSC_ParsePacketTable() without comparing the
+//! address parts with each node of the tree.
+//!
+//! Each reachable node gets a hash slot, which is addressed by the address
+//! part and the slot of the parent node (shared sub-trees get separate
+//! slots for each parent). A hierarchy level which contains wildcards
+//! (e.g. "*" for values which are part of the path) or duplicate address
+//! parts isn't compiled, it will be searched with the tree matcher instead.
+//!
+//! The slots have to be allocated by the application, e.g.:
+//! \code
+//!   static mios32_osc_search_table_entry_t parse_slots[256];
+//!   static mios32_osc_search_table_t parse_table;
+//!
+//!   MIOS32_OSC_SearchTableCompile(&parse_table, parse_slots, 256, parse_root);
+//!   ...
+//!   MIOS32_OSC_ParsePacketTable(packet, len, &parse_table);
+//! \endcode
+//! The number of slots should be at least 1.5 times the number of nodes
+//! (the return value), otherwise hash collisions will slow down the search.
+//!
+//! The search tree has to be recompiled whenever it has been changed.
+//! \param[out] search_table the table which should be compiled
+//! \param[in] slots pointer to the hash slots
+//! \param[in] num_slots number of hash slots, has to be a power of two (2..32768)
+//! \param[in] search_tree the search tree as passed to MIOS32_OSC_ParsePacket()
+//! \return >= 0: number of used slots
+//! \return -1 if num_slots is not a power of two
+//! \return -2 if the number of slots is too small
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SearchTableCompile(mios32_osc_search_table_t *search_table, mios32_osc_search_table_entry_t *slots, u16 num_slots, mios32_osc_search_tree_t *search_tree)
+{
+  u32 ix;
+
+  search_table->slot = slots;
+  search_table->num_slots = 0;
+  search_table->num_entries = 0;
+  search_table->search_tree = search_tree;
+  search_table->tree_search = 1; // until compilation passed
+
+  if( num_slots < 2 || num_slots > 0x8000 || (num_slots & (num_slots-1)) )
+    return -1; // no power of two
+
+  for(ix=0; ix<num_slots; ++ix) {
+    slots[ix].node = NULL;
+    slots[ix].parent = MIOS32_OSC_SEARCH_TABLE_ROOT;
+    slots[ix].hash = 0;
+    slots[ix].tree_search = 0;
+  }
+  search_table->num_slots = num_slots;
+
+  u8 tree_search = 0;
+  s32 status = MIOS32_OSC_SearchTableInsert(search_table, MIOS32_OSC_SEARCH_TABLE_ROOT, search_tree, 0, &tree_search);
+  if( status < 0 ) {
+    // an incomplete table would miss methods: use the tree matcher only
+    search_table->num_entries = 0;
+    return status;
+  }
+
+  search_table->tree_search = tree_search;
+
+  return search_table->num_entries;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Internal function:
+// inserts a hierarchy level of the search tree into the search table
+// tree_search is set if the level has to be searched with the tree matcher
+// returns -2 if the table is full
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_OSC_SearchTableInsert(mios32_osc_search_table_t *search_table, u16 parent, mios32_osc_search_tree_t *search_tree, u8 depth, u8 *tree_search)
+{
+  mios32_osc_search_tree_t *node;
+  u32 mask = search_table->num_slots - 1;
+
+  // MIOS32_OSC_SearchPath() won't go deeper
+  if( depth >= MIOS32_OSC_MAX_PATH_PARTS )
+    return 0;
+
+  // wildcards and duplicates are handled by the tree matcher
+  for(node=search_tree; node->address != NULL; ++node) {
+    mios32_osc_search_tree_t *prev_node;
+
+    if( strpbrk(node->address, "*?") != NULL ) {
+      *tree_search = 1;
+      return 0;
+    }
+
+    for(prev_node=search_tree; prev_node != node; ++prev_node) {
+      if( strcmp(prev_node->address, node->address) == 0 ) {
+	*tree_search = 1;
+	return 0;
+      }
+    }
+  }
+
+  for(node=search_tree; node->address != NULL; ++node) {
+    // keep at least one free slot, it terminates the search
+    if( (search_table->num_entries+1) >= search_table->num_slots )
+      return -2; // table full
+
+    size_t part_len;
+    u32 hash = MIOS32_OSC_SearchTableHash(node->address, parent, &part_len);
+    u32 ix = hash & mask;
+    while( search_table->slot[ix].node != NULL )
+      ix = (ix + 1) & mask;
+
+    mios32_osc_search_table_entry_t *slot = &search_table->slot[ix];
+    slot->node = node;
+    slot->parent = parent;
+    slot->hash = (u8)(hash >> 24);
+    slot->tree_search = 0;
+    ++search_table->num_entries;
+
+    // the method takes precedence over the next hierarchy level (like in MIOS32_OSC_SearchPath())
+    if( node->osc_method == NULL && node->next != NULL ) {
+      s32 status = MIOS32_OSC_SearchTableInsert(search_table, ix, node->next, depth+1, &slot->tree_search);
+      if( status < 0 )
+	return status;
+    }
+  }
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Internal function:
+// hash value of an address part (terminated by '/' or 0) and the parent slot
+// (FNV-1a)
+/////////////////////////////////////////////////////////////////////////////
+static u32 MIOS32_OSC_SearchTableHash(const char *part, u16 parent, size_t *part_len)
+{
+  const char *str = part;
+  u32 hash = 2166136261U;
+
+  while( *str != 0 && *str != '/' ) {
+    hash ^= (u8)*str++;
+    hash *= 16777619U;
+  }
+  *part_len = str - part;
+
+  hash ^= (u32)parent * 0x9e3779b1U;
+  hash ^= hash >> 16;
+
+  return hash;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Internal function:
+// searches in the compiled search table for a matching OSC address
+// The address doesn't contain wildcards, accordingly only a single node can
+// match in each hierarchy level.
+// In distance to MIOS32_OSC_SearchPath(), the search stops if the path ends
+// before a method has been reached.
+// returns -4 if MIOS32_OSC_MAX_PATH_PARTS has been exceeded
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_OSC_SearchTable(char *path, mios32_osc_args_t *osc_args, mios32_osc_search_table_t *search_table)
+{
+  mios32_osc_search_tree_t *search_tree = search_table->search_tree;
+  u8 tree_search = search_table->tree_search;
+  u16 parent = MIOS32_OSC_SEARCH_TABLE_ROOT;
+  u32 method_arg = 0x00000000;
+  u32 mask = search_table->num_slots - 1;
+
+  while( 1 ) {
+    if( tree_search )
+      return MIOS32_OSC_SearchPath(path, osc_args, method_arg, search_tree);
+
+    if( osc_args->num_path_parts >= MIOS32_OSC_MAX_PATH_PARTS )
+      return -4; // maximum number of path parts exceeded
+
+    size_t part_len;
+    u32 hash = MIOS32_OSC_SearchTableHash(path, parent, &part_len);
+    u8 hash_check = (u8)(hash >> 24);
+    u32 ix = hash & mask;
+    mios32_osc_search_table_entry_t *slot;
+
+    while( 1 ) {
+      slot = &search_table->slot[ix];
+
+      if( slot->node == NULL )
+	return 0; // no matching address
+
+      if( slot->parent == parent && slot->hash == hash_check &&
+	  strncmp(slot->node->address, path, part_len) == 0 &&
+	  slot->node->address[part_len] == 0 )
+	break;
+
+      ix = (ix + 1) & mask;
+    }
+
+    const mios32_osc_search_tree_t *node = slot->node;
+
+    // add pointer to path part
+    osc_args->path_part[osc_args->num_path_parts++] = node->address;
+
+    // OR method args of current node to the args to propagate optional parameters
+    method_arg |= node->method_arg;
+
+    if( node->osc_method ) {
+      s32 (*osc_method)(mios32_osc_args_t *osc_args, u32 method_arg) = node->osc_method;
+      osc_method(osc_args, method_arg);
+      return 0; // no error
+    }
+
+    if( node->next == NULL || path[part_len] == 0 )
+      return 0; // no method reached
+
+    // continue search in next hierarchy level
+    path = &path[part_len+1];
+    parent = ix;
+    tree_search = slot->tree_search;
+    search_tree = node->next;
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Initializes a scheduler for OSC bundles.
+//!
+//! OSC bundles contain a timetag which defines when the elements should
+//! be dispatched. MIOS32_OSC_ParsePacket() ignores the timetag, so that the
+//! network jitter is visible in the timing of the dispatched methods.<BR>
+//! With MIOS32_OSC_ParsePacketScheduled() the elements of bundles with a
+//! future timetag are copied into a queue instead, and they are dispatched
+//! by MIOS32_OSC_SchedulerHandler() once the local time has reached the
+//! due time:
+//! \code
+//!   due time = timetag + clock offset + latency compensation
+//! \endcode
+//!
+//! The local time has to be passed as timetag (seconds and 2^-32 fractions),
+//! it's typically derived from MIOS32_SYS_TimeGet().
+//!
+//! In MIOS32_OSC_SCHEDULER_MODE_ABSOLUTE mode the timetags are expected in
+//! local time (the clock offset is 0). This requires that the clock of the
+//! remote host is synchronized, e.g. via NTP.<BR>
+//! In MIOS32_OSC_SCHEDULER_MODE_RELATIVE mode (default) the clock offset
+//! is measured with the fastest transfer, and the latency compensation
+//! should cover the network jitter.
+//!
+//! Bundles which arrive after their due time are dispatched immediately
+//! (and counted as "late"). Elements which are larger than
+//! MIOS32_OSC_SCHEDULER_ELEMENT_SIZE or don't fit into the queue are
+//! dispatched immediately as well (counted as "overflows").
+//!
+//! MIOS32_OSC_ParsePacketScheduled() and MIOS32_OSC_SchedulerHandler()
+//! have to be called from the same task (or they have to be serialized
+//! by the application).
+//!
+//! Usage Example:
+//! \code
+//!   static mios32_osc_scheduler_slot_t osc_scheduler_slots[32];
+//!   static mios32_osc_scheduler_t osc_scheduler;
+//!
+//!   MIOS32_OSC_SchedulerInit(&osc_scheduler, osc_scheduler_slots, 32, parse_root, NULL);
+//!
+//!   // received packet:
+//!   MIOS32_OSC_ParsePacketScheduled(packet, len, &osc_scheduler, now);
+//!
+//!   // each mS:
+//!   MIOS32_OSC_SchedulerHandler(&osc_scheduler, now);
+//! \endcode
+//! \param[out] scheduler the scheduler which should be initialized
+//! \param[in] slots pointer to the queue slots
+//! \param[in] num_slots number of queue slots (1..254)
+//! \param[in] search_tree the search tree which is used to dispatch the elements
+//! \param[in] search_table optional compiled search table (see MIOS32_OSC_SearchTableCompile()), or NULL
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerInit(mios32_osc_scheduler_t *scheduler, mios32_osc_scheduler_slot_t *slots, u8 num_slots, mios32_osc_search_tree_t *search_tree, mios32_osc_search_table_t *search_table)
+{
+  int i;
+
+  if( num_slots == 0 || num_slots >= MIOS32_OSC_SCHEDULER_SLOT_NONE )
+    return -1; // invalid number of slots
+
+  scheduler->slot = slots;
+  scheduler->num_slots = num_slots;
+  scheduler->head = MIOS32_OSC_SCHEDULER_SLOT_NONE;
+  scheduler->search_tree = search_tree;
+  scheduler->search_table = search_table;
+  scheduler->mode = MIOS32_OSC_SCHEDULER_MODE_RELATIVE;
+  scheduler->clock_offset_valid = 0;
+  scheduler->clock_offset = 0;
+  scheduler->latency_us = MIOS32_OSC_SCHEDULER_DEFAULT_LATENCY_US;
+
+  // all slots are free
+  for(i=0; i<num_slots; ++i) {
+    slots[i].len = 0;
+    slots[i].next = (i < (num_slots-1)) ? (i+1) : MIOS32_OSC_SCHEDULER_SLOT_NONE;
+  }
+  scheduler->free = 0;
+
+  return MIOS32_OSC_SchedulerStatsReset(scheduler);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Changes the scheduler mode. The measured clock offset will be reset.
+//! \param[in] scheduler pointer to the scheduler
+//! \param[in] mode MIOS32_OSC_SCHEDULER_MODE_OFF, _RELATIVE or _ABSOLUTE
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerModeSet(mios32_osc_scheduler_t *scheduler, mios32_osc_scheduler_mode_t mode)
+{
+  if( mode > MIOS32_OSC_SCHEDULER_MODE_ABSOLUTE )
+    return -1; // invalid mode
+
+  scheduler->mode = mode;
+  scheduler->clock_offset_valid = 0;
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] scheduler pointer to the scheduler
+//! \return the scheduler mode
+/////////////////////////////////////////////////////////////////////////////
+mios32_osc_scheduler_mode_t MIOS32_OSC_SchedulerModeGet(mios32_osc_scheduler_t *scheduler)
+{
+  return scheduler->mode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Sets the latency compensation, which is added to the timetag of incoming
+//! bundles. It should be slightly higher than the network jitter.
+//! \param[in] scheduler pointer to the scheduler
+//! \param[in] latency_us latency in uS (0..10000000)
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerLatencySet(mios32_osc_scheduler_t *scheduler, u32 latency_us)
+{
+  if( latency_us > 10000000 )
+    return -1; // invalid latency
+
+  scheduler->latency_us = latency_us;
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] scheduler pointer to the scheduler
+//! \return the latency compensation in uS
+/////////////////////////////////////////////////////////////////////////////
+u32 MIOS32_OSC_SchedulerLatencyGet(mios32_osc_scheduler_t *scheduler)
+{
+  return scheduler->latency_us;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the scheduler statistics
+//! \param[in] scheduler pointer to the scheduler
+//! \param[out] stats pointer to the statistics structure
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerStatsGet(mios32_osc_scheduler_t *scheduler, mios32_osc_scheduler_stats_t *stats)
+{
+  *stats = scheduler->stats;
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! Resets the scheduler statistics
+//! \param[in] scheduler pointer to the scheduler
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerStatsReset(mios32_osc_scheduler_t *scheduler)
+{
+  scheduler->stats.queued = 0;
+  scheduler->stats.immediate = 0;
+  scheduler->stats.late = 0;
+  scheduler->stats.overflows = 0;
+  scheduler->stats.max_late_us = 0;
+  scheduler->stats.max_early_us = 0;
+  scheduler->stats.max_dispatch_delay_us = 0;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] scheduler pointer to the scheduler
+//! \return number of elements which are waiting for their due time
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerNumQueued(mios32_osc_scheduler_t *scheduler)
+{
+  s32 num = 0;
+  u8 ix;
+
+  for(ix=scheduler->head; ix != MIOS32_OSC_SCHEDULER_SLOT_NONE; ix=scheduler->slot[ix].next)
+    ++num;
+
+  return num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Same as MIOS32_OSC_ParsePacket(), but the elements of bundles with a
+//! future timetag are queued, and dispatched by MIOS32_OSC_SchedulerHandler()
+//! (see MIOS32_OSC_SchedulerInit())
+//! \param[in] packet pointer to OSC packet
+//! \param[in] len length of packet
+//! \param[in] scheduler pointer to the scheduler
+//! \param[in] now the local time
+//! \return 0 if packet has been parsed w/o errors
+//! \return -1 if packet format invalid
+//! \return -2 if the packet contains an OSC element with invalid format
+//! \return -3 if the packet contains an OSC element with an unsupported format
+//! returns -4 if MIOS32_OSC_MAX_PATH_PARTS has been exceeded
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_ParsePacketScheduled(u8 *packet, u32 len, mios32_osc_scheduler_t *scheduler, mios32_osc_timetag_t now)
+{
+  return MIOS32_OSC_Parse(packet, len, scheduler->search_tree, scheduler->search_table, scheduler,
+			  ((unsigned long long)now.seconds << 32) | now.fraction);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Dispatches all queued elements which have reached their due time.
+//! Should be called periodically, e.g. each mS
+//! \param[in] scheduler pointer to the scheduler
+//! \param[in] now the local time
+//! \return number of dispatched elements
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_OSC_SchedulerHandler(mios32_osc_scheduler_t *scheduler, mios32_osc_timetag_t now)
+{
+  unsigned long long now_time = ((unsigned long long)now.seconds << 32) | now.fraction;
+  mios32_osc_args_t osc_args;
+  s32 num = 0;
+
+  while( scheduler->head != MIOS32_OSC_SCHEDULER_SLOT_NONE ) {
+    u8 ix = scheduler->head;
+    mios32_osc_scheduler_slot_t *slot = &scheduler->slot[ix];
+    unsigned long long due = ((unsigned long long)slot->due.seconds << 32) | slot->due.fraction;
+
+    long long delay = (long long)(now_time - due);
+    if( delay < 0 )
+      break; // the remaining elements are due later
+
+    u32 delay_us = MIOS32_OSC_TimeToUs(delay);
+    if( delay_us > scheduler->stats.max_dispatch_delay_us )
+      scheduler->stats.max_dispatch_delay_us = delay_us;
+
+    // dispatch element (errors have been ignored for immediate bundles as well)
+    scheduler->head = slot->next;
+    osc_args.timetag = slot->timetag;
+    MIOS32_OSC_SearchElement(slot->element, slot->len, &osc_args, scheduler->search_tree, scheduler->search_table);
+    ++num;
+
+    // free slot
+    slot->len = 0;
+    slot->next = scheduler->free;
+    scheduler->free = ix;
+  }
+
+  return num;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Internal function:
+// copies a bundle element into the scheduler queue
+// elements with the same due time are dispatched in the received order
+// returns -1 if the element doesn't fit into the queue
+/////////////////////////////////////////////////////////////////////////////
+static s32 MIOS32_OSC_SchedulerQueue(mios32_osc_scheduler_t *scheduler, u8 *element, u32 len, mios32_osc_timetag_t timetag, unsigned long long due)
+{
+  u8 ix = scheduler->free;
+
+  if( len > MIOS32_OSC_SCHEDULER_ELEMENT_SIZE || ix == MIOS32_OSC_SCHEDULER_SLOT_NONE ) {
+    ++scheduler->stats.overflows;
+    return -1; // dispatch immediately
+  }
+
+  // take over element
+  mios32_osc_scheduler_slot_t *slot = &scheduler->slot[ix];
+  scheduler->free = slot->next;
+  memcpy(slot->element, element, len);
+  slot->len = len;
+  slot->timetag = timetag;
+  slot->due.seconds = (u32)(due >> 32);
+  slot->due.fraction = (u32)due;
+
+  // insert into queue, sorted by due time
+  u8 *link = &scheduler->head;
+  while( *link != MIOS32_OSC_SCHEDULER_SLOT_NONE ) {
+    mios32_osc_scheduler_slot_t *queued = &scheduler->slot[*link];
+    unsigned long long queued_due = ((unsigned long long)queued->due.seconds << 32) | queued->due.fraction;
+    if( (long long)(due - queued_due) < 0 )
+      break;
+    link = &queued->next;
+  }
+  slot->next = *link;
+  *link = ix;
+
+  ++scheduler->stats.queued;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Internal function:
+// converts a time difference (32.32 fixed point) to uS, saturated to 32bit
+/////////////////////////////////////////////////////////////////////////////
+static u32 MIOS32_OSC_TimeToUs(unsigned long long time)
+{
+  if( time >= (4294ULL << 32) )
+    return 0xffffffff; // > 4294 seconds
+
+  return (u32)((time * 1000000ULL) >> 32);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Sends the argument list of a method to the debug terminal.
 //!
@@ -0,0 +1,260 @@
+// $Id$
+//! \defgroup MIOS32_RINGBUFFER
+//!
+//! Lock-free single-producer/single-consumer ring buffers for MIOS32
+//!
+//! The ring buffer only handles the slot indices, the buffer itself is
+//! allocated by the user. This allows to use the same functions for
+//! byte (UART) and package (USB MIDI) buffers, and items can be
+//! copied directly into/from the buffer without intermediate copies.
+//!
+//! The head index is only changed by the producer, the tail index only
+//! by the consumer. Accordingly no interrupt has to be disabled if the
+//! producer runs in an interrupt handler and the consumer in a task
+//! (or vice versa).<BR>
+//! Note that only a single producer and a single consumer are allowed
+//! per ring buffer. If multiple tasks write into the same buffer,
+//! the write accesses have to be serialized, e.g. by disabling interrupts
+//! between MIOS32_RINGBUFFER_Reserve() and MIOS32_RINGBUFFER_Commit().
+//! This is done by the UART and USB MIDI drivers for the Tx buffers, since
+//! MIDI packages can be sent from any task.<BR>
+//! Accordingly only the Rx buffers of these drivers are accessed lock-free.
+//! Writing into a Tx buffer still disables all interrupts with
+//! MIOS32_IRQ_Disable(), and so do the task-level calls of the USB MIDI
+//! buffer handlers. Single interrupt lines are not masked in the NVIC.
+//!
+//! Producer:
+//! \code
+//!   s32 ix = MIOS32_RINGBUFFER_Reserve(&rb, 1);
+//!   if( ix >= 0 ) {
+//!     buffer[ix] = item;
+//!     MIOS32_RINGBUFFER_Commit(&rb, 1);
+//!   }
+//! \endcode
+//!
+//! Consumer:
+//! \code
+//!   s32 ix = MIOS32_RINGBUFFER_Peek(&rb);
+//!   if( ix >= 0 ) {
+//!     item = buffer[ix];
+//!     MIOS32_RINGBUFFER_Release(&rb, 1);
+//!   }
+//! \endcode
+//!
+//! One slot is always kept free to distinguish between an empty and a
+//! full buffer, accordingly a ring buffer with N slots can store N-1 items.
+//!
+//! \{
+/* ==========================================================================
+ *
+ *  Copyright (C) 2008 Thorsten Klose (tk@midibox.org)
+ *  Licensed for personal non-commercial use only.
+ *  All other rights reserved.
+ *
+ * ==========================================================================
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+// Include files
+/////////////////////////////////////////////////////////////////////////////
+
+#include <mios32.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local defines/macros
+/////////////////////////////////////////////////////////////////////////////
+
+// ensures that the buffer content is written/read before the index is changed
+// Cortex-M3 is a single core which doesn't reorder memory accesses
+// to normal memory, so that it's sufficient to stop the compiler from
+// reordering. Emulations could run producer and consumer in different threads.
+#if defined(MIOS32_FAMILY_EMULATION)
+# define MIOS32_RINGBUFFER_BARRIER() __sync_synchronize()
+#else
+# define MIOS32_RINGBUFFER_BARRIER() __asm volatile ("" ::: "memory")
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Initializes a ring buffer
+//! Should only be called when neither the producer nor the consumer accesses
+//! the buffer (or if the producer is the only accessor, e.g. on a buffer reset)
+//! \param[in] rb pointer to the ring buffer
+//! \param[in] size number of slots of the user buffer (2..65535)
+//! \return < 0 if initialisation failed
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Init(mios32_ringbuffer_t *rb, u16 size)
+{
+  if( size < 2 )
+    return -1; // invalid size
+
+  rb->size = size;
+  rb->head = 0;
+  rb->tail = 0;
+  rb->max_used = 0;
+  rb->overruns = 0;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] rb pointer to the ring buffer
+//! \return number of items in the buffer
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Used(mios32_ringbuffer_t *rb)
+{
+  u16 head = rb->head;
+  u16 tail = rb->tail;
+
+  return (head >= tail) ? (head - tail) : (rb->size - tail + head);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] rb pointer to the ring buffer
+//! \return number of items which can still be put into the buffer
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Free(mios32_ringbuffer_t *rb)
+{
+  return rb->size - 1 - MIOS32_RINGBUFFER_Used(rb);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Producer: checks if the given number of items can be put into the buffer
+//! \param[in] rb pointer to the ring buffer
+//! \param[in] len number of items
+//! \return -1 if the buffer doesn't provide enough free slots
+//! \return >= 0: index of the first slot which should be written.<BR>
+//!    Use MIOS32_RINGBUFFER_NextIx() to get the following slots, and
+//!    MIOS32_RINGBUFFER_Commit() to take over the items.
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Reserve(mios32_ringbuffer_t *rb, u16 len)
+{
+  if( len > MIOS32_RINGBUFFER_Free(rb) )
+    return -1; // buffer full
+
+  return rb->head;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Producer: takes over the items which have been written into the reserved
+//! slots, they are visible for the consumer from now on.
+//! \param[in] rb pointer to the ring buffer
+//! \param[in] len number of items (must match with MIOS32_RINGBUFFER_Reserve())
+//! \return number of items in the buffer
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Commit(mios32_ringbuffer_t *rb, u16 len)
+{
+  u32 head = rb->head + len;
+  if( head >= rb->size )
+    head -= rb->size;
+
+  MIOS32_RINGBUFFER_BARRIER(); // items have to be written before head is changed
+  rb->head = head;
+
+  // update high-water mark
+  s32 used = MIOS32_RINGBUFFER_Used(rb);
+  if( used > rb->max_used )
+    rb->max_used = used;
+
+  return used;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Consumer: checks for a new item
+//! \param[in] rb pointer to the ring buffer
+//! \return -1 if the buffer is empty
+//! \return >= 0: index of the slot which should be read.<BR>
+//!    Use MIOS32_RINGBUFFER_NextIx() to get the following slots (if
+//!    MIOS32_RINGBUFFER_Used() reports more items), and
+//!    MIOS32_RINGBUFFER_Release() to free the slots.
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Peek(mios32_ringbuffer_t *rb)
+{
+  u16 tail = rb->tail;
+
+  if( tail == rb->head )
+    return -1; // buffer empty
+
+  MIOS32_RINGBUFFER_BARRIER(); // head has to be read before the items
+  return tail;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Consumer: frees slots which have been read
+//! \param[in] rb pointer to the ring buffer
+//! \param[in] len number of items
+//! \return number of items which are still in the buffer
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_Release(mios32_ringbuffer_t *rb, u16 len)
+{
+  u32 tail = rb->tail + len;
+  if( tail >= rb->size )
+    tail -= rb->size;
+
+  MIOS32_RINGBUFFER_BARRIER(); // items have to be read before tail is changed
+  rb->tail = tail;
+
+  return MIOS32_RINGBUFFER_Used(rb);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] rb pointer to the ring buffer
+//! \param[in] ix slot index
+//! \return index of the next slot
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_NextIx(mios32_ringbuffer_t *rb, u16 ix)
+{
+  return (++ix >= rb->size) ? 0 : ix;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Producer: should be called whenever an item has been dropped because
+//! the buffer was full
+//! \param[in] rb pointer to the ring buffer
+//! \return number of overruns
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_OverrunNotify(mios32_ringbuffer_t *rb)
+{
+  return ++rb->overruns;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the statistics of a ring buffer
+//! \param[in] rb pointer to the ring buffer
+//! \param[out] stats pointer to the statistics structure
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_StatsGet(mios32_ringbuffer_t *rb, mios32_ringbuffer_stats_t *stats)
+{
+  stats->size = rb->size ? (rb->size - 1) : 0;
+  stats->max_used = rb->max_used;
+  stats->overruns = rb->overruns;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Resets the high-water mark and the overrun counter of a ring buffer
+//! \param[in] rb pointer to the ring buffer
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_RINGBUFFER_StatsReset(mios32_ringbuffer_t *rb)
+{
+  rb->max_used = MIOS32_RINGBUFFER_Used(rb);
+  rb->overruns = 0;
+
+  return 0; // no error
+}
+
+//! \}
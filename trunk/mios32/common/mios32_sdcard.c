@@ -18,6 +18,12 @@
 //!
 //! MIOS32_SDCARD_SectorRead/SectorWrite allow to read/write a 512 byte sector.
 //!
+//! MIOS32_SDCARD_SectorsRead/SectorsWrite transfer consecutive sectors with
+//! a single multi block command (CMD18/CMD25). This saves the command overhead
+//! and the programming delay of the card for each sector, and should be used
+//! whenever more than one sector has to be transfered (e.g. by the FatFs/DOSFS
+//! glue to read/write complete clusters)
+//!
 //! If such an access returns an error, it can be assumed that the SD Card has
 //! been disconnected during the transfer.
 //!
@@ -58,6 +64,10 @@
 #define MIOS32_SDCARD_MUTEX_GIVE {}
 #endif
 
+// max. number of polled SPI bytes while the multi block transfers are waiting
+// for the start token of a data block or for the end of the busy state
+#define MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT (32*65536)
+
 
 /* Definitions for MMC/SDC command */
 #define SDCMD_GO_IDLE_STATE		(0x40+0)	
@@ -96,6 +106,18 @@
 #define SDCMD_WRITE_SINGLE_BLOCK (0x40+24)
 #define SDCMD_WRITE_SINGLE_BLOCK_CRC 0xff
 
+#define SDCMD_STOP_TRANSMISSION	(0x40+12)
+#define SDCMD_STOP_TRANSMISSION_CRC 0xff
+
+#define SDCMD_READ_MULTIPLE_BLOCK (0x40+18)
+#define SDCMD_READ_MULTIPLE_BLOCK_CRC 0xff
+
+#define SDCMD_WRITE_MULTIPLE_BLOCK (0x40+25)
+#define SDCMD_WRITE_MULTIPLE_BLOCK_CRC 0xff
+
+#define SDCMD_SET_WR_BLK_ERASE_COUNT (0xC0+23)
+#define SDCMD_SET_WR_BLK_ERASE_COUNT_CRC 0xff
+
 
 /* Card type flags (CardType) */
 #define CT_MMC				0x01
@@ -355,6 +377,10 @@ s32 MIOS32_SDCARD_SendSDCCmd(u8 cmd, u32 addr, u8 crc)
 
   u8 timeout = 0;
 
+  // the byte after STOP_TRANSMISSION is a stuff byte which could still contain data
+  if( cmd == SDCMD_STOP_TRANSMISSION )
+    MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+
   if( cmd == SDCMD_SEND_STATUS ) {
 
   // one dummy read
@@ -555,6 +581,189 @@ error:
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! Reads consecutive 512 byte sectors with a single READ_MULTIPLE_BLOCK command
+//! \param[in] sector 32bit number of the first sector
+//! \param[in] *buffer pointer to buffer which can store count*512 bytes
+//! \param[in] count number of sectors
+//! \return 0 if all sectors have been successfully read
+//! \return -error flags of the R1 response if the command failed (see MIOS32_SDCARD_SectorRead)
+//! \return -256 if timeout during command has been sent
+//! \return -257 if timeout while waiting for start token
+//! \return -258 if timeout while waiting for the end of the transmission
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_SDCARD_SectorsRead(u32 sector, u8 *buffer, u32 count)
+{
+  s32 status;
+  int i;
+
+  if( count == 0 )
+    return 0; // nothing to do
+  if( count == 1 )
+    return MIOS32_SDCARD_SectorRead(sector, buffer); // no benefit from a multi block command
+
+  if (!(CardType & CT_BLOCK)) 
+	sector *= 512;
+
+  MIOS32_SDCARD_MUTEX_TAKE;
+
+  // init SPI port for fast frequency access (ca. 18 MBit/s)
+  // this is required for the case that the SPI port is shared with other devices
+  MIOS32_SPI_TransferModeInit(MIOS32_SDCARD_SPI, MIOS32_SPI_MODE_CLK1_PHASE1, MIOS32_SPI_PRESCALER_4);
+
+  if( (status=MIOS32_SDCARD_SendSDCCmd(SDCMD_READ_MULTIPLE_BLOCK, sector, SDCMD_READ_MULTIPLE_BLOCK_CRC)) ) {
+    status=(status < 0) ? -256 : status; // return timeout indicator or error flags
+	goto error;
+  }
+
+  for(; count; --count, buffer += 512) {
+    // wait for start token of the data block
+    for(i=0; i<MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT; ++i) {
+      u8 ret = MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+      if( ret != 0xff )
+	break;
+    }
+    if( i == MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT ) {
+      status= -257;
+      break;
+    }
+
+    // read 512 bytes via DMA
+    MIOS32_SPI_TransferBlock(MIOS32_SDCARD_SPI, NULL, buffer, 512, NULL);
+
+    // read (and ignore) CRC
+    MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+    MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+  }
+
+  // stop the transmission (also on errors to get the card into a defined state)
+  if( MIOS32_SDCARD_SendSDCCmd(SDCMD_STOP_TRANSMISSION, 0, SDCMD_STOP_TRANSMISSION_CRC) < 0 ) {
+    if( status == 0 )
+      status = -256;
+    goto error;
+  }
+
+  // wait until card isn't busy anymore
+  for(i=0; i<MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT; ++i) {
+    u8 ret = MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+    if( ret != 0x00 )
+      break;
+  }
+  if( i == MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT && status == 0 )
+    status= -258;
+
+error:
+  // deactivate chip select
+  MIOS32_SPI_RC_PinSet(MIOS32_SDCARD_SPI, MIOS32_SDCARD_SPI_RC_PIN, 1); // spi, rc_pin, pin_value
+
+  // Send dummy byte once deactivated to drop cards DO
+  MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+  MIOS32_SDCARD_MUTEX_GIVE;
+  return status; 
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Writes consecutive 512 byte sectors with a single WRITE_MULTIPLE_BLOCK command
+//!
+//! For SD Cards the number of sectors is announced with SET_WR_BLK_ERASE_COUNT,
+//! so that the card can pre-erase the blocks
+//! \param[in] sector 32bit number of the first sector
+//! \param[in] *buffer pointer to count*512 bytes
+//! \param[in] count number of sectors
+//! \return 0 if all sectors have been successfully written
+//! \return -error flags of the R1 response if the command failed (see MIOS32_SDCARD_SectorWrite)
+//! \return -256 if timeout during command has been sent
+//! \return -257 if write operation not accepted
+//! \return -258 if timeout during write operation
+/////////////////////////////////////////////////////////////////////////////
+s32 MIOS32_SDCARD_SectorsWrite(u32 sector, u8 *buffer, u32 count)
+{
+  s32 status;
+  int i;
+
+  if( count == 0 )
+    return 0; // nothing to do
+  if( count == 1 )
+    return MIOS32_SDCARD_SectorWrite(sector, buffer); // no benefit from a multi block command
+
+  MIOS32_SDCARD_MUTEX_TAKE;
+
+  if (!(CardType & CT_BLOCK))
+	sector *= 512;
+  // init SPI port for fast frequency access (ca. 18 MBit/s)
+  // this is required for the case that the SPI port is shared with other devices
+  MIOS32_SPI_TransferModeInit(MIOS32_SDCARD_SPI, MIOS32_SPI_MODE_CLK1_PHASE1, MIOS32_SPI_PRESCALER_4);
+
+  // pre-erase (optional, the error status is ignored)
+  if( CardType & CT_SDC )
+    MIOS32_SDCARD_SendSDCCmd(SDCMD_SET_WR_BLK_ERASE_COUNT, count, SDCMD_SET_WR_BLK_ERASE_COUNT_CRC);
+
+  if( (status=MIOS32_SDCARD_SendSDCCmd(SDCMD_WRITE_MULTIPLE_BLOCK, sector, SDCMD_WRITE_MULTIPLE_BLOCK_CRC)) ) {
+    status=(status < 0) ? -256 : status; // return timeout indicator or error flags
+	goto error;
+  }
+
+  for(; count; --count, buffer += 512) {
+    // send start token
+    MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xfc);
+
+    // send 512 bytes of data via DMA
+    MIOS32_SPI_TransferBlock(MIOS32_SDCARD_SPI, buffer, NULL, 512, NULL);
+
+    // send CRC
+    MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+    MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+
+    // read response
+    u8 response = MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+    if( (response & 0x0f) != 0x5 ) {
+      status= -257;
+      break;
+    }
+
+    // wait until the block has been programmed
+    for(i=0; i<MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT; ++i) {
+      u8 ret = MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+      if( ret != 0x00 )
+	break;
+    }
+    if( i == MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT ) {
+      status= -258;
+      break;
+    }
+  }
+
+  // send stop token (also if a block hasn't been accepted or programmed to terminate the command)
+  MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xfd);
+
+  // skip one byte before the busy state is signaled (see spec)
+  MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+
+  // wait for write completion
+  for(i=0; i<MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT; ++i) {
+    u8 ret = MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+    if( ret != 0x00 )
+      break;
+  }
+  if( i == MIOS32_SDCARD_MULTI_BLOCK_TIMEOUT && status == 0 )
+    status= -258;
+
+  // required for clocking (see spec)
+  MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+
+error:
+  // deactivate chip select
+  MIOS32_SPI_RC_PinSet(MIOS32_SDCARD_SPI, MIOS32_SDCARD_SPI_RC_PIN, 1); // spi, rc_pin, pin_value
+  // Send dummy byte once deactivated to drop cards DO
+  MIOS32_SPI_TransferByte(MIOS32_SDCARD_SPI, 0xff);
+
+  MIOS32_SDCARD_MUTEX_GIVE;
+
+  return status;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! Reads the CID informations from SD Card
 //! \param[in] *cid pointer to buffer which holds the CID informations
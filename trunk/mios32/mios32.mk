@@ -20,6 +20,7 @@ THUMB_SOURCE += \
 	$(MIOS32_PATH)/mios32/common/mios32_dout.c \
 	$(MIOS32_PATH)/mios32/common/mios32_enc.c \
 	$(MIOS32_PATH)/mios32/common/mios32_lcd.c \
+	$(MIOS32_PATH)/mios32/common/mios32_ringbuffer.c \
 	$(MIOS32_PATH)/mios32/common/mios32_midi.c \
 	$(MIOS32_PATH)/mios32/common/mios32_osc.c \
 	$(MIOS32_PATH)/mios32/common/mios32_com.c \
@@ -76,23 +76,25 @@ uint32_t DFS_ReadSector(uint8_t unit, uint8_t *buffer, uint32_t sector, uint32_t
   if( unit != 0 )
     return 1; 
 
-  // according to README.txt, count is always 1 - check this!
-  if( count != 1 )
+  // multiple sectors are read by DFS_ReadFile() for aligned transfers
+  if( count == 0 )
     return 2;
 
-  // cache:
-  if( caching_enabled && sector == last_sector ) {
+  // cache (only for single sectors, which are read into the same buffer)
+  if( count > 1 ) {
+    last_sector = 0xffffffff;
+  } else if( caching_enabled && sector == last_sector ) {
     // we assume that sector is already in *buffer
     // since the user has to take care that the same buffer is used for file reads, this
     // feature has to be explicitely enabled with DFS_CachingEnabledSet(uint8_t enable)
     return 0;
+  } else {
+    last_sector = sector;
   }
 
-  last_sector = sector;
-
   // forward to MIOS
   s32 status;
-  if( (status=MIOS32_SDCARD_SectorRead(sector, buffer)) < 0 ) {
+  if( (status=MIOS32_SDCARD_SectorsRead(sector, buffer, count)) < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
     MIOS32_MIDI_SendDebugMessage("[DFS_ReadSector] Error during reading sector %u, status %d\n", sector, status);
 #endif
@@ -113,8 +115,7 @@ uint32_t DFS_WriteSector(uint8_t unit, uint8_t *buffer, uint32_t sector, uint32_
   if( unit != 0 )
     return 1; 
 
-  // according to README.txt, count is always 1 - check this!
-  if( count != 1 )
+  if( count == 0 )
     return 2;
 
   // invalidate cache
@@ -122,7 +123,7 @@ uint32_t DFS_WriteSector(uint8_t unit, uint8_t *buffer, uint32_t sector, uint32_
 
   // forward to MIOS
   s32 status;
-  if( (status=MIOS32_SDCARD_SectorWrite(sector, buffer)) < 0 ) {
+  if( (status=MIOS32_SDCARD_SectorsWrite(sector, buffer, count)) < 0 ) {
 #if DEBUG_VERBOSE_LEVEL >= 1
     MIOS32_MIDI_SendDebugMessage("[DFS_WriteSector] Error during writing sector %u, status %d\n", sector, status);
 #endif
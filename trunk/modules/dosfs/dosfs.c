@@ -968,18 +968,21 @@ uint32_t DFS_ReadFile(PFILEINFO fileinfo, uint8_t *scratch, uint8_t *buffer, uin
 		// Case 2 - File pointer is on sector boundary
 		else {
 			// Case 2A - We have at least one more full sector to read and don't have
-			// to go through the scratch buffer. You could insert optimizations here to
-			// read multiple sectors at a time, if you were thus inclined (note that
-			// the maximum multi-read you could perform is a single cluster, so it would
-			// be advantageous to have code similar to case 1A above that would round the
-			// pointer to a cluster boundary the first pass through, so all subsequent
-			// [large] read requests would be able to go a cluster at a time).
+			// to go through the scratch buffer. All full sectors up to the end of the
+			// current cluster are read at once (the maximum multi-read is a single
+			// cluster, since the next cluster has to be looked up in the FAT).
 			if (remain >= SECTOR_SIZE) {
-				result = DFS_ReadSector(fileinfo->volinfo->unit, buffer, sector, 1);
-				remain -= SECTOR_SIZE;
-				buffer += SECTOR_SIZE;
-				fileinfo->pointer += SECTOR_SIZE;
-				bytesread = SECTOR_SIZE;
+				uint32_t numsectors = div(remain, SECTOR_SIZE).quot;
+				uint32_t clusremain = fileinfo->volinfo->secperclus -
+				  div(div(fileinfo->pointer,fileinfo->volinfo->secperclus * SECTOR_SIZE).rem, SECTOR_SIZE).quot;
+				if (numsectors > clusremain)
+					numsectors = clusremain;
+
+				result = DFS_ReadSector(fileinfo->volinfo->unit, buffer, sector, numsectors);
+				remain -= numsectors * SECTOR_SIZE;
+				buffer += numsectors * SECTOR_SIZE;
+				fileinfo->pointer += numsectors * SECTOR_SIZE;
+				bytesread = numsectors * SECTOR_SIZE;
 			}
 			// Case 2B - We are only reading a partial sector
 			else {
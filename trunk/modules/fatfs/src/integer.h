@@ -24,9 +24,16 @@ typedef unsigned short	WORD;
 typedef unsigned short	WCHAR;
 
 /* These types must be 32-bit integer */
+#if defined(MIOS32_DATATYPES_INT32)
+/* host builds (see mios32_datatypes.h): long is 64bit on 64bit hosts */
+typedef int				LONG;
+typedef unsigned int	ULONG;
+typedef unsigned int	DWORD;
+#else
 typedef long			LONG;
 typedef unsigned long	ULONG;
 typedef unsigned long	DWORD;
+#endif
 
 /* Boolean type */
 // TK: clashes with STM32 setup, therefore defined locally in ff.c
@@ -18,9 +18,6 @@
 #include <mios32.h>
 #include <string.h>
 
-#include <FreeRTOS.h>
-//#include <portmacro.h>
-
 #include "mid_parser.h"
 
 
@@ -42,6 +39,10 @@ typedef struct {
   u32  chunk_end;
   u32  tick;
   u8   running_status;
+
+  u32  buffer_pos;   // file position of the first byte in buffer
+  u16  buffer_len;   // number of valid bytes in buffer
+  u8   buffer[MID_PARSER_TRACK_BUFFER_SIZE];
 } midi_track_t;
 
 
@@ -52,6 +53,13 @@ typedef struct {
 static u32 MID_PARSER_ReadWord(u8 len);
 static u32 MID_PARSER_ReadVarLen(u32 *pos);
 
+static u32 MID_PARSER_TrackFill(midi_track_t *mt);
+static u32 MID_PARSER_TrackAvail(midi_track_t *mt);
+static u8  MID_PARSER_TrackByte(midi_track_t *mt);
+static u32 MID_PARSER_TrackVarLen(midi_track_t *mt);
+static u32 MID_PARSER_TrackCopy(midi_track_t *mt, u8 *buffer, u32 len);
+static void MID_PARSER_TrackSysEx(u8 track, midi_track_t *mt, u8 event);
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
@@ -71,6 +79,7 @@ static s32 (*mid_parser_eof_callback)(void);
 static s32 (*mid_parser_seek_callback)(u32 pos);
 static s32 (*mid_parser_playevent_callback)(u8 track, mios32_midi_package_t midi_package, u32 tick);
 static s32 (*mid_parser_playmeta_callback)(u8 track, u8 meta, u32 len, u8 *buffer, u32 tick);
+static s32 (*mid_parser_playsysex_callback)(u8 track, u8 event, u32 offset, u32 len, u8 *buffer, u32 tick);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -86,6 +95,7 @@ s32 MID_PARSER_Init(u32 mode)
   mid_parser_seek_callback = NULL;
   mid_parser_playevent_callback = NULL;
   mid_parser_playmeta_callback = NULL;
+  mid_parser_playsysex_callback = NULL;
 
   return 0; // no error
 }
@@ -109,6 +119,19 @@ s32 MID_PARSER_InstallEventCallbacks(void *mid_parser_playevent, void *mid_parse
   return 0; // no error
 }
 
+// optional: SysEx and escaped events (0xf0/0xf7) are forwarded as chunks of
+// up to MID_PARSER_TRACK_BUFFER_SIZE bytes with
+//   s32 playsysex(u8 track, u8 event, u32 offset, u32 len, u8 *buffer, u32 tick)
+// <offset> is the position of the chunk within the event data. The leading
+// 0xf0 of a SysEx event is not part of the data (like in the .mid file).
+// If no callback is installed, the bytes are forwarded one by one to the
+// playevent callback
+s32 MID_PARSER_InstallSysExCallback(void *mid_parser_playsysex)
+{
+  mid_parser_playsysex_callback = mid_parser_playsysex;
+  return 0; // no error
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Opens a .mid file and parses for available header/track chunks
@@ -184,6 +207,8 @@ s32 MID_PARSER_Read(void)
 	mt->chunk_end = file_pos + chunk_len - 1;
 	mt->tick = delta;
 	mt->running_status = 0x80;
+	mt->buffer_pos = 0;
+	mt->buffer_len = 0; // buffer will be filled with the first fetch
 	++midi_tracks_num;
 
 #if DEBUG_VERBOSE_LEVEL >= 1
@@ -264,51 +289,20 @@ s32 MID_PARSER_FetchEvents(u32 tick_offset, u32 num_ticks)
       if( mt->tick >= (tick_offset + num_ticks) )
 	break;
 
-      // set file pos
-      mid_parser_seek_callback(mt->file_pos);
-
       // get event
-      u8 event;
-      mt->file_pos += mid_parser_read_callback(&event, 1);
-
-      if( event == 0xf0 ) { // SysEx event
-	u32 length = (u32)MID_PARSER_ReadVarLen(&mt->file_pos);
-#if DEBUG_VERBOSE_LEVEL >= 3
-	DEBUG_MSG("[MID_PARSER:%d:%u] SysEx event with %u bytes\n\r", track, mt->tick, length);
-#endif
+      // the bytes are taken from the read buffer of the track, the file is only
+      // accessed (seek + block read) when the buffer has to be refilled
+      u8 event = MID_PARSER_TrackByte(mt);
 
-	// TODO: use optimized packages for SysEx!
-	mios32_midi_package_t midi_package;
-	midi_package.type = 0xf; // single bytes will be transmitted
-	int i;
-	for(i=0; i<length; ++i) {
-	  u8 evnt0;
-	  mt->file_pos += mid_parser_read_callback(&evnt0, 1);
-	  midi_package.evnt0 = evnt0;
-	  if( mid_parser_playevent_callback != NULL )
-	    mid_parser_playevent_callback(track, midi_package, mt->tick);
-	}
-      } else if( event == 0xf7 ) { // "Escaped" event (allows to send any MIDI data)
-	u32 length = (u32)MID_PARSER_ReadVarLen(&mt->file_pos);
-#if DEBUG_VERBOSE_LEVEL >= 3
-	DEBUG_MSG("[MID_PARSER:%d:%u] Escaped event with %u bytes\n\r", track, mt->tick, length);
-#endif
-	mios32_midi_package_t midi_package;
-	midi_package.type = 0xf; // single bytes will be transmitted
-	int i;
-	for(i=0; i<length; ++i) {
-	  u8 evnt0;
-	  mt->file_pos += mid_parser_read_callback(&evnt0, 1);
-	  midi_package.evnt0 = evnt0;
-	  if( mid_parser_playevent_callback != NULL )
-	    mid_parser_playevent_callback(track, midi_package, mt->tick);
-	}
+      if( event == 0xf0 || event == 0xf7 ) { // SysEx event or "Escaped" event (allows to send any MIDI data)
+	MID_PARSER_TrackSysEx(track, mt, event);
       } else if( event == 0xff ) { // Meta Event
-	u8 meta;
-	mt->file_pos += mid_parser_read_callback(&meta, 1);
-	u32 length = (u32)MID_PARSER_ReadVarLen(&mt->file_pos);
+	u8 meta = MID_PARSER_TrackByte(mt);
+	u32 length = MID_PARSER_TrackVarLen(mt);
 
-	if( mid_parser_playmeta_callback != NULL ) {
+	if( mid_parser_playmeta_callback == NULL ) {
+	  MID_PARSER_TrackCopy(mt, NULL, length); // skip data
+	} else {
 	  u32 buflen = length;
 	  if( buflen > (MID_PARSER_META_BUFFER_SIZE-1) ) {
 	    buflen = MID_PARSER_META_BUFFER_SIZE - 1;
@@ -321,18 +315,12 @@ s32 MID_PARSER_FetchEvents(u32 tick_offset, u32 num_ticks)
 #endif
 	  }
 
-	  if( buflen ) {
-	    // copy bytes into buffer
-	    mt->file_pos += mid_parser_read_callback(meta_buffer, buflen);
-
-	    if( length > buflen ) {
-	      // no free memory: dummy reads
-	      int i;
-	      u8 dummy;
-	      for(i=buflen; i<length; ++i)
-		mt->file_pos += mid_parser_read_callback(&dummy, 1);
-	    }
-	  }
+	  // copy bytes into buffer
+	  buflen = MID_PARSER_TrackCopy(mt, meta_buffer, buflen);
+
+	  // no free memory: skip remaining bytes
+	  if( length > buflen )
+	    MID_PARSER_TrackCopy(mt, NULL, length - buflen);
 
 	  meta_buffer[buflen] = 0; // terminate with 0 for the case that a string has been transfered
 	  
@@ -345,9 +333,7 @@ s32 MID_PARSER_FetchEvents(u32 tick_offset, u32 num_ticks)
 	if( event & 0x80 ) {
 	  mt->running_status = event;
 	  midi_package.evnt0 = event;
-	  u8 evnt1;
-	  mt->file_pos += mid_parser_read_callback(&evnt1, 1);
-	  midi_package.evnt1 = evnt1;
+	  midi_package.evnt1 = MID_PARSER_TrackByte(mt);
 	} else {
 	  midi_package.evnt0 = mt->running_status;
 	  midi_package.evnt1 = event;
@@ -361,9 +347,7 @@ s32 MID_PARSER_FetchEvents(u32 tick_offset, u32 num_ticks)
 	  case CC:
 	  case PitchBend:
 	  {
-	    u8 evnt2;
-	    mt->file_pos += mid_parser_read_callback(&evnt2, 1);
-	    midi_package.evnt2 = evnt2;
+	    midi_package.evnt2 = MID_PARSER_TrackByte(mt);
 
 	    if( mid_parser_playevent_callback != NULL )
 	      mid_parser_playevent_callback(track, midi_package, mt->tick);
@@ -390,7 +374,7 @@ s32 MID_PARSER_FetchEvents(u32 tick_offset, u32 num_ticks)
 
       // get delta length to next event if end of track hasn't been reached yet
       if( mt->file_pos < mt->chunk_end ) {
-	u32 delta = (u32)MID_PARSER_ReadVarLen(&mt->file_pos);
+	u32 delta = MID_PARSER_TrackVarLen(mt);
 	mt->tick += delta;
       }
     }
@@ -442,6 +426,169 @@ static u32 MID_PARSER_ReadVarLen(u32 *pos)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Help function: refills the read buffer of a track from the current file position
+// returns the number of bytes in buffer
+// returns 0 if end of track has been reached, or on read errors (track will be stopped)
+/////////////////////////////////////////////////////////////////////////////
+static u32 MID_PARSER_TrackFill(midi_track_t *mt)
+{
+  if( mt->file_pos > mt->chunk_end )
+    return 0; // end of track reached
+
+  u32 len = mt->chunk_end + 1 - mt->file_pos;
+  if( len > MID_PARSER_TRACK_BUFFER_SIZE )
+    len = MID_PARSER_TRACK_BUFFER_SIZE;
+
+  if( mid_parser_seek_callback(mt->file_pos) < 0 ||
+      mid_parser_read_callback(mt->buffer, len) != len ) {
+#if DEBUG_VERBOSE_LEVEL >= 1
+    DEBUG_MSG("[MID_PARSER] read error at file position %u - track stopped!\n\r", mt->file_pos);
+#endif
+    mt->buffer_len = 0;
+    mt->file_pos = mt->chunk_end + 1;
+    return 0;
+  }
+
+  mt->buffer_pos = mt->file_pos;
+  mt->buffer_len = len;
+
+  return len;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help function: returns the number of bytes which are available in the
+// read buffer from the current file position of the track, refills the buffer if required
+/////////////////////////////////////////////////////////////////////////////
+static u32 MID_PARSER_TrackAvail(midi_track_t *mt)
+{
+  u32 offset = mt->file_pos - mt->buffer_pos;
+
+  // note: offset wraps if file_pos < buffer_pos (e.g. after MID_PARSER_RestartSong())
+  if( offset >= mt->buffer_len )
+    return MID_PARSER_TrackFill(mt);
+
+  return mt->buffer_len - offset;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help function: reads a byte from the track
+// returns 0 if end of track has been reached
+/////////////////////////////////////////////////////////////////////////////
+static u8 MID_PARSER_TrackByte(midi_track_t *mt)
+{
+  if( !MID_PARSER_TrackAvail(mt) )
+    return 0;
+
+  return mt->buffer[mt->file_pos++ - mt->buffer_pos];
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help function: reads a variable-length number from the track
+// decoded directly from the read buffer if it contains all (max. 4) bytes
+/////////////////////////////////////////////////////////////////////////////
+static u32 MID_PARSER_TrackVarLen(midi_track_t *mt)
+{
+  u32 value = 0;
+  u8 c;
+  int i;
+
+  if( MID_PARSER_TrackAvail(mt) >= 4 ) {
+    u8 *ptr = &mt->buffer[mt->file_pos - mt->buffer_pos];
+    i = 0;
+    do {
+      c = ptr[i++];
+      value = (value << 7) | (c & 0x7f);
+    } while( (c & 0x80) && i < 4 );
+    mt->file_pos += i;
+  } else {
+    // number crosses the buffer boundary
+    i = 0;
+    do {
+      c = MID_PARSER_TrackByte(mt);
+      value = (value << 7) | (c & 0x7f);
+    } while( (c & 0x80) && ++i < 4 );
+  }
+
+  return value;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help function: copies <len> bytes from the track into <buffer>
+// if <buffer> is NULL, the bytes will be skipped w/o reading them
+// returns number of copied (or skipped) bytes
+/////////////////////////////////////////////////////////////////////////////
+static u32 MID_PARSER_TrackCopy(midi_track_t *mt, u8 *buffer, u32 len)
+{
+  if( buffer == NULL ) {
+    u32 remaining = (mt->file_pos > mt->chunk_end) ? 0 : (mt->chunk_end + 1 - mt->file_pos);
+    if( len > remaining )
+      len = remaining;
+    mt->file_pos += len;
+    return len;
+  }
+
+  u32 copied = 0;
+  while( copied < len ) {
+    u32 avail = MID_PARSER_TrackAvail(mt);
+    if( !avail )
+      break; // end of track reached
+
+    if( avail > (len - copied) )
+      avail = len - copied;
+    memcpy(buffer + copied, &mt->buffer[mt->file_pos - mt->buffer_pos], avail);
+    mt->file_pos += avail;
+    copied += avail;
+  }
+
+  return copied;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Help function: forwards a SysEx or escaped event (0xf0/0xf7)
+// the data is taken from the read buffer in chunks
+/////////////////////////////////////////////////////////////////////////////
+static void MID_PARSER_TrackSysEx(u8 track, midi_track_t *mt, u8 event)
+{
+  u32 length = MID_PARSER_TrackVarLen(mt);
+#if DEBUG_VERBOSE_LEVEL >= 3
+  DEBUG_MSG("[MID_PARSER:%d:%u] %s event with %u bytes\n\r", track, mt->tick, (event == 0xf0) ? "SysEx" : "Escaped", length);
+#endif
+
+  u32 offset = 0;
+  while( offset < length ) {
+    u32 len = MID_PARSER_TrackAvail(mt);
+    if( !len )
+      break; // end of track reached
+
+    if( len > (length - offset) )
+      len = length - offset;
+    u8 *buffer = &mt->buffer[mt->file_pos - mt->buffer_pos];
+
+    if( mid_parser_playsysex_callback != NULL ) {
+      mid_parser_playsysex_callback(track, event, offset, len, buffer, mt->tick);
+    } else if( mid_parser_playevent_callback != NULL ) {
+      mios32_midi_package_t midi_package;
+      midi_package.ALL = 0;
+      midi_package.type = 0xf; // single bytes will be transmitted
+      int i;
+      for(i=0; i<len; ++i) {
+	midi_package.evnt0 = buffer[i];
+	mid_parser_playevent_callback(track, midi_package, mt->tick);
+      }
+    }
+
+    mt->file_pos += len;
+    offset += len;
+  }
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Restarts a song w/o reading the .mid file chunks again (saves time)
 /////////////////////////////////////////////////////////////////////////////
@@ -27,6 +27,12 @@
 #define MID_PARSER_META_BUFFER_SIZE 256
 #endif
 
+// each track has a read buffer which is refilled in blocks of this size
+// (allocated MID_PARSER_MAX_TRACKS times!)
+#ifndef MID_PARSER_TRACK_BUFFER_SIZE
+#define MID_PARSER_TRACK_BUFFER_SIZE 64
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -40,6 +46,7 @@ extern s32 MID_PARSER_Init(u32 mode);
 
 extern s32 MID_PARSER_InstallFileCallbacks(void *mid_parser_read, void *mid_parser_eof, void *mid_parser_seek);
 extern s32 MID_PARSER_InstallEventCallbacks(void *mid_parser_playevent, void *mid_parser_playmeta);
+extern s32 MID_PARSER_InstallSysExCallback(void *mid_parser_playsysex);
 
 extern s32 MID_PARSER_Read(void);
 extern s32 MID_PARSER_FetchEvents(u32 tick_offset, u32 num_ticks);
@@ -48,6 +48,29 @@
 //! to measure the delay. Problem: currently I don't know how to handle this
 //! in the MacOS based emulation...
 //!
+//! If the application forwards MIDI clocks with SEQ_BPM_NotifyMIDIRxTimestamp()
+//! (e.g. from a realtime tap, see MIOS32_MIDI_RealtimeTap_Init()), the delay
+//! is measured with the uS timestamps taken on arrival of the F8 events
+//! instead, which is independent from the phase of the 250 uS timer.
+//! The deviations of the measured delays are collected in a jitter
+//! histogram (see SEQ_BPM_JitterGet())
+//!
+//! The timestamps are filtered by a second order delay-locked loop (DLL),
+//! which predicts the arrival time of the next F8 event:
+//! \code
+//!   e      = t_arrival - t_predicted        (phase error)
+//!   t_predicted += period + b * e
+//!   period      += c * e
+//! \endcode
+//! with b = sqrt(2) * w, c = w^2 and w = 2 * pi * bandwidth.
+//! The filtered period is used to interpolate the internal clocks, so that
+//! the jitter of the incoming clock doesn't modulate the tick intervals,
+//! while slow tempo changes of the master are still tracked
+//! (see SEQ_BPM_DLL_BandwidthSet() and SEQ_BPM_DLL_StateGet()).<BR>
+//! The interpolation accumulates the period with a resolution of 1/256
+//! timer ticks, so that the rounding error doesn't sum up over the
+//! ppqn/24 internal clocks.
+//!
 //! \{
 /* ==========================================================================
  *
@@ -76,6 +99,18 @@
 // at 1 BPM the measure delay is typically 10000, so add some more ticks for "no clock" detection
 #define SLAVE_CLK_TIMEOUT_DELAY 11000
 
+// the resolution of incoming_clk_ctr in uS
+#define SLAVE_CLK_TIMER_US 250
+
+// filter constants of the DLL are stored in 16bit fixed point format
+#define DLL_COEFF_ONE (1 << 16)
+
+// the DLL locks again to the measured clock interval if the phase error
+// exceeds 4 * average jitter + DLL_OUTLIER_MIN_US for DLL_OUTLIERS_RELOCK
+// consecutive clocks (e.g. on a tempo jump)
+#define DLL_OUTLIER_MIN_US   500
+#define DLL_OUTLIERS_RELOCK  3
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
@@ -85,6 +120,7 @@ static s32 SEQ_BPM_TimerInit(void);
 static void SEQ_BPM_Timer_Slave(void);
 static void SEQ_BPM_Timer_Master(void);
 static s32 SEQ_BPM_DigitUpdate(void);
+static s32 SEQ_BPM_NotifyMIDIRxDelay(u8 midi_byte, s32 clk_period_q8, s32 *clk_offset_q8);
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -112,12 +148,36 @@ static u16 ppqn;
 
 static u32 incoming_clk_ctr;
 static u32 incoming_clk_delay;
-static u32 sent_clk_ctr;
-static u32 sent_clk_delay;
+static s32 sent_clk_ctr;
+static u32 sent_clk_period_q8; // timer ticks * 256 between two internal clocks
+static u32 sent_clk_phase_q8;
 
 static u16 new_song_pos;
 static u8  receive_song_pos_state;
 
+static u8  clk_timestamp_valid;
+static u32 clk_timestamp_last;
+static u32 clk_period_avg_x8; // average clock interval in uS * 8
+
+static seq_bpm_jitter_t jitter;
+
+// DLL state (all times in uS * 256)
+static u8  dll_locked;
+static u8  dll_resync;
+static u8  dll_outliers;
+static u32 dll_relocks;
+static u32 dll_t_predicted_q8;
+static u32 dll_period_q8;
+static s32 dll_phase_error_q8;
+static u32 dll_jitter_q8; // average of the absolute phase error
+static u32 dll_b_q16;
+static u32 dll_c_q16;
+
+// upper limits of the jitter histogram bins in uS
+static const u32 jitter_bin_limit[SEQ_BPM_JITTER_BINS] = {
+  25, 50, 100, 250, 500, 1000, 2500, 0xffffffff
+};
+
 
 /////////////////////////////////////////////////////////////////////////////
 //! Initialisation of BPM generator
@@ -142,7 +202,15 @@ s32 SEQ_BPM_Init(u32 mode)
   incoming_clk_ctr = 0;
   incoming_clk_delay = 0;
   sent_clk_ctr = 0;
-  sent_clk_delay = 0;
+  sent_clk_period_q8 = 0;
+  sent_clk_phase_q8 = 0;
+
+  clk_timestamp_valid = 0;
+  SEQ_BPM_JitterReset();
+
+  dll_locked = 0;
+  dll_relocks = 0;
+  SEQ_BPM_DLL_BandwidthSet(SEQ_BPM_DLL_DEFAULT_BANDWIDTH);
 
   // start clock generator with 140 BPM/384 ppqn in Auto mode
   ppqn = 384;
@@ -361,10 +429,11 @@ static void SEQ_BPM_Timer_Slave(void)
   // increment clock counter, used to measure the delay between two F8 events
   ++incoming_clk_ctr;
 
-  // decrement sent clock delay, send interpolated clock events ((ppqn/24)-1) times
-  if( sent_clk_delay && --sent_clk_delay == 0 ) {
-    if( sent_clk_ctr < (ppqn/24) ) {
-      sent_clk_delay = incoming_clk_delay/(ppqn/24);
+  // advance the phase of the interpolated clock, send interpolated clock events ((ppqn/24)-1) times
+  if( sent_clk_period_q8 && sent_clk_ctr < (ppqn/24) ) {
+    sent_clk_phase_q8 += 256;
+    if( sent_clk_phase_q8 >= sent_clk_period_q8 ) {
+      sent_clk_phase_q8 -= sent_clk_period_q8;
       ++sent_clk_ctr;
 
       if( run_mode == SEQ_BPM_RUN_MODE_Clocked ) {
@@ -399,6 +468,225 @@ static s32 SEQ_BPM_DigitUpdate(void)
 //! \return < 0 on errors
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_BPM_NotifyMIDIRx(u8 midi_byte)
+{
+  return SEQ_BPM_NotifyMIDIRxDelay(midi_byte, -1, NULL);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Alternative to SEQ_BPM_NotifyMIDIRx() for realtime messages which have
+//! been timestamped on arrival, e.g. by a realtime tap installed with
+//! MIOS32_MIDI_RealtimeTap_Init().<BR>
+//! The delay between two MIDI clocks is measured with the timestamps, and
+//! the deviations are collected in the jitter histogram.
+//! \param[in] midi_byte the received MIDI byte
+//! \param[in] timestamp arrival time in uS (see MIOS32_MIDI_TimestampGet())
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_NotifyMIDIRxTimestamp(u8 midi_byte, u32 timestamp)
+{
+  s32 clk_period_q8 = -1;
+  s32 clk_offset_q8 = 0;
+
+  if( midi_byte == 0xf8 ) {
+    MIOS32_IRQ_Disable();
+
+    u32 interval = timestamp - clk_timestamp_last;
+    if( !clk_timestamp_valid || interval >= (SLAVE_CLK_TIMEOUT_DELAY*SLAVE_CLK_TIMER_US) ) {
+      // no reference: the loop has to be locked again
+      dll_locked = 0;
+    } else {
+      u32 t_q8 = timestamp << 8;
+      s32 period_correction_q8 = 0;
+
+      if( !dll_locked ) {
+	// lock to the measured interval
+	dll_period_q8 = interval << 8;
+	dll_phase_error_q8 = 0;
+	dll_jitter_q8 = 0;
+	dll_resync = 0;
+	dll_outliers = 0;
+	dll_locked = 1;
+      } else {
+	s32 e = (s32)(t_q8 - dll_t_predicted_q8);
+	u32 abs_e = (e >= 0) ? e : -e;
+
+	// errors which are much larger than the average jitter are outliers
+	if( abs_e > (4*dll_jitter_q8 + (DLL_OUTLIER_MIN_US << 8)) )
+	  ++dll_outliers;
+	else
+	  dll_outliers = 0;
+
+	if( abs_e > (dll_period_q8 / 2) || dll_outliers >= DLL_OUTLIERS_RELOCK ) {
+	  // clock dropped, or sudden tempo change: sync to the arrival time,
+	  // and take over the measured interval if the error persists
+	  if( dll_resync || dll_outliers >= DLL_OUTLIERS_RELOCK )
+	    dll_period_q8 = interval << 8;
+	  dll_resync = 1;
+	  dll_outliers = 0;
+	  ++dll_relocks;
+	  e = 0;
+	  abs_e = 0;
+	} else {
+	  dll_resync = 0;
+
+	  // second order loop
+	  t_q8 = dll_t_predicted_q8 + (s32)(((long long)dll_b_q16 * e) >> 16);
+	  period_correction_q8 = (s32)(((long long)dll_c_q16 * e) >> 16);
+	}
+
+	dll_phase_error_q8 = e;
+	dll_jitter_q8 = dll_jitter_q8 - (dll_jitter_q8 / 16) + (abs_e / 16);
+      }
+
+      dll_t_predicted_q8 = t_q8 + dll_period_q8;
+      dll_period_q8 += period_correction_q8;
+
+      // filtered delay in timer ticks * 256, and the time since the
+      // filtered arrival time of this F8 event
+      clk_period_q8 = dll_period_q8 / SLAVE_CLK_TIMER_US;
+      clk_offset_q8 = (s32)((timestamp << 8) - t_q8) / SLAVE_CLK_TIMER_US;
+
+      // update jitter statistics
+      if( !jitter.clocks ) {
+	clk_period_avg_x8 = 8*interval;
+      } else {
+	u32 period_avg = clk_period_avg_x8 / 8;
+	u32 deviation = (interval > period_avg) ? (interval - period_avg) : (period_avg - interval);
+
+	int bin;
+	for(bin=0; deviation > jitter_bin_limit[bin]; ++bin);
+	++jitter.bin[bin];
+
+	if( deviation > jitter.max_us )
+	  jitter.max_us = deviation;
+
+	clk_period_avg_x8 = clk_period_avg_x8 - period_avg + interval;
+      }
+      ++jitter.clocks;
+      jitter.period_us = clk_period_avg_x8 / 8;
+    }
+
+    clk_timestamp_last = timestamp;
+    clk_timestamp_valid = 1;
+
+    MIOS32_IRQ_Enable();
+  }
+
+  return SEQ_BPM_NotifyMIDIRxDelay(midi_byte, clk_period_q8, (clk_period_q8 >= 0) ? &clk_offset_q8 : NULL);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the jitter statistics of the incoming MIDI clock.<BR>
+//! The deviation of each clock interval from the average interval is
+//! counted in a histogram, the upper limits of the bins can be retrieved
+//! with SEQ_BPM_JitterBinLimitGet()
+//! \param[out] _jitter pointer to the statistics structure
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_JitterGet(seq_bpm_jitter_t *_jitter)
+{
+  MIOS32_IRQ_Disable();
+  *_jitter = jitter;
+  MIOS32_IRQ_Enable();
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! Resets the jitter statistics of the incoming MIDI clock
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_JitterReset(void)
+{
+  int bin;
+
+  MIOS32_IRQ_Disable();
+  jitter.clocks = 0;
+  jitter.period_us = 0;
+  jitter.max_us = 0;
+  for(bin=0; bin<SEQ_BPM_JITTER_BINS; ++bin)
+    jitter.bin[bin] = 0;
+  MIOS32_IRQ_Enable();
+
+  return 0; // no error
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//! \param[in] bin number of the jitter histogram bin (0..SEQ_BPM_JITTER_BINS-1)
+//! \return upper limit of the bin in uS (0xffffffff for the last bin)
+/////////////////////////////////////////////////////////////////////////////
+u32 SEQ_BPM_JitterBinLimitGet(u8 bin)
+{
+  return (bin < SEQ_BPM_JITTER_BINS) ? jitter_bin_limit[bin] : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Sets the bandwidth of the DLL which filters the timestamps of the
+//! incoming MIDI clock (see SEQ_BPM_NotifyMIDIRxTimestamp()).<BR>
+//! The bandwidth is specified relative to the MIDI clock rate, e.g. 0.01
+//! at 120 BPM (48 clocks per second) results into a loop bandwidth of
+//! ca. 0.5 Hz. Lower values result into less jitter, higher values
+//! into faster tracking of tempo changes.
+//! \param[in] bandwidth 0.001..0.1
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_DLL_BandwidthSet(float bandwidth)
+{
+  if( bandwidth < 0.001 || bandwidth > 0.1 )
+    return -1; // invalid bandwidth
+
+  float w = 2 * 3.14159265 * bandwidth;
+
+  MIOS32_IRQ_Disable();
+  dll_b_q16 = (u32)(1.41421356 * w * DLL_COEFF_ONE);
+  dll_c_q16 = (u32)(w * w * DLL_COEFF_ONE);
+  MIOS32_IRQ_Enable();
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//! Returns the state of the DLL which filters the timestamps of the
+//! incoming MIDI clock
+//! \param[out] state pointer to the state structure
+//! \return < 0 on errors
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_BPM_DLL_StateGet(seq_bpm_dll_state_t *state)
+{
+  MIOS32_IRQ_Disable();
+  u8 locked = dll_locked;
+  u32 period_q8 = dll_period_q8;
+  s32 phase_error_q8 = dll_phase_error_q8;
+  u32 jitter_q8 = dll_jitter_q8;
+  u32 relocks = dll_relocks;
+  MIOS32_IRQ_Enable();
+
+  state->locked = locked;
+  state->relocks = relocks;
+  state->period_us = (period_q8 + 128) >> 8;
+  state->phase_error_us = phase_error_q8 / 256;
+  state->jitter_us = (jitter_q8 + 128) >> 8;
+  state->bpm = (locked && period_q8) ? ((60E6 * 256 / 24) / (float)period_q8) : 0.0;
+
+  return 0; // no error
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Handles incoming MIDI bytes
+// IN: <midi_byte> the received byte
+//     <clk_period_q8> the (filtered) delay between two F8 events in
+//     SLAVE_CLK_TIMER_US steps * 256 if it has been measured with timestamps,
+//     -1 if incoming_clk_ctr should be taken
+//     <clk_offset_q8> pointer to the time since the filtered arrival time
+//     of the F8 event in SLAVE_CLK_TIMER_US steps * 256, NULL if the clock
+//     isn't filtered
+/////////////////////////////////////////////////////////////////////////////
+static s32 SEQ_BPM_NotifyMIDIRxDelay(u8 midi_byte, s32 clk_period_q8, s32 *clk_offset_q8)
 {
   // any MIDI clock/start/cont/stop event received?
   if( midi_byte == 0xf8 || (midi_byte >= 0xfa && midi_byte <= 0xfc) ) {
@@ -419,29 +707,64 @@ s32 SEQ_BPM_NotifyMIDIRx(u8 midi_byte)
     if( midi_byte == 0xf8 ) { // MIDI clock
 
       // we've measured a new delay between two F8 events
-      incoming_clk_delay = incoming_clk_ctr;
+      if( clk_period_q8 < 0 )
+	clk_period_q8 = ((incoming_clk_ctr < SLAVE_CLK_TIMEOUT_DELAY) ? incoming_clk_ctr : SLAVE_CLK_TIMEOUT_DELAY) << 8;
+      incoming_clk_delay = (clk_period_q8 + 128) >> 8;
       incoming_clk_ctr = 0;
 
       // get new SENT_CLK delay
-      sent_clk_delay = incoming_clk_delay / (ppqn/24);
+      sent_clk_period_q8 = clk_period_q8 / (ppqn/24);
 
-      // how many clocks (still) need to be triggered?
-      if( run_mode == SEQ_BPM_RUN_MODE_Clocked ) {
+      if( clk_offset_q8 != NULL && run_mode == SEQ_BPM_RUN_MODE_Clocked ) {
+	// filtered clock: the interpolated clocks of the previous F8 event
+	// are continued by the timer, and the phase is aligned to the filtered
+	// arrival time, so that the jitter of the F8 events doesn't result
+	// into bursts
 	int open_requests = (ppqn/24) - sent_clk_ctr;
-	if( open_requests > 0 ) {
-	  bpm_req_clk_ctr += open_requests;
-	  bpm_tick += open_requests;
+	if( open_requests > (ppqn/24) ) {
+	  // more than one F8 event behind: catch up immediately
+	  bpm_req_clk_ctr += open_requests - (ppqn/24);
+	  bpm_tick += open_requests - (ppqn/24);
+	  open_requests = (ppqn/24);
+	} else if( open_requests < 0 ) {
+	  open_requests = 0;
 	}
-      }
 
-      if( run_mode != SEQ_BPM_RUN_MODE_Off ) {
-	// send clock immediately if sequencer running
-	sent_clk_ctr = 1;
-	++bpm_tick;
-	++bpm_req_clk_ctr;
+	// the next interpolated clock is due (open_requests+1) clocks before
+	// the filtered arrival time of this F8 event
+	s32 phase_q8 = (s32)sent_clk_period_q8 * (1 + open_requests) + *clk_offset_q8;
+	sent_clk_phase_q8 = (phase_q8 > 0) ? phase_q8 : 0;
+	sent_clk_ctr = -open_requests;
+
+	// send clock immediately if it's due
+	if( sent_clk_phase_q8 >= sent_clk_period_q8 ) {
+	  sent_clk_phase_q8 -= sent_clk_period_q8;
+	  ++sent_clk_ctr;
+	  ++bpm_tick;
+	  ++bpm_req_clk_ctr;
+	}
       } else {
-	// sequencer not running: don't request new clock(s)
-	sent_clk_ctr = 0;
+	// the phase starts with this F8 event
+	sent_clk_phase_q8 = 0;
+
+	// how many clocks (still) need to be triggered?
+	if( run_mode == SEQ_BPM_RUN_MODE_Clocked ) {
+	  int open_requests = (ppqn/24) - sent_clk_ctr;
+	  if( open_requests > 0 ) {
+	    bpm_req_clk_ctr += open_requests;
+	    bpm_tick += open_requests;
+	  }
+	}
+
+	if( run_mode != SEQ_BPM_RUN_MODE_Off ) {
+	  // send clock immediately if sequencer running
+	  sent_clk_ctr = 1;
+	  ++bpm_tick;
+	  ++bpm_req_clk_ctr;
+	} else {
+	  // sequencer not running: don't request new clock(s)
+	  sent_clk_ctr = 0;
+	}
       }
 
       // if first clock after start or continue event: set run state to 2
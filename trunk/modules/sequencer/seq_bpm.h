@@ -23,6 +23,15 @@
 #define SEQ_BPM_MIOS32_TIMER_NUM 0
 #endif
 
+// number of bins of the incoming MIDI clock jitter histogram (see SEQ_BPM_JitterGet())
+#define SEQ_BPM_JITTER_BINS 8
+
+// default bandwidth of the DLL which filters the incoming MIDI clock,
+// relative to the clock rate (see SEQ_BPM_DLL_BandwidthSet())
+#ifndef SEQ_BPM_DLL_DEFAULT_BANDWIDTH
+#define SEQ_BPM_DLL_DEFAULT_BANDWIDTH 0.01
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -40,6 +49,26 @@ typedef enum {
   SEQ_BPM_RUN_MODE_Clocked
 } seq_bpm_run_mode_t;
 
+//! jitter statistics of the incoming MIDI clock
+//! (only measured if clocks are notified with SEQ_BPM_NotifyMIDIRxTimestamp())
+typedef struct {
+  u32 clocks;     // number of measured clock intervals
+  u32 period_us;  // average clock interval in uS
+  u32 max_us;     // max. deviation from the average clock interval in uS
+  u32 bin[SEQ_BPM_JITTER_BINS]; // histogram of the deviations, see SEQ_BPM_JitterBinLimitGet()
+} seq_bpm_jitter_t;
+
+//! state of the DLL which filters the incoming MIDI clock
+//! (only available if clocks are notified with SEQ_BPM_NotifyMIDIRxTimestamp())
+typedef struct {
+  u8  locked;         // 1 if the loop is locked to the incoming clock
+  u32 relocks;        // number of relocks due to lost clocks or tempo jumps
+  u32 period_us;      // filtered clock interval in uS
+  s32 phase_error_us; // arrival time of the last clock - predicted time
+  u32 jitter_us;      // average absolute phase error in uS
+  float bpm;          // estimated BPM
+} seq_bpm_dll_state_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -65,6 +94,14 @@ extern s32 SEQ_BPM_IsMaster(void);
 extern s32 SEQ_BPM_CheckAutoMaster(void);
 
 extern s32 SEQ_BPM_NotifyMIDIRx(u8 midi_byte);
+extern s32 SEQ_BPM_NotifyMIDIRxTimestamp(u8 midi_byte, u32 timestamp);
+
+extern s32 SEQ_BPM_JitterGet(seq_bpm_jitter_t *jitter);
+extern s32 SEQ_BPM_JitterReset(void);
+extern u32 SEQ_BPM_JitterBinLimitGet(u8 bin);
+
+extern s32 SEQ_BPM_DLL_BandwidthSet(float bandwidth);
+extern s32 SEQ_BPM_DLL_StateGet(seq_bpm_dll_state_t *state);
 
 extern s32 SEQ_BPM_Start(void);
 extern s32 SEQ_BPM_Cont(void);
@@ -22,7 +22,7 @@
 #include "seq_midi_out.h"
 #include "seq_bpm.h"
 
-#if SEQ_MIDI_OUT_MALLOC_METHOD != 5
+#if SEQ_MIDI_OUT_MALLOC_METHOD != 5 || SEQ_MIDI_OUT_SCHEDULER == 1
 // FreeRTOS based malloc required
 #include <FreeRTOS.h>
 #endif
@@ -46,16 +46,50 @@ typedef struct seq_midi_out_queue_item_t {
   u16                   len;
   mios32_midi_package_t package;
   u32                   timestamp;
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  u32                   seq;      // insertion counter, keeps FIFO order of events with same timestamp
+  u32                   order;    // seq of the item, for CCs seq of the first On event at the same timestamp
+  u16                   heap_pos; // position in sched_heap[]
+  u16                   tag_prev; // pool index of previous item with the same tag
+  u16                   tag_next; // pool index of next item with the same tag
+  u16                   on_prev;  // pool index of previous On/OnOff event at the same timestamp
+  u16                   on_next;  // pool index of next On/OnOff event at the same timestamp
+  u8                    prio;     // 0: Clock/Tempo, 1: CC, 2: Notes
+#else
   struct seq_midi_out_queue_item_t *next;
+#endif
 } seq_midi_out_queue_item_t;
 
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+// links the On/OnOff events which are scheduled at a given timestamp
+// in the order they have been scheduled
+typedef struct {
+  u32 timestamp;
+  u16 first; // pool index of the first On/OnOff event, SEQ_MIDI_OUT_NO_ITEM: free entry
+  u16 last;  // pool index of the last On/OnOff event
+} seq_midi_out_on_entry_t;
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Local prototypes
 /////////////////////////////////////////////////////////////////////////////
 
+static inline u8 SEQ_MIDI_OUT_EventPrio(u8 event_type);
+static seq_midi_out_queue_item_t *SEQ_MIDI_OUT_ItemCreate(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len);
 static seq_midi_out_queue_item_t *SEQ_MIDI_OUT_SlotMalloc(void);
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+static inline s32 SEQ_MIDI_OUT_HeapBefore(seq_midi_out_queue_item_t *a, seq_midi_out_queue_item_t *b);
+static void SEQ_MIDI_OUT_HeapInsert(seq_midi_out_queue_item_t *item);
+static void SEQ_MIDI_OUT_HeapOrderSet(seq_midi_out_queue_item_t *item);
+static void SEQ_MIDI_OUT_OnEntryRelease(seq_midi_out_queue_item_t *item);
+static void SEQ_MIDI_OUT_HeapRemove(u32 pos);
+static void SEQ_MIDI_OUT_HeapSiftUp(u32 pos);
+static void SEQ_MIDI_OUT_HeapSiftDown(u32 pos);
+#else
+static void SEQ_MIDI_OUT_QueueInsert(seq_midi_out_queue_item_t *new_item, seq_midi_out_queue_item_t *start_item);
 static void SEQ_MIDI_OUT_SlotFree(seq_midi_out_queue_item_t *item);
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
@@ -69,6 +103,10 @@ u32 seq_midi_out_allocated;
 #if SEQ_MIDI_OUT_MALLOC_ANALYSIS
 u32 seq_midi_out_max_allocated;
 u32 seq_midi_out_dropouts;
+
+//! number of queue items visited by the last SEQ_MIDI_OUT_ReSchedule call, and the max value
+u32 seq_midi_out_reschedule_visited;
+u32 seq_midi_out_reschedule_visited_max;
 #endif
 
 
@@ -81,10 +119,44 @@ static s32 (*callback_bpm_is_running)(void);
 static u32 (*callback_bpm_tick_get)(void);
 static s32 (*callback_bpm_set)(float bpm);
 
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+
+#if SEQ_MIDI_OUT_MAX_EVENTS > 32768
+# error "SEQ_MIDI_OUT_SCHEDULER 1 supports up to 32768 events"
+#endif
+
+// terminates the tag lists
+#define SEQ_MIDI_OUT_NO_ITEM 0xffff
+
+// max number of events which are sorted by SEQ_MIDI_OUT_ReSchedule with one pass through the tag list
+#define SEQ_MIDI_OUT_RESCHEDULE_BATCH 16
+
+// all events are located in sched_pool
+// sched_heap[0..seq_midi_out_allocated-1] contains the pool indices of scheduled
+// events, sorted as binary min-heap (earliest event at sched_heap[0])
+// the remaining entries contain the indices of free pool slots
+static seq_midi_out_queue_item_t *sched_pool;
+static u16 sched_heap[SEQ_MIDI_OUT_MAX_EVENTS];
+static u32 sched_seq;
+
+// scheduled events are linked to a list for each tag (mios32_midi_package_t.cable)
+static u16 sched_tag_first[16];
+static u16 sched_tag_last[16];
+
+// the linked list sorts a CC directly before the first On/OnOff event at the
+// same timestamp, therefore the On/OnOff events are linked for each timestamp
+// (hash table with linear probing, the table can't be full since each entry
+// belongs to at least one event in sched_pool)
+static seq_midi_out_on_entry_t sched_on[SEQ_MIDI_OUT_MAX_EVENTS];
+
+#else
+
 static seq_midi_out_queue_item_t *midi_queue;
 
+#endif
+
 
-#if SEQ_MIDI_OUT_MALLOC_METHOD >= 0 && SEQ_MIDI_OUT_MALLOC_METHOD <= 3
+#if SEQ_MIDI_OUT_SCHEDULER == 0 && SEQ_MIDI_OUT_MALLOC_METHOD >= 0 && SEQ_MIDI_OUT_MALLOC_METHOD <= 3
 
 // determine flag array width and mask
 #if SEQ_MIDI_OUT_MALLOC_METHOD == 0
@@ -133,6 +205,8 @@ s32 SEQ_MIDI_OUT_Init(u32 mode)
 #if SEQ_MIDI_OUT_MALLOC_ANALYSIS
   seq_midi_out_max_allocated = 0;
   seq_midi_out_dropouts = 0;
+  seq_midi_out_reschedule_visited = 0;
+  seq_midi_out_reschedule_visited_max = 0;
 #endif
 
   // memory will be allocated with first event
@@ -275,120 +349,31 @@ s32 SEQ_MIDI_OUT_Callback_BPM_Set_Set(void *_callback_bpm_set)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_MIDI_OUT_Send(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len)
 {
-  // failsave measure:
-  // don't take On or OnOff item if heap is almost completely allocated
-  if( seq_midi_out_allocated >= (SEQ_MIDI_OUT_MAX_EVENTS-2) && // should be enough for a On *and* Off event
-      (event_type == SEQ_MIDI_OUT_OnEvent || event_type == SEQ_MIDI_OUT_OnOffEvent) ) {
-#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
-    ++seq_midi_out_dropouts;
-#endif
-    return -1; // allocation error
-  };
-
   // create new item
   seq_midi_out_queue_item_t *new_item;
-  if( (new_item=SEQ_MIDI_OUT_SlotMalloc()) == NULL ) {
+  if( (new_item=SEQ_MIDI_OUT_ItemCreate(port, midi_package, event_type, timestamp, len)) == NULL )
     return -1; // allocation error
-  } else {
-    new_item->port = port;
-    new_item->package = midi_package;
-    new_item->event_type = event_type;
-    new_item->timestamp = timestamp;
-    new_item->len = len;
-    new_item->next = NULL;
-  }
 
-#if DEBUG_VERBOSE_LEVEL >= 2
-#if DEBUG_VERBOSE_LEVEL == 2
-  if( event_type != SEQ_MIDI_OUT_ClkEvent )
-#endif
-  DEBUG_MSG("[SEQ_MIDI_OUT_Send:%u] (tag %d) %02x %02x %02x len:%u\n", timestamp, midi_package.cable, midi_package.evnt0, midi_package.evnt1, midi_package.evnt2, len);
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  SEQ_MIDI_OUT_HeapInsert(new_item);
+#else
+  SEQ_MIDI_OUT_QueueInsert(new_item, NULL);
 #endif
 
-  // search in queue for last item which has the same (or earlier) timestamp
-  seq_midi_out_queue_item_t *item;
-  if( (item=midi_queue) == NULL ) {
-    // no item in queue -- first element
-    midi_queue = new_item;
-  } else {
-    u8 insert_before_item = 0;
-    seq_midi_out_queue_item_t *last_item = NULL;
-    seq_midi_out_queue_item_t *next_item;
-    do {
-      // Clock and Tempo events are sorted before CC and Note events at a given timestamp
-      if( (event_type == SEQ_MIDI_OUT_ClkEvent || event_type == SEQ_MIDI_OUT_TempoEvent ) && 
-	  item->timestamp >= timestamp &&
-	  (item->event_type == SEQ_MIDI_OUT_OnEvent || 
-	   item->event_type == SEQ_MIDI_OUT_OffEvent || 
-	   item->event_type == SEQ_MIDI_OUT_OnOffEvent || 
-	   item->event_type == SEQ_MIDI_OUT_CCEvent) ) {
-	// found any event with same timestamp, insert clock before these events
-	// note that the Clock event order doesn't get lost if clock events 
-	// are queued at the same timestamp (e.g. MIDI start -> MIDI clock)
-	insert_before_item = 1;
-	break;
-      }
-
-      // CCs are sorted before notes at a given timestamp
-      // (new CC before On events at the same timestamp)
-      // CCs are still played after Off or Clock events
-      if( event_type == SEQ_MIDI_OUT_CCEvent && 
-	  item->timestamp == timestamp &&
-	  (item->event_type == SEQ_MIDI_OUT_OnEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent) ) {
-	// found On event with same timestamp, play CC before On event
-	insert_before_item = 1;
-	break;
-      }
-
-      if( item->timestamp > timestamp ) {
-	// found entry with later timestamp
-	insert_before_item = 1;
-	break;
-      }
-
-      if( (next_item=item->next) == NULL ) {
-	// end of queue reached, insert new item at the end
-	break;
-      }
-	
-      if( next_item->timestamp > timestamp ) {
-	// found entry with later timestamp
-	break;
-      }
-
-      // switch to next item
-      last_item = item;
-      item = next_item;
-    } while( 1 );
-
-    // insert/add item into/to list
-    if( insert_before_item ) {
-      if( last_item == NULL )
-	midi_queue = new_item;
-      else
-	last_item->next = new_item;
-      new_item->next = item;
-    } else {
-      item->next = new_item;
-      new_item->next = next_item;
-    }
-  }
-
   // schedule off event now if length > 16bit (since it cannot be stored in event record)
   if( event_type == SEQ_MIDI_OUT_OnOffEvent && len > 0xffff ) {
     return SEQ_MIDI_OUT_Send(port, midi_package, event_type, timestamp+len, 0);
   }
 
   // display queue
-#if DEBUG_VERBOSE_LEVEL >= 4
+#if DEBUG_VERBOSE_LEVEL >= 4 && SEQ_MIDI_OUT_SCHEDULER == 0
   DEBUG_MSG("--- vvv ---\n");
-  item=midi_queue;
+  seq_midi_out_queue_item_t *item=midi_queue;
   while( item != NULL ) {
     DEBUG_MSG("[%u] (tag %d) %02x %02x %02x len:%u\n", item->timestamp, item->package.cable, item->package.evnt0, item->package.evnt1, item->package.evnt2, item->len);
     item = item->next;
   }
   DEBUG_MSG("--- ^^^ ---\n");
-  
 #endif
 
 
@@ -396,6 +381,65 @@ s32 SEQ_MIDI_OUT_Send(mios32_midi_port_t port, mios32_midi_package_t midi_packag
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//! This function schedules multiple MIDI events with a single pass through
+//! the queue.
+//!
+//! The events should be sorted by timestamp, and at the same timestamp
+//! Clock/Tempo events before CCs, and CCs before Notes. In this case each
+//! event is inserted behind the previous one, so that the queue is only
+//! searched once for the whole batch. If an event is not sorted, the search
+//! will be restarted from the beginning of the queue, so that the result is
+//! always the same like with separate SEQ_MIDI_OUT_Send() calls.
+//!
+//! \param[in] events pointer to an array of events
+//! \param[in] num_events number of events in the array
+//! \return 0 if all events have been scheduled successfully
+//! \return -1 if out of memory (remaining events will still be scheduled if possible)
+/////////////////////////////////////////////////////////////////////////////
+s32 SEQ_MIDI_OUT_SendBatch(seq_midi_out_event_t *events, u32 num_events)
+{
+  s32 status = 0;
+#if SEQ_MIDI_OUT_SCHEDULER == 0
+  seq_midi_out_queue_item_t *prev_item = NULL;
+  u32 prev_timestamp = 0;
+  u8 prev_prio = 0;
+#endif
+
+  int i;
+  seq_midi_out_event_t *e = events;
+  for(i=0; i<num_events; ++i, ++e) {
+    seq_midi_out_queue_item_t *new_item;
+    if( (new_item=SEQ_MIDI_OUT_ItemCreate(e->port, e->package, e->event_type, e->timestamp, e->len)) == NULL ) {
+      status = -1; // allocation error
+      continue;
+    }
+
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+    SEQ_MIDI_OUT_HeapInsert(new_item);
+#else
+    // continue search behind the previous event if the batch is sorted
+    u8 prio = SEQ_MIDI_OUT_EventPrio(e->event_type);
+    if( e->timestamp < prev_timestamp || (e->timestamp == prev_timestamp && prio < prev_prio) )
+      prev_item = NULL;
+    prev_timestamp = e->timestamp;
+    prev_prio = prio;
+
+    SEQ_MIDI_OUT_QueueInsert(new_item, prev_item);
+    prev_item = new_item;
+#endif
+
+    // schedule off event now if length > 16bit (since it cannot be stored in event record)
+    if( e->event_type == SEQ_MIDI_OUT_OnOffEvent && e->len > 0xffff ) {
+      if( SEQ_MIDI_OUT_Send(e->port, e->package, e->event_type, e->timestamp+e->len, 0) < 0 )
+	status = -1;
+    }
+  }
+
+  return status;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //! This function re-schedules MIDI Off/OnOff events assigned to a given "tag"
 //! (0..15, stored in mios32_midi_package_t.cable of events which already have been
@@ -417,11 +461,82 @@ s32 SEQ_MIDI_OUT_Send(mios32_midi_port_t port, mios32_midi_package_t midi_packag
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_MIDI_OUT_ReSchedule(u8 tag, seq_midi_out_event_type_t event_type, u32 timestamp)
 {
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+  u32 visited = 0;
+#endif
+
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  // only the items with the given tag have to be checked
+  if( sched_pool == NULL )
+    return 0; // nothing scheduled yet
+
+  // the events are re-scheduled in the order in which they would have been sent,
+  // so that they keep this order at the new timestamp
+  // they are sorted in batches of SEQ_MIDI_OUT_RESCHEDULE_BATCH events, the tag list
+  // is searched again if more events have to be re-scheduled
+  u8 more;
+  do {
+    u16 resched[SEQ_MIDI_OUT_RESCHEDULE_BATCH];
+    u32 num = 0;
+    more = 0;
+
+    u16 ix = sched_tag_first[tag & 0xf];
+    while( ix != SEQ_MIDI_OUT_NO_ITEM ) {
+      seq_midi_out_queue_item_t *item = &sched_pool[ix];
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+      ++visited;
+#endif
+
+      // filter event_type
+      // and ignore events, which will be played with next invocation of the Out Handler to avoid,
+      // that a re-scheduled event will be checked again
+      if( (item->event_type == event_type) && (item->timestamp > timestamp) ) {
+	if( num == SEQ_MIDI_OUT_RESCHEDULE_BATCH ) {
+	  // batch full: drop the latest event, it will be found again
+	  more = 1;
+	  if( SEQ_MIDI_OUT_HeapBefore(item, &sched_pool[resched[num-1]]) )
+	    --num;
+	}
+
+	if( num < SEQ_MIDI_OUT_RESCHEDULE_BATCH ) {
+	  u32 pos = num++;
+	  while( pos > 0 && SEQ_MIDI_OUT_HeapBefore(item, &sched_pool[resched[pos-1]]) ) {
+	    resched[pos] = resched[pos-1];
+	    --pos;
+	  }
+	  resched[pos] = ix;
+	}
+      }
+
+      ix = item->tag_next;
+    }
+
+    u32 i;
+    for(i=0; i<num; ++i) {
+      seq_midi_out_queue_item_t *item = &sched_pool[resched[i]];
+#if DEBUG_VERBOSE_LEVEL >= 2
+      DEBUG_MSG("[SEQ_MIDI_OUT_ReSchedule:%u] (tag %d) %02x %02x %02x\n", timestamp, item->package.cable, item->package.evnt0, item->package.evnt1, item->package.evnt2);
+#endif
+
+      // the new timestamp is earlier, so that the item can only move towards the root
+      // the pool index (and therefore the tag list) isn't changed
+      if( item->event_type == SEQ_MIDI_OUT_OnEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent )
+	SEQ_MIDI_OUT_OnEntryRelease(item);
+      item->timestamp = timestamp;
+      SEQ_MIDI_OUT_HeapOrderSet(item);
+      SEQ_MIDI_OUT_HeapSiftUp(item->heap_pos);
+    }
+  } while( more );
+#else
   // search in queue for items with the given tag
 
   seq_midi_out_queue_item_t *prev_item = NULL;
   seq_midi_out_queue_item_t *item = midi_queue;
   while( item != NULL ) {
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+    ++visited;
+#endif
+
     // filter event_type and tag
     // and ignore events, which will be played with next invocation of the Out Handler to avoid,
     // that a re-scheduled event will be checked again
@@ -466,6 +581,9 @@ s32 SEQ_MIDI_OUT_ReSchedule(u8 tag, seq_midi_out_event_type_t event_type, u32 ti
 	prev_item = NULL;
 	seq_midi_out_queue_item_t *tmp_item = midi_queue;
 	while( tmp_item != NULL ) {
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+	  ++visited;
+#endif
 	  if( tmp_item->next == item ) {
 	    prev_item = tmp_item;
 	    break;
@@ -488,6 +606,13 @@ s32 SEQ_MIDI_OUT_ReSchedule(u8 tag, seq_midi_out_event_type_t event_type, u32 ti
       item = item->next;
     }
   }
+#endif
+
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+  seq_midi_out_reschedule_visited = visited;
+  if( visited > seq_midi_out_reschedule_visited_max )
+    seq_midi_out_reschedule_visited_max = visited;
+#endif
 
   return 0; // no error
 }
@@ -499,6 +624,17 @@ s32 SEQ_MIDI_OUT_ReSchedule(u8 tag, seq_midi_out_event_type_t event_type, u32 ti
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_MIDI_OUT_FlushQueue(void)
 {
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  while( seq_midi_out_allocated ) {
+    seq_midi_out_queue_item_t *item = &sched_pool[sched_heap[0]];
+    if( item->event_type == SEQ_MIDI_OUT_OffEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent ) {
+      item->package.velocity = 0; // ensure that velocity is 0
+      callback_midi_send_package(item->port, item->package);
+    }
+
+    SEQ_MIDI_OUT_HeapRemove(0);
+  }
+#else
   seq_midi_out_queue_item_t *item;
   while( (item=midi_queue) != NULL ) {
     if( item->event_type == SEQ_MIDI_OUT_OffEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent ) {
@@ -509,6 +645,7 @@ s32 SEQ_MIDI_OUT_FlushQueue(void)
     midi_queue = item->next;
     SEQ_MIDI_OUT_SlotFree(item);
   }
+#endif
 
   return 0; // no error
 }
@@ -520,6 +657,16 @@ s32 SEQ_MIDI_OUT_FlushQueue(void)
 /////////////////////////////////////////////////////////////////////////////
 s32 SEQ_MIDI_OUT_FreeHeap(void)
 {
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  // free memory
+  if( sched_pool != NULL ) {
+    vPortFree(sched_pool);
+    sched_pool = NULL;
+  }
+
+  // all slots are free again (sched_heap will be initialized with the next allocation)
+  seq_midi_out_allocated = 0;
+#else
   // ensure that all items are delocated
   seq_midi_out_queue_item_t *item;
   while( (item=midi_queue) != NULL ) {
@@ -544,6 +691,7 @@ s32 SEQ_MIDI_OUT_FreeHeap(void)
   int i;
   for(i=0; i<(SEQ_MIDI_OUT_MAX_EVENTS/SEQ_MIDI_OUT_MALLOC_FLAG_WIDTH); ++i)
     alloc_flags[i] = 0;
+#endif
 #endif
 
   return 0; // no error
@@ -567,7 +715,11 @@ s32 SEQ_MIDI_OUT_Handler(void)
   // has been found which has to be played later than now
 
   seq_midi_out_queue_item_t *item;
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  while( seq_midi_out_allocated && (item=&sched_pool[sched_heap[0]])->timestamp <= callback_bpm_tick_get() ) {
+#else
   while( (item=midi_queue) != NULL && item->timestamp <= callback_bpm_tick_get() ) {
+#endif
 #if DEBUG_VERBOSE_LEVEL >= 2
 #if DEBUG_VERBOSE_LEVEL == 2
     if( item->event_type != SEQ_MIDI_OUT_ClkEvent )
@@ -595,19 +747,26 @@ s32 SEQ_MIDI_OUT_Handler(void)
       copy.len = item->len;
       copy.package.ALL = item->package.ALL;
       copy.timestamp = item->timestamp;
-      copy.next = item->next;
 #endif
       copy.package.velocity = 0; // ensure that velocity is 0
 
       // remove item from queue
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+      SEQ_MIDI_OUT_HeapRemove(0);
+#else
       midi_queue = item->next;
       SEQ_MIDI_OUT_SlotFree(item);
+#endif
 
       SEQ_MIDI_OUT_Send(copy.port, copy.package, SEQ_MIDI_OUT_OffEvent, copy.len + copy.timestamp, 0);
     } else {
       // remove item from queue
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+      SEQ_MIDI_OUT_HeapRemove(0);
+#else
       midi_queue = item->next;
       SEQ_MIDI_OUT_SlotFree(item);
+#endif
     }
   }
 
@@ -615,6 +774,157 @@ s32 SEQ_MIDI_OUT_Handler(void)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Local function which returns the sort priority of an event type at a
+// given timestamp: Clock and Tempo events are sent first, then CCs, then Notes
+/////////////////////////////////////////////////////////////////////////////
+static inline u8 SEQ_MIDI_OUT_EventPrio(u8 event_type)
+{
+  switch( event_type ) {
+  case SEQ_MIDI_OUT_ClkEvent:
+  case SEQ_MIDI_OUT_TempoEvent:
+    return 0;
+  case SEQ_MIDI_OUT_CCEvent:
+    return 1;
+  }
+
+  return 2;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function to allocate and initialize a new queue item
+// returns NULL if no memory free
+/////////////////////////////////////////////////////////////////////////////
+static seq_midi_out_queue_item_t *SEQ_MIDI_OUT_ItemCreate(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len)
+{
+  // failsave measure:
+  // don't take On or OnOff item if heap is almost completely allocated
+  if( seq_midi_out_allocated >= (SEQ_MIDI_OUT_MAX_EVENTS-2) && // should be enough for a On *and* Off event
+      (event_type == SEQ_MIDI_OUT_OnEvent || event_type == SEQ_MIDI_OUT_OnOffEvent) ) {
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+    ++seq_midi_out_dropouts;
+#endif
+    return NULL; // allocation error
+  };
+
+  seq_midi_out_queue_item_t *new_item;
+  if( (new_item=SEQ_MIDI_OUT_SlotMalloc()) == NULL )
+    return NULL; // allocation error
+
+  new_item->port = port;
+  new_item->package = midi_package;
+  new_item->event_type = event_type;
+  new_item->timestamp = timestamp;
+  new_item->len = len;
+#if SEQ_MIDI_OUT_SCHEDULER == 0
+  new_item->next = NULL;
+#endif
+
+#if DEBUG_VERBOSE_LEVEL >= 2
+#if DEBUG_VERBOSE_LEVEL == 2
+  if( event_type != SEQ_MIDI_OUT_ClkEvent )
+#endif
+  DEBUG_MSG("[SEQ_MIDI_OUT_Send:%u] (tag %d) %02x %02x %02x len:%u\n", timestamp, midi_package.cable, midi_package.evnt0, midi_package.evnt1, midi_package.evnt2, len);
+#endif
+
+  return new_item;
+}
+
+
+#if SEQ_MIDI_OUT_SCHEDULER == 0
+/////////////////////////////////////////////////////////////////////////////
+// Local function to sort a new item into the queue
+// the search starts behind start_item (or at the beginning of the queue if NULL)
+// start_item has to be an item which will be sent before the new item!
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_QueueInsert(seq_midi_out_queue_item_t *new_item, seq_midi_out_queue_item_t *start_item)
+{
+  u32 timestamp = new_item->timestamp;
+  u8 event_type = new_item->event_type;
+
+  // search in queue for last item which has the same (or earlier) timestamp
+  seq_midi_out_queue_item_t *item;
+  seq_midi_out_queue_item_t *last_item = NULL;
+  if( start_item != NULL ) {
+    last_item = start_item;
+    item = start_item->next;
+  } else {
+    item = midi_queue;
+  }
+
+  if( item == NULL ) {
+    // end of queue reached -- add item
+    if( last_item == NULL )
+      midi_queue = new_item;
+    else
+      last_item->next = new_item;
+  } else {
+    u8 insert_before_item = 0;
+    seq_midi_out_queue_item_t *next_item;
+    do {
+      // Clock and Tempo events are sorted before CC and Note events at a given timestamp
+      if( (event_type == SEQ_MIDI_OUT_ClkEvent || event_type == SEQ_MIDI_OUT_TempoEvent ) && 
+	  item->timestamp >= timestamp &&
+	  (item->event_type == SEQ_MIDI_OUT_OnEvent || 
+	   item->event_type == SEQ_MIDI_OUT_OffEvent || 
+	   item->event_type == SEQ_MIDI_OUT_OnOffEvent || 
+	   item->event_type == SEQ_MIDI_OUT_CCEvent) ) {
+	// found any event with same timestamp, insert clock before these events
+	// note that the Clock event order doesn't get lost if clock events 
+	// are queued at the same timestamp (e.g. MIDI start -> MIDI clock)
+	insert_before_item = 1;
+	break;
+      }
+
+      // CCs are sorted before notes at a given timestamp
+      // (new CC before On events at the same timestamp)
+      // CCs are still played after Off or Clock events
+      if( event_type == SEQ_MIDI_OUT_CCEvent && 
+	  item->timestamp == timestamp &&
+	  (item->event_type == SEQ_MIDI_OUT_OnEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent) ) {
+	// found On event with same timestamp, play CC before On event
+	insert_before_item = 1;
+	break;
+      }
+
+      if( item->timestamp > timestamp ) {
+	// found entry with later timestamp
+	insert_before_item = 1;
+	break;
+      }
+
+      if( (next_item=item->next) == NULL ) {
+	// end of queue reached, insert new item at the end
+	break;
+      }
+	
+      if( next_item->timestamp > timestamp ) {
+	// found entry with later timestamp
+	break;
+      }
+
+      // switch to next item
+      last_item = item;
+      item = next_item;
+    } while( 1 );
+
+    // insert/add item into/to list
+    if( insert_before_item ) {
+      if( last_item == NULL )
+	midi_queue = new_item;
+      else
+	last_item->next = new_item;
+      new_item->next = item;
+    } else {
+      item->next = new_item;
+      new_item->next = next_item;
+    }
+  }
+}
+#endif
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Local function to allocate memory
 // returns NULL if no memory free
@@ -629,7 +939,42 @@ static seq_midi_out_queue_item_t *SEQ_MIDI_OUT_SlotMalloc(void)
     return NULL;
   }
 
-#if SEQ_MIDI_OUT_MALLOC_METHOD == 4 || SEQ_MIDI_OUT_MALLOC_METHOD == 5
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+  // allocate memory if this hasn't been done yet
+  if( sched_pool == NULL ) {
+    sched_pool = (seq_midi_out_queue_item_t *)pvPortMalloc(
+      sizeof(seq_midi_out_queue_item_t)*SEQ_MIDI_OUT_MAX_EVENTS);
+    if( sched_pool == NULL ) {
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+      ++seq_midi_out_dropouts;
+#endif
+      return NULL;
+    }
+
+    // all slots are free
+    u32 i;
+    for(i=0; i<SEQ_MIDI_OUT_MAX_EVENTS; ++i)
+      sched_heap[i] = i;
+
+    // and the tag lists are empty
+    for(i=0; i<16; ++i)
+      sched_tag_first[i] = sched_tag_last[i] = SEQ_MIDI_OUT_NO_ITEM;
+
+    // no On events are counted
+    for(i=0; i<SEQ_MIDI_OUT_MAX_EVENTS; ++i)
+      sched_on[i].first = SEQ_MIDI_OUT_NO_ITEM;
+  }
+
+  // take the first free slot behind the heap, it will be sorted in by SEQ_MIDI_OUT_HeapInsert()
+  seq_midi_out_queue_item_t *item = &sched_pool[sched_heap[seq_midi_out_allocated]];
+  ++seq_midi_out_allocated;
+#if SEQ_MIDI_OUT_MALLOC_ANALYSIS
+  if( seq_midi_out_allocated > seq_midi_out_max_allocated )
+    seq_midi_out_max_allocated = seq_midi_out_allocated;
+#endif
+
+  return item;
+#elif SEQ_MIDI_OUT_MALLOC_METHOD == 4 || SEQ_MIDI_OUT_MALLOC_METHOD == 5
   seq_midi_out_queue_item_t *item;
 #if SEQ_MIDI_OUT_MALLOC_METHOD == 4
   if( (item=(seq_midi_out_queue_item_t *)pvPortMalloc(sizeof(seq_midi_out_queue_item_t))) == NULL ) {
@@ -751,6 +1096,247 @@ static seq_midi_out_queue_item_t *SEQ_MIDI_OUT_SlotMalloc(void)
 }
 
 
+#if SEQ_MIDI_OUT_SCHEDULER == 1
+/////////////////////////////////////////////////////////////////////////////
+// Local function which returns 1 if item a has to be sent before item b
+// The order is the same like with the linked list: at the same timestamp,
+// Clock and Tempo events are sent first. The remaining events are sent in
+// the order they have been scheduled, but CCs are sent before the first
+// On/OnOff event which was scheduled at this timestamp (HeapOrderSet stores
+// the position of this event in item->order)
+/////////////////////////////////////////////////////////////////////////////
+static inline s32 SEQ_MIDI_OUT_HeapBefore(seq_midi_out_queue_item_t *a, seq_midi_out_queue_item_t *b)
+{
+  if( a->timestamp != b->timestamp )
+    return a->timestamp < b->timestamp;
+
+  if( (a->prio == 0) != (b->prio == 0) )
+    return a->prio == 0;
+
+  if( a->order != b->order )
+    return (s32)(a->order - b->order) < 0; // takes care for counter overruns
+
+  if( a->prio != b->prio )
+    return a->prio < b->prio;
+
+  return (s32)(a->seq - b->seq) < 0; // takes care for counter overruns
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function which returns the position of a timestamp in sched_on[]
+// or the free position at which it can be added
+/////////////////////////////////////////////////////////////////////////////
+static inline u32 SEQ_MIDI_OUT_OnEntryHash(u32 timestamp)
+{
+  u32 h = (timestamp ^ (timestamp >> 16)) * 0x45d9f3b;
+  return (h ^ (h >> 16)) & (SEQ_MIDI_OUT_MAX_EVENTS-1);
+}
+
+static u32 SEQ_MIDI_OUT_OnEntryFind(u32 timestamp)
+{
+  u32 pos = SEQ_MIDI_OUT_OnEntryHash(timestamp);
+  while( sched_on[pos].first != SEQ_MIDI_OUT_NO_ITEM && sched_on[pos].timestamp != timestamp )
+    pos = (pos+1) & (SEQ_MIDI_OUT_MAX_EVENTS-1);
+
+  return pos;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function which removes an On/OnOff event from sched_on[]
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_OnEntryRelease(seq_midi_out_queue_item_t *item)
+{
+  u32 pos = SEQ_MIDI_OUT_OnEntryFind(item->timestamp);
+  seq_midi_out_on_entry_t *entry = &sched_on[pos];
+
+  // unlink the item, the next On/OnOff event becomes the first one
+  if( item->on_prev == SEQ_MIDI_OUT_NO_ITEM )
+    entry->first = item->on_next;
+  else
+    sched_pool[item->on_prev].on_next = item->on_next;
+  if( item->on_next == SEQ_MIDI_OUT_NO_ITEM )
+    entry->last = item->on_prev;
+  else
+    sched_pool[item->on_next].on_prev = item->on_prev;
+
+  if( entry->first != SEQ_MIDI_OUT_NO_ITEM )
+    return;
+
+  // free the entry, and move following entries into the gap
+  // if this is on the probing path from their hash position
+  u32 next = pos;
+  while( 1 ) {
+    next = (next+1) & (SEQ_MIDI_OUT_MAX_EVENTS-1);
+    if( sched_on[next].first == SEQ_MIDI_OUT_NO_ITEM )
+      break;
+
+    u32 home = SEQ_MIDI_OUT_OnEntryHash(sched_on[next].timestamp);
+    if( (pos <= next) ? (home <= pos || home > next) : (home <= pos && home > next) ) {
+      sched_on[pos] = sched_on[next];
+      pos = next;
+    }
+  }
+
+  sched_on[pos].first = SEQ_MIDI_OUT_NO_ITEM;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function which sets the sort order of a new or re-scheduled item
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_HeapOrderSet(seq_midi_out_queue_item_t *item)
+{
+  item->prio = SEQ_MIDI_OUT_EventPrio(item->event_type);
+  item->seq = sched_seq++;
+  item->order = item->seq;
+
+  if( item->event_type == SEQ_MIDI_OUT_OnEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent ) {
+    // the item has the latest seq, therefore it's appended to the list of its timestamp
+    u16 ix = item - sched_pool;
+    seq_midi_out_on_entry_t *entry = &sched_on[SEQ_MIDI_OUT_OnEntryFind(item->timestamp)];
+    item->on_next = SEQ_MIDI_OUT_NO_ITEM;
+    if( entry->first == SEQ_MIDI_OUT_NO_ITEM ) {
+      entry->timestamp = item->timestamp;
+      entry->first = ix;
+      item->on_prev = SEQ_MIDI_OUT_NO_ITEM;
+    } else {
+      item->on_prev = entry->last;
+      sched_pool[entry->last].on_next = ix;
+    }
+    entry->last = ix;
+  } else if( item->event_type == SEQ_MIDI_OUT_CCEvent ) {
+    seq_midi_out_on_entry_t *entry = &sched_on[SEQ_MIDI_OUT_OnEntryFind(item->timestamp)];
+    if( entry->first != SEQ_MIDI_OUT_NO_ITEM )
+      item->order = sched_pool[entry->first].seq; // CC will be sent before this On event
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function to sort a new item into the heap
+// the item has been allocated at sched_heap[seq_midi_out_allocated-1] by
+// SEQ_MIDI_OUT_SlotMalloc()
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_HeapInsert(seq_midi_out_queue_item_t *item)
+{
+  SEQ_MIDI_OUT_HeapOrderSet(item);
+
+  // append item to the list of its tag
+  u16 ix = sched_heap[seq_midi_out_allocated-1];
+  u8 tag = item->package.cable;
+  item->tag_next = SEQ_MIDI_OUT_NO_ITEM;
+  item->tag_prev = sched_tag_last[tag];
+  if( item->tag_prev == SEQ_MIDI_OUT_NO_ITEM )
+    sched_tag_first[tag] = ix;
+  else
+    sched_pool[item->tag_prev].tag_next = ix;
+  sched_tag_last[tag] = ix;
+
+  SEQ_MIDI_OUT_HeapSiftUp(seq_midi_out_allocated-1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function to remove the item at the given heap position
+// the pool slot is moved behind the heap, so that it is free again
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_HeapRemove(u32 pos)
+{
+  u16 ix = sched_heap[pos];
+  u32 last = --seq_midi_out_allocated;
+
+  seq_midi_out_queue_item_t *item = &sched_pool[ix];
+  if( item->event_type == SEQ_MIDI_OUT_OnEvent || item->event_type == SEQ_MIDI_OUT_OnOffEvent )
+    SEQ_MIDI_OUT_OnEntryRelease(item);
+
+  // remove item from the list of its tag
+  u8 tag = item->package.cable;
+  if( item->tag_prev == SEQ_MIDI_OUT_NO_ITEM )
+    sched_tag_first[tag] = item->tag_next;
+  else
+    sched_pool[item->tag_prev].tag_next = item->tag_next;
+  if( item->tag_next == SEQ_MIDI_OUT_NO_ITEM )
+    sched_tag_last[tag] = item->tag_prev;
+  else
+    sched_pool[item->tag_next].tag_prev = item->tag_prev;
+
+  if( pos != last ) {
+    // move last item into the gap
+    u16 last_ix = sched_heap[last];
+    sched_heap[pos] = last_ix;
+    sched_pool[last_ix].heap_pos = pos;
+    sched_heap[last] = ix;
+
+    // and restore the heap order
+    if( pos > 0 && SEQ_MIDI_OUT_HeapBefore(&sched_pool[last_ix], &sched_pool[sched_heap[(pos-1) >> 1]]) )
+      SEQ_MIDI_OUT_HeapSiftUp(pos);
+    else
+      SEQ_MIDI_OUT_HeapSiftDown(pos);
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function which moves an item towards the root until the heap order
+// is restored
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_HeapSiftUp(u32 pos)
+{
+  u16 ix = sched_heap[pos];
+  seq_midi_out_queue_item_t *item = &sched_pool[ix];
+
+  while( pos > 0 ) {
+    u32 parent = (pos-1) >> 1;
+    u16 parent_ix = sched_heap[parent];
+    if( !SEQ_MIDI_OUT_HeapBefore(item, &sched_pool[parent_ix]) )
+      break;
+
+    sched_heap[pos] = parent_ix;
+    sched_pool[parent_ix].heap_pos = pos;
+    pos = parent;
+  }
+
+  sched_heap[pos] = ix;
+  item->heap_pos = pos;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Local function which moves an item away from the root until the heap order
+// is restored
+/////////////////////////////////////////////////////////////////////////////
+static void SEQ_MIDI_OUT_HeapSiftDown(u32 pos)
+{
+  u32 num = seq_midi_out_allocated;
+  u16 ix = sched_heap[pos];
+  seq_midi_out_queue_item_t *item = &sched_pool[ix];
+
+  while( 1 ) {
+    u32 child = 2*pos + 1;
+    if( child >= num )
+      break;
+
+    // select the earlier child
+    if( (child+1) < num && SEQ_MIDI_OUT_HeapBefore(&sched_pool[sched_heap[child+1]], &sched_pool[sched_heap[child]]) )
+      ++child;
+
+    u16 child_ix = sched_heap[child];
+    if( !SEQ_MIDI_OUT_HeapBefore(&sched_pool[child_ix], item) )
+      break;
+
+    sched_heap[pos] = child_ix;
+    sched_pool[child_ix].heap_pos = pos;
+    pos = child;
+  }
+
+  sched_heap[pos] = ix;
+  item->heap_pos = pos;
+}
+
+#else
+
 /////////////////////////////////////////////////////////////////////////////
 // Local function to free memory
 /////////////////////////////////////////////////////////////////////////////
@@ -794,6 +1380,7 @@ static void SEQ_MIDI_OUT_SlotFree(seq_midi_out_queue_item_t *item)
   }
 #endif
 }
+#endif
 
 
 //! \}
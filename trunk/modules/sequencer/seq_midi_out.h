@@ -19,6 +19,16 @@
 // Global definitions
 /////////////////////////////////////////////////////////////////////////////
 
+// scheduler method:
+// 0: sorted linked list (O(n) insert, memory allocated via SEQ_MIDI_OUT_MALLOC_METHOD)
+// 1: binary heap (O(log n) insert and pop, events are stored in a statically
+//    sized pool, SEQ_MIDI_OUT_MALLOC_METHOD is ignored)
+//    Events are additionally indexed by their tag, so that SEQ_MIDI_OUT_ReSchedule
+//    only visits the events of the given tag
+#ifndef SEQ_MIDI_OUT_SCHEDULER
+#define SEQ_MIDI_OUT_SCHEDULER 0
+#endif
+
 // memory alloccation method:
 // 0: internal static allocation with one byte for each flag
 // 1: internal static allocation with 8bit flags
@@ -31,13 +41,15 @@
 #endif
 
 // max number of scheduled events which will allocate memory
-// each event allocates 12 bytes
+// each event allocates 12 bytes (42 bytes with SEQ_MIDI_OUT_SCHEDULER 1)
 // MAX_EVENTS must be a power of two! (e.g. 64, 128, 256, 512, ...)
+// (SEQ_MIDI_OUT_SCHEDULER 1 supports up to 32768 events)
 #ifndef SEQ_MIDI_OUT_MAX_EVENTS
 #define SEQ_MIDI_OUT_MAX_EVENTS 128
 #endif
 
-// enable seq_midi_out_max_allocated and seq_midi_out_dropouts
+// enable seq_midi_out_max_allocated, seq_midi_out_dropouts and the
+// seq_midi_out_reschedule_visited* counters
 #ifndef SEQ_MIDI_OUT_MALLOC_ANALYSIS
 #define SEQ_MIDI_OUT_MALLOC_ANALYSIS 0
 #endif
@@ -56,6 +68,15 @@ typedef enum {
   SEQ_MIDI_OUT_OnOffEvent  // Plays On and Off event after given length
 } seq_midi_out_event_type_t;
 
+// an event for SEQ_MIDI_OUT_SendBatch
+typedef struct {
+  mios32_midi_port_t    port;
+  mios32_midi_package_t package;
+  seq_midi_out_event_type_t event_type;
+  u32                   timestamp;
+  u32                   len;
+} seq_midi_out_event_t;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Prototypes
@@ -69,6 +90,7 @@ extern s32 SEQ_MIDI_OUT_Callback_BPM_TickGet_Set(void *_callback_bpm_tick_get);
 extern s32 SEQ_MIDI_OUT_Callback_BPM_Set_Set(void *_callback_bpm_set);
 
 extern s32 SEQ_MIDI_OUT_Send(mios32_midi_port_t port, mios32_midi_package_t midi_package, seq_midi_out_event_type_t event_type, u32 timestamp, u32 len);
+extern s32 SEQ_MIDI_OUT_SendBatch(seq_midi_out_event_t *events, u32 num_events);
 extern s32 SEQ_MIDI_OUT_ReSchedule(u8 tag, seq_midi_out_event_type_t event_type, u32 timestamp);
 extern s32 SEQ_MIDI_OUT_FlushQueue(void);
 extern s32 SEQ_MIDI_OUT_FreeHeap(void);
@@ -83,6 +105,8 @@ extern u32 seq_midi_out_allocated;
 #if SEQ_MIDI_OUT_MALLOC_ANALYSIS
 extern u32 seq_midi_out_max_allocated;
 extern u32 seq_midi_out_dropouts;
+extern u32 seq_midi_out_reschedule_visited;
+extern u32 seq_midi_out_reschedule_visited_max;
 #endif
 
 #endif /* _SEQ_MIDI_OUT_H */
@@ -266,6 +266,9 @@ s32 SID_Init(u32 mode)
       sid_regs[sid].ALL[reg] = 0;
       sid_regs_shadow[sid].ALL[reg] = 0;
     }
+#if SID_USE_DIRTY_FLAGS
+    sid_regs[sid].dirty = 0;
+#endif
 #if SID_USE_MBNET
     sid_regs_shadow_updated[sid] = 0xffffffff;
 #endif
@@ -337,12 +340,24 @@ s32 SID_Update(u32 mode)
   for(sid=0; sid<SID_NUM; ++sid) {
     u8 *regs = (u8 *)&sid_regs[sid];
     u8 *regs_shadow = (u8 *)&sid_regs_shadow[sid];
+#if SID_USE_DIRTY_FLAGS
+    // only the marked registers have to be checked
+    u32 dirty = (mode >= 1) ? 0xffffffff : sid_regs[sid].dirty;
+    sid_regs[sid].dirty = 0;
 
+    for(reg=0; dirty; ++reg, dirty >>= 1) {
+      if( (dirty & 1) && regs_shadow[reg] != regs[reg] ) {
+	sid_regs_shadow_updated[sid] |= (1 << reg);
+	regs_shadow[reg] = regs[reg];
+      }
+    }
+#else
     for(reg=0; reg<SID_REGS_NUM; ++reg) {
       if( *regs_shadow != *regs )
 	sid_regs_shadow_updated[sid] |= (1 << reg);
       *regs_shadow++ = *regs++;
     }
+#endif
   }
   MIOS32_IRQ_Enable();
 
@@ -465,6 +480,18 @@ s32 SID_Update(u32 mode)
 	sid_regs_shadow[sid].ALL[reg] = ~sid_regs[sid].ALL[reg];
   }
 
+#if SID_USE_DIRTY_FLAGS
+  // take over the dirty flags: only the marked registers have to be checked
+  // (the flags of the right SID are ORed, since both SIDs are handled together)
+  u32 dirty[SID_NUM];
+  MIOS32_IRQ_Disable();
+  for(sid=0; sid<SID_NUM; ++sid) {
+    dirty[sid] = (mode >= 1) ? 0xffffffff : sid_regs[sid].dirty;
+    sid_regs[sid].dirty = 0;
+  }
+  MIOS32_IRQ_Enable();
+#endif
+
   // this loop should run so fast as possible, 
   // we consider to update two SIDs at once if values are identical
   for(sid=0; sid<SID_NUM; sid+=2) {
@@ -484,10 +511,18 @@ s32 SID_Update(u32 mode)
     sid_cs_pin_t *cs_pin1 = NULL;
 #endif
 
+#if SID_USE_DIRTY_FLAGS
+    u32 dirty_lr = dirty[sid] | ((sid+1) < SID_NUM ? dirty[sid+1] : 0);
+#endif
+
     for(i=0; i<SID_REGS_NUM; ++i, update_order_ptr++) {
       u8 data;
 
       reg = *update_order_ptr;
+#if SID_USE_DIRTY_FLAGS
+      if( !(dirty_lr & (1 << reg)) )
+	continue;
+#endif
 
       // check if update of left/right channel SID are required
       // partly duplicated code ensures best performance in all cases!
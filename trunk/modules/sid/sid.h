@@ -122,6 +122,13 @@ extern "C" {
 #define SID_USE_MBNET 0
 #endif
 
+// if 1: SID_Update() only checks the registers which have been marked in
+// sid_regs_t.dirty - all writers of sid_regs[] have to set the dirty flags!
+// if 0: all registers are compared with their shadow copy on each update
+#ifndef SID_USE_DIRTY_FLAGS
+#define SID_USE_DIRTY_FLAGS 0
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Global Types
@@ -154,6 +161,26 @@ typedef union {
   };
 } sid_voice_t;
 
+// dirty flags of the voice registers (have to be shifted by 7*voice)
+#define SID_VOICE_DIRTY_FRQ      0x03
+#define SID_VOICE_DIRTY_PW       0x0c
+#define SID_VOICE_DIRTY_WAVEFORM 0x10
+#define SID_VOICE_DIRTY_AD       0x20
+#define SID_VOICE_DIRTY_SR       0x40
+
+// dirty flags of the filter/volume registers
+#define SID_DIRTY_FILTER_CUTOFF  (3 << 21) // filter_l/filter_h
+#define SID_DIRTY_FILTER_RES_CHN (1 << 23) // filter_select/resonance
+#define SID_DIRTY_FILTER_MODE_VOL (1 << 24) // volume/filter_mode
+
+// marks registers of a sid_regs_t structure as changed
+// (sid_regs_t has no dirty flags if the option is disabled)
+#if SID_USE_DIRTY_FLAGS
+#define SID_REGS_DIRTY_SET(regs, flags) ((regs)->dirty |= (flags))
+#else
+#define SID_REGS_DIRTY_SET(regs, flags) ((void)0)
+#endif
+
 
 typedef union {
   u8 ALL[SID_REGS_NUM];
@@ -191,6 +218,12 @@ typedef union {
     u8 dummy_v2[7];
     sid_voice_t v3;
   };
+#if SID_USE_DIRTY_FLAGS
+  struct {
+    u8 dummy_regs[SID_REGS_NUM];
+    u32 dirty; // one flag per register: set by the writer, cleared by SID_Update()
+  };
+#endif
 } sid_regs_t;
 
 
@@ -24,6 +24,7 @@
 #include <getopt.h>
 
 #include <sys/types.h>
+#include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -55,6 +56,11 @@
 #define SYSEX_BUFFER_MAX 0x100000 // 1 MB
 #define SYSEX_BLOB_LEN_MAX 512 // maximal length of a blob
 
+#define OSC_SCHEDULER_SLOTS 128 // number of bundle elements which can be scheduled
+#define OSC_SCHEDULER_STATS_PERIOD 10 // print scheduler statistics each 10 seconds
+
+#define NTP_UNIX_OFFSET 2208988800U // seconds between 1900 (NTP epoch) and 1970 (unix epoch)
+
 /////////////////////////////////////////////////////////////////////////////
 // Local variables
 /////////////////////////////////////////////////////////////////////////////
@@ -70,6 +76,10 @@ static volatile int terminated;
 
 static struct sockaddr_in remote_address_info;
 
+static int osc_latency_ms = -1; // scheduler disabled
+static mios32_osc_scheduler_slot_t osc_scheduler_slot[OSC_SCHEDULER_SLOTS];
+static mios32_osc_scheduler_t osc_scheduler;
+
 
 static unsigned char sysex_buffer_in[SYSEX_BUFFER_MAX];
 static unsigned sysex_buffer_in_len;
@@ -557,6 +567,36 @@ void receive_poll(PtTimestamp timestamp, void *userData)
   } while( bundle_ix );
 }
 
+/////////////////////////////////////////////////////////////////////////////
+// Returns the system time in OSC timetag format
+/////////////////////////////////////////////////////////////////////////////
+static mios32_osc_timetag_t timetag_get(void)
+{
+  struct timeval tv;
+  mios32_osc_timetag_t timetag;
+
+  gettimeofday(&tv, NULL);
+  timetag.seconds = (u32)tv.tv_sec + NTP_UNIX_OFFSET;
+  timetag.fraction = (u32)(((unsigned long long)tv.tv_usec << 32) / 1000000);
+
+  return timetag;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Prints the statistics of the bundle scheduler
+/////////////////////////////////////////////////////////////////////////////
+static void scheduler_stats_print(void)
+{
+  mios32_osc_scheduler_stats_t stats;
+
+  MIOS32_OSC_SchedulerStatsGet(&osc_scheduler, &stats);
+  printf("Scheduler: %u queued, %u immediate, %u late (max %u uS), %u overflows, max dispatch delay %u uS\n",
+	 (unsigned)stats.queued, (unsigned)stats.immediate, (unsigned)stats.late, (unsigned)stats.max_late_us,
+	 (unsigned)stats.overflows, (unsigned)stats.max_dispatch_delay_us);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // This function handles OSC and MIDI messages
 /////////////////////////////////////////////////////////////////////////////
@@ -564,6 +604,7 @@ static void proxy_handler(void)
 {
   char buffer[OSC_BUFFER_MAX];
   s32 status;
+  u32 stats_seconds = 0;
 
   // clear sysex buffer
   sysex_buffer_in_len = 0;
@@ -597,6 +638,21 @@ static void proxy_handler(void)
     printf("MIDI OUT '%s: %s' opened.\n", info->interf, info->name);
   }
 
+  // init bundle scheduler
+  // recv() has to return each mS, so that scheduled bundles are executed in time
+  if( osc_latency_ms >= 0 ) {
+    struct timeval timeout;
+
+    MIOS32_OSC_SchedulerInit(&osc_scheduler, osc_scheduler_slot, OSC_SCHEDULER_SLOTS, parse_root, NULL);
+    MIOS32_OSC_SchedulerLatencySet(&osc_scheduler, osc_latency_ms * 1000);
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 1000;
+    setsockopt(osc_server_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    printf("Bundle scheduler enabled, latency %d mS\n", osc_latency_ms);
+  }
+
   // start proxy
   printf("Proxy is running!\n");
   terminated = 0;
@@ -608,11 +664,25 @@ static void proxy_handler(void)
       printf("### Received %d bytes\n", size);
       // MIOS32_MIDI_SendDebugHexDump(buffer, size);
 #endif
-      status = MIOS32_OSC_ParsePacket((u8 *)buffer, size, parse_root);
+      if( osc_latency_ms >= 0 )
+	status = MIOS32_OSC_ParsePacketScheduled((u8 *)buffer, size, &osc_scheduler, timetag_get());
+      else
+	status = MIOS32_OSC_ParsePacket((u8 *)buffer, size, parse_root);
       if( status < 0 ) {
 	printf("Invalid OSC packet, status %d\n", (int)status);
       }	
     }
+
+    if( osc_latency_ms >= 0 ) {
+      mios32_osc_timetag_t now = timetag_get();
+      MIOS32_OSC_SchedulerHandler(&osc_scheduler, now);
+
+      if( (now.seconds - stats_seconds) >= OSC_SCHEDULER_STATS_PERIOD ) {
+	if( stats_seconds )
+	  scheduler_stats_print();
+	stats_seconds = now.seconds;
+      }
+    }
   }
 
   // close device (this not explicitly needed in most implementations)
@@ -626,7 +696,7 @@ static void proxy_handler(void)
 
 int usage(char *program_name)
 {
-  printf("SYNTAX: %s <remote-host> <remote-port> [<local-port>] [--in <in-port-number>] [--out <out-port-number>]\n", program_name);
+  printf("SYNTAX: %s <remote-host> <remote-port> [<local-port>] [--in <in-port-number>] [--out <out-port-number>] [--latency <ms>]\n", program_name);
   return 1;
 }
 
@@ -653,10 +723,11 @@ int main(int argc, char* argv[])
   const struct option longopts[] = {
     { "in",    required_argument, NULL, 'i' },
     { "out",   required_argument, NULL, 'o' },
+    { "latency", required_argument, NULL, 'l' },
     { NULL,    0,                 NULL,  0 }
   };
 
-  while( (ch=getopt_long(argc, argv, "io", longopts, NULL)) != -1 )
+  while( (ch=getopt_long(argc, argv, "iol", longopts, NULL)) != -1 )
     switch( ch ) {
       case 'i':
 	opt_in = atoi(optarg);
@@ -664,6 +735,11 @@ int main(int argc, char* argv[])
       case 'o':
 	opt_out = atoi(optarg);
 	break;
+      case 'l':
+	osc_latency_ms = atoi(optarg);
+	if( osc_latency_ms < 0 || osc_latency_ms > 10000 )
+	  return usage(program_name);
+	break;
     default:
       return usage(program_name);
     }